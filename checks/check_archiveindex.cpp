@@ -0,0 +1,417 @@
+#include "rts2fits/archiveindex.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <libnova/libnova.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define NUM_ENTRIES   20000
+
+static char tmpdir[50];
+static std::string indexfile;
+
+static const char *filters[] = {"B", "V", "R", "I"};
+
+void setup_index (void)
+{
+	strcpy (tmpdir, "/tmp/rts2-check-index-XXXXXX");
+	ck_assert (mkdtemp (tmpdir) != NULL);
+	indexfile = std::string (tmpdir) + "/archive.idx";
+	srand (42);
+}
+
+void teardown_index (void)
+{
+	std::string cmd = std::string ("rm -rf ") + tmpdir;
+	ck_assert_int_eq (system (cmd.c_str ()), 0);
+}
+
+static void randomEntry (rts2image::ArchiveEntry &entry)
+{
+	rts2image::ArchiveIndex::initEntry (entry);
+	entry.JD = 2461333.5 + 30.0 * rand () / RAND_MAX;
+	entry.ra = 360.0 * rand () / RAND_MAX;
+	entry.dec = asin (2.0 * rand () / RAND_MAX - 1) * 180.0 / M_PI;
+	entry.exposure = 10;
+	entry.tar_id = rand () % 50;
+	strcpy (entry.filter, filters[rand () % 4]);
+	strcpy (entry.camera, "C0");
+}
+
+static std::string entryPath (int i)
+{
+	char buf[50];
+	snprintf (buf, sizeof (buf), "/images/%d/%05d.fits", i % 10, i);
+	return std::string (buf);
+}
+
+static void fillIndex (rts2image::ArchiveIndex &index, int num)
+{
+	for (int i = 0; i < num; i++)
+	{
+		rts2image::ArchiveEntry entry;
+		randomEntry (entry);
+		ck_assert_int_eq (index.addEntry (entryPath (i).c_str (), entry), 0);
+	}
+}
+
+static void bruteForce (rts2image::ArchiveIndex &index, const rts2image::ArchiveQuery &q, int num, std::set <std::string> &ret)
+{
+	for (int i = 0; i < num; i++)
+	{
+		const rts2image::ArchiveItem *item = index.find (entryPath (i).c_str ());
+		if (item == NULL)
+			continue;
+		const rts2image::ArchiveEntry &e = item->entry;
+		if (!std::isnan (q.from) && e.JD < q.from)
+			continue;
+		if (!std::isnan (q.to) && e.JD > q.to)
+			continue;
+		if (!q.filter.empty () && q.filter != e.filter)
+			continue;
+		if (q.tar_id >= 0 && q.tar_id != e.tar_id)
+			continue;
+		if (!std::isnan (q.radius))
+		{
+			struct ln_equ_posn p1, p2;
+			p1.ra = q.ra;
+			p1.dec = q.dec;
+			p2.ra = e.ra;
+			p2.dec = e.dec;
+			if (ln_get_angular_separation (&p1, &p2) > q.radius)
+				continue;
+		}
+		ret.insert (item->path);
+	}
+}
+
+static void checkQuery (rts2image::ArchiveIndex &index, const rts2image::ArchiveQuery &q, int num)
+{
+	std::vector <const rts2image::ArchiveItem *> res;
+	index.query (q, res);
+
+	std::set <std::string> expected;
+	bruteForce (index, q, num, expected);
+
+	ck_assert_int_eq (res.size (), expected.size ());
+	for (size_t i = 0; i < res.size (); i++)
+	{
+		ck_assert (expected.find (res[i]->path) != expected.end ());
+		// sorted by exposure start
+		if (i > 0)
+			ck_assert (res[i - 1]->entry.JD <= res[i]->entry.JD);
+	}
+}
+
+START_TEST(journal)
+{
+	rts2image::ArchiveIndex writer;
+	ck_assert_int_eq (writer.open (indexfile.c_str (), false), 0);
+	fillIndex (writer, 100);
+	ck_assert_int_eq (writer.removeFile (entryPath (10).c_str ()), 0);
+	ck_assert_int_eq (writer.size (), 99);
+	ck_assert_int_eq (writer.getRecords (), 101);
+
+	rts2image::ArchiveIndex reader;
+	ck_assert_int_eq (reader.open (indexfile.c_str ()), 0);
+	ck_assert_int_eq (reader.size (), 99);
+	ck_assert (reader.find (entryPath (10).c_str ()) == NULL);
+	ck_assert_dbl_eq (reader.find (entryPath (11).c_str ())->entry.JD, writer.find (entryPath (11).c_str ())->entry.JD, 1e-12);
+
+	// read-only index cannot be modified
+	rts2image::ArchiveEntry entry;
+	randomEntry (entry);
+	ck_assert_int_eq (reader.addEntry ("/images/new.fits", entry), -1);
+
+	// reader picks up only appended records
+	ck_assert_int_eq (writer.addEntry ("/images/new.fits", entry), 0);
+	ck_assert_int_eq (writer.addEntry (entryPath (11).c_str (), entry), 0);
+	ck_assert_int_eq (reader.refresh (), 2);
+	ck_assert_int_eq (reader.refresh (), 0);
+	ck_assert_int_eq (reader.size (), 100);
+	ck_assert_dbl_eq (reader.find (entryPath (11).c_str ())->entry.JD, entry.JD, 1e-12);
+
+	// second writer sees records of the first
+	rts2image::ArchiveIndex writer2;
+	ck_assert_int_eq (writer2.open (indexfile.c_str (), false), 0);
+	ck_assert_int_eq (writer2.removeFile ("/images/new.fits"), 0);
+	ck_assert_int_eq (writer.addEntry ("/images/new2.fits", entry), 0);
+	ck_assert (writer.find ("/images/new.fits") == NULL);
+	ck_assert_int_eq (writer.size (), 100);
+
+	struct stat sb1, sb2;
+	ck_assert_int_eq (stat (indexfile.c_str (), &sb1), 0);
+	ck_assert_int_eq (writer.compact (), 0);
+	ck_assert_int_eq (writer.getRecords (), 100);
+	ck_assert_int_eq (stat (indexfile.c_str (), &sb2), 0);
+	ck_assert (sb2.st_size < sb1.st_size);
+
+	// compacted index is loaded again
+	ck_assert_int_eq (reader.refresh (), 100);
+	ck_assert_int_eq (reader.size (), 100);
+	ck_assert_int_eq (reader.getRecords (), 100);
+
+	// writer with old file appends to the new one
+	ck_assert_int_eq (writer2.addEntry ("/images/new3.fits", entry), 0);
+	ck_assert_int_eq (writer2.size (), 101);
+	ck_assert_int_eq (reader.refresh (), 1);
+	ck_assert (reader.find ("/images/new3.fits") != NULL);
+}
+END_TEST
+
+START_TEST(query)
+{
+	rts2image::ArchiveIndex index;
+	ck_assert_int_eq (index.open (indexfile.c_str (), false), 0);
+	fillIndex (index, NUM_ENTRIES);
+
+	for (int i = 0; i < 20; i++)
+	{
+		rts2image::ArchiveQuery q;
+		q.from = 2461333.5 + 30.0 * rand () / RAND_MAX;
+		q.to = q.from + 0.5;
+		checkQuery (index, q, NUM_ENTRIES);
+
+		q.filter = filters[i % 4];
+		checkQuery (index, q, NUM_ENTRIES);
+
+		rts2image::ArchiveQuery qp;
+		qp.ra = 360.0 * rand () / RAND_MAX;
+		qp.dec = 180.0 * rand () / RAND_MAX - 90;
+		qp.radius = 2;
+		checkQuery (index, qp, NUM_ENTRIES);
+
+		qp.tar_id = i;
+		qp.from = 2461340;
+		checkQuery (index, qp, NUM_ENTRIES);
+	}
+
+	// around pole and RA 0
+	rts2image::ArchiveQuery qp;
+	qp.ra = 0.5;
+	qp.dec = 89;
+	qp.radius = 5;
+	checkQuery (index, qp, NUM_ENTRIES);
+
+	rts2image::ArchiveQuery qd;
+	qd.directory = "/images/3/";
+	std::vector <const rts2image::ArchiveItem *> res;
+	index.query (qd, res);
+	ck_assert_int_eq (res.size (), NUM_ENTRIES / 10);
+
+	// queries after update
+	ck_assert_int_eq (index.removeFile (entryPath (3).c_str ()), 0);
+	res.clear ();
+	index.query (qd, res);
+	ck_assert_int_eq (res.size (), NUM_ENTRIES / 10 - 1);
+
+	// 1x1 degree field
+	rts2image::ArchiveEntry entry;
+	randomEntry (entry);
+	entry.ra = 10;
+	entry.dec = 20;
+	entry.wcs[4] = entry.wcs[5] = 1 / 3600.0;
+	entry.width = entry.height = 3600;
+	ck_assert_dbl_eq (rts2image::ArchiveIndex::getFieldRadius (entry), sqrt (2) / 2.0, 1e-12);
+	ck_assert_int_eq (index.addEntry ("/field/1.fits", entry), 0);
+	// unknown field size
+	entry.wcs[4] = NAN;
+	ck_assert_int_eq (index.addEntry ("/field/2.fits", entry), 0);
+
+	rts2image::ArchiveQuery qf;
+	qf.ra = 10.6;
+	qf.dec = 20.6;
+	qf.radius = 2;
+	qf.directory = "/field";
+	res.clear ();
+	index.query (qf, res);
+	ck_assert_int_eq (res.size (), 2);
+
+	qf.field = true;
+	res.clear ();
+	index.query (qf, res);
+	ck_assert_int_eq (res.size (), 1);
+	ck_assert_str_eq (res[0]->path.c_str (), "/field/2.fits");
+
+	qf.ra = 10.3;
+	qf.dec = 20.3;
+	res.clear ();
+	index.query (qf, res);
+	ck_assert_int_eq (res.size (), 2);
+}
+END_TEST
+
+START_TEST(listdir)
+{
+	rts2image::ArchiveIndex index;
+	ck_assert_int_eq (index.open (indexfile.c_str (), false), 0);
+
+	rts2image::ArchiveEntry entry;
+	randomEntry (entry);
+	ck_assert_int_eq (index.addEntry ("/a/b/x.fits", entry), 0);
+	ck_assert_int_eq (index.addEntry ("/a/b/y.fits", entry), 0);
+	ck_assert_int_eq (index.addEntry ("/a/b-c/y.fits", entry), 0);
+	ck_assert_int_eq (index.addEntry ("/a/c/d/y.fits", entry), 0);
+	ck_assert_int_eq (index.addEntry ("/a/z.fits", entry), 0);
+	ck_assert_int_eq (index.addEntry ("/ab/z.fits", entry), 0);
+
+	std::vector <std::string> subdirs;
+	std::vector <const rts2image::ArchiveItem *> files;
+	index.listDirectory ("/a/", subdirs, files);
+
+	ck_assert_int_eq (subdirs.size (), 3);
+	ck_assert_str_eq (subdirs[0].c_str (), "b");
+	ck_assert_str_eq (subdirs[1].c_str (), "b-c");
+	ck_assert_str_eq (subdirs[2].c_str (), "c");
+	ck_assert_int_eq (files.size (), 1);
+	ck_assert_str_eq (files[0]->path.c_str (), "/a/z.fits");
+
+	ck_assert_int_eq (index.removeDirectory ("/a/b"), 0);
+	ck_assert_int_eq (index.size (), 4);
+	ck_assert (index.find ("/a/b-c/y.fits") != NULL);
+}
+END_TEST
+
+START_TEST(scan)
+{
+	std::string dir = std::string (tmpdir) + "/images";
+	ck_assert_int_eq (mkdir (dir.c_str (), 0755), 0);
+	ck_assert_int_eq (mkdir ((dir + "/sub").c_str (), 0755), 0);
+
+	const char *names[] = {"/1.fits", "/2.fits", "/sub/3.fit", "/sub/readme.txt"};
+	for (int i = 0; i < 4; i++)
+	{
+		FILE *f = fopen ((dir + names[i]).c_str (), "w");
+		ck_assert (f != NULL);
+		fprintf (f, "not a FITS file\n");
+		fclose (f);
+	}
+
+	rts2image::ArchiveIndex index;
+	ck_assert_int_eq (index.open (indexfile.c_str (), false), 0);
+
+	ck_assert_int_eq (index.scan (dir.c_str ()), 3);
+	ck_assert_int_eq (index.size (), 3);
+	ck_assert (index.find ((dir + "/sub/3.fit").c_str ())->entry.flags & ARCHIVE_INVALID);
+
+	// invalid files are not returned by default
+	rts2image::ArchiveQuery q;
+	std::vector <const rts2image::ArchiveItem *> res;
+	index.query (q, res);
+	ck_assert_int_eq (res.size (), 0);
+	q.invalid = true;
+	index.query (q, res);
+	ck_assert_int_eq (res.size (), 3);
+
+	// unchanged files are not read again
+	ck_assert_int_eq (index.scan (dir.c_str ()), 0);
+
+	FILE *f = fopen ((dir + "/2.fits").c_str (), "a");
+	fprintf (f, "more data\n");
+	fclose (f);
+	ck_assert_int_eq (unlink ((dir + "/sub/3.fit").c_str ()), 0);
+
+	ck_assert_int_eq (index.scan (dir.c_str ()), 2);
+	ck_assert_int_eq (index.size (), 2);
+	ck_assert (index.find ((dir + "/sub/3.fit").c_str ()) == NULL);
+
+	// non-recursive scan keeps entries in subdirectories
+	f = fopen ((dir + "/sub/4.fits").c_str (), "w");
+	fclose (f);
+	ck_assert_int_eq (index.scan ((dir + "/sub").c_str ()), 1);
+	ck_assert_int_eq (index.scan (dir.c_str (), false), 0);
+	ck_assert_int_eq (index.size (), 3);
+}
+END_TEST
+
+START_TEST(benchmark)
+{
+	rts2image::ArchiveIndex index;
+	ck_assert_int_eq (index.open (indexfile.c_str (), false), 0);
+	fillIndex (index, NUM_ENTRIES);
+
+	std::vector <rts2image::ArchiveQuery> queries;
+	for (int i = 0; i < 200; i++)
+	{
+		rts2image::ArchiveQuery q;
+		q.ra = 360.0 * rand () / RAND_MAX;
+		q.dec = 180.0 * rand () / RAND_MAX - 90;
+		q.radius = 1;
+		queries.push_back (q);
+	}
+
+	size_t n1 = 0;
+	uint64_t t0 = gettime_ns ();
+	for (std::vector <rts2image::ArchiveQuery>::iterator iter = queries.begin (); iter != queries.end (); iter++)
+	{
+		std::set <std::string> ret;
+		bruteForce (index, *iter, NUM_ENTRIES, ret);
+		n1 += ret.size ();
+	}
+	uint64_t tbrute = gettime_ns () - t0;
+
+	size_t n2 = 0;
+	t0 = gettime_ns ();
+	for (std::vector <rts2image::ArchiveQuery>::iterator iter = queries.begin (); iter != queries.end (); iter++)
+	{
+		std::vector <const rts2image::ArchiveItem *> ret;
+		index.query (*iter, ret);
+		n2 += ret.size ();
+	}
+	uint64_t tindex = gettime_ns () - t0;
+
+	ck_assert_int_eq (n1, n2);
+
+	t0 = gettime_ns ();
+	rts2image::ArchiveIndex reader;
+	ck_assert_int_eq (reader.open (indexfile.c_str ()), 0);
+	uint64_t tload = gettime_ns () - t0;
+	ck_assert_int_eq (reader.size (), NUM_ENTRIES);
+
+	printf ("%d entries: loaded in %.1f ms, 200 position queries %.1f ms, linear search %.1f ms\n", NUM_ENTRIES, tload / 1e6, tindex / 1e6, tbrute / 1e6);
+}
+END_TEST
+
+Suite * archiveindex_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("ArchiveIndex");
+	tc_core = tcase_create ("Core");
+	tcase_add_checked_fixture (tc_core, setup_index, teardown_index);
+	tcase_set_timeout (tc_core, 60);
+	tcase_add_test (tc_core, journal);
+	tcase_add_test (tc_core, query);
+	tcase_add_test (tc_core, listdir);
+	tcase_add_test (tc_core, scan);
+	tcase_add_test (tc_core, benchmark);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = archiveindex_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
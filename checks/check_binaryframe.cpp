@@ -0,0 +1,366 @@
+#include "daemon.h"
+#include "valuearray.h"
+#include "valuestat.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define NUM_DOUBLES    50
+#define NUM_INTEGERS   20
+#define ARRAY_SIZE     100
+#define REPLAYS        500
+
+class FrameDaemon:public rts2core::Daemon
+{
+	public:
+		FrameDaemon (int argc, char **argv, bool sender):rts2core::Daemon (argc, argv)
+		{
+			if (!sender)
+				return;
+			for (int i = 0; i < NUM_DOUBLES; i++)
+			{
+				char name[20];
+				snprintf (name, sizeof (name), "double_%d", i);
+				createValue (doubles[i], name, "double value", false);
+			}
+			for (int i = 0; i < NUM_INTEGERS; i++)
+			{
+				char name[20];
+				snprintf (name, sizeof (name), "int_%d", i);
+				createValue (integers[i], name, "integer value", false);
+			}
+			createValue (array, "array", "readout statistics", false);
+			createValue (stat, "stat", "statistics", false);
+			createValue (str, "string", "string value", false);
+		}
+
+		/**
+		 * Change values the way they change during exposures - doubles
+		 * by small amount, integers by a few counts.
+		 */
+		void change (int step)
+		{
+			for (int i = 0; i < NUM_DOUBLES; i++)
+				doubles[i]->setValueDouble (20.0 + i * 0.37 + sin (step * 0.01 + i) * 0.25);
+			for (int i = 0; i < NUM_INTEGERS; i++)
+				integers[i]->setValueInteger (1000 * i + step % 17 - 8);
+			std::vector <double> arr;
+			for (int i = 0; i < ARRAY_SIZE; i++)
+				arr.push_back (1200.0 + 0.5 * ((step + i) % 31));
+			array->setValueArray (arr);
+			stat->addValue (step * 0.1, 20);
+			stat->calculate ();
+			char s[30];
+			snprintf (s, sizeof (s), "step %d", step);
+			str->setValueCharArr (s);
+		}
+
+		/**
+		 * Move connections from the added list to the connections list.
+		 */
+		void processAdded () { idle (); }
+
+		rts2core::ValueDouble *doubles[NUM_DOUBLES];
+		rts2core::ValueInteger *integers[NUM_INTEGERS];
+		rts2core::DoubleArray *array;
+		rts2core::ValueDoubleStat *stat;
+		rts2core::ValueString *str;
+
+	protected:
+		virtual bool isRunning (rts2core::Connection *conn) { return true; }
+		virtual rts2core::Connection *createClientConnection (rts2core::NetworkAddress * in_addr) { return NULL; }
+};
+
+FrameDaemon *sender;
+FrameDaemon *receiver;
+rts2core::Connection *sconn;
+rts2core::Connection *rconn;
+int rsock;
+
+void setup_frames (void)
+{
+	const char *argv[] = {"check_binaryframe"};
+	sender = new FrameDaemon (1, (char **) argv, true);
+	receiver = new FrameDaemon (1, (char **) argv, false);
+	receiver->setTimeout (1000);
+
+	int sv[2];
+	ck_assert_int_eq (socketpair (AF_UNIX, SOCK_STREAM, 0, sv), 0);
+	fcntl (sv[1], F_SETFL, O_NONBLOCK);
+	rsock = sv[1];
+	sconn = new rts2core::Connection (sv[0], sender);
+	rconn = new rts2core::Connection (sv[1], receiver);
+	sender->addConnection (sconn);
+	sender->processAdded ();
+	receiver->addConnection (rconn);
+	receiver->processAdded ();
+}
+
+void teardown_frames (void)
+{
+	delete sender;
+	delete receiver;
+	sender = receiver = NULL;
+}
+
+/**
+ * Let receiver process all data waiting on its socket.
+ */
+void receiveAll ()
+{
+	int pending;
+	for (int i = 0; i < 10000; i++)
+	{
+		if (ioctl (rsock, FIONREAD, &pending) || pending == 0)
+			return;
+		receiver->oneRunLoop ();
+	}
+}
+
+void checkReceived ()
+{
+	for (int i = 0; i < NUM_DOUBLES; i++)
+	{
+		rts2core::Value *v = rconn->getValue (sender->doubles[i]->getName ().c_str ());
+		ck_assert_ptr_ne (v, NULL);
+		ck_assert (v->getValueDouble () == sender->doubles[i]->getValueDouble ());
+	}
+	for (int i = 0; i < NUM_INTEGERS; i++)
+		ck_assert_int_eq (rconn->getValueInteger (sender->integers[i]->getName ().c_str ()), sender->integers[i]->getValueInteger ());
+	rts2core::DoubleArray *arr = (rts2core::DoubleArray *) rconn->getValue ("array");
+	ck_assert_ptr_ne (arr, NULL);
+	ck_assert_int_eq (arr->size (), sender->array->size ());
+	ck_assert (arr->getValueVector () == sender->array->getValueVector ());
+	rts2core::ValueDoubleStat *st = (rts2core::ValueDoubleStat *) rconn->getValue ("stat");
+	ck_assert_ptr_ne (st, NULL);
+	ck_assert_int_eq (st->getNumMes (), sender->stat->getNumMes ());
+	ck_assert (st->getValueDouble () == sender->stat->getValueDouble ());
+	ck_assert (st->getMin () == sender->stat->getMin ());
+	ck_assert (st->getMax () == sender->stat->getMax ());
+	ck_assert_str_eq (rconn->getValueChar ("string"), sender->str->getValue ());
+}
+
+/**
+ * Send all values in a single frame.
+ */
+void sendValues (rts2core::Connection *conn)
+{
+	rts2core::ValueFrame frame;
+	sender->encodeInfo (frame, true);
+	ck_assert_int_eq (conn->sendValueFrame (frame), 0);
+}
+
+START_TEST(encoding)
+{
+	int64_t sv[] = {0, 1, -1, 63, -64, 64, 300, -300, INT_MAX, INT_MIN, INT64_MAX, INT64_MIN};
+	std::string frame;
+	for (size_t i = 0; i < sizeof (sv) / sizeof (sv[0]); i++)
+		rts2core::binaryPutSigned (frame, sv[i]);
+	// small numbers take single byte
+	ck_assert_int_eq ((unsigned char) frame[1], 2);
+	ck_assert_int_eq ((unsigned char) frame[2], 1);
+
+	double dv[] = {0, -0.0, 1, 1.0000000001, 1e300, -1e-300, NAN, INFINITY, -INFINITY, 23.5, 23.5, 23.25};
+	uint64_t prev = 0;
+	for (size_t i = 0; i < sizeof (dv) / sizeof (dv[0]); i++)
+	{
+		rts2core::binaryPutDouble (frame, dv[i]);
+		rts2core::binaryPutDoubleDelta (frame, dv[i], prev);
+	}
+
+	const char *data = frame.data ();
+	const char *end = data + frame.length ();
+	for (size_t i = 0; i < sizeof (sv) / sizeof (sv[0]); i++)
+	{
+		int64_t v;
+		ck_assert_int_eq (rts2core::binaryGetSigned (data, end, v), 0);
+		ck_assert (v == sv[i]);
+	}
+	prev = 0;
+	for (size_t i = 0; i < sizeof (dv) / sizeof (dv[0]); i++)
+	{
+		double v1, v2;
+		ck_assert_int_eq (rts2core::binaryGetDouble (data, end, v1), 0);
+		ck_assert_int_eq (rts2core::binaryGetDoubleDelta (data, end, v2, prev), 0);
+		ck_assert (memcmp (&v1, &dv[i], sizeof (double)) == 0);
+		ck_assert (memcmp (&v2, &dv[i], sizeof (double)) == 0);
+	}
+	ck_assert (data == end);
+
+	// truncated data are detected
+	double v;
+	data = frame.data ();
+	ck_assert_int_eq (rts2core::binaryGetDouble (data, data + 7, v), -1);
+	std::string trunc;
+	rts2core::binaryPutVarint (trunc, 1000000);
+	data = trunc.data ();
+	uint64_t u;
+	ck_assert_int_eq (rts2core::binaryGetVarint (data, data + trunc.length () - 1, u), -1);
+
+	// values encode and decode their binary records
+	rts2core::IntegerArray ia ("ia", "test", false);
+	std::vector <int> iv;
+	iv.push_back (5);
+	iv.push_back (-100000);
+	iv.push_back (INT_MAX);
+	iv.push_back (INT_MIN);
+	ia.setValueArray (iv);
+	std::string rec;
+	ia.encodeBinary (rec);
+	rts2core::IntegerArray ia2 ("ia", "test", false);
+	data = rec.data () + 1;
+	ck_assert_int_eq (rts2core::binaryGetVarint (data, rec.data () + rec.length (), u), 0);
+	ck_assert_int_eq (ia2.decodeBinary (rec[0], data, u), 0);
+	ck_assert (ia2.getValueVector () == iv);
+	ck_assert_int_eq (ia2.decodeBinary (BINARY_VALUE_DARRAY, data, u), -1);
+}
+END_TEST
+
+START_TEST(text_fallback)
+{
+	sender->sendMetaInfo (sconn);
+	sender->change (1);
+	// connection did not request binary frames
+	sendValues (sconn);
+	receiveAll ();
+	checkReceived ();
+
+	// values without ID are send as text even on binary connection
+	sconn->setBinaryValues (true);
+	rts2core::ValueFrame frame;
+	sender->doubles[0]->setValueDouble (-3.5);
+	frame.add (sender->doubles[0], -1);
+	sconn->sendValueFrame (frame);
+	receiveAll ();
+	ck_assert (rconn->getValueDouble ("double_0") == -3.5);
+}
+END_TEST
+
+START_TEST(binary_frames)
+{
+	sender->sendMetaInfo (sconn);
+	sconn->setBinaryValues (true);
+	for (int step = 0; step < 50; step++)
+	{
+		sender->change (step);
+		sendValues (sconn);
+		receiveAll ();
+		checkReceived ();
+	}
+
+	// only changed values are send
+	sender->change (100);
+	sender->infoAll ();
+	receiveAll ();
+	checkReceived ();
+	sender->doubles[5]->setValueDouble (7);
+	sender->sendValueAll (sender->doubles[5]);
+	receiveAll ();
+	ck_assert (rconn->getValueDouble ("double_5") == 7);
+
+	// frame split between reads
+	rts2core::ValueFrame frame;
+	sender->change (101);
+	sender->encodeInfo (frame, true);
+	std::string binary = frame.getBinary ();
+	char header[50];
+	snprintf (header, sizeof (header), PROTO_VALUE_FRAME " %lu\n", (unsigned long) binary.length ());
+	std::string msg = std::string (header) + binary;
+	size_t half = msg.length () / 2;
+	sconn->sendFrame (msg.substr (0, half));
+	receiveAll ();
+	sconn->sendFrame (msg.substr (half));
+	receiveAll ();
+	checkReceived ();
+}
+END_TEST
+
+START_TEST(malformed_frame)
+{
+	sender->sendMetaInfo (sconn);
+	receiveAll ();
+	ck_assert_int_eq (sconn->sendFrame (PROTO_VALUE_FRAME " 4\n\x7f\x7f\xff\xff"), 0);
+	receiveAll ();
+	ck_assert (rconn->isConnState (CONN_BROKEN) || rconn->isConnState (CONN_DELETE));
+}
+END_TEST
+
+START_TEST(replay)
+{
+	sender->sendMetaInfo (sconn);
+	receiveAll ();
+
+	uint64_t bytes[2] = {0, 0};
+	uint64_t cpu[2] = {0, 0};
+	size_t updates = 0;
+	for (int b = 0; b < 2; b++)
+	{
+		sconn->setBinaryValues (b == 1);
+		for (int step = 0; step < REPLAYS; step++)
+		{
+			sender->change (step);
+			uint64_t t0 = getcpu_ns ();
+			rts2core::ValueFrame frame;
+			sender->encodeInfo (frame);
+			sconn->sendValueFrame (frame);
+			receiveAll ();
+			cpu[b] += getcpu_ns () - t0;
+			bytes[b] += b ? frame.getBinary ().length () : frame.getText ().length ();
+			if (b == 0)
+				updates += frame.size ();
+			for (rts2core::CondValueVector::iterator iter = sender->getValuesBegin (); iter != sender->getValuesEnd (); iter++)
+				(*iter)->getValue ()->resetNeedSend ();
+		}
+		checkReceived ();
+	}
+	printf ("%lu value updates: text %.1f bytes %.0f ns CPU, binary %.1f bytes %.0f ns CPU per value update\n", (unsigned long) updates, (double) bytes[0] / updates, (double) cpu[0] / updates, (double) bytes[1] / updates, (double) cpu[1] / updates);
+	ck_assert_msg (bytes[1] < bytes[0], "binary frames are longer than text");
+	ck_assert_msg (cpu[1] < cpu[0], "binary frames need more CPU than text");
+}
+END_TEST
+
+Suite * binaryframe_suite (void)
+{
+	Suite *s;
+	TCase *tc_frames;
+
+	s = suite_create ("Binary value frames");
+	tc_frames = tcase_create ("Encode and decode value frames");
+	tcase_add_checked_fixture (tc_frames, setup_frames, teardown_frames);
+	tcase_set_timeout (tc_frames, 120);
+
+	tcase_add_test (tc_frames, encoding);
+	tcase_add_test (tc_frames, text_fallback);
+	tcase_add_test (tc_frames, binary_frames);
+	tcase_add_test (tc_frames, malformed_frame);
+	tcase_add_test (tc_frames, replay);
+	suite_add_tcase (s, tc_frames);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = binaryframe_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
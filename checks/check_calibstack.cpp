@@ -0,0 +1,457 @@
+#include "rts2fits/calibstack.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define BIAS_LEVEL     300
+#define READ_NOISE     5
+
+using namespace rts2image;
+
+static uint32_t hash (uint32_t a, uint32_t b, uint32_t c)
+{
+	uint32_t h = a * 0x9e3779b1u ^ b * 0x85ebca6bu ^ c * 0xc2b2ae35u;
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	h *= 0x846ca68bu;
+	h ^= h >> 16;
+	return h;
+}
+
+// approximately normal noise with unity sigma, sum of four uniform values
+static float noise (uint32_t i, uint32_t x, uint32_t y)
+{
+	uint32_t h1 = hash (i, x, y);
+	uint32_t h2 = hash (h1, y, i);
+	float s = (h1 & 0xffff) + (h1 >> 16) + (h2 & 0xffff) + (h2 >> 16);
+	return (s / 65536.0 - 2) * 1.7320508;
+}
+
+static float flatPattern (int x, int y)
+{
+	return 1 + 0.1 * sin (x / 30.0) * cos (y / 40.0);
+}
+
+/**
+ * Frame generated as rows are read, so benchmark frames do not need to be
+ * held in memory. Frame is bias plus level times flat pattern plus noise.
+ * Every 1000th pixel is hit by a cosmic ray.
+ */
+class SyntheticInput:public StackInput
+{
+	public:
+		SyntheticInput (int _seed, int _width, int _height, float _level, bool _flat):StackInput ("synthetic")
+		{
+			seed = _seed;
+			width = _width;
+			height = _height;
+			level = _level;
+			flat = _flat;
+		}
+
+		virtual int readRows (int row, int nrows, float *buf)
+		{
+			for (int y = row; y < row + nrows; y++)
+			{
+				for (int x = 0; x < width; x++, buf++)
+				{
+					float v = BIAS_LEVEL + level * (flat ? flatPattern (x, y) : 1) + READ_NOISE * noise (seed, x, y);
+					if (hash (x, y, seed + 1000) % 1000 == 0)
+						v += 5000;
+					*buf = v;
+				}
+			}
+			return 0;
+		}
+
+	private:
+		int seed;
+		float level;
+		bool flat;
+};
+
+class MemoryInput:public StackInput
+{
+	public:
+		MemoryInput (int _width, int _height):StackInput ("memory")
+		{
+			width = _width;
+			height = _height;
+			data.resize (width * height);
+		}
+
+		virtual int readRows (int row, int nrows, float *buf)
+		{
+			memcpy (buf, data.data () + row * width, nrows * width * sizeof (float));
+			return 0;
+		}
+
+		std::vector <float> data;
+};
+
+START_TEST(median)
+{
+	float values[] = {10, 11, 9, NAN, 10, 12, 1000};
+	float scratch[7];
+	size_t used;
+
+	float m = CalibrationStack::combineMedian (values, 7, scratch, 3, 3, 3, used);
+	ck_assert_dbl_eq (m, 10, 1e-12);
+	ck_assert_int_eq (used, 5);
+
+	// without clipping only NAN is dropped
+	float values2[] = {10, 11, 9, NAN, 10, 12, 1000};
+	m = CalibrationStack::combineMedian (values2, 7, scratch, 3, 3, 0, used);
+	ck_assert_dbl_eq (m, 10.5, 1e-12);
+	ck_assert_int_eq (used, 6);
+
+	// equal integer values have zero deviation, nothing is rejected
+	float values3[] = {300, 300, 300, 300, 301};
+	m = CalibrationStack::combineMedian (values3, 5, scratch, 3, 3, 3, used);
+	ck_assert_dbl_eq (m, 300, 1e-12);
+	ck_assert_int_eq (used, 5);
+
+	float values4[] = {NAN, NAN};
+	m = CalibrationStack::combineMedian (values4, 2, scratch, 3, 3, 3, used);
+	ck_assert (isnan (m));
+	ck_assert_int_eq (used, 0);
+}
+END_TEST
+
+START_TEST(mean)
+{
+	// 20 frames, 4 pixels; pixel 1 has outlier, pixel 2 one NAN, pixel 3 has no values
+	const int n = 20;
+	std::vector <float> data (n * 4);
+	std::vector <const float *> rows (n);
+	for (int i = 0; i < n; i++)
+	{
+		float *r = data.data () + i * 4;
+		r[0] = 100 + (i % 2 ? 1 : -1);
+		r[1] = i == 7 ? 10000 : 200 + (i % 2 ? 2 : -2);
+		r[2] = i == 3 ? NAN : 50;
+		r[3] = NAN;
+		rows[i] = r;
+	}
+
+	float out[4];
+	float used[4];
+	float scratch[6 * 4];
+
+	CalibrationStack::combineMean (rows.data (), n, 4, 3, 3, 5, out, used, scratch);
+	ck_assert_dbl_eq (out[0], 100, 1e-9);
+	ck_assert_int_eq (used[0], 20);
+	// outlier rejected; remaining values are 9 x 202 and 10 x 198
+	ck_assert_dbl_eq (out[1], (9 * 202 + 10 * 198) / 19.0, 1e-4);
+	ck_assert_int_eq (used[1], 19);
+	ck_assert_dbl_eq (out[2], 50, 1e-9);
+	ck_assert_int_eq (used[2], 19);
+	ck_assert (isnan (out[3]));
+	ck_assert_int_eq (used[3], 0);
+
+	// without clipping outlier is included
+	CalibrationStack::combineMean (rows.data (), n, 4, 3, 3, 0, out, used, scratch);
+	ck_assert_dbl_eq (out[1], (9 * 202 + 10 * 198 + 10000) / 20.0, 1e-4);
+	ck_assert_int_eq (used[1], 20);
+}
+END_TEST
+
+static void stackSynthetic (stack_method_t method, size_t memory, int threads, std::vector <float> &master, int &blockRows)
+{
+	StackParams params;
+	params.method = method;
+	params.memory = memory;
+	params.threads = threads;
+
+	CalibrationStack stack (params);
+	for (int i = 0; i < 15; i++)
+		stack.addInput (new SyntheticInput (i, 200, 150, 1000, false));
+	ck_assert_int_eq (stack.stack (), 0);
+
+	master = stack.getMaster ();
+	blockRows = stack.getBlockRows ();
+
+	ck_assert (stack.getRejected () > 0.0005);
+	// sigma from median absolute deviation of 15 values is noisy, so median rejects more
+	ck_assert (stack.getRejected () < (method == STACK_MEDIAN ? 0.05 : 0.005));
+}
+
+START_TEST(blocks)
+{
+	stack_method_t methods[] = {STACK_MEDIAN, STACK_MEAN};
+	for (int m = 0; m < 2; m++)
+	{
+		std::vector <float> whole, blocks, threads;
+		int br;
+
+		stackSynthetic (methods[m], 256 * 1024 * 1024, 1, whole, br);
+		ck_assert_int_eq (br, 150);
+
+		// 7 rows of 15 frames, split to two buffers
+		stackSynthetic (methods[m], 7 * 15 * 200 * sizeof (float), 1, blocks, br);
+		ck_assert_int_eq (br, 3);
+
+		stackSynthetic (methods[m], 7 * 15 * 200 * sizeof (float), 3, threads, br);
+
+		ck_assert_int_eq (whole.size (), 200 * 150);
+		ck_assert (whole == blocks);
+		ck_assert (whole == threads);
+
+		// cosmic rays are rejected, result is close to the signal
+		double err2 = 0;
+		for (size_t i = 0; i < whole.size (); i++)
+			err2 += (whole[i] - BIAS_LEVEL - 1000) * (whole[i] - BIAS_LEVEL - 1000);
+		ck_assert (sqrt (err2 / whole.size ()) < READ_NOISE);
+	}
+}
+END_TEST
+
+START_TEST(flat)
+{
+	const int w = 160;
+	const int h = 120;
+
+	MemoryInput bias (w, h);
+	for (int y = 0; y < h; y++)
+		for (int x = 0; x < w; x++)
+			bias.data[y * w + x] = BIAS_LEVEL;
+
+	StackParams params;
+	params.normalize = true;
+	params.sampleStep = 4;
+	params.threads = 2;
+	params.memory = 10 * w * 8 * sizeof (float);
+
+	CalibrationStack stack (params);
+	ck_assert_int_eq (stack.setBias (bias), 0);
+	float levels[] = {1000, 2000, 5000, 10000, 20000, 3000, 4000, 8000, 6000, 7000};
+	for (int i = 0; i < 10; i++)
+		stack.addInput (new SyntheticInput (i, w, h, levels[i], true));
+	ck_assert_int_eq (stack.stack (), 0);
+
+	for (int i = 0; i < 10; i++)
+		ck_assert_dbl_eq (stack.getScale (i) * levels[i], 1, 0.02);
+
+	// flat pattern is recovered, normalized to its median
+	std::vector <float> pattern;
+	for (int y = 0; y < h; y++)
+		for (int x = 0; x < w; x++)
+			pattern.push_back (flatPattern (x, y));
+	std::vector <float> tmp (pattern);
+	std::nth_element (tmp.begin (), tmp.begin () + tmp.size () / 2, tmp.end ());
+	float med = tmp[tmp.size () / 2];
+
+	const std::vector <float> &master = stack.getMaster ();
+	double err2 = 0;
+	for (size_t i = 0; i < master.size (); i++)
+		err2 += (master[i] - pattern[i] / med) * (master[i] - pattern[i] / med);
+	ck_assert (sqrt (err2 / master.size ()) < 0.005);
+}
+END_TEST
+
+START_TEST(dark)
+{
+	const int w = 64;
+	const int h = 48;
+
+	// dark current increases along rows
+	MemoryInput bias (w, h);
+	MemoryInput dark (w, h);
+	dark.exposure = 10;
+	for (int y = 0; y < h; y++)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			bias.data[y * w + x] = BIAS_LEVEL + x;
+			dark.data[y * w + x] = y;
+		}
+	}
+
+	StackParams params;
+	CalibrationStack stack (params);
+	ck_assert_int_eq (stack.setBias (bias), 0);
+	ck_assert_int_eq (stack.setDark (dark), 0);
+
+	// 20 s frames
+	for (int i = 0; i < 9; i++)
+	{
+		MemoryInput *in = new MemoryInput (w, h);
+		in->exposure = 20;
+		for (int y = 0; y < h; y++)
+			for (int x = 0; x < w; x++)
+				in->data[y * w + x] = BIAS_LEVEL + x + 2 * y + (i - 4);
+		stack.addInput (in);
+	}
+	ck_assert_int_eq (stack.stack (), 0);
+
+	const std::vector <float> &master = stack.getMaster ();
+	for (size_t i = 0; i < master.size (); i++)
+		ck_assert_dbl_eq (master[i], 0, 1e-3);
+
+	// frames of different size are refused
+	stack.addInput (new MemoryInput (w, h + 1));
+	ck_assert_int_eq (stack.stack (), -1);
+}
+END_TEST
+
+static void writeFrame (const char *fn, int i, int w, int h)
+{
+	fitsfile *fptr;
+	int status = 0;
+	long sizes[2] = {w, h};
+	std::vector <unsigned short> data (w * h);
+	for (int k = 0; k < w * h; k++)
+		data[k] = BIAS_LEVEL + k % w + i;
+
+	fits_create_file (&fptr, (std::string ("!") + fn).c_str (), &status);
+	fits_create_img (fptr, USHORT_IMG, 2, sizes, &status);
+	fits_write_img (fptr, TUSHORT, 1, w * h, data.data (), &status);
+	float exposure = 0;
+	double JD = 2461000.5 + i / 1440.0;
+	fits_write_key (fptr, TFLOAT, "EXPOSURE", &exposure, NULL, &status);
+	fits_write_key (fptr, TDOUBLE, "JD", &JD, NULL, &status);
+	fits_write_key (fptr, TSTRING, "IMAGETYP", (void *) "zero", NULL, &status);
+	fits_write_key (fptr, TSTRING, "CCD_NAME", (void *) "C0", NULL, &status);
+	fits_close_file (fptr, &status);
+	ck_assert_int_eq (status, 0);
+}
+
+START_TEST(fits)
+{
+	const int w = 50;
+	const int h = 40;
+
+	char dir[] = "/tmp/check_calibstackXXXXXX";
+	ck_assert (mkdtemp (dir) != NULL);
+	std::string base (dir);
+
+	StackParams params;
+	params.memory = 10 * 5 * w * sizeof (float);
+	CalibrationStack stack (params);
+	for (int i = 0; i < 5; i++)
+	{
+		char fn[100];
+		snprintf (fn, sizeof (fn), "%s/bias%d.fits", dir, i);
+		writeFrame (fn, i, w, h);
+		FitsStackInput *in = new FitsStackInput (fn);
+		ck_assert_int_eq (in->open (), 0);
+		ck_assert_int_eq (in->getWidth (), w);
+		ck_assert_int_eq (in->getHeight (), h);
+		ck_assert_str_eq (in->imageType.c_str (), "zero");
+		stack.addInput (in);
+	}
+	ck_assert_int_eq (stack.stack (), 0);
+	ck_assert_int_eq (stack.getBlockRows (), 5);
+
+	std::string out = base + "/master.fits";
+	ck_assert_int_eq (stack.writeMaster (out.c_str ()), 0);
+
+	fitsfile *fptr;
+	int status = 0;
+	fits_open_image (&fptr, out.c_str (), READONLY, &status);
+	std::vector <float> data (w * h);
+	int anynul;
+	fits_read_img (fptr, TFLOAT, 1, w * h, NULL, data.data (), &anynul, &status);
+	int ncombine;
+	char val[FLEN_VALUE];
+	double jd_first;
+	fits_read_key (fptr, TINT, "NCOMBINE", &ncombine, NULL, &status);
+	fits_read_key (fptr, TDOUBLE, "JD_FIRST", &jd_first, NULL, &status);
+	fits_read_key (fptr, TSTRING, "IMAGETYP", val, NULL, &status);
+	ck_assert_str_eq (val, "zero");
+	fits_read_key (fptr, TSTRING, "IMCMB005", val, NULL, &status);
+	ck_assert_str_eq (val, "bias4.fits");
+	fits_close_file (fptr, &status);
+	ck_assert_int_eq (status, 0);
+
+	ck_assert_int_eq (ncombine, 5);
+	ck_assert_dbl_eq (jd_first, 2461000.5, 1e-6);
+	for (int k = 0; k < w * h; k++)
+		ck_assert_dbl_eq (data[k], BIAS_LEVEL + k % w + 2, 1e-6);
+
+	for (int i = 0; i < 5; i++)
+	{
+		char fn[100];
+		snprintf (fn, sizeof (fn), "%s/bias%d.fits", dir, i);
+		unlink (fn);
+	}
+	unlink (out.c_str ());
+	rmdir (dir);
+}
+END_TEST
+
+START_TEST(buffers)
+{
+	int n = 50, w = 400, h = 300;
+	stack_method_t methods[] = {STACK_MEDIAN, STACK_MEAN};
+
+	for (int m = 0; m < 2; m++)
+	{
+		StackParams params;
+		params.method = methods[m];
+		params.threads = 2;
+		params.memory = 8 * n * w * sizeof (float);
+
+		CalibrationStack stack (params);
+		for (int i = 0; i < n; i++)
+			stack.addInput (new SyntheticInput (i, w, h, 1000, false));
+
+		ck_assert_int_eq (stack.stack (), 0);
+		ck_assert_int_lt (stack.getBlockRows (), h);
+
+		// frames are not held in memory, only block buffers and master
+		size_t all = (size_t) n * w * h * sizeof (float);
+		ck_assert (stack.getBufferSize () < all / 10);
+
+		const std::vector <float> &master = stack.getMaster ();
+		ck_assert_int_eq (master.size (), (size_t) (w * h));
+		ck_assert_dbl_eq (master[w * h / 2], BIAS_LEVEL + 1000, READ_NOISE);
+	}
+}
+END_TEST
+
+Suite * calibstack_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("CalibStack");
+	tc_core = tcase_create ("Core");
+	tcase_set_timeout (tc_core, 60);
+	tcase_add_test (tc_core, median);
+	tcase_add_test (tc_core, mean);
+	tcase_add_test (tc_core, blocks);
+	tcase_add_test (tc_core, flat);
+	tcase_add_test (tc_core, dark);
+	tcase_add_test (tc_core, fits);
+	tcase_add_test (tc_core, buffers);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = calibstack_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
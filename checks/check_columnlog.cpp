@@ -0,0 +1,266 @@
+#include "columnlog.h"
+#include "displayvalue.h"
+#include "value.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <sstream>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define NUM_ROWS        3600
+
+rts2core::ValueDouble *temp;
+rts2core::ValueDouble *pressure;
+rts2core::ValueInteger *counter;
+rts2core::ValueBool *open;
+rts2core::ValueString *mode;
+std::list <rts2core::Value *> values;
+
+void setup_values (void)
+{
+	temp = new rts2core::ValueDouble ("TEMP", "temperature", false);
+	pressure = new rts2core::ValueDouble ("PRESSURE", "pressure", false);
+	counter = new rts2core::ValueInteger ("COUNTER", "counter", false);
+	open = new rts2core::ValueBool ("OPEN", "open", false);
+	mode = new rts2core::ValueString ("MODE", "mode", false);
+	values.clear ();
+	values.push_back (temp);
+	values.push_back (pressure);
+	values.push_back (counter);
+	values.push_back (open);
+	values.push_back (mode);
+}
+
+void teardown_values (void)
+{
+	values.clear ();
+	delete temp;
+	delete pressure;
+	delete counter;
+	delete open;
+	delete mode;
+}
+
+// simulated slowly changing environmental values
+void setRow (int i)
+{
+	temp->setValueDouble (10 + floor (sin (i / 600.0) * 100) / 10.0);
+	pressure->setValueDouble (i % 60 < 30 ? 1013.25 : 1013.5);
+	counter->setValueInteger (i / 10);
+	open->setValueBool (i % 1000 > 500);
+	mode->setValueCharArr (i % 1200 < 600 ? "NORMAL" : "FAST");
+}
+
+double rowTime (int i)
+{
+	// 1 Hz sampling with few milliseconds jitter
+	return 1760000000 + i + (i % 7) * 0.001;
+}
+
+START_TEST(roundtrip)
+{
+	rts2core::ColumnLogWriter writer ("S1");
+	for (int i = 0; i < NUM_ROWS; i++)
+	{
+		setRow (i);
+		ck_assert_int_eq (writer.addRow (rowTime (i), values), 0);
+	}
+	ck_assert_int_eq (writer.getRows (), NUM_ROWS);
+	ck_assert (writer.getFirstTime () == rowTime (0));
+
+	std::stringstream ss;
+	ck_assert_int_eq (writer.write (ss), 0);
+	ck_assert_int_eq (writer.getRows (), 0);
+	// nothing to write
+	ck_assert_int_eq (writer.write (ss), 0);
+
+	rts2core::ColumnLogReader reader (ss);
+	rts2core::ColumnLogChunk chunk;
+	ck_assert_int_eq (reader.readChunk (chunk), 1);
+	ck_assert_str_eq (chunk.device.c_str (), "S1");
+	ck_assert_int_eq (chunk.getRows (), NUM_ROWS);
+	ck_assert_int_eq (chunk.columns.size (), 5);
+	ck_assert_int_eq (chunk.columns[0].type, COLUMNLOG_DOUBLE);
+	ck_assert_int_eq (chunk.columns[2].type, COLUMNLOG_INTEGER);
+	ck_assert_int_eq (chunk.columns[3].type, COLUMNLOG_INTEGER);
+	ck_assert_int_eq (chunk.columns[4].type, COLUMNLOG_STRING);
+
+	for (int i = 0; i < NUM_ROWS; i++)
+	{
+		setRow (i);
+		ck_assert (fabs (chunk.times[i] - rowTime (i)) < 1e-6);
+		ck_assert (chunk.columns[0].doubles[i] == temp->getValueDouble ());
+		ck_assert (chunk.columns[1].doubles[i] == pressure->getValueDouble ());
+		ck_assert_int_eq (chunk.columns[2].ints[i], counter->getValueInteger ());
+		ck_assert_int_eq (chunk.columns[3].ints[i], open->getValueInteger ());
+		ck_assert_str_eq (chunk.columns[4].strings[i].c_str (), mode->getValue ());
+	}
+
+	std::string s;
+	chunk.columns[1].appendValue (s, 0);
+	ck_assert_str_eq (s.c_str (), "1013.25");
+
+	ck_assert_int_eq (reader.readChunk (chunk), 0);
+	ck_assert_int_eq (reader.getSkipped (), 0);
+
+	// special values
+	temp->setValueDouble (NAN);
+	counter->setValueInteger (-2147483647);
+	writer.addRow (1, values);
+	temp->setValueDouble (-0.0);
+	counter->setValueInteger (2147483647);
+	writer.addRow (0.5, values);
+	std::string enc = writer.encode ();
+	ck_assert_int_eq (reader.decode (enc.substr (8), chunk), 0);
+	ck_assert (isnan (chunk.columns[0].doubles[0]));
+	ck_assert (chunk.columns[0].doubles[1] == 0 && signbit (chunk.columns[0].doubles[1]));
+	ck_assert_int_eq (chunk.columns[2].ints[0], -2147483647);
+	ck_assert_int_eq (chunk.columns[2].ints[1], 2147483647);
+	ck_assert (chunk.times[1] == 0.5);
+}
+END_TEST
+
+START_TEST(filters)
+{
+	std::stringstream ss;
+	rts2core::ColumnLogWriter w1 ("S1");
+	rts2core::ColumnLogWriter w2 ("S2");
+	for (int i = 0; i < 100; i++)
+	{
+		setRow (i);
+		w1.addRow (rowTime (i), values);
+		w2.addRow (rowTime (i), values);
+		if (i % 10 == 9)
+		{
+			w1.write (ss);
+			w2.write (ss);
+		}
+	}
+
+	// other columns are refused
+	std::list <rts2core::Value *> other;
+	other.push_back (temp);
+	ck_assert (!w1.sameColumns (other));
+	w1.addRow (0, values);
+	ck_assert_int_eq (w1.addRow (1, other), -1);
+	// new chunk starts with the new columns
+	std::ostringstream ss2;
+	ck_assert_int_eq (w1.write (ss2), 0);
+	ck_assert_int_eq (w1.addRow (1, other), 0);
+	ck_assert_int_eq (w1.getRows (), 1);
+
+	std::string data = ss.str ();
+
+	std::istringstream is (data);
+	rts2core::ColumnLogReader reader (is);
+	reader.setDevice ("S2");
+	reader.addColumn ("COUNTER");
+	reader.addColumn ("MODE");
+	rts2core::ColumnLogChunk chunk;
+	int n = 0;
+	while (reader.readChunk (chunk) == 1)
+	{
+		ck_assert_str_eq (chunk.device.c_str (), "S2");
+		ck_assert_int_eq (chunk.names.size (), 5);
+		ck_assert_int_eq (chunk.columns.size (), 2);
+		ck_assert_int_eq (chunk.findColumn ("COUNTER"), 0);
+		ck_assert_int_eq (chunk.findColumn ("TEMP"), -1);
+		ck_assert_int_eq (chunk.columns[0].ints[0], n);
+		n++;
+	}
+	ck_assert_int_eq (n, 10);
+
+	// garbage between chunks and truncated last chunk
+	std::string corrupted = std::string ("garbage") + data.substr (0, data.length () / 2) + std::string ("xx") + data;
+	corrupted.resize (corrupted.length () - 3);
+	std::istringstream cs (corrupted);
+	rts2core::ColumnLogReader creader (cs);
+	n = 0;
+	while (creader.readChunk (chunk) == 1)
+		n++;
+	// 10 chunks in the first half, last chunk of the complete data is truncated
+	ck_assert (n >= 28);
+	ck_assert (n < 30);
+	ck_assert (creader.getSkipped () > 0);
+}
+END_TEST
+
+START_TEST(benchmark)
+{
+	std::ostringstream text;
+	std::stringstream binary;
+	rts2core::ColumnLogWriter writer ("S1");
+
+	// a day of 1 Hz values
+	for (int i = 0; i < 86400; i++)
+	{
+		setRow (i);
+		// text logger output
+		text << "S1";
+		for (std::list <rts2core::Value *>::iterator iter = values.begin (); iter != values.end (); iter++)
+			text << " " << rts2core::getDisplayValue (*iter);
+		text << std::endl;
+
+		writer.addRow (rowTime (i), values);
+		if (writer.getRows () >= 3600)
+			writer.write (binary);
+	}
+	writer.write (binary);
+
+	size_t textSize = text.str ().length ();
+	size_t binarySize = binary.str ().length ();
+
+	uint64_t t0 = gettime_ns ();
+	rts2core::ColumnLogReader reader (binary);
+	rts2core::ColumnLogChunk chunk;
+	size_t rows = 0;
+	double sum = 0;
+	while (reader.readChunk (chunk) == 1)
+	{
+		rows += chunk.getRows ();
+		for (std::vector <double>::iterator iter = chunk.columns[0].doubles.begin (); iter != chunk.columns[0].doubles.end (); iter++)
+			sum += *iter;
+	}
+	uint64_t tread = gettime_ns () - t0;
+	ck_assert_int_eq (rows, 86400);
+
+	printf ("86400 rows of 5 values: text %lu bytes, binary %lu bytes (%.1f bytes per row, %.1fx smaller), decoded in %.1f ms\n", textSize, binarySize, (double) binarySize / rows, (double) textSize / binarySize, tread / 1000000.0);
+	ck_assert_msg (binarySize * 4 < textSize, "binary log is not much smaller: %lu bytes, text %lu bytes", binarySize, textSize);
+}
+END_TEST
+
+Suite * columnlog_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Column log");
+	tc_core = tcase_create ("Core");
+	tcase_add_checked_fixture (tc_core, setup_values, teardown_values);
+	tcase_set_timeout (tc_core, 60);
+	tcase_add_test (tc_core, roundtrip);
+	tcase_add_test (tc_core, filters);
+	tcase_add_test (tc_core, benchmark);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = columnlog_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
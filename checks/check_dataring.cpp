@@ -0,0 +1,260 @@
+#include "dataring.h"
+#include "imghdr.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define RING_NAME     "/rts2-check-dataring"
+#define RING_SLOTS    8
+#define RING_CHAN     2
+#define CHAN_SIZE     (sizeof (struct imghdr) + 640 * 480 * 2)
+
+rts2core::DataRingWrite *ring;
+
+void setup_ring (void)
+{
+	ring = new rts2core::DataRingWrite ();
+	ck_assert_int_eq (ring->create (RING_NAME, RING_SLOTS, CHAN_SIZE, RING_CHAN), 0);
+}
+
+void teardown_ring (void)
+{
+	delete ring;
+	ring = NULL;
+}
+
+// write frame number to the first bytes of every channel
+void writeFrame (uint64_t num)
+{
+	char *slot = ring->beginFrame ();
+	ck_assert_msg (slot != NULL, "cannot begin frame %lu", (unsigned long) num);
+	for (int c = 0; c < RING_CHAN; c++)
+		memcpy (ring->getChannel (slot, c) + sizeof (struct imghdr), &num, sizeof (num));
+	ring->publishFrame (CHAN_SIZE * RING_CHAN);
+}
+
+uint64_t frameNum (rts2core::DataRingRead *reader, char *slot, int chan)
+{
+	uint64_t num;
+	memcpy (&num, reader->getChannel (slot, chan) + sizeof (struct imghdr), sizeof (num));
+	return num;
+}
+
+START_TEST(multi_reader)
+{
+	rts2core::DataRingRead r1, r2;
+	ck_assert_int_eq (r1.attach (RING_NAME), 0);
+	ck_assert_int_eq (r2.attach (RING_NAME), 0);
+	ck_assert_int_eq (ring->getReaders (), 2);
+
+	ck_assert_ptr_eq (r1.waitFrame (0), NULL);
+
+	for (uint64_t i = 1; i <= 3; i++)
+		writeFrame (i);
+
+	// both readers see all frames, in order
+	for (uint64_t i = 1; i <= 3; i++)
+	{
+		char *f1 = r1.waitFrame (1);
+		ck_assert_ptr_ne (f1, NULL);
+		ck_assert_int_eq (r1.getFrameSeq (), i);
+		ck_assert_int_eq (r1.getFrameSize (), CHAN_SIZE * RING_CHAN);
+		ck_assert_int_eq (frameNum (&r1, f1, 0), i);
+		ck_assert_int_eq (frameNum (&r1, f1, 1), i);
+		ck_assert_int_eq (r1.releaseFrame (), 0);
+
+		char *f2 = r2.waitFrame (1);
+		ck_assert_ptr_ne (f2, NULL);
+		ck_assert_int_eq (frameNum (&r2, f2, 1), i);
+		ck_assert_int_eq (r2.releaseFrame (), 0);
+	}
+	ck_assert_ptr_eq (r1.waitFrame (0.01), NULL);
+	ck_assert_int_eq (r1.getDropped (), 0);
+}
+END_TEST
+
+START_TEST(drop_oldest)
+{
+	rts2core::DataRingRead slow;
+	ck_assert_int_eq (slow.attach (RING_NAME), 0);
+
+	char *f = NULL;
+	writeFrame (1);
+	f = slow.waitFrame (1);
+	ck_assert_int_eq (frameNum (&slow, f, 0), 1);
+
+	// writer overruns reader holding frame 1
+	for (uint64_t i = 2; i <= RING_SLOTS + 4; i++)
+		writeFrame (i);
+
+	// frame was overwritten while it was processed
+	ck_assert_int_eq (slow.releaseFrame (), -1);
+
+	// reader continues with the oldest frame in the ring
+	f = slow.waitFrame (1);
+	ck_assert_ptr_ne (f, NULL);
+	ck_assert_int_eq (slow.getFrameSeq (), 5);
+	ck_assert_int_eq (frameNum (&slow, f, 0), 5);
+	ck_assert_int_eq (slow.releaseFrame (), 0);
+	ck_assert_int_eq (slow.getDropped (), 4);
+	ck_assert_int_eq (ring->getDropped (), 4);
+}
+END_TEST
+
+START_TEST(latest_frame)
+{
+	rts2core::DataRingRead preview;
+	ck_assert_int_eq (preview.attach (RING_NAME), 0);
+
+	for (uint64_t i = 1; i <= 5; i++)
+		writeFrame (i);
+
+	// older frames are skipped, but not counted as dropped
+	char *f = preview.latestFrame (1);
+	ck_assert_ptr_ne (f, NULL);
+	ck_assert_int_eq (preview.getFrameSeq (), 5);
+	ck_assert_int_eq (frameNum (&preview, f, 0), 5);
+	ck_assert_int_eq (preview.releaseFrame (), 0);
+	ck_assert_int_eq (preview.getDropped (), 0);
+
+	ck_assert_ptr_eq (preview.latestFrame (0.01), NULL);
+
+	writeFrame (6);
+	f = preview.latestFrame (1);
+	ck_assert_ptr_ne (f, NULL);
+	ck_assert_int_eq (frameNum (&preview, f, 1), 6);
+	ck_assert_int_eq (preview.releaseFrame (), 0);
+}
+END_TEST
+
+START_TEST(critical_reader)
+{
+	rts2core::DataRingRead crit;
+	ck_assert_int_eq (crit.attach (RING_NAME, true), 0);
+
+	for (uint64_t i = 1; i <= RING_SLOTS; i++)
+		writeFrame (i);
+
+	// ring is full, critical reader has not released the first frame
+	ck_assert_ptr_eq (ring->beginFrame (), NULL);
+
+	char *f = crit.waitFrame (1);
+	ck_assert_int_eq (frameNum (&crit, f, 0), 1);
+	ck_assert_int_eq (crit.releaseFrame (), 0);
+
+	writeFrame (RING_SLOTS + 1);
+	ck_assert_ptr_eq (ring->beginFrame (), NULL);
+	ring->abortFrame ();
+	ck_assert_int_eq (crit.getDropped (), 0);
+}
+END_TEST
+
+struct ConsumerStats
+{
+	uint64_t frames;
+	uint64_t last;
+	bool ordered;
+	uint64_t dropped;
+};
+
+void *consumer (void *arg)
+{
+	ConsumerStats *st = (ConsumerStats *) arg;
+	rts2core::DataRingRead reader;
+	if (reader.attach (RING_NAME))
+		return NULL;
+	while (true)
+	{
+		char *f = reader.waitFrame (1);
+		if (f == NULL)
+			break;
+		uint64_t num = frameNum (&reader, f, RING_CHAN - 1);
+		if (reader.releaseFrame () == 0 && num != 0)
+		{
+			if (num <= st->last)
+				st->ordered = false;
+			st->last = num;
+			st->frames++;
+		}
+		if (num == 0)
+			break;
+	}
+	st->dropped = reader.getDropped ();
+	return NULL;
+}
+
+START_TEST(throughput)
+{
+	const int nconsumers = 4;
+	const uint64_t nframes = 20000;
+
+	pthread_t th[nconsumers];
+	ConsumerStats st[nconsumers];
+	for (int i = 0; i < nconsumers; i++)
+	{
+		st[i].frames = 0;
+		st[i].last = 0;
+		st[i].ordered = true;
+		pthread_create (th + i, NULL, consumer, st + i);
+	}
+	while (ring->getReaders () < nconsumers)
+		usleep (1000);
+
+	uint64_t t0 = gettime_ns ();
+	for (uint64_t i = 1; i <= nframes; i++)
+		writeFrame (i);
+	uint64_t t1 = gettime_ns ();
+	// end marker
+	writeFrame (0);
+
+	for (int i = 0; i < nconsumers; i++)
+	{
+		pthread_join (th[i], NULL);
+		ck_assert_msg (st[i].ordered, "consumer %d received frames out of order", i);
+		ck_assert_msg (st[i].frames + st[i].dropped >= nframes, "consumer %d lost frames without counting them as dropped", i);
+		printf ("consumer %d frames %lu dropped %lu\n", i, (unsigned long) st[i].frames, (unsigned long) st[i].dropped);
+	}
+	printf ("ring overhead: published %lu frames of %lu bytes in %.1f ms, %.0f frames/s\n", (unsigned long) nframes, (unsigned long) (CHAN_SIZE * RING_CHAN), (t1 - t0) / 1000000.0, nframes / ((t1 - t0) / 1000000000.0));
+}
+END_TEST
+
+Suite * dataring_suite (void)
+{
+	Suite *s;
+	TCase *tc_ring;
+
+	s = suite_create ("Data ring");
+	tc_ring = tcase_create ("Shared memory ring");
+	tcase_add_checked_fixture (tc_ring, setup_ring, teardown_ring);
+	tcase_set_timeout (tc_ring, 60);
+
+	tcase_add_test (tc_ring, multi_reader);
+	tcase_add_test (tc_ring, drop_oldest);
+	tcase_add_test (tc_ring, latest_frame);
+	tcase_add_test (tc_ring, critical_reader);
+	tcase_add_test (tc_ring, throughput);
+	suite_add_tcase (s, tc_ring);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = dataring_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
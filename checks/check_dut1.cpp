@@ -5,8 +5,62 @@
 #include <check.h>
 #include <check_utils.h>
 #include <math.h>
+#include <stdint.h>
+#include <string.h>
 #include <unistd.h>
 
+#define NUM_LOOKUPS   10000
+
+/**
+ * DUT1 lookup as done before EOPTable, scanning the file on every call.
+ */
+namespace legacy
+{
+
+double getDUT1 (const char *fn, struct tm *gmdate)
+{
+	FILE *f = fopen (fn, "r");
+	if (f == NULL)
+		return NAN;
+
+	char *line = NULL;
+	size_t n = 0;
+
+	char datepart[7];
+	snprintf (datepart, 7, "%2d%2d%2d", gmdate->tm_year - 100, gmdate->tm_mon + 1, gmdate->tm_mday);
+
+	while (getline (&line, &n, f) >= 0)
+	{
+		if (n > 60 && strncmp (line, datepart, 6) == 0)
+		{
+			double dut1 = atof (line + 59);
+			free (line);
+			fclose (f);
+			return dut1;
+		}
+	}
+	free (line);
+	fclose (f);
+
+	return NAN;
+}
+
+}
+
+void copyLines (const char *src, const char *dst, int lines)
+{
+	FILE *in = fopen (src, "r");
+	FILE *out = fopen (dst, "w");
+	ck_assert (in != NULL && out != NULL);
+	char *line = NULL;
+	size_t n = 0;
+	for (int i = 0; i < lines && getline (&line, &n, in) >= 0; i++)
+		fputs (line, out);
+	free (line);
+	fclose (in);
+	fclose (out);
+}
+
 void setup_dut1 (void)
 {
 }
@@ -37,6 +91,105 @@ START_TEST(GETDUT1)
 }
 END_TEST
 
+START_TEST(EOPTABLE)
+{
+	rts2core::EOPTable table;
+	ck_assert_int_eq (table.load ("data/finals2000A.daily"), 181);
+
+	double dut1, xp, yp;
+	// 2017-02-05 0h UT
+	ck_assert (table.getEOP (57789.0 + 2400000.5, dut1, xp, yp));
+	ck_assert_dbl_eq (dut1, 0.5484645, 1e-9);
+	ck_assert_dbl_eq (xp, 0.029226, 1e-9);
+	ck_assert_dbl_eq (yp, 0.288340, 1e-9);
+
+	// interpolation between 2017-02-05 and 2017-02-06
+	ck_assert (table.getEOP (57789.25 + 2400000.5, dut1, xp, yp));
+	ck_assert_dbl_eq (dut1, 0.5484645 + 0.25 * (0.5471842 - 0.5484645), 1e-9);
+	ck_assert_dbl_eq (xp, 0.029226 + 0.25 * (0.027833 - 0.029226), 1e-9);
+	ck_assert_dbl_eq (yp, 0.288340 + 0.25 * (0.289713 - 0.288340), 1e-9);
+
+	// last day contains leap second jump, which is not interpolated
+	ck_assert_dbl_eq (table.getDUT1 (57961.5 + 2400000.5), 0.3657371 + 0.5 * (0.3652135 - 0.3657371), 1e-9);
+	ck_assert_dbl_eq (table.getDUT1 (57962.0 + 2400000.5), 1.3652135, 1e-9);
+
+	// outside of the table
+	ck_assert (!table.getEOP (57781.9 + 2400000.5, dut1, xp, yp));
+	ck_assert (std::isnan (dut1));
+	ck_assert (std::isnan (table.getDUT1 (57962.1 + 2400000.5)));
+
+	// same as old whole day lookup
+	struct tm gmt;
+	memset (&gmt, 0, sizeof (gmt));
+	for (int mjd = 57782; mjd <= 57962; mjd++)
+	{
+		time_t t = (mjd - 40587) * 86400;
+		gmtime_r (&t, &gmt);
+		double d = legacy::getDUT1 ("data/finals2000A.daily", &gmt);
+		ck_assert_dbl_eq (table.getDUT1 (mjd + 2400000.5), d, 1e-9);
+		ck_assert_dbl_eq (getDUT1 ("data/finals2000A.daily", &gmt), d, 1e-9);
+	}
+}
+END_TEST
+
+START_TEST(RELOAD)
+{
+	char fn[] = "/tmp/check_dut1_XXXXXX";
+	int fd = mkstemp (fn);
+	ck_assert (fd >= 0);
+	close (fd);
+
+	copyLines ("data/finals2000A.daily", fn, 10);
+
+	rts2core::EOPTable table;
+	ck_assert_int_eq (table.reload (fn), 1);
+	ck_assert_int_eq (table.size (), 10);
+	ck_assert_int_eq (table.reload (fn), 0);
+	ck_assert (std::isnan (table.getDUT1 (57792.5 + 2400000.5)));
+
+	copyLines ("data/finals2000A.daily", fn, 100);
+	ck_assert_int_eq (table.reload (fn), 1);
+	ck_assert_int_eq (table.size (), 100);
+	ck_assert (!std::isnan (table.getDUT1 (57792.5 + 2400000.5)));
+
+	unlink (fn);
+	ck_assert_int_eq (table.reload (fn), -1);
+	ck_assert_int_eq (table.size (), 0);
+	ck_assert (std::isnan (table.getDUT1 (57789.0 + 2400000.5)));
+}
+END_TEST
+
+START_TEST(BENCHMARK)
+{
+	struct tm gmt[NUM_LOOKUPS];
+	double JD[NUM_LOOKUPS];
+	for (int i = 0; i < NUM_LOOKUPS; i++)
+	{
+		JD[i] = 2457782.5 + 180.0 * i / NUM_LOOKUPS;
+		time_t t = (JD[i] - 2440587.5) * 86400;
+		gmtime_r (&t, gmt + i);
+	}
+
+	uint64_t t0 = gettime_ns ();
+	double s = 0;
+	for (int i = 0; i < NUM_LOOKUPS; i++)
+		s += legacy::getDUT1 ("data/finals2000A.daily", gmt + i);
+	uint64_t tlegacy = gettime_ns () - t0;
+
+	rts2core::EOPTable table;
+	t0 = gettime_ns ();
+	table.reload ("data/finals2000A.daily");
+	double s1 = 0;
+	for (int i = 0; i < NUM_LOOKUPS; i++)
+		s1 += table.getDUT1 (JD[i]);
+	uint64_t ttable = gettime_ns () - t0;
+
+	ck_assert_dbl_eq (s / NUM_LOOKUPS, s1 / NUM_LOOKUPS, 1e-3);
+
+	printf ("%d DUT1 lookups: file scan %.1f ms, EOP table %.3f ms (including load)\n", NUM_LOOKUPS, tlegacy / 1e6, ttable / 1e6);
+}
+END_TEST
+
 START_TEST(UPDATE)
 {
 	const char *fn = "dut1_download";
@@ -74,6 +227,9 @@ Suite * dut1_suite (void)
 
 	tcase_add_checked_fixture (tc_dut1, setup_dut1, teardown_dut1);
 	tcase_add_test (tc_dut1, GETDUT1);
+	tcase_add_test (tc_dut1, EOPTABLE);
+	tcase_add_test (tc_dut1, RELOAD);
+	tcase_add_test (tc_dut1, BENCHMARK);
 	suite_add_tcase (s, tc_dut1);
 
 	tc_update = tcase_create ("DUT1 download");
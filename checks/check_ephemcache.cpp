@@ -0,0 +1,276 @@
+#include "ephemcache.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <libnova/libnova.h>
+#include <vector>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define NUM_EVALS     20000
+
+// 2026-10-20 0h UT
+#define NIGHT_JD      2461333.5
+
+typedef void (*equ_func_t) (double, struct ln_equ_posn *);
+
+static equ_func_t bodyFuncs[rts2core::EPHEM_BODIES] =
+{
+	ln_get_solar_equ_coords,
+	ln_get_mercury_equ_coords,
+	ln_get_venus_equ_coords,
+	ln_get_lunar_equ_coords,
+	ln_get_mars_equ_coords,
+	ln_get_jupiter_equ_coords,
+	ln_get_saturn_equ_coords,
+	ln_get_uranus_equ_coords,
+	ln_get_neptune_equ_coords,
+	ln_get_pluto_equ_coords
+};
+
+static struct ln_lnlat_posn observer;
+
+void setup_ephem (void)
+{
+	observer.lng = 14.78;
+	observer.lat = 49.91;
+	srand (42);
+}
+
+void teardown_ephem (void)
+{
+}
+
+static double randomJD ()
+{
+	// night hours
+	return NIGHT_JD - 0.3 + 0.6 * rand () / RAND_MAX;
+}
+
+START_TEST(accuracy)
+{
+	rts2core::EphemerisCache cache;
+	cache.setObserver (&observer);
+
+	double maxPos = 0;
+	double maxAlt = 0;
+	for (int b = 0; b < rts2core::EPHEM_BODIES; b++)
+	{
+		for (int i = 0; i < 500; i++)
+		{
+			double JD = randomJD ();
+			struct ln_equ_posn pos, cpos;
+			struct ln_hrz_posn hrz;
+			bodyFuncs[b] (JD, &pos);
+			ln_get_hrz_from_equ (&pos, &observer, JD, &hrz);
+
+			cache.getEquCoords ((rts2core::ephem_body_t) b, JD, &cpos);
+
+			double d = ln_get_angular_separation (&pos, &cpos);
+			if (d > maxPos)
+				maxPos = d;
+			double da = fabs (hrz.alt - cache.getAltitude ((rts2core::ephem_body_t) b, JD));
+			if (da > maxAlt)
+				maxAlt = da;
+		}
+	}
+
+	double maxPhase = 0;
+	for (int i = 0; i < 500; i++)
+	{
+		double JD = randomJD ();
+		double dp = fabs (ln_get_lunar_phase (JD) - cache.getLunarPhase (JD));
+		if (dp > maxPhase)
+			maxPhase = dp;
+	}
+
+	printf ("maximal error: position %.4f\", altitude %.4f\", lunar phase %.4f\"\n", maxPos * 3600.0, maxAlt * 3600.0, maxPhase * 3600.0);
+
+	// below 0.05 arcsec
+	ck_assert_dbl_eq (maxPos, 0, 0.05 / 3600.0);
+	ck_assert_dbl_eq (maxAlt, 0, 0.05 / 3600.0);
+	ck_assert_dbl_eq (maxPhase, 0, 0.05 / 3600.0);
+
+	// every body is tabulated once
+	ck_assert_int_eq (cache.getRecalculations (), rts2core::EPHEM_BODIES);
+}
+END_TEST
+
+START_TEST(move)
+{
+	rts2core::EphemerisCache cache;
+	cache.setObserver (&observer);
+
+	struct ln_equ_posn pos, cpos;
+
+	cache.prepare (NIGHT_JD, (1 << rts2core::EPHEM_SUN) | (1 << rts2core::EPHEM_MOON));
+	ck_assert_int_eq (cache.getRecalculations (), 2);
+
+	// next night is still in the table
+	cache.getEquCoords (rts2core::EPHEM_MOON, NIGHT_JD + 1, &cpos);
+	ck_assert_int_eq (cache.getRecalculations (), 2);
+
+	// table is moved, other bodies are dropped
+	cache.getEquCoords (rts2core::EPHEM_MOON, NIGHT_JD + 10, &cpos);
+	ck_assert_int_eq (cache.getRecalculations (), 3);
+	ln_get_lunar_equ_coords (NIGHT_JD + 10, &pos);
+	ck_assert_dbl_eq (ln_get_angular_separation (&pos, &cpos), 0, 0.05 / 3600.0);
+
+	cache.getAltitude (rts2core::EPHEM_SUN, NIGHT_JD + 10.1);
+	ck_assert_int_eq (cache.getRecalculations (), 4);
+
+	// observer change invalidates altitudes
+	struct ln_lnlat_posn obs2;
+	obs2.lng = -70.7;
+	obs2.lat = -30.2;
+	cache.setObserver (&obs2);
+	struct ln_hrz_posn hrz;
+	ln_get_solar_equ_coords (NIGHT_JD + 10.1, &pos);
+	ln_get_hrz_from_equ (&pos, &obs2, NIGHT_JD + 10.1, &hrz);
+	ck_assert_dbl_eq (cache.getAltitude (rts2core::EPHEM_SUN, NIGHT_JD + 10.1), hrz.alt, 0.05 / 3600.0);
+	ck_assert_int_eq (cache.getRecalculations (), 5);
+
+	// RA wrap around 0h
+	for (double JD = NIGHT_JD - 200; JD < NIGHT_JD + 200; JD += 0.37)
+	{
+		ln_get_solar_equ_coords (JD, &pos);
+		cache.getEquCoords (rts2core::EPHEM_SUN, JD, &cpos);
+		ck_assert_dbl_eq (ln_get_angular_separation (&pos, &cpos), 0, 0.05 / 3600.0);
+		ck_assert (cpos.ra >= 0 && cpos.ra < 360);
+	}
+}
+END_TEST
+
+START_TEST(shared)
+{
+	char name[50];
+	snprintf (name, sizeof (name), "/rts2-check-ephem-%d", getpid ());
+	shm_unlink (name);
+
+	rts2core::EphemerisCache c1;
+	c1.setObserver (&observer);
+	ck_assert_int_eq (c1.attachShared (name), 0);
+	ck_assert (c1.isShared ());
+
+	c1.prepare (NIGHT_JD, (1 << rts2core::EPHEM_SUN) | (1 << rts2core::EPHEM_MOON));
+	ck_assert_int_eq (c1.getRecalculations (), 2);
+
+	rts2core::EphemerisCache c2;
+	c2.setObserver (&observer);
+	ck_assert_int_eq (c2.attachShared (name), 0);
+
+	// values are calculated by the first cache
+	for (int i = 0; i < 100; i++)
+	{
+		double JD = randomJD ();
+		ck_assert_dbl_eq (c2.getAltitude (rts2core::EPHEM_SUN, JD), c1.getAltitude (rts2core::EPHEM_SUN, JD), 1e-12);
+		ck_assert_dbl_eq (c2.getLunarPhase (JD), c1.getLunarPhase (JD), 1e-12);
+	}
+	ck_assert_int_eq (c2.getRecalculations (), 0);
+
+	// body tabulated by second cache is seen by the first
+	struct ln_equ_posn p1, p2;
+	c2.getEquCoords (rts2core::EPHEM_JUPITER, NIGHT_JD, &p2);
+	ck_assert_int_eq (c2.getRecalculations (), 1);
+	c1.getEquCoords (rts2core::EPHEM_JUPITER, NIGHT_JD, &p1);
+	ck_assert_int_eq (c1.getRecalculations (), 2);
+	ck_assert_dbl_eq (p1.ra, p2.ra, 1e-12);
+	ck_assert_dbl_eq (p1.dec, p2.dec, 1e-12);
+
+	// table with different size cannot be attached
+	rts2core::EphemerisCache c3 (60);
+	ck_assert_int_eq (c3.attachShared (name), -1);
+	ck_assert (!c3.isShared ());
+
+	shm_unlink (name);
+}
+END_TEST
+
+START_TEST(benchmark)
+{
+	std::vector <double> JDs;
+	for (int i = 0; i < NUM_EVALS; i++)
+		JDs.push_back (randomJD ());
+
+	// Sun altitude, Moon altitude, Moon phase and lunar distance - the constraints which use ephemeris
+	struct ln_equ_posn tar;
+	tar.ra = 120;
+	tar.dec = 30;
+
+	double s1 = 0;
+	uint64_t t0 = gettime_ns ();
+	for (std::vector <double>::iterator iter = JDs.begin (); iter != JDs.end (); iter++)
+	{
+		struct ln_equ_posn pos;
+		struct ln_hrz_posn hrz;
+		ln_get_solar_equ_coords (*iter, &pos);
+		ln_get_hrz_from_equ (&pos, &observer, *iter, &hrz);
+		s1 += hrz.alt;
+		ln_get_lunar_equ_coords (*iter, &pos);
+		ln_get_hrz_from_equ (&pos, &observer, *iter, &hrz);
+		s1 += hrz.alt;
+		s1 += ln_get_lunar_phase (*iter);
+		ln_get_lunar_equ_coords (*iter, &pos);
+		s1 += ln_get_angular_separation (&pos, &tar);
+	}
+	uint64_t tdirect = gettime_ns () - t0;
+
+	rts2core::EphemerisCache cache;
+	cache.setObserver (&observer);
+
+	double s2 = 0;
+	t0 = gettime_ns ();
+	for (std::vector <double>::iterator iter = JDs.begin (); iter != JDs.end (); iter++)
+	{
+		struct ln_equ_posn pos;
+		s2 += cache.getAltitude (rts2core::EPHEM_SUN, *iter);
+		s2 += cache.getAltitude (rts2core::EPHEM_MOON, *iter);
+		s2 += cache.getLunarPhase (*iter);
+		cache.getEquCoords (rts2core::EPHEM_MOON, *iter, &pos);
+		s2 += ln_get_angular_separation (&pos, &tar);
+	}
+	uint64_t tcache = gettime_ns () - t0;
+
+	ck_assert_dbl_eq (s1 / NUM_EVALS, s2 / NUM_EVALS, 1e-5);
+
+	printf ("%d constraint evaluations: libnova %.1f ms, ephemeris cache %.1f ms (including tabulation)\n", NUM_EVALS, tdirect / 1e6, tcache / 1e6);
+}
+END_TEST
+
+Suite * ephemcache_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("EphemerisCache");
+	tc_core = tcase_create ("Core");
+	tcase_add_checked_fixture (tc_core, setup_ephem, teardown_ephem);
+	tcase_set_timeout (tc_core, 60);
+	tcase_add_test (tc_core, accuracy);
+	tcase_add_test (tc_core, move);
+	tcase_add_test (tc_core, shared);
+	tcase_add_test (tc_core, benchmark);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = ephemcache_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
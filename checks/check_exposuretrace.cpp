@@ -0,0 +1,100 @@
+#include "exposuretrace.h"
+
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sstream>
+
+#include <check.h>
+#include <check_utils.h>
+
+START_TEST(trace)
+{
+	rts2core::ExposureTrace tr;
+	ck_assert (isnan (tr.interval (rts2core::TRACE_EXPOSURE_END, rts2core::TRACE_READOUT_END)));
+
+	tr.set (rts2core::TRACE_EXPOSURE_END, 100);
+	tr.set (rts2core::TRACE_READOUT_END, 102.5);
+	ck_assert_dbl_eq (tr.interval (rts2core::TRACE_EXPOSURE_END, rts2core::TRACE_READOUT_END), 2.5, 10e-10);
+	ck_assert (isnan (tr.interval (rts2core::TRACE_EXPOSURE_END, rts2core::TRACE_TRANSFER_END)));
+
+	std::ostringstream os;
+	os << tr;
+	ck_assert_str_eq (os.str ().c_str (), "exposure end readout end +2.500");
+
+	tr.clear ();
+	ck_assert (isnan (tr.get (rts2core::TRACE_EXPOSURE_END)));
+
+	// stamps are monotonic and close to system time
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	tr.mark (rts2core::TRACE_DATA_START);
+	usleep (10000);
+	tr.mark (rts2core::TRACE_DATA_END);
+	ck_assert (fabs (tr.get (rts2core::TRACE_DATA_START) - (tv.tv_sec + tv.tv_usec / 1000000.0)) < 0.1);
+	double l = tr.interval (rts2core::TRACE_DATA_START, rts2core::TRACE_DATA_END);
+	ck_assert_msg (l >= 0.01 && l < 0.5, "interval %f", l);
+}
+END_TEST
+
+START_TEST(histogram)
+{
+	rts2core::TraceHistogram h;
+	ck_assert_int_eq (h.getCount (), 0);
+	ck_assert (isnan (h.getPercentile (50)));
+
+	ck_assert_dbl_eq (rts2core::TraceHistogram::getBinLimit (0), 0.001, 10e-10);
+	ck_assert_dbl_eq (rts2core::TraceHistogram::getBinLimit (10), 1.024, 10e-10);
+	ck_assert (isinf (rts2core::TraceHistogram::getBinLimit (TRACE_HISTOGRAM_BINS - 1)));
+
+	for (int i = 0; i < 90; i++)
+		h.add (0.3);
+	for (int i = 0; i < 10; i++)
+		h.add (3);
+	// ignored
+	h.add (NAN);
+	h.add (-1);
+	h.add (1e6);
+
+	ck_assert_int_eq (h.getCount (), 101);
+	ck_assert_dbl_eq (h.getMax (), 1e6, 10e-10);
+	ck_assert_dbl_eq (h.getPercentile (50), 0.512, 10e-10);
+	ck_assert_dbl_eq (h.getPercentile (95), 4.096, 10e-10);
+	ck_assert (isinf (h.getPercentile (100)));
+
+	h.clear ();
+	ck_assert_int_eq (h.getCount (), 0);
+	ck_assert_dbl_eq (h.getSum (), 0, 10e-10);
+}
+END_TEST
+
+Suite * exposuretrace_suite (void)
+{
+	Suite *s;
+	TCase *tc_trace;
+
+	s = suite_create ("Exposure trace");
+	tc_trace = tcase_create ("Stamps and histograms");
+
+	tcase_add_test (tc_trace, trace);
+	tcase_add_test (tc_trace, histogram);
+	suite_add_tcase (s, tc_trace);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = exposuretrace_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,325 @@
+#include "block.h"
+#include "expression.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <vector>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define NUM_TRIGGERS   500
+#define NUM_CAMERAS    8
+#define NUM_ROUNDS     200
+
+#define ck_assert_throw(x, E) { bool thrown = false; try { x; } catch (E &er) { thrown = true; } ck_assert_msg (thrown, "%s did not throw %s", #x, #E); }
+
+using namespace rts2expression;
+
+/**
+ * Block with values held in a map, as values of connections.
+ */
+class ExpressionBlock:public rts2core::Block
+{
+	public:
+		ExpressionBlock (int argc, char **argv):rts2core::Block (argc, argv) {}
+		virtual ~ExpressionBlock ()
+		{
+			for (std::map <std::string, rts2core::Value *>::iterator iter = devValues.begin (); iter != devValues.end (); iter++)
+				delete iter->second;
+		}
+
+		virtual int run () { return 0; }
+
+		virtual rts2core::Value *getValue (const char *device_name, const char *value_name)
+		{
+			std::map <std::string, rts2core::Value *>::iterator iter = devValues.find (std::string (device_name) + "." + value_name);
+			if (iter == devValues.end ())
+				return NULL;
+			return iter->second;
+		}
+
+		rts2core::ValueDouble *addDouble (const char *device_name, const char *value_name, double v)
+		{
+			rts2core::ValueDouble *val = new rts2core::ValueDouble (value_name, "test", false);
+			val->setValueDouble (v);
+			devValues[std::string (device_name) + "." + value_name] = val;
+			rts2core::Connection::changeValuesEpoch ();
+			return val;
+		}
+
+		void removeValue (const char *device_name, const char *value_name)
+		{
+			std::map <std::string, rts2core::Value *>::iterator iter = devValues.find (std::string (device_name) + "." + value_name);
+			delete iter->second;
+			devValues.erase (iter);
+			rts2core::Connection::changeValuesEpoch ();
+		}
+
+	protected:
+		virtual rts2core::Connection *createClientConnection (rts2core::NetworkAddress * in_addr) { return NULL; }
+
+	private:
+		std::map <std::string, rts2core::Value *> devValues;
+};
+
+ExpressionBlock *master;
+rts2core::ValueDouble *alt;
+rts2core::ValueDouble *rain;
+rts2core::ValueDouble *camTemp[NUM_CAMERAS];
+
+void resetTemperatures ()
+{
+	for (int i = 0; i < NUM_CAMERAS; i++)
+		camTemp[i]->setValueDouble (-10 - i);
+}
+
+void setup_block (void)
+{
+	const char *argv[] = {"check_expression"};
+	master = new ExpressionBlock (1, (char **) argv);
+	alt = master->addDouble ("T0", "ALT", 45);
+	rain = master->addDouble ("W0", "RAIN", 0);
+	for (int i = 0; i < NUM_CAMERAS; i++)
+	{
+		char name[10];
+		snprintf (name, 10, "C%d", i);
+		camTemp[i] = master->addDouble (name, "TEMP", 0);
+	}
+	resetTemperatures ();
+}
+
+void teardown_block (void)
+{
+	delete master;
+	master = NULL;
+}
+
+double evaluateTree (const char *str)
+{
+	Expression *exp = parseExpression (str);
+	double ret = exp->evaluate ();
+	delete exp;
+	return ret;
+}
+
+START_TEST(compile)
+{
+	struct
+	{
+		const char *exp;
+		double result;
+	} exps[] = {
+		{"T0.ALT > 30", 1},
+		{"T0.ALT>30", 1},
+		{"10.5 < T0.ALT", 1},
+		{"T0.ALT >= 45 and W0.RAIN == 0", 1},
+		{"T0.ALT < 10 or W0.RAIN != 0 or C1.TEMP <= -11", 1},
+		{"T0.ALT < 10 or W0.RAIN != 0 or C1.TEMP < -11", 0},
+		{"T0.ALT > 30 xor C0.TEMP > -20", 0},
+		{"W0.RAIN == 0 and T0.ALT > 30 and C2.TEMP > -12.5", 1},
+		{"W0.RAIN and T0.ALT", 0},
+		{"W0.RAIN or T0.ALT", 1},
+		{"1 < 2 and T0.ALT > 50", 0},
+		{NULL, 0}
+	};
+	for (int i = 0; exps[i].exp; i++)
+	{
+		CompiledExpression ce (exps[i].exp);
+		ck_assert_msg (ce.evaluate () == exps[i].result, "compiled expression %s is not %f", exps[i].exp, exps[i].result);
+		ck_assert_msg (evaluateTree (exps[i].exp) == exps[i].result, "expression %s is not %f", exps[i].exp, exps[i].result);
+	}
+
+	CompiledExpression c1 ("10.5 < T0.ALT");
+	ck_assert (c1.evaluate () == 1);
+	alt->setValueDouble (10.4);
+	ck_assert (c1.evaluate () == 0);
+
+	// constant folding
+	CompiledExpression c2 ("1 < 2.5");
+	ck_assert (c2.isConst ());
+	ck_assert (c2.evaluate () == 1);
+
+	CompiledExpression c3 ("1 < 2 and T0.ALT > 50 and 3 == 3");
+	ck_assert (!c3.isConst ());
+	ck_assert_int_eq (c3.getInputs (), 1);
+	// T0.ALT, 50, GT
+	ck_assert_int_eq (c3.getCodeSize (), 3);
+
+	CompiledExpression c4 ("1 > 2 and T0.ALT > 50");
+	ck_assert (c4.isConst ());
+	ck_assert (c4.evaluate () == 0);
+
+	CompiledExpression c5 ("T0.ALT > 1 and T0.ALT < 20");
+	ck_assert_int_eq (c5.getInputs (), 1);
+	ck_assert (c5.evaluate () == 1);
+
+	// right side is evaluated only when needed
+	CompiledExpression c6 ("T0.ALT > 1 or X.MISSING > 1");
+	ck_assert (c6.evaluate () == 1);
+	alt->setValueDouble (0);
+	ck_assert_throw (c6.evaluate (), ExpressionErrorValueMissing);
+
+	ck_assert_throw (CompiledExpression ("T0.ALT >"), rts2core::Error);
+	ck_assert_throw (CompiledExpression ("> 1"), rts2core::Error);
+	ck_assert_throw (CompiledExpression ("T0.ALT > (1)"), rts2core::Error);
+}
+END_TEST
+
+START_TEST(rebind)
+{
+	CompiledExpression ce ("C0.TEMP < -5 and X.NEW > 2");
+	ck_assert_throw (ce.evaluate (), ExpressionErrorValueMissing);
+
+	rts2core::ValueDouble *nv = master->addDouble ("X", "NEW", 3);
+	ck_assert (ce.evaluate () == 1);
+
+	// value replaced by reconnected device
+	master->removeValue ("X", "NEW");
+	ck_assert_throw (ce.evaluate (), ExpressionErrorValueMissing);
+	nv = master->addDouble ("X", "NEW", 1);
+	ck_assert (ce.evaluate () == 0);
+	nv->setValueDouble (5);
+	ck_assert (ce.evaluate () == 1);
+}
+END_TEST
+
+START_TEST(dependencies)
+{
+	ExpressionIndex index;
+	CompiledExpression *e1 = new CompiledExpression ("T0.ALT > 30");
+	CompiledExpression *e2 = new CompiledExpression ("C0.TEMP < -5 and W0.RAIN == 0");
+	index.add (e1);
+	index.add (e2);
+
+	index.valueChanged (alt);
+	ck_assert (e1->evaluate () == 1);
+	ck_assert (e2->evaluate () == 1);
+
+	// not reported changes are not seen
+	alt->setValueDouble (20);
+	ck_assert (e1->evaluate () == 1);
+	index.valueChanged (alt);
+	ck_assert (e1->evaluate () == 0);
+
+	rain->setValueDouble (1);
+	index.valueChanged (camTemp[1]);
+	ck_assert (e2->evaluate () == 1);
+	index.valueChanged (rain);
+	ck_assert (e2->evaluate () == 0);
+
+	// new values invalidate all results
+	master->removeValue ("C0", "TEMP");
+	index.valueChanged (rain);
+	ck_assert_throw (e2->evaluate (), ExpressionErrorValueMissing);
+	camTemp[0] = master->addDouble ("C0", "TEMP", -10);
+	rain->setValueDouble (0);
+	index.valueChanged (alt);
+	ck_assert (e2->evaluate () == 1);
+}
+END_TEST
+
+START_TEST(benchmark)
+{
+	std::vector <std::string> tests;
+	for (int i = 0; i < NUM_TRIGGERS; i++)
+	{
+		char buf[200];
+		snprintf (buf, 200, "T0.ALT > %d and W0.RAIN == 0 and C%d.TEMP < -%d or C%d.TEMP > 20", i % 60, i % NUM_CAMERAS, i % 15, (i + 1) % NUM_CAMERAS);
+		tests.push_back (std::string (buf));
+	}
+
+	std::vector <Expression *> trees;
+	std::vector <CompiledExpression *> compiled;
+	std::vector <CompiledExpression *> tracked;
+	ExpressionIndex index;
+	for (std::vector <std::string>::iterator iter = tests.begin (); iter != tests.end (); iter++)
+	{
+		trees.push_back (parseExpression (iter->c_str ()));
+		compiled.push_back (new CompiledExpression (iter->c_str ()));
+		tracked.push_back (new CompiledExpression (iter->c_str ()));
+		index.add (tracked.back ());
+	}
+
+	// each round one camera temperature changes and all triggers are evaluated
+	double sumTree = 0, sumCompiled = 0, sumTracked = 0;
+
+	resetTemperatures ();
+	uint64_t t0 = gettime_ns ();
+	for (int r = 0; r < NUM_ROUNDS; r++)
+	{
+		camTemp[r % NUM_CAMERAS]->setValueDouble (-20 + r % 30);
+		for (std::vector <Expression *>::iterator iter = trees.begin (); iter != trees.end (); iter++)
+			sumTree += (*iter)->evaluate ();
+	}
+	uint64_t ttree = gettime_ns () - t0;
+
+	resetTemperatures ();
+	t0 = gettime_ns ();
+	for (int r = 0; r < NUM_ROUNDS; r++)
+	{
+		camTemp[r % NUM_CAMERAS]->setValueDouble (-20 + r % 30);
+		for (std::vector <CompiledExpression *>::iterator iter = compiled.begin (); iter != compiled.end (); iter++)
+			sumCompiled += (*iter)->evaluate ();
+	}
+	uint64_t tcompiled = gettime_ns () - t0;
+
+	resetTemperatures ();
+	t0 = gettime_ns ();
+	for (int r = 0; r < NUM_ROUNDS; r++)
+	{
+		camTemp[r % NUM_CAMERAS]->setValueDouble (-20 + r % 30);
+		index.valueChanged (camTemp[r % NUM_CAMERAS]);
+		for (std::vector <CompiledExpression *>::iterator iter = tracked.begin (); iter != tracked.end (); iter++)
+			sumTracked += (*iter)->evaluate ();
+	}
+	uint64_t ttracked = gettime_ns () - t0;
+
+	ck_assert (sumTree == sumCompiled);
+	ck_assert (sumTree == sumTracked);
+
+	double n = NUM_TRIGGERS * NUM_ROUNDS;
+	printf ("%d triggers: tree %.0f, compiled %.0f, compiled with dependencies %.0f evaluations per second\n", NUM_TRIGGERS, n * 1e9 / ttree, n * 1e9 / tcompiled, n * 1e9 / ttracked);
+
+	for (int i = 0; i < NUM_TRIGGERS; i++)
+	{
+		delete trees[i];
+		delete compiled[i];
+	}
+}
+END_TEST
+
+Suite * expression_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Expression");
+	tc_core = tcase_create ("Core");
+	tcase_add_checked_fixture (tc_core, setup_block, teardown_block);
+	tcase_set_timeout (tc_core, 60);
+	tcase_add_test (tc_core, compile);
+	tcase_add_test (tc_core, rebind);
+	tcase_add_test (tc_core, dependencies);
+	tcase_add_test (tc_core, benchmark);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = expression_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
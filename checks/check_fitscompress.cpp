@@ -0,0 +1,210 @@
+#include "rts2fits/compression.h"
+#include "imghdr.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <arpa/inet.h>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define FRAME_W       2048
+#define FRAME_H       2048
+#define FRAME_CHAN    4
+
+double gaussrand ()
+{
+	double u1 = (rand () + 1.0) / (RAND_MAX + 2.0);
+	double u2 = (rand () + 1.0) / (RAND_MAX + 2.0);
+	return sqrt (-2 * log (u1)) * cos (2 * M_PI * u2);
+}
+
+/**
+ * Creates data channel with representative frame - bias with read noise, sky and few stars.
+ */
+rts2core::DataRead *makeChannel (int chan, int dataType, int w, int h)
+{
+	int bpp = (dataType == RTS2_DATA_FLOAT) ? sizeof (float) : sizeof (uint16_t);
+	size_t ts = (size_t) w * h * bpp;
+
+	struct imghdr imgh;
+	memset (&imgh, 0, sizeof (imgh));
+	imgh.data_type = htons (dataType);
+	imgh.naxes = 2;
+	imgh.sizes[0] = htonl (w);
+	imgh.sizes[1] = htonl (h);
+	imgh.binnings[0] = htons (1);
+	imgh.binnings[1] = htons (1);
+	imgh.channel = htons (chan);
+
+	char *pixels = new char[ts];
+	for (int y = 0; y < h; y++)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			double v = 1000 + 300 + 10 * gaussrand ();
+			if (dataType == RTS2_DATA_FLOAT)
+				((float *) pixels)[y * w + x] = v;
+			else
+				((uint16_t *) pixels)[y * w + x] = v;
+		}
+	}
+	for (int s = 0; s < 200; s++)
+	{
+		int sx = rand () % (w - 10) + 5;
+		int sy = rand () % (h - 10) + 5;
+		double flux = rand () % 20000;
+		for (int dy = -4; dy <= 4; dy++)
+		{
+			for (int dx = -4; dx <= 4; dx++)
+			{
+				double v = flux * exp (-(dx * dx + dy * dy) / 3.0);
+				size_t i = (sy + dy) * w + sx + dx;
+				if (dataType == RTS2_DATA_FLOAT)
+					((float *) pixels)[i] += v;
+				else
+					((uint16_t *) pixels)[i] = std::min (65535.0, ((uint16_t *) pixels)[i] + v);
+			}
+		}
+	}
+
+	rts2core::DataRead *dr = new rts2core::DataRead (ts + sizeof (struct imghdr), dataType);
+	dr->setChunkSizeFromData ();
+	dr->addData ((char *) &imgh, sizeof (struct imghdr));
+	dr->addData (pixels, ts);
+	delete[] pixels;
+	return dr;
+}
+
+rts2core::DataChannels *makeFrame (int dataType)
+{
+	rts2core::DataChannels *data = new rts2core::DataChannels ();
+	for (int i = 1; i <= FRAME_CHAN; i++)
+		data->push_back (makeChannel (i, dataType, FRAME_W, FRAME_H));
+	return data;
+}
+
+/**
+ * Compress frame, print throughput and compression ratio.
+ */
+double benchCompress (const char *name, rts2image::TileCompression &tc, rts2core::DataChannels *data)
+{
+	rts2image::ChannelCompressor compressor (tc);
+
+	uint64_t t0 = gettime_ns ();
+	ck_assert_int_eq (compressor.compress (data), 0);
+	uint64_t t1 = gettime_ns ();
+
+	double ratio = (double) compressor.getRawSize () / compressor.getCompressedSize ();
+	printf ("%-12s %d threads %8.1f ms %8.1f MB/s ratio %5.2f\n", name, tc.threads, (t1 - t0) / 1000000.0, compressor.getRawSize () / ((t1 - t0) / 1000.0), ratio);
+	return ratio;
+}
+
+START_TEST(lossless)
+{
+	rts2core::DataChannels *data = makeFrame (RTS2_DATA_USHORT);
+
+	rts2image::TileCompression tc;
+	ck_assert_int_eq (tc.setType ("rice"), 0);
+	tc.threads = FRAME_CHAN;
+
+	rts2image::ChannelCompressor compressor (tc);
+	ck_assert_int_eq (compressor.compress (data), 0);
+
+	// recompressing single channel keeps results of the other channels
+	ck_assert_int_eq (compressor.compress ((*data)[1]->getDataBuff (), (*data)[1]->getDataTop ()), 0);
+
+	// write compressed channels to single file, read them back
+	size_t memsize = 2880;
+	void *memptr = malloc (memsize);
+	int status = 0;
+	fitsfile *out;
+	fits_create_memfile (&out, &memptr, &memsize, 2880, realloc, &status);
+	fits_create_img (out, USHORT_IMG, 0, NULL, &status);
+	ck_assert_int_eq (status, 0);
+
+	for (int i = 1; i <= FRAME_CHAN; i++)
+		ck_assert_int_eq (compressor.appendTo (i, out, &status), 0);
+	ck_assert_int_eq (compressor.appendTo (FRAME_CHAN + 1, out, &status), -1);
+
+	int hdunum = 0;
+	fits_get_num_hdus (out, &hdunum, &status);
+	ck_assert_int_eq (hdunum, FRAME_CHAN + 1);
+
+	uint16_t *back = new uint16_t[FRAME_W * FRAME_H];
+	for (int i = 1; i <= FRAME_CHAN; i++)
+	{
+		int anynull;
+		fits_movabs_hdu (out, i + 1, NULL, &status);
+		fits_read_img (out, TUSHORT, 1, FRAME_W * FRAME_H, NULL, back, &anynull, &status);
+		ck_assert_int_eq (status, 0);
+		ck_assert_msg (memcmp (back, (*data)[i - 1]->getDataBuff () + sizeof (struct imghdr), FRAME_W * FRAME_H * sizeof (uint16_t)) == 0, "decompressed channel %d differs", i);
+	}
+	delete[] back;
+
+	fits_close_file (out, &status);
+	free (memptr);
+
+	delete data;
+}
+END_TEST
+
+START_TEST(benchmark)
+{
+	rts2core::DataChannels *data = makeFrame (RTS2_DATA_USHORT);
+
+	rts2image::TileCompression tc;
+	const char *types[] = {"rice", "hcompress", "gzip"};
+	for (int t = 0; t < 3; t++)
+	{
+		tc.setType (types[t]);
+		for (tc.threads = 1; tc.threads <= FRAME_CHAN; tc.threads *= 2)
+			ck_assert_msg (benchCompress (types[t], tc, data) > 1.5, "%s compression ratio is too low", types[t]);
+	}
+	delete data;
+
+	data = makeFrame (RTS2_DATA_FLOAT);
+	tc.setType ("rice");
+	tc.quantize = 4;
+	for (tc.threads = 1; tc.threads <= FRAME_CHAN; tc.threads *= 2)
+		ck_assert_msg (benchCompress ("float rice", tc, data) > 2, "quantized float compression ratio is too low");
+	tc.quantize = 0;
+	tc.threads = FRAME_CHAN;
+	benchCompress ("float gzip", tc, data);
+	delete data;
+}
+END_TEST
+
+Suite * fitscompress_suite (void)
+{
+	Suite *s;
+	TCase *tc_compress;
+
+	s = suite_create ("FITS compression");
+	tc_compress = tcase_create ("Tile compression");
+	tcase_set_timeout (tc_compress, 120);
+
+	tcase_add_test (tc_compress, lossless);
+	tcase_add_test (tc_compress, benchmark);
+	suite_add_tcase (s, tc_compress);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = fitscompress_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,335 @@
+#include "gpointfit.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <sstream>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define ARCSEC      (M_PI / 180.0 / 3600.0)
+
+double randu (double from, double to)
+{
+	return from + (to - from) * (rand () / (RAND_MAX + 1.0));
+}
+
+double randn ()
+{
+	double u1 = randu (1e-12, 1);
+	double u2 = randu (0, 1);
+	return sqrt (-2 * log (u1)) * cos (2 * M_PI * u2);
+}
+
+// alt-az model with known terms, generates observations with given noise (arcsec)
+void fillAltAz (rts2telmodel::GPointFit &fit, rts2telmodel::GPointModel &model, int n, double noise, int outliers)
+{
+	std::istringstream iss ("RTS2_ALTAZ -28.7\" 1.5\" 4.6\" -17.2\" 3.1\" -15.9\" 9.9\"\nAZ\t6.8\"\tsincos\taz;el\t2;2\nEL\t-2.5\"\tsin\taz\t1");
+	model.load (iss);
+
+	fit.setModel (true, -32.53);
+	struct ln_hrz_posn hrz, err;
+	struct ln_equ_posn equ;
+	equ.ra = equ.dec = 0;
+	for (int i = 0; i < n; i++)
+	{
+		double az = randu (0, 360);
+		double el = randu (10, 85);
+		hrz.az = az;
+		hrz.alt = el;
+		model.getErrAltAz (&hrz, &equ, &err);
+		double dn = (i < outliers) ? 100 : noise;
+		// residual a - r + m should be zero
+		fit.addObservation (az, el, az + err.az + dn * randn () / 3600.0 / cos (ln_deg_to_rad (el)), el + err.alt + dn * randn () / 3600.0);
+	}
+	fit.addExtra ("az", "sincos", "az;el", "2;2");
+	fit.addExtra ("el", "sin", "az", "1");
+}
+
+START_TEST(altaz_synthetic)
+{
+	srand (1);
+	rts2telmodel::GPointModel model (-32.53);
+	rts2telmodel::GPointFit fit;
+	fillAltAz (fit, model, 5000, 0.5, 0);
+
+	ck_assert_int_eq (fit.getParamCount (), 9);
+	ck_assert_str_eq (fit.getParamName (7), "az_sincos_az_el_2_0_2_0");
+	ck_assert_str_eq (fit.getParamName (8), "el_sin_az_1_0");
+
+	uint64_t t0 = gettime_ns ();
+	double rms = fit.fit ();
+	uint64_t t = gettime_ns () - t0;
+
+	printf ("alt-az fit of %d observations: %.1f ms, %d iterations, RMS %.3f\"\n", (int) fit.size (), t / 1e6, fit.getIterations (), rms);
+	fit.printParameters (std::cout);
+
+	ck_assert (rms < 1.0);
+	for (int i = 0; i < 7; i++)
+		ck_assert_dbl_eq (fit.getParam (i), model.params[i], 0.3 * ARCSEC);
+	ck_assert_dbl_eq (fit.getParam ("az_sincos_az_el_2_0_2_0"), 6.8 * ARCSEC, 0.3 * ARCSEC);
+	ck_assert_dbl_eq (fit.getParam ("el_sin_az_1_0"), -2.5 * ARCSEC, 0.3 * ARCSEC);
+	for (int i = 0; i < fit.getParamCount (); i++)
+		ck_assert (fit.getParamError (i) > 0 && fit.getParamError (i) < 0.3 * ARCSEC);
+
+	// written model must load and give same corrections
+	std::ostringstream os;
+	fit.print (os);
+	std::cout << os.str ();
+	rts2telmodel::GPointModel loaded (-32.53);
+	std::istringstream iss (os.str ());
+	loaded.load (iss);
+	ck_assert (loaded.altaz);
+	ck_assert_int_eq (loaded.extraParamsAz.size (), 1);
+	ck_assert_int_eq (loaded.extraParamsEl.size (), 1);
+
+	struct ln_hrz_posn h1, h2, e1, e2;
+	struct ln_equ_posn equ;
+	equ.ra = equ.dec = 0;
+	for (int i = 0; i < 100; i++)
+	{
+		h1.az = h2.az = randu (0, 360);
+		h1.alt = h2.alt = randu (10, 85);
+		model.getErrAltAz (&h1, &equ, &e1);
+		loaded.getErrAltAz (&h2, &equ, &e2);
+		ck_assert_dbl_eq (e1.az * 3600.0, e2.az * 3600.0, 0.3);
+		ck_assert_dbl_eq (e1.alt * 3600.0, e2.alt * 3600.0, 0.3);
+	}
+}
+END_TEST
+
+START_TEST(gem_synthetic)
+{
+	srand (2);
+	rts2telmodel::GPointModel model (35);
+	std::istringstream iss ("RTS2_MODEL -160\" 12\" -8\" 20\" 35\" -21\" 44\" 6\" 14\"\nDEC\t3.5\"\tcos\tha\t2");
+	model.load (iss);
+
+	rts2telmodel::GPointFit fit;
+	fit.setModel (false, 35);
+	fit.setThreads (4);
+	for (int i = 0; i < 4000; i++)
+	{
+		double ha = randu (-90, 90);
+		double dec = randu (-30, 80);
+		// flipped telescope
+		if (i % 2)
+			dec = 180 - dec;
+		struct ln_equ_posn pos;
+		struct ln_hrz_posn hrz;
+		pos.ra = ha;
+		pos.dec = dec;
+		hrz.az = hrz.alt = 0;
+		// reverse adds -model
+		model.reverse (&pos, &hrz);
+		fit.addObservation (ha, dec, 2 * ha - pos.ra + 0.3 * randn () / 3600.0, 2 * dec - pos.dec + 0.3 * randn () / 3600.0);
+	}
+	fit.addExtra ("dec", "cos", "ha", "2");
+
+	uint64_t t0 = gettime_ns ();
+	double rms = fit.fit ();
+	uint64_t t = gettime_ns () - t0;
+
+	printf ("GEM fit of %d observations: %.1f ms, %d iterations, RMS %.3f\"\n", (int) fit.size (), t / 1e6, fit.getIterations (), rms);
+	fit.printParameters (std::cout);
+
+	ck_assert (rms < 1.0);
+	for (int i = 0; i < 9; i++)
+		ck_assert_dbl_eq (fit.getParam (i), model.params[i], 0.3 * ARCSEC);
+	ck_assert_dbl_eq (fit.getParam ("dec_cos_ha_2_0"), 3.5 * ARCSEC, 0.1 * ARCSEC);
+
+	std::ostringstream os;
+	fit.print (os);
+	std::cout << os.str ();
+	rts2telmodel::GPointModel loaded (35);
+	std::istringstream liss (os.str ());
+	loaded.load (liss);
+	ck_assert (!loaded.altaz);
+	ck_assert_int_eq (loaded.extraParamsDec.size (), 1);
+	for (int i = 0; i < 9; i++)
+		ck_assert_dbl_eq (loaded.params[i], fit.getParam (i), 1e-12);
+
+	// fixed parameters keep their values
+	rts2telmodel::GPointFit fit2;
+	fit2.setModel (false, 35);
+	for (size_t i = 0; i < fit.size (); i++)
+		fit2.addObservation (ln_rad_to_deg (fit[i].a_x), ln_rad_to_deg (fit[i].a_y), ln_rad_to_deg (fit[i].r_x), ln_rad_to_deg (fit[i].r_y));
+	fit2.setFixed ("me");
+	fit2.setFixed ("daf");
+	ck_assert (!std::isnan (fit2.fit ()));
+	ck_assert (fit2.isFixed (1));
+	ck_assert_dbl_eq (fit2.getParam ("me"), 0, 1e-15);
+	ck_assert_dbl_eq (fit2.getParam ("daf"), 0, 1e-15);
+
+	try
+	{
+		fit2.setFixed ("ia");
+		ck_abort_msg ("alt-az parameter accepted for GEM model");
+	}
+	catch (rts2core::Error &er)
+	{
+	}
+}
+END_TEST
+
+START_TEST(outliers)
+{
+	srand (3);
+	rts2telmodel::GPointModel model (-32.53);
+	rts2telmodel::GPointFit fit;
+	fillAltAz (fit, model, 2000, 0.5, 40);
+
+	double rms = fit.fit ();
+	// outliers spoil the fit
+	ck_assert (rms > 5);
+
+	int removed = fit.fitRejectOutliers (4);
+	rms = fit.fit ();
+	printf ("removed %d outliers, RMS %.3f\"\n", removed, rms);
+	ck_assert (removed >= 40 && removed < 50);
+	for (int i = 0; i < 40; i++)
+		ck_assert (fit[i].active == false);
+	ck_assert (rms < 1.0);
+	for (int i = 0; i < 7; i++)
+		ck_assert_dbl_eq (fit.getParam (i), model.params[i], 0.3 * ARCSEC);
+}
+END_TEST
+
+START_TEST(input_files)
+{
+	// same fits as done in check_python_gpoint_altaz and check_python_gpoint_gem
+	rts2telmodel::GPointFit fit;
+	ck_assert_int_eq (fit.loadInput ("gpoint_in_altaz"), 235);
+	ck_assert (fit.isAltAz ());
+	ck_assert_dbl_eq (fit.getLatitude (), -32.53, 1e-9);
+
+	fit.addExtra ("az", "sincos", "az;el", "2;2");
+	fit.addExtra ("az", "sincos", "el;az", "5;3");
+	fit.addExtra ("el", "sincos", "az;el", "4;4");
+	fit.addExtra ("el", "sin", "az", "1");
+	try
+	{
+		fit.addExtra ("az", "sincos", "az;el", "2;2");
+		ck_abort_msg ("duplicated term accepted");
+	}
+	catch (rts2core::Error &er)
+	{
+	}
+
+	fit.setFixed ("tn");
+	fit.setFixed ("el_sincos_az_el_4_0_4_0");
+	fit.setFixed ("el_sin_az_1_0");
+	fit.setFixed ("az_sincos_el_az_5_0_3_0");
+	fit.setFixed ("npoa");
+
+	double rms = fit.fit ();
+	printf ("gpoint_in_altaz RMS %.2f\"\n", rms);
+	fit.printParameters (std::cout);
+
+	ck_assert_dbl_eq (fit.getParam ("ia") / ARCSEC, -28.72, 0.5);
+	ck_assert_dbl_eq (fit.getParam ("tn"), 0, 1e-15);
+	ck_assert_dbl_eq (fit.getParam ("te") / ARCSEC, 4.63, 0.5);
+	ck_assert_dbl_eq (fit.getParam ("npae") / ARCSEC, -17.18, 0.5);
+	ck_assert_dbl_eq (fit.getParam ("ie") / ARCSEC, -15.86, 0.5);
+	ck_assert_dbl_eq (fit.getParam ("tf") / ARCSEC, 9.86, 0.5);
+	ck_assert_dbl_eq (fit.getParam ("az_sincos_az_el_2_0_2_0") / ARCSEC, 6.84, 0.5);
+
+	rts2telmodel::GPointFit gem;
+	ck_assert_int_eq (gem.loadInput ("gpoint_in_gem"), 24);
+	ck_assert (!gem.isAltAz ());
+	gem.setFixed ("me");
+	gem.setFixed ("daf");
+	gem.setFixed ("ma");
+	gem.setFixed ("tf");
+	gem.setFixed ("ih");
+	rms = gem.fit ();
+	printf ("gpoint_in_gem RMS %.2f\"\n", rms);
+	gem.printParameters (std::cout);
+
+	ck_assert_dbl_eq (gem.getParam ("id") / ARCSEC, -1613.58, 1);
+	ck_assert_dbl_eq (gem.getParam ("ch") / ARCSEC, -216.39, 1);
+	ck_assert_dbl_eq (gem.getParam ("np") / ARCSEC, 444.38, 1);
+	ck_assert_dbl_eq (gem.getParam ("fo") / ARCSEC, 143.16, 1);
+
+	// invalid input
+	rts2telmodel::GPointFit inv;
+	std::istringstream iss ("# header\n# observatory 20 -32 1000\n1 2 3 4\n");
+	try
+	{
+		inv.loadInput (iss);
+		ck_abort_msg ("too short line accepted");
+	}
+	catch (rts2core::Error &er)
+	{
+	}
+}
+END_TEST
+
+START_TEST(extra_terms)
+{
+	// terms written by the model must be parsed back
+	rts2telmodel::GPointModel model (20);
+	std::istringstream iss ("RTS2_ALTAZ 0 0 0 0 0 0 0\nAZ\t2\"\tcsc\tel\t1\nAZ\t3\"\tsec\tzd\t1\nEL\t4\"\tsinsin\taz;el\t2;0.5\nEL\t5\"\tcos\tpd\t1");
+	model.load (iss);
+
+	std::ostringstream os;
+	model.print (os, '"');
+	rts2telmodel::GPointModel loaded (20);
+	std::istringstream liss (os.str ());
+	loaded.load (liss);
+	ck_assert_int_eq (loaded.extraParamsAz.size (), 2);
+	ck_assert_int_eq (loaded.extraParamsEl.size (), 2);
+
+	std::list <rts2telmodel::ExtraParam *>::iterator it1 = model.extraParamsEl.begin ();
+	std::list <rts2telmodel::ExtraParam *>::iterator it2 = loaded.extraParamsEl.begin ();
+	ck_assert_int_eq ((*it2)->function, rts2telmodel::GPOINT_SINSIN);
+	ck_assert_dbl_eq ((*it2)->consts[1], 0.5, 1e-12);
+	ck_assert_dbl_eq ((*it1)->getValue (1, 0.5, 0, 0), (*it2)->getValue (1, 0.5, 0, 0), 1e-15);
+	ck_assert_dbl_eq ((*it2)->getValue (1, 0.5, 0, 0), 4 * ARCSEC * sin (2) * sin (0.25), 1e-15);
+
+	it2++;
+	ck_assert_int_eq ((*it2)->terms[0], rts2telmodel::GPOINT_PD);
+	ck_assert_dbl_eq ((*it2)->getValue (0, 0, 0, ln_deg_to_rad (60)), 5 * ARCSEC * cos (ln_deg_to_rad (30)), 1e-15);
+	ck_assert_dbl_eq ((*it2)->getValue (0, 0, 0, ln_deg_to_rad (120)), 5 * ARCSEC * cos (ln_deg_to_rad (30)), 1e-15);
+
+	it2 = loaded.extraParamsAz.begin ();
+	ck_assert_dbl_eq ((*it2)->getValue (0, 0.5, 0, 0), 2 * ARCSEC / sin (0.5), 1e-15);
+	it2++;
+	ck_assert_dbl_eq ((*it2)->getValue (0, 0.5, 0, 0), 3 * ARCSEC / cos (M_PI / 2.0 - 0.5), 1e-15);
+}
+END_TEST
+
+Suite * gpointfit_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("GPointFit");
+	tc_core = tcase_create ("Core");
+	tcase_set_timeout (tc_core, 60);
+	tcase_add_test (tc_core, altaz_synthetic);
+	tcase_add_test (tc_core, gem_synthetic);
+	tcase_add_test (tc_core, outliers);
+	tcase_add_test (tc_core, input_files);
+	tcase_add_test (tc_core, extra_terms);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = gpointfit_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
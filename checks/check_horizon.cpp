@@ -0,0 +1,263 @@
+#include "objectcheck.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <math.h>
+#include <libnova/libnova.h>
+#include <vector>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define NUM_LOOKUPS   1000000
+
+/**
+ * Horizon interpolation as done by ObjectCheck before horizon was
+ * compiled to lookup table. Kept to verify and benchmark the table.
+ */
+namespace legacy
+{
+
+double getHorizonHeightAz (double az, horizon_t::iterator iter1, horizon_t::iterator iter2)
+{
+	double az1;
+	if ((*iter1).hrz.az > (*iter2).hrz.az)
+		az1 = (*iter1).hrz.az - 360.0;
+	else
+		az1 = (*iter1).hrz.az;
+	return (*iter1).hrz.alt + ln_range_degrees (az - az1) * ((*iter2).hrz.alt - (*iter1).hrz.alt) / ((*iter2).hrz.az - az1);
+}
+
+double getHorizonHeight (ObjectCheck &checker, double az)
+{
+	if (checker.begin () == checker.end ())
+		return 0;
+
+	horizon_t::iterator iter = checker.begin ();
+
+	if (az < (*iter).hrz.az)
+		return getHorizonHeightAz (az, iter, --checker.end ());
+
+	horizon_t::iterator iter_last = iter;
+
+	iter++;
+
+	for (; iter != checker.end (); iter++)
+	{
+		if ((*iter).hrz.az > az)
+			return getHorizonHeightAz (az, iter_last, iter);
+		iter_last = iter;
+	}
+	return getHorizonHeightAz (az, iter_last, checker.begin ());
+}
+
+int is_good_with_margin (ObjectCheck &checker, struct ln_hrz_posn *hrz, double alt_margin, double az_margin)
+{
+	hrz->alt = hrz->alt - alt_margin;
+	if (hrz->alt > 90)
+		hrz->alt = 90;
+	hrz->az = ln_range_degrees (hrz->az - az_margin);
+	if (hrz->alt > getHorizonHeight (checker, hrz->az))
+		return 1;
+	hrz->az = ln_range_degrees (hrz->az + 2 * az_margin);
+	return hrz->alt > getHorizonHeight (checker, hrz->az);
+}
+
+}
+
+/**
+ * Write AZ-ALT horizon file and load it. Altitude must be signed, as
+ * otherwise it is parsed as arcminutes of azimuth.
+ */
+void loadHorizon (ObjectCheck &checker, const std::vector <std::pair <double, double> > &points)
+{
+	char fn[] = "/tmp/check_horizon_XXXXXX";
+	int fd = mkstemp (fn);
+	ck_assert (fd >= 0);
+	FILE *f = fdopen (fd, "w");
+	fprintf (f, "# test horizon\nAZ-ALT\n");
+	for (std::vector <std::pair <double, double> >::const_iterator iter = points.begin (); iter != points.end (); iter++)
+		fprintf (f, "%.10f %+.10f\n", iter->first, iter->second);
+	fclose (f);
+	ck_assert_int_eq (checker.loadHorizon (fn), 0);
+	unlink (fn);
+}
+
+double randaz ()
+{
+	return 360.0 * (rand () / (RAND_MAX + 1.0));
+}
+
+START_TEST(lookup)
+{
+	srand (7);
+	// horizon starting at 0, as usual horizon files
+	std::vector <std::pair <double, double> > points;
+	for (int az = 0; az < 360; az += 5)
+		points.push_back (std::pair <double, double> (az + (az ? rand () % 40 / 10.0 : 0), rand () % 400 / 10.0));
+	ObjectCheck checker;
+	loadHorizon (checker, points);
+
+	struct ln_hrz_posn hrz;
+	for (int i = 0; i < NUM_LOOKUPS; i++)
+	{
+		hrz.az = randaz ();
+		ck_assert_dbl_eq (checker.getHorizonHeight (&hrz, 0), legacy::getHorizonHeight (checker, hrz.az), 1e-9);
+	}
+	// at, just before and after horizon points and bin boundaries
+	for (std::vector <std::pair <double, double> >::iterator iter = points.begin (); iter != points.end (); iter++)
+	{
+		for (double d = -1e-7; d <= 1e-7; d += 1e-7)
+		{
+			hrz.az = ln_range_degrees (iter->first + d);
+			ck_assert_dbl_eq (checker.getHorizonHeight (&hrz, 0), legacy::getHorizonHeight (checker, hrz.az), 1e-6);
+		}
+		hrz.az = iter->first;
+		ck_assert_dbl_eq (checker.getHorizonHeight (&hrz, 0), iter->second, 1e-9);
+	}
+	for (int b = 0; b < HORIZON_LUT_BINS; b++)
+	{
+		hrz.az = b * 360.0 / HORIZON_LUT_BINS;
+		ck_assert_dbl_eq (checker.getHorizonHeight (&hrz, 0), legacy::getHorizonHeight (checker, hrz.az), 1e-9);
+	}
+
+	// out of range azimuths
+	ck_assert_dbl_eq (checker.getHorizonHeightAz (-10), checker.getHorizonHeightAz (350), 1e-9);
+	ck_assert_dbl_eq (checker.getHorizonHeightAz (370), checker.getHorizonHeightAz (10), 1e-9);
+	ck_assert (isnan (checker.getHorizonHeightAz (NAN)));
+
+	// is_good, is_good_with_margin and batch check
+	std::vector <struct ln_hrz_posn> pos (10000);
+	for (std::vector <struct ln_hrz_posn>::iterator iter = pos.begin (); iter != pos.end (); iter++)
+	{
+		iter->az = randaz ();
+		iter->alt = rand () % 500 / 10.0;
+	}
+	bool good[pos.size ()];
+	size_t ngood = checker.is_good_batch (pos.data (), pos.size (), good);
+	size_t n = 0;
+	for (size_t i = 0; i < pos.size (); i++)
+	{
+		int g = pos[i].alt > legacy::getHorizonHeight (checker, pos[i].az);
+		ck_assert_int_eq (checker.is_good (&pos[i]), g);
+		ck_assert_int_eq (good[i], g);
+		n += g;
+
+		struct ln_hrz_posn h1 = pos[i], h2 = pos[i];
+		ck_assert_int_eq (checker.is_good_with_margin (&h1, 2, 3), legacy::is_good_with_margin (checker, &h2, 2, 3));
+		ck_assert_dbl_eq (h1.az, h2.az, 1e-12);
+		ck_assert_dbl_eq (h1.alt, h2.alt, 1e-12);
+	}
+	ck_assert_int_eq (ngood, n);
+	ck_assert (n > 0 && n < pos.size ());
+
+	checker.setIgnore ();
+	ck_assert_int_eq (checker.is_good_batch (pos.data (), pos.size (), good), pos.size ());
+}
+END_TEST
+
+START_TEST(wrap)
+{
+	// first point is not at 0 azimuth
+	std::vector <std::pair <double, double> > points;
+	points.push_back (std::pair <double, double> (10, 20));
+	points.push_back (std::pair <double, double> (100, 5));
+	points.push_back (std::pair <double, double> (200, 25));
+	points.push_back (std::pair <double, double> (350, 30));
+	ObjectCheck checker;
+	loadHorizon (checker, points);
+
+	for (int i = 0; i < 100000; i++)
+	{
+		double az = randaz ();
+		if (az >= 10)
+			ck_assert_dbl_eq (checker.getHorizonHeightAz (az), legacy::getHorizonHeight (checker, az), 1e-9);
+	}
+
+	// horizon is interpolated between last and first point across 0
+	ck_assert_dbl_eq (checker.getHorizonHeightAz (0), 25, 1e-9);
+	ck_assert_dbl_eq (checker.getHorizonHeightAz (5), 22.5, 1e-9);
+	ck_assert_dbl_eq (checker.getHorizonHeightAz (355), 27.5, 1e-9);
+	ck_assert_dbl_eq (checker.getHorizonHeightAz (10 - 1e-9), 20, 1e-6);
+	ck_assert_dbl_eq (checker.getHorizonHeightAz (360 - 1e-9), 25, 1e-6);
+
+	// single point
+	points.resize (1);
+	loadHorizon (checker, points);
+	ck_assert_dbl_eq (checker.getHorizonHeightAz (0), 20, 1e-9);
+	ck_assert_dbl_eq (checker.getHorizonHeightAz (10), 20, 1e-9);
+	ck_assert_dbl_eq (checker.getHorizonHeightAz (300), 20, 1e-9);
+
+	// no horizon
+	ObjectCheck empty;
+	ck_assert_int_eq (empty.loadHorizon ("-"), 0);
+	ck_assert_dbl_eq (empty.getHorizonHeightAz (100), 0, 1e-9);
+}
+END_TEST
+
+START_TEST(benchmark)
+{
+	std::vector <std::pair <double, double> > points;
+	for (int az = 0; az < 360; az++)
+		points.push_back (std::pair <double, double> (az, 10 + 5 * sin (az * M_PI / 30)));
+	ObjectCheck checker;
+	loadHorizon (checker, points);
+
+	std::vector <double> az (NUM_LOOKUPS), alt (NUM_LOOKUPS);
+	for (int i = 0; i < NUM_LOOKUPS; i++)
+		az[i] = randaz ();
+
+	uint64_t t0 = gettime_ns ();
+	double s = 0;
+	for (int i = 0; i < NUM_LOOKUPS; i++)
+		s += legacy::getHorizonHeight (checker, az[i]);
+	uint64_t tlegacy = gettime_ns () - t0;
+
+	t0 = gettime_ns ();
+	double s1 = 0;
+	for (int i = 0; i < NUM_LOOKUPS; i++)
+		s1 += checker.getHorizonHeightAz (az[i]);
+	uint64_t tlut = gettime_ns () - t0;
+
+	t0 = gettime_ns ();
+	checker.getHorizonHeights (az.data (), alt.data (), NUM_LOOKUPS);
+	uint64_t tbatch = gettime_ns () - t0;
+
+	ck_assert_dbl_eq (s, s1, 1e-3);
+
+	printf ("%d lookups, 360 point horizon: list walk %.1f ms, lookup table %.1f ms, batch %.1f ms\n", NUM_LOOKUPS, tlegacy / 1e6, tlut / 1e6, tbatch / 1e6);
+}
+END_TEST
+
+Suite * horizon_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Horizon");
+	tc_core = tcase_create ("Core");
+	tcase_set_timeout (tc_core, 60);
+	tcase_add_test (tc_core, lookup);
+	tcase_add_test (tc_core, wrap);
+	tcase_add_test (tc_core, benchmark);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = horizon_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
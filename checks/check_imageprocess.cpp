@@ -0,0 +1,458 @@
+#include "rts2fits/imageprocess.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define FIELD_W       2048
+#define FIELD_H       2048
+#define FIELD_STARS   400
+#define STAR_SIGMA    1.5
+#define SKY           1000
+#define SKY_NOISE     10
+
+using namespace rts2image;
+
+double gaussrand ()
+{
+	double u1 = (rand () + 1.0) / (RAND_MAX + 2.0);
+	double u2 = (rand () + 1.0) / (RAND_MAX + 2.0);
+	return sqrt (-2 * log (u1)) * cos (2 * M_PI * u2);
+}
+
+/**
+ * Star finding as done by Image::findStar, Image::centroid and
+ * Image::classicMedian before they were replaced. Kept to benchmark new
+ * kernels against.
+ */
+namespace legacy
+{
+
+static int cmpdouble (const void *a, const void *b)
+{
+	if (*((double *) a) > *((double *) b))
+		return 1;
+	if (*((double *) a) < *((double *) b))
+		return -1;
+	return 0;
+}
+
+double classicMedian (double *q, int n, double *retsigma)
+{
+	double *f = (double *) malloc (n * sizeof (double));
+	memcpy (f, q, n * sizeof (double));
+	qsort (f, n, sizeof (double), cmpdouble);
+	double M = (n % 2) ? f[n / 2] : f[n / 2] / 2 + f[n / 2 + 1] / 2;
+	for (int i = 0; i < n; i++)
+		f[i] = fabs (f[i] - M) * 0.6745;
+	qsort (f, n, sizeof (double), cmpdouble);
+	*retsigma = (n % 2) ? f[n / 2] : f[n / 2] / 2 + f[n / 2 + 1] / 2;
+	free (f);
+	return M;
+}
+
+struct pixel
+{
+	int x;
+	int y;
+};
+
+void findStar (unsigned short *in_data, int w, int h, double median, double sigma, std::vector <pixel> &list)
+{
+	float cols_sum[3];
+	for (int r = 0; r < h - 3; r++)
+	{
+		unsigned short *row_start_ptr = in_data + r * w;
+		float sum = 0;
+		for (int i = 0; i < 2; i++)
+		{
+			unsigned short *data_ptr = row_start_ptr;
+			cols_sum[i] = 0;
+			for (int j = 0; j < 3; j++)
+			{
+				cols_sum[i] += *data_ptr;
+				data_ptr += w;
+			}
+			sum += cols_sum[i];
+			row_start_ptr++;
+		}
+		cols_sum[2] = 0;
+		for (int c = 2; c < w; c++)
+		{
+			unsigned short *data_ptr = row_start_ptr;
+			sum -= cols_sum[c % 3];
+			cols_sum[c % 3] = 0;
+			for (int j = 0; j < 3; j++)
+			{
+				cols_sum[c % 3] += *data_ptr;
+				data_ptr += w;
+			}
+			sum += cols_sum[c % 3];
+			if (sum / 9.0 > median + 10 * sigma)
+			{
+				bool sedi = false;
+				for (std::vector <pixel>::iterator iter = list.begin (); iter != list.end (); iter++)
+				{
+					if (fabs ((double) (c - iter->x)) < 10 || fabs ((double) (r - iter->y)) < 10)
+						sedi = true;
+				}
+				if (!sedi)
+				{
+					pixel p = {c, r};
+					list.push_back (p);
+				}
+			}
+			row_start_ptr++;
+		}
+	}
+}
+
+void centroid (unsigned short *in_data, int w, double median, double sigma, pixel pix, float *px, float *py)
+{
+	float cmean, total, subtotal;
+	int i, j;
+	for (cmean = 0.0, total = 0.0, i = pix.x - 3; i < pix.x + 4; i++)
+	{
+		for (subtotal = 0.0, j = pix.y - 3; j < pix.y + 4; j++)
+		{
+			if (in_data[i + w * j] > median + 6 * sigma)
+				subtotal += in_data[i + w * j];
+		}
+		total += subtotal;
+		cmean += (i * subtotal);
+	}
+	*px = cmean / total;
+	for (cmean = 0.0, total = 0.0, j = pix.y - 3; j < pix.y + 4; j++)
+	{
+		for (subtotal = 0.0, i = pix.x - 3; i < pix.x + 4; i++)
+		{
+			if (in_data[i + w * j] > median + 6 * sigma)
+				subtotal += in_data[i + w * j];
+		}
+		total += subtotal;
+		cmean += (j * subtotal);
+	}
+	*py = cmean / total;
+}
+
+}
+
+struct truestar
+{
+	double x, y, peak;
+};
+
+/**
+ * Simulated field - sky with noise and well separated Gaussian stars.
+ */
+void makeField (int w, int h, int nstars, std::vector <float> &img, std::vector <truestar> &truth)
+{
+	srand (42);
+	img.resize ((size_t) w * h);
+	for (size_t i = 0; i < img.size (); i++)
+		img[i] = SKY + SKY_NOISE * gaussrand ();
+	truth.clear ();
+	while ((int) truth.size () < nstars)
+	{
+		truestar s;
+		s.x = 20 + (w - 40) * (rand () / (RAND_MAX + 1.0));
+		s.y = 20 + (h - 40) * (rand () / (RAND_MAX + 1.0));
+		s.peak = 300 + 5000 * (rand () / (RAND_MAX + 1.0));
+		bool close = false;
+		for (std::vector <truestar>::iterator iter = truth.begin (); iter != truth.end (); iter++)
+			if (fabs (iter->x - s.x) < 25 && fabs (iter->y - s.y) < 25)
+				close = true;
+		if (close)
+			continue;
+		truth.push_back (s);
+		for (int y = (int) s.y - 10; y <= (int) s.y + 10; y++)
+			for (int x = (int) s.x - 10; x <= (int) s.x + 10; x++)
+				img[(size_t) y * w + x] += s.peak * exp (-((x - s.x) * (x - s.x) + (y - s.y) * (y - s.y)) / (2 * STAR_SIGMA * STAR_SIGMA));
+	}
+	// integer detector
+	for (size_t i = 0; i < img.size (); i++)
+		img[i] = roundf (img[i]);
+}
+
+// returns index of the true star closest to given position, -1 if none is within 2 pixels
+int matchStar (const std::vector <truestar> &truth, double x, double y)
+{
+	for (size_t i = 0; i < truth.size (); i++)
+		if (fabs (truth[i].x - x) < 2 && fabs (truth[i].y - y) < 2)
+			return i;
+	return -1;
+}
+
+bool sameStar (const stardata &a, const stardata &b)
+{
+	return a.X == b.X && a.Y == b.Y && a.F == b.F && a.Fe == b.Fe && a.fwhm == b.fwhm && a.flags == b.flags;
+}
+
+START_TEST(median)
+{
+	srand (1);
+	for (int n = 1; n < 200; n++)
+	{
+		std::vector <float> v (n);
+		for (int i = 0; i < n; i++)
+			v[i] = rand () % 50;
+		std::vector <float> s (v);
+		std::sort (s.begin (), s.end ());
+		float m = (n % 2) ? s[n / 2] : (s[n / 2 - 1] + s[n / 2]) / 2;
+		ck_assert_dbl_eq (selectMedian (v.data (), n), m, 1e-6);
+	}
+
+	// sigma clipping removes outliers
+	std::vector <float> v (100000);
+	for (size_t i = 0; i < v.size (); i++)
+		v[i] = (i % 20 == 0) ? 30000 : SKY + SKY_NOISE * gaussrand ();
+	float m, s;
+	sigmaClip (v.data (), v.size (), 3, 5, m, s);
+	ck_assert_dbl_eq (m, SKY, 0.3);
+	ck_assert_dbl_eq (s, SKY_NOISE, 0.3);
+
+	// zero median absolute deviation
+	std::vector <float> c (1000, 5);
+	c[0] = 6;
+	c[1] = 4;
+	sigmaClip (c.data (), c.size (), 3, 5, m, s);
+	ck_assert_dbl_eq (m, 5, 1e-6);
+	ck_assert (s > 0);
+}
+END_TEST
+
+START_TEST(convolve)
+{
+	int w = 37, h = 23;
+	std::vector <float> img (w * h), out (w * h);
+	for (int i = 0; i < w * h; i++)
+		img[i] = rand () % 1000;
+	std::vector <float> kernel;
+	gaussianKernel (3, kernel);
+	ck_assert_int_eq (kernel.size () % 2, 1);
+	int r = kernel.size () / 2;
+
+	convolveSeparable (img.data (), out.data (), w, h, kernel);
+
+	// direct 2D convolution, edges extended
+	for (int y = 0; y < h; y++)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			double s = 0;
+			for (int j = -r; j <= r; j++)
+				for (int i = -r; i <= r; i++)
+					s += kernel[i + r] * kernel[j + r] * img[std::min (std::max (y + j, 0), h - 1) * w + std::min (std::max (x + i, 0), w - 1)];
+			ck_assert_dbl_eq (out[y * w + x], s, 1e-2);
+		}
+	}
+
+	// image narrower than kernel
+	std::vector <float> narrow (3 * 5, 7), nout (3 * 5);
+	convolveSeparable (narrow.data (), nout.data (), 3, 5, kernel);
+	for (int i = 0; i < 15; i++)
+		ck_assert_dbl_eq (nout[i], 7, 1e-4);
+}
+END_TEST
+
+START_TEST(label)
+{
+	const char *pattern[] = {
+		"X.X....XX.",
+		"X.X.....X.",
+		"XXX..X....",
+		".....X..X.",
+		"..X.....X.",
+		"...X...X..",
+		"X...XXX..X"
+	};
+	int w = 10, h = 7;
+	std::vector <float> img (w * h);
+	for (int y = 0; y < h; y++)
+		for (int x = 0; x < w; x++)
+			img[y * w + x] = pattern[y][x] == 'X' ? 10 : 0;
+	std::vector <int> labels (w * h);
+	// U shape is a single component, diagonals are connected
+	ck_assert_int_eq (labelComponents (img.data (), w, h, 5, labels.data ()), 6);
+	ck_assert_int_eq (labels[0], 1);
+	ck_assert_int_eq (labels[2], 1);
+	ck_assert_int_eq (labels[2 * w + 1], 1);
+	ck_assert_int_eq (labels[7], 2);
+	ck_assert_int_eq (labels[1 * w + 8], 2);
+	ck_assert_int_eq (labels[2 * w + 5], 3);
+	ck_assert_int_eq (labels[3 * w + 5], 3);
+	// V shape, two components merged on the last line
+	ck_assert_int_eq (labels[3 * w + 8], 4);
+	ck_assert_int_eq (labels[4 * w + 2], 4);
+	ck_assert_int_eq (labels[6 * w + 4], 4);
+	ck_assert_int_eq (labels[6 * w + 6], 4);
+	ck_assert_int_eq (labels[6 * w], 5);
+	ck_assert_int_eq (labels[6 * w + 9], 6);
+	ck_assert_int_eq (labels[6 * w + 1], 0);
+}
+END_TEST
+
+START_TEST(centroid)
+{
+	int w = 41, h = 41;
+	std::vector <float> img (w * h);
+	for (double ox = 0; ox < 1; ox += 0.13)
+	{
+		double sx = 20 + ox, sy = 20.4 - ox;
+		for (int y = 0; y < h; y++)
+			for (int x = 0; x < w; x++)
+				img[y * w + x] = 100 + 1000 * exp (-((x - sx) * (x - sx) + (y - sy) * (y - sy)) / (2 * STAR_SIGMA * STAR_SIGMA));
+		double cx = 20, cy = 20;
+		ck_assert (gaussianCentroid (img.data (), w, h, 100, cx, cy, STAR_SIGMA * 2.35482));
+		ck_assert_dbl_eq (cx, sx, 1e-3);
+		ck_assert_dbl_eq (cy, sy, 1e-3);
+	}
+
+	// empty image
+	std::fill (img.begin (), img.end (), 100);
+	double cx = 20, cy = 20;
+	ck_assert (gaussianCentroid (img.data (), w, h, 100, cx, cy, 3) == false);
+	ck_assert_dbl_eq (cx, 20, 1e-9);
+}
+END_TEST
+
+START_TEST(findstars)
+{
+	std::vector <float> img;
+	std::vector <truestar> truth;
+	makeField (FIELD_W, FIELD_H, FIELD_STARS, img, truth);
+
+	size_t n = img.size ();
+	std::vector <uint16_t> u16 (n);
+	std::vector <int32_t> i32 (n);
+	std::vector <double> f64 (n);
+	for (size_t i = 0; i < n; i++)
+	{
+		u16[i] = img[i];
+		i32[i] = img[i];
+		f64[i] = img[i];
+	}
+
+	StarFindParams params;
+	params.fwhm = STAR_SIGMA * 2.35482;
+
+	std::vector <stardata> stars;
+	float m, s;
+	uint64_t t0 = gettime_ns ();
+	findStars (u16.data (), FIELD_W, FIELD_H, stars, params, &m, &s);
+	uint64_t tnew = gettime_ns () - t0;
+
+	ck_assert_dbl_eq (m, SKY, 0.5);
+	ck_assert_dbl_eq (s, SKY_NOISE, 0.5);
+
+	// all stars found, none spurious
+	ck_assert_int_eq (stars.size (), FIELD_STARS);
+	double err2 = 0, fwhm = 0;
+	std::vector <bool> found (truth.size (), false);
+	for (std::vector <stardata>::iterator iter = stars.begin (); iter != stars.end (); iter++)
+	{
+		int t = matchStar (truth, iter->X, iter->Y);
+		ck_assert_msg (t >= 0, "spurious star at %.2f %.2f", iter->X, iter->Y);
+		ck_assert (found[t] == false);
+		found[t] = true;
+		ck_assert_int_eq (iter->flags, 0);
+		err2 += (iter->X - truth[t].x) * (iter->X - truth[t].x) + (iter->Y - truth[t].y) * (iter->Y - truth[t].y);
+		fwhm += iter->fwhm;
+		if (iter != stars.begin ())
+			ck_assert ((iter - 1)->F >= iter->F);
+	}
+	double rms = sqrt (err2 / stars.size ());
+	fwhm /= stars.size ();
+	ck_assert_msg (rms < 0.05, "centroid rms error %f", rms);
+	ck_assert_dbl_eq (fwhm, STAR_SIGMA * 2.35482, 0.4);
+
+	// all data types give the same results
+	std::vector <stardata> st32, st64, stf;
+	findStars (i32.data (), FIELD_W, FIELD_H, st32, params);
+	findStars (f64.data (), FIELD_W, FIELD_H, st64, params);
+	findStars ((const float *) img.data (), FIELD_W, FIELD_H, stf, params);
+	ck_assert_int_eq (st32.size (), stars.size ());
+	ck_assert_int_eq (st64.size (), stars.size ());
+	ck_assert_int_eq (stf.size (), stars.size ());
+	for (size_t i = 0; i < stars.size (); i++)
+	{
+		ck_assert (sameStar (stars[i], st32[i]));
+		ck_assert (sameStar (stars[i], st64[i]));
+		ck_assert (sameStar (stars[i], stf[i]));
+	}
+
+	// benchmark against the replaced routines
+	t0 = gettime_ns ();
+	std::vector <double> dimg (img.begin (), img.end ());
+	double lmedian, lsigma;
+	lmedian = legacy::classicMedian (dimg.data (), n, &lsigma);
+	uint64_t tlmedian = gettime_ns () - t0;
+
+	std::vector <legacy::pixel> list;
+	legacy::findStar (u16.data (), FIELD_W, FIELD_H, lmedian, lsigma, list);
+	double lerr2 = 0;
+	int lmatched = 0;
+	for (std::vector <legacy::pixel>::iterator iter = list.begin (); iter != list.end (); iter++)
+	{
+		if (iter->x < 4 || iter->y < 4 || iter->x >= FIELD_W - 4 || iter->y >= FIELD_H - 4)
+			continue;
+		float px, py;
+		legacy::centroid (u16.data (), FIELD_W, lmedian, lsigma, *iter, &px, &py);
+		int t = matchStar (truth, px, py);
+		if (t < 0)
+			continue;
+		lmatched++;
+		lerr2 += (px - truth[t].x) * (px - truth[t].x) + (py - truth[t].y) * (py - truth[t].y);
+	}
+	uint64_t tlegacy = gettime_ns () - t0;
+
+	t0 = gettime_ns ();
+	std::vector <float> buf (img);
+	selectMedian (buf.data (), n);
+	uint64_t tselect = gettime_ns () - t0;
+
+	printf ("%dx%d median: qsort %.1f ms, selection %.1f ms\n", FIELD_W, FIELD_H, tlmedian / 1e6, tselect / 1e6);
+	printf ("%d stars: legacy %.1f ms, %lu stars, %d matched, rms %.3f px\n", FIELD_STARS, tlegacy / 1e6, list.size (), lmatched, lmatched ? sqrt (lerr2 / lmatched) : NAN);
+	printf ("%d stars: new %.1f ms, %lu stars, rms %.3f px, fwhm %.2f px\n", FIELD_STARS, tnew / 1e6, stars.size (), rms, fwhm);
+}
+END_TEST
+
+Suite * imageprocess_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("ImageProcess");
+	tc_core = tcase_create ("Core");
+	tcase_set_timeout (tc_core, 120);
+	tcase_add_test (tc_core, median);
+	tcase_add_test (tc_core, convolve);
+	tcase_add_test (tc_core, label);
+	tcase_add_test (tc_core, centroid);
+	tcase_add_test (tc_core, findstars);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = imageprocess_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,223 @@
+#include "app.h"
+#include "value.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sstream>
+#include <vector>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define NUM_THREADS    4
+#define NUM_THREAD_MSG 1000
+#define NUM_BENCHMARK  200000
+
+class LogApp:public rts2core::App
+{
+	public:
+		LogApp (int argc, char **argv):rts2core::App (argc, argv) {}
+
+		virtual int run () { return 0; }
+
+		virtual void sendMessage (messageType_t in_messageType, const char *in_messageString)
+		{
+			types.push_back (in_messageType);
+			msgs.push_back (std::string (in_messageString));
+		}
+
+		std::vector <messageType_t> types;
+		std::vector <std::string> msgs;
+};
+
+LogApp *app;
+
+void setup_app (void)
+{
+	const char *argv[] = {"check_logstream"};
+	app = new LogApp (1, (char **) argv);
+	rts2core::setLogLevels (MESSAGE_MASK_ALL);
+}
+
+void teardown_app (void)
+{
+	delete app;
+	app = NULL;
+}
+
+START_TEST(levels)
+{
+	ck_assert_int_eq (rts2core::parseLogLevels ("ewic"), MESSAGE_ERROR | MESSAGE_WARNING | MESSAGE_INFO | MESSAGE_CRITICAL);
+	ck_assert_int_eq (rts2core::parseLogLevels ("d"), MESSAGE_DEBUG);
+	ck_assert_int_eq (rts2core::parseLogLevels ("ex"), -1);
+
+	ck_assert (rts2core::logEnabled (MESSAGE_DEBUG));
+	rts2core::setLogLevels (rts2core::parseLogLevels ("ewic"));
+	ck_assert (!rts2core::logEnabled (MESSAGE_DEBUG));
+	ck_assert (!rts2core::logEnabled (MESSAGE_DEBUG | 0x000100));
+	ck_assert (rts2core::logEnabled (MESSAGE_ERROR));
+
+	logStream (MESSAGE_DEBUG) << "debug " << 1 << sendLog;
+	logStream (MESSAGE_INFO) << "info " << 2 << sendLog;
+	int evaluated = 0;
+	LOG_IF (MESSAGE_DEBUG) << "debug " << ++evaluated << sendLog;
+	LOG_IF (MESSAGE_ERROR) << "error " << ++evaluated << sendLog;
+
+	ck_assert_int_eq (app->msgs.size (), 2);
+	ck_assert_str_eq (app->msgs[0].c_str (), "info 2");
+	ck_assert_str_eq (app->msgs[1].c_str (), "error 1");
+	ck_assert_int_eq (evaluated, 1);
+}
+END_TEST
+
+START_TEST(fields)
+{
+	rts2core::ValueDouble temp ("temperature", "test", false);
+	temp.setValueDouble (12.5);
+
+	int called = 0;
+	logStream (MESSAGE_INFO) << "move" << rts2core::logField ("ra", 10.5) << rts2core::logField ("device", "T0") << rts2core::logLazy ("n", [&] { return ++called; }) << rts2core::logValue (&temp) << sendLog;
+	ck_assert_int_eq (app->msgs.size (), 1);
+	ck_assert_str_eq (app->msgs[0].c_str (), "move ra=10.500000 device=T0 n=1 temperature=12.5");
+
+	rts2core::setLogLevels (MESSAGE_ERROR);
+	logStream (MESSAGE_DEBUG) << "move" << rts2core::logLazy ("n", [&] { return ++called; }) << sendLog;
+	ck_assert_int_eq (called, 1);
+	ck_assert_int_eq (app->msgs.size (), 1);
+
+	// formatting does not leak between streams sharing the thread buffer
+	rts2core::setLogLevels (MESSAGE_MASK_ALL);
+	logStream (MESSAGE_INFO) << std::hex << 255 << sendLog;
+	logStream (MESSAGE_INFO) << 255 << " " << 1.5 << sendLog;
+	ck_assert_str_eq (app->msgs[1].c_str (), "ff");
+	ck_assert_str_eq (app->msgs[2].c_str (), "255 1.500000");
+}
+END_TEST
+
+void *logThread (void *arg)
+{
+	long n = (long) arg;
+	for (int i = 0; i < NUM_THREAD_MSG; i++)
+		logStream (MESSAGE_INFO) << n << " " << i << sendLog;
+	return NULL;
+}
+
+START_TEST(threads)
+{
+	int fd = rts2core::initThreadLogs ();
+	ck_assert (fd >= 0);
+
+	pthread_t th[NUM_THREADS];
+	for (long i = 0; i < NUM_THREADS; i++)
+		ck_assert_int_eq (pthread_create (th + i, NULL, logThread, (void *) i), 0);
+	for (int i = 0; i < NUM_THREADS; i++)
+		pthread_join (th[i], NULL);
+
+	// nothing is send from worker threads
+	ck_assert_int_eq (app->msgs.size (), 0);
+
+	struct pollfd pfd;
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	ck_assert_int_eq (poll (&pfd, 1, 0), 1);
+
+	rts2core::sendThreadLogs ();
+	ck_assert_int_eq (app->msgs.size (), NUM_THREADS * NUM_THREAD_MSG);
+	ck_assert_int_eq (poll (&pfd, 1, 0), 0);
+
+	// messages from each thread are in order
+	int last[NUM_THREADS];
+	for (int i = 0; i < NUM_THREADS; i++)
+		last[i] = -1;
+	for (std::vector <std::string>::iterator iter = app->msgs.begin (); iter != app->msgs.end (); iter++)
+	{
+		int n, i;
+		ck_assert_int_eq (sscanf (iter->c_str (), "%d %d", &n, &i), 2);
+		ck_assert_int_eq (i, last[n] + 1);
+		last[n] = i;
+	}
+
+	// main thread sends directly
+	logStream (MESSAGE_INFO) << "main" << sendLog;
+	ck_assert_int_eq (app->msgs.size (), NUM_THREADS * NUM_THREAD_MSG + 1);
+}
+END_TEST
+
+START_TEST(benchmark)
+{
+	double ra = 123.456789;
+	double dec = -12.345678;
+	rts2core::setLogLevels (rts2core::parseLogLevels ("ewic"));
+
+	// message formatted and dropped by the application, as before
+	uint64_t t0 = gettime_ns ();
+	for (int i = 0; i < NUM_BENCHMARK; i++)
+	{
+		std::ostringstream os;
+		os.setf (std::ios_base::fixed, std::ios_base::floatfield);
+		os.precision (6);
+		os << "tracking " << ra + i << " " << dec << " " << i;
+		if (rts2core::logEnabled (MESSAGE_DEBUG))
+			app->sendMessage (MESSAGE_DEBUG, os.str ().c_str ());
+	}
+	uint64_t told = gettime_ns () - t0;
+
+	t0 = gettime_ns ();
+	for (int i = 0; i < NUM_BENCHMARK; i++)
+		logStream (MESSAGE_DEBUG) << "tracking " << ra + i << " " << dec << " " << i << sendLog;
+	uint64_t tdisabled = gettime_ns () - t0;
+
+	t0 = gettime_ns ();
+	for (int i = 0; i < NUM_BENCHMARK; i++)
+		LOG_IF (MESSAGE_DEBUG) << "tracking " << ra + i << " " << dec << " " << i << sendLog;
+	uint64_t tlogif = gettime_ns () - t0;
+
+	ck_assert_int_eq (app->msgs.size (), 0);
+
+	rts2core::setLogLevels (MESSAGE_MASK_ALL);
+	t0 = gettime_ns ();
+	for (int i = 0; i < NUM_BENCHMARK; i++)
+		logStream (MESSAGE_DEBUG) << "tracking " << ra + i << " " << dec << " " << i << sendLog;
+	uint64_t tenabled = gettime_ns () - t0;
+
+	ck_assert_int_eq (app->msgs.size (), NUM_BENCHMARK);
+
+	printf ("%d debug messages: formatted and dropped %.1f ns, disabled logStream %.1f ns, disabled LOG_IF %.1f ns, enabled %.1f ns per message\n", NUM_BENCHMARK, (double) told / NUM_BENCHMARK, (double) tdisabled / NUM_BENCHMARK, (double) tlogif / NUM_BENCHMARK, (double) tenabled / NUM_BENCHMARK);
+}
+END_TEST
+
+Suite * logstream_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Log stream");
+	tc_core = tcase_create ("Core");
+	tcase_add_checked_fixture (tc_core, setup_app, teardown_app);
+	tcase_set_timeout (tc_core, 60);
+	tcase_add_test (tc_core, levels);
+	tcase_add_test (tc_core, fields);
+	tcase_add_test (tc_core, threads);
+	tcase_add_test (tc_core, benchmark);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = logstream_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,306 @@
+#include "messagelog.h"
+#include "messagejournal.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fstream>
+#include <sys/stat.h>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define NUM_BENCHMARK   100000
+
+char tmpdir[50];
+std::string journalPath;
+std::string logPath;
+
+void setup_dir (void)
+{
+	strcpy (tmpdir, "/tmp/rts2-check-messagelog-XXXXXX");
+	ck_assert (mkdtemp (tmpdir) != NULL);
+	journalPath = std::string (tmpdir) + "/journal";
+	logPath = std::string (tmpdir) + "/log";
+}
+
+void teardown_dir (void)
+{
+	std::string cmd = std::string ("rm -rf ") + tmpdir;
+	ck_assert_int_eq (system (cmd.c_str ()), 0);
+}
+
+// adds messages from three devices, every 10th is an error
+void addMessages (rts2core::MessageJournal &journal, int num)
+{
+	for (int i = 0; i < num; i++)
+	{
+		char dev[10];
+		char text[50];
+		snprintf (dev, sizeof (dev), "dev%d", i % 3);
+		snprintf (text, sizeof (text), "message %d", i);
+		rts2core::Message msg (1000.0 + i, dev, i % 10 == 0 ? MESSAGE_ERROR : MESSAGE_DEBUG, text);
+		journal.add (msg);
+	}
+}
+
+int countLines (const std::string &fn)
+{
+	std::ifstream is (fn.c_str ());
+	std::string line;
+	int ret = 0;
+	while (std::getline (is, line))
+		ret++;
+	return ret;
+}
+
+bool exists (const std::string &fn)
+{
+	struct stat st;
+	return stat (fn.c_str (), &st) == 0;
+}
+
+START_TEST(journal_query)
+{
+	rts2core::MessageJournal writer;
+	ck_assert_int_eq (writer.create (journalPath.c_str (), 1000), 0);
+	addMessages (writer, 300);
+
+	rts2core::MessageJournal reader;
+	ck_assert_int_eq (reader.open (journalPath.c_str ()), 0);
+	ck_assert_int_eq (reader.getWriteSeq (), 300);
+
+	std::vector <rts2core::Message> msgs;
+	ck_assert_int_eq (reader.query (0, 2000, MESSAGE_MASK_ALL, NULL, msgs), 300);
+	ck_assert (msgs[0].getMessageTime () == 1000);
+	ck_assert_str_eq (msgs[0].getMessageOName (), "dev0");
+	ck_assert_str_eq (msgs[299].getMessageString ().c_str (), "message 299");
+
+	msgs.clear ();
+	ck_assert_int_eq (reader.query (0, 2000, MESSAGE_ERROR, NULL, msgs), 30);
+	ck_assert (msgs[1].getMessageTime () == 1010);
+	ck_assert_int_eq (msgs[1].getType (), MESSAGE_ERROR);
+
+	msgs.clear ();
+	ck_assert_int_eq (reader.query (0, 2000, MESSAGE_MASK_ALL, "dev1", msgs), 100);
+	ck_assert (msgs[0].getMessageTime () == 1001);
+	ck_assert (msgs[99].getMessageTime () == 1298);
+
+	msgs.clear ();
+	ck_assert_int_eq (reader.query (0, 2000, MESSAGE_ERROR, "dev1", msgs), 10);
+	ck_assert (msgs[0].getMessageTime () == 1010);
+	ck_assert (msgs[1].getMessageTime () == 1040);
+
+	msgs.clear ();
+	ck_assert_int_eq (reader.query (1100, 1149, MESSAGE_MASK_ALL, "", msgs), 50);
+	ck_assert (msgs[0].getMessageTime () == 1100);
+	ck_assert (msgs[49].getMessageTime () == 1149);
+
+	// newest messages are returned
+	msgs.clear ();
+	ck_assert_int_eq (reader.query (0, 2000, MESSAGE_MASK_ALL, NULL, msgs, 5), 5);
+	ck_assert (msgs[0].getMessageTime () == 1295);
+	ck_assert (msgs[4].getMessageTime () == 1299);
+
+	msgs.clear ();
+	ck_assert_int_eq (reader.query (0, 2000, MESSAGE_ERROR | MESSAGE_DEBUG, NULL, msgs, 3), 3);
+	ck_assert (msgs[2].getMessageTime () == 1299);
+
+	msgs.clear ();
+	ck_assert_int_eq (reader.query (0, 2000, MESSAGE_MASK_ALL, "unknown", msgs), 0);
+	ck_assert_int_eq (reader.query (0, 2000, MESSAGE_WARNING, NULL, msgs), 0);
+}
+END_TEST
+
+START_TEST(journal_wrap)
+{
+	rts2core::MessageJournal writer;
+	ck_assert_int_eq (writer.create (journalPath.c_str (), 100), 0);
+	addMessages (writer, 250);
+
+	std::vector <rts2core::Message> msgs;
+	ck_assert_int_eq (writer.query (0, 2000, MESSAGE_MASK_ALL, NULL, msgs), 100);
+	ck_assert (msgs[0].getMessageTime () == 1150);
+
+	msgs.clear ();
+	ck_assert_int_eq (writer.query (0, 2000, MESSAGE_ERROR, NULL, msgs), 10);
+	ck_assert (msgs[0].getMessageTime () == 1150);
+
+	msgs.clear ();
+	ck_assert_int_eq (writer.query (0, 2000, MESSAGE_MASK_ALL, "dev2", msgs), 33);
+
+	// writer continues in existing journal
+	writer.close ();
+	ck_assert_int_eq (writer.create (journalPath.c_str (), 100), 0);
+	ck_assert_int_eq (writer.getWriteSeq (), 250);
+	rts2core::Message msg (500, "dev0", MESSAGE_ERROR, "out of order");
+	writer.add (msg);
+	msgs.clear ();
+	ck_assert_int_eq (writer.query (1249, 2000, MESSAGE_ERROR, "dev0", msgs), 1);
+	ck_assert_str_eq (msgs[0].getMessageString ().c_str (), "out of order");
+
+	// different size creates new journal, reader keeps the old one until it is reopened
+	rts2core::MessageJournal reader;
+	ck_assert_int_eq (reader.open (journalPath.c_str ()), 0);
+	ck_assert (!reader.isReplaced ());
+
+	writer.close ();
+	ck_assert_int_eq (writer.create (journalPath.c_str (), 200), 0);
+	ck_assert_int_eq (writer.getWriteSeq (), 0);
+	addMessages (writer, 250);
+
+	ck_assert (reader.isReplaced ());
+	msgs.clear ();
+	ck_assert_int_eq (reader.query (0, 2000, MESSAGE_MASK_ALL, NULL, msgs), 100);
+
+	ck_assert_int_eq (reader.open (journalPath.c_str ()), 0);
+	ck_assert (!reader.isReplaced ());
+	ck_assert_int_eq (reader.getRecords (), 200);
+	msgs.clear ();
+	ck_assert_int_eq (reader.query (0, 2000, MESSAGE_MASK_ALL, NULL, msgs), 200);
+}
+END_TEST
+
+START_TEST(log_rotate)
+{
+	rts2core::MessageLog log;
+	log.setRotation (2000, 0, 2, false);
+	ck_assert_int_eq (log.open (logPath.c_str ()), 0);
+
+	for (int i = 0; i < 200; i++)
+	{
+		char text[50];
+		snprintf (text, sizeof (text), "message %d", i);
+		rts2core::Message msg (1000.0 + i, "dev", MESSAGE_INFO, text);
+		log.log (msg);
+		// let writer process messages in smaller blocks
+		if (i % 20 == 19)
+			log.flush ();
+	}
+	log.close ();
+
+	ck_assert (exists (logPath));
+	ck_assert (exists (logPath + ".1"));
+	ck_assert (exists (logPath + ".2"));
+	ck_assert (!exists (logPath + ".3"));
+
+	std::ifstream is ((logPath + ".1").c_str ());
+	std::string line;
+	ck_assert (std::getline (is, line));
+	ck_assert (line.find (" dev 4 message ") != std::string::npos);
+}
+END_TEST
+
+START_TEST(log_all)
+{
+	rts2core::MessageLog log;
+	ck_assert_int_eq (log.open (logPath.c_str ()), 0);
+	for (int i = 0; i < 1000; i++)
+	{
+		rts2core::Message msg (1000.0 + i, "dev", MESSAGE_DEBUG, "debug message");
+		log.log (msg);
+	}
+	log.flush ();
+	ck_assert_int_eq (countLines (logPath), 1000);
+	ck_assert_int_eq (log.getDropped (), 0);
+
+	// reopen with the same name continues logging
+	ck_assert_int_eq (log.open (logPath.c_str ()), 0);
+	rts2core::Message msg (3000, "dev", MESSAGE_ERROR, "error message");
+	log.log (msg);
+	log.close ();
+	ck_assert_int_eq (countLines (logPath), 1001);
+}
+END_TEST
+
+START_TEST(benchmark)
+{
+	std::vector <rts2core::Message> msgs;
+	for (int i = 0; i < NUM_BENCHMARK; i++)
+	{
+		char text[100];
+		snprintf (text, sizeof (text), "debug message number %d from a misbehaving driver, value %f", i, i * 0.1);
+		msgs.push_back (rts2core::Message (1000.0 + i * 0.001, "C0", MESSAGE_DEBUG, text));
+	}
+
+	// synchronous logging, as was done in centrald
+	std::ofstream *fileLog = new std::ofstream ();
+	fileLog->open ((logPath + ".sync").c_str (), std::ios_base::out | std::ios_base::app);
+	uint64_t t0 = gettime_ns ();
+	for (std::vector <rts2core::Message>::iterator iter = msgs.begin (); iter != msgs.end (); iter++)
+		(*fileLog) << (*iter) << std::endl;
+	uint64_t tsync = gettime_ns () - t0;
+	fileLog->close ();
+	delete fileLog;
+
+	rts2core::MessageLog log;
+	log.setMaxQueue (NUM_BENCHMARK);
+	ck_assert_int_eq (log.open (logPath.c_str ()), 0);
+	rts2core::MessageJournal journal;
+	ck_assert_int_eq (journal.create (journalPath.c_str (), NUM_BENCHMARK), 0);
+
+	t0 = gettime_ns ();
+	for (std::vector <rts2core::Message>::iterator iter = msgs.begin (); iter != msgs.end (); iter++)
+	{
+		log.log (*iter);
+		journal.add (*iter);
+	}
+	uint64_t tasync = gettime_ns () - t0;
+	log.flush ();
+	uint64_t tflush = gettime_ns () - t0;
+	log.close ();
+
+	ck_assert_int_eq (countLines (logPath), NUM_BENCHMARK);
+
+	// query errors from a debug storm
+	rts2core::Message err (1050, "C1", MESSAGE_ERROR, "error");
+	journal.add (err);
+	std::vector <rts2core::Message> res;
+	t0 = gettime_ns ();
+	ck_assert_int_eq (journal.query (0, 2000, MESSAGE_ERROR, NULL, res), 1);
+	uint64_t tquery = gettime_ns () - t0;
+
+	printf ("%d messages: synchronous log %.0f ns, queued log and journal %.0f ns per message, all written after %.0f ns per message; error query in debug storm %.1f us\n", NUM_BENCHMARK, (double) tsync / NUM_BENCHMARK, (double) tasync / NUM_BENCHMARK, (double) tflush / NUM_BENCHMARK, tquery / 1000.0);
+}
+END_TEST
+
+Suite * messagelog_suite (void)
+{
+	Suite *s;
+	TCase *tc_journal;
+	TCase *tc_log;
+
+	s = suite_create ("Message log");
+	tc_journal = tcase_create ("Message journal");
+	tcase_add_checked_fixture (tc_journal, setup_dir, teardown_dir);
+	tcase_add_test (tc_journal, journal_query);
+	tcase_add_test (tc_journal, journal_wrap);
+	suite_add_tcase (s, tc_journal);
+
+	tc_log = tcase_create ("Asynchronous log");
+	tcase_add_checked_fixture (tc_log, setup_dir, teardown_dir);
+	tcase_set_timeout (tc_log, 60);
+	tcase_add_test (tc_log, log_rotate);
+	tcase_add_test (tc_log, log_all);
+	tcase_add_test (tc_log, benchmark);
+	suite_add_tcase (s, tc_log);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = messagelog_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,275 @@
+#include "numfmt.h"
+#include "valuestat.h"
+#include "valuearray.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define ROUNDTRIPS    1000000
+#define BENCH         200000
+
+// xorshift, so the test is repeatable
+uint64_t rnd_state = 88172645463325252ULL;
+
+uint64_t rnd ()
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 7;
+	rnd_state ^= rnd_state << 17;
+	return rnd_state;
+}
+
+/**
+ * Random double - either random bit pattern, or number typical for
+ * device values (coordinates, temperatures,..).
+ */
+double rndDouble (int type)
+{
+	uint64_t u = rnd ();
+	double d;
+	switch (type % 3)
+	{
+		case 0:
+			memcpy (&d, &u, sizeof (d));
+			if (isnan (d) || isinf (d))
+				d = 0;
+			return d;
+		case 1:
+			return (int64_t) (u % 72000000) / 200000.0 - 180;
+		default:
+			return ldexp ((double) (u >> 11), (int) (u % 200) - 150);
+	}
+}
+
+START_TEST(format)
+{
+	char buf[DOUBLE_BUF_LEN];
+	const struct
+	{
+		double value;
+		const char *str;
+	} tests[] = {
+		{0, "0"},
+		{-0.0, "-0"},
+		{1, "1"},
+		{17, "17"},
+		{-180, "-180"},
+		{0.1, "0.1"},
+		{0.3, "0.3"},
+		{123456.789, "123456.789"},
+		{1.5e-6, "0.0000015"},
+		{1e-7, "1e-07"},
+		{1e20, "100000000000000000000"},
+		{1e21, "1e+21"},
+		{2.5e25, "2.5e+25"},
+		{-1.25e-10, "-1.25e-10"},
+		{5e-324, "5e-324"},
+		{1.7976931348623157e308, "1.7976931348623157e+308"},
+		{NAN, "nan"},
+		{INFINITY, "inf"},
+		{-INFINITY, "-inf"},
+	};
+	for (size_t i = 0; i < sizeof (tests) / sizeof (tests[0]); i++)
+	{
+		int len = rts2core::formatDouble (buf, tests[i].value);
+		ck_assert_str_eq (buf, tests[i].str);
+		ck_assert_int_eq (len, strlen (tests[i].str));
+	}
+
+	std::string s ("x ");
+	rts2core::appendDouble (s, 2.75);
+	ck_assert_str_eq (s.c_str (), "x 2.75");
+}
+END_TEST
+
+START_TEST(roundtrip)
+{
+	char buf[DOUBLE_BUF_LEN];
+	char buf2[DOUBLE_BUF_LEN];
+	int longer = 0;
+	for (int i = 0; i < ROUNDTRIPS; i++)
+	{
+		double d = rndDouble (i);
+		int len = rts2core::formatDouble (buf, d);
+		ck_assert (len < DOUBLE_BUF_LEN);
+
+		// bit-exact with both strtod and parseDouble
+		double s = strtod (buf, NULL);
+		ck_assert_msg (memcmp (&s, &d, sizeof (d)) == 0, "%.17g printed as %s", d, buf);
+		char *end;
+		double p = rts2core::parseDouble (buf, &end);
+		ck_assert_msg (memcmp (&p, &d, sizeof (d)) == 0, "%s parsed as %.17g", buf, p);
+		ck_assert (*end == '\0');
+
+		// and the string is the same after second round
+		rts2core::formatDouble (buf2, p);
+		ck_assert_str_eq (buf, buf2);
+
+		// compare number of digits with the shortest representation
+		int shortest;
+		for (shortest = 1; shortest < 17; shortest++)
+		{
+			snprintf (buf2, DOUBLE_BUF_LEN, "%.*e", shortest - 1, d);
+			if (strtod (buf2, NULL) == d)
+				break;
+		}
+		int digits = 0;
+		for (char *c = buf; *c && *c != 'e'; c++)
+			if (*c >= '0' && *c <= '9' && (digits > 0 || *c != '0'))
+				digits++;
+		if (strchr (buf, '.') == NULL && strchr (buf, 'e') == NULL)
+			while (digits > 0 && buf[len - 1] == '0')
+			{
+				len--;
+				digits--;
+			}
+		ck_assert_msg (digits <= 17, "%s is too long", buf);
+		// Grisu2 does not use boundaries between doubles, so number which lies very close
+		// to the boundary is sometimes printed with more digits than needed
+		if (digits > shortest)
+			longer++;
+	}
+	printf ("%d of %d doubles printed with more digits than shortest\n", longer, ROUNDTRIPS);
+	ck_assert (longer < ROUNDTRIPS / 100);
+}
+END_TEST
+
+START_TEST(parse)
+{
+	const char *tests[] = {
+		"1.70000000000000000000e+01", "  -3.5e-3xyz", "1e", "1e+", "0x1p3", "nan", "-inf",
+		".5", ".", "-", "", "-0", "1.", "123456789012345678901234", "1e400", "1e-400",
+		"4.9e-324", "2.2250738585072014e-308", "9007199254740993", "1.7976931348623157e308",
+		"1e23", "123e30", "  +7", "0.000000000000000000000000000000001", "1,2", NULL
+	};
+	for (int i = 0; tests[i]; i++)
+	{
+		char *e1, *e2;
+		double a = rts2core::parseDouble (tests[i], &e1);
+		double b = strtod (tests[i], &e2);
+		ck_assert_msg (e1 == e2, "different end for %s", tests[i]);
+		ck_assert_msg ((isnan (a) && isnan (b)) || memcmp (&a, &b, sizeof (a)) == 0, "%s parsed as %.17g, strtod returns %.17g", tests[i], a, b);
+	}
+
+	// random decimal strings
+	for (int i = 0; i < ROUNDTRIPS; i++)
+	{
+		char str[60];
+		uint64_t u = rnd ();
+		snprintf (str, sizeof (str), "%s%d.%0*llue%d", (u & 1) ? "-" : "", (int) (u % 100000), (int) ((u >> 20) % 14) + 1, (unsigned long long) ((u >> 8) % 100000000000000ULL), (int) ((u >> 40) % 80) - 40);
+		double a = rts2core::parseDouble (str);
+		double b = strtod (str, NULL);
+		ck_assert_msg (memcmp (&a, &b, sizeof (a)) == 0, "%s parsed as %.17g, strtod returns %.17g", str, a, b);
+	}
+}
+END_TEST
+
+START_TEST(values)
+{
+	// protocol strings of values parse back to the same values
+	rts2core::ValueDoubleStat st ("stat", "test", false);
+	st.addValue (0.1, 10);
+	st.addValue (1e-20, 10);
+	st.addValue (-3.3333333333333335, 10);
+	st.calculate ();
+	char *end;
+	const char *p = st.getValue ();
+	double v = rts2core::parseDouble (p, &end);
+	ck_assert (v == st.getValueDouble ());
+	ck_assert_int_eq (strtol (end, &end, 10), 3);
+	ck_assert (rts2core::parseDouble (end, &end) == st.getMode ());
+	ck_assert (rts2core::parseDouble (end, &end) == st.getMin ());
+	ck_assert (rts2core::parseDouble (end, &end) == st.getMax ());
+	double stdev = rts2core::parseDouble (end, &end);
+	ck_assert ((isnan (stdev) && isnan (st.getStdev ())) || stdev == st.getStdev ());
+	ck_assert (*end == '\0');
+
+	rts2core::DoubleArray arr ("arr", "test", false);
+	arr.addValue (0.1);
+	arr.addValue (-1e30);
+	arr.addValue (1.0 / 3.0);
+	ck_assert_str_eq (arr.getValue (), "0.1 -1e+30 0.3333333333333333");
+	rts2core::DoubleArray arr2 ("arr", "test", false);
+	arr2.setValueCharArr (arr.getValue ());
+	ck_assert_int_eq (arr2.size (), 3);
+	ck_assert (arr2[2] == 1.0 / 3.0);
+}
+END_TEST
+
+START_TEST(benchmark)
+{
+	double *vals = new double[BENCH];
+	char (*strs)[DOUBLE_BUF_LEN] = new char[BENCH][DOUBLE_BUF_LEN];
+	char (*oldstrs)[40] = new char[BENCH][40];
+	for (int i = 0; i < BENCH; i++)
+		vals[i] = rndDouble (i % 2 + 1);
+
+	uint64_t t0 = gettime_ns ();
+	for (int i = 0; i < BENCH; i++)
+		snprintf (oldstrs[i], 40, "%.20le", vals[i]);
+	uint64_t t1 = gettime_ns ();
+	for (int i = 0; i < BENCH; i++)
+		rts2core::formatDouble (strs[i], vals[i]);
+	uint64_t t2 = gettime_ns ();
+
+	double sum1 = 0, sum2 = 0;
+	for (int i = 0; i < BENCH; i++)
+	{
+		double d;
+		sscanf (oldstrs[i], "%lf", &d);
+		sum1 += d;
+	}
+	uint64_t t3 = gettime_ns ();
+	for (int i = 0; i < BENCH; i++)
+		sum2 += rts2core::parseDouble (strs[i]);
+	uint64_t t4 = gettime_ns ();
+
+	printf ("format: snprintf %%.20le %.1f ns, formatDouble %.1f ns per value; parse: sscanf %.1f ns, parseDouble %.1f ns per value\n", (double) (t1 - t0) / BENCH, (double) (t2 - t1) / BENCH, (double) (t3 - t2) / BENCH, (double) (t4 - t3) / BENCH);
+	// values printed with %.20le are not shortest, sums can differ in the last bits
+	ck_assert (fabs (sum1 - sum2) <= fabs (sum1) * 1e-12);
+
+	delete[] oldstrs;
+	delete[] strs;
+	delete[] vals;
+}
+END_TEST
+
+Suite * numfmt_suite (void)
+{
+	Suite *s;
+	TCase *tc_numfmt;
+
+	s = suite_create ("Number formatting");
+	tc_numfmt = tcase_create ("Format and parse doubles");
+	tcase_set_timeout (tc_numfmt, 120);
+
+	tcase_add_test (tc_numfmt, format);
+	tcase_add_test (tc_numfmt, roundtrip);
+	tcase_add_test (tc_numfmt, parse);
+	tcase_add_test (tc_numfmt, values);
+	tcase_add_test (tc_numfmt, benchmark);
+	suite_add_tcase (s, tc_numfmt);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = numfmt_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,322 @@
+#include "block.h"
+#include "redisconn.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string>
+#include <vector>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define NUM_COMMANDS   20000
+
+/**
+ * Stand-in for redis-server. Parses RESP commands, records them and
+ * replies with +OK, or with an error to commands named ERR.
+ */
+class StandIn
+{
+	public:
+		StandIn ()
+		{
+			lsock = socket (AF_INET, SOCK_STREAM, 0);
+			int on = 1;
+			setsockopt (lsock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof (on));
+			struct sockaddr_in addr;
+			memset (&addr, 0, sizeof (addr));
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+			addr.sin_port = 0;
+			bind (lsock, (struct sockaddr *) &addr, sizeof (addr));
+			socklen_t len = sizeof (addr);
+			getsockname (lsock, (struct sockaddr *) &addr, &len);
+			port = ntohs (addr.sin_port);
+			listen (lsock, 1);
+
+			pthread_mutex_init (&lock, NULL);
+			stallUntil = 0;
+			closeRequest = false;
+			pthread_create (&thread, NULL, run, this);
+		}
+
+		~StandIn ()
+		{
+			pthread_join (thread, NULL);
+			close (lsock);
+			pthread_mutex_destroy (&lock);
+		}
+
+		int port;
+
+		size_t getCommands ()
+		{
+			pthread_mutex_lock (&lock);
+			size_t ret = commands.size ();
+			pthread_mutex_unlock (&lock);
+			return ret;
+		}
+
+		std::vector <std::string> getCommand (size_t i)
+		{
+			pthread_mutex_lock (&lock);
+			std::vector <std::string> ret = commands[i];
+			pthread_mutex_unlock (&lock);
+			return ret;
+		}
+
+		// do not read commands for given time
+		void stall (double sec) { stallUntil = gettime_ns () + sec * 1e9; }
+
+		void closeConnection () { closeRequest = true; }
+
+	private:
+		int lsock;
+		pthread_t thread;
+		pthread_mutex_t lock;
+		std::vector <std::vector <std::string> > commands;
+		volatile uint64_t stallUntil;
+		volatile bool closeRequest;
+
+		static void *run (void *arg)
+		{
+			((StandIn *) arg)->serve ();
+			return NULL;
+		}
+
+		void serve ()
+		{
+			int sock = accept (lsock, NULL, NULL);
+			std::string in;
+			char buf[65536];
+			while (!closeRequest)
+			{
+				if (gettime_ns () < stallUntil)
+				{
+					usleep (1000);
+					continue;
+				}
+				struct timeval tv = {0, 10000};
+				setsockopt (sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+				ssize_t r = read (sock, buf, sizeof (buf));
+				if (r == 0)
+					break;
+				if (r < 0)
+					continue;
+				in.append (buf, r);
+				// stall could start while waiting in read
+				if (gettime_ns () < stallUntil)
+					continue;
+				std::string out;
+				std::vector <std::string> cmd;
+				size_t used;
+				while ((used = parse (in, cmd)) > 0)
+				{
+					in.erase (0, used);
+					out += cmd[0] == "ERR" ? "-ERR unknown command\r\n" : "+OK\r\n";
+					pthread_mutex_lock (&lock);
+					commands.push_back (cmd);
+					pthread_mutex_unlock (&lock);
+				}
+				if (out.length () > 0 && write (sock, out.c_str (), out.length ()) != (ssize_t) out.length ())
+					break;
+			}
+			close (sock);
+		}
+
+		// returns number of bytes used by a complete command, 0 if command is not complete
+		size_t parse (const std::string &in, std::vector <std::string> &cmd)
+		{
+			cmd.clear ();
+			if (in.length () < 4 || in[0] != '*')
+				return 0;
+			size_t pos = in.find ("\r\n");
+			if (pos == std::string::npos)
+				return 0;
+			int n = atoi (in.c_str () + 1);
+			pos += 2;
+			for (int i = 0; i < n; i++)
+			{
+				size_t e = in.find ("\r\n", pos);
+				if (e == std::string::npos || in[pos] != '$')
+					return 0;
+				size_t l = atoi (in.c_str () + pos + 1);
+				pos = e + 2;
+				if (pos + l + 2 > in.length ())
+					return 0;
+				cmd.push_back (in.substr (pos, l));
+				pos += l + 2;
+			}
+			return pos;
+		}
+};
+
+class RedisBlock:public rts2core::Block
+{
+	public:
+		RedisBlock (int argc, char **argv):rts2core::Block (argc, argv) {}
+
+		virtual int run () { return 0; }
+
+		// run loop until condition is true or timeout expires
+		template <typename F> bool loopUntil (F condition, double timeout)
+		{
+			uint64_t end = gettime_ns () + timeout * 1e9;
+			while (!condition ())
+			{
+				if (gettime_ns () > end)
+					return false;
+				oneRunLoop ();
+			}
+			return true;
+		}
+
+	protected:
+		virtual rts2core::Connection *createClientConnection (rts2core::NetworkAddress * in_addr) { return NULL; }
+};
+
+RedisBlock *master;
+
+void setup_block (void)
+{
+	const char *argv[] = {"check_redis"};
+	master = new RedisBlock (1, (char **) argv);
+	master->setTimeout (10000);
+}
+
+void teardown_block (void)
+{
+	delete master;
+	master = NULL;
+}
+
+START_TEST(pipeline)
+{
+	StandIn server;
+	RedisConn *conn = new RedisConn (master, "127.0.0.1", server.port);
+	ck_assert_int_eq (conn->init (), 0);
+	master->addConnection (conn);
+
+	ck_assert (master->loopUntil ([&] { return conn->isConnected (); }, 5));
+
+	std::vector <std::string> cmd = {"SET", "rts2:C0:value", ""};
+	uint64_t t0 = gettime_ns ();
+	for (int i = 0; i < NUM_COMMANDS; i++)
+	{
+		cmd[2] = std::to_string (i);
+		ck_assert_int_eq (conn->command (cmd), 0);
+	}
+	uint64_t tqueue = gettime_ns () - t0;
+	ck_assert_int_eq (conn->getBacklog (), NUM_COMMANDS);
+
+	ck_assert (master->loopUntil ([&] { return conn->getBacklog () == 0; }, 10));
+	uint64_t tall = gettime_ns () - t0;
+
+	ck_assert_int_eq (server.getCommands (), NUM_COMMANDS);
+	for (int i = 0; i < NUM_COMMANDS; i += 997)
+	{
+		std::vector <std::string> c = server.getCommand (i);
+		ck_assert_int_eq (c.size (), 3);
+		ck_assert_str_eq (c[0].c_str (), "SET");
+		ck_assert_str_eq (c[2].c_str (), std::to_string (i).c_str ());
+	}
+	ck_assert_int_eq (conn->getCommands (), NUM_COMMANDS);
+
+	// errors are counted
+	ck_assert_int_eq (conn->command ({"ERR"}), 0);
+	ck_assert (master->loopUntil ([&] { return conn->getBacklog () == 0; }, 5));
+	ck_assert_int_eq (conn->getErrors (), 1);
+
+	printf ("%d pipelined commands: queued in %.1f ms, replied in %.1f ms\n", NUM_COMMANDS, tqueue / 1e6, tall / 1e6);
+
+	server.closeConnection ();
+	ck_assert (master->loopUntil ([&] { return !conn->isConnected (); }, 5));
+	ck_assert_int_eq (conn->getBacklog (), 0);
+	ck_assert_int_eq (conn->command (cmd), -1);
+}
+END_TEST
+
+START_TEST(stalled)
+{
+	StandIn server;
+	RedisConn *conn = new RedisConn (master, "127.0.0.1", server.port);
+	conn->setMaxBacklog (1000);
+	ck_assert_int_eq (conn->init (), 0);
+	master->addConnection (conn);
+	ck_assert (master->loopUntil ([&] { return conn->isConnected (); }, 5));
+
+	// server does not read commands, the loop must not block
+	server.stall (1);
+	std::string payload (1000, 'x');
+	std::vector <std::string> cmd = {"PUBLISH", "C0", payload};
+	int sent = 0;
+	uint64_t maxLoop = 0;
+	uint64_t end = gettime_ns () + 500000000;
+	while (gettime_ns () < end)
+	{
+		// postpone when backlog is full, as the proxy does
+		if (!conn->isFull ())
+		{
+			ck_assert_int_eq (conn->command (cmd), 0);
+			sent++;
+		}
+		uint64_t t0 = gettime_ns ();
+		master->oneRunLoop ();
+		uint64_t t = gettime_ns () - t0;
+		if (t > maxLoop)
+			maxLoop = t;
+	}
+	ck_assert (conn->isFull ());
+	ck_assert_int_eq (sent, 1000);
+	ck_assert_int_eq (server.getCommands (), 0);
+
+	printf ("stalled server: %d commands queued, longest loop %.1f ms\n", sent, maxLoop / 1e6);
+	// blocking write would wait until the server stops stalling, after 1 s
+	ck_assert_msg (maxLoop < 400000000, "loop blocked for %.1f ms", maxLoop / 1e6);
+
+	ck_assert (master->loopUntil ([&] { return conn->getBacklog () == 0; }, 10));
+	ck_assert_int_eq (server.getCommands (), 1000);
+
+	server.closeConnection ();
+	ck_assert (master->loopUntil ([&] { return !conn->isConnected (); }, 5));
+}
+END_TEST
+
+Suite * redis_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Redis");
+	tc_core = tcase_create ("Core");
+	tcase_add_checked_fixture (tc_core, setup_block, teardown_block);
+	tcase_set_timeout (tc_core, 60);
+	tcase_add_test (tc_core, pipeline);
+	tcase_add_test (tc_core, stalled);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = redis_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
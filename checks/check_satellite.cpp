@@ -0,0 +1,331 @@
+#include "pluto/satengine.h"
+#include "pluto/observe.h"
+#include "objectcheck.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <math.h>
+#include <libnova/libnova.h>
+#include <vector>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define NUM_PROPAGATIONS    100000
+
+const char *iss1 = "1 25544U 98067A   16128.85424799  .00005564  00000-0  90091-4 0  9999";
+const char *iss2 = "2 25544  51.6438 259.2325 0002021  92.7504  10.7493 15.54477273998701";
+
+const char *xmm1 = "1 25989U 99066A   16126.72024749 -.00000083  00000-0  00000+0 0  9995";
+const char *xmm2 = "2 25989  67.4812  25.2476 8203967  94.8547 359.5975  0.50170988 18843";
+
+const char *pluto1 = "1 25544U 98067A   02256.70033192  .00045618  00000-0  57184-3 0  1499";
+const char *pluto2 = "2 25544  51.6396 328.6851 0018421 253.2171 244.7656 15.59086742217834";
+
+/**
+ * Satellite position calculation as done by TLETarget and Telescope
+ * before SatelliteEngine, with model initialization on every call.
+ */
+namespace legacy
+{
+
+int parseTLE (const char *l1, const char *l2, tle_t &tle)
+{
+	parse_elements (l1, l2, &tle);
+
+	int ephem = 1;
+	int is_deep = select_ephemeris (&tle);
+	if (is_deep && (ephem == 1 || ephem == 2))
+		ephem += 2;
+	if (!is_deep && (ephem == 3 || ephem == 4))
+		ephem -= 2;
+	return ephem;
+}
+
+void getPosition (tle_t &tle, int ephem, double JD, double lng, double lat, double altitude, double &ra, double &dec, double &dist)
+{
+	double sat_params[N_SAT_PARAMS], observer_loc[3], sat_pos[3];
+	double r_c, r_s;
+
+	lat_alt_to_parallax (lat * M_PI / 180.0, altitude, &r_c, &r_s);
+	observer_cartesian_coords (JD, lng * M_PI / 180.0, r_c, r_s, observer_loc);
+
+	double t_since = (JD - tle.epoch) * 1440.;
+	switch (ephem)
+	{
+		case 1:
+			SGP4_init (sat_params, &tle);
+			SGP4 (t_since, &tle, sat_params, sat_pos, NULL);
+			break;
+		case 3:
+			SDP4_init (sat_params, &tle);
+			SDP4 (t_since, &tle, sat_params, sat_pos, NULL);
+			break;
+		default:
+			ck_abort_msg ("invalid ephem value: %d", ephem);
+	}
+
+	get_satellite_ra_dec_delta (observer_loc, sat_pos, &ra, &dec, &dist);
+}
+
+}
+
+double getJD (int hours, int minutes, int seconds)
+{
+	struct ln_date test_t;
+	test_t.years = 2016;
+	test_t.months = 5;
+	test_t.days = 10;
+	test_t.hours = hours;
+	test_t.minutes = minutes;
+	test_t.seconds = seconds;
+	return ln_get_julian_day (&test_t);
+}
+
+void checkAltAz (rts2pluto::SatelliteEngine &engine, double JD, double alt, double az)
+{
+	double a, z;
+	engine.getAltAz (JD, a, z);
+	ck_assert_dbl_eq (a, alt, 0.5);
+	ck_assert_dbl_eq (z, az, 0.5);
+}
+
+START_TEST(position)
+{
+	const char *tles[3][2] = {{iss1, iss2}, {xmm1, xmm2}, {pluto1, pluto2}};
+
+	srand (3);
+	for (int i = 0; i < 3; i++)
+	{
+		rts2pluto::SatelliteEngine engine;
+		ck_assert_int_eq (engine.setTLE (tles[i][0], tles[i][1]), 0);
+		engine.setObserver (-4.4643, 40.4610, 791);
+
+		tle_t tle;
+		int ephem = legacy::parseTLE (tles[i][0], tles[i][1], tle);
+
+		for (int j = 0; j < 1000; j++)
+		{
+			double JD = engine.getTLE ()->epoch + 6.0 * rand () / RAND_MAX - 3.0;
+			double ra, dec, dist, lra, ldec, ldist;
+			engine.getPosition (JD, ra, dec, dist);
+			legacy::getPosition (tle, ephem, JD, -4.4643, 40.4610, 791, lra, ldec, ldist);
+			ck_assert_dbl_eq (ra, lra, 1e-12);
+			ck_assert_dbl_eq (dec, ldec, 1e-12);
+			ck_assert_dbl_eq (dist, ldist, 1e-9);
+		}
+	}
+
+	// invalid TLE keeps previous one
+	rts2pluto::SatelliteEngine engine;
+	ck_assert (!engine.isValid ());
+	ck_assert_int_eq (engine.setTLE (iss1, iss2), 0);
+	ck_assert_int_eq (engine.getEphem (), 1);
+	ck_assert (engine.setTLE ("1 garbage", "2 garbage") != 0);
+	ck_assert (engine.isValid ());
+	ck_assert_int_eq (engine.getTLE ()->norad_number, 25544);
+	ck_assert_dbl_eq (engine.getPeriod () * 1440, 92.6, 0.1);
+
+	ck_assert_int_eq (engine.setTLE (xmm1, xmm2), 0);
+	ck_assert_int_eq (engine.getEphem (), 3);
+
+	// PLUTO reference, 24 Sep 2002 0h UT
+	ck_assert_int_eq (engine.setTLE (pluto1, pluto2), 0);
+	engine.setObserver (-69.9, 44.01, 100);
+	double ra, dec, dist;
+	engine.getPosition (2452541.5, ra, dec, dist);
+	epoch_of_date_to_j2000 (2452541.5, &ra, &dec);
+	ck_assert_dbl_eq (ra * 180.0 / M_PI, 350.1615, 0.5);
+	ck_assert_dbl_eq (dec * 180.0 / M_PI, -24.0241, 0.5);
+	ck_assert_dbl_eq (dist, 1867.97542, 0.5);
+}
+END_TEST
+
+START_TEST(altaz)
+{
+	rts2pluto::SatelliteEngine engine;
+	ck_assert_int_eq (engine.setTLE (iss1, iss2), 0);
+	engine.setObserver (-4.4643, 40.4610, 791);
+
+	// ISS pass above Madrid, same reference values as in check_tle
+	checkAltAz (engine, getJD (3, 47, 26), 21, 14.7);
+	checkAltAz (engine, getJD (3, 49, 8), 39, 318);
+	checkAltAz (engine, getJD (3, 52, 12), 10, 247);
+	checkAltAz (engine, getJD (3, 54, 22), 0, 239.6);
+
+	double JD[4] = {getJD (3, 47, 26), getJD (3, 49, 8), getJD (3, 52, 12), getJD (3, 54, 22)};
+	double alt[4], az[4];
+	engine.getAltAzs (JD, 4, alt, az);
+	for (int i = 0; i < 4; i++)
+	{
+		double a, z;
+		engine.getAltAz (JD[i], a, z);
+		ck_assert_dbl_eq (alt[i], a, 1e-12);
+		ck_assert_dbl_eq (az[i], z, 1e-12);
+	}
+}
+END_TEST
+
+START_TEST(passes)
+{
+	rts2pluto::SatelliteEngine engine;
+	ck_assert_int_eq (engine.setTLE (iss1, iss2), 0);
+	engine.setObserver (-4.4643, 40.4610, 791);
+
+	std::vector <rts2pluto::SatellitePass> passes;
+	ck_assert_int_eq (engine.getPasses (getJD (3, 30, 0), getJD (4, 10, 0), 0, NULL, passes), 1);
+
+	rts2pluto::SatellitePass &p = passes[0];
+	ck_assert (p.rise < getJD (3, 47, 26));
+	ck_assert_dbl_eq (p.set, getJD (3, 54, 22), 30 / 86400.0);
+	ck_assert (p.culmination > getJD (3, 47, 26) && p.culmination < getJD (3, 52, 12));
+	ck_assert (p.maxAlt > 38.5);
+	ck_assert_dbl_eq (p.setAz, 239.6, 1);
+
+	double alt, az, a1, a2;
+	engine.getAltAz (p.rise, alt, az);
+	ck_assert_dbl_eq (alt, 0, 1e-3);
+	ck_assert_dbl_eq (az, p.riseAz, 1e-9);
+	engine.getAltAz (p.set, alt, az);
+	ck_assert_dbl_eq (alt, 0, 1e-3);
+	engine.getAltAz (p.culmination, alt, az);
+	ck_assert_dbl_eq (alt, p.maxAlt, 1e-9);
+	engine.getAltAz (p.culmination - 1 / 86400.0, a1, az);
+	engine.getAltAz (p.culmination + 1 / 86400.0, a2, az);
+	ck_assert (a1 < p.maxAlt && a2 < p.maxAlt);
+
+	// compare with brute force, one second step scan over one day
+	double from = getJD (0, 0, 0);
+	double to = from + 1;
+	engine.getPasses (from, to, 10, NULL, passes);
+	std::vector <double> crossings;
+	engine.getAltAz (from, alt, az);
+	bool up = alt > 10;
+	for (double t = from + 1 / 86400.0; t <= to; t += 1 / 86400.0)
+	{
+		engine.getAltAz (t, alt, az);
+		if ((alt > 10) != up)
+		{
+			crossings.push_back (t);
+			up = alt > 10;
+		}
+	}
+	ck_assert (passes.size () > 2);
+	ck_assert_int_eq (crossings.size (), 2 * passes.size ());
+	for (size_t i = 0; i < passes.size (); i++)
+	{
+		ck_assert_dbl_eq (passes[i].rise, crossings[2 * i], 1 / 86400.0);
+		ck_assert_dbl_eq (passes[i].set, crossings[2 * i + 1], 1 / 86400.0);
+		ck_assert (passes[i].culmination > passes[i].rise && passes[i].culmination < passes[i].set);
+	}
+
+	// start and end in the middle of pass
+	ck_assert_int_eq (engine.getPasses (getJD (3, 49, 8), getJD (3, 52, 12), 0, NULL, passes), 1);
+	ck_assert (isnan (passes[0].rise));
+	ck_assert (isnan (passes[0].set));
+	ck_assert (passes[0].maxAlt > 38.5);
+
+	// horizon
+	char fn[] = "/tmp/check_satellite_XXXXXX";
+	int fd = mkstemp (fn);
+	ck_assert (fd >= 0);
+	FILE *f = fdopen (fd, "w");
+	fprintf (f, "AZ-ALT\n0 +5\n180 +25\n");
+	fclose (f);
+	ObjectCheck checker;
+	ck_assert_int_eq (checker.loadHorizon (fn), 0);
+	unlink (fn);
+
+	ck_assert_int_eq (engine.getPasses (getJD (3, 30, 0), getJD (4, 10, 0), 0, &checker, passes), 1);
+	engine.getAltAz (passes[0].rise, alt, az);
+	ck_assert_dbl_eq (alt, checker.getHorizonHeightAz (az), 1e-3);
+	engine.getAltAz (passes[0].set, alt, az);
+	ck_assert_dbl_eq (alt, checker.getHorizonHeightAz (az), 1e-3);
+	ck_assert (passes[0].set < p.set);
+
+	// horizon bellow minimal altitude
+	ck_assert_int_eq (engine.getPasses (getJD (3, 30, 0), getJD (4, 10, 0), 30, &checker, passes), 1);
+	engine.getAltAz (passes[0].rise, alt, az);
+	ck_assert_dbl_eq (alt, 30, 1e-3);
+	engine.getAltAz (passes[0].set, alt, az);
+	ck_assert_dbl_eq (alt, 30, 1e-3);
+
+	// never that high
+	ck_assert_int_eq (engine.getPasses (getJD (3, 30, 0), getJD (4, 10, 0), 80, NULL, passes), 0);
+}
+END_TEST
+
+START_TEST(benchmark)
+{
+	rts2pluto::SatelliteEngine engine;
+	engine.setTLE (iss1, iss2);
+	engine.setObserver (-4.4643, 40.4610, 791);
+
+	std::vector <double> JD (NUM_PROPAGATIONS), ra (NUM_PROPAGATIONS), dec (NUM_PROPAGATIONS), dist (NUM_PROPAGATIONS);
+	for (int i = 0; i < NUM_PROPAGATIONS; i++)
+		JD[i] = getJD (0, 0, 0) + i / 86400.0;
+
+	tle_t tle;
+	int ephem = legacy::parseTLE (iss1, iss2, tle);
+
+	uint64_t t0 = gettime_ns ();
+	double s = 0;
+	for (int i = 0; i < NUM_PROPAGATIONS; i++)
+	{
+		double r, d, di;
+		legacy::getPosition (tle, ephem, JD[i], -4.4643, 40.4610, 791, r, d, di);
+		s += r;
+	}
+	uint64_t tlegacy = gettime_ns () - t0;
+
+	t0 = gettime_ns ();
+	engine.getPositions (JD.data (), NUM_PROPAGATIONS, ra.data (), dec.data (), dist.data ());
+	uint64_t tbatch = gettime_ns () - t0;
+
+	double s1 = 0;
+	for (int i = 0; i < NUM_PROPAGATIONS; i++)
+		s1 += ra[i];
+	ck_assert_dbl_eq (s, s1, 1e-6);
+
+	std::vector <rts2pluto::SatellitePass> passes;
+	t0 = gettime_ns ();
+	engine.getPasses (JD[0], JD[0] + 7, 0, NULL, passes);
+	uint64_t tpasses = gettime_ns () - t0;
+
+	printf ("%d propagations: init on every call %.0f/s, cached %.0f/s; %d passes in 7 days found in %.1f ms\n", NUM_PROPAGATIONS, NUM_PROPAGATIONS / (tlegacy / 1e9), NUM_PROPAGATIONS / (tbatch / 1e9), (int) passes.size (), tpasses / 1e6);
+}
+END_TEST
+
+Suite * satellite_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Satellite");
+	tc_core = tcase_create ("Core");
+	tcase_set_timeout (tc_core, 60);
+	tcase_add_test (tc_core, position);
+	tcase_add_test (tc_core, altaz);
+	tcase_add_test (tc_core, passes);
+	tcase_add_test (tc_core, benchmark);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = satellite_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -3,7 +3,6 @@
 #include <stdint.h>
 #include <string.h>
 #include <math.h>
-#include <sys/time.h>
 #include <unistd.h>
 
 #include "sep/sep.h"
@@ -23,15 +22,6 @@ void teardown_sep (void)
 }
 
 
-uint64_t
-gettime_ns ()
-{
-	struct timeval tv;
-	gettimeofday (&tv, NULL);
-	return (uint64_t) tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
-}
-
-
 double *
 ones_dbl (int nx, int ny)
 {
@@ -433,6 +423,195 @@ START_TEST(SEP1)
 }
 END_TEST
 
+void
+addstar (float *im, int w, int h, float xc, float yc, float sigma, float flux)
+/* add gaussian star */
+{
+	int x, y;
+	int r = (int) (5 * sigma) + 1;
+	float norm = flux / (2 * M_PI * sigma * sigma);
+
+	for (y = (int) yc - r; y <= (int) yc + r; y++)
+	{
+		if (y < 0 || y >= h)
+			continue;
+		for (x = (int) xc - r; x <= (int) xc + r; x++)
+		{
+			if (x < 0 || x >= w)
+				continue;
+			im[x + w * y] += norm * exp (-((x - xc) * (x - xc) + (y - yc) * (y - yc)) / (2 * sigma * sigma));
+		}
+	}
+}
+
+
+void
+compare_catalogs (sep_catalog *c1, sep_catalog *c2)
+{
+	int i;
+
+	ck_assert_int_eq (c1->nobj, c2->nobj);
+	for (i = 0; i < c1->nobj; i++)
+	{
+		ck_assert_int_eq (c1->npix[i], c2->npix[i]);
+		ck_assert_int_eq (c1->xmin[i], c2->xmin[i]);
+		ck_assert_int_eq (c1->ymax[i], c2->ymax[i]);
+		ck_assert_int_eq (c1->flag[i], c2->flag[i]);
+		ck_assert (c1->x[i] == c2->x[i]);
+		ck_assert (c1->y[i] == c2->y[i]);
+		ck_assert (c1->x2[i] == c2->x2[i]);
+		ck_assert (c1->a[i] == c2->a[i]);
+		ck_assert (c1->flux[i] == c2->flux[i]);
+		ck_assert (c1->cflux[i] == c2->cflux[i]);
+		ck_assert (c1->peak[i] == c2->peak[i]);
+		ck_assert (memcmp (c1->pix[i], c2->pix[i], c1->npix[i] * sizeof (int)) == 0);
+	}
+}
+
+
+/* serial and multi-threaded processing of a full frame image */
+void
+check_parallel (const char *name, float *data, int nx, int ny, int nthreads, int tileh, int *nobj)
+{
+	int i, status;
+	uint64_t t0, t1, tserial, tparallel;
+	sep_bkg *bkg1 = NULL, *bkg2 = NULL;
+	sep_catalog *cat1 = NULL, *cat2 = NULL;
+	float conv[] = { 1, 2, 1, 2, 4, 2, 1, 2, 1 };
+	float *im1, *im2;
+	double *flux1, *flux2, *fluxerr, *area;
+	short *flag;
+
+	printf ("%s %dx%d, %d threads, tile height %d\n", name, nx, ny, nthreads, tileh);
+
+	im1 = (float *) malloc (nx * ny * sizeof (float));
+	im2 = (float *) malloc (nx * ny * sizeof (float));
+	memcpy (im1, data, nx * ny * sizeof (float));
+	memcpy (im2, data, nx * ny * sizeof (float));
+
+	sep_image im = { im1, NULL, NULL, SEP_TFLOAT, 0, 0, nx, ny, 0.0, SEP_NOISE_NONE, 1.0, 0.0 };
+
+	/* background */
+	t0 = gettime_ns ();
+	status = sep_background (&im, 64, 64, 3, 3, 0.0, &bkg1);
+	t1 = gettime_ns ();
+	ck_assert_int_eq (status, 0);
+	tserial = t1 - t0;
+
+	t0 = gettime_ns ();
+	status = sep_background_mt (&im, 64, 64, 3, 3, 0.0, nthreads, &bkg2);
+	t1 = gettime_ns ();
+	ck_assert_int_eq (status, 0);
+	tparallel = t1 - t0;
+	printf ("  %-22s serial %7.1f ms parallel %7.1f ms\n", "sep_background()", tserial / 1e6, tparallel / 1e6);
+
+	ck_assert_int_eq (bkg1->n, bkg2->n);
+	ck_assert (memcmp (bkg1->back, bkg2->back, bkg1->n * sizeof (float)) == 0);
+	ck_assert (memcmp (bkg1->sigma, bkg2->sigma, bkg1->n * sizeof (float)) == 0);
+	ck_assert (memcmp (bkg1->dback, bkg2->dback, bkg1->n * sizeof (float)) == 0);
+	ck_assert (bkg1->globalrms == bkg2->globalrms);
+
+	t0 = gettime_ns ();
+	status = sep_bkg_subarray (bkg1, im1, SEP_TFLOAT);
+	t1 = gettime_ns ();
+	ck_assert_int_eq (status, 0);
+	tserial = t1 - t0;
+
+	t0 = gettime_ns ();
+	status = sep_bkg_subarray_mt (bkg2, im2, SEP_TFLOAT, nthreads);
+	t1 = gettime_ns ();
+	ck_assert_int_eq (status, 0);
+	tparallel = t1 - t0;
+	printf ("  %-22s serial %7.1f ms parallel %7.1f ms\n", "sep_bkg_subarray()", tserial / 1e6, tparallel / 1e6);
+	ck_assert (memcmp (im1, im2, nx * ny * sizeof (float)) == 0);
+
+	/* extraction with deblending and cleaning */
+	im.noiseval = bkg1->globalrms;
+	im.noise_type = SEP_NOISE_STDDEV;
+
+	t0 = gettime_ns ();
+	status = sep_extract (&im, 1.5, SEP_THRESH_REL, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, &cat1);
+	t1 = gettime_ns ();
+	ck_assert_int_eq (status, 0);
+	tserial = t1 - t0;
+
+	t0 = gettime_ns ();
+	status = sep_extract_mt (&im, 1.5, SEP_THRESH_REL, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, tileh, nthreads, &cat2);
+	t1 = gettime_ns ();
+	ck_assert_int_eq (status, 0);
+	tparallel = t1 - t0;
+	printf ("  %-22s serial %7.1f ms parallel %7.1f ms, %d objects\n", "sep_extract()", tserial / 1e6, tparallel / 1e6, cat1->nobj);
+
+	compare_catalogs (cat1, cat2);
+	*nobj = cat1->nobj;
+
+	/* aperture photometry */
+	flux1 = (double *) malloc (cat1->nobj * sizeof (double));
+	flux2 = (double *) malloc (cat1->nobj * sizeof (double));
+	fluxerr = (double *) malloc (cat1->nobj * sizeof (double));
+	area = (double *) malloc (cat1->nobj * sizeof (double));
+	flag = (short *) malloc (cat1->nobj * sizeof (short));
+
+	t0 = gettime_ns ();
+	for (i = 0; i < cat1->nobj; i++)
+		sep_sum_circle (&im, cat1->x[i], cat1->y[i], 5.0, 5, 0, flux1 + i, fluxerr + i, area + i, flag + i);
+	t1 = gettime_ns ();
+	tserial = t1 - t0;
+
+	t0 = gettime_ns ();
+	status = sep_sum_circle_array (&im, cat1->x, cat1->y, cat1->nobj, 5.0, 5, 0, flux2, fluxerr, area, flag, nthreads);
+	t1 = gettime_ns ();
+	ck_assert_int_eq (status, 0);
+	tparallel = t1 - t0;
+	printf ("  %-22s serial %7.1f ms parallel %7.1f ms\n", "sep_sum_circle()", tserial / 1e6, tparallel / 1e6);
+	ck_assert (memcmp (flux1, flux2, cat1->nobj * sizeof (double)) == 0);
+
+	free (flux1);
+	free (flux2);
+	free (fluxerr);
+	free (area);
+	free (flag);
+	sep_catalog_free (cat1);
+	sep_catalog_free (cat2);
+	sep_bkg_free (bkg1);
+	sep_bkg_free (bkg2);
+	free (im1);
+	free (im2);
+}
+
+
+START_TEST(parallel)
+{
+	int i, nx, ny, status, nobj;
+	float *data, *frame;
+
+	/* test image tiled to full frame */
+	status = read_test_image ("data/image.fits", &data, &nx, &ny);
+	ck_assert_int_eq (status, 0);
+	frame = tile_flt (data, nx, ny, 8, 8, &nx, &ny);
+	free (data);
+
+	check_parallel ("tiled test image", frame, nx, ny, 4, 0, &nobj);
+	ck_assert (nobj > 64 * 60);
+	// small tiles with many seams
+	check_parallel ("tiled test image", frame, nx, ny, 3, 100, &nobj);
+	free (frame);
+
+	/* simulated field with bright stars and galaxies larger than tile overlap */
+	srand (1);
+	nx = ny = 2048;
+	frame = makenoiseim (nx, ny, 1000, 10);
+	for (i = 0; i < 5000; i++)
+		addstar (frame, nx, ny, nx * (rand () / (float) RAND_MAX), ny * (rand () / (float) RAND_MAX), 1.5, 100 + 20000 * pow (rand () / (float) RAND_MAX, 4));
+	for (i = 0; i < 20; i++)
+		addstar (frame, nx, ny, nx * (rand () / (float) RAND_MAX), ny * (rand () / (float) RAND_MAX), 25, 5e6);
+	check_parallel ("simulated field", frame, nx, ny, 4, 0, &nobj);
+	ck_assert (nobj > 2000);
+	check_parallel ("simulated field", frame, nx, ny, 2, 128, &nobj);
+	free (frame);
+}
+END_TEST
+
 /***************************************************************************/
 /* aperture photometry */
 
@@ -474,7 +653,9 @@ sep_suite (void)
 	tc_sep = tcase_create ("SEP");
 
 	tcase_add_checked_fixture (tc_sep, setup_sep, teardown_sep);
+	tcase_set_timeout (tc_sep, 120);
 	tcase_add_test (tc_sep, SEP1);
+	tcase_add_test (tc_sep, parallel);
 	suite_add_tcase (s, tc_sep);
 
 	return s;
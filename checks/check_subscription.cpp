@@ -0,0 +1,376 @@
+#include "daemon.h"
+#include "valuesubscription.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define NUM_VALUES    200
+#define NUM_CONNS     30
+#define ITERATIONS    200
+
+class SubscriptionDaemon:public rts2core::Daemon
+{
+	public:
+		SubscriptionDaemon (int argc, char **argv):rts2core::Daemon (argc, argv)
+		{
+			for (int i = 0; i < NUM_VALUES; i++)
+			{
+				char name[20];
+				snprintf (name, sizeof (name), "value_%d", i);
+				createValue (vals[i], name, "test value", false);
+			}
+			setTimeout (USEC_SEC / 100);
+		}
+
+		void change (double v)
+		{
+			for (int i = 0; i < NUM_VALUES; i++)
+				vals[i]->setValueDouble (v + i);
+		}
+
+		/**
+		 * Move connections from the added list to the connections list.
+		 */
+		void processAdded () { idle (); }
+
+		rts2core::ValueDouble *vals[NUM_VALUES];
+
+	protected:
+		virtual bool isRunning (rts2core::Connection *conn) { return true; }
+		virtual rts2core::Connection *createClientConnection (rts2core::NetworkAddress * in_addr) { return NULL; }
+};
+
+SubscriptionDaemon *daemon_s;
+rts2core::Connection *conns[NUM_CONNS];
+int readers[NUM_CONNS];
+
+void setup_daemon (void)
+{
+	const char *argv[] = {"check_subscription"};
+	daemon_s = new SubscriptionDaemon (1, (char **) argv);
+	for (int i = 0; i < NUM_CONNS; i++)
+	{
+		int sv[2];
+		ck_assert_int_eq (socketpair (AF_UNIX, SOCK_STREAM, 0, sv), 0);
+		fcntl (sv[1], F_SETFL, O_NONBLOCK);
+		readers[i] = sv[1];
+		conns[i] = new rts2core::Connection (sv[0], daemon_s);
+		daemon_s->addConnection (conns[i]);
+	}
+	daemon_s->processAdded ();
+}
+
+void teardown_daemon (void)
+{
+	delete daemon_s;
+	daemon_s = NULL;
+	for (int i = 0; i < NUM_CONNS; i++)
+		if (readers[i] >= 0)
+			close (readers[i]);
+}
+
+std::string drain (int fd)
+{
+	std::string ret;
+	char buf[16384];
+	while (true)
+	{
+		ssize_t r = read (fd, buf, sizeof (buf));
+		if (r <= 0)
+			break;
+		ret.append (buf, r);
+	}
+	return ret;
+}
+
+int countLines (const std::string &s, const char *prefix)
+{
+	int ret = 0;
+	size_t pos = 0;
+	size_t plen = strlen (prefix);
+	while (pos < s.length ())
+	{
+		size_t e = s.find ('\n', pos);
+		if (e == std::string::npos)
+			break;
+		if (s.compare (pos, plen, prefix) == 0)
+			ret++;
+		pos = e + 1;
+	}
+	return ret;
+}
+
+START_TEST(patterns)
+{
+	rts2core::ValueDouble temp ("temperature", "test", false);
+	rts2core::ValueDouble hum ("HUM", "test", false);
+	rts2core::ValueDouble humidity ("humidity", "test", false);
+	rts2core::ValueTime infotime (RTS2_VALUE_INFOTIME, "test", false);
+
+	rts2core::ValueSubscription all;
+	ck_assert (all.matches (&temp, 0));
+	ck_assert (all.matches (&humidity, -1));
+
+	rts2core::ValueSubscription sub;
+	sub.addPattern ("temp*");
+	sub.addPattern ("hum");
+	ck_assert (sub.matches (&temp, 0));
+	ck_assert (sub.matches (&hum, 1));
+	ck_assert (!sub.matches (&humidity, 2));
+	ck_assert (sub.matches (&infotime, 3));
+	// cached results
+	ck_assert (sub.matches (&temp, 0));
+	ck_assert (!sub.matches (&humidity, 2));
+	ck_assert (!sub.matches (&humidity, -1));
+}
+END_TEST
+
+START_TEST(rate_limit)
+{
+	rts2core::ValueDouble temp ("temperature", "test", false);
+	rts2core::ValueDouble hum ("humidity", "test", false);
+	rts2core::ValueSubscription sub (1.0);
+	std::vector <int> ids;
+
+	ck_assert (sub.accept (&temp, 0, 100));
+	ck_assert (sub.accept (&hum, 1, 100.1));
+	ck_assert (isnan (sub.getPendingTime ()));
+
+	// withheld, send after interval
+	ck_assert (!sub.accept (&temp, 0, 100.5));
+	ck_assert (!sub.accept (&temp, 0, 100.7));
+	ck_assert (!sub.accept (&hum, 1, 100.8));
+	ck_assert (sub.getPendingTime () == 101);
+	sub.getPending (100.9, ids);
+	ck_assert (ids.empty ());
+	sub.getPending (101, ids);
+	ck_assert_int_eq (ids.size (), 1);
+	ck_assert_int_eq (ids[0], 0);
+	ck_assert (sub.getPendingTime () == 101.1);
+	ck_assert (sub.accept (&temp, 0, 101));
+
+	// explicit request is not limited, and clears withheld value
+	ck_assert (sub.accept (&hum, 1, 101.05, false));
+	ids.clear ();
+	sub.getPending (102, ids);
+	ck_assert (ids.empty ());
+	ck_assert (isnan (sub.getPendingTime ()));
+
+	// values without ID are not limited
+	ck_assert (sub.accept (&hum, -1, 102));
+	ck_assert (sub.accept (&hum, -1, 102));
+}
+END_TEST
+
+START_TEST(daemon_filter)
+{
+	rts2core::ValueSubscription *sub = new rts2core::ValueSubscription ();
+	sub->addPattern ("value_1*");
+	conns[0]->setSubscription (sub);
+
+	daemon_s->change (10);
+	ck_assert_int_eq (daemon_s->infoAll (), 0);
+	std::string s0 = drain (readers[0]);
+	std::string s1 = drain (readers[1]);
+	// value_1, value_10 - value_19 and value_100 - value_199
+	ck_assert_int_eq (countLines (s0, PROTO_VALUE " value_"), 111);
+	ck_assert_int_eq (countLines (s0, PROTO_VALUE " " RTS2_VALUE_INFOTIME " "), 1);
+	ck_assert_int_eq (countLines (s1, PROTO_VALUE " value_"), NUM_VALUES);
+	ck_assert (s0.find (PROTO_VALUE " value_2 ") == std::string::npos);
+
+	daemon_s->vals[2]->setValueDouble (1);
+	daemon_s->sendValueAll (daemon_s->vals[2]);
+	ck_assert_str_eq (drain (readers[0]).c_str (), "");
+	ck_assert_str_eq (drain (readers[1]).c_str (), PROTO_VALUE " value_2 1\n");
+
+	daemon_s->vals[12]->setValueDouble (1);
+	daemon_s->sendValueAll (daemon_s->vals[12]);
+	ck_assert_str_eq (drain (readers[0]).c_str (), PROTO_VALUE " value_12 1\n");
+
+	// binary frames carry the same subset
+	conns[0]->setBinaryValues (true);
+	daemon_s->change (20);
+	daemon_s->infoAll ();
+	std::string b0 = drain (readers[0]);
+	ck_assert (b0.compare (0, 2, PROTO_VALUE_FRAME " ") == 0);
+	ck_assert (b0.find ("value_2") == std::string::npos);
+	ck_assert (b0.find ("value_199") != std::string::npos);
+
+	// removing subscription sends everything again
+	conns[0]->setSubscription (NULL);
+	conns[0]->setBinaryValues (false);
+	daemon_s->change (30);
+	daemon_s->infoAll ();
+	ck_assert_int_eq (countLines (drain (readers[0]), PROTO_VALUE " value_"), NUM_VALUES);
+}
+END_TEST
+
+START_TEST(daemon_rate)
+{
+	rts2core::ValueSubscription *sub = new rts2core::ValueSubscription (0.2);
+	sub->addPattern ("value_3");
+	conns[0]->setSubscription (sub);
+
+	for (int i = 0; i < 10; i++)
+	{
+		daemon_s->vals[3]->setValueDouble (i);
+		daemon_s->sendValueAll (daemon_s->vals[3]);
+	}
+	ck_assert_str_eq (drain (readers[0]).c_str (), PROTO_VALUE " value_3 0\n");
+	ck_assert_int_eq (countLines (drain (readers[1]), PROTO_VALUE " value_3 "), 10);
+
+	// info command is answered with current value
+	daemon_s->sendInfo (conns[0], true);
+	std::string s = drain (readers[0]);
+	ck_assert_int_eq (countLines (s, PROTO_VALUE " value_"), 1);
+	ck_assert (s.find (PROTO_VALUE " value_3 9\n") != std::string::npos);
+
+	daemon_s->vals[3]->setValueDouble (42);
+	daemon_s->sendValueAll (daemon_s->vals[3]);
+	ck_assert_str_eq (drain (readers[0]).c_str (), "");
+
+	// latest value is send after interval expires
+	double start = getNow ();
+	while (getNow () - start < 2)
+	{
+		daemon_s->oneRunLoop ();
+		s = drain (readers[0]);
+		if (!s.empty ())
+			break;
+	}
+	ck_assert_str_eq (s.c_str (), PROTO_VALUE " value_3 42\n");
+	ck_assert_msg (getNow () - start > 0.1, "withheld value send too early");
+}
+END_TEST
+
+volatile bool metaSent;
+
+void *sendMeta (void *arg)
+{
+	for (int i = 0; i < NUM_CONNS; i++)
+		daemon_s->sendMetaInfo (conns[i]);
+	metaSent = true;
+	return NULL;
+}
+
+START_TEST(benchmark)
+{
+	// clients parse the received values
+	const char *argv[] = {"check_subscription"};
+	SubscriptionDaemon *clients = new SubscriptionDaemon (1, (char **) argv);
+	for (int i = 0; i < NUM_CONNS; i++)
+		clients->addConnection (new rts2core::Connection (readers[i], clients));
+	clients->processAdded ();
+
+	// metainfo does not fit into socket buffers, clients must read it while it is send
+	pthread_t th;
+	metaSent = false;
+	pthread_create (&th, NULL, sendMeta, NULL);
+	while (!metaSent)
+		clients->oneRunLoop ();
+	pthread_join (th, NULL);
+	for (int i = 0; i < 10; i++)
+		clients->oneRunLoop ();
+
+	uint64_t cpu[2] = {0, 0};
+	size_t bytes[2] = {0, 0};
+	for (int b = 0; b < 2; b++)
+	{
+		for (int i = 0; i < NUM_CONNS; i++)
+		{
+			if (b == 0)
+			{
+				conns[i]->setSubscription (NULL);
+				continue;
+			}
+			// each client is interested in a few values
+			rts2core::ValueSubscription *sub = new rts2core::ValueSubscription ();
+			for (int j = 0; j < 5; j++)
+			{
+				char name[20];
+				snprintf (name, sizeof (name), "value_%d", (i * 7 + j * 13) % NUM_VALUES);
+				sub->addPattern (name);
+			}
+			conns[i]->setSubscription (sub);
+		}
+		for (int it = 0; it < ITERATIONS; it++)
+		{
+			daemon_s->change (it + b * 0.5);
+			uint64_t t0 = getcpu_ns ();
+			daemon_s->infoAll ();
+			// let clients process everything
+			for (int l = 0; true; l++)
+			{
+				int pending = 0;
+				for (int i = 0; i < NUM_CONNS; i++)
+				{
+					int p;
+					if (ioctl (readers[i], FIONREAD, &p) == 0)
+						pending += p;
+				}
+				if (l == 0)
+					bytes[b] += pending;
+				if (pending == 0)
+					break;
+				clients->oneRunLoop ();
+			}
+			cpu[b] += getcpu_ns () - t0;
+		}
+	}
+	printf ("%d values to %d clients: all values %.3f ms CPU %lu bytes, 5 subscribed values %.3f ms CPU %lu bytes per update\n", NUM_VALUES, NUM_CONNS, cpu[0] / 1000000.0 / ITERATIONS, (unsigned long) bytes[0] / ITERATIONS, cpu[1] / 1000000.0 / ITERATIONS, (unsigned long) bytes[1] / ITERATIONS);
+	ck_assert (bytes[1] < bytes[0] / 10);
+
+	delete clients;
+	// sockets were closed by client connections
+	for (int i = 0; i < NUM_CONNS; i++)
+		readers[i] = -1;
+}
+END_TEST
+
+Suite * subscription_suite (void)
+{
+	Suite *s;
+	TCase *tc_subscription;
+	TCase *tc_daemon;
+
+	s = suite_create ("Value subscriptions");
+	tc_subscription = tcase_create ("Patterns and rate limits");
+	tcase_add_test (tc_subscription, patterns);
+	tcase_add_test (tc_subscription, rate_limit);
+	suite_add_tcase (s, tc_subscription);
+
+	tc_daemon = tcase_create ("Daemon sends subscribed values");
+	tcase_add_checked_fixture (tc_daemon, setup_daemon, teardown_daemon);
+	tcase_set_timeout (tc_daemon, 60);
+	tcase_add_test (tc_daemon, daemon_filter);
+	tcase_add_test (tc_daemon, daemon_rate);
+	tcase_add_test (tc_daemon, benchmark);
+	suite_add_tcase (s, tc_daemon);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = subscription_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -2,6 +2,8 @@
 #define __CHECK_UTILS__
 
 #include <math.h>
+#include <stdint.h>
+#include <time.h>
 #include <string>
 
 #include <check.h>
@@ -16,4 +18,20 @@ inline void ck_assert_string_eq (const char *chr, std::string oo)
 	ck_assert_str_eq (chr, oo.c_str ());
 }
 
+// monotonic time in nanoseconds, for benchmarks
+inline uint64_t gettime_ns ()
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// CPU time used by the process in nanoseconds
+inline uint64_t getcpu_ns ()
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 #endif //!__CHECK_UTILS__
@@ -0,0 +1,232 @@
+#include "daemon.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define NUM_VALUES    200
+#define NUM_CONNS     30
+#define ITERATIONS    200
+
+class FanoutDaemon:public rts2core::Daemon
+{
+	public:
+		FanoutDaemon (int argc, char **argv):rts2core::Daemon (argc, argv)
+		{
+			for (int i = 0; i < NUM_VALUES; i++)
+			{
+				char name[20];
+				snprintf (name, sizeof (name), "value_%d", i);
+				createValue (vals[i], name, "benchmark value", false);
+			}
+			createValue (str, "string", "string value", false);
+		}
+
+		void change (double v)
+		{
+			for (int i = 0; i < NUM_VALUES; i++)
+				vals[i]->setValueDouble (v + i);
+		}
+
+		/**
+		 * Send values the way they were send before values were encoded to frames.
+		 */
+		void sendPerConnection ()
+		{
+			for (rts2core::connections_t::iterator iter = getConnections ()->begin (); iter != getConnections ()->end (); iter++)
+				for (int i = 0; i < NUM_VALUES; i++)
+					vals[i]->send (*iter);
+			for (int i = 0; i < NUM_VALUES; i++)
+				vals[i]->resetNeedSend ();
+		}
+
+		void sendFramed ()
+		{
+			std::string frame;
+			for (int i = 0; i < NUM_VALUES; i++)
+				vals[i]->encode (frame);
+			for (rts2core::connections_t::iterator iter = getConnections ()->begin (); iter != getConnections ()->end (); iter++)
+				(*iter)->sendFrame (frame);
+			for (int i = 0; i < NUM_VALUES; i++)
+				vals[i]->resetNeedSend ();
+		}
+
+		/**
+		 * Move connections from the added list to the connections list.
+		 */
+		void processAdded () { idle (); }
+
+		rts2core::ValueDouble *vals[NUM_VALUES];
+		rts2core::ValueString *str;
+
+	protected:
+		virtual bool isRunning (rts2core::Connection *conn) { return true; }
+		virtual rts2core::Connection *createClientConnection (rts2core::NetworkAddress * in_addr) { return NULL; }
+};
+
+FanoutDaemon *fanout;
+int readers[NUM_CONNS];
+
+void setup_fanout (void)
+{
+	const char *argv[] = {"check_valuefanout"};
+	fanout = new FanoutDaemon (1, (char **) argv);
+	for (int i = 0; i < NUM_CONNS; i++)
+	{
+		int sv[2];
+		ck_assert_int_eq (socketpair (AF_UNIX, SOCK_STREAM, 0, sv), 0);
+		fcntl (sv[1], F_SETFL, O_NONBLOCK);
+		readers[i] = sv[1];
+		fanout->addConnection (new rts2core::Connection (sv[0], fanout));
+	}
+	fanout->processAdded ();
+	ck_assert_int_eq (fanout->getConnections ()->size (), NUM_CONNS);
+}
+
+void teardown_fanout (void)
+{
+	delete fanout;
+	fanout = NULL;
+	for (int i = 0; i < NUM_CONNS; i++)
+		close (readers[i]);
+}
+
+/**
+ * Read all data waiting on the reader socket.
+ */
+std::string drain (int fd)
+{
+	std::string ret;
+	char buf[16384];
+	while (true)
+	{
+		ssize_t r = read (fd, buf, sizeof (buf));
+		if (r <= 0)
+			break;
+		ret.append (buf, r);
+	}
+	return ret;
+}
+
+int countLines (const std::string &s, const char *prefix)
+{
+	int ret = 0;
+	size_t pos = 0;
+	size_t plen = strlen (prefix);
+	while (pos < s.length ())
+	{
+		size_t e = s.find ('\n', pos);
+		if (e == std::string::npos)
+			break;
+		if (s.compare (pos, plen, prefix) == 0)
+			ret++;
+		pos = e + 1;
+	}
+	return ret;
+}
+
+START_TEST(frame_content)
+{
+	fanout->change (10);
+	fanout->str->setValueCharArr ("test string");
+	ck_assert_int_eq (fanout->infoAll (), 0);
+
+	for (int i = 0; i < NUM_CONNS; i++)
+	{
+		std::string s = drain (readers[i]);
+		ck_assert_int_eq (countLines (s, PROTO_VALUE " value_"), NUM_VALUES);
+		ck_assert_msg (s.find (PROTO_VALUE " value_7 17\n") != std::string::npos, "value_7 not found in %s", s.c_str ());
+		ck_assert_msg (s.find (PROTO_VALUE " string \"test string\"\n") != std::string::npos, "string value not found");
+	}
+
+	// nothing changed, nothing send
+	fanout->infoAll ();
+	for (int i = 0; i < NUM_CONNS; i++)
+		ck_assert_int_eq (countLines (drain (readers[i]), PROTO_VALUE " value_"), 0);
+
+	fanout->vals[3]->setValueDouble (1);
+	fanout->sendValueAll (fanout->vals[3]);
+	for (int i = 0; i < NUM_CONNS; i++)
+		ck_assert_str_eq (drain (readers[i]).c_str (), PROTO_VALUE " value_3 1\n");
+}
+END_TEST
+
+START_TEST(frame_compatible)
+{
+	// framed messages must be identical to messages send one by one
+	fanout->change (0.123456789);
+	fanout->sendPerConnection ();
+	std::string single = drain (readers[NUM_CONNS - 1]);
+
+	fanout->change (0.123456789);
+	fanout->sendFramed ();
+	std::string framed = drain (readers[NUM_CONNS - 1]);
+
+	ck_assert_int_eq (countLines (single, PROTO_VALUE " value_"), NUM_VALUES);
+	ck_assert_msg (single == framed, "framed messages differ from single messages");
+}
+END_TEST
+
+START_TEST(benchmark)
+{
+	uint64_t tsingle = 0, tframed = 0;
+	for (int it = 0; it < ITERATIONS; it++)
+	{
+		fanout->change (it);
+		uint64_t t0 = gettime_ns ();
+		fanout->sendPerConnection ();
+		tsingle += gettime_ns () - t0;
+		for (int i = 0; i < NUM_CONNS; i++)
+			drain (readers[i]);
+
+		fanout->change (it + 0.5);
+		t0 = gettime_ns ();
+		fanout->sendFramed ();
+		tframed += gettime_ns () - t0;
+		for (int i = 0; i < NUM_CONNS; i++)
+			drain (readers[i]);
+	}
+	printf ("%d values to %d connections: per connection %.3f ms, framed %.3f ms per update, speedup %.1fx\n", NUM_VALUES, NUM_CONNS, tsingle / 1000000.0 / ITERATIONS, tframed / 1000000.0 / ITERATIONS, (double) tsingle / tframed);
+}
+END_TEST
+
+Suite * valuefanout_suite (void)
+{
+	Suite *s;
+	TCase *tc_fanout;
+
+	s = suite_create ("Value fan-out");
+	tc_fanout = tcase_create ("Framed values");
+	tcase_add_checked_fixture (tc_fanout, setup_fanout, teardown_fanout);
+	tcase_set_timeout (tc_fanout, 120);
+
+	tcase_add_test (tc_fanout, frame_content);
+	tcase_add_test (tc_fanout, frame_compatible);
+	tcase_add_test (tc_fanout, benchmark);
+	suite_add_tcase (s, tc_fanout);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = valuefanout_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,188 @@
+#include "valuelist.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <check.h>
+#include <check_utils.h>
+
+#define LOOKUPS    200000
+
+void fillValues (rts2core::ValueVector &vv, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		char name[30];
+		snprintf (name, sizeof (name), "device_value_%d", i);
+		vv.addValue (new rts2core::ValueDouble (name, "test value", false));
+	}
+}
+
+// the way values were searched before the registry
+rts2core::Value *linearSearch (rts2core::ValueVector &vv, const char *name)
+{
+	for (rts2core::ValueVector::iterator iter = vv.begin (); iter != vv.end (); iter++)
+		if ((*iter)->isValue (name))
+			return *iter;
+	return NULL;
+}
+
+START_TEST(registry)
+{
+	rts2core::ValueRegistry <int> reg;
+	int a = 1, b = 2, c = 3;
+
+	ck_assert_int_eq (reg.getId ("a"), -1);
+	ck_assert_ptr_eq (reg.find ("a"), NULL);
+
+	ck_assert_int_eq (reg.add ("a", &a), 0);
+	ck_assert_int_eq (reg.add ("B", &b), 1);
+	ck_assert_ptr_eq (reg.find ("A"), &a);
+	ck_assert_ptr_eq (reg.find ("b"), &b);
+
+	// first added value is kept
+	ck_assert_int_eq (reg.add ("a", &c), 0);
+	ck_assert_ptr_eq (reg.find ("a"), &a);
+
+	// ID is kept after removal
+	reg.remove ("a");
+	ck_assert_ptr_eq (reg.find ("a"), NULL);
+	ck_assert_int_eq (reg.getId ("a"), 0);
+	ck_assert_int_eq (reg.add ("a", &c), 0);
+	ck_assert_ptr_eq (reg.get (0), &c);
+	ck_assert_ptr_eq (reg.get (5), NULL);
+	ck_assert_ptr_eq (reg.get (-1), NULL);
+
+	// rehash keeps all IDs
+	for (int i = 0; i < 1000; i++)
+	{
+		char name[20];
+		snprintf (name, sizeof (name), "v%d", i);
+		ck_assert_int_eq (reg.intern (name), i + 2);
+	}
+	ck_assert_int_eq (reg.size (), 1002);
+	ck_assert_int_eq (reg.getId ("V537"), 539);
+	ck_assert_ptr_eq (reg.find ("b"), &b);
+}
+END_TEST
+
+START_TEST(value_vector)
+{
+	rts2core::ValueVector vv;
+	fillValues (vv, 50);
+
+	rts2core::Value *v = vv.getValue ("device_value_17");
+	ck_assert_ptr_ne (v, NULL);
+	ck_assert_str_eq (v->getName ().c_str (), "device_value_17");
+	ck_assert_ptr_eq (vv.getValue ("DEVICE_VALUE_17"), v);
+	ck_assert_ptr_eq (vv.getValue ("device_value_50"), NULL);
+	ck_assert (*vv.getValueIterator ("device_value_17") == v);
+	ck_assert (vv.getValueIterator ("unknown") == vv.end ());
+
+	int id = vv.getValueId ("device_value_17");
+	ck_assert_ptr_eq (vv.getValueById (id), v);
+
+	rts2core::ValueVector::iterator iter = vv.removeValue ("device_value_17");
+	ck_assert_str_eq ((*iter)->getName ().c_str (), "device_value_18");
+	ck_assert_ptr_eq (vv.getValue ("device_value_17"), NULL);
+	ck_assert_ptr_eq (vv.getValueById (id), NULL);
+	ck_assert_int_eq (vv.size (), 49);
+
+	// value which replaces removed value gets the same ID, at the same position
+	rts2core::Value *nv = new rts2core::ValueInteger ("device_value_17", "replaced value", false);
+	vv.insertValue (iter, nv);
+	ck_assert_int_eq (vv.getValueId ("device_value_17"), id);
+	ck_assert_ptr_eq (vv.getValueById (id), nv);
+	ck_assert (vv[17] == nv);
+}
+END_TEST
+
+START_TEST(cond_values)
+{
+	rts2core::CondValueVector cv;
+	rts2core::Value *vals[10];
+	for (int i = 0; i < 10; i++)
+	{
+		char name[20];
+		snprintf (name, sizeof (name), "cond_%d", i);
+		vals[i] = new rts2core::ValueDouble (name, "test value", false);
+		cv.addCondValue (new rts2core::CondValue (vals[i], 0));
+	}
+	ck_assert_ptr_eq (cv.getCondValue ("cond_4")->getValue (), vals[4]);
+	ck_assert_ptr_eq (cv.getCondValue (vals[7])->getValue (), vals[7]);
+	ck_assert_ptr_eq (cv.getCondValue ("cond_10"), NULL);
+	ck_assert_ptr_eq (cv.getCondValue ((rts2core::Value *) NULL), NULL);
+	ck_assert_ptr_eq (cv.getCondValueById (cv.getValueId ("COND_2")), cv.getCondValue (vals[2]));
+}
+END_TEST
+
+START_TEST(benchmark)
+{
+	int counts[] = {30, 300, 3000};
+	for (int c = 0; c < 3; c++)
+	{
+		rts2core::ValueVector vv;
+		fillValues (vv, counts[c]);
+
+		// names to search for, spread over the whole list
+		std::vector <std::string> names;
+		for (int i = 0; i < 64; i++)
+		{
+			char name[30];
+			snprintf (name, sizeof (name), "device_value_%d", (i * 7919) % counts[c]);
+			names.push_back (name);
+		}
+
+		int found = 0;
+		uint64_t t0 = gettime_ns ();
+		for (int i = 0; i < LOOKUPS; i++)
+			if (vv.getValue (names[i % 64].c_str ()))
+				found++;
+		uint64_t t1 = gettime_ns ();
+		int lookups = LOOKUPS / counts[c] * 30;
+		for (int i = 0; i < lookups; i++)
+			if (linearSearch (vv, names[i % 64].c_str ()))
+				found++;
+		uint64_t t2 = gettime_ns ();
+
+		ck_assert_int_eq (found, LOOKUPS + lookups);
+		double treg = (double) (t1 - t0) / LOOKUPS;
+		double tlin = (double) (t2 - t1) / lookups;
+		printf ("%d values: registry %.1f ns, linear scan %.1f ns per lookup\n", counts[c], treg, tlin);
+	}
+}
+END_TEST
+
+Suite * valueregistry_suite (void)
+{
+	Suite *s;
+	TCase *tc_registry;
+
+	s = suite_create ("Value registry");
+	tc_registry = tcase_create ("Hash index of value names");
+	tcase_set_timeout (tc_registry, 60);
+
+	tcase_add_test (tc_registry, registry);
+	tcase_add_test (tc_registry, value_vector);
+	tcase_add_test (tc_registry, cond_values);
+	tcase_add_test (tc_registry, benchmark);
+	suite_add_tcase (s, tc_registry);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = valueregistry_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
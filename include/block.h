@@ -54,6 +54,8 @@
 // protocol specific commands
 /** The command is variable value update. @ingroup RTS2Protocol */
 #define PROTO_VALUE            "V"
+/** Binary value frame of given length follows. Send only to connections which requested it with binary_values command. @ingroup RTS2Protocol */
+#define PROTO_VALUE_FRAME      "W"
 /** The command set variable value. @ingroup RTS2Protocol */
 #define PROTO_SET_VALUE        "X"
 /** The command is authorization request. @ingroup RTS2Protocol */
@@ -810,6 +812,9 @@ class Block: public App
 		nfds_t pollsize;
 		nfds_t npolls;
 
+		// becomes readable when other threads log messages
+		int threadLogFd;
+
 		// timers - time when they should be executed, event which should be triggered
 		std::map <double, Event*> timers;
 
@@ -25,6 +25,9 @@
 
 #include "scriptdevice.h"
 #include "imghdr.h"
+#include "dataring.h"
+#include "exposuretrace.h"
+#include "tsqueue.h"
 
 #define MAX_CHIPS  3
 #define MAX_DATA_RETRY 100
@@ -231,6 +234,12 @@ class Camera:public rts2core::ScriptDevice
 		virtual int killAll (bool callScriptEnds);
 		virtual int scriptEnds ();
 
+		/**
+		 * Run main loop. Video mode is stopped when the loop ends, while
+		 * the driver still exists.
+		 */
+		virtual int run ();
+
 		/**
 		 * Sets camera cooling temperature. Descendants should call
 		 * Camera::setCoolTemp to make sure that the set temperature is
@@ -460,6 +469,8 @@ class Camera:public rts2core::ScriptDevice
 		 */
 		long getWriteBinaryDataSize ()
 		{
+			if (pipelineActive)
+				return getPipelineRemaining (-1);
 			if (currentImageData < 0 && calculateStatistics->getValueInteger () == STATISTIC_ONLY)
 				// end bytes
 				return calculateDataSize;
@@ -475,6 +486,8 @@ class Camera:public rts2core::ScriptDevice
 		 */
 		long getWriteBinaryDataSize (int chan)
 		{
+			if (pipelineActive)
+				return getPipelineRemaining (chan);
 			if (currentImageData < 0 && calculateStatistics->getValueInteger () == STATISTIC_ONLY)
 				// end bytes
 				return calculateDataSize;
@@ -939,6 +952,53 @@ class Camera:public rts2core::ScriptDevice
 		 */
 		void createShiftStore () { createValue (shiftstoreLines, "shiftstore", "pixels of shiftstore", true); }
 
+		/**
+		 * Indicates camera can stream frames in video (burst) mode. Frames
+		 * are published to the frame ring, so video mode can be started only
+		 * when the camera runs with --frame-ring. Driver calling it in
+		 * constructor must implement startVideo, readVideoFrame and
+		 * stopVideo. Driver which is destroyed without ending run must call
+		 * stopVideoMode in its destructor.
+		 */
+		void createVideoMode ();
+
+		/**
+		 * Start streaming frames from the sensor. Called before
+		 * acquisition thread is started.
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		virtual int startVideo () { return -1; }
+
+		/**
+		 * Read next frame from the sensor. It is called from the
+		 * acquisition thread, so it cannot touch values or connections.
+		 * It should block until the next frame is available, but should
+		 * return in a fraction of second even if no frame arrives, so
+		 * video mode can be stopped.
+		 *
+		 * @param buf      buffer for frame data
+		 * @param bufSize  size of the buffer (chipByteSize () at the start of video mode)
+		 *
+		 * @return 0 if frame was read, 1 if no frame arrived, -1 on error
+		 */
+		virtual int readVideoFrame (char *buf, size_t bufSize) { return -1; }
+
+		/**
+		 * Stop streaming frames. Called after acquisition thread finished.
+		 */
+		virtual int stopVideo () { return 0; }
+
+		/**
+		 * Returns true if camera streams frames in video mode.
+		 */
+		bool isVideoRunning () { return videoPool != NULL; }
+
+		/**
+		 * Stop acquisition thread, publish acquired frames and call stopVideo.
+		 */
+		void stopVideoMode ();
+
 		virtual int shiftStoreStart (rts2core::Connection *conn, float exptime);
 
 		virtual int shiftStoreShift (rts2core::Connection *conn, int shift, float exptime);
@@ -1034,6 +1094,159 @@ class Camera:public rts2core::ScriptDevice
 		int sharedMemNum;
 		rts2core::DataSharedWrite *sharedData;
 
+		// ring of frames in POSIX shared memory, for local high frame rate readers
+		rts2core::DataRingWrite *frameRing;
+		int frameRingSlots;
+		// slot of the frame being read out, NULL if frame is not published to the ring
+		char *ringFrame;
+		rts2core::ValueString *frameRingName;
+		rts2core::ValueLong *ringFrames;
+		rts2core::ValueLong *ringDropped;
+		rts2core::ValueLong *ringFull;
+
+		/**
+		 * Publish frame which was read out to the frame ring.
+		 */
+		void publishRingFrame ();
+
+		/**
+		 * Fill image header with current readout parameters.
+		 */
+		void fillImageHeader (struct imghdr *hdr, int pchan);
+
+		/**
+		 * Add data to sum, min, max and mode statistics.
+		 *
+		 * @return number of pixels processed
+		 */
+		int computeStatistics (char *data, size_t dataSize);
+
+		// video (burst) mode
+		rts2core::ValueBool *videoMode;
+		rts2core::ValueLong *videoBurst;
+		rts2core::ValueInteger *videoPoolSize;
+		rts2core::ValueDouble *videoUpdate;
+		rts2core::ValueInteger *videoStatEvery;
+		rts2core::ValueDouble *videoFps;
+		rts2core::ValueLong *videoAcquired;
+		rts2core::ValueLong *videoDropped;
+
+		// preallocated frame buffers
+		char **videoPool;
+		int videoPoolAllocated;
+		size_t videoFrameSize;
+		// indices of free and filled buffers
+		TSQueue <int> videoFree;
+		TSQueue <int> videoReady;
+
+		pthread_t videoThread;
+		// following are shared with acquisition thread, accessed with atomic builtins
+		bool videoStop;
+		bool videoThreadRunning;
+		bool videoError;
+		long videoAcquiredCount;
+		long videoDroppedCount;
+		long videoStoredCount;
+
+		long videoBurstFrames;
+		long videoProcessed;
+		double videoStart;
+		double videoLastUpdate;
+		long videoLastAcquired;
+
+		int startVideoMode ();
+		void freeVideoPool ();
+
+		/**
+		 * Calculate statistics and publish frames from acquisition thread.
+		 */
+		void processVideoFrames ();
+		void sendVideoValues ();
+
+		static void *videoAcquisition (void *arg);
+
+		// pipelined transfer - data are send while the next exposure is running
+		rts2core::ValueBool *pipeline;
+
+		// frame timing
+		rts2core::ValueDouble *frameCycle;
+		rts2core::ValueDouble *deadTime;
+		rts2core::ValueDouble *dutyCycle;
+		double lastExposureStart;
+		double lastExposureEnd;
+
+		// exposure chain tracing
+		rts2core::ValueTime *traceExposureEnd;
+		rts2core::ValueTime *traceReadoutStart;
+		rts2core::ValueDouble *readoutLatency;
+		rts2core::ValueDouble *transferLatency;
+		rts2core::ValueDoubleStat *nightDeadTime;
+
+		// exposure being taken
+		rts2core::ExposureTrace frameTrace;
+		// exposure being read out
+		rts2core::ExposureTrace readoutTrace;
+		// exposure waiting for pipelined transfer
+		rts2core::ExposureTrace pendingTrace;
+
+		rts2core::TraceHistogram deadTimeHistogram;
+		rts2core::TraceHistogram readoutHistogram;
+		rts2core::TraceHistogram transferHistogram;
+
+		// true if the current readout is buffered for pipelined transfer
+		bool pipelineActive;
+		struct imghdr *frameHeaders;
+
+		// frame waiting for transfer
+		char **pendingBuffers;
+		size_t *pendingWritten;
+		struct imghdr *pendingHeaders;
+		int pendingImageData;
+		rts2core::Connection *pendingConn;
+		int pendingChannels;
+		int pendingChan;
+		size_t pendingSent;
+		double pendingStart;
+
+		/**
+		 * Returns number of bytes driver has to read out in pipelined readout.
+		 *
+		 * @param chan  channel, -1 for all channels
+		 */
+		long getPipelineRemaining (int chan);
+
+		/**
+		 * Move read out frame to pending buffers, so the next readout can proceed.
+		 */
+		void handoffFrame ();
+
+		/**
+		 * Send part of the pending frame.
+		 *
+		 * @param maxBytes  maximal number of data bytes to send
+		 *
+		 * @return -1 on error, 0 when there are more data to send, 1 when frame was sent
+		 */
+		int sendPendingData (size_t maxBytes);
+
+		void flushPendingData ();
+		void dropPendingData ();
+
+		/**
+		 * Update frame cycle, dead time and duty cycle values at exposure start.
+		 */
+		void updateFrameTiming (double now);
+
+		/**
+		 * Update latency values and histograms after frame data were transfered.
+		 */
+		void finishTrace (rts2core::ExposureTrace &trace);
+
+		/**
+		 * Log summary of the night latencies and reset histograms.
+		 */
+		void logNightTrace ();
+
 		// number of exposures camera takes
 		rts2core::ValueLong *exposureNumber;
 		// exposure number inside script
@@ -0,0 +1,227 @@
+/*
+ * Columnar binary log of device values.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_COLUMNLOG__
+#define __RTS2_COLUMNLOG__
+
+#include <istream>
+#include <list>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// chunk magic, RTCL
+#define COLUMNLOG_MAGIC       0x4c435452
+#define COLUMNLOG_VERSION     1
+
+// column types
+#define COLUMNLOG_INTEGER     0
+#define COLUMNLOG_DOUBLE      1
+#define COLUMNLOG_STRING      2
+
+namespace rts2core
+{
+
+class Value;
+
+/**
+ * Returns column type used to log the value.
+ */
+int columnLogType (Value *value);
+
+/**
+ * Decoded column of a chunk.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class ColumnLogColumn
+{
+	public:
+		ColumnLogColumn (const std::string &_name, int _type)
+		{
+			name = _name;
+			type = _type;
+		}
+
+		/**
+		 * Append value at given row to the string.
+		 */
+		void appendValue (std::string &str, size_t row);
+
+		std::string name;
+		int type;
+
+		// only vector of the column type is filled
+		std::vector <int64_t> ints;
+		std::vector <double> doubles;
+		std::vector <std::string> strings;
+};
+
+/**
+ * Decoded chunk - values of a single device with the same set of columns.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class ColumnLogChunk
+{
+	public:
+		std::string device;
+		std::vector <double> times;
+		std::vector <ColumnLogColumn> columns;
+
+		// names of all columns in chunk, including columns which were not decoded
+		std::vector <std::string> names;
+
+		size_t getRows () { return times.size (); }
+
+		/**
+		 * Returns index of decoded column with given name, -1 if not found.
+		 */
+		int findColumn (const char *name);
+
+		void clear ();
+};
+
+/**
+ * Collects rows of device values and writes them as compressed columnar
+ * chunks. Chunk starts with column names and types, taken from value
+ * metadata. Timestamps are stored as delta of deltas of microseconds,
+ * integers as deltas, doubles as XOR with the previous value (only the
+ * changed bytes are written) and strings only when they change, all
+ * with variable length integer encoding. Regularly sampled slowly
+ * changing values thus take one or two bytes per sample.
+ *
+ * Chunks are self contained, so chunks of different devices can be
+ * appended to the same file.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class ColumnLogWriter
+{
+	public:
+		ColumnLogWriter (const char *_device);
+
+		/**
+		 * Add row of values. Column names and types are set by the first
+		 * row of the chunk.
+		 *
+		 * @param t       row time (ctime)
+		 * @param values  values, in the same order for all rows
+		 *
+		 * @return -1 if values do not match chunk columns, 0 on success
+		 */
+		int addRow (double t, std::list <Value *> &values);
+
+		/**
+		 * Returns true if values match columns of the current chunk.
+		 */
+		bool sameColumns (std::list <Value *> &values);
+
+		size_t getRows () { return rows; }
+
+		/**
+		 * Returns time of the first row in the current chunk.
+		 */
+		double getFirstTime () { return firstTime; }
+
+		/**
+		 * Write collected rows as a chunk and start a new chunk. Does
+		 * nothing if there are no rows.
+		 *
+		 * @return -1 on write error, 0 on success
+		 */
+		int write (std::ostream &os);
+
+		/**
+		 * Returns encoded chunk, including chunk header.
+		 */
+		std::string encode ();
+
+	private:
+		std::string device;
+		std::vector <std::string> names;
+		std::vector <int> types;
+
+		size_t rows;
+		double firstTime;
+
+		std::string timeBuf;
+		int64_t lastTime;
+		int64_t lastDelta;
+
+		std::vector <std::string> colBufs;
+		std::vector <int64_t> lastInts;
+		std::vector <uint64_t> lastDoubles;
+		std::vector <std::string> lastStrings;
+
+		void reset ();
+};
+
+/**
+ * Reads chunks written by ColumnLogWriter.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class ColumnLogReader
+{
+	public:
+		ColumnLogReader (std::istream &_is);
+
+		/**
+		 * Read only chunks of given device.
+		 */
+		void setDevice (const char *_device) { device = _device; }
+
+		/**
+		 * Decode only given column. If no column is added, all columns are decoded.
+		 */
+		void addColumn (const char *name) { columns.push_back (std::string (name)); }
+
+		/**
+		 * Read next chunk.
+		 *
+		 * @return 1 if chunk was read, 0 on end of file, -1 on error
+		 */
+		int readChunk (ColumnLogChunk &chunk);
+
+		/**
+		 * Returns number of bytes skipped because of corrupted or truncated chunks.
+		 */
+		uint64_t getSkipped () { return skipped; }
+
+		/**
+		 * Decode chunk payload (without chunk header).
+		 *
+		 * @return -1 on corrupted payload, 0 on success, 1 if the chunk was filtered out
+		 */
+		int decode (const std::string &payload, ColumnLogChunk &chunk);
+
+	private:
+		std::istream &is;
+		std::string device;
+		std::vector <std::string> columns;
+		uint64_t skipped;
+
+		bool selected (const std::string &name);
+};
+
+}
+
+#endif // !__RTS2_COLUMNLOG__
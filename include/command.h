@@ -47,6 +47,24 @@
  */
 #define COMMAND_INFO            "info"
 
+/**
+ * Request binary value frames. @ingroup RTS2Command
+ *
+ * Takes version of binary frames as parameter. If device accepts the
+ * command, it sends value updates in PROTO_VALUE_FRAME binary frames.
+ */
+#define COMMAND_BINARY_VALUES   "binary_values"
+
+/**
+ * Subscribe to values. @ingroup RTS2Command
+ *
+ * Parameters are minimal interval between updates of a single value (in
+ * seconds, 0 for no limit), followed by value name patterns. Device sends
+ * to the connection only updates of matching values. Command without
+ * patterns subscribes to all values.
+ */
+#define COMMAND_SUBSCRIBE       "subscribe"
+
 
 /**
  * Move command. @ingroup RTS2Command
@@ -426,11 +444,7 @@ class CommandSendKey:public Command
 		CommandSendKey (Block * _master, int _centrald_id, int _centrald_num, int _key);
 		virtual int send ();
 
-		virtual int commandReturnOK (Connection * conn)
-		{
-			connection->setConnState (CONN_AUTH_OK);
-			return -1;
-		}
+		virtual int commandReturnOK (Connection * conn);
 		virtual int commandReturnFailed (int status, Connection * conn)
 		{
 			connection->setConnState (CONN_AUTH_FAILED);
@@ -438,6 +452,33 @@ class CommandSendKey:public Command
 		}
 };
 
+/**
+ * Ask device to send value updates in binary frames. Devices which do not
+ * understand the command return an error, and the connection continues to
+ * receive text updates.
+ *
+ * @ingroup RTS2Command
+ */
+class CommandBinaryValues:public Command
+{
+	public:
+		CommandBinaryValues (Block * _master);
+		virtual int commandReturnFailed (int status, Connection * conn) { return -1; }
+};
+
+/**
+ * Send value subscription. Devices which do not understand the command
+ * return an error and continue to send all values.
+ *
+ * @ingroup RTS2Command
+ */
+class CommandSubscribe:public Command
+{
+	public:
+		CommandSubscribe (Block * _master, ValueSubscription *subscription);
+		virtual int commandReturnFailed (int status, Connection * conn) { return -1; }
+};
+
 /**
  * Send authorization query to centrald daemon.
  *
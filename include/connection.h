@@ -41,6 +41,8 @@
 #include "message.h"
 #include "logstream.h"
 #include "valuelist.h"
+#include "valueframe.h"
+#include "valuesubscription.h"
 
 #define MAX_DATA    2000
 
@@ -233,6 +235,73 @@ class Connection:public Object
 		int sendMsg (std::string msg);
 		int sendMsg (std::ostringstream &_os);
 
+		/**
+		 * Send frame of already encoded messages. Each message in the
+		 * frame must be terminated with a new line.
+		 *
+		 * @param frame  encoded messages
+		 *
+		 * @return -1 on error, 0 on sucess
+		 */
+		virtual int sendFrame (const std::string &frame);
+
+		/**
+		 * Send value updates. If the other side requested binary
+		 * frames, values are send in PROTO_VALUE_FRAME, preceded by
+		 * names of values not yet send over the connection. Otherwise
+		 * text PROTO_VALUE messages are send.
+		 *
+		 * If the other side subscribed to values, only values matching
+		 * the subscription are send.
+		 *
+		 * @param frame      values to send
+		 * @param rateLimit  if false, subscription rate limit is not applied
+		 *
+		 * @return -1 on error, 0 on sucess
+		 */
+		int sendValueFrame (ValueFrame &frame, bool rateLimit = true);
+
+		/**
+		 * Enable or disable sending of binary value frames to the
+		 * connection.
+		 */
+		void setBinaryValues (bool binary)
+		{
+			binaryValues = binary;
+			binaryDefined.clear ();
+		}
+
+		bool getBinaryValues () { return binaryValues; }
+
+		/**
+		 * Set values subscription requested by the other side.
+		 *
+		 * @param _subscription  subscription, NULL to send all values. Connection takes ownership.
+		 */
+		void setSubscription (ValueSubscription *_subscription);
+
+		/**
+		 * Request value subscription from the other side. The request
+		 * is send immediately if the connection is authorized, and after
+		 * every (re)authorization.
+		 *
+		 * @param _subscription  requested values and rate. Connection takes ownership.
+		 */
+		void subscribe (ValueSubscription *_subscription);
+
+		ValueSubscription *getSubscriptionRequest () { return subscriptionRequest; }
+
+		/**
+		 * Returns time when value withheld by subscription rate limit can be send,
+		 * NAN if no value is withheld.
+		 */
+		double getPendingTime () { return subscription ? subscription->getPendingTime () : NAN; }
+
+		/**
+		 * Return IDs of withheld values which can be send now.
+		 */
+		void getPendingValues (double now, std::vector <int> &ids);
+
 		/**
 		 * Switch connection to binary connection.
 		 *
@@ -512,11 +581,40 @@ class Connection:public Object
 		 */
 		Value *getValue (const char *value_name);
 
+		/**
+		 * Returns ID of value name. IDs are small integers, which do
+		 * not change while the connection exists, so they can be
+		 * used instead of repeated searches by name.
+		 *
+		 * @return value ID, -1 if value with given name was never received
+		 */
+		int getValueId (const char *value_name) { return values.getValueId (value_name); }
+
+		/**
+		 * Returns value with given ID.
+		 *
+		 * @return value, NULL if value with given ID does not exists (was removed)
+		 */
+		Value *getValueById (int id) { return values.getValueById (id); }
+
 		/**
 		 * Returns true if connection has given value.
 		 */
 		bool hasValue (Value *val) { return std::find (values.begin (), values.end (), val) != values.end (); }
 
+		/**
+		 * Returns counter which changes when value is added to or
+		 * removed from any connection, or when connection is deleted.
+		 * Holders of Value pointers found by name shall look them up
+		 * again when the counter changes.
+		 */
+		static uint32_t getValuesEpoch () { return valuesEpoch; }
+
+		/**
+		 * Invalidate Value pointers found by name.
+		 */
+		static void changeValuesEpoch () { valuesEpoch++; }
+
 		/**
 		 * Returns value with given name and type. Throw error if such value does not exists.
 		 *
@@ -772,6 +870,8 @@ class Connection:public Object
 		inline int isCommandReturn () { return (*(getCommand ()) == '+' || *(getCommand ()) == '-'); }
 
 	private:
+		static uint32_t valuesEpoch;
+
 		char *full_data_end;	 // points to end of full data
 
 		conn_type_t type;
@@ -804,6 +904,29 @@ class Connection:public Object
 		int activeReadData;
 		int activeReadChannel;
 
+		// send binary value frames
+		bool binaryValues;
+		// values IDs, for which name was send in binary frame
+		std::vector <bool> binaryDefined;
+
+		// size of binary value frame being received, -1 if no frame is expected
+		long binaryFrameSize;
+		std::string binaryFrame;
+		// maps IDs of the other side to IDs of values
+		std::vector <int> binaryIds;
+
+		// values subscribed by the other side
+		ValueSubscription *subscription;
+		// values we would like to receive
+		ValueSubscription *subscriptionRequest;
+
+		/**
+		 * Process received binary value frame.
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int processValueFrame ();
+
 		rts2core::DataSharedRead *sharedReadMemory;
 
 		std::map <int, DataAbstractWrite *> writeChannels;
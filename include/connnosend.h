@@ -45,6 +45,7 @@ class ConnNoSend:public Connection
 		virtual ~ConnNoSend (void);
 
 		virtual int sendMsg (const char *msg);
+		virtual int sendFrame (const std::string &frame);
 };
 
 }
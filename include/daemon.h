@@ -131,6 +131,14 @@ class Daemon:public Block
 		void constInfoAll ();
 		int sendInfo (Connection * conn, bool forceSend = false);
 
+		/**
+		 * Add changed values to a single frame.
+		 *
+		 * @param frame      frame to which values are added
+		 * @param forceSend  when true, all values are added
+		 */
+		void encodeInfo (ValueFrame &frame, bool forceSend = false);
+
 		int sendMetaInfo (Connection * conn);
 
 		virtual void addPollSocks ();
@@ -340,6 +348,16 @@ class Daemon:public Block
 		 */
 		CondValue *getCondValue (const Value *val);
 
+		/**
+		 * Return ID of the value used in binary value frames.
+		 */
+		int getValueFrameId (Value *val);
+
+		/**
+		 * Return value with given binary frame ID, NULL if there isn't such value.
+		 */
+		Value *getValueByFrameId (int id);
+
 		/**
 		 * Duplicate variable.
 		 *
@@ -697,6 +715,20 @@ class Daemon:public Block
 
 		double idleInfoInterval;
 
+		// time of timer sending values withheld by subscriptions, NAN if there isn't such timer
+		double subscriptionFlushTime;
+
+		/**
+		 * Add timer to send withheld values, if connection withheld
+		 * some value updates.
+		 */
+		void scheduleSubscriptionFlush (Connection *conn);
+
+		/**
+		 * Send values withheld by subscriptions whose rate limit expired.
+		 */
+		void flushSubscriptions ();
+
 		bool doHupIdleLoop;
 
 		// mode related variable
@@ -21,7 +21,10 @@
 #define __RTS2_DATA__
 
 #include <errno.h>
+#include <math.h>
+#include <string.h>
 #include <unistd.h>
+#include <map>
 #include <vector>
 
 // maximal number of shared clients
@@ -362,7 +365,7 @@ class DataSharedWrite:public DataAbstractWrite, public DataAbstractShared
 class DataChannels:public std::vector <DataAbstractRead *>
 {
 	public:
-		DataChannels () {}
+		DataChannels () { dataStart = NAN; dataEnd = NAN; }
 		~DataChannels ();
 
 		/**
@@ -395,6 +398,16 @@ class DataChannels:public std::vector <DataAbstractRead *>
 		size_t getChunkSize (int chan) { return at(chan)->getChunkSize (); }
 
 		size_t getRestSize ();
+
+		/**
+		 * Time (traceNow) when the first data chunk was received.
+		 */
+		double dataStart;
+
+		/**
+		 * Time (traceNow) when all data were received.
+		 */
+		double dataEnd;
 };
 
 }
@@ -0,0 +1,284 @@
+/*
+ * Lock-free POSIX shared memory ring buffer for camera frames.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_DATARING__
+#define __RTS2_DATARING__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#include "data.h"
+
+// magic number at the begining of the ring memory
+#define DATARING_MAGIC           0x52325247
+// maximal number of readers attached to single ring
+#define DATARING_MAX_READERS     MAX_SHARED_CLIENTS
+
+namespace rts2core
+{
+
+/**
+ * Reader cursor. Reader is free when client is 0.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+struct DataRingReader
+{
+	// process ID of the reader, 0 if the entry is unused
+	int32_t client;
+	// when non-zero, writer will never overwrite frame the reader has not yet released
+	int32_t critical;
+	// sequence number of the next frame reader will process
+	uint64_t cursor;
+	// number of frames skipped because the reader was too slow
+	uint64_t dropped;
+};
+
+/**
+ * Header of a single ring slot.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+struct DataRingSlot
+{
+	// sequence number of frame stored in the slot, 0 while the slot is being written
+	uint64_t seq;
+	// number of bytes written to the slot
+	uint64_t size;
+	// time (ctime with fractional part) when the frame was published
+	double timestamp;
+	uint64_t pad;
+};
+
+/**
+ * Ring header, placed at the begining of the shared memory. Slots follow the header.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+struct DataRingHeader
+{
+	uint32_t magic;
+	// number of slots
+	uint32_t nslots;
+	// size of slot data, without DataRingSlot
+	uint64_t slotSize;
+	// number of channels stored in every slot
+	uint32_t channels;
+	// futex word, increased with every published frame
+	uint32_t futex;
+	// sequence number of the last published frame; frames are numbered from 1
+	uint64_t writeSeq;
+	struct DataRingReader readers[DATARING_MAX_READERS];
+};
+
+/**
+ * Ring buffer of frames in POSIX shared memory. Single writer (camera
+ * daemon) publishes frames, multiple readers in other processes access
+ * frames in place, without any copy.
+ *
+ * Frames are identified by monotonically increasing sequence numbers.
+ * Each slot records sequence of the frame it holds, writer invalidates it
+ * before overwriting slot, so reader can verify the frame was not
+ * overwritten while it was processed. Readers keep their cursor in the
+ * shared header. Non-critical readers lagging more than number of slots
+ * behind the writer have their cursor moved forward (drop-oldest policy),
+ * critical readers stop the writer from overwriting frames they have not
+ * yet released. Readers wait for new frames on futex.
+ *
+ * Each slot is split to channels, every channel starts with imghdr
+ * followed by channel data.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class DataRing
+{
+	public:
+		DataRing ();
+		virtual ~DataRing ();
+
+		/**
+		 * Returns ring shared memory name.
+		 */
+		const char *getName () { return name.c_str (); }
+
+		int getSlots () { return header ? header->nslots : 0; }
+		size_t getSlotSize () { return header ? header->slotSize : 0; }
+		int getChannels () { return header ? header->channels : 0; }
+
+		/**
+		 * Returns size of single channel (including imghdr) inside the slot.
+		 */
+		size_t getChannelStride () { return header ? header->slotSize / header->channels : 0; }
+
+		/**
+		 * Returns sequence number of the last published frame.
+		 */
+		uint64_t getWriteSeq ();
+
+		/**
+		 * Returns number of attached readers.
+		 */
+		int getReaders ();
+
+		/**
+		 * Returns pointer to channel data (including imghdr) inside the slot data.
+		 */
+		char *getChannel (char *slotData, int chan) { return slotData + chan * getChannelStride (); }
+
+	protected:
+		struct DataRingHeader *header;
+		std::string name;
+		size_t mapSize;
+		int fd;
+
+		struct DataRingSlot *getSlot (uint64_t seq);
+		char *getSlotData (struct DataRingSlot *slot) { return ((char *) slot) + sizeof (struct DataRingSlot); }
+
+		void unmap ();
+};
+
+/**
+ * Writer (camera daemon) side of the ring.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class DataRingWrite:public DataRing
+{
+	public:
+		DataRingWrite ();
+		virtual ~DataRingWrite ();
+
+		/**
+		 * Create new ring. Any existing ring with the same name is removed.
+		 *
+		 * @param _name      shared memory name, must start with /
+		 * @param nslots     number of slots
+		 * @param chanSize   size of a single channel (including imghdr)
+		 * @param channels   number of channels in a frame
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int create (const char *_name, int nslots, size_t chanSize, int channels);
+
+		/**
+		 * Reserve slot for the next frame.
+		 *
+		 * @return pointer to slot data, NULL if slot cannot be reused as a critical reader has not yet processed it
+		 */
+		char *beginFrame ();
+
+		/**
+		 * Publish frame started with beginFrame and wake up all waiting readers.
+		 *
+		 * @param size   number of bytes written to the slot
+		 */
+		void publishFrame (size_t size);
+
+		/**
+		 * Abandon frame started with beginFrame. The slot will be reused for the next frame.
+		 */
+		void abortFrame () { current = NULL; }
+
+		/**
+		 * Returns total number of frames which readers dropped.
+		 */
+		uint64_t getDropped ();
+
+	private:
+		struct DataRingSlot *current;
+		uint64_t currentSeq;
+};
+
+/**
+ * Reader side of the ring.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class DataRingRead:public DataRing
+{
+	public:
+		DataRingRead ();
+		virtual ~DataRingRead ();
+
+		/**
+		 * Attach to existing ring and register as a reader. Reader starts with the next published frame.
+		 *
+		 * @param _name     shared memory name
+		 * @param critical  if true, writer will not overwrite frames until they are released by the reader
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int attach (const char *_name, bool critical = false);
+
+		/**
+		 * Wait for next frame.
+		 *
+		 * @param timeout  timeout in seconds, negative to wait forever
+		 *
+		 * @return frame data, NULL on timeout
+		 */
+		char *waitFrame (double timeout);
+
+		/**
+		 * Skip frames published before the last one and wait for it. Used
+		 * by readers interested only in current frame, e.g. for previews.
+		 *
+		 * @param timeout  timeout in seconds, negative to wait forever
+		 *
+		 * @return frame data, NULL if no new frame was published within timeout
+		 */
+		char *latestFrame (double timeout);
+
+		/**
+		 * Returns sequence number of the frame returned by waitFrame.
+		 */
+		uint64_t getFrameSeq () { return frameSeq; }
+
+		/**
+		 * Returns size of the frame returned by waitFrame.
+		 */
+		size_t getFrameSize () { return frameSize; }
+
+		double getFrameTime () { return frameTime; }
+
+		/**
+		 * Release frame returned by waitFrame.
+		 *
+		 * @return -1 if the frame was overwritten while it was processed (and its data are therefore invalid), 0 on success
+		 */
+		int releaseFrame ();
+
+		/**
+		 * Returns number of frames the reader missed.
+		 */
+		uint64_t getDropped ();
+
+	private:
+		int reader;
+		uint64_t frameSeq;
+		size_t frameSize;
+		double frameTime;
+
+		struct DataRingReader *getReader () { return header->readers + reader; }
+};
+
+}
+
+#endif // !__RTS2_DATARING__
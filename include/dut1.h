@@ -19,6 +19,12 @@
  */
 
 #include <time.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+#include <string>
+#include <vector>
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,6 +48,89 @@ double getDUT1 (const char *fn, struct tm *gmdate);
 
 #ifdef __cplusplus
 };
+
+namespace rts2core
+{
+
+/**
+ * Earth orientation parameters for one day.
+ */
+struct EOPEntry
+{
+	// modified Julian date of 0h UTC
+	double mjd;
+	// polar motion, arcseconds
+	double xp;
+	double yp;
+	// UT1 - UTC, seconds
+	double dut1;
+};
+
+/**
+ * In-memory table of Earth orientation parameters. IERS finals2000A
+ * (Bulletin A) file is parsed once, values for given instant are
+ * interpolated from the table. File is reloaded only when it changes.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class EOPTable
+{
+	public:
+		EOPTable ();
+
+		/**
+		 * Load table from finals2000A file.
+		 *
+		 * @return number of days loaded, -1 on error
+		 */
+		int load (const char *fn);
+
+		/**
+		 * Load table if it was not loaded yet, or if the file was
+		 * changed since the last load.
+		 *
+		 * @return 0 if table was not changed, 1 if it was reloaded, -1 on error
+		 */
+		int reload (const char *fn);
+
+		/**
+		 * Interpolate Earth orientation parameters for given instant.
+		 * DUT1 leap second jumps are respected. Polar motion is NAN if
+		 * not available in the table.
+		 *
+		 * @param JD    Julian date (UTC)
+		 * @param dut1  returned UT1 - UTC, seconds
+		 * @param xp    returned polar motion X, arcseconds
+		 * @param yp    returned polar motion Y, arcseconds
+		 *
+		 * @return false if JD is outside of the table
+		 */
+		bool getEOP (double JD, double &dut1, double &xp, double &yp);
+
+		/**
+		 * Returns interpolated DUT1, NAN if JD is outside of the table.
+		 */
+		double getDUT1 (double JD);
+
+		size_t size () { return entries.size (); }
+
+		void clear ();
+
+	private:
+		std::vector <EOPEntry> entries;
+
+		std::string filename;
+		dev_t fileDev;
+		ino_t fileIno;
+		off_t fileSize;
+		struct timespec fileMtime;
+
+		// index of the entry before given MJD, -1 if outside of the table
+		ssize_t findEntry (double mjd);
+};
+
+}
+
 #endif
 
 #endif //!__RTS2_DUT1__
@@ -0,0 +1,182 @@
+/*
+ * Tabulated Sun, Moon and planets ephemeris.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_EPHEMCACHE__
+#define __RTS2_EPHEMCACHE__
+
+#include <libnova/ln_types.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#define EPHEM_MAGIC       0x45504831
+
+namespace rts2core
+{
+
+/**
+ * Bodies in the ephemeris table. Order follows planets table of
+ * rts2db::TargetPlanet.
+ */
+typedef enum
+{
+	EPHEM_SUN = 0,
+	EPHEM_MERCURY,
+	EPHEM_VENUS,
+	EPHEM_MOON,
+	EPHEM_MARS,
+	EPHEM_JUPITER,
+	EPHEM_SATURN,
+	EPHEM_URANUS,
+	EPHEM_NEPTUNE,
+	EPHEM_PLUTO,
+	EPHEM_BODIES
+} ephem_body_t;
+
+/**
+ * Table header. The same structure is used for private tables and for
+ * tables in shared memory, followed by EPHEM_BODIES * size entries.
+ * Each entry holds RA (continuous, not wrapped at 360), DEC, altitude
+ * and phase (degrees).
+ */
+struct EphemerisTable
+{
+	uint32_t magic;
+	// number of entries allocated for each body
+	uint32_t size;
+	// odd while table is being updated
+	uint32_t seq;
+	// bit mask of tabulated bodies
+	uint32_t bodies;
+	double lng;
+	double lat;
+	// JD of the first entry
+	double start;
+	// step between entries, in days
+	double step;
+};
+
+/**
+ * Ephemeris of the Sun, Moon and planets tabulated over the night. Bodies
+ * are tabulated when first requested, values for given JD are
+ * interpolated from four nearest entries. Table is moved when JD outside
+ * of it is requested.
+ *
+ * Table can be placed to POSIX shared memory, so all daemons on the
+ * machine use values calculated only once. Updates are protected with
+ * sequence lock; readers never block writer.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class EphemerisCache
+{
+	public:
+		/**
+		 * @param _step     table step in seconds
+		 * @param _length   table length in days
+		 */
+		EphemerisCache (double _step = 300, double _length = 2);
+		~EphemerisCache ();
+
+		/**
+		 * Returns process wide cache for observer from configuration.
+		 * If observatory/ephemeris_shm is set, the table is shared
+		 * through shared memory of that name.
+		 */
+		static EphemerisCache *instance ();
+
+		void setObserver (struct ln_lnlat_posn *_observer);
+
+		/**
+		 * Attach table in shared memory. Segment is created if it does
+		 * not exist.
+		 *
+		 * @return 0 on success, -1 on error; private table is used on error
+		 */
+		int attachShared (const char *_name);
+
+		/**
+		 * Tabulate bodies for given JD. Called automatically, can be used
+		 * to prepare table in advance.
+		 *
+		 * @param JD      JD which shall be in the table
+		 * @param bodies  bit mask of bodies (1 << EPHEM_SUN ..)
+		 */
+		void prepare (double JD, uint32_t bodies);
+
+		/**
+		 * Geocentric equatorial coordinates, as from ln_get_xxx_equ_coords.
+		 */
+		void getEquCoords (ephem_body_t body, double JD, struct ln_equ_posn *pos);
+
+		/**
+		 * Altitude of the body, as ln_get_hrz_from_equ of its equatorial coordinates.
+		 */
+		double getAltitude (ephem_body_t body, double JD);
+
+		/**
+		 * Lunar phase, as from ln_get_lunar_phase. Phase has minimum at
+		 * full moon, interpolation error around it is up to 0.05 degree.
+		 */
+		double getLunarPhase (double JD);
+
+		/**
+		 * Returns number of table recalculations. Calculations by other
+		 * processes sharing the table are not counted.
+		 */
+		int getRecalculations () { return recalculations; }
+
+		bool isShared () { return fd >= 0; }
+
+	private:
+		double step;
+		double length;
+		// number of entries for each body
+		size_t size;
+
+		struct ln_lnlat_posn observer;
+
+		struct EphemerisTable *table;
+		double *entries;
+
+		std::string name;
+		int fd;
+		size_t mapSize;
+
+		int recalculations;
+
+		void allocPrivate ();
+
+		// check that table holds body around given JD
+		bool covers (ephem_body_t body, double JD);
+
+		// calculate body entries and store them to table
+		void tabulate (ephem_body_t body, double JD);
+
+		/**
+		 * Interpolate values at JD.
+		 *
+		 * @param ret  RA, DEC, altitude and phase
+		 */
+		void interpolate (ephem_body_t body, double JD, double ret[4]);
+};
+
+}
+
+#endif // !__RTS2_EPHEMCACHE__
@@ -99,6 +99,9 @@
 /** Timeout for closign sequence. */
 #define EVENT_CLOSE_TIMEOUT              27
 
+/** Send value updates withheld by subscription rate limits. */
+#define EVENT_SUBSCRIPTION_FLUSH         28
+
 // events number below that number shoudl be considered RTS2-reserved
 #define RTS2_LOCAL_EVENT         1000
 
@@ -0,0 +1,153 @@
+/*
+ * Timestamps of the exposure processing chain.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_EXPOSURETRACE__
+#define __RTS2_EXPOSURETRACE__
+
+#include <ostream>
+
+// number of histogram bins; bins are logarithmic, starting at 1 ms, each
+// next bin is twice wider, the last bin holds everything above 2^18 ms
+#define TRACE_HISTOGRAM_BINS     20
+
+namespace rts2core
+{
+
+/**
+ * Stages of the exposure chain. Stages up to TRACE_TRANSFER_END are
+ * recorded by the camera daemon, the rest by the client which receives
+ * and saves the image.
+ */
+typedef enum
+{
+	TRACE_EXPOSURE_START,
+	TRACE_EXPOSURE_END,
+	TRACE_READOUT_START,
+	TRACE_READOUT_END,
+	TRACE_TRANSFER_END,
+	TRACE_DATA_START,
+	TRACE_DATA_END,
+	TRACE_FITS_WRITTEN,
+	TRACE_IMAGE_SAVED,
+	TRACE_PROCESSED,
+	TRACE_STAGES
+} traceStage_t;
+
+/**
+ * Returns time for trace stamps. Time is taken from monotonic clock, so
+ * intervals between stamps are not affected by system time changes, and
+ * shifted by constant offset to ctime, so it can be compared with stamps
+ * recorded by other processes.
+ *
+ * @return ctime (seconds from 1.1.1970) with fractional part
+ */
+double traceNow ();
+
+/**
+ * Timestamps of a single exposure, from the start of the exposure to the
+ * moment the image was processed.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class ExposureTrace
+{
+	public:
+		ExposureTrace () { clear (); }
+
+		/**
+		 * Clear all stamps.
+		 */
+		void clear ();
+
+		/**
+		 * Record current time as the time of the stage.
+		 */
+		void mark (traceStage_t stage) { stamps[stage] = traceNow (); }
+
+		void set (traceStage_t stage, double t) { stamps[stage] = t; }
+
+		double get (traceStage_t stage) { return stamps[stage]; }
+
+		/**
+		 * Returns interval between two stages.
+		 *
+		 * @return interval in seconds, NAN if any of the stages was not recorded
+		 */
+		double interval (traceStage_t from, traceStage_t to);
+
+		/**
+		 * Returns short name of the stage, used in logs.
+		 */
+		static const char *getStageName (traceStage_t stage);
+
+		friend std::ostream & operator << (std::ostream & _os, ExposureTrace & trace);
+
+	private:
+		double stamps[TRACE_STAGES];
+};
+
+/**
+ * Latency histogram, used to summarize intervals over the night.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class TraceHistogram
+{
+	public:
+		TraceHistogram () { clear (); }
+
+		void clear ();
+
+		/**
+		 * Add interval to the histogram. NAN and negative intervals are ignored.
+		 *
+		 * @param interval   interval in seconds
+		 */
+		void add (double interval);
+
+		unsigned int getCount () { return count; }
+		double getSum () { return sum; }
+		double getMax () { return max; }
+
+		/**
+		 * Returns upper bound of the bin holding the given percentile.
+		 *
+		 * @param p   percentile (0-100)
+		 *
+		 * @return interval in seconds, NAN if histogram is empty
+		 */
+		double getPercentile (double p);
+
+		/**
+		 * Returns upper bound of the bin in seconds.
+		 */
+		static double getBinLimit (int bin);
+
+		friend std::ostream & operator << (std::ostream & _os, TraceHistogram & hist);
+
+	private:
+		unsigned int bins[TRACE_HISTOGRAM_BINS];
+		unsigned int count;
+		double sum;
+		double max;
+};
+
+}
+
+#endif // !__RTS2_EXPOSURETRACE__
@@ -23,19 +23,33 @@
 #include "block.h"
 #include "error.h"
 
+#include <map>
 #include <ostream>
+#include <vector>
 
 namespace rts2expression
 {
 
 typedef enum {OR, AND, XOR, EQU, LT, LEQU, GT, GEQU, NEQ} op_t;
 
+/**
+ * Returns result of binary operation.
+ */
+double applyOp (op_t op, double v1, double v2);
+
+class CompiledExpression;
+
 class Expression
 {
 	public:
 		virtual ~Expression () {};
 		virtual double evaluate () = 0;
 
+		/**
+		 * Append bytecode of the expression to compiled expression.
+		 */
+		virtual void compile (CompiledExpression &ce) = 0;
+
 		virtual Expression* add (op_t _op);
 		virtual Expression* add (Expression *_exp) { throw rts2core::Error ("missing operand"); }
 
@@ -51,6 +65,7 @@ class ExpressionPair:public Expression
 		ExpressionPair (Expression *_exp1, op_t _op, Expression *_exp2) { exp1 = _exp1; op = _op; exp2 = _exp2; }
 		virtual ~ExpressionPair () { delete exp1; delete exp2; }
 		virtual double evaluate ();
+		virtual void compile (CompiledExpression &ce);
 
 		virtual Expression *add (op_t _op);
 		virtual Expression *add (Expression *_exp);
@@ -67,6 +82,7 @@ class ExpressionConst:public Expression
 	public:
 		ExpressionConst (double _val) { val = _val; }
 		virtual double evaluate () { return val; }
+		virtual void compile (CompiledExpression &ce);
 	private:
 		double val;
 };
@@ -80,6 +96,7 @@ class ExpressionValue:public Expression
 			valueName = std::string (_value);
 		}
 		virtual double evaluate ();
+		virtual void compile (CompiledExpression &ce);
 	private:
 		std::string deviceName;
 		std::string valueName;
@@ -91,6 +108,159 @@ class ExpressionErrorValueMissing:public rts2core::Error
 		ExpressionErrorValueMissing (const char *_device, const char *_value): rts2core::Error() { setMsg (std::string ("missing value ") + _device + "." + _value); }
 };
 
+/**
+ * Expression compiled to flat bytecode, evaluated on a small stack. Values
+ * are found by name only when they are first needed and again after
+ * connection values change (see rts2core::Connection::getValuesEpoch).
+ * Constant subexpressions are folded during compilation. AND and OR
+ * evaluate their right side only when needed, as in the expression tree.
+ *
+ * When the expression is added to ExpressionIndex, its result is cached
+ * and recomputed only after one of its input values changes.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class CompiledExpression
+{
+	public:
+		/**
+		 * Compile expression tree. The tree is not used after compilation.
+		 */
+		CompiledExpression (Expression *exp);
+
+		/**
+		 * Parse and compile expression. Throws rts2core::Error on parsing error.
+		 */
+		CompiledExpression (const char *str);
+
+		/**
+		 * Evaluate expression. Throws ExpressionErrorValueMissing if an
+		 * input value does not exist.
+		 */
+		double evaluate ();
+
+		/**
+		 * Find input values by name.
+		 */
+		void bind ();
+
+		/**
+		 * Force recomputation on next evaluate call.
+		 */
+		void invalidate () { dirty = true; }
+
+		/**
+		 * Returns true if the expression was folded to a constant.
+		 */
+		bool isConst () { return code.size () == 1 && code[0].code == I_CONST; }
+
+		size_t getCodeSize () { return code.size (); }
+		size_t getInputs () { return inputs.size (); }
+
+		// used by Expression::compile
+		size_t size () { return code.size (); }
+		void truncate (size_t start) { code.resize (start); }
+
+		/**
+		 * Returns true if code from start to the end is a single constant.
+		 */
+		bool getConst (size_t start, double &val);
+
+		void emitConst (double val);
+		void emitValue (const std::string &device, const std::string &value);
+		void emitBinary (op_t op);
+
+		/**
+		 * Convert value to boolean, folds constant starting at start.
+		 */
+		void emitBool (size_t start);
+
+		/**
+		 * Emit jump for AND or OR, taken if left side decides the result.
+		 *
+		 * @return jump position for patchJump
+		 */
+		size_t emitJump (op_t op);
+
+		/**
+		 * Set jump target to the current end of the code.
+		 */
+		void patchJump (size_t jump) { code[jump].arg = code.size (); }
+
+	private:
+		// instruction codes; binary operations use op_t values
+		enum {I_CONST = 16, I_VALUE, I_JUMP_TRUE, I_JUMP_FALSE, I_BOOL};
+
+		struct Instruction
+		{
+			int code;
+			int arg;
+			double val;
+		};
+
+		struct Input
+		{
+			std::string device;
+			std::string value;
+			rts2core::Value *val;
+		};
+
+		std::vector <Instruction> code;
+		std::vector <Input> inputs;
+		std::vector <double> stack;
+
+		bool bound;
+		uint32_t epoch;
+
+		bool tracked;
+		bool dirty;
+		double result;
+
+		void compile (Expression *exp);
+
+		friend class ExpressionIndex;
+};
+
+/**
+ * Holds compiled expressions and values they depend on, so expression
+ * results are recomputed only after their inputs change. Owner must call
+ * valueChanged for every changed value.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class ExpressionIndex
+{
+	public:
+		ExpressionIndex () { indexed = false; epoch = 0; }
+		~ExpressionIndex () { clear (); }
+
+		/**
+		 * Add expression. Index takes ownership of the expression.
+		 */
+		void add (CompiledExpression *exp);
+
+		/**
+		 * Delete all expressions.
+		 */
+		void clear ();
+
+		/**
+		 * Invalidate results of expressions which depend on the value.
+		 */
+		void valueChanged (rts2core::Value *val);
+
+		size_t size () { return expressions.size (); }
+
+	private:
+		std::vector <CompiledExpression *> expressions;
+		std::map <rts2core::Value *, std::vector <CompiledExpression *> > dependencies;
+
+		bool indexed;
+		uint32_t epoch;
+
+		void reindex ();
+};
+
 }
 
 rts2expression::Expression * parseExpression (const char *str);
@@ -0,0 +1,211 @@
+/*
+ * Pointing model fitting.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_GPOINTFIT__
+#define __RTS2_GPOINTFIT__
+
+#include "gpointmodel.h"
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace rts2telmodel
+{
+
+/**
+ * Single pointing observation. All values are in radians. Target (a_)
+ * and real (r_) positions are in model axes - az/el for alt-az, ha/dec
+ * for GEM models. Target position in other axes is used for extra terms.
+ */
+struct GPointObservation
+{
+	double a_x;
+	double a_y;
+	double r_x;
+	double r_y;
+
+	double az;
+	double el;
+	double ha;
+	double dec;
+
+	bool active;
+};
+
+/**
+ * Least squares fit of the GPoint model. Reads the same input files as
+ * gpoint script, fits model terms with Levenberg-Marquardt and writes
+ * model file which can be loaded by GPointModel.
+ *
+ * Model is linear in its terms, so Jacobian is computed analytically from
+ * term values. Residuals and normal equations are evaluated in parallel
+ * threads.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class GPointFit
+{
+	public:
+		GPointFit ();
+		~GPointFit ();
+
+		/**
+		 * Load observations from gpoint input file. First line is
+		 * skipped, "# observatory|gem|altaz|altaz-manual lng lat alt"
+		 * line specifies model type and latitude.
+		 *
+		 * @return number of loaded observations
+		 *
+		 * @throw rts2core::Error on invalid input
+		 */
+		int loadInput (const char *fn);
+		int loadInput (std::istream &is);
+
+		/**
+		 * Set model type and latitude, when observations are added
+		 * with addObservation.
+		 */
+		void setModel (bool _altaz, double _latitude);
+
+		/**
+		 * Add observation. Coordinates are in degrees, in model axes
+		 * (az/el or ha/dec).
+		 */
+		void addObservation (double a_x, double a_y, double r_x, double r_y);
+
+		/**
+		 * Add extra model term. Arguments are the same as on gpoint
+		 * model line, e.g. "az", "sincos", "az;el", "2;2".
+		 *
+		 * @throw rts2core::Error on invalid term
+		 */
+		void addExtra (const char *axis, const char *function, const char *terms, const char *consts);
+
+		/**
+		 * Do not fit given parameter. Parameter keeps its value (0 unless set).
+		 *
+		 * @throw rts2core::Error if parameter does not exist
+		 */
+		void setFixed (const char *name);
+
+		void setThreads (int _threads) { threads = _threads; }
+
+		/**
+		 * Fit model to active observations.
+		 *
+		 * @param maxIter maximal number of Levenberg-Marquardt iterations
+		 *
+		 * @return RMS of angular errors after fit (arcsec), NAN if fit failed
+		 */
+		double fit (int maxIter = 100);
+
+		/**
+		 * Fit model, remove observations with angular error above
+		 * sigma * RMS and refit, until no observation is removed.
+		 *
+		 * @return number of removed observations
+		 */
+		int fitRejectOutliers (double sigma, int maxRounds = 10);
+
+		/**
+		 * Angular error of observation after model is applied, in radians.
+		 */
+		double getError (size_t i);
+
+		size_t size () { return observations.size (); }
+		size_t activeSize ();
+
+		GPointObservation & operator[] (size_t i) { return observations[i]; }
+
+		bool isAltAz () { return altaz; }
+		double getLatitude () { return latitude; }
+
+		int getParamCount () { return names.size (); }
+		const char *getParamName (int i) { return names[i].c_str (); }
+
+		/**
+		 * Parameter value, in radians.
+		 */
+		double getParam (const char *name);
+		double getParam (int i) { return values[i]; }
+		double getParamError (int i) { return stderrs[i]; }
+		bool isFixed (int i) { return fixed[i]; }
+
+		int getIterations () { return iterations; }
+
+		/**
+		 * Copy fitted parameters to model.
+		 */
+		void getModel (GPointModel *model);
+
+		/**
+		 * Print fitted model, in format accepted by GPointModel::load.
+		 */
+		std::ostream & print (std::ostream &os, char frmt = '"');
+
+		/**
+		 * Print parameter table with errors.
+		 */
+		std::ostream & printParameters (std::ostream &os);
+
+		// compute partial results for observations from..to; public for worker threads
+		void computePartial (size_t from, size_t to, const double *p, double *jtj, double *jtr, double *chi2, bool normal);
+
+	private:
+		bool altaz;
+		double latitude;
+		double sinLat;
+		double cosLat;
+		int threads;
+		int iterations;
+
+		std::vector <GPointObservation> observations;
+
+		std::vector <std::string> names;
+		std::vector <double> values;
+		std::vector <double> stderrs;
+		std::vector <bool> fixed;
+		// indices of fitted parameters
+		std::vector <int> freeParams;
+
+		// extra terms, multiplier params[0] is 1; value is in values
+		std::vector <ExtraParam *> extras;
+		std::vector <int> extraAxis;
+
+		void initParams ();
+
+		void fillTargetCoordinates (GPointObservation &o);
+
+		/**
+		 * Fills partial derivatives (term values) of model in both
+		 * axes, returns model values for given parameters.
+		 */
+		void terms (const GPointObservation &o, const double *p, double *dx, double *dy, double &mx, double &my);
+
+		/**
+		 * Compute chi2 and optionally normal equations (J^T J, J^T r) over free parameters.
+		 */
+		double evaluate (const double *p, double *jtj, double *jtr, bool normal);
+};
+
+}
+
+#endif // !__RTS2_GPOINTFIT__
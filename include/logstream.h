@@ -24,9 +24,115 @@
 
 #include <message.h>
 
+/**
+ * Message levels which are compiled in. Build with
+ * -DRTS2_LOG_COMPILED_LEVELS=0x17 to remove debug messages from the
+ * binary.
+ */
+#ifndef RTS2_LOG_COMPILED_LEVELS
+#define RTS2_LOG_COMPILED_LEVELS MESSAGE_LEVEL_MASK
+#endif
+
+/**
+ * Log only if message type is enabled. Unlike plain logStream, arguments
+ * streamed to the log are not evaluated for disabled levels.
+ *
+ * @code
+ * LOG_IF (MESSAGE_DEBUG) << "tracking " << expensiveCall () << sendLog;
+ * @endcode
+ */
+#define LOG_IF(type) if (!rts2core::logEnabled (type)) {} else logStream (type)
+
 namespace rts2core
 {
 class App;
+class Value;
+
+/**
+ * Runtime mask of logged message levels.
+ */
+extern uint32_t logLevels;
+
+/**
+ * Returns true if messages of given type shall be logged.
+ */
+inline bool logEnabled (messageType_t type)
+{
+	messageType_t level = type & MESSAGE_LEVEL_MASK;
+	return (level & ~RTS2_LOG_COMPILED_LEVELS) == 0 && (level & ~__atomic_load_n (&logLevels, __ATOMIC_RELAXED)) == 0;
+}
+
+/**
+ * Set mask of logged message levels.
+ */
+void setLogLevels (uint32_t levels);
+
+/**
+ * Parse log levels from string with level characters (e for error, w for
+ * warning, i for info, d for debug, c for critical).
+ *
+ * @return log levels mask, -1 on error
+ */
+int parseLogLevels (const char *levels);
+
+/**
+ * Prepare hand off of messages logged from threads other than the calling
+ * thread. Messages logged from other threads are queued and sent by
+ * sendThreadLogs call. Must be called before any other thread logs.
+ *
+ * @return file descriptor which becomes readable when messages are queued, -1 on error
+ */
+int initThreadLogs ();
+
+/**
+ * Send messages queued by other threads. Must be called from the thread
+ * which called initThreadLogs.
+ */
+void sendThreadLogs ();
+
+/**
+ * Structured log field, printed as key=value.
+ */
+template < typename T > struct LogField
+{
+	const char *key;
+	const T &value;
+};
+
+template < typename T > LogField <T> logField (const char *key, const T &value)
+{
+	LogField <T> f = {key, value};
+	return f;
+}
+
+/**
+ * Structured log field with value evaluated only when the message is logged.
+ */
+template < typename F > struct LogLazyField
+{
+	const char *key;
+	F func;
+};
+
+template < typename F > LogLazyField <F> logLazy (const char *key, F func)
+{
+	LogLazyField <F> f = {key, func};
+	return f;
+}
+
+/**
+ * Log value name and its display value as structured field.
+ */
+struct LogValueField
+{
+	Value *value;
+};
+
+inline LogValueField logValue (Value *value)
+{
+	LogValueField f = {value};
+	return f;
+}
 
 /**
  * Class used for streaming log messages. This class provides operators which
@@ -34,6 +140,9 @@ class App;
  * sendLog manipulator to this class, it is passed to the system for
  * processing.
  *
+ * Messages of disabled levels are not formatted. Formatting buffers are
+ * reused from a per-thread cache.
+ *
  * @ingroup RTS2Block
  *
  * @author Petr Kubanek <petr@kubanek.net>
@@ -45,16 +154,14 @@ class LogStream
 		{
 			masterApp = in_master;
 			messageType = in_type;
-			ls.setf (std::ios_base::fixed, std::ios_base::floatfield);
-			ls.precision (6);
+			ls = logEnabled (messageType) ? acquireBuffer () : NULL;
 		}
 
 		LogStream (const LogStream &_logStream)
 		{
 			masterApp = _logStream.masterApp;
 			messageType = _logStream.messageType;
-			ls.setf (std::ios_base::fixed, std::ios_base::floatfield);
-			ls.precision (6);
+			ls = logEnabled (messageType) ? acquireBuffer () : NULL;
 		}
 
 
@@ -62,10 +169,20 @@ class LogStream
 		{
 			masterApp = _logStream.masterApp;
 			messageType = _logStream.messageType;
-			ls.setf (std::ios_base::fixed, std::ios_base::floatfield);
-			ls.precision (6);
+			ls = logEnabled (messageType) ? acquireBuffer () : NULL;
 		}
 
+		~LogStream ()
+		{
+			if (ls)
+				releaseBuffer (ls);
+		}
+
+		/**
+		 * Returns true if the stream will be logged.
+		 */
+		bool enabled () { return ls != NULL; }
+
 		LogStream & operator << (LogStream & (*func) (LogStream &))
 		{
 			return func (*this);
@@ -73,10 +190,27 @@ class LogStream
 
 		template < typename _charT > LogStream & operator << (_charT value)
 		{
-			ls << value;
+			if (ls)
+				*ls << value;
 			return *this;
 		}
 
+		template < typename T > LogStream & operator << (const LogField <T> &f)
+		{
+			if (ls)
+				*ls << ' ' << f.key << '=' << f.value;
+			return *this;
+		}
+
+		template < typename F > LogStream & operator << (const LogLazyField <F> &f)
+		{
+			if (ls)
+				*ls << ' ' << f.key << '=' << f.func ();
+			return *this;
+		}
+
+		LogStream & operator << (const LogValueField &f);
+
 		/**
 		 * Set fill value for log stream. Call fill method for ostream.
 		 *
@@ -86,7 +220,9 @@ class LogStream
 		 */
 		char fill (char _f)
 		{
-			return ls.fill (_f);
+			if (ls == NULL)
+				return ' ';
+			return ls->fill (_f);
 		}
 
 		/**
@@ -114,7 +250,12 @@ class LogStream
 	private:
 		rts2core::App * masterApp;
 		messageType_t messageType;
-		std::ostringstream ls;
+		std::ostringstream *ls;
+
+		static std::ostringstream *acquireBuffer ();
+		static void releaseBuffer (std::ostringstream *buf);
+
+		void send (bool endl);
 };
 
 }
@@ -160,7 +160,7 @@ class Message
 			}
 		}
 
-		double getMessageTime () { return messageTime.tv_sec + (double) messageTime.tv_usec / USEC_SEC;	}
+		double getMessageTime () const { return messageTime.tv_sec + (double) messageTime.tv_usec / USEC_SEC;	}
 
 		time_t getMessageTimeSec () { return messageTime.tv_sec; }
 
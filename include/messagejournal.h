@@ -0,0 +1,216 @@
+/*
+ * Binary ring journal of system messages.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_MESSAGEJOURNAL__
+#define __RTS2_MESSAGEJOURNAL__
+
+#include "message.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+// magic number at the begining of the journal file
+#define MESSAGE_JOURNAL_MAGIC      0x524d4a31
+
+#define MESSAGE_JOURNAL_ONAME      20
+#define MESSAGE_JOURNAL_TEXT       192
+
+// number of devices with their own message chain
+#define MESSAGE_JOURNAL_DEVICES    64
+
+// number of message level chains - error, warning, info, debug, critical, and messages without level
+#define MESSAGE_JOURNAL_LEVELS     6
+
+namespace rts2core
+{
+
+/**
+ * Single journal record. Records are linked to the previous record of the
+ * same level and of the same device.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+struct MessageJournalRecord
+{
+	// sequence number of the record, 0 while the record is being written
+	uint64_t seq;
+	// sequence number of the previous record with the same level, 0 if none
+	uint64_t prevLevel;
+	// sequence number of the previous record from the same device, 0 if none
+	uint64_t prevDevice;
+	// message time
+	double time;
+	// index time - message time, but never lower than index time of the previous record
+	double itime;
+	int32_t type;
+	char oname[MESSAGE_JOURNAL_ONAME];
+	char text[MESSAGE_JOURNAL_TEXT];
+};
+
+/**
+ * Last record of a device.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+struct MessageJournalDevice
+{
+	char oname[MESSAGE_JOURNAL_ONAME];
+	uint32_t pad;
+	uint64_t last;
+};
+
+/**
+ * Journal header, records follow the header.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+struct MessageJournalHeader
+{
+	uint32_t magic;
+	// number of records in the ring
+	uint32_t nrecords;
+	// size of the single record
+	uint32_t recordSize;
+	uint32_t pad;
+	// sequence number of the last written record; records are numbered from 1
+	uint64_t writeSeq;
+	uint64_t lastLevel[MESSAGE_JOURNAL_LEVELS];
+	struct MessageJournalDevice devices[MESSAGE_JOURNAL_DEVICES];
+};
+
+/**
+ * Ring of the last messages stored in memory mapped file. Centrald writes
+ * every message it receives to the journal, other processes (rts2-httpd,
+ * rts2-logger) open the journal read-only and query it without contacting
+ * centrald.
+ *
+ * Records are written in order of arrival. They are indexed by time
+ * (binary search on monotonic index time), and chained by message level and
+ * by originating device, so queries for errors or for a single device do not
+ * need to walk through debug messages of other devices.
+ *
+ * Writer invalidates record sequence number before the record is
+ * overwritten, readers check sequence number before and after the record
+ * is copied, so records overwritten during a query are skipped.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class MessageJournal
+{
+	public:
+		MessageJournal ();
+		~MessageJournal ();
+
+		/**
+		 * Open journal for writing. Existing journal with the same
+		 * number of records is reused, otherwise new journal is
+		 * created and renamed over the existing file. Readers keep
+		 * the old journal mapped until they reopen it.
+		 *
+		 * @param _path     journal file path
+		 * @param nrecords  number of records in the ring
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int create (const char *_path, uint32_t nrecords);
+
+		/**
+		 * Open existing journal for reading.
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int open (const char *_path);
+
+		void close ();
+
+		bool isOpen () { return header != NULL; }
+
+		const char *getPath () { return path.c_str (); }
+
+		uint32_t getRecords () { return records; }
+
+		/**
+		 * Returns true if journal file was replaced by a new journal
+		 * (after change of journal size), so reader should reopen it.
+		 */
+		bool isReplaced ();
+
+		/**
+		 * Returns sequence number of the last written record.
+		 */
+		uint64_t getWriteSeq ();
+
+		/**
+		 * Add message to the journal. Message string is truncated to fit into the record.
+		 */
+		void add (Message &msg);
+
+		/**
+		 * Retrieve messages within given period, ordered by arrival.
+		 *
+		 * @param from       start of the period
+		 * @param to         end of the period
+		 * @param typeMask   type mask to filter messages
+		 * @param device     device name, NULL or empty string for all devices
+		 * @param msgs       retrieved messages are appended to this vector
+		 * @param max        maximal number of returned messages, newest are returned. 0 for no limit.
+		 *
+		 * @return number of retrieved messages
+		 */
+		size_t query (double from, double to, int typeMask, const char *device, std::vector <Message> &msgs, size_t max = 0);
+
+	private:
+		struct MessageJournalHeader *header;
+		std::string path;
+		size_t mapSize;
+		// number of records in the mapped journal; header of the file is not trusted for indexing
+		uint32_t records;
+		dev_t fileDev;
+		ino_t fileIno;
+		bool writer;
+
+		struct MessageJournalRecord *getRecord (uint64_t seq) { return ((struct MessageJournalRecord *) (header + 1)) + (seq - 1) % records; }
+
+		/**
+		 * Copy record, returns false if the record was overwritten.
+		 */
+		bool readRecord (uint64_t seq, struct MessageJournalRecord &rec);
+
+		// index time of the last written record
+		double lastITime;
+
+		// walk chain starting at seq, collects sequence numbers of matching records, newest first
+		void walkChain (uint64_t seq, bool byDevice, double from, double to, int typeMask, const char *device, std::vector <uint64_t> &seqs, size_t max);
+
+		int findDevice (const char *oname);
+
+		int map (int fd, bool rw);
+};
+
+/**
+ * Returns index of message level chain.
+ */
+int messageJournalLevel (int type);
+
+}
+
+#endif // !__RTS2_MESSAGEJOURNAL__
@@ -0,0 +1,145 @@
+/*
+ * Asynchronous message log with rotation.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_MESSAGELOG__
+#define __RTS2_MESSAGELOG__
+
+#include "message.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace rts2core
+{
+
+/**
+ * Message log file written by a background thread. Messages are queued by
+ * log () call, which does not touch the disk. Writer thread formats queued
+ * messages and writes them in blocks, flushing the file once per block.
+ *
+ * Log is rotated when it grows over maximal size or after given interval.
+ * Rotated logs are numbered (logfile.1 is the most recent), optionally
+ * compressed with gzip. If writer cannot keep up, messages over the queue
+ * limit are dropped and number of dropped messages is written to the log.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class MessageLog
+{
+	public:
+		MessageLog ();
+		/**
+		 * Writes all queued messages and stops writer thread.
+		 */
+		~MessageLog ();
+
+		/**
+		 * Set rotation parameters.
+		 *
+		 * @param _maxSize    rotate log when it is bigger than maxSize bytes, 0 to not rotate on size
+		 * @param _interval   rotate log after interval seconds, 0 to not rotate on time
+		 * @param _keep       number of rotated logs to keep
+		 * @param _compress   compress rotated logs with gzip
+		 */
+		void setRotation (size_t _maxSize, double _interval, int _keep, bool _compress);
+
+		/**
+		 * Set maximal number of queued messages.
+		 */
+		void setMaxQueue (size_t _maxQueue) { maxQueue = _maxQueue; }
+
+		/**
+		 * Open log file and start writer thread. If log is already
+		 * opened with the same file name, it is reopened (so external
+		 * log rotation can be used).
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int open (const char *_filename);
+
+		/**
+		 * Stop writer thread, write all queued messages and close the log.
+		 */
+		void close ();
+
+		/**
+		 * Queue message for logging.
+		 */
+		void log (Message &msg);
+
+		/**
+		 * Wait until all messages queued so far are written.
+		 */
+		void flush ();
+
+		const char *getFilename () { return filename.c_str (); }
+
+		/**
+		 * Returns number of messages dropped because the writer was too slow.
+		 */
+		uint64_t getDropped ();
+
+	private:
+		std::string filename;
+
+		// rotation parameters are protected by mutex
+		size_t maxSize;
+		double interval;
+		int keep;
+		bool compress;
+		size_t maxQueue;
+
+		pthread_t thread;
+		bool running;
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+		pthread_cond_t flushed;
+
+		// following are protected by mutex
+		std::vector <Message> queue;
+		bool stop;
+		bool reopen;
+		uint64_t queued;
+		uint64_t written;
+		uint64_t dropped;
+		uint64_t reportedDropped;
+
+		// log times in local time
+		bool localTime;
+
+		// following are accessed only by writer thread
+		FILE *file;
+		size_t fileSize;
+		double openTime;
+
+		static void *writerThread (void *arg);
+		void writer ();
+
+		int openFile ();
+		void rotate (int _keep, bool _compress);
+		void compressFile (const std::string &fn);
+		std::string rotatedName (int i);
+};
+
+}
+
+#endif // !__RTS2_MESSAGELOG__
@@ -0,0 +1,65 @@
+/*
+ * Fast conversion of doubles to and from protocol strings.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_NUMFMT__
+#define __RTS2_NUMFMT__
+
+#include <string>
+
+// buffer size sufficient for any double printed by formatDouble, including terminating 0
+#define DOUBLE_BUF_LEN     32
+
+namespace rts2core
+{
+
+/**
+ * Print double in the shortest form which converts back to the same
+ * double (in rare cases the result is one digit longer than the shortest
+ * possible). Numbers with decimal exponent between -6 and 20 are printed
+ * in fixed notation (123.45, 0.001), others in scientific notation
+ * (1.5e+25). NAN is printed as nan, infinities as inf and -inf.
+ *
+ * @param buf     buffer, at least DOUBLE_BUF_LEN characters long
+ * @param value   value to print
+ *
+ * @return number of characters written, without terminating 0
+ */
+int formatDouble (char *buf, double value);
+
+/**
+ * Append shortest representation of the double to the string.
+ */
+void appendDouble (std::string &str, double value);
+
+/**
+ * Parse double. Behaves as strtod in the C locale - leading whitespace
+ * is skipped, and the longest valid prefix is converted. Decimal numbers
+ * with mantissa and power of ten exactly representable in double are
+ * converted without calling strtod, everything else is passed to strtod.
+ *
+ * @param str      string to parse
+ * @param endptr   if not NULL, set to first character after the number
+ *
+ * @return parsed value, 0 if nothing was parsed (endptr is then set to str)
+ */
+double parseDouble (const char *str, char **endptr = NULL);
+
+}
+
+#endif // !__RTS2_NUMFMT__
@@ -40,6 +40,9 @@ class HorizonEntry
 
 typedef std::vector < class HorizonEntry > horizon_t;
 
+// number of azimuth bins of horizon lookup table
+#define HORIZON_LUT_BINS     3600
+
 /**
  * Class for checking, whenewer observation target is correct or no.
  *
@@ -83,7 +86,33 @@ class ObjectCheck
 
 		int is_good_with_margin (struct ln_hrz_posn *hrz, double alt_margin, double az_margin, int hardness = 0);
 
-		double getHorizonHeight (const struct ln_hrz_posn *hrz, int hardness);
+		/**
+		 * Check multiple positions.
+		 *
+		 * @param hrz       object horizontal coordinates
+		 * @param n         number of positions
+		 * @param good      returned check results, true if position can be observed
+		 * @param hardness  how many limits to ignore
+		 *
+		 * @return number of positions which can be observed
+		 */
+		size_t is_good_batch (const struct ln_hrz_posn *hrz, size_t n, bool *good, int hardness = 0);
+
+		double getHorizonHeight (const struct ln_hrz_posn *hrz, int hardness)
+		{
+			return getHorizonHeightAz (hrz->az);
+		}
+
+		/**
+		 * Returns horizon height at given azimuth. Horizon is linearly
+		 * interpolated between horizon file points.
+		 */
+		double getHorizonHeightAz (double az);
+
+		/**
+		 * Returns horizon heights for multiple azimuths.
+		 */
+		void getHorizonHeights (const double *az, double *alt, size_t n);
 
 		horizon_t::iterator begin ()
 		{
@@ -104,7 +133,23 @@ class ObjectCheck
 
 		horizon_t horizon;
 
-		double getHorizonHeightAz (double az, horizon_t::iterator iter1, horizon_t::iterator iter2);
+		/**
+		 * Horizon segments, compiled from horizon points. Segments cover
+		 * 0 - 360 azimuth range, each is described by its start azimuth
+		 * and linear function of azimuth.
+		 */
+		std::vector <double> segStart;
+		std::vector <double> segAz;
+		std::vector <double> segAlt;
+		std::vector <double> segSlope;
+
+		// index of segment containing start of the azimuth bin
+		std::vector <int> azIndex;
+
+		void compileHorizon ();
+
+		// segment between two points, first point azimuth is shifted for segments crossing 0
+		void addSegment (double start, double az1, double alt1, double az2, double alt2);
 
 		bool ignoreHorizon;
 };
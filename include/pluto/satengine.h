@@ -0,0 +1,172 @@
+/*
+ * Cached satellite propagation and pass prediction.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_SATENGINE__
+#define __RTS2_SATENGINE__
+
+#include "pluto/norad.h"
+
+#include <stddef.h>
+#include <vector>
+
+class ObjectCheck;
+
+namespace rts2pluto
+{
+
+/**
+ * Satellite pass above horizon. Times are JD, altitudes and azimuths in
+ * degrees, azimuth as in libnova and horizon files.
+ */
+struct SatellitePass
+{
+	// rise time, NAN if satellite was above horizon at search start
+	double rise;
+	// culmination - time of the maximal altitude
+	double culmination;
+	// set time, NAN if satellite is above horizon at search end
+	double set;
+	double maxAlt;
+	double riseAz;
+	double setAz;
+};
+
+/**
+ * Satellite propagation engine. Holds parsed TLE together with
+ * initialized model parameters and observer location, so the expensive
+ * SxPx_init and observer parallax calculations are done only once per
+ * TLE, not on every position request.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class SatelliteEngine
+{
+	public:
+		SatelliteEngine ();
+
+		/**
+		 * Parse TLE and initialize model parameters.
+		 *
+		 * @param l1    first TLE line
+		 * @param l2    second TLE line
+		 *
+		 * @return 0 on success, parse_elements error code if TLE cannot be parsed; previous TLE is kept in that case
+		 */
+		int setTLE (const char *l1, const char *l2);
+
+		/**
+		 * Set observer location. Parallax constants are recalculated
+		 * only when location changes.
+		 *
+		 * @param lng       longitude in degrees, east positive
+		 * @param lat       latitude in degrees
+		 * @param altitude  altitude above sea level in meters
+		 */
+		void setObserver (double lng, double lat, double altitude);
+
+		bool isValid () { return ephem >= 0; }
+
+		/**
+		 * Returns model used - 0 SGP, 1 SGP4, 2 SGP8, 3 SDP4, 4 SDP8.
+		 */
+		int getEphem () { return ephem; }
+
+		const tle_t *getTLE () { return &tle; }
+
+		/**
+		 * Returns orbital period in days.
+		 */
+		double getPeriod ();
+
+		/**
+		 * Propagate satellite to given date.
+		 *
+		 * @param JD       Julian date
+		 * @param sat_pos  returned geocentric satellite position (km)
+		 */
+		void propagate (double JD, double *sat_pos);
+
+		/**
+		 * Topocentric position of date.
+		 *
+		 * @param JD    Julian date
+		 * @param ra    returned right ascension (radians)
+		 * @param dec   returned declination (radians)
+		 * @param dist  returned distance from observer (km)
+		 */
+		void getPosition (double JD, double &ra, double &dec, double &dist);
+
+		/**
+		 * Topocentric positions for multiple dates.
+		 */
+		void getPositions (const double *JD, size_t n, double *ra, double *dec, double *dist);
+
+		/**
+		 * Horizontal coordinates, in degrees. Azimuth follows libnova
+		 * convention, so it can be checked against horizon.
+		 */
+		void getAltAz (double JD, double &alt, double &az);
+
+		/**
+		 * Horizontal coordinates for multiple dates.
+		 */
+		void getAltAzs (const double *JD, size_t n, double *alt, double *az);
+
+		/**
+		 * Find satellite passes. Altitude is sampled with given step,
+		 * horizon crossings are refined by bisection and culmination by
+		 * golden section search. Passes shorter than step might be
+		 * missed.
+		 *
+		 * @param from     search start (JD)
+		 * @param to       search end (JD)
+		 * @param minAlt   minimal altitude (degrees)
+		 * @param horizon  if not NULL, horizon above minAlt is also considered
+		 * @param passes   found passes
+		 * @param step     altitude sampling step (seconds)
+		 *
+		 * @return number of passes found
+		 */
+		size_t getPasses (double from, double to, double minAlt, ObjectCheck *horizon, std::vector <SatellitePass> &passes, double step = 30);
+
+	private:
+		tle_t tle;
+		int ephem;
+		double sat_params[N_SAT_PARAMS];
+		double deep_params[N_SAT_PARAMS];
+
+		double obsLng;
+		double obsLat;
+		double obsAltitude;
+		double rho_cos_phi;
+		double rho_sin_phi;
+		double sinLat;
+		double cosLat;
+
+		void observerLocation (double JD, double *observer_loc);
+
+		// altitude above minAlt and horizon
+		double heightAbove (double JD, double minAlt, ObjectCheck *horizon, double *az = NULL);
+
+		double findCrossing (double JD1, double JD2, double minAlt, ObjectCheck *horizon);
+};
+
+}
+
+#endif // !__RTS2_SATENGINE__
@@ -21,12 +21,16 @@
 #define __RTS2_IMGSET__
 
 #include "../rts2fits/image.h"
+#include "../rts2fits/archiveindex.h"
 
 #include <iostream>
 #include <iomanip>
 #include <vector>
 #include "imagesetstat.h"
 
+// maximal distance of image center from searched position (degrees)
+#define IMAGESET_INDEX_RADIUS    5
+
 class Rts2ImageDb;
 
 namespace rts2db {
@@ -67,12 +71,20 @@ class ImageSet:public std::vector <rts2image::Image * >
 		}
 	protected:
 		int load (std::string in_where);
+
+		/**
+		 * Load images from archive index instead of the database.
+		 */
+		int load (rts2image::ArchiveIndex *index, const rts2image::ArchiveQuery &query);
+
 		void stat ();
 	private:
 		ImageSetStat allStat;
 
 		// which images filters are in set..
 		std::vector <ImageSetStat> filterStat;
+
+		void addStat (int filter_id, float img_alt, float img_az, float img_exposure, double img_err, double img_err_ra, double img_err_dec);
 };
 
 class ImageSetTarget:public ImageSet
@@ -93,6 +105,24 @@ class ImageSetObs:public ImageSet
 		rts2db::Observation *observation;
 };
 
+/**
+ * Images found in archive index. Index must be up to date, images
+ * recorded only in the database are not included.
+ */
+class ImageSetIndex:public ImageSet
+{
+	public:
+		ImageSetIndex (rts2image::ArchiveIndex *_index, const rts2image::ArchiveQuery &_query) { index = _index; query = _query; }
+		virtual int load ();
+	private:
+		rts2image::ArchiveIndex *index;
+		rts2image::ArchiveQuery query;
+};
+
+/**
+ * Images with given position in their field. If archive index is
+ * configured (observatory/archive_index), images are found in the index.
+ */
 class ImageSetPosition:public ImageSet
 {
 	public:
@@ -41,6 +41,41 @@ class MessageDB:public rts2core::Message
 		MessageDB (double in_messageTime, const char *in_messageOName, messageType_t in_messageType, const char *in_messageString);
 		virtual ~ MessageDB (void);
 		void insertDB ();
+
+		/**
+		 * Insert message to the database, without commiting the transaction.
+		 *
+		 * @return false on error
+		 */
+		bool insert ();
+};
+
+/**
+ * Messages waiting to be written to the database. All queued messages are
+ * inserted in a single transaction, so message bursts do not require a
+ * commit for every message.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class MessageDBQueue:public std::vector <MessageDB>
+{
+	public:
+		MessageDBQueue () { lastInsert = 0; }
+
+		/**
+		 * Insert all queued messages in single transaction and clear
+		 * the queue. If a message cannot be inserted, messages are
+		 * inserted one by one, so only failing messages are lost.
+		 */
+		void insertDB ();
+
+		/**
+		 * Time of the last insert.
+		 */
+		double getLastInsert () { return lastInsert; }
+
+	private:
+		double lastInsert;
 };
 
 /**
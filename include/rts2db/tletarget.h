@@ -22,7 +22,7 @@
 
 #include "target.h"
 
-#include "pluto/norad.h"
+#include "pluto/satengine.h"
 
 namespace rts2db
 {
@@ -48,8 +48,29 @@ class TLETarget:public Target
 		void orbitFromTLE (std::string tle);
 
 		virtual void getPosition (struct ln_equ_posn *pos, double JD);
+
+		/**
+		 * Returns next satellite rise, culmination and set above the
+		 * horizon. Local horizon from configuration is respected. If
+		 * satellite is above horizon at JD, set and transit are of the
+		 * current pass and rise is of the next pass.
+		 *
+		 * @return 0 on success, 1 if satellite is above horizon and -1 if it is bellow horizon for the whole searched period
+		 */
 		virtual int getRST (struct ln_rst_time *rst, double jd, double horizon);
 
+		/**
+		 * Find satellite passes above horizon.
+		 *
+		 * @param from     search start (JD)
+		 * @param to       search end (JD)
+		 * @param horizon  minimal altitude
+		 * @param passes   found passes
+		 *
+		 * @return number of passes found
+		 */
+		size_t getPasses (double from, double to, double horizon, std::vector <rts2pluto::SatellitePass> &passes);
+
 		virtual moveType startSlew (struct ln_equ_posn *position, std::string &p1, std::string &p2, bool update_position, int plan_id = -1);
 
 		virtual void printExtra (Rts2InfoValStream & _os, double JD);
@@ -63,12 +84,9 @@ class TLETarget:public Target
 		std::string tle1;
 		std::string tle2;
 
-		tle_t tle;
-
-		int ephem;
-		int is_deep;
+		rts2pluto::SatelliteEngine engine;
 
-		void getPosition (struct ln_equ_posn *pos, double JD, struct ln_equ_posn *parallax);
+		void setObserver ();
 };
 
 }
@@ -0,0 +1,325 @@
+/*
+ * Incremental index of image archive.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_ARCHIVEINDEX__
+#define __RTS2_ARCHIVEINDEX__
+
+#include "rts2-config.h"
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef RTS2_HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+#define ARCHIVE_INDEX_MAGIC    0x52414931
+
+// entry position is from WCS (CRVAL1, CRVAL2)
+#define ARCHIVE_WCS            0x01
+// file was removed; used only in index journal
+#define ARCHIVE_DELETED        0x02
+// file cannot be read as FITS image. It is kept in index, so it is not opened again until modified
+#define ARCHIVE_INVALID        0x04
+
+#define ARCHIVE_WCS_VALUES     7
+
+namespace rts2image
+{
+
+/**
+ * Summary of image header, as stored in index file. Unknown values are
+ * NAN or -1.
+ */
+struct ArchiveEntry
+{
+	// file modification time and size, used to detect changed files
+	int64_t mtime;
+	int64_t size;
+	// exposure start
+	double JD;
+	// WCS reference position if available, target position otherwise (degrees)
+	double ra;
+	double dec;
+	// CRVAL1, CRVAL2, CRPIX1, CRPIX2, CDELT1, CDELT2, CROTA2
+	double wcs[ARCHIVE_WCS_VALUES];
+	float exposure;
+	float temperature;
+	float alt;
+	float az;
+	// pixel statistics written by camera
+	float average;
+	float stdev;
+	// astrometry error (degrees)
+	float pos_err;
+	int32_t tar_id;
+	int32_t obs_id;
+	int32_t img_id;
+	// image size (pixels), 0 if not known
+	int32_t width;
+	int32_t height;
+	uint32_t flags;
+	char tar_type;
+	char filter[15];
+	char camera[16];
+	char mount[16];
+	char object[32];
+};
+
+/**
+ * Indexed file.
+ */
+struct ArchiveItem
+{
+	std::string path;
+	ArchiveEntry entry;
+};
+
+/**
+ * Index query. Criteria which are NAN, empty or -1 are not used.
+ */
+class ArchiveQuery
+{
+	public:
+		ArchiveQuery ();
+
+		// exposure start range (JD)
+		double from;
+		double to;
+		// sky position and search radius (degrees)
+		double ra;
+		double dec;
+		double radius;
+		// only images with position inside their field. Field size is
+		// calculated from CDELT and image size, radius limits the search
+		bool field;
+		std::string filter;
+		std::string camera;
+		int tar_id;
+		int obs_id;
+		// only files in this directory and its subdirectories
+		std::string directory;
+		// include files which cannot be read as images
+		bool invalid;
+};
+
+/**
+ * Index of image archive. Keeps summary of FITS headers of all images
+ * under archive directories, so tools searching for images by target,
+ * time, position or filter do not need to walk directories and open every
+ * file.
+ *
+ * Index file is a journal of fixed size records, each followed by file
+ * path. Updates are appended to the file, so readers can pick them with
+ * refresh without loading the whole index again. Superseded records are
+ * dropped by compact, which replaces the file.
+ *
+ * Index is updated incrementally - scan opens only files whose size or
+ * modification time differs from the index, and watch adds inotify
+ * watches to process changes as they happen.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class ArchiveIndex
+{
+	public:
+		ArchiveIndex ();
+		~ArchiveIndex ();
+
+		/**
+		 * Returns process wide index, opened read-only from
+		 * observatory/archive_index. Returns NULL if index is not
+		 * configured or cannot be opened.
+		 */
+		static ArchiveIndex *instance ();
+
+		/**
+		 * Open and load index file. If the file does not exist and index
+		 * is opened for writing, it is created.
+		 *
+		 * @return 0 on success, -1 on error
+		 */
+		int open (const char *_filename, bool _readOnly = true);
+
+		void close ();
+
+		/**
+		 * Load records appended by other processes since last load. If
+		 * index file was compacted, it is loaded again.
+		 *
+		 * @return number of loaded records, -1 on error
+		 */
+		int refresh ();
+
+		/**
+		 * Scan directory, index new and changed files, drop index
+		 * entries of files which no longer exist.
+		 *
+		 * @return number of updated entries, -1 on error
+		 */
+		int scan (const char *dir, bool recursive = true);
+
+		/**
+		 * Index file if it is not in index or was changed.
+		 *
+		 * @return 1 if index was updated, 0 if file is unchanged, -1 on error
+		 */
+		int updateFile (const char *path, bool force = false);
+
+		/**
+		 * Remove file from index.
+		 */
+		int removeFile (const char *path);
+
+		/**
+		 * Remove all files in directory from index.
+		 */
+		int removeDirectory (const char *dir);
+
+		/**
+		 * Add or replace entry.
+		 *
+		 * @return 0 on success, -1 if entry cannot be written to index file
+		 */
+		int addEntry (const char *path, const ArchiveEntry &entry);
+
+		/**
+		 * Write index without superseded records.
+		 *
+		 * @return 0 on success, -1 on error
+		 */
+		int compact ();
+
+		/**
+		 * Returns index entry of the file, NULL if file is not in the index.
+		 * Returned pointers are valid until next index update.
+		 */
+		const ArchiveItem *find (const char *path);
+
+		/**
+		 * Find files matching query, sorted by exposure start.
+		 */
+		void query (const ArchiveQuery &q, std::vector <const ArchiveItem *> &ret);
+
+		/**
+		 * List directory content known to the index.
+		 *
+		 * @param subdirs   subdirectories holding indexed files
+		 * @param files     files in directory, sorted by name
+		 */
+		void listDirectory (const char *dir, std::vector <std::string> &subdirs, std::vector <const ArchiveItem *> &files);
+
+		size_t size () { return pathMap.size (); }
+
+		/**
+		 * Returns number of records in index file. Records over size are
+		 * superseded and will be dropped by compact.
+		 */
+		size_t getRecords () { return records; }
+
+		/**
+		 * Returns true for file names which are indexed (*.fits, *.fit, *.fts).
+		 */
+		static bool isImageName (const char *name);
+
+		/**
+		 * Fill entry from FITS file headers.
+		 *
+		 * @return 0 on success, -1 if file cannot be read as image; entry is marked ARCHIVE_INVALID
+		 */
+		static int readEntry (const char *path, ArchiveEntry &entry);
+
+		static void initEntry (ArchiveEntry &entry);
+
+		/**
+		 * Returns distance from image center to its corner (degrees), NAN if
+		 * WCS or image size is not known.
+		 */
+		static double getFieldRadius (const ArchiveEntry &entry);
+
+#ifdef RTS2_HAVE_SYS_INOTIFY_H
+		/**
+		 * Add inotify watches for directory and its subdirectories.
+		 *
+		 * @param _notifyFd  inotify file descriptor, e.g. from rts2core::ConnNotify
+		 *
+		 * @return number of watched directories, -1 on error
+		 */
+		int watch (int _notifyFd, const char *dir);
+
+		/**
+		 * Update index from inotify event. Events for watches not
+		 * created by watch call are ignored.
+		 */
+		void processEvent (struct inotify_event *event);
+#endif
+
+	private:
+		std::string filename;
+		bool readOnly;
+		int fd;
+		ino_t inode;
+		// end of the last loaded record
+		off_t offset;
+		// number of records in index file, including superseded
+		size_t records;
+
+		// owns items
+		std::map <std::string, ArchiveItem *> pathMap;
+
+		// items sorted by JD and by DEC; rebuilt on query after update
+		std::vector <ArchiveItem *> byJD;
+		std::vector <ArchiveItem *> byDec;
+		bool sorted;
+
+		int notifyFd;
+		std::map <int, std::string> watches;
+
+		void clear ();
+
+		// close and open index file again, used after compaction
+		int reopen ();
+
+		// read records from offset to end of file
+		int load ();
+
+		// lock index file for writing and load records appended by other writers
+		int lock ();
+		void unlock ();
+
+		void insert (const char *path, const ArchiveEntry &entry);
+		void erase (const std::string &path);
+
+		// append record to index file
+		int append (const char *path, const ArchiveEntry &entry);
+
+		void sort ();
+
+		bool matches (const ArchiveItem *item, const ArchiveQuery &q);
+
+		int scanDir (const std::string &dir, bool recursive, std::set <std::string> &seen);
+};
+
+}
+
+#endif // !__RTS2_ARCHIVEINDEX__
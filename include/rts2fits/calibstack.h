@@ -0,0 +1,296 @@
+/*
+ * Streaming combination of calibration frames.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_CALIBSTACK__
+#define __RTS2_CALIBSTACK__
+
+#include <fitsio.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace rts2image
+{
+
+typedef enum {STACK_MEDIAN, STACK_MEAN} stack_method_t;
+
+/**
+ * Parameters of frame combination.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class StackParams
+{
+	public:
+		StackParams ()
+		{
+			method = STACK_MEDIAN;
+			kappaLow = 3;
+			kappaHigh = 3;
+			iterations = 3;
+			normalize = false;
+			threads = 1;
+			memory = 256 * 1024 * 1024;
+			sampleStep = 16;
+		}
+
+		stack_method_t method;
+		// values further than kappa * sigma below/above center are rejected
+		float kappaLow;
+		float kappaHigh;
+		// maximal number of clipping iterations, 0 disables clipping
+		int iterations;
+		// scale frames to unity median before combination (flats)
+		bool normalize;
+		// number of threads combining pixels
+		int threads;
+		// size of row buffers (bytes)
+		size_t memory;
+		// every n-th row and column is used to estimate frame median for normalization
+		int sampleStep;
+};
+
+/**
+ * Frame to combine. Provides rows of pixel data, so frames do not need to
+ * be held in memory.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class StackInput
+{
+	public:
+		StackInput (const char *_name);
+		virtual ~StackInput () {}
+
+		/**
+		 * Read rows as floats. Undefined pixels are NAN.
+		 *
+		 * @param row    first row, counted from 0
+		 * @param nrows  number of rows
+		 * @param buf    buffer for nrows * width values
+		 *
+		 * @return 0 on success, -1 on error
+		 */
+		virtual int readRows (int row, int nrows, float *buf) = 0;
+
+		const char *getName () { return name.c_str (); }
+
+		int getWidth () { return width; }
+		int getHeight () { return height; }
+
+		// values from the frame header, NAN or empty if not known
+		double JD;
+		float exposure;
+		float temperature;
+		std::string imageType;
+		std::string filter;
+		std::string camera;
+
+	protected:
+		std::string name;
+		int width;
+		int height;
+};
+
+/**
+ * Frame read from FITS file. File is kept open, rows are read as they
+ * are requested. The first HDU with image data is used, so tile
+ * compressed images are read as well.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class FitsStackInput:public StackInput
+{
+	public:
+		FitsStackInput (const char *_filename);
+		virtual ~FitsStackInput ();
+
+		/**
+		 * Open file and read header values.
+		 *
+		 * @return 0 on success, -1 on error
+		 */
+		int open ();
+
+		virtual int readRows (int row, int nrows, float *buf);
+
+	private:
+		fitsfile *fptr;
+};
+
+/**
+ * Combine frames into master calibration frame. Frames are read in
+ * blocks of rows, so memory use depends on number of frames and block
+ * size, not on frame size. While worker threads combine a block, the
+ * calling thread reads the next one.
+ *
+ * Median combination rejects values using sigma estimated from median
+ * absolute deviation. Mean combination uses standard deviation, and runs
+ * over rows of pixels, so compiler can vectorize the loops.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class CalibrationStack
+{
+	public:
+		CalibrationStack (const StackParams &_params);
+		~CalibrationStack ();
+
+		/**
+		 * Add frame. Stack takes ownership of the input.
+		 */
+		void addInput (StackInput *input);
+
+		size_t getInputs () { return inputs.size (); }
+
+		/**
+		 * Read master bias, which will be subtracted from all frames.
+		 *
+		 * @return 0 on success, -1 on error
+		 */
+		int setBias (StackInput &bias);
+
+		/**
+		 * Read master dark, which will be subtracted from all frames. Dark
+		 * is scaled by ratio of frame and dark exposures, if both are known.
+		 *
+		 * @return 0 on success, -1 on error
+		 */
+		int setDark (StackInput &dark);
+
+		/**
+		 * Combine frames.
+		 *
+		 * @return 0 on success, -1 on error
+		 */
+		int stack ();
+
+		/**
+		 * Returns combined frame.
+		 */
+		const std::vector <float> &getMaster () { return master; }
+
+		int getWidth () { return width; }
+		int getHeight () { return height; }
+
+		/**
+		 * Returns number of rows in a block. Valid after stack call.
+		 */
+		int getBlockRows () { return blockRows; }
+
+		/**
+		 * Returns number of bytes allocated for frame data - row buffers,
+		 * master frame, bias and dark.
+		 */
+		size_t getBufferSize ();
+
+		/**
+		 * Returns fraction of rejected values.
+		 */
+		double getRejected ();
+
+		/**
+		 * Returns scale applied to frame by normalization, 1 if frames are
+		 * not normalized.
+		 */
+		float getScale (size_t i) { return scales[i]; }
+
+		/**
+		 * Write master frame with header recording inputs and combination parameters.
+		 *
+		 * @param filename   output file, overwritten if it exists
+		 * @param imageType  IMAGETYP of the master, NULL to copy type from inputs
+		 *
+		 * @return 0 on success, -1 on error
+		 */
+		int writeMaster (const char *filename, const char *imageType = NULL);
+
+		/**
+		 * Combine values of single pixel by clipped median.
+		 *
+		 * @param values   values from frames, NAN values are ignored. Buffer is reordered.
+		 * @param n        number of values
+		 * @param scratch  buffer for n values
+		 * @param used     returns number of values which were not rejected
+		 */
+		static float combineMedian (float *values, size_t n, float *scratch, float kappaLow, float kappaHigh, int iterations, size_t &used);
+
+		/**
+		 * Combine row of pixels by clipped mean.
+		 *
+		 * @param rows     pointers to rows of frames
+		 * @param n        number of frames
+		 * @param w        row length
+		 * @param out      combined row
+		 * @param used     returns number of values used for each pixel
+		 * @param scratch  buffer for 6 * w values
+		 */
+		static void combineMean (const float **rows, size_t n, int w, float kappaLow, float kappaHigh, int iterations, float *out, float *used, float *scratch);
+
+		/**
+		 * Combine rows of the current block until all rows are
+		 * combined. Used by worker threads.
+		 */
+		void combineRows ();
+
+	private:
+		StackParams params;
+
+		std::vector <StackInput *> inputs;
+		std::vector <float> scales;
+		std::vector <float> darkScales;
+
+		int width;
+		int height;
+		int blockRows;
+
+		std::vector <float> bias;
+		std::vector <float> dark;
+		std::string biasName;
+		std::string darkName;
+		float darkExposure;
+
+		std::vector <float> master;
+
+		// row buffers of frames; block is read to one while the other is combined
+		std::vector <float> blocks[2];
+		// block being combined
+		const float *block;
+		int blockStart;
+		int blockLength;
+		int nextRow;
+		pthread_mutex_t rowMutex;
+
+		size_t rejected;
+		size_t total;
+
+		int checkSize (StackInput *input);
+		int readFrame (StackInput &input, std::vector <float> &data);
+
+		// read and calibrate rows of all frames
+		int readBlock (int start, int nrows, float *buf);
+		void calibrate (size_t i, int row, int nrows, float *buf);
+
+		int estimateScales ();
+};
+
+}
+
+#endif // !__RTS2_CALIBSTACK__
@@ -21,6 +21,7 @@
 #define __RTS2_CAMERA_IMAGE__
 
 #include "rts2fits/image.h"
+#include "exposuretrace.h"
 
 #include <map>
 #include <vector>
@@ -68,6 +69,8 @@ class CameraImage
 		double exEnd;
 		bool dataWriten;
 		Image *image;
+		// timestamps of the exposure chain
+		rts2core::ExposureTrace trace;
 
 		CameraImage (Image * in_image, double in_exStart, std::vector < rts2core::DevClient * > &_prematurelyReceived)
 		{
@@ -93,6 +96,11 @@ class CameraImage
 
 		bool canDelete ();
 
+		/**
+		 * Write exposure chain latencies to image header.
+		 */
+		void writeTrace ();
+
 		/**
 		 * Return true if the image is waiting for some of the metadata.
 		 */
@@ -0,0 +1,171 @@
+/*
+ * FITS tile compression of image channels.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_FITS_COMPRESSION__
+#define __RTS2_FITS_COMPRESSION__
+
+#include <fitsio.h>
+#include <pthread.h>
+#include <vector>
+
+#include "data.h"
+
+namespace rts2image
+{
+
+/**
+ * Tile compression settings. Compression type is one of CFITSIO
+ * compression constants (RICE_1, HCOMPRESS_1, GZIP_1, GZIP_2, PLIO_1), 0
+ * means images are written uncompressed.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class TileCompression
+{
+	public:
+		TileCompression ()
+		{
+			type = 0;
+			tileRows = 0;
+			quantize = 4;
+			threads = 1;
+		}
+
+		/**
+		 * Set compression type from its name.
+		 *
+		 * @param name  compression name (none, rice, hcompress, gzip, gzip2 or plio)
+		 *
+		 * @return -1 if the name is not known, 0 on success
+		 */
+		int setType (const char *name);
+
+		const char *getTypeName ();
+
+		bool isCompressed () { return type != 0; }
+
+		/**
+		 * Set tile compression parameters of the given file. Parameters are
+		 * used for any image HDU created afterwards.
+		 *
+		 * @param fptr      file which will receive compressed HDU
+		 * @param dataType  RTS2_DATA_XXX type of the image
+		 * @param sizes     image dimensions
+		 * @param status    CFITSIO status
+		 */
+		int setFileCompression (fitsfile *fptr, int dataType, long sizes[2], int *status);
+
+		// CFITSIO compression type
+		int type;
+		// rows in a single tile, 0 for CFITSIO default (row by row, 16 rows for HCOMPRESS)
+		int tileRows;
+		// quantization level for floating point images, 0 for lossless compression
+		float quantize;
+		// number of threads compressing channels
+		int threads;
+};
+
+/**
+ * Compress image channels into in-memory FITS files. Channels are
+ * compressed in parallel by a pool of threads, compressed HDUs are then
+ * appended to the target file without recompression.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class ChannelCompressor
+{
+	public:
+		ChannelCompressor (TileCompression &_compression);
+		~ChannelCompressor ();
+
+		/**
+		 * Compress all data channels. Each channel starts with imghdr.
+		 *
+		 * @param data   data channels as received from camera
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int compress (rts2core::DataChannels *data);
+
+		/**
+		 * Compress single channel. Results of other channels are kept,
+		 * previous result of the same channel is replaced.
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int compress (char *in_data, char *fullTop);
+
+		/**
+		 * Append compressed channel to the end of the file. The new HDU becomes current HDU of the file.
+		 *
+		 * @param channel    channel number (as recorded in imghdr)
+		 * @param out        target FITS file
+		 * @param status     CFITSIO status
+		 *
+		 * @return -1 when channel was not compressed, or CFITSIO error occured
+		 */
+		int appendTo (int channel, fitsfile *out, int *status);
+
+		/**
+		 * Returns number of bytes of the compressed channels.
+		 */
+		size_t getCompressedSize ();
+
+		/**
+		 * Returns number of bytes of the uncompressed data.
+		 */
+		size_t getRawSize ();
+
+		/**
+		 * Delete all compressed channels.
+		 */
+		void clear ();
+
+		/**
+		 * Compress single queued job. Used by worker threads.
+		 *
+		 * @return false if there is no job to process
+		 */
+		bool compressNext ();
+
+	private:
+		struct CompressJob
+		{
+			int channel;
+			char *data;
+			char *top;
+			void *memptr;
+			size_t memsize;
+			fitsfile *fptr;
+			int status;
+		};
+
+		TileCompression compression;
+
+		std::vector <CompressJob *> jobs;
+		size_t nextJob;
+		pthread_mutex_t jobMutex;
+
+		void runJob (CompressJob *job);
+		void freeJob (CompressJob *job);
+};
+
+}
+
+#endif // !__RTS2_FITS_COMPRESSION__
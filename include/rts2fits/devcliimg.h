@@ -127,6 +127,9 @@ class DevClientCameraImage:public rts2core::DevClientCamera
 		// template for headers.
 		rts2core::IniParser *fitsTemplate;
 
+		// tile compression of written images
+		TileCompression compression;
+
 	private:
 		// queue for images needed to be checked for metadata arrival
 		std::vector <Image *> checkImages;
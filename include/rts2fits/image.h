@@ -30,6 +30,8 @@
 
 #include "rts2fits/fitsfile.h"
 #include "rts2fits/channel.h"
+#include "rts2fits/compression.h"
+#include "rts2fits/imageprocess.h"
 
 #include "libnova_cpp.h"
 #include "devclient.h"
@@ -68,22 +70,6 @@ namespace rts2image
 /** Image scaling functions. */
 typedef enum { SCALING_LINEAR, SCALING_LOG, SCALING_SQRT, SCALING_POW } scaling_type;
 
-/**
- * One pixel at the image, with coordinates and a value.
- */
-struct pixel
-{
-	int x;
-	int y;
-	unsigned short value;
-};
-
-struct stardata
-{
-	double X, Y, F, Fe, fwhm;
-	int flags;
-};
-
 typedef enum
 {
 	IMGTYPE_UNKNOW, IMGTYPE_DARK, IMGTYPE_FLAT, IMGTYPE_OBJECT, IMGTYPE_ZERO,
@@ -263,6 +249,25 @@ class Image:public FitsFile
 
 		int writeData (char *in_data, char *fullTop, int nchan);
 
+		/**
+		 * Set tile compression of the image data. Must be called
+		 * before data are written.
+		 *
+		 * @param _compression  compression parameters
+		 */
+		void setCompression (TileCompression &_compression) { compression = _compression; }
+
+		/**
+		 * Compress all data channels in parallel. Compressed channels
+		 * are then used by writeData call. Does nothing if image
+		 * compression is not enabled.
+		 *
+		 * @param data  data channels
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int compressChannels (rts2core::DataChannels *data);
+
 		/**
 		 * Fill image header structure.
 		 */
@@ -687,17 +692,20 @@ class Image:public FitsFile
 		 */
 		double getExposureLST ();
 
-		// image processing routines and values
-		double classicMedian (double *q, int n, double *sigma);
-		int findMaxIntensity (unsigned short *in_data, struct pixel *ret);
-		unsigned short getPixel (unsigned short *data, int x, int y);
-		int findStar (unsigned short *data);
-		int aperture (unsigned short *data, struct pixel pix, struct pixel *ret);
-		int centroid (unsigned short *data, struct pixel pix, float *px, float *py);
-		int radius (unsigned short *data, double px, double py, int rmax);
-		int integrate (unsigned short *data, double px, double py, int size, float *ret);
-
-		std::vector < pixel > list;
+		/**
+		 * Find stars on image channel and store them as star data
+		 * (sexResults), replacing results of previous detection. Works
+		 * with any channel data type. Star positions are in pixels,
+		 * counted from 1 as positions reported by sextractor.
+		 *
+		 * @param chan    channel number
+		 * @param params  detection parameters
+		 *
+		 * @return number of stars found, -1 on error
+		 */
+		int findStars (int chan, const StarFindParams &params = StarFindParams ());
+
+		// background level and noise found by findStars
 		double median, sigma;
 
 		/**
@@ -793,8 +801,16 @@ class Image:public FitsFile
 
 		std::map <int, TableData *> arrayGroups;
 
+		TileCompression compression;
+		ChannelCompressor *compressor;
+
 		void initData ();
 
+		/**
+		 * Append tile compressed channel to the file.
+		 */
+		int writeCompressedData (char *in_data, char *fullTop);
+
 		/**
 		 * Write data channel (image) header).
 		 */
@@ -0,0 +1,176 @@
+/*
+ * Star detection and centroiding kernels.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_IMAGEPROCESS__
+#define __RTS2_IMAGEPROCESS__
+
+#include <stddef.h>
+#include <vector>
+
+// star touches image border
+#define STAR_EDGE          0x01
+// centroid iterations did not converge, position is isophotal centroid
+#define STAR_NOCONVERGE    0x02
+
+namespace rts2image
+{
+
+struct stardata
+{
+	double X, Y, F, Fe, fwhm;
+	int flags;
+};
+
+/**
+ * Star detection parameters.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class StarFindParams
+{
+	public:
+		StarFindParams ()
+		{
+			threshold = 5;
+			minArea = 5;
+			fwhm = 3;
+			clipKappa = 3;
+			clipIterations = 5;
+			sampleStep = 1;
+		}
+
+		// detection threshold, in background sigmas of the smoothed image
+		float threshold;
+		// minimal number of pixels above threshold
+		int minArea;
+		// expected star FWHM in pixels, sets smoothing kernel and centroid window
+		float fwhm;
+		// background estimate sigma clipping
+		float clipKappa;
+		int clipIterations;
+		// use every n-th pixel for background estimate
+		int sampleStep;
+};
+
+/**
+ * Returns median of the buffer. Uses selection, so buffer is reordered.
+ * Median of even number of values is average of the two middle values.
+ */
+float selectMedian (float *buf, size_t n);
+
+/**
+ * Iterative sigma clipping. Sigma is estimated from median absolute
+ * deviation, values further than kappa * sigma from median are removed.
+ * Buffer is reordered and its used part shrinks.
+ *
+ * @param buf         values
+ * @param n           number of values
+ * @param kappa       clipping limit, in sigmas
+ * @param iterations  maximal number of clipping iterations
+ * @param median      returned median of the clipped values
+ * @param sigma       returned sigma of the clipped values
+ */
+void sigmaClip (float *buf, size_t n, float kappa, int iterations, float &median, float &sigma);
+
+/**
+ * Fills normalised 1D Gaussian kernel of given FWHM.
+ */
+void gaussianKernel (float fwhm, std::vector <float> &kernel);
+
+/**
+ * Convolve image with separable kernel - rows first, then columns. Image
+ * edges are extended by their border pixels.
+ *
+ * @param in      input image
+ * @param out     output image, must not be the same as in
+ * @param w       image width
+ * @param h       image height
+ * @param kernel  1D kernel, odd size
+ */
+void convolveSeparable (const float *in, float *out, int w, int h, const std::vector <float> &kernel);
+
+/**
+ * Label 8-connected components of pixels above threshold.
+ *
+ * @param in      image
+ * @param w       image width
+ * @param h       image height
+ * @param thresh  threshold
+ * @param labels  w * h labels, 0 for pixels not above threshold, 1..n for components
+ *
+ * @return number of components
+ */
+int labelComponents (const float *in, int w, int h, float thresh, int *labels);
+
+/**
+ * Sub-pixel centroid of a star. Iterates centroid weighted by Gaussian
+ * window of the star FWHM, which converges to center of Gaussian
+ * profile and is insensitive to noise in the star wings.
+ *
+ * @param in    image
+ * @param w     image width
+ * @param h     image height
+ * @param bkg   background level
+ * @param x     initial position, returns centroid
+ * @param y     initial position, returns centroid
+ * @param fwhm  window FWHM
+ *
+ * @return false if centroid did not converge, x and y are not changed
+ */
+bool gaussianCentroid (const float *in, int w, int h, float bkg, double &x, double &y, float fwhm);
+
+/**
+ * Find stars on image. Background and its noise are estimated by sigma
+ * clipping, image is smoothed with Gaussian kernel and components above
+ * threshold are centroided.
+ *
+ * @param in      image
+ * @param w       image width
+ * @param h       image height
+ * @param stars   found stars, sorted by flux, brightest first
+ * @param params  detection parameters
+ * @param median  if not NULL, returns background level
+ * @param sigma   if not NULL, returns background noise
+ *
+ * @return number of stars found
+ */
+int findStars (const float *in, int w, int h, std::vector <stardata> &stars, const StarFindParams &params, float *median = NULL, float *sigma = NULL);
+
+/**
+ * Convert image data of any type to floats.
+ */
+template <typename T> void toFloat (const T *in, float *out, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		out[i] = in[i];
+}
+
+/**
+ * Find stars on image of any data type.
+ */
+template <typename T> int findStars (const T *in, int w, int h, std::vector <stardata> &stars, const StarFindParams &params, float *median = NULL, float *sigma = NULL)
+{
+	std::vector <float> buf ((size_t) w * h);
+	toFloat (in, buf.data (), buf.size ());
+	return findStars ((const float *) buf.data (), w, h, stars, params, median, sigma);
+}
+
+}
+
+#endif // !__RTS2_IMAGEPROCESS__
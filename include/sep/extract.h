@@ -75,10 +75,11 @@ typedef struct
 } arraybuffer;
 
 
-/* globals */
-extern int plistexist_cdvalue, plistexist_thresh, plistexist_var;
-extern int plistoff_value, plistoff_cdvalue, plistoff_thresh, plistoff_var;
-extern int plistsize;
+/* globals, per thread so extraction can run in several threads */
+extern __thread int plistexist_cdvalue, plistexist_thresh, plistexist_var;
+extern __thread int plistoff_value, plistoff_cdvalue, plistoff_thresh,
+  plistoff_var;
+extern __thread int plistsize;
 
 typedef struct
 {
@@ -154,6 +154,16 @@ int sep_background(sep_image *image,
                    double fthresh,   /* filter threshold                 */
                    sep_bkg **bkg);   /* OUTPUT                           */
 
+/* sep_background_mt()
+ *
+ * As sep_background(), with rows of background meshes processed by
+ * `nthreads` threads (number of online CPUs if nthreads <= 0). The result
+ * is identical to sep_background().
+ */
+int sep_background_mt(sep_image *image,
+                      int bw, int bh, int fw, int fh, double fthresh,
+                      int nthreads, sep_bkg **bkg);
+
 
 /* sep_bkg_global[rms]()
  *
@@ -194,6 +204,14 @@ int sep_bkg_array(sep_bkg *bkg, void *arr, int dtype);
 int sep_bkg_subarray(sep_bkg *bkg, void *arr, int dtype);
 int sep_bkg_rmsarray(sep_bkg *bkg, void *arr, int dtype);
 
+/* sep_bkg_[sub]array_mt()
+ *
+ * As sep_bkg_[sub]array(), with bands of lines evaluated by `nthreads`
+ * threads (number of online CPUs if nthreads <= 0).
+ */
+int sep_bkg_array_mt(sep_bkg *bkg, void *arr, int dtype, int nthreads);
+int sep_bkg_subarray_mt(sep_bkg *bkg, void *arr, int dtype, int nthreads);
+
 /* sep_bkg_free()
  *
  * Free memory associated with bkg.
@@ -231,6 +249,21 @@ int sep_extract(sep_image *image,
 		double clean_param,   /* clean parameter               [1.0] */
                 sep_catalog **catalog); /* OUTPUT catalog                    */
 
+/* sep_extract_mt()
+ *
+ * As sep_extract(), extracting horizontal tiles of `tileh` lines in
+ * `nthreads` threads (number of online CPUs if nthreads <= 0). Tiles
+ * overlap, objects crossing tile boundaries are taken from the tile
+ * holding their first line. The catalog is identical to sep_extract(),
+ * including order of objects. If tileh <= 0, tile height is selected to
+ * give few tiles per thread.
+ */
+int sep_extract_mt(sep_image *image, float thresh, int thresh_type,
+                   int minarea, float *conv, int convw, int convh,
+                   int filter_type, int deblend_nthresh, double deblend_cont,
+                   int clean_flag, double clean_param,
+                   int tileh, int nthreads, sep_catalog **catalog);
+
 
 
 /* set and get the size of the pixel stack used in extract() */
@@ -271,6 +304,17 @@ int sep_sum_circle(sep_image *image,
 		   short *flag);      /* OUTPUT: flags */
 
 
+/* sep_sum_circle_array()
+ *
+ * Sum circular apertures of radius r centered at (x[i], y[i]) for n
+ * objects, using `nthreads` threads (number of online CPUs if
+ * nthreads <= 0). Output arrays must hold n elements.
+ */
+int sep_sum_circle_array(sep_image *image, double *x, double *y, int n,
+                         double r, int subpix, short inflags,
+                         double *sum, double *sumerr, double *area,
+                         short *flag, int nthreads);
+
 int sep_sum_circann(sep_image *image,
                     double x, double y, double rin, double rout,
                     int subpix, short inflags,
@@ -83,3 +83,12 @@ int get_converter(int dtype, converter *f, int *size);
 int get_array_converter(int dtype, array_converter *f, int *size);
 int get_array_writer(int dtype, array_writer *f, int *size);
 int get_array_subtractor(int dtype, array_writer *f, int *size);
+
+/* job run by worker threads, returns RETURN_OK or error code */
+typedef int (*sep_job)(void *arg, int job);
+
+/* number of worker threads; nthreads <= 0 means number of online CPUs */
+int sep_get_nthreads(int nthreads);
+
+/* run jobs 0..njobs-1 on worker threads, returns first error */
+int sep_run_jobs(int nthreads, int njobs, sep_job func, void *arg);
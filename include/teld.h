@@ -23,10 +23,11 @@
 #include <libnova/libnova.h>
 #include <sys/time.h>
 #include <time.h>
-#include "pluto/norad.h"
+#include "pluto/satengine.h"
 
 #include "device.h"
 #include "objectcheck.h"
+#include "dut1.h"
 
 // pointing models
 #define POINTING_RADEC          0
@@ -413,6 +414,8 @@ class Telescope:public rts2core::Device
 		rts2core::ValueFloat *telHumidity;
 		rts2core::ValueFloat *telWavelength;
 		rts2core::ValueDouble *telDUT1;
+		rts2core::ValueDouble *telPolarX;
+		rts2core::ValueDouble *telPolarY;
 
 		/**
 		 * Which coordinates are used for pointing (eq, alt-az,..)
@@ -1439,7 +1442,8 @@ class Telescope:public rts2core::Device
 
 		rts2core::ValueDouble *trackingLogInterval;
 
-		tle_t tle;
+		// TLE propagation, initialized once per TLE
+		rts2pluto::SatelliteEngine tleEngine;
 
 		// Value for RA DEC differential tracking
 		rts2core::ValueRaDec *diffRaDec;
@@ -1460,8 +1464,14 @@ class Telescope:public rts2core::Device
 		double lastTrackLog;
 		double unstableDist;
 
+		/**
+		 * Interpolate DUT1 and polar motion for the current time from
+		 * the EOP table. The table is reloaded only if the file changed.
+		 */
 		void updateDUT1 ();
 		const char *dut1fn;
+		rts2core::EOPTable eop;
+		double nextDUT1Update;
 
 		int requestDUT1 ();
 
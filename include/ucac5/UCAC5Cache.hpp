@@ -0,0 +1,214 @@
+/*
+ * UCAC5 sub-catalog cache with background prefetch.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __UCAC5CACHE__
+#define __UCAC5CACHE__
+
+#include "ucac5/UCAC5Record.hpp"
+#include "ucac5/UCAC5Bands.hpp"
+#include "gtp/Vector.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Star returned from the cache. Positions are in radians, corrected for
+ * proper motion to requested epoch. Magnitudes are in mag.
+ */
+struct UCAC5Star
+{
+	uint64_t srcid;
+	double ra;
+	double dec;
+	// distance from field center (radians)
+	double dist;
+	float gmag;
+	float umag;
+	float rmag;
+	float jmag;
+	float hmag;
+	float kmag;
+};
+
+/**
+ * Compact star record kept in cache - Gaia position at epoch 2015.0,
+ * proper motion and magnitudes.
+ */
+struct UCAC5CachedStar
+{
+	uint64_t srcid;
+	Vector xyz;
+	double ra;
+	double dec;
+	// proper motion, radians/year; pmra is not multiplied by cos(dec)
+	float pmra;
+	float pmdec;
+	int16_t mags[6];
+};
+
+/**
+ * Cached catalog field.
+ */
+struct UCAC5Field
+{
+	double ra;
+	double dec;
+	double radius;
+	Vector center;
+	bool ready;
+	int ret;
+	// number of threads waiting for field to be loaded
+	int waiting;
+	std::vector <UCAC5CachedStar> stars;
+};
+
+/**
+ * Cache of UCAC5 sub-catalogs. Band index and zone files are opened and
+ * mmaped once and kept open. Fields around upcoming targets can be
+ * queued with prefetch, and are loaded by background threads. Stars for
+ * an image are then served from memory, only proper motion correction to
+ * the requested epoch is calculated.
+ *
+ * rts2-ucac5d prefetches fields of targets queued in the executor and
+ * serves them to image processing scripts, ucac5-search prefetches fields
+ * listed in its input file.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class UCAC5Cache
+{
+	public:
+		/**
+		 * @param _maxFields  maximal number of cached fields; least recently used fields are dropped
+		 */
+		UCAC5Cache(size_t _maxFields = 32);
+		~UCAC5Cache();
+
+		/**
+		 * Open UCAC5 catalog.
+		 *
+		 * @param _base  directory with u5index.unf, zone (zNNN) and index (zNNN.xyz) files
+		 *
+		 * @return 0 on success, -1 on error
+		 */
+		int openCatalog(const char *_base);
+
+		/**
+		 * Start background prefetch threads.
+		 */
+		int startPrefetch(int threads = 2);
+
+		/**
+		 * Stop background threads. Queued fields which were not yet loaded are dropped.
+		 */
+		void stopPrefetch();
+
+		/**
+		 * Queue field for loading. Returns immediately.
+		 *
+		 * @param ra      field center RA (radians)
+		 * @param dec     field center DEC (radians)
+		 * @param radius  field radius (radians)
+		 */
+		void prefetch(double ra, double dec, double radius);
+
+		/**
+		 * Returns stars inside given field. Field is served from cache if
+		 * any cached field covers it, otherwise it is loaded from catalog files.
+		 *
+		 * @param ra      field center RA (radians)
+		 * @param dec     field center DEC (radians)
+		 * @param minRad  minimal distance from center (radians)
+		 * @param maxRad  maximal distance from center (radians)
+		 * @param epoch   epoch of returned positions (Julian year, e.g. 2026.5)
+		 * @param stars   returned stars
+		 * @param wait    if field is being loaded by background thread, wait for it; if false, field is loaded again
+		 *
+		 * @return number of stars, -1 on error
+		 */
+		int getStars(double ra, double dec, double minRad, double maxRad, double epoch, std::vector <UCAC5Star> &stars, bool wait = true);
+
+		/**
+		 * Returns true if field is in cache and loaded.
+		 */
+		bool isCached(double ra, double dec, double radius);
+
+		size_t getHits() { return hits; }
+		size_t getMisses() { return misses; }
+		size_t getPrefetched() { return prefetched; }
+
+		size_t fieldCount();
+		size_t queueSize();
+
+		// background thread loop; public for thread start function
+		void prefetchLoop();
+
+	private:
+		struct UCAC5Zone
+		{
+			int xyz_fd;
+			Vector *xyz;
+			size_t xyz_size;
+			int data_fd;
+			struct ucac5 *data;
+			size_t data_size;
+		};
+
+		std::string base;
+		UCAC5Bands bands;
+		bool bandsOpened;
+
+		size_t maxFields;
+
+		std::map <int, UCAC5Zone> zones;
+		// most recently used fields are at front
+		std::list <UCAC5Field*> fields;
+		std::list <UCAC5Field*> queue;
+
+		std::vector <pthread_t> workers;
+		bool running;
+
+		pthread_mutex_t mutex;
+		pthread_cond_t queueCond;
+		pthread_cond_t loadedCond;
+
+		size_t hits;
+		size_t misses;
+		size_t prefetched;
+
+		// returns opened zone, NULL on error; must be called with mutex locked
+		UCAC5Zone *getZone(int dec_b);
+
+		// search catalog files, fill field stars; called without mutex locked
+		int loadField(UCAC5Field *field);
+
+		// find field covering given circle, must be called with mutex locked
+		UCAC5Field *findField(double ra, double dec, double radius);
+
+		UCAC5Field *newField(double ra, double dec, double radius);
+
+		// drop least recently used loaded fields over maxFields, must be called with mutex locked
+		void expire();
+};
+
+#endif // !__UCAC5CACHE__
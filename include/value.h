@@ -490,6 +490,36 @@ class Value
 		 */
 		virtual void send (Connection * connection);
 
+		/**
+		 * Append value message to the frame. Frame is encoded only once
+		 * and send to all connections which shall receive the value.
+		 *
+		 * @param frame  frame to which the value message is appended
+		 */
+		virtual void encode (std::string &frame);
+
+		/**
+		 * Append binary record of the value to the frame - record type,
+		 * length and payload. Default implementation puts text of the
+		 * value, as encoded for PROTO_VALUE, into BINARY_VALUE_TEXT record.
+		 *
+		 * @param frame  frame to which record is appended
+		 *
+		 * @see ValueFrame
+		 */
+		virtual void encodeBinary (std::string &frame);
+
+		/**
+		 * Set value from binary record payload.
+		 *
+		 * @param type    record type
+		 * @param data    record payload
+		 * @param length  payload length
+		 *
+		 * @return 0 on success, -1 if record type is not supported or record is invalid
+		 */
+		virtual int decodeBinary (char type, const char *data, size_t length) { return -1; }
+
 		/**
 		 * Reset value change bit, so changes will be recorded from now on.
 		 *
@@ -562,6 +592,7 @@ class ValueString:public Value
 		virtual const char *getValue ();
 		std::string getValueString () { return value; }
 		virtual void send (Connection * connection);
+		virtual void encode (std::string &frame);
 		virtual void setFromValue (Value * newValue);
 		virtual bool isEqual (Value *other_value);
 		virtual int checkNotNull ();
@@ -612,6 +643,8 @@ class ValueInteger:public Value
 		virtual void setFromValue (Value * newValue);
 		virtual bool isEqual (Value *other_value);
 		virtual int checkNotNull ();
+		virtual void encodeBinary (std::string &frame);
+		virtual int decodeBinary (char type, const char *data, size_t length);
 	private:
 		int value;
 };
@@ -650,6 +683,8 @@ class ValueDouble:public Value
 		virtual void setFromValue (Value * newValue);
 		virtual bool isEqual (Value *other_value);
 		virtual int checkNotNull ();
+		virtual void encodeBinary (std::string &frame);
+		virtual int decodeBinary (char type, const char *data, size_t length);
 	protected:
 		double value;
 };
@@ -959,6 +994,8 @@ class ValueLong:public Value
 		}
 		virtual void setFromValue (Value * newValue);
 		virtual bool isEqual (Value *other_value);
+		virtual void encodeBinary (std::string &frame);
+		virtual int decodeBinary (char type, const char *data, size_t length);
 	private:
 		long int value;
 };
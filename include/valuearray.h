@@ -138,6 +138,8 @@ class DoubleArray: public ValueArray
 		virtual const char *getValue ();
 		virtual void setFromValue (rts2core::Value *newValue);
 		virtual bool isEqual (rts2core::Value *other_val);
+		virtual void encodeBinary (std::string &frame);
+		virtual int decodeBinary (char type, const char *data, size_t length);
 
 		void setValueArray (std::vector <double> _arr);
 
@@ -214,6 +216,8 @@ class IntegerArray: public ValueArray
 		virtual const char *getValue ();
 		virtual void setFromValue (rts2core::Value *newValue);
 		virtual bool isEqual (rts2core::Value *other_val);
+		virtual void encodeBinary (std::string &frame);
+		virtual int decodeBinary (char type, const char *data, size_t length);
 
 		void setValueInteger (int i, int v) { value[i] = v; }
 
@@ -0,0 +1,154 @@
+/*
+ * Value updates encoded for the text and binary protocol.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_VALUEFRAME__
+#define __RTS2_VALUEFRAME__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * Version of the binary value frames. Client requests binary frames with
+ * COMMAND_BINARY_VALUES command, daemons which do not know the command
+ * (or the version) return an error and continue to send text updates.
+ */
+#define BINARY_VALUES_VERSION     1
+
+/**
+ * Binary value frame consists of records. Each record starts with varint
+ * value ID, followed by record type, varint payload length and payload.
+ * Value IDs are assigned by the sender. Before ID is used for the first
+ * time, BINARY_VALUE_NAME record with value name as payload is send.
+ */
+#define BINARY_VALUE_NAME         '='
+// maximal accepted value ID, protects receiver from allocating huge ID tables
+#define MAX_BINARY_ID             1048576
+// value text, as it will be send after value name in PROTO_VALUE command
+#define BINARY_VALUE_TEXT         'T'
+// double, 8 bytes, little endian
+#define BINARY_VALUE_DOUBLE       'D'
+// zigzag varint
+#define BINARY_VALUE_INTEGER      'I'
+#define BINARY_VALUE_LONG         'L'
+// varint number of measurements, value, mode, min, max and stdev as doubles
+#define BINARY_VALUE_STAT         'S'
+// varint count, doubles XORed with the previous element
+#define BINARY_VALUE_DARRAY       'A'
+// varint count, zigzag varint differences to the previous element
+#define BINARY_VALUE_IARRAY       'N'
+
+namespace rts2core
+{
+
+class Value;
+
+void binaryPutVarint (std::string &frame, uint64_t v);
+
+/**
+ * Put signed number, zigzag encoded, so small negative numbers use
+ * a single byte.
+ */
+void binaryPutSigned (std::string &frame, int64_t v);
+
+void binaryPutDouble (std::string &frame, double v);
+
+/**
+ * Put double as XOR with the previous double. Neighbouring array
+ * elements usually share sign, exponent and upper bits of mantissa,
+ * which are then not send.
+ *
+ * @param prev  bits of the previous double, updated by the call
+ */
+void binaryPutDoubleDelta (std::string &frame, double v, uint64_t &prev);
+
+/**
+ * Put record header - type and payload length.
+ */
+void binaryPutRecord (std::string &frame, char type, size_t length);
+
+/**
+ * Functions reading frame data. All return -1 if data are too short.
+ */
+int binaryGetVarint (const char *&data, const char *end, uint64_t &v);
+int binaryGetSigned (const char *&data, const char *end, int64_t &v);
+int binaryGetDouble (const char *&data, const char *end, double &v);
+int binaryGetDoubleDelta (const char *&data, const char *end, double &v, uint64_t &prev);
+
+/**
+ * Updates of values, which are send to multiple connections. Text and
+ * binary representation are encoded only when needed, and only once for
+ * all connections.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class ValueFrame
+{
+	public:
+		ValueFrame () {}
+
+		/**
+		 * Add value to the frame.
+		 *
+		 * @param value    value
+		 * @param id       sender value ID, used in binary frames
+		 */
+		void add (Value *value, int id);
+
+		bool empty () { return values.empty (); }
+
+		/**
+		 * Returns PROTO_VALUE lines for the values.
+		 */
+		const std::string &getText ();
+
+		/**
+		 * Returns binary records for the values.
+		 */
+		const std::string &getBinary ();
+
+		/**
+		 * Append text of i-th value to the string. Used to send
+		 * subset of values to connections with subscriptions.
+		 */
+		void appendText (std::string &out, size_t i);
+
+		/**
+		 * Append binary record of i-th value to the string.
+		 */
+		void appendBinary (std::string &out, size_t i);
+
+		size_t size () { return values.size (); }
+		Value *getValue (size_t i) { return values[i]; }
+		int getId (size_t i) { return ids[i]; }
+
+	private:
+		std::vector <Value *> values;
+		std::vector <int> ids;
+
+		std::string text;
+		std::string binary;
+		// end of i-th value in text and binary
+		std::vector <size_t> textEnd;
+		std::vector <size_t> binaryEnd;
+};
+
+}
+
+#endif // !__RTS2_VALUEFRAME__
@@ -20,7 +20,11 @@
 #ifndef __RTS2_VALUELIST__
 #define __RTS2_VALUELIST__
 
+#include <algorithm>
+#include <unordered_map>
 #include <vector>
+#include <ctype.h>
+#include <strings.h>
 
 #include "value.h"
 #include "app.h"
@@ -28,6 +32,141 @@
 namespace rts2core
 {
 
+/**
+ * Hash index of value names. Names are interned - once a name is
+ * registered, it gets small integer ID which does not change even if the
+ * value is removed and later added again. Names are compared case
+ * insensitive, as in Value::isValue.
+ *
+ * @ingroup RTS2Value
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+template <typename T> class ValueRegistry
+{
+	public:
+		ValueRegistry ():buckets (16, -1) {}
+
+		/**
+		 * Returns ID of the name, registering the name if it is not yet known.
+		 */
+		int intern (const char *name)
+		{
+			size_t h = hashName (name);
+			int id = findId (name, h);
+			if (id >= 0)
+				return id;
+			// keep load factor below 0.5
+			if ((entries.size () + 1) * 2 > buckets.size ())
+				rehash (buckets.size () * 2);
+			id = entries.size ();
+			entries.push_back (Entry (name, h));
+			buckets[findFree (h)] = id;
+			return id;
+		}
+
+		/**
+		 * Returns ID of the name.
+		 *
+		 * @return name ID, -1 if name was never registered
+		 */
+		int getId (const char *name) { return findId (name, hashName (name)); }
+
+		/**
+		 * Returns value with given ID, NULL if there is no value for the ID.
+		 */
+		T *get (int id) { return (id < 0 || (size_t) id >= entries.size ()) ? NULL : entries[id].value; }
+
+		/**
+		 * Search for value by name.
+		 *
+		 * @return value with given name, NULL if it does not exist
+		 */
+		T *find (const char *name) { return get (getId (name)); }
+
+		/**
+		 * Register value under name. If a value with the same name is
+		 * already registered, the first registered value is kept.
+		 *
+		 * @return ID of the value name
+		 */
+		int add (const char *name, T *value)
+		{
+			int id = intern (name);
+			if (entries[id].value == NULL)
+				entries[id].value = value;
+			return id;
+		}
+
+		/**
+		 * Remove value from the index. Name keeps its ID.
+		 */
+		void remove (const char *name)
+		{
+			int id = getId (name);
+			if (id >= 0)
+				entries[id].value = NULL;
+		}
+
+		/**
+		 * Returns number of registered names.
+		 */
+		size_t size () { return entries.size (); }
+
+	private:
+		struct Entry
+		{
+			Entry (const char *_name, size_t _hash):name (_name), hash (_hash), value (NULL) {}
+			std::string name;
+			size_t hash;
+			T *value;
+		};
+
+		std::vector <Entry> entries;
+		// IDs of entries, -1 for an empty bucket; size is always a power of two
+		std::vector <int> buckets;
+
+		// FNV-1a of lower case name
+		static size_t hashName (const char *name)
+		{
+			size_t h = 2166136261u;
+			for (; *name; name++)
+			{
+				h ^= (unsigned char) tolower (*name);
+				h *= 16777619u;
+			}
+			return h;
+		}
+
+		int findId (const char *name, size_t h)
+		{
+			size_t mask = buckets.size () - 1;
+			for (size_t b = h & mask; buckets[b] >= 0; b = (b + 1) & mask)
+			{
+				Entry &e = entries[buckets[b]];
+				if (e.hash == h && !strcasecmp (e.name.c_str (), name))
+					return buckets[b];
+			}
+			return -1;
+		}
+
+		size_t findFree (size_t h)
+		{
+			size_t mask = buckets.size () - 1;
+			size_t b = h & mask;
+			while (buckets[b] >= 0)
+				b = (b + 1) & mask;
+			return b;
+		}
+
+		void rehash (size_t nsize)
+		{
+			buckets.assign (nsize, -1);
+			for (size_t i = 0; i < entries.size (); i++)
+				buckets[findFree (entries[i].hash)] = i;
+		}
+};
+
 /**
  * Represent set of Values. It's used to store values which shall
  * be reseted when new script starts etc..
@@ -57,15 +196,10 @@ class ValueVector:public std::vector < Value * >
 		 */
 		ValueVector::iterator getValueIterator (const char *value_name)
 		{
-			ValueVector::iterator val_iter;
-			for (val_iter = begin (); val_iter != end (); val_iter++)
-			{
-				Value *val;
-				val = (*val_iter);
-				if (val->isValue (value_name))
-					return val_iter;
-			}
-			return val_iter;
+			Value *val = getValue (value_name);
+			if (val == NULL)
+				return end ();
+			return std::find (begin (), end (), val);
 		}
 
 		/**
@@ -75,12 +209,45 @@ class ValueVector:public std::vector < Value * >
 		 *
 		 * @return  Value object of value with given name, or NULL if value with this name does not exists.
 		 */
-		Value *getValue (const char *value_name)
+		Value *getValue (const char *value_name) { return registry.find (value_name); }
+
+		/**
+		 * Returns ID of the value name. ID does not change when value
+		 * is removed and added again.
+		 *
+		 * @return value ID, -1 if value with the name was never added
+		 */
+		int getValueId (const char *value_name) { return registry.getId (value_name); }
+
+		/**
+		 * Returns ID of the value name, registering the name if it was
+		 * not yet seen. Value added later with the same name will get
+		 * this ID.
+		 */
+		int internValueId (const char *value_name) { return registry.intern (value_name); }
+
+		/**
+		 * Returns value with given ID, NULL if there isn't such value.
+		 */
+		Value *getValueById (int id) { return registry.get (id); }
+
+		/**
+		 * Add value to the list. Values must be added with this or
+		 * insertValue method, so they can be found by name.
+		 */
+		void addValue (Value *value)
 		{
-			ValueVector::iterator val_iter = getValueIterator (value_name);
-			if (val_iter == end ())
-				return NULL;
-			return (*val_iter);
+			push_back (value);
+			registry.add (value->getName ().c_str (), value);
+		}
+
+		/**
+		 * Insert value before given position.
+		 */
+		ValueVector::iterator insertValue (ValueVector::iterator pos, Value *value)
+		{
+			registry.add (value->getName ().c_str (), value);
+			return insert (pos, value);
 		}
 
 		/**
@@ -93,10 +260,14 @@ class ValueVector:public std::vector < Value * >
 			ValueVector::iterator val_iter = getValueIterator (value_name);
 			if (val_iter == end ())
 				return val_iter;
+			registry.remove (value_name);
 			delete (*val_iter);
 			val_iter = erase (val_iter);
 			return val_iter;
 		}
+
+	private:
+		ValueRegistry <Value> registry;
 };
 
 /**
@@ -114,6 +285,7 @@ class CondValue
 			value = in_value;
 			stateCondition = in_stateCondition;
 			save = 0;
+			id = -1;
 		}
 		~CondValue (void) { delete value; }
 
@@ -128,10 +300,17 @@ class CondValue
 
 		Value *getValue () { return value; }
 
+		/**
+		 * Returns value ID, assigned when value is added to CondValueVector.
+		 */
+		int getId () { return id; }
+		void setId (int _id) { id = _id; }
+
 	private:
 		Value *value;
 		int stateCondition;
 		int save;
+		int id;
 };
 
 /**
@@ -151,6 +330,48 @@ class CondValueVector:public std::vector < CondValue * >
 			for (CondValueVector::iterator iter = begin (); iter != end (); iter++)
 				delete *iter;
 		}
+
+		/**
+		 * Add value to the list, indexing it by name and value pointer.
+		 */
+		void addCondValue (CondValue *c_val)
+		{
+			push_back (c_val);
+			c_val->setId (registry.add (c_val->getValue ()->getName ().c_str (), c_val));
+			byValue[c_val->getValue ()] = c_val;
+		}
+
+		/**
+		 * Search for value by name.
+		 *
+		 * @return CondValue for value with given name, NULL if it does not exist
+		 */
+		CondValue *getCondValue (const char *value_name) { return registry.find (value_name); }
+
+		/**
+		 * Search for CondValue holding given value.
+		 */
+		CondValue *getCondValue (const Value *val)
+		{
+			std::unordered_map <const Value *, CondValue *>::iterator iter = byValue.find (val);
+			return iter == byValue.end () ? NULL : iter->second;
+		}
+
+		/**
+		 * Returns ID of the value name, -1 if value with the name does not exist.
+		 */
+		int getValueId (const char *value_name) { return registry.getId (value_name); }
+
+		/**
+		 * Returns ID for the name, registering the name if it is not known.
+		 */
+		int internValueId (const char *value_name) { return registry.intern (value_name); }
+
+		CondValue *getCondValueById (int id) { return registry.get (id); }
+
+	private:
+		ValueRegistry <CondValue> registry;
+		std::unordered_map <const Value *, CondValue *> byValue;
 };
 
 /**
@@ -53,6 +53,9 @@ class ValueDoubleStat:public ValueDouble
 		virtual const char *getValue ();
 		virtual const char *getDisplayValue ();
 		virtual void send (Connection * connection);
+		virtual void encode (std::string &frame);
+		virtual void encodeBinary (std::string &frame);
+		virtual int decodeBinary (char type, const char *data, size_t length);
 		virtual void setFromValue (Value * newValue);
 
 		int getNumMes () { return numMes; }
@@ -140,6 +143,7 @@ class ValueDoubleTimeserie:public ValueDouble
 		virtual const char *getValue ();
 		virtual const char *getDisplayValue ();
 		virtual void send (Connection * connection);
+		virtual void encode (std::string &frame);
 		virtual void setFromValue (Value * newValue);
 
 		int getNumMes () { return numMes; }
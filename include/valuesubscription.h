@@ -0,0 +1,117 @@
+/*
+ * Value subscriptions - filtering and rate limiting of value updates.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_VALUESUBSCRIPTION__
+#define __RTS2_VALUESUBSCRIPTION__
+
+#include <string>
+#include <vector>
+
+namespace rts2core
+{
+
+class Value;
+
+/**
+ * Values and update rate a client is interested in. Client sends
+ * subscription with COMMAND_SUBSCRIBE command, the daemon then sends to the
+ * connection only updates of values whose names match one of the patterns,
+ * and at most one update of each value per interval. Update withheld
+ * because of the rate limit is send after the interval expires, so the
+ * client always ends with the latest value.
+ *
+ * Replies to info command are not rate limited.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class ValueSubscription
+{
+	public:
+		/**
+		 * @param _interval  minimal interval between two updates of the same value, in seconds
+		 */
+		ValueSubscription (double _interval = 0);
+
+		/**
+		 * Add value name pattern. Patterns are shell wildcards
+		 * (fnmatch), matched without regard to case. Subscription
+		 * without patterns matches all values.
+		 */
+		void addPattern (const char *pattern);
+
+		const std::vector <std::string> &getPatterns () { return patterns; }
+
+		double getInterval () { return interval; }
+
+		/**
+		 * Returns true if value name matches subscription patterns.
+		 * Value info time always matches, as it is needed to timestamp
+		 * other values.
+		 *
+		 * @param value  value
+		 * @param id     value ID, used to cache result of pattern matching. -1 if value does not have ID.
+		 */
+		bool matches (Value *value, int id);
+
+		/**
+		 * Decide if value update should be send now.
+		 *
+		 * @param value      value
+		 * @param id         value ID. Values without ID (-1) are not rate limited.
+		 * @param now        current time
+		 * @param rateLimit  if false, matching value is always send
+		 *
+		 * @return true if the update should be send
+		 */
+		bool accept (Value *value, int id, double now, bool rateLimit = true)
+		{
+			// most values are usually not subscribed, reject them quickly
+			if (id >= 0 && (size_t) id < matched.size () && matched[id] < 0)
+				return false;
+			return checkAccept (value, id, now, rateLimit);
+		}
+
+		/**
+		 * Returns time when the first withheld value can be send, NAN if
+		 * no value is withheld.
+		 */
+		double getPendingTime () { return pendingTime; }
+
+		/**
+		 * Return IDs of withheld values which can be send now.
+		 */
+		void getPending (double now, std::vector <int> &ids);
+
+	private:
+		std::vector <std::string> patterns;
+
+		bool checkAccept (Value *value, int id, double now, bool rateLimit);
+		double interval;
+
+		// pattern matching results by value ID; 0 not known, 1 matches, -1 does not match
+		std::vector <signed char> matched;
+		std::vector <double> lastSend;
+		std::vector <bool> pending;
+		std::vector <int> pendingIds;
+		double pendingTime;
+};
+
+}
+
+#endif // !__RTS2_VALUESUBSCRIPTION__
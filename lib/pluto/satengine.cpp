@@ -0,0 +1,344 @@
+/*
+ * Cached satellite propagation and pass prediction.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "pluto/satengine.h"
+#include "pluto/observe.h"
+
+#include "objectcheck.h"
+
+#include <cmath>
+#include <string.h>
+
+// horizon crossings are refined to this precision (days)
+#define CROSSING_PRECISION    1e-7
+
+using namespace rts2pluto;
+
+SatelliteEngine::SatelliteEngine ()
+{
+	ephem = -1;
+	obsLng = obsLat = obsAltitude = NAN;
+	rho_cos_phi = 1;
+	rho_sin_phi = 0;
+	sinLat = 0;
+	cosLat = 1;
+}
+
+int SatelliteEngine::setTLE (const char *l1, const char *l2)
+{
+	tle_t parsed;
+	int ret = parse_elements (l1, l2, &parsed);
+	// keep previous TLE if new one cannot be parsed
+	if (ret != 0)
+		return ret;
+
+	tle = parsed;
+	ephem = 1;
+	int is_deep = select_ephemeris (&tle);
+	if (is_deep && (ephem == 1 || ephem == 2))
+		ephem += 2;	/* switch to an SDx */
+	if (!is_deep && (ephem == 3 || ephem == 4))
+		ephem -= 2;	/* switch to an SGx */
+
+	switch (ephem)
+	{
+		case 0:
+			SGP_init (sat_params, &tle);
+			break;
+		case 1:
+			SGP4_init (sat_params, &tle);
+			break;
+		case 2:
+			SGP8_init (sat_params, &tle);
+			break;
+		case 3:
+			SDP4_init (sat_params, &tle);
+			break;
+		case 4:
+			SDP8_init (sat_params, &tle);
+			break;
+	}
+	return 0;
+}
+
+void SatelliteEngine::setObserver (double lng, double lat, double altitude)
+{
+	if (lng == obsLng && lat == obsLat && altitude == obsAltitude)
+		return;
+	obsLng = lng;
+	obsLat = lat;
+	obsAltitude = altitude;
+
+	double lat_r = lat * M_PI / 180.0;
+	lat_alt_to_parallax (lat_r, altitude, &rho_cos_phi, &rho_sin_phi);
+	sinLat = sin (lat_r);
+	cosLat = cos (lat_r);
+}
+
+double SatelliteEngine::getPeriod ()
+{
+	// mean motion is in radians per minute
+	return 2 * M_PI / tle.xno / 1440.0;
+}
+
+void SatelliteEngine::propagate (double JD, double *sat_pos)
+{
+	double t_since = (JD - tle.epoch) * 1440.;
+	switch (ephem)
+	{
+		case 0:
+			SGP (t_since, &tle, sat_params, sat_pos, NULL);
+			break;
+		case 1:
+			SGP4 (t_since, &tle, sat_params, sat_pos, NULL);
+			break;
+		case 2:
+			SGP8 (t_since, &tle, sat_params, sat_pos, NULL);
+			break;
+		case 3:
+			// deep space models cache periodics and resonance integration in parameters, start always from initialized state
+			memcpy (deep_params, sat_params, sizeof (sat_params));
+			SDP4 (t_since, &tle, deep_params, sat_pos, NULL);
+			break;
+		case 4:
+			memcpy (deep_params, sat_params, sizeof (sat_params));
+			SDP8 (t_since, &tle, deep_params, sat_pos, NULL);
+			break;
+		default:
+			sat_pos[0] = sat_pos[1] = sat_pos[2] = NAN;
+	}
+}
+
+void SatelliteEngine::observerLocation (double JD, double *observer_loc)
+{
+	observer_cartesian_coords (JD, obsLng * M_PI / 180.0, rho_cos_phi, rho_sin_phi, observer_loc);
+}
+
+void SatelliteEngine::getPosition (double JD, double &ra, double &dec, double &dist)
+{
+	double sat_pos[3], observer_loc[3];
+	propagate (JD, sat_pos);
+	observerLocation (JD, observer_loc);
+	get_satellite_ra_dec_delta (observer_loc, sat_pos, &ra, &dec, &dist);
+}
+
+void SatelliteEngine::getPositions (const double *JD, size_t n, double *ra, double *dec, double *dist)
+{
+	for (size_t i = 0; i < n; i++)
+		getPosition (JD[i], ra[i], dec[i], dist[i]);
+}
+
+void SatelliteEngine::getAltAz (double JD, double &alt, double &az)
+{
+	double sat_pos[3], observer_loc[3];
+	propagate (JD, sat_pos);
+	observerLocation (JD, observer_loc);
+
+	// local sidereal time is observer geocentric longitude
+	double lst = atan2 (observer_loc[1], observer_loc[0]);
+	double sinLst = sin (lst);
+	double cosLst = cos (lst);
+
+	double v[3];
+	for (int i = 0; i < 3; i++)
+		v[i] = sat_pos[i] - observer_loc[i];
+
+	// project to local zenith, east and north vectors
+	double up = cosLat * cosLst * v[0] + cosLat * sinLst * v[1] + sinLat * v[2];
+	double east = -sinLst * v[0] + cosLst * v[1];
+	double north = -sinLat * cosLst * v[0] - sinLat * sinLst * v[1] + cosLat * v[2];
+
+	alt = atan2 (up, sqrt (east * east + north * north)) * 180.0 / M_PI;
+	// libnova azimuth, measured from south
+	az = atan2 (-east, -north) * 180.0 / M_PI;
+	if (az < 0)
+		az += 360.0;
+}
+
+void SatelliteEngine::getAltAzs (const double *JD, size_t n, double *alt, double *az)
+{
+	for (size_t i = 0; i < n; i++)
+		getAltAz (JD[i], alt[i], az[i]);
+}
+
+double SatelliteEngine::heightAbove (double JD, double minAlt, ObjectCheck *horizon, double *az)
+{
+	double alt, a;
+	getAltAz (JD, alt, a);
+	if (az)
+		*az = a;
+	double limit = minAlt;
+	if (horizon && !horizon->getIgnore ())
+	{
+		double h = horizon->getHorizonHeightAz (a);
+		if (h > limit)
+			limit = h;
+	}
+	return alt - limit;
+}
+
+double SatelliteEngine::findCrossing (double JD1, double JD2, double minAlt, ObjectCheck *horizon)
+{
+	bool above1 = heightAbove (JD1, minAlt, horizon) > 0;
+	while (JD2 - JD1 > CROSSING_PRECISION)
+	{
+		double mid = (JD1 + JD2) / 2.0;
+		if ((heightAbove (mid, minAlt, horizon) > 0) == above1)
+			JD1 = mid;
+		else
+			JD2 = mid;
+	}
+	return (JD1 + JD2) / 2.0;
+}
+
+size_t SatelliteEngine::getPasses (double from, double to, double minAlt, ObjectCheck *horizon, std::vector <SatellitePass> &passes, double step)
+{
+	passes.clear ();
+	if (!isValid () || !(to > from))
+		return 0;
+
+	const double stepd = step / 86400.0;
+	const double gr = (sqrt (5.0) - 1) / 2.0;
+
+	SatellitePass pass;
+	double az;
+	double t = from;
+	bool up = heightAbove (t, minAlt, horizon, &az) > 0;
+	double maxT = t;
+	double maxAlt = -90;
+
+	if (up)
+	{
+		pass.rise = NAN;
+		pass.riseAz = NAN;
+	}
+
+	while (true)
+	{
+		if (up)
+		{
+			double alt, a;
+			getAltAz (t, alt, a);
+			if (alt > maxAlt)
+			{
+				maxAlt = alt;
+				maxT = t;
+			}
+		}
+		if (t >= to)
+			break;
+
+		double t2 = t + stepd;
+		if (t2 > to)
+			t2 = to;
+		bool up2 = heightAbove (t2, minAlt, horizon) > 0;
+		if (up2 != up)
+		{
+			double c = findCrossing (t, t2, minAlt, horizon);
+			double alt;
+			if (up2)
+			{
+				pass.rise = c;
+				getAltAz (c, alt, pass.riseAz);
+				maxAlt = alt;
+				maxT = c;
+			}
+			else
+			{
+				pass.set = c;
+				getAltAz (c, alt, pass.setAz);
+				if (alt > maxAlt)
+				{
+					maxAlt = alt;
+					maxT = c;
+				}
+			}
+		}
+		else if (!up && !up2)
+		{
+			t = t2;
+			continue;
+		}
+
+		if (up && !up2)
+		{
+			// refine culmination around maximal sample
+			double lo = maxT - stepd;
+			double hi = maxT + stepd;
+			if (!std::isnan (pass.rise) && lo < pass.rise)
+				lo = pass.rise;
+			if (lo < from)
+				lo = from;
+			if (hi > pass.set)
+				hi = pass.set;
+			double x1 = hi - gr * (hi - lo);
+			double x2 = lo + gr * (hi - lo);
+			double a1, a2, a;
+			getAltAz (x1, a1, a);
+			getAltAz (x2, a2, a);
+			while (hi - lo > CROSSING_PRECISION)
+			{
+				if (a1 < a2)
+				{
+					lo = x1;
+					x1 = x2;
+					a1 = a2;
+					x2 = lo + gr * (hi - lo);
+					getAltAz (x2, a2, a);
+				}
+				else
+				{
+					hi = x2;
+					x2 = x1;
+					a2 = a1;
+					x1 = hi - gr * (hi - lo);
+					getAltAz (x1, a1, a);
+				}
+			}
+			double alt;
+			pass.culmination = (lo + hi) / 2.0;
+			getAltAz (pass.culmination, alt, a);
+			if (alt > maxAlt)
+			{
+				maxAlt = alt;
+			}
+			else
+			{
+				pass.culmination = maxT;
+			}
+			pass.maxAlt = maxAlt;
+			passes.push_back (pass);
+			maxAlt = -90;
+		}
+		up = up2;
+		t = t2;
+	}
+
+	if (up)
+	{
+		// pass in progress at search end
+		pass.set = NAN;
+		pass.setAz = NAN;
+		pass.culmination = maxT;
+		pass.maxAlt = maxAlt;
+		passes.push_back (pass);
+	}
+
+	return passes.size ();
+}
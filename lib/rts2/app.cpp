@@ -41,6 +41,7 @@ static App *masterApp = NULL;
 #define OPT_VERSION      999
 #define OPT_DEBUG        998
 #define OPT_UTTIME       997
+#define OPT_LOGLEVELS    996
 
 App *getMasterApp ()
 {
@@ -70,6 +71,7 @@ App::App (int argc, char **argv):Object ()
 	addOption (OPT_VERSION, "version", 0, "show program version and license");
 	addOption (OPT_DEBUG, "debug", 0, "print debug messages");
 	addOption (OPT_UTTIME, "UT", 0, "use UT (not local) time for time displays");
+	addOption (OPT_LOGLEVELS, "log-levels", 1, "log only messages of given levels (e - error, w - warning, i - info, d - debug, c - critical)");
 
 	if (masterApp == NULL)
 		masterApp = this;
@@ -232,6 +234,17 @@ int App::processOption (int in_opt)
 		case OPT_UTTIME:
 			useLocalTime = false;
 			break;
+		case OPT_LOGLEVELS:
+			{
+				int l = parseLogLevels (optarg);
+				if (l < 0)
+				{
+					std::cerr << "invalid log levels " << optarg << std::endl;
+					return -1;
+				}
+				setLogLevels (l);
+			}
+			break;
 		case OPT_VERSION:
 			std::cout << "Part of RTS2 version " << RTS2_VERSION << std::endl
 				<< std::endl
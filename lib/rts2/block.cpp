@@ -61,6 +61,8 @@ Block::Block (int in_argc, char **in_argv):App (in_argc, in_argv)
 	fds = new struct pollfd[pollsize];
 	npolls = 0;
 
+	threadLogFd = initThreadLogs ();
+
 	signal (SIGPIPE, SIG_IGN);
 
 	masterState = SERVERD_HARD_OFF;
@@ -108,6 +110,8 @@ void Block::addPollSocks ()
 {
 	connections_t::iterator iter;
 	npolls = 0;
+	if (threadLogFd >= 0)
+		addPollFD (threadLogFd, POLLIN);
 	for (iter = connections.begin (); iter != connections.end (); iter++)
 		(*iter)->add (this);
 	for (iter = centraldConns.begin (); iter != centraldConns.end (); iter++)
@@ -409,6 +413,7 @@ void Block::oneRunLoop ()
 	addPollSocks ();
 	if (ppoll (fds, npolls, &read_tout, NULL) > 0)
 		pollSuccess ();
+	sendThreadLogs ();
 	ret = idle ();
 	if (ret == -1)
 		endRunLoop ();
@@ -17,6 +17,7 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
  */
 
+#include <assert.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -51,9 +52,13 @@
 #define OPT_COMMENTS          OPT_LOCAL + 421
 #define OPT_HISTORIES         OPT_LOCAL + 422
 #define OPT_RTS2_COOLING      OPT_LOCAL + 423
+#define OPT_FRAMERING         OPT_LOCAL + 424
 
 #define EVENT_TEMP_CHECK      RTS2_LOCAL_EVENT + 676
 
+// maximal number of bytes of pending frame send in a single idle call
+#define PIPELINE_CHUNK        (4 * 1024 * 1024)
+
 using namespace rts2camd;
 
 FilterVal::FilterVal (Camera *master, const char *n, char fil)
@@ -165,6 +170,8 @@ long Camera::isExposing ()
 
 int Camera::endExposure (int ret)
 {
+	lastExposureEnd = getNow ();
+	frameTrace.mark (rts2core::TRACE_EXPOSURE_END);
 	if (modeCount)
 		memset (modeCount, 0, modeCountSize * sizeof (uint32_t));
 	if (exposureConn)
@@ -212,6 +219,10 @@ int Camera::deleteConnection (rts2core::Connection * conn)
 	{
 		exposureConn = NULL;
 	}
+	if (conn == pendingConn)
+	{
+		pendingConn = NULL;
+	}
 	// delete connection in shared data
 	if (sharedData)
 	{
@@ -242,7 +253,19 @@ int Camera::endReadout ()
 	logStream (MESSAGE_INFO) << "readout " <<  readoutPixels << " pixels in " << TimeDiff (tr)
 		<< " (" << std::setiosflags (std::ios_base::fixed) << pixelsSecond->getValueDouble () << " pixels per second, transfered with " << transferSecond << " pixels per second)" << sendLog;
 
+	readoutTrace.mark (rts2core::TRACE_READOUT_END);
+
 	clearReadout ();
+	publishRingFrame ();
+	if (pipelineActive)
+	{
+		handoffFrame ();
+	}
+	else
+	{
+		readoutTrace.mark (rts2core::TRACE_TRANSFER_END);
+		finishTrace (readoutTrace);
+	}
 	if (currentImageTransfer == SHARED && exposureConn)
 	{
 		if (currentImageData >= 0)
@@ -263,6 +286,476 @@ void Camera::clearReadout ()
 {
 }
 
+void Camera::publishRingFrame ()
+{
+	if (ringFrame == NULL)
+		return;
+	frameRing->publishFrame (frameRing->getChannelStride () * getNumChannels ());
+	ringFrame = NULL;
+
+	ringFrames->setValueLong (frameRing->getWriteSeq ());
+	ringDropped->setValueLong (frameRing->getDropped ());
+	sendValueAll (ringFrames);
+	sendValueAll (ringDropped);
+	sendValueAll (ringFull);
+}
+
+void Camera::createVideoMode ()
+{
+	createValue (videoMode, "video", "stream frames from the sensor", false, RTS2_VALUE_WRITABLE, CAM_WORKING);
+	videoMode->setValueBool (false);
+	createValue (videoBurst, "video_burst", "number of frames taken in burst, 0 for continuous video", false, RTS2_VALUE_WRITABLE);
+	videoBurst->setValueLong (0);
+	createValue (videoPoolSize, "video_pool", "number of preallocated frame buffers", false, RTS2_VALUE_WRITABLE, CAM_WORKING);
+	videoPoolSize->setValueInteger (16);
+	createValue (videoUpdate, "video_update", "[s] interval between updates of video values", false, RTS2_VALUE_WRITABLE | RTS2_DT_TIMEINTERVAL);
+	videoUpdate->setValueDouble (1);
+	createValue (videoStatEvery, "video_stat_every", "calculate statistics for every n-th frame, 0 to disable", false, RTS2_VALUE_WRITABLE);
+	videoStatEvery->setValueInteger (10);
+	createValue (videoFps, "video_fps", "[frames/s] achieved frame rate", false);
+	createValue (videoAcquired, "video_frames", "number of frames read from the sensor", false);
+	videoAcquired->setValueLong (0);
+	createValue (videoDropped, "video_dropped", "number of frames dropped, as frame pool was full", false);
+	videoDropped->setValueLong (0);
+}
+
+int Camera::startVideoMode ()
+{
+	if (videoMode == NULL)
+		return -1;
+	if (isVideoRunning ())
+		return 0;
+	if (getStateChip (0) & (CAM_EXPOSING | CAM_EXPOSING_NOIM | CAM_READING))
+	{
+		logStream (MESSAGE_ERROR) << "cannot start video mode while camera is exposing or reading" << sendLog;
+		return -1;
+	}
+	// frames are published only to the frame ring
+	if (frameRing == NULL)
+	{
+		logStream (MESSAGE_ERROR) << "video mode needs frame ring, start camera with --frame-ring" << sendLog;
+		return -1;
+	}
+
+	videoFrameSize = chipByteSize ();
+	videoPoolAllocated = videoPoolSize->getValueInteger ();
+	if (videoPoolAllocated < 2)
+		videoPoolAllocated = 2;
+
+	if (startVideo ())
+	{
+		logStream (MESSAGE_ERROR) << "cannot start video mode" << sendLog;
+		return -1;
+	}
+
+	videoPool = new char*[videoPoolAllocated];
+	while (!videoReady.empty ())
+		videoReady.pop ();
+	while (!videoFree.empty ())
+		videoFree.pop ();
+	for (int i = 0; i < videoPoolAllocated; i++)
+	{
+		videoPool[i] = new char[videoFrameSize];
+		videoFree.push (i);
+	}
+
+	videoStop = false;
+	videoError = false;
+	videoAcquiredCount = 0;
+	videoDroppedCount = 0;
+	videoStoredCount = 0;
+	videoBurstFrames = videoBurst->getValueLong ();
+	videoProcessed = 0;
+	videoStart = videoLastUpdate = getNow ();
+	videoLastAcquired = 0;
+
+	videoThreadRunning = true;
+	if (pthread_create (&videoThread, NULL, videoAcquisition, this))
+	{
+		logStream (MESSAGE_ERROR) << "cannot create video acquisition thread: " << strerror (errno) << sendLog;
+		videoThreadRunning = false;
+		// thread was not created, so it cannot be joined in stopVideoMode
+		stopVideo ();
+		freeVideoPool ();
+		return -1;
+	}
+
+	videoMode->setValueBool (true);
+	sendValueAll (videoMode);
+
+	logStream (MESSAGE_INFO) << "started " << (videoBurstFrames > 0 ? "burst" : "video") << " mode with " << videoPoolAllocated << " buffers of " << videoFrameSize << " bytes" << sendLog;
+
+	setTimeout (USEC_SEC / 1000);
+	return 0;
+}
+
+void Camera::stopVideoMode ()
+{
+	if (videoPool == NULL)
+		return;
+
+	__atomic_store_n (&videoStop, true, __ATOMIC_RELEASE);
+	pthread_join (videoThread, NULL);
+
+	// publish frames which were already acquired
+	processVideoFrames ();
+	if (videoPool == NULL)
+		return;
+
+	stopVideo ();
+	freeVideoPool ();
+
+	sendVideoValues ();
+
+	videoMode->setValueBool (false);
+	sendValueAll (videoMode);
+
+	logStream (MESSAGE_INFO) << "video mode finished, " << videoAcquired->getValueLong () << " frames, " << videoDropped->getValueLong () << " dropped, " << videoProcessed / (getNow () - videoStart) << " frames/s" << sendLog;
+}
+
+void Camera::freeVideoPool ()
+{
+	for (int i = 0; i < videoPoolAllocated; i++)
+		delete[] videoPool[i];
+	delete[] videoPool;
+	videoPool = NULL;
+}
+
+void Camera::processVideoFrames ()
+{
+	int statEvery = videoStatEvery->getValueInteger ();
+
+	while (!videoReady.empty ())
+	{
+		int idx = videoReady.pop ();
+		char *frame = videoPool[idx];
+		videoProcessed++;
+
+		if (statEvery > 0 && (videoProcessed % statEvery) == 0)
+		{
+			sum->setValueDouble (0);
+			max->setValueDouble (-LONG_MAX);
+			min->setValueDouble (LONG_MAX);
+			if (modeCount)
+				memset (modeCount, 0, modeCountSize * sizeof (uint32_t));
+			computedPix->setValueLong (computeStatistics (frame, videoFrameSize));
+			average->setValueDouble (sum->getValueDouble () / computedPix->getValueLong ());
+		}
+
+		char *slot = frameRing->beginFrame ();
+		if (slot)
+		{
+			char *chan = frameRing->getChannel (slot, 0);
+			fillImageHeader ((struct imghdr *) chan, getPhysicalChannel (1));
+			size_t s = videoFrameSize;
+			if (s > frameRing->getChannelStride () - sizeof (struct imghdr))
+				s = frameRing->getChannelStride () - sizeof (struct imghdr);
+			memcpy (chan + sizeof (struct imghdr), frame, s);
+			frameRing->publishFrame (frameRing->getChannelStride ());
+		}
+		else
+		{
+			ringFull->inc ();
+		}
+
+		videoFree.push (idx);
+	}
+
+	double now = getNow ();
+	bool finished = !__atomic_load_n (&videoThreadRunning, __ATOMIC_ACQUIRE);
+
+	if (now - videoLastUpdate >= videoUpdate->getValueDouble ())
+		sendVideoValues ();
+
+	if (finished && !__atomic_load_n (&videoStop, __ATOMIC_ACQUIRE))
+	{
+		// thread finished on its own - burst completed or error
+		if (__atomic_load_n (&videoError, __ATOMIC_ACQUIRE))
+			logStream (MESSAGE_ERROR) << "error reading video frame, stopping video mode" << sendLog;
+		stopVideoMode ();
+		return;
+	}
+
+	setTimeout (USEC_SEC / 1000);
+}
+
+void Camera::sendVideoValues ()
+{
+	double now = getNow ();
+	long acquired = __atomic_load_n (&videoAcquiredCount, __ATOMIC_ACQUIRE);
+
+	if (now > videoLastUpdate)
+		videoFps->setValueDouble ((acquired - videoLastAcquired) / (now - videoLastUpdate));
+	videoAcquired->setValueLong (acquired);
+	videoDropped->setValueLong (__atomic_load_n (&videoDroppedCount, __ATOMIC_ACQUIRE));
+
+	videoLastUpdate = now;
+	videoLastAcquired = acquired;
+
+	sendValueAll (videoFps);
+	sendValueAll (videoAcquired);
+	sendValueAll (videoDropped);
+
+	if (videoStatEvery->getValueInteger () > 0)
+	{
+		sendValueAll (average);
+		sendValueAll (max);
+		sendValueAll (min);
+		sendValueAll (sum);
+		sendValueAll (computedPix);
+	}
+
+	if (frameRing)
+	{
+		ringFrames->setValueLong (frameRing->getWriteSeq ());
+		ringDropped->setValueLong (frameRing->getDropped ());
+		sendValueAll (ringFrames);
+		sendValueAll (ringDropped);
+		sendValueAll (ringFull);
+	}
+}
+
+void *Camera::videoAcquisition (void *arg)
+{
+	Camera *cam = (Camera *) arg;
+	// frames are read to this buffer when the pool is full
+	char *dropBuffer = NULL;
+
+	while (!__atomic_load_n (&(cam->videoStop), __ATOMIC_ACQUIRE))
+	{
+		if (cam->videoBurstFrames > 0 && __atomic_load_n (&(cam->videoStoredCount), __ATOMIC_ACQUIRE) >= cam->videoBurstFrames)
+			break;
+
+		int idx = -1;
+		char *buf;
+		if (!cam->videoFree.empty ())
+		{
+			idx = cam->videoFree.pop ();
+			buf = cam->videoPool[idx];
+		}
+		else
+		{
+			if (dropBuffer == NULL)
+				dropBuffer = new char[cam->videoFrameSize];
+			buf = dropBuffer;
+		}
+
+		int ret = cam->readVideoFrame (buf, cam->videoFrameSize);
+		if (ret < 0)
+		{
+			__atomic_store_n (&(cam->videoError), true, __ATOMIC_RELEASE);
+			if (idx >= 0)
+				cam->videoFree.push (idx);
+			break;
+		}
+		if (ret == 1)
+		{
+			if (idx >= 0)
+				cam->videoFree.push (idx);
+			continue;
+		}
+
+		__atomic_fetch_add (&(cam->videoAcquiredCount), 1, __ATOMIC_RELEASE);
+		if (idx < 0)
+		{
+			__atomic_fetch_add (&(cam->videoDroppedCount), 1, __ATOMIC_RELEASE);
+			continue;
+		}
+
+		__atomic_fetch_add (&(cam->videoStoredCount), 1, __ATOMIC_RELEASE);
+		cam->videoReady.push (idx);
+	}
+
+	delete[] dropBuffer;
+	__atomic_store_n (&(cam->videoThreadRunning), false, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+long Camera::getPipelineRemaining (int chan)
+{
+	size_t chsize = chipByteSize ();
+	if (chan >= 0)
+		return chsize > dataWritten[chan] ? chsize - dataWritten[chan] : 0;
+	long ret = 0;
+	for (int i = 0; i < (dataChannels ? dataChannels->getValueInteger () : 1); i++)
+		ret += chsize > dataWritten[i] ? chsize - dataWritten[i] : 0;
+	return ret;
+}
+
+void Camera::handoffFrame ()
+{
+	// previous frame must be send before its buffers are reused
+	flushPendingData ();
+
+	char **tb = pendingBuffers;
+	pendingBuffers = dataBuffers;
+	dataBuffers = tb;
+
+	struct imghdr *th = pendingHeaders;
+	pendingHeaders = frameHeaders;
+	frameHeaders = th;
+
+	memcpy (pendingWritten, dataWritten, getNumChannels () * sizeof (size_t));
+	memset (dataWritten, 0, getNumChannels () * sizeof (size_t));
+
+	pendingImageData = currentImageData;
+	pendingConn = exposureConn;
+	pendingChannels = dataChannels ? dataChannels->getValueInteger () : 1;
+	pendingChan = 0;
+	pendingSent = 0;
+	pendingStart = getNow ();
+	pendingTrace = readoutTrace;
+
+	currentImageData = -1;
+	pipelineActive = false;
+}
+
+int Camera::sendPendingData (size_t maxBytes)
+{
+	if (pendingConn == NULL)
+		return 1;
+
+	bool stats = calculateStatistics->getValueInteger () != STATISTIC_NO;
+	size_t sent = 0;
+
+	while (pendingChan < pendingChannels)
+	{
+		if (pendingSent == 0)
+		{
+			if (pendingChan == 0)
+			{
+				sum->setValueDouble (0);
+				average->setValueDouble (0);
+				max->setValueDouble (-LONG_MAX);
+				min->setValueDouble (LONG_MAX);
+				computedPix->setValueLong (0);
+			}
+			if (pendingConn->sendBinaryData (pendingImageData, pendingChan, (char *) (pendingHeaders + pendingChan), sizeof (imghdr)))
+			{
+				dropPendingData ();
+				return -1;
+			}
+		}
+
+		size_t rest = pendingWritten[pendingChan] - pendingSent;
+		if (rest > maxBytes - sent)
+			rest = maxBytes - sent;
+		if (rest > 0)
+		{
+			char *d = pendingBuffers[pendingChan] + pendingSent;
+			if (stats)
+				computedPix->setValueLong (computedPix->getValueLong () + computeStatistics (d, rest));
+			if (pendingConn->sendBinaryData (pendingImageData, pendingChan, d, rest))
+			{
+				dropPendingData ();
+				return -1;
+			}
+			pendingSent += rest;
+			sent += rest;
+		}
+
+		if (pendingSent < pendingWritten[pendingChan])
+			return 0;
+
+		pendingChan++;
+		pendingSent = 0;
+
+		if (sent >= maxBytes && pendingChan < pendingChannels)
+			return 0;
+	}
+
+	if (stats)
+	{
+		average->setValueDouble (sum->getValueDouble () / computedPix->getValueLong ());
+		sendValueAll (average);
+		sendValueAll (max);
+		sendValueAll (min);
+		sendValueAll (sum);
+	}
+	sendValueAll (computedPix);
+
+	transferTime->setValueDouble (getNow () - pendingStart);
+	sendValueAll (transferTime);
+
+	pendingTrace.mark (rts2core::TRACE_TRANSFER_END);
+	finishTrace (pendingTrace);
+
+	pendingConn = NULL;
+	pendingImageData = -1;
+	return 1;
+}
+
+void Camera::flushPendingData ()
+{
+	while (pendingConn && sendPendingData ((size_t) -1) == 0)
+	{
+	}
+}
+
+void Camera::dropPendingData ()
+{
+	if (pendingConn && pendingImageData >= 0)
+		pendingConn->endBinaryData (pendingImageData);
+	pendingConn = NULL;
+	pendingImageData = -1;
+}
+
+void Camera::updateFrameTiming (double now)
+{
+	if (!std::isnan (lastExposureStart))
+	{
+		double cycle = now - lastExposureStart;
+		frameCycle->setValueDouble (cycle);
+		if (cycle > 0)
+			dutyCycle->setValueDouble (100 * exposure->getValueDouble () / cycle);
+		if (!std::isnan (lastExposureEnd))
+		{
+			deadTime->setValueDouble (now - lastExposureEnd);
+			deadTimeHistogram.add (deadTime->getValueDouble ());
+			nightDeadTime->addValue (deadTime->getValueDouble ());
+			nightDeadTime->calculate ();
+			sendValueAll (nightDeadTime);
+		}
+
+		sendValueAll (frameCycle);
+		sendValueAll (deadTime);
+		sendValueAll (dutyCycle);
+
+		LOG_IF (MESSAGE_DEBUG) << "frame cycle " << TimeDiff (cycle) << ", dead time " << TimeDiff (deadTime->getValueDouble ()) << ", duty cycle " << dutyCycle->getValueDouble () << "%" << sendLog;
+	}
+	lastExposureStart = now;
+}
+
+void Camera::finishTrace (rts2core::ExposureTrace &trace)
+{
+	readoutLatency->setValueDouble (trace.interval (rts2core::TRACE_EXPOSURE_END, rts2core::TRACE_READOUT_END));
+	transferLatency->setValueDouble (trace.interval (rts2core::TRACE_READOUT_END, rts2core::TRACE_TRANSFER_END));
+	sendValueAll (readoutLatency);
+	sendValueAll (transferLatency);
+
+	readoutHistogram.add (readoutLatency->getValueDouble ());
+	transferHistogram.add (transferLatency->getValueDouble ());
+
+	LOG_IF (MESSAGE_DEBUG) << "exposure trace: " << trace << sendLog;
+}
+
+void Camera::logNightTrace ()
+{
+	if (deadTimeHistogram.getCount () == 0 && readoutHistogram.getCount () == 0)
+		return;
+
+	logStream (MESSAGE_INFO) << "night dead time: " << deadTimeHistogram << sendLog;
+	logStream (MESSAGE_INFO) << "night readout latency: " << readoutHistogram << sendLog;
+	logStream (MESSAGE_INFO) << "night transfer latency: " << transferHistogram << sendLog;
+
+	deadTimeHistogram.clear ();
+	readoutHistogram.clear ();
+	transferHistogram.clear ();
+
+	nightDeadTime->clearStat ();
+	sendValueAll (nightDeadTime);
+}
+
 int Camera::getPhysicalChannel (int ch)
 {
 	if (channels == NULL)
@@ -336,22 +829,17 @@ int Camera::sendFirstLine (int chan, int pchan)
 		focusingHeader = fhd;
 	}
 
-	focusingHeader->data_type = htons (getDataType ());
-	focusingHeader->naxes = 2;
-	focusingHeader->sizes[0] = htonl (chipUsedReadout->getWidthInt () / binningHorizontal ());
-	focusingHeader->sizes[1] = htonl (chipUsedReadout->getHeightInt () / binningVertical ());
-	focusingHeader->binnings[0] = htons (binningVertical ());
-	focusingHeader->binnings[1] = htons (binningHorizontal ());
-	focusingHeader->x = htons (chipUsedReadout->getXInt ());
-	focusingHeader->y = htons (chipUsedReadout->getYInt ());
-	focusingHeader->filter = htons (getLastFilterNum ());
-	// light - dark images
-	if (expType)
-		focusingHeader->shutter = htons (expType->getValueInteger ());
-	else
-		focusingHeader->shutter = 0;
+	fillImageHeader (focusingHeader, pchan);
 
-	focusingHeader->channel = htons (pchan);
+	if (ringFrame)
+		memcpy (frameRing->getChannel (ringFrame, chan), focusingHeader, sizeof (imghdr));
+
+	if (pipelineActive)
+	{
+		// header and statistics are send with the pending frame
+		frameHeaders[chan] = *focusingHeader;
+		return 0;
+	}
 
 	sum->setValueDouble (0);
 	average->setValueDouble (0);
@@ -374,6 +862,26 @@ int Camera::sendFirstLine (int chan, int pchan)
 	return 0;
 }
 
+void Camera::fillImageHeader (struct imghdr *hdr, int pchan)
+{
+	hdr->data_type = htons (getDataType ());
+	hdr->naxes = 2;
+	hdr->sizes[0] = htonl (chipUsedReadout->getWidthInt () / binningHorizontal ());
+	hdr->sizes[1] = htonl (chipUsedReadout->getHeightInt () / binningVertical ());
+	hdr->binnings[0] = htons (binningVertical ());
+	hdr->binnings[1] = htons (binningHorizontal ());
+	hdr->x = htons (chipUsedReadout->getXInt ());
+	hdr->y = htons (chipUsedReadout->getYInt ());
+	hdr->filter = htons (getLastFilterNum ());
+	// light - dark images
+	if (expType)
+		hdr->shutter = htons (expType->getValueInteger ());
+	else
+		hdr->shutter = 0;
+
+	hdr->channel = htons (pchan);
+}
+
 bool Camera::supportFrameTransfer ()
 {
 	return false;
@@ -435,6 +943,45 @@ Camera::Camera (int in_argc, char **in_argv, rounding_t binning_rounding):rts2co
 	sharedData = NULL;
 	sharedMemNum = -1;
 
+	frameRing = NULL;
+	frameRingSlots = 0;
+
+	videoMode = NULL;
+	videoBurst = NULL;
+	videoPoolSize = NULL;
+	videoUpdate = NULL;
+	videoStatEvery = NULL;
+	videoFps = NULL;
+	videoAcquired = NULL;
+	videoDropped = NULL;
+
+	videoPool = NULL;
+	videoPoolAllocated = 0;
+	videoFrameSize = 0;
+	videoStop = false;
+	videoThreadRunning = false;
+	videoError = false;
+
+	lastExposureStart = NAN;
+	lastExposureEnd = NAN;
+
+	pipelineActive = false;
+	frameHeaders = NULL;
+	pendingBuffers = NULL;
+	pendingWritten = NULL;
+	pendingHeaders = NULL;
+	pendingImageData = -1;
+	pendingConn = NULL;
+	pendingChannels = 0;
+	pendingChan = 0;
+	pendingSent = 0;
+	pendingStart = NAN;
+	ringFrame = NULL;
+	frameRingName = NULL;
+	ringFrames = NULL;
+	ringDropped = NULL;
+	ringFull = NULL;
+
 	currentImageData = -1;
 	currentImageTransfer = TCPIP;
 
@@ -550,6 +1097,19 @@ Camera::Camera (int in_argc, char **in_argv, rounding_t binning_rounding):rts2co
 	createValue (readoutTime, "readout_time", "[s] data readout time", false, RTS2_DT_TIMEINTERVAL);
 	createValue (transferTime, "transfer_time", "[s] data transfer time, including overhead", false, RTS2_DT_TIMEINTERVAL);
 
+	createValue (pipeline, "pipeline", "transfer image data while the next exposure is running", false, RTS2_VALUE_WRITABLE, CAM_WORKING);
+	pipeline->setValueBool (false);
+
+	createValue (frameCycle, "frame_cycle", "[s] time between starts of the last two exposures", false, RTS2_DT_TIMEINTERVAL);
+	createValue (deadTime, "dead_time", "[s] time between end of the previous exposure and start of the last exposure", false, RTS2_DT_TIMEINTERVAL);
+	createValue (dutyCycle, "duty_cycle", "[%] exposure time to frame cycle ratio", false, RTS2_DT_PERCENTS);
+
+	createValue (traceExposureEnd, "trace_exposure_end", "time when the last exposure ended", false);
+	createValue (traceReadoutStart, "trace_readout_start", "time when readout of the last exposure started", false);
+	createValue (readoutLatency, "readout_latency", "[s] time from end of the exposure to end of its readout", false, RTS2_DT_TIMEINTERVAL);
+	createValue (transferLatency, "transfer_latency", "[s] time from end of the readout to end of the data transfer", false, RTS2_DT_TIMEINTERVAL);
+	createValue (nightDeadTime, "night_dead_time", "[s] dead time statistics since the night start", false, RTS2_DT_TIMEINTERVAL);
+
 	createValue (camFocVal, "focpos", "position of focuser", false, RTS2_VALUE_WRITABLE, CAM_EXPOSING);
 
 	camFilterVal = NULL;
@@ -578,6 +1138,7 @@ Camera::Camera (int in_argc, char **in_argv, rounding_t binning_rounding):rts2co
 	addOption (OPT_WCS_CDELT, "wcs", 1, "WCS CD matrix (CRPIX1:CRPIX2:CDELT1:CDELT2:CROTA in default, unbinned configuration)");
 	addOption (OPT_WCS_MULTI, "wcs-multi", 1, "letter for multiple WCS (A-Z)");
 	addOption (OPT_WITHSHM, "with-shm", 2, "use given numbers of segments of shared memory");
+	addOption (OPT_FRAMERING, "frame-ring", 1, "publish frames to POSIX shared memory ring with given number of slots");
 
 	// detector sizes, channel starting points and offsets
 	addOption (OPT_DETSIZE, "detsize", 1, "detector size - X:Y:W:H");
@@ -589,12 +1150,31 @@ Camera::Camera (int in_argc, char **in_argv, rounding_t binning_rounding):rts2co
 
 Camera::~Camera ()
 {
+	// acquisition thread calls driver methods, it must be stopped before driver is destroyed
+	assert (!isVideoRunning ());
+
 	delete sharedData;
+	delete frameRing;
 	delete fhd;
 
+	if (dataBuffers)
+	{
+		for (int i = 0; i < getNumChannels (); i++)
+			delete[] dataBuffers[i];
+	}
 	delete[] dataBuffers;
 	delete[] dataWritten;
 
+	if (pendingBuffers)
+	{
+		for (int i = 0; i < getNumChannels (); i++)
+			delete[] pendingBuffers[i];
+	}
+	delete[] pendingBuffers;
+	delete[] pendingWritten;
+	delete[] pendingHeaders;
+	delete[] frameHeaders;
+
 	delete[] modeCount;
 }
 
@@ -673,6 +1253,13 @@ void Camera::checkQueuedExposures ()
 	infoAll ();
 }
 
+int Camera::run ()
+{
+	int ret = rts2core::ScriptDevice::run ();
+	stopVideoMode ();
+	return ret;
+}
+
 int Camera::killAll (bool callScriptEnds)
 {
 	timeReadoutStart = NAN;
@@ -687,6 +1274,18 @@ int Camera::killAll (bool callScriptEnds)
 	}
 
 
+	if (frameRing)
+	{
+		frameRing->abortFrame ();
+		ringFrame = NULL;
+	}
+
+	if (isVideoRunning ())
+		stopVideoMode ();
+
+	pipelineActive = false;
+	dropPendingData ();
+
 	if (exposureConn && currentImageData >= 0)
 	{
 		// end actual data connections
@@ -891,6 +1490,14 @@ int Camera::processOption (int in_opt)
 			else
 				sharedMemNum = atoi (optarg);
 			break;
+		case OPT_FRAMERING:
+			frameRingSlots = atoi (optarg);
+			if (frameRingSlots <= 0)
+			{
+				std::cerr << "invalid number of frame ring slots: " << optarg << std::endl;
+				return -1;
+			}
+			break;
 
 		case OPT_DETSIZE:
 			{
@@ -955,6 +1562,7 @@ int Camera::sendImage (char *data, size_t dataSize)
 {
 	if (!exposureConn)
 		return -1;
+	pipelineActive = false;
 	if (calculateStatistics->getValueInteger () != STATISTIC_ONLY)
 	{
 		if (realTimeDataTransferCount != 0)
@@ -968,44 +1576,66 @@ int Camera::sendImage (char *data, size_t dataSize)
 	return sendReadoutData (data, dataSize);
 }
 
+int Camera::computeStatistics (char *data, size_t dataSize)
+{
+	int totPix = 0;
+	// update sum. min and max
+	switch (getDataType ())
+	{
+		case RTS2_DATA_BYTE:
+			totPix = updateStatistics ((uint8_t *) data, dataSize);
+			break;
+		case RTS2_DATA_SHORT:
+			totPix = updateStatistics ((int16_t *) data, dataSize);
+			break;
+		case RTS2_DATA_LONG:
+			totPix = updateStatistics ((int32_t *) data, dataSize);
+			break;
+		case RTS2_DATA_LONGLONG:
+			totPix = updateStatistics ((int64_t *) data, dataSize);
+			break;
+		case RTS2_DATA_FLOAT:
+			totPix = updateStatistics ((float *) data, dataSize);
+			break;
+		case RTS2_DATA_DOUBLE:
+			totPix = updateStatistics ((double *) data, dataSize);
+			break;
+		case RTS2_DATA_SBYTE:
+			totPix = updateStatistics ((int8_t *) data, dataSize);
+			break;
+		case RTS2_DATA_USHORT:
+			totPix = updateStatistics ((uint16_t *) data, dataSize);
+			break;
+		case RTS2_DATA_ULONG:
+			totPix = updateStatistics ((uint32_t *) data, dataSize);
+			break;
+	}
+	return totPix;
+}
+
 int Camera::sendReadoutData (char *data, size_t dataSize, int chan)
 {
-	std::cerr << "Camera::sendReadoutData " << dataSize << " chan " << chan << " exposureConn " << exposureConn << std::endl;
-	// calculated..
-	if (calculateStatistics->getValueInteger () != STATISTIC_NO)
+	if (pipelineActive)
 	{
-		int totPix;
-		// update sum. min and max
-		switch (getDataType ())
+		if (getDataBuffer (chan) == NULL)
 		{
-			case RTS2_DATA_BYTE:
-				totPix = updateStatistics ((uint8_t *) data, dataSize);
-				break;
-			case RTS2_DATA_SHORT:
-				totPix = updateStatistics ((int16_t *) data, dataSize);
-				break;
-			case RTS2_DATA_LONG:
-				totPix = updateStatistics ((int32_t *) data, dataSize);
-				break;
-			case RTS2_DATA_LONGLONG:
-				totPix = updateStatistics ((int64_t *) data, dataSize);
-				break;
-			case RTS2_DATA_FLOAT:
-				totPix = updateStatistics ((float *) data, dataSize);
-				break;
-			case RTS2_DATA_DOUBLE:
-				totPix = updateStatistics ((double *) data, dataSize);
-				break;
-			case RTS2_DATA_SBYTE:
-				totPix = updateStatistics ((int8_t *) data, dataSize);
-				break;
-			case RTS2_DATA_USHORT:
-				totPix = updateStatistics ((uint16_t *) data, dataSize);
-				break;
-			case RTS2_DATA_ULONG:
-				totPix = updateStatistics ((uint32_t *) data, dataSize);
-				break;
+			logStream (MESSAGE_ERROR) << "no buffer for pipelined data of channel " << chan << sendLog;
+			return -1;
+		}
+		// driver did not use buffer from getDataBuffer
+		if (data != getDataTop (chan))
+		{
+			size_t rest = getPipelineRemaining (chan);
+			memcpy (getDataTop (chan), data, dataSize < rest ? dataSize : rest);
 		}
+		dataWritten[chan] += dataSize;
+		return 0;
+	}
+
+	// calculated..
+	if (calculateStatistics->getValueInteger () != STATISTIC_NO)
+	{
+		int totPix = computeStatistics (data, dataSize);
 		computedPix->setValueLong (computedPix->getValueLong () + totPix);
 		average->setValueDouble (sum->getValueDouble () / computedPix->getValueLong ());
 
@@ -1079,6 +1709,13 @@ int Camera::sendReadoutData (char *data, size_t dataSize, int chan)
 	if (currentImageTransfer == SHARED)
 		sharedData->dataWritten (chan, dataSize);
 
+	// driver did not use buffer from getDataBuffer, copy data to the ring
+	if (ringFrame && data != getDataTop (chan))
+	{
+		size_t rest = frameRing->getChannelStride () - sizeof (imghdr) - dataWritten[chan];
+		memcpy (getDataTop (chan), data, dataSize < rest ? dataSize : rest);
+	}
+
 	dataWritten[chan] += dataSize;
 
 	if (exposureConn && currentImageTransfer == TCPIP)
@@ -1263,6 +1900,22 @@ int Camera::initValues ()
 		}
 		logStream (MESSAGE_DEBUG) << "creating shared memory with " << sharedMemNum << " segments" << sendLog;
 	}
+	if (frameRingSlots > 0)
+	{
+		frameRing = new rts2core::DataRingWrite ();
+		std::string rname = std::string ("/rts2-") + getDeviceName ();
+		if (frameRing->create (rname.c_str (), frameRingSlots, getWidth () * getHeight () * maxPixelByteSize () + sizeof (imghdr), getNumChannels ()))
+			return -1;
+		createValue (frameRingName, "frame_ring", "name of shared memory ring with frames", false);
+		frameRingName->setValueCharArr (rname.c_str ());
+		createValue (ringFrames, "ring_frames", "number of frames published to the ring", false);
+		ringFrames->setValueLong (0);
+		createValue (ringDropped, "ring_dropped", "number of frames skipped by slow ring readers", false);
+		ringDropped->setValueLong (0);
+		createValue (ringFull, "ring_full", "number of frames not published, as critical reader has not released slot", false);
+		ringFull->setValueLong (0);
+		logStream (MESSAGE_DEBUG) << "created frame ring " << rname << " with " << frameRingSlots << " slots" << sendLog;
+	}
 	fhd = new struct imghdr;
 	focusingHeader = NULL;
 
@@ -1277,6 +1930,15 @@ int Camera::initValues ()
 	dataWritten = new size_t[getNumChannels ()];
 	memset (dataWritten, 0, getNumChannels () * sizeof (size_t));
 
+	pendingBuffers = new char*[getNumChannels ()];
+	memset (pendingBuffers, 0, getNumChannels () * sizeof (char*));
+
+	pendingWritten = new size_t[getNumChannels ()];
+	memset (pendingWritten, 0, getNumChannels () * sizeof (size_t));
+
+	frameHeaders = new struct imghdr[getNumChannels ()];
+	pendingHeaders = new struct imghdr[getNumChannels ()];
+
 	return rts2core::ScriptDevice::initValues ();
 }
 
@@ -1447,6 +2109,23 @@ int Camera::setValue (rts2core::Value * old_value, rts2core::Value * new_value)
 		setExposure (new_value->getValueDouble ());
 		return 0;
 	}
+	if (old_value == pipeline)
+	{
+		// drivers without buffers from getDataBuffer read to their own buffers, which are reused
+		if (((rts2core::ValueBool *) new_value)->getValueBool () && suggestBufferSize () == 0)
+		{
+			logStream (MESSAGE_ERROR) << "camera driver does not support pipelined transfer" << sendLog;
+			return -2;
+		}
+		return 0;
+	}
+	if (old_value == videoMode)
+	{
+		if (((rts2core::ValueBool *) new_value)->getValueBool ())
+			return startVideoMode () == 0 ? 0 : -2;
+		stopVideoMode ();
+		return 0;
+	}
 	return rts2core::ScriptDevice::setValue (old_value, new_value);
 }
 
@@ -1528,6 +2207,10 @@ void Camera::postEvent (rts2core::Event * event)
 
 int Camera::idle ()
 {
+	if (isVideoRunning ())
+		processVideoFrames ();
+	if (pendingConn && sendPendingData (PIPELINE_CHUNK) == 0)
+		setTimeout (0);
 	checkExposures ();
 	checkReadouts ();
 	return rts2core::ScriptDevice::idle ();
@@ -1535,6 +2218,9 @@ int Camera::idle ()
 
 void Camera::changeMasterState (rts2_status_t old_state, rts2_status_t new_state)
 {
+	if ((new_state & SERVERD_STATUS_MASK) == SERVERD_DAY && (old_state & SERVERD_STATUS_MASK) != SERVERD_DAY)
+		logNightTrace ();
+
 	switch (new_state & SERVERD_STATUS_MASK)
 	{
 		case SERVERD_EVENING:
@@ -1570,56 +2256,86 @@ void Camera::findSepStars (uint16_t *data)
 	sepY->clear ();
 	sepFluxes->clear ();
 
-	sep_image im = {data, NULL, NULL, SEP_TUINT16, 0, 0, getUsedWidthBinned (), getUsedHeightBinned (), 0.0, SEP_NOISE_NONE, 1.0, 0.0};
-	sep_bkg *bkg = NULL;
-	int status = sep_background (&im, 64, 64, 3, 3, 0.0, &bkg);
-	if (status)
+	int w = getUsedWidthBinned ();
+	int h = getUsedHeightBinned ();
+
+	// background is subtracted from copy, image data are not modified
+	float *fdata = (float *) malloc (w * h * sizeof (float));
+	if (fdata == NULL)
 	{
-		logStream (MESSAGE_ERROR) << "SEP: unable to estimate background:" << status << sendLog;
+		logStream (MESSAGE_ERROR) << "SEP: cannot allocate image buffer" << sendLog;
 		return;
 	}
+	for (int i = 0; i < w * h; i++)
+		fdata[i] = data[i];
 
-	uint16_t *imback = (uint16_t *) malloc (getUsedWidthBinned () * getUsedHeightBinned () * sizeof (uint16_t));
-	status = sep_bkg_array (bkg, imback, SEP_TUINT16);
+	// SEP stages run on all CPUs, results are identical to single threaded SEP
+	sep_image im = {fdata, NULL, NULL, SEP_TFLOAT, 0, 0, w, h, 0.0, SEP_NOISE_NONE, 1.0, 0.0};
+	sep_bkg *bkg = NULL;
+	int status = sep_background_mt (&im, 64, 64, 3, 3, 0.0, 0, &bkg);
 	if (status)
 	{
-		logStream (MESSAGE_ERROR) << "SEP: cannot construct background array:" << status << sendLog;
+		logStream (MESSAGE_ERROR) << "SEP: unable to estimate background:" << status << sendLog;
+		free (fdata);
 		return;
 	}
 
-	status = sep_bkg_subarray (bkg, im.data, im.dtype);
+	status = sep_bkg_subarray_mt (bkg, im.data, im.dtype, 0);
 	if (status)
 	{
 		logStream (MESSAGE_ERROR) << "SEP: cannot subtract background:" << status << sendLog;
+		sep_bkg_free (bkg);
+		free (fdata);
 		return;
 	}
 
+	/* set image noise level */
+	im.noiseval = bkg->globalrms;
+	im.noise_type = SEP_NOISE_STDDEV;
+	sep_bkg_free (bkg);
+
 	float conv[] = {1,2,1, 2,4,2, 1,2,1};
 	sep_catalog *catalog = NULL;
 
-	im.noise = &(bkg->globalrms);  /* set image noise level */
-
-	status = sep_extract(&im, 1.5*bkg->globalrms, SEP_THRESH_REL, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, &catalog);
+	status = sep_extract_mt (&im, 1.5, SEP_THRESH_REL, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, 0, 0, &catalog);
 	if (status)
 	{
 		logStream (MESSAGE_ERROR) << "SEP: cannot extract sources:" << status << sendLog;
+		free (fdata);
 		return;
 	}
 
 	/* aperture photometry */
-	double *flux, *fluxerr, *fluxt, *fluxerrt, *area, *areat;
-	short *flag, *flagt;
+	double *flux = (double *) malloc (catalog->nobj * sizeof (double));
+	double *fluxerr = (double *) malloc (catalog->nobj * sizeof (double));
+	double *area = (double *) malloc (catalog->nobj * sizeof (double));
+	short *flag = (short *) malloc (catalog->nobj * sizeof (short));
 
-	im.noise = &(bkg->globalrms);  /* set image noise level */
-	im.ndtype = SEP_TUINT16;
-	fluxt = flux = (double *)malloc(catalog->nobj * sizeof(double));
-	fluxerrt = fluxerr = (double *)malloc(catalog->nobj * sizeof(double));
-	areat = area = (double *)malloc(catalog->nobj * sizeof(double));
-	flagt = flag = (short *)malloc(catalog->nobj * sizeof(short));
-	for (int i=0; i<catalog->nobj; i++, fluxt++, fluxerrt++, flagt++, areat++)
-		sep_sum_circle(&im, catalog->x[i], catalog->y[i], 5.0, 5, 0, fluxt, fluxerrt, areat, flagt);
+	status = sep_sum_circle_array (&im, catalog->x, catalog->y, catalog->nobj, 5.0, 5, 0, flux, fluxerr, area, flag, 0);
+	if (status)
+	{
+		logStream (MESSAGE_ERROR) << "SEP: aperture photometry failed:" << status << sendLog;
+	}
+	else
+	{
+		for (int i = 0; i < catalog->nobj; i++)
+		{
+			sepX->addValue (catalog->x[i]);
+			sepY->addValue (catalog->y[i]);
+			sepFluxes->addValue (flux[i]);
+		}
+	}
 
+	sendValueAll (sepX);
+	sendValueAll (sepY);
+	sendValueAll (sepFluxes);
 
+	free (flux);
+	free (fluxerr);
+	free (area);
+	free (flag);
+	sep_catalog_free (catalog);
+	free (fdata);
 }
 
 int Camera::camStartExposure (bool careBlock)
@@ -1711,6 +2427,11 @@ int Camera::camStartExposureWithoutCheck ()
 
 	double now = getNow ();
 
+	frameTrace.clear ();
+	frameTrace.mark (rts2core::TRACE_EXPOSURE_START);
+
+	updateFrameTiming (now);
+
         exposureEnd->setValueDouble (now + ( acquireTime ? acquireTime->getValueDouble () : exposure->getValueDouble () ));
 
 	infoAll ();
@@ -1744,6 +2465,13 @@ int Camera::camExpose (rts2core::Connection * conn, int chipState, bool fromQue,
 {
 	int ret;
 
+	if (isVideoRunning ())
+	{
+		if (conn)
+			conn->sendCommandEnd (DEVDEM_E_HW, "camera is streaming video, cannot start exposure");
+		return -1;
+	}
+
 	// if it is currently exposing
 	// or performing other op that can block command execution
 	// or there are queued values which needs to be dealed before we can start exposing
@@ -1818,6 +2546,14 @@ int Camera::readoutStart ()
 int Camera::camReadout (rts2core::Connection * conn)
 {
 	timeTransferStart = getNow ();
+
+	// stamps must reach the client before the image data
+	readoutTrace = frameTrace;
+	readoutTrace.mark (rts2core::TRACE_READOUT_START);
+	traceExposureEnd->setValueDouble (readoutTrace.get (rts2core::TRACE_EXPOSURE_END));
+	traceReadoutStart->setValueDouble (readoutTrace.get (rts2core::TRACE_READOUT_START));
+	sendValueAll (traceExposureEnd);
+	sendValueAll (traceReadoutStart);
 	// if we can do exposure, do it..
 	if (quedExpNumber->getValueInteger () > 0 && exposureConn && supportFrameTransfer ())
 	{
@@ -1849,6 +2585,20 @@ int Camera::camReadout (rts2core::Connection * conn)
 
 	memset (dataWritten, 0, getNumChannels () * sizeof (size_t));
 
+	// SHARED transfer has own buffers
+	if (frameRing && currentImageTransfer != SHARED)
+	{
+		ringFrame = frameRing->beginFrame ();
+		if (ringFrame == NULL)
+			ringFull->inc ();
+	}
+
+	// buffer data, send them after next exposure is started
+	pipelineActive = pipeline->getValueBool () && suggestBufferSize () > 0 && currentImageTransfer == TCPIP && currentImageData >= 0 && ringFrame == NULL && realTimeDataTransferCount < 0;
+	// pipeline was switched off, send pending frame before data of the new frame
+	if (!pipelineActive)
+		flushPendingData ();
+
 	if (realTimeDataTransferCount >= 0)
 	{
 		realTimeDataTransferCount++;
@@ -2194,6 +2944,8 @@ char* Camera::getDataBuffer (int chan)
 {
 	if (currentImageTransfer == SHARED)
 		return ((char *) sharedData->getChannelData (chan)) + sizeof (imghdr);
+	if (ringFrame)
+		return frameRing->getChannel (ringFrame, chan) + sizeof (imghdr);
 	// if dataBuffesr is null, allocate it
 	if (dataBuffers[chan] == NULL && suggestBufferSize () > 0)
 		dataBuffers[chan] = new char[getHeight () * getWidth () * maxPixelByteSize ()];
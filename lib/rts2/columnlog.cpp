@@ -0,0 +1,515 @@
+/*
+ * Columnar binary log of device values.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "columnlog.h"
+#include "displayvalue.h"
+#include "numfmt.h"
+#include "value.h"
+
+#include <math.h>
+#include <string.h>
+
+// maximal chunk payload accepted by reader
+#define COLUMNLOG_MAX_PAYLOAD   (256 * 1024 * 1024)
+
+using namespace rts2core;
+
+static void putVarint (std::string &buf, uint64_t v)
+{
+	while (v >= 0x80)
+	{
+		buf += (char) ((v & 0x7f) | 0x80);
+		v >>= 7;
+	}
+	buf += (char) v;
+}
+
+static bool getVarint (const char *&p, const char *end, uint64_t &v)
+{
+	v = 0;
+	for (int shift = 0; shift < 64 && p < end; shift += 7)
+	{
+		uint8_t b = *p++;
+		v |= (uint64_t) (b & 0x7f) << shift;
+		if (!(b & 0x80))
+			return true;
+	}
+	return false;
+}
+
+static uint64_t zigzag (int64_t v)
+{
+	return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+static int64_t unzigzag (uint64_t v)
+{
+	return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+static void putString (std::string &buf, const std::string &s)
+{
+	putVarint (buf, s.length ());
+	buf.append (s);
+}
+
+static bool getString (const char *&p, const char *end, std::string &s)
+{
+	uint64_t l;
+	if (!getVarint (p, end, l) || l > (uint64_t) (end - p))
+		return false;
+	s.assign (p, l);
+	p += l;
+	return true;
+}
+
+static void putUInt32 (std::string &buf, uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		buf += (char) (v & 0xff);
+		v >>= 8;
+	}
+}
+
+static uint32_t getUInt32 (const char *p)
+{
+	return (uint32_t) (uint8_t) p[0] | ((uint32_t) (uint8_t) p[1] << 8) | ((uint32_t) (uint8_t) p[2] << 16) | ((uint32_t) (uint8_t) p[3] << 24);
+}
+
+static uint64_t doubleBits (double v)
+{
+	uint64_t ret;
+	memcpy (&ret, &v, sizeof (ret));
+	return ret;
+}
+
+/**
+ * Encode XOR of double with the previous value. Header byte holds number
+ * of leading zero bytes in upper nibble and number of trailing zero
+ * bytes in lower nibble, only the remaining bytes follow.
+ */
+static void putDouble (std::string &buf, uint64_t &last, double v)
+{
+	uint64_t bits = doubleBits (v);
+	uint64_t x = bits ^ last;
+	last = bits;
+	if (x == 0)
+	{
+		buf += (char) 0x80;
+		return;
+	}
+	int lead = __builtin_clzll (x) / 8;
+	int trail = __builtin_ctzll (x) / 8;
+	buf += (char) ((lead << 4) | trail);
+	for (int i = 7 - lead; i >= trail; i--)
+		buf += (char) ((x >> (8 * i)) & 0xff);
+}
+
+static bool getDouble (const char *&p, const char *end, uint64_t &last, double &v)
+{
+	if (p >= end)
+		return false;
+	uint8_t h = *p++;
+	int lead = h >> 4;
+	int trail = h & 0x0f;
+	if (lead + trail > 8)
+		return false;
+	int n = 8 - lead - trail;
+	if (n > end - p)
+		return false;
+	uint64_t x = 0;
+	for (int i = 0; i < n; i++)
+		x = (x << 8) | (uint8_t) *p++;
+	if (n > 0)
+		x <<= 8 * trail;
+	last ^= x;
+	memcpy (&v, &last, sizeof (v));
+	return true;
+}
+
+int rts2core::columnLogType (Value *value)
+{
+	if (value->getValueExtType ())
+		return COLUMNLOG_STRING;
+	switch (value->getValueBaseType ())
+	{
+		case RTS2_VALUE_INTEGER:
+		case RTS2_VALUE_LONGINT:
+		case RTS2_VALUE_BOOL:
+			return COLUMNLOG_INTEGER;
+		case RTS2_VALUE_DOUBLE:
+		case RTS2_VALUE_FLOAT:
+		case RTS2_VALUE_TIME:
+			return COLUMNLOG_DOUBLE;
+		default:
+			return COLUMNLOG_STRING;
+	}
+}
+
+void ColumnLogColumn::appendValue (std::string &str, size_t row)
+{
+	char buf[50];
+	switch (type)
+	{
+		case COLUMNLOG_INTEGER:
+			snprintf (buf, sizeof (buf), "%lld", (long long) ints[row]);
+			str.append (buf);
+			break;
+		case COLUMNLOG_DOUBLE:
+			appendDouble (str, doubles[row]);
+			break;
+		default:
+			str.append (strings[row]);
+	}
+}
+
+int ColumnLogChunk::findColumn (const char *name)
+{
+	for (size_t i = 0; i < columns.size (); i++)
+	{
+		if (columns[i].name == name)
+			return i;
+	}
+	return -1;
+}
+
+void ColumnLogChunk::clear ()
+{
+	device.clear ();
+	times.clear ();
+	columns.clear ();
+	names.clear ();
+}
+
+ColumnLogWriter::ColumnLogWriter (const char *_device)
+{
+	device = std::string (_device);
+	reset ();
+}
+
+bool ColumnLogWriter::sameColumns (std::list <Value *> &values)
+{
+	if (values.size () != names.size ())
+		return false;
+	size_t i = 0;
+	for (std::list <Value *>::iterator iter = values.begin (); iter != values.end (); iter++, i++)
+	{
+		if ((*iter)->getName () != names[i] || columnLogType (*iter) != types[i])
+			return false;
+	}
+	return true;
+}
+
+int ColumnLogWriter::addRow (double t, std::list <Value *> &values)
+{
+	if (rows == 0)
+	{
+		names.clear ();
+		types.clear ();
+		for (std::list <Value *>::iterator iter = values.begin (); iter != values.end (); iter++)
+		{
+			names.push_back ((*iter)->getName ());
+			types.push_back (columnLogType (*iter));
+		}
+		colBufs.assign (names.size (), std::string ());
+		lastInts.assign (names.size (), 0);
+		lastDoubles.assign (names.size (), 0);
+		lastStrings.assign (names.size (), std::string ());
+		firstTime = t;
+	}
+	else if (!sameColumns (values))
+	{
+		return -1;
+	}
+
+	// first time is stored as it is, then deltas of deltas
+	int64_t us = llround (t * 1000000.0);
+	if (rows == 0)
+	{
+		putVarint (timeBuf, zigzag (us));
+	}
+	else
+	{
+		int64_t delta = us - lastTime;
+		putVarint (timeBuf, zigzag (delta - lastDelta));
+		lastDelta = delta;
+	}
+	lastTime = us;
+
+	size_t i = 0;
+	for (std::list <Value *>::iterator iter = values.begin (); iter != values.end (); iter++, i++)
+	{
+		switch (types[i])
+		{
+			case COLUMNLOG_INTEGER:
+				{
+					int64_t v = (*iter)->getValueLong ();
+					putVarint (colBufs[i], zigzag ((int64_t) ((uint64_t) v - (uint64_t) lastInts[i])));
+					lastInts[i] = v;
+				}
+				break;
+			case COLUMNLOG_DOUBLE:
+				putDouble (colBufs[i], lastDoubles[i], (*iter)->getValueDouble ());
+				break;
+			default:
+				{
+					std::string v = getDisplayValue (*iter);
+					if (rows > 0 && v == lastStrings[i])
+					{
+						colBufs[i] += (char) 0;
+					}
+					else
+					{
+						putVarint (colBufs[i], v.length () + 1);
+						colBufs[i].append (v);
+						lastStrings[i] = v;
+					}
+				}
+		}
+	}
+	rows++;
+	return 0;
+}
+
+std::string ColumnLogWriter::encode ()
+{
+	std::string payload;
+	payload += (char) COLUMNLOG_VERSION;
+	putString (payload, device);
+	putVarint (payload, names.size ());
+	for (size_t i = 0; i < names.size (); i++)
+	{
+		putString (payload, names[i]);
+		payload += (char) types[i];
+	}
+	putVarint (payload, rows);
+	putString (payload, timeBuf);
+	for (size_t i = 0; i < colBufs.size (); i++)
+		putString (payload, colBufs[i]);
+
+	std::string ret;
+	putUInt32 (ret, COLUMNLOG_MAGIC);
+	putUInt32 (ret, payload.length ());
+	ret.append (payload);
+	return ret;
+}
+
+int ColumnLogWriter::write (std::ostream &os)
+{
+	if (rows == 0)
+		return 0;
+	std::string chunk = encode ();
+	reset ();
+	os.write (chunk.data (), chunk.length ());
+	os.flush ();
+	return os.fail () ? -1 : 0;
+}
+
+void ColumnLogWriter::reset ()
+{
+	rows = 0;
+	firstTime = NAN;
+	timeBuf.clear ();
+	lastTime = 0;
+	lastDelta = 0;
+	for (std::vector <std::string>::iterator iter = colBufs.begin (); iter != colBufs.end (); iter++)
+		iter->clear ();
+}
+
+ColumnLogReader::ColumnLogReader (std::istream &_is):is (_is)
+{
+	skipped = 0;
+}
+
+bool ColumnLogReader::selected (const std::string &name)
+{
+	if (columns.empty ())
+		return true;
+	for (std::vector <std::string>::iterator iter = columns.begin (); iter != columns.end (); iter++)
+	{
+		if (*iter == name)
+			return true;
+	}
+	return false;
+}
+
+int ColumnLogReader::readChunk (ColumnLogChunk &chunk)
+{
+	char header[8];
+	std::string payload;
+	while (true)
+	{
+		is.read (header, 4);
+		if (is.gcount () == 0)
+			return 0;
+		if (is.gcount () < 4)
+		{
+			skipped += is.gcount ();
+			return 0;
+		}
+		// search for the next chunk after corrupted data
+		while (getUInt32 (header) != COLUMNLOG_MAGIC)
+		{
+			int c = is.get ();
+			if (c == EOF)
+			{
+				skipped += 4;
+				return 0;
+			}
+			memmove (header, header + 1, 3);
+			header[3] = c;
+			skipped++;
+		}
+		is.read (header + 4, 4);
+		if (is.gcount () < 4)
+		{
+			skipped += 4 + is.gcount ();
+			return 0;
+		}
+		uint32_t len = getUInt32 (header + 4);
+		if (len > COLUMNLOG_MAX_PAYLOAD)
+		{
+			skipped += 8;
+			continue;
+		}
+		payload.resize (len);
+		is.read (&payload[0], len);
+		if ((uint32_t) is.gcount () < len)
+		{
+			// truncated chunk at the end of file, e.g. file being written
+			skipped += 8 + is.gcount ();
+			return 0;
+		}
+		int ret = decode (payload, chunk);
+		if (ret == 0)
+			return 1;
+		if (ret < 0)
+			skipped += 8 + len;
+	}
+}
+
+int ColumnLogReader::decode (const std::string &payload, ColumnLogChunk &chunk)
+{
+	chunk.clear ();
+	const char *p = payload.data ();
+	const char *end = p + payload.length ();
+
+	if (p >= end || *p++ != COLUMNLOG_VERSION)
+		return -1;
+	if (!getString (p, end, chunk.device))
+		return -1;
+	if (!device.empty () && chunk.device != device)
+		return 1;
+
+	uint64_t ncols;
+	if (!getVarint (p, end, ncols) || ncols > (uint64_t) (end - p))
+		return -1;
+	std::vector <int> types;
+	for (uint64_t i = 0; i < ncols; i++)
+	{
+		std::string name;
+		if (!getString (p, end, name) || p >= end)
+			return -1;
+		chunk.names.push_back (name);
+		types.push_back (*p++);
+	}
+
+	uint64_t rows;
+	if (!getVarint (p, end, rows) || rows > (uint64_t) (end - p))
+		return -1;
+
+	std::string buf;
+	if (!getString (p, end, buf))
+		return -1;
+	const char *bp = buf.data ();
+	const char *bend = bp + buf.length ();
+	int64_t t = 0;
+	int64_t delta = 0;
+	chunk.times.reserve (rows);
+	for (uint64_t r = 0; r < rows; r++)
+	{
+		uint64_t v;
+		if (!getVarint (bp, bend, v))
+			return -1;
+		if (r == 0)
+		{
+			t = unzigzag (v);
+		}
+		else
+		{
+			delta += unzigzag (v);
+			t += delta;
+		}
+		chunk.times.push_back (t / 1000000.0);
+	}
+
+	for (uint64_t i = 0; i < ncols; i++)
+	{
+		if (!getString (p, end, buf))
+			return -1;
+		if (!selected (chunk.names[i]))
+			continue;
+		chunk.columns.push_back (ColumnLogColumn (chunk.names[i], types[i]));
+		ColumnLogColumn &col = chunk.columns.back ();
+		bp = buf.data ();
+		bend = bp + buf.length ();
+		int64_t lastInt = 0;
+		uint64_t lastDouble = 0;
+		for (uint64_t r = 0; r < rows; r++)
+		{
+			uint64_t v;
+			switch (col.type)
+			{
+				case COLUMNLOG_INTEGER:
+					if (!getVarint (bp, bend, v))
+						return -1;
+					lastInt = (int64_t) ((uint64_t) lastInt + (uint64_t) unzigzag (v));
+					col.ints.push_back (lastInt);
+					break;
+				case COLUMNLOG_DOUBLE:
+					{
+						double d;
+						if (!getDouble (bp, bend, lastDouble, d))
+							return -1;
+						col.doubles.push_back (d);
+					}
+					break;
+				case COLUMNLOG_STRING:
+					if (!getVarint (bp, bend, v) || v > (uint64_t) (bend - bp) + 1)
+						return -1;
+					if (v == 0)
+					{
+						if (col.strings.empty ())
+							return -1;
+						col.strings.push_back (col.strings.back ());
+					}
+					else
+					{
+						col.strings.push_back (std::string (bp, v - 1));
+						bp += v - 1;
+					}
+					break;
+				default:
+					return -1;
+			}
+		}
+	}
+	return 0;
+}
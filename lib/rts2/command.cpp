@@ -144,6 +144,31 @@ int CommandSendKey::send ()
 	return Command::send ();
 }
 
+int CommandSendKey::commandReturnOK (Connection * conn)
+{
+	connection->setConnState (CONN_AUTH_OK);
+	connection->queSend (new CommandBinaryValues (owner));
+	if (connection->getSubscriptionRequest ())
+		connection->queCommand (new CommandSubscribe (owner, connection->getSubscriptionRequest ()));
+	return -1;
+}
+
+CommandBinaryValues::CommandBinaryValues (Block * _master):Command (_master)
+{
+	std::ostringstream _os;
+	_os << COMMAND_BINARY_VALUES " " << BINARY_VALUES_VERSION;
+	setCommand (_os);
+}
+
+CommandSubscribe::CommandSubscribe (Block * _master, ValueSubscription *subscription):Command (_master)
+{
+	std::ostringstream _os;
+	_os << COMMAND_SUBSCRIBE " " << subscription->getInterval ();
+	for (std::vector <std::string>::const_iterator iter = subscription->getPatterns ().begin (); iter != subscription->getPatterns ().end (); iter++)
+		_os << " " << *iter;
+	setCommand (_os);
+}
+
 CommandAuthorize::CommandAuthorize (Block * _master, int centralId, int key):Command (_master)
 {
 	std::ostringstream _os;
@@ -29,6 +29,8 @@
 #include "valueminmax.h"
 #include "valuerectangle.h"
 #include "valuearray.h"
+#include "exposuretrace.h"
+#include "numfmt.h"
 
 #include "libnova_cpp.h"
 
@@ -42,12 +44,15 @@
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/stat.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 
 using namespace rts2core;
 
+uint32_t Connection::valuesEpoch = 0;
+
 ConnError::ConnError (Connection *conn, const char *_msg): Error (_msg)
 {
 	conn->connectionError (-1);
@@ -99,6 +104,12 @@ Connection::Connection (Block * in_master):Object ()
 	activeReadData = -1;
 	dataConn = 0;
 
+	binaryValues = false;
+	binaryFrameSize = -1;
+
+	subscription = NULL;
+	subscriptionRequest = NULL;
+
 	sharedReadMemory = NULL;
 }
 
@@ -141,6 +152,12 @@ Connection::Connection (int in_sock, Block * in_master):Object ()
 	activeReadData = -1;
 	dataConn = 0;
 
+	binaryValues = false;
+	binaryFrameSize = -1;
+
+	subscription = NULL;
+	subscriptionRequest = NULL;
+
 	sharedReadMemory = NULL;
 }
 
@@ -154,6 +171,9 @@ Connection::~Connection (void)
 	delete[]buf;
 	delete sharedReadMemory;
 	delete otherDevice;
+	delete subscription;
+	delete subscriptionRequest;
+	changeValuesEpoch ();
 }
 
 int Connection::add (Block *block)
@@ -837,6 +857,23 @@ void Connection::processLine ()
 			ret = -1;
 		}
 	}
+	else if (isCommand (PROTO_VALUE_FRAME))
+	{
+		int size;
+		if (paramNextInteger (&size) || size < 0 || !paramEnd ())
+		{
+			// end connection - we cannot find frame end
+			connectionError (-2);
+			ret = -2;
+		}
+		else
+		{
+			binaryFrameSize = size;
+			binaryFrame.clear ();
+			binaryFrame.reserve (size);
+			ret = -1;
+		}
+	}
 	else if (isCommand (PROTO_SELMETAINFO))
 	{
 		char *m_name;
@@ -895,6 +932,8 @@ void Connection::processLine ()
 		}
 		else
 		{
+			if (std::isnan (readChannels[activeReadData]->dataStart))
+				readChannels[activeReadData]->dataStart = traceNow ();
 			ret = -1;
 		}
 	}
@@ -953,6 +992,7 @@ void Connection::processLine ()
 			{
 				DataChannels * chann = new DataChannels ();
 				chann->initSharedFromConnection (this, sharedReadMemory);
+				chann->dataStart = traceNow ();
 				readChannels[dC] = chann;
 				newDataConn (dC);
 			}
@@ -971,6 +1011,7 @@ void Connection::processLine ()
 			std::map <int, DataChannels *>::iterator iter = readChannels.find (dC);
 			if (iter != readChannels.end ())
 			{
+				iter->second->dataEnd = traceNow ();
 				if (otherDevice)
 				{
 					otherDevice->fullDataReceived (dC, iter->second);
@@ -1086,6 +1127,16 @@ void Connection::processBuffer ()
 				memmove (buf_top, buf_top + readSize, (full_data_end - buf_top) - readSize + 1);
 				full_data_end -= readSize;
 			}
+			// binary value frame
+			if (binaryFrameSize >= 0)
+			{
+				long readSize = std::min ((long) (full_data_end - buf_top), binaryFrameSize - (long) binaryFrame.length ());
+				binaryFrame.append (buf_top, readSize);
+				memmove (buf_top, buf_top + readSize, (full_data_end - buf_top) - readSize + 1);
+				full_data_end -= readSize;
+				if ((long) binaryFrame.length () == binaryFrameSize)
+					processValueFrame ();
+			}
 			command_start = buf_top;
 		}
 	}
@@ -1123,6 +1174,28 @@ int Connection::receive (Block *block)
 			dataReceived ();
 			return data_size;
 		}
+		// rest of binary value frame
+		if (binaryFrameSize >= 0)
+		{
+			size_t oldSize = binaryFrame.length ();
+			binaryFrame.resize (binaryFrameSize);
+			data_size = read (sock, &binaryFrame[oldSize], binaryFrameSize - oldSize);
+			if (data_size == -1 && errno == EINTR)
+			{
+				binaryFrame.resize (oldSize);
+				return 0;
+			}
+			if (data_size <= 0)
+			{
+				connectionError (data_size);
+				return -1;
+			}
+			binaryFrame.resize (oldSize + data_size);
+			successfullRead ();
+			if ((long) binaryFrame.length () == binaryFrameSize)
+				processValueFrame ();
+			return data_size;
+		}
 		checkBufferSize ();
 		data_size = read (sock, buf_top, buf_size - (buf_top - buf));
 		// ignore EINTR
@@ -1581,16 +1654,19 @@ int Connection::sendMsg (const char *msg)
 		return -1;
 	}
 	len = strlen (msg) + 1;
-	char *mbuf = new char[len + 1];
-	strcpy (mbuf, msg);
 	#ifdef DEBUG_ALL
 	std::cout << "Connection::sendMsg will send " << msg << std::endl;
 	#endif
-	strcat (mbuf, "\n");
+	// send message and new line in a single call, without copying message
+	struct iovec iov[2];
+	iov[0].iov_base = (void *) msg;
+	iov[0].iov_len = len - 1;
+	iov[1].iov_base = (void *) "\n";
+	iov[1].iov_len = 1;
 	// ignore EINTR
 	do
 	{
-		ret = write (sock, mbuf, len);
+		ret = writev (sock, iov, 2);
 	} while (ret == -1 && errno == EINTR);
 
 	if (ret != len)
@@ -1604,7 +1680,6 @@ int Connection::sendMsg (const char *msg)
 			<< sendLog;
 		#endif
 		connectionError (ret);
-		delete[] mbuf;
 		return -1;
 	}
 	#ifdef DEBUG_ALL
@@ -1613,7 +1688,6 @@ int Connection::sendMsg (const char *msg)
 		<< std::endl;
 	#endif
 
-	delete[] mbuf;
 	successfullSend ();
 	return 0;
 }
@@ -1628,6 +1702,202 @@ int Connection::sendMsg (std::ostringstream &_os)
 	return sendMsg (_os.str ().c_str ());
 }
 
+int Connection::sendFrame (const std::string &frame)
+{
+	if (frame.empty ())
+		return 0;
+	if (sock == -1 || getConnState () == CONN_INPROGRESS || getConnState () == CONN_UNKNOW)
+		return -1;
+	const char *top = frame.data ();
+	size_t rest = frame.length ();
+	while (rest > 0)
+	{
+		ssize_t ret = write (sock, top, rest);
+		if (ret == -1)
+		{
+			// ignore EINTR
+			if (errno == EINTR)
+				continue;
+			syslog (LOG_ERR, "Cannot send frame of %lu bytes to sock %i, errno %i message %m", (unsigned long) frame.length (), sock, errno);
+			connectionError (ret);
+			return -1;
+		}
+		top += ret;
+		rest -= ret;
+	}
+	successfullSend ();
+	return 0;
+}
+
+int Connection::sendValueFrame (ValueFrame &frame, bool rateLimit)
+{
+	if (frame.empty ())
+		return 0;
+	// indices of values accepted by the subscription
+	std::vector <size_t> selected;
+	bool all = true;
+	if (subscription)
+	{
+		double now = getNow ();
+		for (size_t i = 0; i < frame.size (); i++)
+		{
+			if (subscription->accept (frame.getValue (i), frame.getId (i), now, rateLimit))
+				selected.push_back (i);
+			else
+				all = false;
+		}
+		if (selected.empty ())
+			return 0;
+	}
+	size_t count = all ? frame.size () : selected.size ();
+
+	bool binary = binaryValues;
+	// value without ID cannot be send in binary frame
+	for (size_t k = 0; binary && k < count; k++)
+	{
+		if (frame.getId (all ? k : selected[k]) < 0)
+			binary = false;
+	}
+
+	if (!binary)
+	{
+		if (all)
+			return sendFrame (frame.getText ());
+		std::string text;
+		for (size_t k = 0; k < count; k++)
+			frame.appendText (text, selected[k]);
+		return sendFrame (text);
+	}
+
+	std::string names;
+	for (size_t k = 0; k < count; k++)
+	{
+		size_t i = all ? k : selected[k];
+		int id = frame.getId (i);
+		if ((size_t) id >= binaryDefined.size ())
+			binaryDefined.resize (id + 1, false);
+		if (!binaryDefined[id])
+		{
+			const std::string &vn = frame.getValue (i)->getName ();
+			binaryPutVarint (names, id);
+			binaryPutRecord (names, BINARY_VALUE_NAME, vn.length ());
+			names.append (vn);
+			binaryDefined[id] = true;
+		}
+	}
+	std::string records;
+	if (!all)
+	{
+		for (size_t k = 0; k < count; k++)
+			frame.appendBinary (records, selected[k]);
+	}
+	const std::string &data = all ? frame.getBinary () : records;
+	char header[50];
+	int hlen = snprintf (header, sizeof (header), PROTO_VALUE_FRAME " %lu\n", (unsigned long) (names.length () + data.length ()));
+	std::string msg;
+	msg.reserve (hlen + names.length () + data.length ());
+	msg.append (header, hlen);
+	msg.append (names);
+	msg.append (data);
+	return sendFrame (msg);
+}
+
+void Connection::setSubscription (ValueSubscription *_subscription)
+{
+	delete subscription;
+	subscription = _subscription;
+}
+
+void Connection::subscribe (ValueSubscription *_subscription)
+{
+	delete subscriptionRequest;
+	subscriptionRequest = _subscription;
+	if (isConnState (CONN_AUTH_OK))
+		queCommand (new CommandSubscribe (master, subscriptionRequest));
+}
+
+void Connection::getPendingValues (double now, std::vector <int> &ids)
+{
+	if (subscription)
+		subscription->getPending (now, ids);
+}
+
+int Connection::processValueFrame ()
+{
+	const char *data = binaryFrame.data ();
+	const char *end = data + binaryFrame.length ();
+	bool malformed = false;
+	binaryFrameSize = -1;
+	while (data < end && !malformed)
+	{
+		uint64_t id;
+		uint64_t length;
+		if (binaryGetVarint (data, end, id) || data >= end)
+		{
+			malformed = true;
+			break;
+		}
+		char rtype = *data++;
+		if (binaryGetVarint (data, end, length) || length > (uint64_t) (end - data))
+		{
+			malformed = true;
+			break;
+		}
+		if (rtype == BINARY_VALUE_NAME)
+		{
+			// IDs are indices of sender values
+			if (id > MAX_BINARY_ID)
+			{
+				malformed = true;
+				break;
+			}
+			if (id >= binaryIds.size ())
+				binaryIds.resize (id + 1, -1);
+			binaryIds[id] = values.internValueId (std::string (data, length).c_str ());
+			data += length;
+			continue;
+		}
+		// value must be named before its first use
+		if (id >= binaryIds.size () || binaryIds[id] < 0)
+		{
+			malformed = true;
+			break;
+		}
+		Value *value = values.getValueById (binaryIds[id]);
+		if (value)
+		{
+			int ret;
+			if (rtype == BINARY_VALUE_TEXT)
+			{
+				// parse text with the usual paramNext functions
+				std::string text (data, length);
+				char *old_top = command_buf_top;
+				command_buf_top = &text[0];
+				ret = value->setValue (this);
+				command_buf_top = old_top;
+			}
+			else
+			{
+				ret = value->decodeBinary (rtype, data, length);
+			}
+			if (ret)
+				logStream (MESSAGE_ERROR) << "cannot decode value " << value->getName () << " from binary frame received from " << getName () << sendLog;
+			if (getOtherDevClient ())
+				getOtherDevClient ()->valueChanged (value);
+		}
+		data += length;
+	}
+	if (malformed)
+	{
+		logStream (MESSAGE_ERROR) << "malformed binary value frame received from " << getName () << sendLog;
+		binaryFrame.clear ();
+		connectionError (-2);
+		return -1;
+	}
+	binaryFrame.clear ();
+	return 0;
+}
+
 int Connection::startBinaryData (int dataType, int channum, size_t *chansize)
 {
 	std::ostringstream _os;
@@ -1773,6 +2043,10 @@ void Connection::connConnected ()
 void Connection::connectionError (int last_data_size)
 {
 	activeReadData = -1;
+	binaryFrameSize = -1;
+	binaryIds.clear ();
+	setBinaryValues (false);
+	setSubscription (NULL);
 	if (canDelete ())
 		setConnState (CONN_DELETE);
 	else
@@ -1799,11 +2073,10 @@ int Connection::sendValue (std::string val_name, int value)
 int Connection::sendValue (std::string val_name, int val1, double val2)
 {
 	std::ostringstream _os;
-	_os.setf (std::ios_base::fixed, std::ios_base::floatfield);
-	_os.precision (20);
-	_os << PROTO_VALUE " " << val_name << " " << val1
-		<< " " << val2;
-	return sendMsg (_os);
+	_os << PROTO_VALUE " " << val_name << " " << val1 << " ";
+	std::string msg = _os.str ();
+	appendDouble (msg, val2);
+	return sendMsg (msg.c_str ());
 }
 
 int Connection::sendValue (std::string val_name, const char *value)
@@ -1830,11 +2103,11 @@ int Connection::sendValueRaw (std::string val_name, const char *value)
 
 int Connection::sendValue (std::string val_name, double value)
 {
-	std::ostringstream _os;
-	_os.setf (std::ios_base::fixed, std::ios_base::floatfield);
-	_os.precision (20);
-	_os << PROTO_VALUE " " << val_name << " " << value;
-	return sendMsg (_os);
+	std::string msg (PROTO_VALUE " ");
+	msg += val_name;
+	msg += ' ';
+	appendDouble (msg, value);
+	return sendMsg (msg.c_str ());
 }
 
 int Connection::sendValue (char *val_name, char *val1, int val2)
@@ -1847,13 +2120,15 @@ int Connection::sendValue (char *val_name, char *val1, int val2)
 int Connection::sendValue (char *val_name, int val1, int val2, double val3, double val4, double val5, double val6)
 {
 	std::ostringstream _os;
-	_os.setf (std::ios_base::fixed, std::ios_base::floatfield);
-	_os.precision (20);
-	_os << PROTO_VALUE " " << val_name << " "
-		<< val1 << " " << val2 << " "
-		<< val3 << " " << val4 << " "
-		<< val5 << " " << val6;
-	return sendMsg (_os);
+	_os << PROTO_VALUE " " << val_name << " " << val1 << " " << val2;
+	std::string msg = _os.str ();
+	double vals[] = {val3, val4, val5, val6};
+	for (int i = 0; i < 4; i++)
+	{
+		msg += ' ';
+		appendDouble (msg, vals[i]);
+	}
+	return sendMsg (msg.c_str ());
 }
 
 int Connection::sendValueTime (std::string val_name, time_t * value)
@@ -2029,7 +2304,7 @@ int Connection::paramNextSSizeT (ssize_t * num)
 int Connection::paramNextDouble (double *num)
 {
 	char *str_num;
-	int ret;
+	char *num_end;
 	if (paramNextString (&str_num, ","))
 		return -1;
 	if (!strcasecmp (str_num, "nan"))
@@ -2037,8 +2312,8 @@ int Connection::paramNextDouble (double *num)
 		*num = NAN;
 		return 0;
 	}
-	ret = sscanf (str_num, "%lf", num);
-	if (ret != 1)
+	*num = parseDouble (str_num, &num_end);
+	if (num_end == str_num)
 		return -1;
 	return 0;
 }
@@ -2118,11 +2393,11 @@ int Connection::paramNextDoubleTime (double *num)
 int Connection::paramNextFloat (float *num)
 {
 	char *str_num;
-	int ret;
+	char *num_end;
 	if (paramNextString (&str_num, ","))
 		return -1;
-	ret = sscanf (str_num, "%f", num);
-	if (ret != 1)
+	*num = parseDouble (str_num, &num_end);
+	if (num_end == str_num)
 		return -1;
 	return 0;
 }
@@ -2179,6 +2454,7 @@ void Connection::dataReceived ()
 		otherDevice->dataReceived ((iter->second)->at(activeReadChannel));
 	if ((iter->second)->getRestSize () == 0)
 	{
+		(iter->second)->dataEnd = traceNow ();
 		if (otherDevice)
 			otherDevice->fullDataReceived (iter->first, iter->second);
 		delete iter->second;
@@ -2220,7 +2496,8 @@ void Connection::addValue (Value * value, const ValueVector::iterator eiter)
 {
 	if (value->isValue (RTS2_VALUE_INFOTIME))
 		info_time = (ValueTime *) value;
-	values.insert (eiter, value);
+	values.insertValue (eiter, value);
+	changeValuesEpoch ();
 }
 
 int Connection::metaInfo (int rts2Type, std::string m_name, std::string desc)
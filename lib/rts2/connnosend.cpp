@@ -41,3 +41,8 @@ int ConnNoSend::sendMsg (const char *msg)
 {
 	return 0;
 }
+
+int ConnNoSend::sendFrame (const std::string &frame)
+{
+	return 0;
+}
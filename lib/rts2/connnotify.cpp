@@ -88,7 +88,7 @@ int ConnNotify::receive (Block *block)
 						logStream (MESSAGE_DEBUG) << "notified update of file with ID " << ep->wd << sendLog;
 					}
 				}
-				ep += sizeof (struct inotify_event) + ep->len;
+				ep = (struct inotify_event *) (((char *) ep) + sizeof (struct inotify_event) + ep->len);
 			}
 			free (event);
 		}
@@ -95,6 +95,7 @@ Daemon::Daemon (int _argc, char **_argv, int _init_state):rts2core::Block (_argc
 	uptime->setNow ();
 
 	idleInfoInterval = -1;
+	subscriptionFlushTime = NAN;
 
 	addOption ('i', NULL, 0, "run in interactive mode, don't loose console");
 	addOption (OPT_AUTORESTART, "autorestart", 1, "seconds to wait for restart of crashed daemon");
@@ -569,6 +570,10 @@ void Daemon::postEvent (Event *event)
 				return;
 			}
 			break;
+		case EVENT_SUBSCRIPTION_FLUSH:
+			subscriptionFlushTime = NAN;
+			flushSubscriptions ();
+			break;
 	}
 	rts2core::Block::postEvent (event);
 }
@@ -706,7 +711,7 @@ void Daemon::pollSuccess ()
 
 void Daemon::addValue (Value * value, int queCondition)
 {
-	values.push_back (new CondValue (value, queCondition));
+	values.addCondValue (new CondValue (value, queCondition));
 }
 
 Value * Daemon::getOwnValue (const char *v_name)
@@ -719,28 +724,35 @@ Value * Daemon::getOwnValue (const char *v_name)
 
 CondValue * Daemon::getCondValue (const char *v_name)
 {
-	CondValueVector::iterator iter;
-	for (iter = values.begin (); iter != values.end (); iter++)
-	{
-		CondValue *val = *iter;
-		if (val->getValue ()->isValue (v_name))
-			return val;
-	}
-	return NULL;
+	return values.getCondValue (v_name);
 }
 
 CondValue * Daemon::getCondValue (const Value *val)
 {
-	CondValueVector::iterator iter;
-	for (iter = values.begin (); iter != values.end (); iter++)
-	{
-		CondValue *c_val = *iter;
-		if (c_val->getValue () == val)
-			return c_val;
-	}
+	return values.getCondValue (val);
+}
+
+Value * Daemon::getValueByFrameId (int id)
+{
+	CondValue *c_val = values.getCondValueById (id);
+	if (c_val)
+		return c_val->getValue ();
+	if (id == getValueFrameId (info_time))
+		return info_time;
+	if (id == getValueFrameId (uptime))
+		return uptime;
 	return NULL;
 }
 
+int Daemon::getValueFrameId (Value *val)
+{
+	CondValue *c_val = values.getCondValue (val);
+	if (c_val)
+		return c_val->getId ();
+	// values which are not in values list (uptime, infotime) are registered by name
+	return values.internValueId (val->getName ().c_str ());
+}
+
 Value * Daemon::duplicateValue (Value * old_value, bool withVal)
 {
 	// create new value, which will be passed to hook
@@ -819,7 +831,7 @@ Value * Daemon::duplicateValue (Value * old_value, bool withVal)
 
 void Daemon::addConstValue (Value * value)
 {
-	constValues.push_back (value);
+	constValues.addValue (value);
 }
 
 void Daemon::addConstValue (const char *in_name, const char *in_desc, const char *in_value)
@@ -1052,11 +1064,22 @@ int Daemon::infoAll ()
 	{
 		return -1;
 	}
+	// values are encoded only once and send in a single frame to all connections
+	ValueFrame frame;
+	encodeInfo (frame);
+
 	connections_t::iterator iter;
 	for (iter = getConnections ()->begin (); iter != getConnections ()->end (); iter++)
-		sendInfo (*iter);
+	{
+		if (isRunning (*iter))
+		{
+			(*iter)->sendValueFrame (frame);
+			scheduleSubscriptionFlush (*iter);
+		}
+	}
 	for (iter = getCentraldConns ()->begin (); iter != getCentraldConns ()->end (); iter++)
-		sendInfo (*iter);
+		if (isRunning (*iter))
+			(*iter)->sendValueFrame (frame);
 
 	for (CondValueVector::iterator iter2 = values.begin (); iter2 != values.end (); iter2++)
 	{
@@ -1080,36 +1103,84 @@ int Daemon::sendInfo (Connection * conn, bool forceSend)
 {
 	if (!isRunning (conn))
 		return -1;
+	ValueFrame frame;
+	encodeInfo (frame, forceSend);
+	// client asked for the values, they are not rate limited
+	conn->sendValueFrame (frame, false);
+	return 0;
+}
+
+void Daemon::encodeInfo (ValueFrame &frame, bool forceSend)
+{
 	for (CondValueVector::iterator iter = values.begin (); iter != values.end (); iter++)
 	{
 		Value *val = (*iter)->getValue ();
 		if (val->needSend () || forceSend)
-		{
-			val->send (conn);
-		}
+			frame.add (val, (*iter)->getId ());
 	}
 	if (info_time->needSend ())
-		info_time->send (conn);
+		frame.add (info_time, getValueFrameId (info_time));
 	if (uptime->needSend ())
-		uptime->send (conn);
-	return 0;
+		frame.add (uptime, getValueFrameId (uptime));
 }
 
 void Daemon::sendValueAll (Value * value)
 {
 	if (value->needSend ())
 	{
+		// encode once for all connections
+		ValueFrame frame;
+		frame.add (value, getValueFrameId (value));
+
 		connections_t::iterator iter;
 		for (iter = getConnections ()->begin (); iter != getConnections ()->end (); iter++)
+		{
 			if ((*iter)->getSendAll ())
-				value->send (*iter);
+			{
+				(*iter)->sendValueFrame (frame);
+				scheduleSubscriptionFlush (*iter);
+			}
+		}
 		for (iter = getCentraldConns ()->begin (); iter != getCentraldConns ()->end (); iter++)
 			if ((*iter)->getSendAll ())
-				value->send (*iter);
+				(*iter)->sendValueFrame (frame);
 		value->resetNeedSend ();
 	}
 }
 
+void Daemon::scheduleSubscriptionFlush (Connection *conn)
+{
+	double t = conn->getPendingTime ();
+	if (std::isnan (t) || (!std::isnan (subscriptionFlushTime) && subscriptionFlushTime <= t))
+		return;
+	if (!std::isnan (subscriptionFlushTime))
+		deleteTimers (EVENT_SUBSCRIPTION_FLUSH);
+	subscriptionFlushTime = t;
+	addTimer (t - getNow (), new Event (EVENT_SUBSCRIPTION_FLUSH));
+}
+
+void Daemon::flushSubscriptions ()
+{
+	double now = getNow ();
+	for (connections_t::iterator iter = getConnections ()->begin (); iter != getConnections ()->end (); iter++)
+	{
+		std::vector <int> ids;
+		(*iter)->getPendingValues (now, ids);
+		if (!ids.empty ())
+		{
+			ValueFrame frame;
+			for (std::vector <int>::iterator id = ids.begin (); id != ids.end (); id++)
+			{
+				Value *val = getValueByFrameId (*id);
+				if (val)
+					frame.add (val, *id);
+			}
+			(*iter)->sendValueFrame (frame);
+		}
+		scheduleSubscriptionFlush (*iter);
+	}
+}
+
 void Daemon::sendProgressAll (double start, double end, Connection *except)
 {
 	connections_t::iterator iter;
@@ -0,0 +1,423 @@
+/*
+ * Lock-free POSIX shared memory ring buffer for camera frames.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "dataring.h"
+#include "app.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+// slot data are page aligned
+#define DATARING_ALIGN     4096
+
+using namespace rts2core;
+
+static size_t ringAlign (size_t s)
+{
+	return ((s + DATARING_ALIGN - 1) / DATARING_ALIGN) * DATARING_ALIGN;
+}
+
+static double ringNow ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/**
+ * Wait on futex word until its value differs from val.
+ *
+ * @return -1 on timeout, 0 otherwise
+ */
+static int ringWait (uint32_t *addr, uint32_t val, double timeout)
+{
+#ifdef __linux__
+	struct timespec ts;
+	struct timespec *pts = NULL;
+	if (timeout >= 0)
+	{
+		ts.tv_sec = floor (timeout);
+		ts.tv_nsec = (timeout - ts.tv_sec) * 1000000000;
+		pts = &ts;
+	}
+	// shared futex - readers and writer live in different processes
+	if (syscall (SYS_futex, addr, FUTEX_WAIT, val, pts, NULL, 0) == -1 && errno == ETIMEDOUT)
+		return -1;
+	return 0;
+#else
+	// no futex, poll every millisecond
+	double end = ringNow () + timeout;
+	while (__atomic_load_n (addr, __ATOMIC_ACQUIRE) == val)
+	{
+		if (timeout >= 0 && ringNow () > end)
+			return -1;
+		usleep (1000);
+	}
+	return 0;
+#endif
+}
+
+static void ringWake (uint32_t *addr)
+{
+#ifdef __linux__
+	syscall (SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+DataRing::DataRing ()
+{
+	header = NULL;
+	mapSize = 0;
+	fd = -1;
+}
+
+DataRing::~DataRing ()
+{
+	unmap ();
+}
+
+uint64_t DataRing::getWriteSeq ()
+{
+	return __atomic_load_n (&(header->writeSeq), __ATOMIC_ACQUIRE);
+}
+
+int DataRing::getReaders ()
+{
+	int ret = 0;
+	for (int i = 0; i < DATARING_MAX_READERS; i++)
+	{
+		if (__atomic_load_n (&(header->readers[i].client), __ATOMIC_ACQUIRE) != 0)
+			ret++;
+	}
+	return ret;
+}
+
+struct DataRingSlot *DataRing::getSlot (uint64_t seq)
+{
+	size_t slotStride = ringAlign (sizeof (struct DataRingSlot) + header->slotSize);
+	return (struct DataRingSlot *) (((char *) header) + ringAlign (sizeof (struct DataRingHeader)) + ((seq - 1) % header->nslots) * slotStride);
+}
+
+void DataRing::unmap ()
+{
+	if (header)
+		munmap (header, mapSize);
+	header = NULL;
+	if (fd >= 0)
+		close (fd);
+	fd = -1;
+}
+
+DataRingWrite::DataRingWrite ():DataRing ()
+{
+	current = NULL;
+	currentSeq = 0;
+}
+
+DataRingWrite::~DataRingWrite ()
+{
+	if (header)
+	{
+		unmap ();
+		shm_unlink (name.c_str ());
+	}
+}
+
+int DataRingWrite::create (const char *_name, int nslots, size_t chanSize, int channels)
+{
+	if (nslots <= 0 || channels <= 0)
+	{
+		logStream (MESSAGE_ERROR) << "invalid number of ring slots or channels: " << nslots << " " << channels << sendLog;
+		return -1;
+	}
+
+	name = std::string (_name);
+	// remove any ring left by crashed daemon
+	shm_unlink (_name);
+
+	fd = shm_open (_name, O_RDWR | O_CREAT | O_EXCL, 0666);
+	if (fd < 0)
+	{
+		logStream (MESSAGE_ERROR) << "cannot create shared memory ring " << _name << ": " << strerror (errno) << sendLog;
+		return -1;
+	}
+
+	size_t slotSize = chanSize * channels;
+	mapSize = ringAlign (sizeof (struct DataRingHeader)) + nslots * ringAlign (sizeof (struct DataRingSlot) + slotSize);
+
+	if (ftruncate (fd, mapSize))
+	{
+		logStream (MESSAGE_ERROR) << "cannot resize shared memory ring " << _name << " to " << mapSize << " bytes: " << strerror (errno) << sendLog;
+		close (fd);
+		fd = -1;
+		shm_unlink (_name);
+		return -1;
+	}
+
+	void *m = mmap (NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (m == MAP_FAILED)
+	{
+		logStream (MESSAGE_ERROR) << "cannot map shared memory ring " << _name << ": " << strerror (errno) << sendLog;
+		close (fd);
+		fd = -1;
+		shm_unlink (_name);
+		return -1;
+	}
+
+	header = (struct DataRingHeader *) m;
+	memset (header, 0, sizeof (struct DataRingHeader));
+	header->nslots = nslots;
+	header->slotSize = slotSize;
+	header->channels = channels;
+	for (int i = 1; i <= nslots; i++)
+		memset (getSlot (i), 0, sizeof (struct DataRingSlot));
+
+	__atomic_store_n (&(header->magic), DATARING_MAGIC, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+char *DataRingWrite::beginFrame ()
+{
+	currentSeq = header->writeSeq + 1;
+
+	// slot holds frame which will be overwritten
+	if (currentSeq > header->nslots)
+	{
+		uint64_t overwritten = currentSeq - header->nslots;
+		for (int i = 0; i < DATARING_MAX_READERS; i++)
+		{
+			struct DataRingReader *r = header->readers + i;
+			int32_t client = __atomic_load_n (&(r->client), __ATOMIC_ACQUIRE);
+			if (client == 0)
+				continue;
+			uint64_t c = __atomic_load_n (&(r->cursor), __ATOMIC_ACQUIRE);
+			while (c <= overwritten)
+			{
+				if (__atomic_load_n (&(r->critical), __ATOMIC_ACQUIRE))
+				{
+					// free entry of the reader which died without unregistering
+					if (kill (client, 0) && errno == ESRCH)
+					{
+						logStream (MESSAGE_WARNING) << "removing dead reader " << client << " from ring " << name << sendLog;
+						__atomic_store_n (&(r->client), 0, __ATOMIC_RELEASE);
+						break;
+					}
+					current = NULL;
+					return NULL;
+				}
+				// drop oldest frames, move reader to the oldest frame which will stay in the ring
+				if (__atomic_compare_exchange_n (&(r->cursor), &c, overwritten + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				{
+					__atomic_fetch_add (&(r->dropped), overwritten + 1 - c, __ATOMIC_RELAXED);
+					break;
+				}
+			}
+		}
+	}
+
+	current = getSlot (currentSeq);
+	// invalidate slot, so readers processing the old frame will find it was overwritten
+	__atomic_store_n (&(current->seq), 0, __ATOMIC_RELEASE);
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+	return getSlotData (current);
+}
+
+void DataRingWrite::publishFrame (size_t size)
+{
+	if (current == NULL)
+		return;
+
+	current->size = size;
+	current->timestamp = ringNow ();
+
+	__atomic_store_n (&(current->seq), currentSeq, __ATOMIC_RELEASE);
+	__atomic_store_n (&(header->writeSeq), currentSeq, __ATOMIC_RELEASE);
+	__atomic_fetch_add (&(header->futex), 1, __ATOMIC_RELEASE);
+
+	if (getReaders () > 0)
+		ringWake (&(header->futex));
+
+	current = NULL;
+}
+
+uint64_t DataRingWrite::getDropped ()
+{
+	uint64_t ret = 0;
+	for (int i = 0; i < DATARING_MAX_READERS; i++)
+	{
+		if (__atomic_load_n (&(header->readers[i].client), __ATOMIC_ACQUIRE) != 0)
+			ret += __atomic_load_n (&(header->readers[i].dropped), __ATOMIC_RELAXED);
+	}
+	return ret;
+}
+
+DataRingRead::DataRingRead ():DataRing ()
+{
+	reader = -1;
+	frameSeq = 0;
+	frameSize = 0;
+	frameTime = NAN;
+}
+
+DataRingRead::~DataRingRead ()
+{
+	if (header && reader >= 0)
+		__atomic_store_n (&(getReader ()->client), 0, __ATOMIC_RELEASE);
+}
+
+int DataRingRead::attach (const char *_name, bool critical)
+{
+	name = std::string (_name);
+
+	fd = shm_open (_name, O_RDWR, 0);
+	if (fd < 0)
+	{
+		logStream (MESSAGE_ERROR) << "cannot open shared memory ring " << _name << ": " << strerror (errno) << sendLog;
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat (fd, &st) || (size_t) st.st_size < sizeof (struct DataRingHeader))
+	{
+		logStream (MESSAGE_ERROR) << "invalid size of shared memory ring " << _name << sendLog;
+		unmap ();
+		return -1;
+	}
+
+	mapSize = st.st_size;
+	void *m = mmap (NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (m == MAP_FAILED)
+	{
+		logStream (MESSAGE_ERROR) << "cannot map shared memory ring " << _name << ": " << strerror (errno) << sendLog;
+		unmap ();
+		return -1;
+	}
+	header = (struct DataRingHeader *) m;
+
+	if (__atomic_load_n (&(header->magic), __ATOMIC_ACQUIRE) != DATARING_MAGIC)
+	{
+		logStream (MESSAGE_ERROR) << "shared memory " << _name << " is not a data ring" << sendLog;
+		unmap ();
+		return -1;
+	}
+
+	int32_t pid = getpid ();
+	for (int i = 0; i < DATARING_MAX_READERS; i++)
+	{
+		int32_t empty = 0;
+		if (__atomic_compare_exchange_n (&(header->readers[i].client), &empty, pid, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		{
+			reader = i;
+			struct DataRingReader *r = getReader ();
+			__atomic_store_n (&(r->dropped), 0, __ATOMIC_RELAXED);
+			__atomic_store_n (&(r->cursor), getWriteSeq () + 1, __ATOMIC_RELEASE);
+			__atomic_store_n (&(r->critical), critical ? 1 : 0, __ATOMIC_RELEASE);
+			return 0;
+		}
+	}
+
+	logStream (MESSAGE_ERROR) << "all " << DATARING_MAX_READERS << " readers of ring " << _name << " are in use" << sendLog;
+	unmap ();
+	return -1;
+}
+
+char *DataRingRead::waitFrame (double timeout)
+{
+	struct DataRingReader *r = getReader ();
+	double end = ringNow () + timeout;
+
+	while (true)
+	{
+		uint32_t fw = __atomic_load_n (&(header->futex), __ATOMIC_ACQUIRE);
+		uint64_t c = __atomic_load_n (&(r->cursor), __ATOMIC_ACQUIRE);
+		uint64_t w = getWriteSeq ();
+
+		if (c <= w)
+		{
+			struct DataRingSlot *slot = getSlot (c);
+			uint64_t s = __atomic_load_n (&(slot->seq), __ATOMIC_ACQUIRE);
+			if (s == c)
+			{
+				frameSeq = c;
+				frameSize = slot->size;
+				frameTime = slot->timestamp;
+				return getSlotData (slot);
+			}
+			// frame was overwritten before we get to it, skip it
+			if (__atomic_compare_exchange_n (&(r->cursor), &c, c + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				__atomic_fetch_add (&(r->dropped), 1, __ATOMIC_RELAXED);
+			continue;
+		}
+
+		double rest = -1;
+		if (timeout >= 0)
+		{
+			rest = end - ringNow ();
+			if (rest <= 0)
+				return NULL;
+		}
+		ringWait (&(header->futex), fw, rest);
+	}
+}
+
+char *DataRingRead::latestFrame (double timeout)
+{
+	struct DataRingReader *r = getReader ();
+	uint64_t w = getWriteSeq ();
+	uint64_t c = __atomic_load_n (&(r->cursor), __ATOMIC_ACQUIRE);
+	// frames were skipped on purpose, they are not counted as dropped
+	if (c < w)
+		__atomic_compare_exchange_n (&(r->cursor), &c, w, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+	return waitFrame (timeout);
+}
+
+int DataRingRead::releaseFrame ()
+{
+	struct DataRingSlot *slot = getSlot (frameSeq);
+	// make sure all data reads are finished before the slot sequence is checked
+	__atomic_thread_fence (__ATOMIC_ACQUIRE);
+	bool valid = __atomic_load_n (&(slot->seq), __ATOMIC_ACQUIRE) == frameSeq;
+
+	uint64_t c = frameSeq;
+	// cursor is moved by writer if reader was too slow
+	if (!__atomic_compare_exchange_n (&(getReader ()->cursor), &c, frameSeq + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		valid = false;
+
+	return valid ? 0 : -1;
+}
+
+uint64_t DataRingRead::getDropped ()
+{
+	return __atomic_load_n (&(getReader ()->dropped), __ATOMIC_RELAXED);
+}
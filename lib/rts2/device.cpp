@@ -532,6 +532,44 @@ int Device::commandAuthorized (Connection * conn)
 	{
 		return baseInfo (conn);
 	}
+	else if (conn->isCommand (COMMAND_BINARY_VALUES))
+	{
+		int version;
+		if (conn->paramNextInteger (&version) || !conn->paramEnd ())
+			return -2;
+		if (version != BINARY_VALUES_VERSION)
+		{
+			conn->sendCommandEnd (DEVDEM_E_PARAMSVAL, "unsupported version of binary frames");
+			return -1;
+		}
+		conn->setBinaryValues (true);
+		return 0;
+	}
+	else if (conn->isCommand (COMMAND_SUBSCRIBE))
+	{
+		double interval;
+		if (conn->paramNextDouble (&interval) || interval < 0)
+			return -2;
+		ValueSubscription *subscription = new ValueSubscription (interval);
+		while (!conn->paramEnd ())
+		{
+			char *pattern;
+			if (conn->paramNextString (&pattern))
+			{
+				delete subscription;
+				return -2;
+			}
+			subscription->addPattern (pattern);
+		}
+		// no patterns and no rate limit - send everything
+		if (subscription->getPatterns ().empty () && interval == 0)
+		{
+			delete subscription;
+			subscription = NULL;
+		}
+		conn->setSubscription (subscription);
+		return 0;
+	}
 	else if (conn->isCommand ("killall"))
 	{
 		return killAll (true);
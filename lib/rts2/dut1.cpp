@@ -18,6 +18,8 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <math.h>
+#include <algorithm>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -72,31 +74,176 @@ failed:
 
 double getDUT1 (const char *fn, struct tm *gmdate)
 {
+	// table is kept between calls, file is parsed again only when it changes
+	static rts2core::EOPTable table;
+
+	if (table.reload (fn) < 0)
+		return NAN;
+
+	struct tm t = *gmdate;
+	t.tm_hour = t.tm_min = t.tm_sec = 0;
+	return table.getDUT1 (timegm (&t) / 86400.0 + 2440587.5);
+}
+
+using namespace rts2core;
+
+/**
+ * Parse fixed width field of finals2000A line.
+ *
+ * @param line  line
+ * @param len   line length
+ * @param pos   field start (0 based)
+ * @param w     field width
+ *
+ * @return field value, NAN if field is empty
+ */
+static double parseField (const char *line, size_t len, size_t pos, size_t w)
+{
+	char buf[20];
+	if (pos + w > len || w >= sizeof (buf))
+		return NAN;
+	memcpy (buf, line + pos, w);
+	buf[w] = '\0';
+	char *endp;
+	double ret = strtod (buf, &endp);
+	if (endp == buf)
+		return NAN;
+	return ret;
+}
+
+EOPTable::EOPTable ()
+{
+	clear ();
+}
+
+void EOPTable::clear ()
+{
+	entries.clear ();
+	filename = "";
+	fileDev = 0;
+	fileIno = 0;
+	fileSize = -1;
+	fileMtime.tv_sec = 0;
+	fileMtime.tv_nsec = 0;
+}
+
+int EOPTable::load (const char *fn)
+{
+	clear ();
+
 	FILE *f = fopen (fn, "r");
 	if (f == NULL)
 	{
 		logStream (MESSAGE_ERROR) << "cannot open DUT file " << fn << ", error:" << strerror (errno) << sendLog;
-		return NAN;
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat (fileno (f), &st))
+	{
+		logStream (MESSAGE_ERROR) << "cannot stat DUT file " << fn << ", error:" << strerror (errno) << sendLog;
+		fclose (f);
+		return -1;
 	}
 
 	char *line = NULL;
 	size_t n = 0;
+	ssize_t len;
 
-	char datepart[7];
-	snprintf (datepart, 7, "%2d%2d%2d", gmdate->tm_year - 100, gmdate->tm_mon + 1, gmdate->tm_mday);
-
-	while (getline (&line, &n, f) >= 0)
+	while ((len = getline (&line, &n, f)) >= 0)
 	{
-		if (n > 60 && strncmp (line, datepart, 6) == 0)
+		// MJD in columns 8-15, UT1 - UTC in 59-68, polar motion X in 19-27 and Y in 38-46
+		EOPEntry e;
+		e.mjd = parseField (line, len, 7, 8);
+		e.dut1 = parseField (line, len, 58, 10);
+		// end of predictions
+		if (std::isnan (e.mjd) || std::isnan (e.dut1))
+			break;
+		e.xp = parseField (line, len, 18, 9);
+		e.yp = parseField (line, len, 37, 9);
+		if (!entries.empty () && e.mjd <= entries.back ().mjd)
 		{
-			double dut1 = atof (line + 59);
+			logStream (MESSAGE_ERROR) << "DUT file " << fn << " is not sorted, MJD " << e.mjd << sendLog;
 			free (line);
 			fclose (f);
-			return dut1;
+			clear ();
+			return -1;
 		}
+		entries.push_back (e);
 	}
 	free (line);
 	fclose (f);
 
-	return NAN;
+	filename = fn;
+	fileDev = st.st_dev;
+	fileIno = st.st_ino;
+	fileSize = st.st_size;
+	fileMtime = st.st_mtim;
+
+	return entries.size ();
+}
+
+int EOPTable::reload (const char *fn)
+{
+	struct stat st;
+	if (stat (fn, &st))
+	{
+		if (fileSize != -2)
+			logStream (MESSAGE_ERROR) << "cannot stat DUT file " << fn << ", error:" << strerror (errno) << sendLog;
+		clear ();
+		// do not repeat error message
+		fileSize = -2;
+		return -1;
+	}
+	if (filename == fn && fileDev == st.st_dev && fileIno == st.st_ino && fileSize == st.st_size && fileMtime.tv_sec == st.st_mtim.tv_sec && fileMtime.tv_nsec == st.st_mtim.tv_nsec)
+		return 0;
+	return load (fn) < 0 ? -1 : 1;
+}
+
+ssize_t EOPTable::findEntry (double mjd)
+{
+	if (entries.empty () || !(mjd >= entries.front ().mjd) || mjd > entries.back ().mjd)
+		return -1;
+	// table has usually one entry per day
+	ssize_t i = (ssize_t) (mjd - entries.front ().mjd);
+	if (i >= (ssize_t) entries.size () || entries[i].mjd > mjd || (i + 1 < (ssize_t) entries.size () && entries[i + 1].mjd <= mjd))
+	{
+		std::vector <EOPEntry>::iterator iter = std::upper_bound (entries.begin (), entries.end (), mjd, [] (double m, const EOPEntry &e) { return m < e.mjd; });
+		i = (iter - entries.begin ()) - 1;
+	}
+	return i;
+}
+
+bool EOPTable::getEOP (double JD, double &dut1, double &xp, double &yp)
+{
+	double mjd = JD - 2400000.5;
+	ssize_t i = findEntry (mjd);
+	if (i < 0)
+	{
+		dut1 = xp = yp = NAN;
+		return false;
+	}
+	EOPEntry &e0 = entries[i];
+	if (i + 1 == (ssize_t) entries.size ())
+	{
+		dut1 = e0.dut1;
+		xp = e0.xp;
+		yp = e0.yp;
+		return true;
+	}
+	EOPEntry &e1 = entries[i + 1];
+	double f = (mjd - e0.mjd) / (e1.mjd - e0.mjd);
+	// leap second is inserted at the end of the day, remove the jump from interpolation
+	double d1 = e1.dut1 - round (e1.dut1 - e0.dut1);
+	dut1 = e0.dut1 + f * (d1 - e0.dut1);
+	xp = e0.xp + f * (e1.xp - e0.xp);
+	yp = e0.yp + f * (e1.yp - e0.yp);
+	return true;
+}
+
+double EOPTable::getDUT1 (double JD)
+{
+	double dut1, xp, yp;
+	getEOP (JD, dut1, xp, yp);
+	return dut1;
 }
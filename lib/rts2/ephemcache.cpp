@@ -0,0 +1,311 @@
+/*
+ * Tabulated Sun, Moon and planets ephemeris.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "ephemcache.h"
+#include "configuration.h"
+#include "app.h"
+
+#include <libnova/libnova.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+
+// values stored for each entry
+#define EPHEM_VALUES   4
+
+using namespace rts2core;
+
+typedef void (*equ_func_t) (double, struct ln_equ_posn *);
+
+static equ_func_t ephemFuncs[EPHEM_BODIES] =
+{
+	ln_get_solar_equ_coords,
+	ln_get_mercury_equ_coords,
+	ln_get_venus_equ_coords,
+	ln_get_lunar_equ_coords,
+	ln_get_mars_equ_coords,
+	ln_get_jupiter_equ_coords,
+	ln_get_saturn_equ_coords,
+	ln_get_uranus_equ_coords,
+	ln_get_neptune_equ_coords,
+	ln_get_pluto_equ_coords
+};
+
+EphemerisCache::EphemerisCache (double _step, double _length)
+{
+	step = _step / 86400.0;
+	length = _length;
+
+	observer.lng = 0;
+	observer.lat = 0;
+
+	table = NULL;
+	entries = NULL;
+	fd = -1;
+	size = (size_t) ceil (length / step) + 1;
+	mapSize = sizeof (struct EphemerisTable) + EPHEM_BODIES * size * EPHEM_VALUES * sizeof (double);
+
+	recalculations = 0;
+
+	allocPrivate ();
+}
+
+EphemerisCache::~EphemerisCache ()
+{
+	if (fd >= 0)
+	{
+		munmap (table, mapSize);
+		close (fd);
+	}
+	else
+	{
+		delete[] (char *) table;
+	}
+}
+
+EphemerisCache *EphemerisCache::instance ()
+{
+	static EphemerisCache *pInstance = NULL;
+	if (pInstance == NULL)
+	{
+		pInstance = new EphemerisCache ();
+		pInstance->setObserver (Configuration::instance ()->getObserver ());
+		std::string shm;
+		Configuration::instance ()->getString ("observatory", "ephemeris_shm", shm, "");
+		if (!shm.empty ())
+			pInstance->attachShared (shm.c_str ());
+	}
+	return pInstance;
+}
+
+void EphemerisCache::setObserver (struct ln_lnlat_posn *_observer)
+{
+	observer.lng = _observer->lng;
+	observer.lat = _observer->lat;
+}
+
+int EphemerisCache::attachShared (const char *_name)
+{
+	int sfd = shm_open (_name, O_RDWR | O_CREAT, 0666);
+	if (sfd < 0)
+	{
+		logStream (MESSAGE_ERROR) << "cannot open shared ephemeris " << _name << ": " << strerror (errno) << sendLog;
+		return -1;
+	}
+
+	struct stat sb;
+	if (fstat (sfd, &sb))
+	{
+		logStream (MESSAGE_ERROR) << "cannot stat shared ephemeris " << _name << ": " << strerror (errno) << sendLog;
+		close (sfd);
+		return -1;
+	}
+
+	// new segment is zero filled, table will be initialized on first update
+	if (sb.st_size == 0 && ftruncate (sfd, mapSize))
+	{
+		logStream (MESSAGE_ERROR) << "cannot resize shared ephemeris " << _name << " to " << mapSize << " bytes: " << strerror (errno) << sendLog;
+		close (sfd);
+		return -1;
+	}
+	else if (sb.st_size != 0 && (size_t) sb.st_size != mapSize)
+	{
+		logStream (MESSAGE_ERROR) << "shared ephemeris " << _name << " has size " << sb.st_size << ", expected " << mapSize << "; different table step or length?" << sendLog;
+		close (sfd);
+		return -1;
+	}
+
+	void *m = mmap (NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, sfd, 0);
+	if (m == MAP_FAILED)
+	{
+		logStream (MESSAGE_ERROR) << "cannot map shared ephemeris " << _name << ": " << strerror (errno) << sendLog;
+		close (sfd);
+		return -1;
+	}
+
+	delete[] (char *) table;
+
+	name = std::string (_name);
+	fd = sfd;
+	table = (struct EphemerisTable *) m;
+	entries = (double *) (table + 1);
+
+	return 0;
+}
+
+void EphemerisCache::prepare (double JD, uint32_t bodies)
+{
+	for (int b = 0; b < EPHEM_BODIES; b++)
+	{
+		if ((bodies & (1 << b)) && !covers ((ephem_body_t) b, JD))
+			tabulate ((ephem_body_t) b, JD);
+	}
+}
+
+void EphemerisCache::getEquCoords (ephem_body_t body, double JD, struct ln_equ_posn *pos)
+{
+	double v[EPHEM_VALUES];
+	interpolate (body, JD, v);
+	pos->ra = ln_range_degrees (v[0]);
+	pos->dec = v[1];
+}
+
+double EphemerisCache::getAltitude (ephem_body_t body, double JD)
+{
+	double v[EPHEM_VALUES];
+	interpolate (body, JD, v);
+	return v[2];
+}
+
+double EphemerisCache::getLunarPhase (double JD)
+{
+	double v[EPHEM_VALUES];
+	interpolate (EPHEM_MOON, JD, v);
+	return v[3];
+}
+
+void EphemerisCache::allocPrivate ()
+{
+	char *m = new char[mapSize];
+	memset (m, 0, mapSize);
+	table = (struct EphemerisTable *) m;
+	entries = (double *) (table + 1);
+}
+
+bool EphemerisCache::covers (ephem_body_t body, double JD)
+{
+	return table->magic == EPHEM_MAGIC
+		&& (table->bodies & (1 << body))
+		&& table->lng == observer.lng && table->lat == observer.lat
+		&& table->step == step
+		&& JD >= table->start + step
+		&& JD <= table->start + (size - 3) * step;
+}
+
+void EphemerisCache::tabulate (ephem_body_t body, double JD)
+{
+	double start;
+	// keep table position, so other bodies stay valid
+	if (table->magic == EPHEM_MAGIC && table->lng == observer.lng && table->lat == observer.lat && table->step == step
+		&& JD >= table->start + step && JD <= table->start + (size - 3) * step)
+		start = table->start;
+	else
+		// start is aligned to step, so processes sharing the table agree on its position
+		start = floor ((JD - length / 4.0) / step) * step;
+
+	std::vector <double> vals (size * EPHEM_VALUES);
+	for (size_t i = 0; i < size; i++)
+	{
+		double j = start + i * step;
+		struct ln_equ_posn pos;
+		struct ln_hrz_posn hrz;
+		ephemFuncs[body] (j, &pos);
+		ln_get_hrz_from_equ (&pos, &observer, j, &hrz);
+
+		double *v = &(vals[i * EPHEM_VALUES]);
+		v[0] = pos.ra;
+		// keep RA continuous for interpolation
+		if (i > 0)
+		{
+			double pra = vals[(i - 1) * EPHEM_VALUES];
+			while (v[0] - pra > 180)
+				v[0] -= 360;
+			while (v[0] - pra < -180)
+				v[0] += 360;
+		}
+		v[1] = pos.dec;
+		v[2] = hrz.alt;
+		v[3] = body == EPHEM_MOON ? ln_get_lunar_phase (j) : 0;
+	}
+
+	// take the lock
+	uint32_t s;
+	while (true)
+	{
+		s = __atomic_load_n (&(table->seq), __ATOMIC_ACQUIRE);
+		if (!(s & 1) && __atomic_compare_exchange_n (&(table->seq), &s, s + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			break;
+		sched_yield ();
+	}
+
+	if (table->magic != EPHEM_MAGIC || table->start != start || table->lng != observer.lng || table->lat != observer.lat || table->step != step)
+	{
+		table->size = size;
+		table->lng = observer.lng;
+		table->lat = observer.lat;
+		table->step = step;
+		table->start = start;
+		table->bodies = 0;
+		table->magic = EPHEM_MAGIC;
+	}
+
+	memcpy (entries + body * size * EPHEM_VALUES, &(vals[0]), size * EPHEM_VALUES * sizeof (double));
+	table->bodies |= (1 << body);
+
+	__atomic_store_n (&(table->seq), s + 2, __ATOMIC_RELEASE);
+
+	recalculations++;
+}
+
+void EphemerisCache::interpolate (ephem_body_t body, double JD, double ret[EPHEM_VALUES])
+{
+	while (true)
+	{
+		uint32_t s = __atomic_load_n (&(table->seq), __ATOMIC_ACQUIRE);
+		if (s & 1)
+		{
+			sched_yield ();
+			continue;
+		}
+		if (!covers (body, JD))
+		{
+			tabulate (body, JD);
+			continue;
+		}
+
+		double x = (JD - table->start) / step;
+		// table was moved by other process
+		if (!(x >= 1 && x < size - 2))
+			continue;
+		size_t i = floor (x);
+		double t = x - i;
+
+		// Lagrange polynomial through entries i-1, i, i+1, i+2
+		double w[4];
+		w[0] = -t * (t - 1) * (t - 2) / 6.0;
+		w[1] = (t + 1) * (t - 1) * (t - 2) / 2.0;
+		w[2] = -(t + 1) * t * (t - 2) / 2.0;
+		w[3] = (t + 1) * t * (t - 1) / 6.0;
+
+		const double *e = entries + (body * size + i - 1) * EPHEM_VALUES;
+		for (int v = 0; v < EPHEM_VALUES; v++)
+			ret[v] = w[0] * e[v] + w[1] * e[v + EPHEM_VALUES] + w[2] * e[v + 2 * EPHEM_VALUES] + w[3] * e[v + 3 * EPHEM_VALUES];
+
+		__atomic_thread_fence (__ATOMIC_ACQUIRE);
+		if (__atomic_load_n (&(table->seq), __ATOMIC_ACQUIRE) == s)
+			return;
+	}
+}
@@ -0,0 +1,187 @@
+/*
+ * Timestamps of the exposure processing chain.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "exposuretrace.h"
+
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+
+using namespace rts2core;
+
+static double monotonicOffset = NAN;
+
+double rts2core::traceNow ()
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	double mono = ts.tv_sec + ts.tv_nsec / 1000000000.0;
+	// offset is calculated only once, so later changes of system time do not influence intervals
+	if (isnan (monotonicOffset))
+	{
+		struct timeval tv;
+		gettimeofday (&tv, NULL);
+		monotonicOffset = tv.tv_sec + tv.tv_usec / 1000000.0 - mono;
+	}
+	return mono + monotonicOffset;
+}
+
+void ExposureTrace::clear ()
+{
+	for (int i = 0; i < TRACE_STAGES; i++)
+		stamps[i] = NAN;
+}
+
+double ExposureTrace::interval (traceStage_t from, traceStage_t to)
+{
+	return stamps[to] - stamps[from];
+}
+
+const char *ExposureTrace::getStageName (traceStage_t stage)
+{
+	switch (stage)
+	{
+		case TRACE_EXPOSURE_START:
+			return "exposure start";
+		case TRACE_EXPOSURE_END:
+			return "exposure end";
+		case TRACE_READOUT_START:
+			return "readout start";
+		case TRACE_READOUT_END:
+			return "readout end";
+		case TRACE_TRANSFER_END:
+			return "transfer end";
+		case TRACE_DATA_START:
+			return "data start";
+		case TRACE_DATA_END:
+			return "data end";
+		case TRACE_FITS_WRITTEN:
+			return "FITS written";
+		case TRACE_IMAGE_SAVED:
+			return "image saved";
+		case TRACE_PROCESSED:
+			return "processed";
+		case TRACE_STAGES:
+			break;
+	}
+	return "unknown";
+}
+
+namespace rts2core
+{
+
+std::ostream & operator << (std::ostream & _os, ExposureTrace & trace)
+{
+	// print intervals from the first recorded stage
+	int last = -1;
+	std::ios_base::fmtflags old_settings = _os.flags ();
+	int old_precision = _os.precision (3);
+	_os.setf (std::ios_base::fixed, std::ios_base::floatfield);
+	for (int i = 0; i < TRACE_STAGES; i++)
+	{
+		if (isnan (trace.stamps[i]))
+			continue;
+		if (last >= 0)
+			_os << " " << ExposureTrace::getStageName ((traceStage_t) i) << " +" << (trace.stamps[i] - trace.stamps[last]);
+		else
+			_os << ExposureTrace::getStageName ((traceStage_t) i);
+		last = i;
+	}
+	_os.precision (old_precision);
+	_os.flags (old_settings);
+	return _os;
+}
+
+}
+
+void TraceHistogram::clear ()
+{
+	for (int i = 0; i < TRACE_HISTOGRAM_BINS; i++)
+		bins[i] = 0;
+	count = 0;
+	sum = 0;
+	max = NAN;
+}
+
+void TraceHistogram::add (double interval)
+{
+	if (isnan (interval) || interval < 0)
+		return;
+	int b = 0;
+	while (b < TRACE_HISTOGRAM_BINS - 1 && interval > getBinLimit (b))
+		b++;
+	bins[b]++;
+	count++;
+	sum += interval;
+	if (isnan (max) || interval > max)
+		max = interval;
+}
+
+double TraceHistogram::getPercentile (double p)
+{
+	if (count == 0)
+		return NAN;
+	double limit = count * p / 100.0;
+	unsigned int c = 0;
+	for (int b = 0; b < TRACE_HISTOGRAM_BINS; b++)
+	{
+		c += bins[b];
+		if (c >= limit && c > 0)
+			return getBinLimit (b);
+	}
+	return getBinLimit (TRACE_HISTOGRAM_BINS - 1);
+}
+
+double TraceHistogram::getBinLimit (int bin)
+{
+	if (bin >= TRACE_HISTOGRAM_BINS - 1)
+		return INFINITY;
+	return ldexp (0.001, bin);
+}
+
+namespace rts2core
+{
+
+std::ostream & operator << (std::ostream & _os, TraceHistogram & hist)
+{
+	if (hist.count == 0)
+	{
+		_os << "no data";
+		return _os;
+	}
+	std::ios_base::fmtflags old_settings = _os.flags ();
+	int old_precision = _os.precision (3);
+	_os.setf (std::ios_base::fixed, std::ios_base::floatfield);
+	_os << hist.count << " frames, mean " << hist.sum / hist.count << "s, max " << hist.max
+		<< "s, median <" << hist.getPercentile (50) << "s, 90% <" << hist.getPercentile (90) << "s;";
+	for (int b = 0; b < TRACE_HISTOGRAM_BINS; b++)
+	{
+		if (hist.bins[b] == 0)
+			continue;
+		if (b == TRACE_HISTOGRAM_BINS - 1)
+			_os << " >" << TraceHistogram::getBinLimit (b - 1) << "s:" << hist.bins[b];
+		else
+			_os << " <" << TraceHistogram::getBinLimit (b) << "s:" << hist.bins[b];
+	}
+	_os.precision (old_precision);
+	_os.flags (old_settings);
+	return _os;
+}
+
+}
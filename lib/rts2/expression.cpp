@@ -20,9 +20,36 @@
 #include "expression.h"
 
 #include <ctype.h>
+#include <math.h>
 
 using namespace rts2expression;
 
+double rts2expression::applyOp (op_t op, double v1, double v2)
+{
+	switch (op)
+	{
+		case OR:
+			return v1 || v2;
+		case AND:
+			return v1 && v2;
+		case XOR:
+			return (v1 != 0) xor (v2 != 0);
+		case EQU:
+			return v1 == v2;
+		case LT:
+			return v1 < v2;
+		case LEQU:
+			return v1 <= v2;
+		case GT:
+			return v1 > v2;
+		case GEQU:
+			return v1 >= v2;
+		case NEQ:
+			return v1 != v2;
+	}
+	throw rts2core::Error ("unknow operand");
+}
+
 Expression *Expression::add (op_t _op)
 {
 	return new ExpressionPair (this, _op, NULL);
@@ -54,23 +81,75 @@ double ExpressionPair::evaluate ()
 	throw rts2core::Error ("unknow operand");
 }
 
+void ExpressionPair::compile (CompiledExpression &ce)
+{
+	size_t s1 = ce.size ();
+	double v1, v2;
+	exp1->compile (ce);
+	if (op == OR || op == AND)
+	{
+		if (ce.getConst (s1, v1))
+		{
+			ce.truncate (s1);
+			// left side decides result
+			if ((op == OR) == (v1 != 0))
+			{
+				ce.emitConst (op == OR);
+				return;
+			}
+			exp2->compile (ce);
+			ce.emitBool (s1);
+			return;
+		}
+		size_t jump = ce.emitJump (op);
+		exp2->compile (ce);
+		// right side does not change left side result
+		if (ce.getConst (jump + 1, v2) && (op == OR) == (v2 == 0))
+		{
+			ce.truncate (jump);
+			ce.emitBool (s1);
+			return;
+		}
+		ce.emitBool (jump + 1);
+		ce.patchJump (jump);
+		return;
+	}
+	bool c1 = ce.getConst (s1, v1);
+	size_t s2 = ce.size ();
+	exp2->compile (ce);
+	if (c1 && ce.getConst (s2, v2))
+	{
+		ce.truncate (s1);
+		ce.emitConst (applyOp (op, v1, v2));
+		return;
+	}
+	ce.emitBinary (op);
+}
+
 Expression *ExpressionPair::add (op_t _op)
 {
-	if (_op < op)
+	if (_op <= op)
 		return new ExpressionPair (this, _op, NULL);
 	if (exp2 == NULL)
 		throw rts2core::Error ("missing value");
-	return exp2->add (_op);
+	exp2 = exp2->add (_op);
+	return this;
 }
 
 Expression *ExpressionPair::add (Expression *_exp)
 {
 	if (exp2 != NULL)
-		return exp2->add (_exp);
-	exp2 = _exp;
+		exp2 = exp2->add (_exp);
+	else
+		exp2 = _exp;
 	return this;
 }
 
+void ExpressionConst::compile (CompiledExpression &ce)
+{
+	ce.emitConst (val);
+}
+
 double ExpressionValue::evaluate ()
 {
 	rts2core::Value *val = ((rts2core::Block *)getMasterApp ())->getValue (deviceName.c_str (), valueName.c_str ());
@@ -79,6 +158,299 @@ double ExpressionValue::evaluate ()
 	throw ExpressionErrorValueMissing (deviceName.c_str (), valueName.c_str ());
 }
 
+void ExpressionValue::compile (CompiledExpression &ce)
+{
+	ce.emitValue (deviceName, valueName);
+}
+
+CompiledExpression::CompiledExpression (Expression *exp)
+{
+	compile (exp);
+}
+
+CompiledExpression::CompiledExpression (const char *str)
+{
+	Expression *exp = parseExpression (str);
+	try
+	{
+		compile (exp);
+	}
+	catch (rts2core::Error &er)
+	{
+		delete exp;
+		throw er;
+	}
+	delete exp;
+}
+
+void CompiledExpression::compile (Expression *exp)
+{
+	bound = false;
+	epoch = 0;
+	tracked = false;
+	dirty = true;
+	result = NAN;
+
+	exp->compile (*this);
+
+	// stack depth; jumps leave the same depth as the code they skip
+	int depth = 0;
+	int maxDepth = 0;
+	for (std::vector <Instruction>::iterator iter = code.begin (); iter != code.end (); iter++)
+	{
+		switch (iter->code)
+		{
+			case I_CONST:
+			case I_VALUE:
+				depth++;
+				break;
+			case I_BOOL:
+				break;
+			default:
+				depth--;
+		}
+		if (depth > maxDepth)
+			maxDepth = depth;
+	}
+	stack.resize (maxDepth);
+}
+
+double CompiledExpression::evaluate ()
+{
+	if (bound == false || epoch != rts2core::Connection::getValuesEpoch ())
+		bind ();
+	else if (tracked && !dirty)
+		return result;
+
+	double *st = &(stack[0]);
+	int sp = -1;
+	size_t len = code.size ();
+	for (size_t pc = 0; pc < len; pc++)
+	{
+		Instruction &in = code[pc];
+		switch (in.code)
+		{
+			case I_CONST:
+				st[++sp] = in.val;
+				break;
+			case I_VALUE:
+				{
+					Input &inp = inputs[in.arg];
+					if (inp.val == NULL)
+						throw ExpressionErrorValueMissing (inp.device.c_str (), inp.value.c_str ());
+					st[++sp] = inp.val->getValueDouble ();
+				}
+				break;
+			case I_JUMP_TRUE:
+				if (st[sp])
+				{
+					st[sp] = 1;
+					pc = in.arg - 1;
+				}
+				else
+				{
+					sp--;
+				}
+				break;
+			case I_JUMP_FALSE:
+				if (st[sp])
+				{
+					sp--;
+				}
+				else
+				{
+					st[sp] = 0;
+					pc = in.arg - 1;
+				}
+				break;
+			case I_BOOL:
+				st[sp] = st[sp] != 0;
+				break;
+			case XOR:
+				sp--;
+				st[sp] = (st[sp] != 0) xor (st[sp + 1] != 0);
+				break;
+			case EQU:
+				sp--;
+				st[sp] = st[sp] == st[sp + 1];
+				break;
+			case LT:
+				sp--;
+				st[sp] = st[sp] < st[sp + 1];
+				break;
+			case LEQU:
+				sp--;
+				st[sp] = st[sp] <= st[sp + 1];
+				break;
+			case GT:
+				sp--;
+				st[sp] = st[sp] > st[sp + 1];
+				break;
+			case GEQU:
+				sp--;
+				st[sp] = st[sp] >= st[sp + 1];
+				break;
+			case NEQ:
+				sp--;
+				st[sp] = st[sp] != st[sp + 1];
+				break;
+			default:
+				throw rts2core::Error ("invalid instruction");
+		}
+	}
+	result = st[0];
+	dirty = false;
+	return result;
+}
+
+void CompiledExpression::bind ()
+{
+	rts2core::Block *master = (rts2core::Block *) getMasterApp ();
+	for (std::vector <Input>::iterator iter = inputs.begin (); iter != inputs.end (); iter++)
+		iter->val = master ? master->getValue (iter->device.c_str (), iter->value.c_str ()) : NULL;
+	epoch = rts2core::Connection::getValuesEpoch ();
+	bound = true;
+	dirty = true;
+}
+
+bool CompiledExpression::getConst (size_t start, double &val)
+{
+	if (code.size () != start + 1 || code[start].code != I_CONST)
+		return false;
+	val = code[start].val;
+	return true;
+}
+
+void CompiledExpression::emitConst (double val)
+{
+	Instruction in;
+	in.code = I_CONST;
+	in.arg = 0;
+	in.val = val;
+	code.push_back (in);
+}
+
+void CompiledExpression::emitValue (const std::string &device, const std::string &value)
+{
+	Instruction in;
+	in.code = I_VALUE;
+	in.val = 0;
+	// the same value is read from the same input
+	for (in.arg = 0; in.arg < (int) inputs.size (); in.arg++)
+	{
+		if (inputs[in.arg].device == device && inputs[in.arg].value == value)
+			break;
+	}
+	if (in.arg == (int) inputs.size ())
+	{
+		Input inp;
+		inp.device = device;
+		inp.value = value;
+		inp.val = NULL;
+		inputs.push_back (inp);
+	}
+	code.push_back (in);
+}
+
+void CompiledExpression::emitBinary (op_t op)
+{
+	Instruction in;
+	in.code = op;
+	in.arg = 0;
+	in.val = 0;
+	code.push_back (in);
+}
+
+void CompiledExpression::emitBool (size_t start)
+{
+	double val;
+	if (getConst (start, val))
+	{
+		code.back ().val = val != 0;
+		return;
+	}
+	// already boolean
+	switch (code.back ().code)
+	{
+		case XOR:
+		case EQU:
+		case LT:
+		case LEQU:
+		case GT:
+		case GEQU:
+		case NEQ:
+		case I_BOOL:
+			return;
+	}
+	Instruction in;
+	in.code = I_BOOL;
+	in.arg = 0;
+	in.val = 0;
+	code.push_back (in);
+}
+
+size_t CompiledExpression::emitJump (op_t op)
+{
+	Instruction in;
+	in.code = op == OR ? I_JUMP_TRUE : I_JUMP_FALSE;
+	in.arg = 0;
+	in.val = 0;
+	code.push_back (in);
+	return code.size () - 1;
+}
+
+void ExpressionIndex::add (CompiledExpression *exp)
+{
+	exp->tracked = true;
+	exp->invalidate ();
+	expressions.push_back (exp);
+	indexed = false;
+}
+
+void ExpressionIndex::clear ()
+{
+	for (std::vector <CompiledExpression *>::iterator iter = expressions.begin (); iter != expressions.end (); iter++)
+		delete *iter;
+	expressions.clear ();
+	dependencies.clear ();
+	indexed = false;
+}
+
+void ExpressionIndex::valueChanged (rts2core::Value *val)
+{
+	if (indexed == false || epoch != rts2core::Connection::getValuesEpoch ())
+	{
+		reindex ();
+		return;
+	}
+	std::map <rts2core::Value *, std::vector <CompiledExpression *> >::iterator iter = dependencies.find (val);
+	if (iter == dependencies.end ())
+		return;
+	for (std::vector <CompiledExpression *>::iterator eiter = iter->second.begin (); eiter != iter->second.end (); eiter++)
+		(*eiter)->invalidate ();
+}
+
+void ExpressionIndex::reindex ()
+{
+	dependencies.clear ();
+	for (std::vector <CompiledExpression *>::iterator iter = expressions.begin (); iter != expressions.end (); iter++)
+	{
+		(*iter)->bind ();
+		for (std::vector <CompiledExpression::Input>::iterator iiter = (*iter)->inputs.begin (); iiter != (*iter)->inputs.end (); iiter++)
+		{
+			if (iiter->val)
+				dependencies[iiter->val].push_back (*iter);
+		}
+	}
+	epoch = rts2core::Connection::getValuesEpoch ();
+	indexed = true;
+}
+
+static bool isOperator (char c)
+{
+	return c == '=' || c == '>' || c == '<' || c == '!';
+}
+
 Expression * parseExpression (const char *str)
 {
 	Expression *new_exp = NULL;
@@ -91,7 +463,7 @@ Expression * parseExpression (const char *str)
 		else if (isalpha (str[i]))
 		{
 			int b = i;
-			for (; str[i] && !isspace (str[i]); i++);
+			for (; str[i] && !isspace (str[i]) && !isOperator (str[i]); i++);
 			// get string
 			char val[i - b + 1];
 			memcpy (val, str + b, i - b);
@@ -113,19 +485,25 @@ Expression * parseExpression (const char *str)
 			{
 				char *sep = strchr (val, '.');
 				if (sep == NULL)
+				{
+					delete new_exp;
+					delete root_exp;
 					throw rts2core::Error ("cannot find value separator (.)");
+				}
 				*sep = '\0';
 				sep++;
-				delete new_exp;
-				delete root_exp;
 				new_exp = new ExpressionValue (val, sep);
 			}
+			i--;
 		}
-		else if (isdigit (str[i]))
+		else if (isdigit (str[i]) || (str[i] == '-' && isdigit (str[i + 1])))
 		{
 			double v = 0;
 			long fraction = 0;
-			for (; str[i] && !isspace (str[i]); i++)
+			bool negative = str[i] == '-';
+			if (negative)
+				i++;
+			for (; str[i] && !isspace (str[i]) && !isOperator (str[i]); i++)
 			{
 				if (str[i] == '.')
 				{
@@ -137,7 +515,7 @@ Expression * parseExpression (const char *str)
 				{
 					if (fraction)
 					{
-						v += (str[i] - '0') / fraction;
+						v += (str[i] - '0') / (double) fraction;
 						fraction *= 10;
 					}
 					else
@@ -152,7 +530,8 @@ Expression * parseExpression (const char *str)
 					throw rts2core::Error ("number contains unallowed characters");
 				}
 			}
-			new_exp = new ExpressionConst (v);
+			new_exp = new ExpressionConst (negative ? -v : v);
+			i--;
 		}
 		else if (str[i] == '=' || str[i] == '>' || str[i] == '<' || str[i] == '!')
 		{
@@ -163,6 +542,7 @@ Expression * parseExpression (const char *str)
 			char val[i - b + 1];
 			memcpy (val, str + b, i - b);
 			val[i - b] = '\0';
+			i--;
 			if (!strcmp (val, "=="))
 			{
 				op = EQU;
@@ -194,9 +574,20 @@ Expression * parseExpression (const char *str)
 				throw rts2core::Error ("invalid operand");
 			}
 		}
+		else
+		{
+			delete new_exp;
+			delete root_exp;
+			throw rts2core::Error (std::string ("unexpected character ") + str[i]);
+		}
 
 		if (op != -1)
 		{
+			if (root_exp == NULL)
+			{
+				delete new_exp;
+				throw rts2core::Error ("missing left side");
+			}
 			root_exp = root_exp->add ((op_t) op);
 			op = -1;
 		}
@@ -222,7 +613,15 @@ Expression * parseExpression (const char *str)
 	}
 	if (root_exp)
 	{
-		root_exp->check ();
+		try
+		{
+			root_exp->check ();
+		}
+		catch (rts2core::Error &er)
+		{
+			delete root_exp;
+			throw er;
+		}
 		return root_exp;
 	}
 	throw rts2core::Error ("empty expression");
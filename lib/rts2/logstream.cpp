@@ -19,14 +19,225 @@
 
 #include "app.h"
 #include "logstream.h"
+#include "value.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <iomanip>
 #include <iostream>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+// maximal number of messages queued by other threads
+#define THREAD_LOG_MAX     10000
+// number of formatting buffers cached per thread
+#define LOG_BUFFER_CACHE   4
 
 using namespace rts2core;
 
+uint32_t rts2core::logLevels = MESSAGE_MASK_ALL;
+
+namespace
+{
+
+/**
+ * Formatting buffers cached for reuse by the thread.
+ */
+struct LogBufferCache
+{
+	std::ostringstream *buffers[LOG_BUFFER_CACHE];
+	int num;
+
+	~LogBufferCache ()
+	{
+		for (int i = 0; i < num; i++)
+			delete buffers[i];
+		// streams destroyed later during thread exit will not cache their buffers
+		num = -1;
+	}
+};
+
+thread_local LogBufferCache logBuffers;
+
+/**
+ * Message logged by other thread, waiting to be send by the main thread.
+ */
+struct ThreadLogEntry
+{
+	App *master;
+	messageType_t type;
+	std::string text;
+	bool endl;
+	ThreadLogEntry *next;
+};
+
+// lock-free stack of messages from other threads, newest first
+ThreadLogEntry *threadLogHead = NULL;
+int threadLogQueued = 0;
+int threadLogDropped = 0;
+int threadLogPipe[2] = {-1, -1};
+pthread_t threadLogMain;
+
+void queueThreadLog (App *master, messageType_t type, const std::string &text, bool endl)
+{
+	if (__atomic_add_fetch (&threadLogQueued, 1, __ATOMIC_RELAXED) > THREAD_LOG_MAX)
+	{
+		__atomic_sub_fetch (&threadLogQueued, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch (&threadLogDropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	ThreadLogEntry *e = new ThreadLogEntry;
+	e->master = master;
+	e->type = type;
+	e->text = text;
+	e->endl = endl;
+	e->next = __atomic_load_n (&threadLogHead, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n (&threadLogHead, &(e->next), e, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		;
+	// wake up main thread only when the first message is queued
+	if (e->next == NULL)
+	{
+		char c = 0;
+		if (write (threadLogPipe[1], &c, 1) < 0 && errno != EAGAIN)
+			std::cerr << "cannot wake up main thread: " << strerror (errno) << std::endl;
+	}
+}
+
+}
+
+void rts2core::setLogLevels (uint32_t levels)
+{
+	__atomic_store_n (&logLevels, levels, __ATOMIC_RELAXED);
+}
+
+int rts2core::parseLogLevels (const char *levels)
+{
+	int ret = 0;
+	for (const char *c = levels; *c; c++)
+	{
+		switch (*c)
+		{
+			case 'e':
+				ret |= MESSAGE_ERROR;
+				break;
+			case 'w':
+				ret |= MESSAGE_WARNING;
+				break;
+			case 'i':
+				ret |= MESSAGE_INFO;
+				break;
+			case 'd':
+				ret |= MESSAGE_DEBUG;
+				break;
+			case 'c':
+				ret |= MESSAGE_CRITICAL;
+				break;
+			default:
+				return -1;
+		}
+	}
+	return ret;
+}
+
+int rts2core::initThreadLogs ()
+{
+	if (threadLogPipe[0] >= 0)
+		return threadLogPipe[0];
+	if (pipe (threadLogPipe))
+	{
+		std::cerr << "cannot create pipe for thread logs: " << strerror (errno) << std::endl;
+		return -1;
+	}
+	fcntl (threadLogPipe[0], F_SETFL, O_NONBLOCK);
+	fcntl (threadLogPipe[1], F_SETFL, O_NONBLOCK);
+	threadLogMain = pthread_self ();
+	return threadLogPipe[0];
+}
+
+void rts2core::sendThreadLogs ()
+{
+	if (threadLogPipe[0] < 0)
+		return;
+
+	char buf[100];
+	while (read (threadLogPipe[0], buf, sizeof (buf)) > 0)
+		;
+
+	ThreadLogEntry *e = __atomic_exchange_n (&threadLogHead, (ThreadLogEntry *) NULL, __ATOMIC_ACQUIRE);
+	// reverse to send messages in order they were logged
+	ThreadLogEntry *ordered = NULL;
+	while (e)
+	{
+		ThreadLogEntry *next = e->next;
+		e->next = ordered;
+		ordered = e;
+		e = next;
+	}
+
+	int n = 0;
+	while (ordered)
+	{
+		if (ordered->endl)
+			ordered->master->sendMessage (ordered->type, ordered->text.c_str ());
+		else
+			ordered->master->sendMessageNoEndl (ordered->type, ordered->text.c_str ());
+		e = ordered->next;
+		delete ordered;
+		ordered = e;
+		n++;
+	}
+	__atomic_sub_fetch (&threadLogQueued, n, __ATOMIC_RELAXED);
+
+	int d = __atomic_exchange_n (&threadLogDropped, 0, __ATOMIC_RELAXED);
+	if (d > 0)
+		logStream (MESSAGE_WARNING) << "too many messages logged from threads, " << d << " messages were dropped" << sendLog;
+}
+
+std::ostringstream *LogStream::acquireBuffer ()
+{
+	std::ostringstream *ret;
+	if (logBuffers.num > 0)
+	{
+		ret = logBuffers.buffers[--logBuffers.num];
+	}
+	else
+	{
+		ret = new std::ostringstream ();
+	}
+	ret->flags (std::ios_base::dec | std::ios_base::skipws | std::ios_base::fixed);
+	ret->precision (6);
+	return ret;
+}
+
+void LogStream::releaseBuffer (std::ostringstream *buf)
+{
+	if (logBuffers.num >= 0 && logBuffers.num < LOG_BUFFER_CACHE)
+	{
+		buf->str ("");
+		buf->clear ();
+		buf->fill (' ');
+		buf->width (0);
+		logBuffers.buffers[logBuffers.num++] = buf;
+	}
+	else
+	{
+		delete buf;
+	}
+}
+
+LogStream & LogStream::operator << (const LogValueField &f)
+{
+	if (ls)
+		*ls << ' ' << f.value->getName () << '=' << f.value->getDisplayValue ();
+	return *this;
+}
+
 void LogStream::logArr (const char *arr, int len)
 {
+	if (ls == NULL)
+		return;
 	bool lastIsHex = false;
 	for (int i = 0; i < len; i++)
 	{
@@ -48,6 +259,8 @@ void LogStream::logArr (const char *arr, int len)
 
 void LogStream::logArrAsHex (const char *arr, int len)
 {
+	if (ls == NULL)
+		return;
 	for (int i = 0; i < len; i++)
 	{
 		int b = arr[i];
@@ -55,20 +268,39 @@ void LogStream::logArrAsHex (const char *arr, int len)
 	}
 }
 
-void LogStream::sendLog ()
+void LogStream::send (bool endl)
 {
+	if (ls == NULL)
+		return;
+	// messages from other threads are sent by the main thread
+	if (threadLogPipe[1] >= 0 && masterApp != NULL && !pthread_equal (pthread_self (), threadLogMain))
+	{
+		queueThreadLog (masterApp, messageType, ls->str (), endl);
+		return;
+	}
 	if (masterApp != NULL)
-		masterApp->sendMessage (messageType, ls.str ().c_str ());
+	{
+		if (endl)
+			masterApp->sendMessage (messageType, ls->str ().c_str ());
+		else
+			masterApp->sendMessageNoEndl (messageType, ls->str ().c_str ());
+	}
 	else
-		std::cerr << "log " << ls.str () << std::endl;
+	{
+		std::cerr << "log " << ls->str ();
+		if (endl)
+			std::cerr << std::endl;
+	}
+}
+
+void LogStream::sendLog ()
+{
+	send (true);
 }
 
 void LogStream::sendLogNoEndl ()
 {
-	if (masterApp != NULL)
-		masterApp->sendMessageNoEndl (messageType, ls.str ().c_str ());
-	else
-		std::cerr << "log " << ls.str ();
+	send (false);
 }
 
 LogStream & sendLog (LogStream & _ls)
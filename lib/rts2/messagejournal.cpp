@@ -0,0 +1,399 @@
+/*
+ * Binary ring journal of system messages.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "messagejournal.h"
+#include "app.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace rts2core;
+
+int rts2core::messageJournalLevel (int type)
+{
+	if (type & MESSAGE_ERROR)
+		return 0;
+	if (type & MESSAGE_WARNING)
+		return 1;
+	if (type & MESSAGE_INFO)
+		return 2;
+	if (type & MESSAGE_DEBUG)
+		return 3;
+	if (type & MESSAGE_CRITICAL)
+		return 4;
+	return 5;
+}
+
+// type mask selecting given level
+static bool levelSelected (int level, int typeMask)
+{
+	static const int levelMask[MESSAGE_JOURNAL_LEVELS] = {MESSAGE_ERROR, MESSAGE_WARNING, MESSAGE_INFO, MESSAGE_DEBUG, MESSAGE_CRITICAL, ~MESSAGE_LEVEL_MASK};
+	return (levelMask[level] & typeMask) != 0;
+}
+
+static bool onameEqual (const char *oname, const char *device)
+{
+	return strncmp (oname, device, MESSAGE_JOURNAL_ONAME - 1) == 0;
+}
+
+MessageJournal::MessageJournal ()
+{
+	header = NULL;
+	mapSize = 0;
+	records = 0;
+	fileDev = 0;
+	fileIno = 0;
+	writer = false;
+	lastITime = 0;
+}
+
+MessageJournal::~MessageJournal ()
+{
+	close ();
+}
+
+int MessageJournal::create (const char *_path, uint32_t nrecords)
+{
+	close ();
+	if (nrecords == 0)
+		return -1;
+
+	size_t expected = sizeof (struct MessageJournalHeader) + (size_t) nrecords * sizeof (struct MessageJournalRecord);
+
+	// continue where previous writer ended
+	int fd = ::open (_path, O_RDWR);
+	if (fd >= 0)
+	{
+		if (map (fd, true) == 0)
+		{
+			if (mapSize == expected && header->magic == MESSAGE_JOURNAL_MAGIC && header->nrecords == nrecords && header->recordSize == sizeof (struct MessageJournalRecord))
+			{
+				::close (fd);
+				records = nrecords;
+				lastITime = header->writeSeq > 0 ? getRecord (header->writeSeq)->itime : 0;
+				path = std::string (_path);
+				writer = true;
+				return 0;
+			}
+			close ();
+		}
+		::close (fd);
+	}
+
+	// readers can have the existing journal mapped, so it is never resized
+	// or rewritten. New journal is created and renamed over the old one.
+	std::string tmpPath = std::string (_path) + ".XXXXXX";
+	fd = mkstemp (&tmpPath[0]);
+	if (fd < 0)
+	{
+		logStream (MESSAGE_ERROR) << "cannot create message journal " << tmpPath << ": " << strerror (errno) << sendLog;
+		return -1;
+	}
+
+	if (fchmod (fd, 0644) || ftruncate (fd, expected))
+	{
+		logStream (MESSAGE_ERROR) << "cannot resize message journal " << tmpPath << ": " << strerror (errno) << sendLog;
+		::close (fd);
+		unlink (tmpPath.c_str ());
+		return -1;
+	}
+
+	int ret = map (fd, true);
+	::close (fd);
+	if (ret)
+	{
+		unlink (tmpPath.c_str ());
+		return -1;
+	}
+
+	// new file is filled with zeros
+	header->nrecords = nrecords;
+	header->recordSize = sizeof (struct MessageJournalRecord);
+	__atomic_store_n (&(header->magic), MESSAGE_JOURNAL_MAGIC, __ATOMIC_RELEASE);
+
+	if (rename (tmpPath.c_str (), _path))
+	{
+		logStream (MESSAGE_ERROR) << "cannot rename message journal " << tmpPath << " to " << _path << ": " << strerror (errno) << sendLog;
+		close ();
+		unlink (tmpPath.c_str ());
+		return -1;
+	}
+
+	records = nrecords;
+	lastITime = 0;
+	path = std::string (_path);
+	writer = true;
+	return 0;
+}
+
+int MessageJournal::open (const char *_path)
+{
+	close ();
+
+	int fd = ::open (_path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	int ret = map (fd, false);
+	::close (fd);
+	if (ret)
+		return -1;
+
+	if (__atomic_load_n (&(header->magic), __ATOMIC_ACQUIRE) != MESSAGE_JOURNAL_MAGIC
+		|| header->recordSize != sizeof (struct MessageJournalRecord)
+		|| header->nrecords == 0
+		|| mapSize < sizeof (struct MessageJournalHeader) + (size_t) header->nrecords * sizeof (struct MessageJournalRecord))
+	{
+		logStream (MESSAGE_ERROR) << "invalid message journal " << _path << sendLog;
+		close ();
+		return -1;
+	}
+
+	// records are always indexed by the number of records which were mapped
+	records = header->nrecords;
+	path = std::string (_path);
+	writer = false;
+	return 0;
+}
+
+bool MessageJournal::isReplaced ()
+{
+	if (header == NULL)
+		return false;
+	struct stat st;
+	if (stat (path.c_str (), &st))
+		return true;
+	return st.st_dev != fileDev || st.st_ino != fileIno;
+}
+
+void MessageJournal::close ()
+{
+	if (header)
+		munmap (header, mapSize);
+	header = NULL;
+	mapSize = 0;
+	records = 0;
+	writer = false;
+}
+
+uint64_t MessageJournal::getWriteSeq ()
+{
+	if (header == NULL)
+		return 0;
+	return __atomic_load_n (&(header->writeSeq), __ATOMIC_ACQUIRE);
+}
+
+void MessageJournal::add (Message &msg)
+{
+	if (header == NULL || !writer)
+		return;
+
+	uint64_t seq = header->writeSeq + 1;
+	struct MessageJournalRecord *rec = getRecord (seq);
+
+	// invalidate record before it is overwritten
+	__atomic_store_n (&(rec->seq), 0, __ATOMIC_RELEASE);
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+	int level = messageJournalLevel (msg.getType ());
+	int dev = findDevice (msg.getMessageOName ());
+
+	rec->prevLevel = header->lastLevel[level];
+	rec->prevDevice = dev >= 0 ? header->devices[dev].last : 0;
+	rec->time = msg.getMessageTime ();
+	if (rec->time > lastITime)
+		lastITime = rec->time;
+	rec->itime = lastITime;
+	rec->type = msg.getType ();
+	strncpy (rec->oname, msg.getMessageOName (), MESSAGE_JOURNAL_ONAME - 1);
+	rec->oname[MESSAGE_JOURNAL_ONAME - 1] = '\0';
+	std::string text = msg.getMessageString ();
+	strncpy (rec->text, text.c_str (), MESSAGE_JOURNAL_TEXT - 1);
+	rec->text[MESSAGE_JOURNAL_TEXT - 1] = '\0';
+
+	__atomic_store_n (&(rec->seq), seq, __ATOMIC_RELEASE);
+	__atomic_store_n (&(header->writeSeq), seq, __ATOMIC_RELEASE);
+	__atomic_store_n (&(header->lastLevel[level]), seq, __ATOMIC_RELEASE);
+	if (dev >= 0)
+		__atomic_store_n (&(header->devices[dev].last), seq, __ATOMIC_RELEASE);
+}
+
+size_t MessageJournal::query (double from, double to, int typeMask, const char *device, std::vector <Message> &msgs, size_t max)
+{
+	if (header == NULL)
+		return 0;
+
+	std::vector <uint64_t> seqs;
+
+	uint64_t w = getWriteSeq ();
+	if (w == 0)
+		return 0;
+	uint64_t oldest = w > records ? w - records + 1 : 1;
+
+	if (device != NULL && device[0] == '\0')
+		device = NULL;
+
+	int selected = 0;
+	for (int l = 0; l < MESSAGE_JOURNAL_LEVELS; l++)
+		if (levelSelected (l, typeMask))
+			selected++;
+
+	int dev = device ? findDevice (device) : -1;
+	if (dev >= 0)
+	{
+		walkChain (__atomic_load_n (&(header->devices[dev].last), __ATOMIC_ACQUIRE), true, from, to, typeMask, device, seqs, max);
+		std::reverse (seqs.begin (), seqs.end ());
+	}
+	else if (device != NULL && __atomic_load_n (&(header->devices[MESSAGE_JOURNAL_DEVICES - 1].last), __ATOMIC_ACQUIRE) == 0)
+	{
+		// device table is not full and device is not in it - device never send any message
+		return 0;
+	}
+	else if (device == NULL && selected < MESSAGE_JOURNAL_LEVELS)
+	{
+		for (int l = 0; l < MESSAGE_JOURNAL_LEVELS; l++)
+		{
+			if (levelSelected (l, typeMask))
+				walkChain (__atomic_load_n (&(header->lastLevel[l]), __ATOMIC_ACQUIRE), false, from, to, typeMask, device, seqs, max);
+		}
+		std::sort (seqs.begin (), seqs.end ());
+		if (max > 0 && seqs.size () > max)
+			seqs.erase (seqs.begin (), seqs.end () - max);
+	}
+	else
+	{
+		// binary search for the last record within the period, then scan backward
+		struct MessageJournalRecord rec;
+		uint64_t lo = oldest;
+		uint64_t hi = w + 1;
+		while (lo < hi)
+		{
+			uint64_t mid = lo + (hi - lo) / 2;
+			if (!readRecord (mid, rec) || rec.itime <= to)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		for (uint64_t s = lo - 1; s >= oldest && s > 0; s--)
+		{
+			if (!readRecord (s, rec))
+				break;
+			if (rec.itime < from)
+				break;
+			if ((rec.type & typeMask) == 0)
+				continue;
+			if (device && !onameEqual (rec.oname, device))
+				continue;
+			seqs.push_back (s);
+			if (max > 0 && seqs.size () >= max)
+				break;
+		}
+		std::reverse (seqs.begin (), seqs.end ());
+	}
+
+	size_t ret = 0;
+	struct MessageJournalRecord rec;
+	for (std::vector <uint64_t>::iterator iter = seqs.begin (); iter != seqs.end (); iter++)
+	{
+		if (!readRecord (*iter, rec))
+			continue;
+		msgs.push_back (Message (rec.time, rec.oname, rec.type, rec.text));
+		ret++;
+	}
+	return ret;
+}
+
+bool MessageJournal::readRecord (uint64_t seq, struct MessageJournalRecord &rec)
+{
+	struct MessageJournalRecord *r = getRecord (seq);
+	if (__atomic_load_n (&(r->seq), __ATOMIC_ACQUIRE) != seq)
+		return false;
+	memcpy (&rec, r, sizeof (struct MessageJournalRecord));
+	__atomic_thread_fence (__ATOMIC_ACQUIRE);
+	return __atomic_load_n (&(r->seq), __ATOMIC_RELAXED) == seq;
+}
+
+void MessageJournal::walkChain (uint64_t seq, bool byDevice, double from, double to, int typeMask, const char *device, std::vector <uint64_t> &seqs, size_t max)
+{
+	struct MessageJournalRecord rec;
+	size_t found = 0;
+	while (seq > 0)
+	{
+		// overwritten records end the chain
+		if (!readRecord (seq, rec))
+			break;
+		if (rec.itime < from)
+			break;
+		if (rec.itime <= to && (rec.type & typeMask) && (device == NULL || onameEqual (rec.oname, device)))
+		{
+			seqs.push_back (seq);
+			found++;
+			if (max > 0 && found >= max)
+				break;
+		}
+		seq = byDevice ? rec.prevDevice : rec.prevLevel;
+	}
+}
+
+int MessageJournal::findDevice (const char *oname)
+{
+	for (int i = 0; i < MESSAGE_JOURNAL_DEVICES; i++)
+	{
+		struct MessageJournalDevice *d = header->devices + i;
+		if (__atomic_load_n (&(d->last), __ATOMIC_ACQUIRE) == 0)
+		{
+			if (!writer)
+				return -1;
+			// new device, last is set when the first record is written
+			strncpy (d->oname, oname, MESSAGE_JOURNAL_ONAME - 1);
+			d->oname[MESSAGE_JOURNAL_ONAME - 1] = '\0';
+			return i;
+		}
+		if (onameEqual (d->oname, oname))
+			return i;
+	}
+	// device table is full, device messages are not chained
+	return -1;
+}
+
+int MessageJournal::map (int fd, bool rw)
+{
+	struct stat st;
+	if (fstat (fd, &st) || (size_t) st.st_size < sizeof (struct MessageJournalHeader))
+		return -1;
+	mapSize = st.st_size;
+	fileDev = st.st_dev;
+	fileIno = st.st_ino;
+	void *m = mmap (NULL, mapSize, rw ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+	if (m == MAP_FAILED)
+	{
+		logStream (MESSAGE_ERROR) << "cannot map message journal: " << strerror (errno) << sendLog;
+		mapSize = 0;
+		return -1;
+	}
+	header = (struct MessageJournalHeader *) m;
+	return 0;
+}
@@ -0,0 +1,326 @@
+/*
+ * Asynchronous message log with rotation.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "messagelog.h"
+#include "app.h"
+#include "utilsfunc.h"
+
+#include <errno.h>
+#include <iostream>
+#include <sstream>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+// size of the log file buffer
+#define MESSAGELOG_BUFFER   65536
+
+using namespace rts2core;
+
+/**
+ * Append message in the same format as Message operator <<. Timestamp
+ * streaming is not used, as it is not thread safe.
+ */
+static void formatMessage (std::string &out, Message &msg, bool localTime)
+{
+	struct tm tmval;
+	time_t t = msg.getMessageTimeSec ();
+	if (localTime)
+		localtime_r (&t, &tmval);
+	else
+		gmtime_r (&t, &tmval);
+	char buf[100];
+	snprintf (buf, sizeof (buf), "%04d-%02d-%02dT%02d:%02d:%06.3f %s %s %d ", tmval.tm_year + 1900, tmval.tm_mon + 1, tmval.tm_mday, tmval.tm_hour, tmval.tm_min, tmval.tm_sec + (double) msg.getMessageTimeUSec () / USEC_SEC, localTime ? *tzname : "UT", msg.getMessageOName (), msg.getType ());
+	out.append (buf);
+	out.append (msg.getMessageString ());
+	out += '\n';
+}
+
+MessageLog::MessageLog ()
+{
+	maxSize = 0;
+	interval = 0;
+	keep = 5;
+	compress = false;
+	maxQueue = 100000;
+
+	running = false;
+	pthread_mutex_init (&mutex, NULL);
+	pthread_cond_init (&cond, NULL);
+	pthread_cond_init (&flushed, NULL);
+
+	stop = false;
+	reopen = false;
+	queued = 0;
+	written = 0;
+	dropped = 0;
+	reportedDropped = 0;
+
+	file = NULL;
+	fileSize = 0;
+	openTime = 0;
+	localTime = true;
+}
+
+MessageLog::~MessageLog ()
+{
+	close ();
+	pthread_cond_destroy (&flushed);
+	pthread_cond_destroy (&cond);
+	pthread_mutex_destroy (&mutex);
+}
+
+void MessageLog::setRotation (size_t _maxSize, double _interval, int _keep, bool _compress)
+{
+	pthread_mutex_lock (&mutex);
+	maxSize = _maxSize;
+	interval = _interval;
+	keep = _keep;
+	compress = _compress;
+	pthread_mutex_unlock (&mutex);
+}
+
+int MessageLog::open (const char *_filename)
+{
+	if (running)
+	{
+		if (filename == _filename)
+		{
+			pthread_mutex_lock (&mutex);
+			reopen = true;
+			pthread_cond_signal (&cond);
+			pthread_mutex_unlock (&mutex);
+			return 0;
+		}
+		close ();
+	}
+
+	filename = std::string (_filename);
+	if (openFile ())
+		return -1;
+
+	localTime = getMasterApp () == NULL || getMasterApp ()->usesLocalTime ();
+	tzset ();
+
+	stop = false;
+	reopen = false;
+	if (pthread_create (&thread, NULL, writerThread, this))
+	{
+		std::cerr << "cannot start message log writer: " << strerror (errno) << std::endl;
+		fclose (file);
+		file = NULL;
+		return -1;
+	}
+	running = true;
+	return 0;
+}
+
+void MessageLog::close ()
+{
+	if (!running)
+		return;
+	pthread_mutex_lock (&mutex);
+	stop = true;
+	pthread_cond_signal (&cond);
+	pthread_mutex_unlock (&mutex);
+	pthread_join (thread, NULL);
+	running = false;
+	if (file)
+		fclose (file);
+	file = NULL;
+}
+
+void MessageLog::log (Message &msg)
+{
+	pthread_mutex_lock (&mutex);
+	if (queue.size () >= maxQueue)
+	{
+		dropped++;
+	}
+	else
+	{
+		queue.push_back (msg);
+		queued++;
+		if (queue.size () == 1)
+			pthread_cond_signal (&cond);
+	}
+	pthread_mutex_unlock (&mutex);
+}
+
+void MessageLog::flush ()
+{
+	pthread_mutex_lock (&mutex);
+	uint64_t target = queued;
+	pthread_cond_signal (&cond);
+	while (running && written < target)
+		pthread_cond_wait (&flushed, &mutex);
+	pthread_mutex_unlock (&mutex);
+}
+
+uint64_t MessageLog::getDropped ()
+{
+	pthread_mutex_lock (&mutex);
+	uint64_t ret = dropped;
+	pthread_mutex_unlock (&mutex);
+	return ret;
+}
+
+void *MessageLog::writerThread (void *arg)
+{
+	((MessageLog *) arg)->writer ();
+	return NULL;
+}
+
+void MessageLog::writer ()
+{
+	std::vector <Message> batch;
+	std::string out;
+
+	pthread_mutex_lock (&mutex);
+	while (true)
+	{
+		if (queue.empty () && !stop && !reopen)
+		{
+			// wake up regularly to check time based rotation
+			struct timeval now;
+			struct timespec abstime;
+			gettimeofday (&now, NULL);
+			abstime.tv_sec = now.tv_sec + 1;
+			abstime.tv_nsec = now.tv_usec * 1000;
+			pthread_cond_timedwait (&cond, &mutex, &abstime);
+		}
+
+		batch.swap (queue);
+		uint64_t d = dropped - reportedDropped;
+		reportedDropped = dropped;
+		bool r = reopen;
+		reopen = false;
+		bool s = stop;
+		size_t rotateSize = maxSize;
+		double rotateInterval = interval;
+		int rotateKeep = keep;
+		bool rotateCompress = compress;
+		pthread_mutex_unlock (&mutex);
+
+		if (r)
+		{
+			if (file)
+				fclose (file);
+			openFile ();
+		}
+
+		if (!batch.empty () || d > 0)
+		{
+			out.clear ();
+			for (std::vector <Message>::iterator iter = batch.begin (); iter != batch.end (); iter++)
+				formatMessage (out, *iter, localTime);
+			if (d > 0)
+			{
+				std::ostringstream os;
+				os << "message log queue full, " << d << " messages were not logged";
+				Message dmsg ("centrald", MESSAGE_WARNING, os.str ().c_str ());
+				formatMessage (out, dmsg, localTime);
+			}
+			if (file)
+			{
+				fwrite (out.c_str (), 1, out.length (), file);
+				fflush (file);
+				fileSize += out.length ();
+			}
+		}
+
+		if (file && ((rotateSize > 0 && fileSize >= rotateSize) || (rotateInterval > 0 && getNow () >= openTime + rotateInterval)))
+			rotate (rotateKeep, rotateCompress);
+
+		pthread_mutex_lock (&mutex);
+		written += batch.size ();
+		batch.clear ();
+		pthread_cond_broadcast (&flushed);
+		if (s && queue.empty ())
+			break;
+	}
+	pthread_mutex_unlock (&mutex);
+}
+
+int MessageLog::openFile ()
+{
+	file = fopen (filename.c_str (), "a");
+	if (file == NULL)
+	{
+		std::cerr << "cannot open log file " << filename << ": " << strerror (errno) << std::endl;
+		return -1;
+	}
+	setvbuf (file, NULL, _IOFBF, MESSAGELOG_BUFFER);
+	fseek (file, 0, SEEK_END);
+	long pos = ftell (file);
+	fileSize = pos > 0 ? pos : 0;
+	openTime = getNow ();
+	return 0;
+}
+
+std::string MessageLog::rotatedName (int i)
+{
+	std::ostringstream os;
+	os << filename << "." << i;
+	return os.str ();
+}
+
+void MessageLog::rotate (int _keep, bool _compress)
+{
+	fclose (file);
+	file = NULL;
+
+	if (_keep > 0)
+	{
+		unlink (rotatedName (_keep).c_str ());
+		unlink ((rotatedName (_keep) + ".gz").c_str ());
+		for (int i = _keep - 1; i > 0; i--)
+		{
+			rename (rotatedName (i).c_str (), rotatedName (i + 1).c_str ());
+			rename ((rotatedName (i) + ".gz").c_str (), (rotatedName (i + 1) + ".gz").c_str ());
+		}
+		rename (filename.c_str (), rotatedName (1).c_str ());
+		if (_compress)
+			compressFile (rotatedName (1));
+	}
+	else
+	{
+		unlink (filename.c_str ());
+	}
+
+	openFile ();
+}
+
+void MessageLog::compressFile (const std::string &fn)
+{
+	pid_t pid = fork ();
+	if (pid < 0)
+	{
+		std::cerr << "cannot fork to compress " << fn << ": " << strerror (errno) << std::endl;
+		return;
+	}
+	if (pid == 0)
+	{
+		execlp ("gzip", "gzip", "-f", fn.c_str (), (char *) NULL);
+		_exit (1);
+	}
+	waitpid (pid, NULL, 0);
+}
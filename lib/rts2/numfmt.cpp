@@ -0,0 +1,501 @@
+/*
+ * Fast conversion of doubles to and from protocol strings.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/*
+ * Formatting uses Grisu2 algorithm by Florian Loitsch ("Printing
+ * Floating-Point Numbers Quickly and Accurately with Integers", PLDI 2010),
+ * which produces the shortest or nearly shortest string which converts
+ * back to the same double. Parsing uses Clinger's fast path - if the
+ * decimal mantissa and the power of ten are both exactly representable
+ * in double, single multiplication or division gives correctly rounded
+ * result.
+ */
+
+#include "numfmt.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+using namespace rts2core;
+
+namespace
+{
+
+// 10^-348, 10^-340, .., 10^340, normalized significands
+const uint64_t cachedSignificands[] = {
+	0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+	0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+	0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+	0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+	0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+	0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+	0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+	0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+	0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+	0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+	0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+	0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+	0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+	0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+	0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+	0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+	0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+	0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+	0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+	0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+	0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+	0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+	0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+	0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+	0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+	0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+	0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+	0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+	0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+// binary exponents of cachedSignificands
+const int16_t cachedExponents[] = {
+	-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+	-954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+	-688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+	-422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+	-157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+	109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+	375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+	641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+	907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+const uint32_t pow10_32[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+// powers of ten exactly representable in double
+const double pow10_exact[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * Floating point number with 64 bit significand, f * 2^e.
+ */
+struct DiyFp
+{
+	DiyFp () {}
+	DiyFp (uint64_t _f, int _e):f (_f), e (_e) {}
+
+	explicit DiyFp (double d)
+	{
+		uint64_t u;
+		memcpy (&u, &d, sizeof (u));
+		int biased_e = (u >> 52) & 0x7FF;
+		uint64_t significand = u & 0x000FFFFFFFFFFFFFULL;
+		if (biased_e != 0)
+		{
+			f = significand + 0x0010000000000000ULL;
+			e = biased_e - 1075;
+		}
+		else
+		{
+			f = significand;
+			e = -1074;
+		}
+	}
+
+	DiyFp operator - (const DiyFp &rhs) const { return DiyFp (f - rhs.f, e); }
+
+	DiyFp operator * (const DiyFp &rhs) const
+	{
+		const uint64_t M32 = 0xFFFFFFFFULL;
+		uint64_t a = f >> 32;
+		uint64_t b = f & M32;
+		uint64_t c = rhs.f >> 32;
+		uint64_t d = rhs.f & M32;
+		uint64_t ac = a * c;
+		uint64_t bc = b * c;
+		uint64_t ad = a * d;
+		uint64_t bd = b * d;
+		uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+		// round
+		tmp += 1U << 31;
+		return DiyFp (ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+	}
+
+	DiyFp normalize () const
+	{
+		DiyFp res = *this;
+		while (!(res.f & 0x8000000000000000ULL))
+		{
+			res.f <<= 1;
+			res.e--;
+		}
+		return res;
+	}
+
+	DiyFp normalizeBoundary () const
+	{
+		DiyFp res = *this;
+		while (!(res.f & (0x0010000000000000ULL << 1)))
+		{
+			res.f <<= 1;
+			res.e--;
+		}
+		res.f <<= 10;
+		res.e -= 10;
+		return res;
+	}
+
+	/**
+	 * Calculate boundaries m- and m+ - numbers halfway to the neighbouring doubles.
+	 */
+	void normalizedBoundaries (DiyFp *minus, DiyFp *plus) const
+	{
+		DiyFp pl = DiyFp ((f << 1) + 1, e - 1).normalizeBoundary ();
+		DiyFp mi = (f == 0x0010000000000000ULL) ? DiyFp ((f << 2) - 1, e - 2) : DiyFp ((f << 1) - 1, e - 1);
+		mi.f <<= mi.e - pl.e;
+		mi.e = pl.e;
+		*plus = pl;
+		*minus = mi;
+	}
+
+	uint64_t f;
+	int e;
+};
+
+DiyFp getCachedPower (int e, int *K)
+{
+	// 1/log2(10)
+	double dk = (-61 - e) * 0.30102999566398114 + 347;
+	int k = (int) dk;
+	if (dk - k > 0.0)
+		k++;
+	unsigned index = (unsigned) ((k >> 3) + 1);
+	*K = -(-348 + (int) (index << 3));
+	return DiyFp (cachedSignificands[index], cachedExponents[index]);
+}
+
+int countDecimalDigit32 (uint32_t n)
+{
+	int d = 1;
+	while (d < 10 && n >= pow10_32[d])
+		d++;
+	return d;
+}
+
+void grisuRound (char *buffer, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+	while (rest < wp_w && delta - rest >= ten_kappa && (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+	{
+		buffer[len - 1]--;
+		rest += ten_kappa;
+	}
+}
+
+void digitGen (const DiyFp &W, const DiyFp &Mp, uint64_t delta, char *buffer, int *len, int *K)
+{
+	const DiyFp one (((uint64_t) 1) << -Mp.e, Mp.e);
+	const DiyFp wp_w = Mp - W;
+	uint32_t p1 = (uint32_t) (Mp.f >> -one.e);
+	uint64_t p2 = Mp.f & (one.f - 1);
+	int kappa = countDecimalDigit32 (p1);
+	*len = 0;
+
+	while (kappa > 0)
+	{
+		uint32_t d = p1 / pow10_32[kappa - 1];
+		p1 %= pow10_32[kappa - 1];
+		if (d || *len)
+			buffer[(*len)++] = '0' + d;
+		kappa--;
+		uint64_t tmp = (((uint64_t) p1) << -one.e) + p2;
+		if (tmp <= delta)
+		{
+			*K += kappa;
+			grisuRound (buffer, *len, delta, tmp, ((uint64_t) pow10_32[kappa]) << -one.e, wp_w.f);
+			return;
+		}
+	}
+
+	uint64_t unit = 1;
+	while (true)
+	{
+		p2 *= 10;
+		delta *= 10;
+		unit *= 10;
+		char d = (char) (p2 >> -one.e);
+		if (d || *len)
+			buffer[(*len)++] = '0' + d;
+		p2 &= one.f - 1;
+		kappa--;
+		if (p2 < delta)
+		{
+			*K += kappa;
+			grisuRound (buffer, *len, delta, p2, one.f, wp_w.f * unit);
+			return;
+		}
+	}
+}
+
+/**
+ * Produce decimal digits of positive value, value = digits * 10^K.
+ */
+void grisu2 (double value, char *buffer, int *length, int *K)
+{
+	const DiyFp v (value);
+	DiyFp w_m, w_p;
+	v.normalizedBoundaries (&w_m, &w_p);
+
+	const DiyFp c_mk = getCachedPower (w_p.e, K);
+	const DiyFp W = v.normalize () * c_mk;
+	DiyFp Wp = w_p * c_mk;
+	DiyFp Wm = w_m * c_mk;
+	Wm.f++;
+	Wp.f--;
+	digitGen (W, Wp, Wp.f - Wm.f, buffer, length, K);
+}
+
+char *writeExponent (int K, char *buf)
+{
+	if (K < 0)
+	{
+		*buf++ = '-';
+		K = -K;
+	}
+	else
+	{
+		*buf++ = '+';
+	}
+	if (K >= 100)
+	{
+		*buf++ = '0' + K / 100;
+		K %= 100;
+	}
+	*buf++ = '0' + K / 10;
+	*buf++ = '0' + K % 10;
+	return buf;
+}
+
+/**
+ * Place decimal point or exponent into digits.
+ *
+ * @param buf      buffer with digits
+ * @param length   number of digits
+ * @param k        decimal exponent, value = digits * 10^k
+ *
+ * @return end of the string
+ */
+char *prettify (char *buf, int length, int k)
+{
+	// position of the decimal point, value = 0.digits * 10^kk
+	const int kk = length + k;
+
+	if (0 <= k && kk <= 21)
+	{
+		// integer, 1234e5 -> 123400000
+		for (int i = length; i < kk; i++)
+			buf[i] = '0';
+		return buf + kk;
+	}
+	if (0 < kk && kk <= 21)
+	{
+		// 1234e-2 -> 12.34
+		memmove (buf + kk + 1, buf + kk, length - kk);
+		buf[kk] = '.';
+		return buf + length + 1;
+	}
+	if (-6 < kk && kk <= 0)
+	{
+		// 1234e-6 -> 0.001234
+		const int offset = 2 - kk;
+		memmove (buf + offset, buf, length);
+		buf[0] = '0';
+		buf[1] = '.';
+		for (int i = 2; i < offset; i++)
+			buf[i] = '0';
+		return buf + length + offset;
+	}
+	if (length == 1)
+	{
+		// 1e30
+		buf[1] = 'e';
+		return writeExponent (kk - 1, buf + 2);
+	}
+	// 1234e30 -> 1.234e+33
+	memmove (buf + 2, buf + 1, length - 1);
+	buf[1] = '.';
+	buf[length + 1] = 'e';
+	return writeExponent (kk - 1, buf + length + 2);
+}
+
+}
+
+int rts2core::formatDouble (char *buf, double value)
+{
+	char *p = buf;
+	if (isnan (value))
+	{
+		strcpy (buf, "nan");
+		return 3;
+	}
+	if (signbit (value))
+	{
+		*p++ = '-';
+		value = -value;
+	}
+	if (isinf (value))
+	{
+		strcpy (p, "inf");
+		return p - buf + 3;
+	}
+	if (value == 0)
+	{
+		*p++ = '0';
+	}
+	else
+	{
+		int length, K;
+		grisu2 (value, p, &length, &K);
+		p = prettify (p, length, K);
+	}
+	*p = '\0';
+	return p - buf;
+}
+
+void rts2core::appendDouble (std::string &str, double value)
+{
+	char buf[DOUBLE_BUF_LEN];
+	int len = formatDouble (buf, value);
+	str.append (buf, len);
+}
+
+double rts2core::parseDouble (const char *str, char **endptr)
+{
+	const char *p = str;
+	while (isspace (*p))
+		p++;
+	bool negative = false;
+	if (*p == '-' || *p == '+')
+	{
+		negative = (*p == '-');
+		p++;
+	}
+	// hexadecimal numbers, nan and inf are left to strtod
+	if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+		return strtod (str, endptr);
+
+	uint64_t mantissa = 0;
+	// number of significant digits in mantissa
+	int ndigits = 0;
+	// zeros which were not yet multiplied into mantissa
+	int zeros = 0;
+	int exponent = 0;
+	bool anydigit = false;
+	bool fraction = false;
+
+	for (;; p++)
+	{
+		if (*p == '.' && !fraction)
+		{
+			fraction = true;
+			continue;
+		}
+		if (*p < '0' || *p > '9')
+			break;
+		anydigit = true;
+		if (fraction)
+			exponent--;
+		if (*p == '0')
+		{
+			if (ndigits > 0)
+				zeros++;
+			continue;
+		}
+		ndigits += zeros + 1;
+		if (ndigits > 19)
+			return strtod (str, endptr);
+		for (; zeros > 0; zeros--)
+			mantissa *= 10;
+		mantissa = mantissa * 10 + (*p - '0');
+	}
+	if (!anydigit)
+		return strtod (str, endptr);
+
+	if (*p == 'e' || *p == 'E')
+	{
+		const char *ep = p + 1;
+		bool eneg = false;
+		if (*ep == '-' || *ep == '+')
+		{
+			eneg = (*ep == '-');
+			ep++;
+		}
+		if (*ep >= '0' && *ep <= '9')
+		{
+			int e = 0;
+			for (; *ep >= '0' && *ep <= '9'; ep++)
+			{
+				if (e < 100000)
+					e = e * 10 + (*ep - '0');
+			}
+			exponent += eneg ? -e : e;
+			p = ep;
+		}
+	}
+
+	double ret;
+	exponent += zeros;
+	if (mantissa == 0)
+	{
+		ret = 0;
+	}
+	else if (mantissa > (((uint64_t) 1) << 53))
+	{
+		return strtod (str, endptr);
+	}
+	else if (exponent >= 0 && exponent <= 22)
+	{
+		ret = (double) mantissa * pow10_exact[exponent];
+	}
+	else if (exponent < 0 && exponent >= -22)
+	{
+		ret = (double) mantissa / pow10_exact[-exponent];
+	}
+	else if (exponent > 22 && exponent <= 22 + 15)
+	{
+		// shift part of the exponent into mantissa, if it stays exact
+		uint64_t m = mantissa;
+		for (int i = 22; i < exponent; i++)
+		{
+			m *= 10;
+			if (m > (((uint64_t) 1) << 53))
+				return strtod (str, endptr);
+		}
+		ret = (double) m * pow10_exact[22];
+	}
+	else
+	{
+		return strtod (str, endptr);
+	}
+
+	if (endptr)
+		*endptr = (char *) p;
+	return negative ? -ret : ret;
+}
@@ -20,6 +20,7 @@
 #include "configuration.h"
 
 #include <stdio.h>
+#include <math.h>
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -159,6 +160,8 @@ int ObjectCheck::loadHorizon (const char *horizon_file)
 	// sort horizon file
 	sort (horizon.begin (), horizon.end (), RAcomp);
 
+	compileHorizon ();
+
 	return 0;
 }
 
@@ -167,7 +170,7 @@ int ObjectCheck::is_good (const struct ln_hrz_posn *hrz, int hardness)
 	if (getIgnore ())
 		return true;
 
-	return hrz->alt > getHorizonHeight (hrz, hardness);
+	return hrz->alt > getHorizonHeightAz (hrz->az);
 }
 
 int ObjectCheck::is_good_with_margin (struct ln_hrz_posn *hrz, double alt_margin, double az_margin, int hardness)
@@ -191,37 +194,87 @@ int ObjectCheck::is_good_with_margin (struct ln_hrz_posn *hrz, double alt_margin
 	return is_good (hrz, hardness);
 }
 
-double ObjectCheck::getHorizonHeightAz (double az, horizon_t::iterator iter1, horizon_t::iterator iter2)
+size_t ObjectCheck::is_good_batch (const struct ln_hrz_posn *hrz, size_t n, bool *good, int hardness)
 {
-	double az1;
-	if ((*iter1).hrz.az > (*iter2).hrz.az)
-		az1 = (*iter1).hrz.az - 360.0;
-	else
-		az1 = (*iter1).hrz.az;
-	return (*iter1).hrz.alt + ln_range_degrees (az - az1) * ((*iter2).hrz.alt -
-		(*iter1).hrz.alt) /
-		((*iter2).hrz.az - az1);
+	if (getIgnore ())
+	{
+		std::fill (good, good + n, true);
+		return n;
+	}
+
+	size_t ret = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		good[i] = hrz[i].alt > getHorizonHeightAz (hrz[i].az);
+		ret += good[i];
+	}
+	return ret;
 }
 
-double ObjectCheck::getHorizonHeight (const struct ln_hrz_posn *hrz, int hardness)
+void ObjectCheck::addSegment (double start, double az1, double alt1, double az2, double alt2)
 {
-	if (horizon.size () == 0)
-		return 0;	// default height (alt) of hard horizon, when not explicitly defined
-
-	horizon_t::iterator iter = horizon.begin ();
-
-	if (hrz->az < (*iter).hrz.az)
-		return getHorizonHeightAz (hrz->az, iter, --horizon.end ());
+	segStart.push_back (start);
+	segAz.push_back (az1);
+	segAlt.push_back (alt1);
+	segSlope.push_back (az2 == az1 ? 0 : (alt2 - alt1) / (az2 - az1));
+}
 
-	horizon_t::iterator iter_last = iter;
+void ObjectCheck::compileHorizon ()
+{
+	segStart.clear ();
+	segAz.clear ();
+	segAlt.clear ();
+	segSlope.clear ();
+	azIndex.clear ();
+
+	size_t n = horizon.size ();
+	if (n == 0)
+		return;
+
+	HorizonEntry &first = horizon.front ();
+	HorizonEntry &last = horizon.back ();
+
+	// from last point to first point, crossing 0
+	addSegment (0, last.hrz.az - 360.0, last.hrz.alt, first.hrz.az, first.hrz.alt);
+	for (size_t i = 0; i < n - 1; i++)
+		addSegment (horizon[i].hrz.az, horizon[i].hrz.az, horizon[i].hrz.alt, horizon[i + 1].hrz.az, horizon[i + 1].hrz.alt);
+	addSegment (last.hrz.az, last.hrz.az, last.hrz.alt, first.hrz.az + 360.0, first.hrz.alt);
+
+	azIndex.resize (HORIZON_LUT_BINS);
+	size_t s = 0;
+	for (int b = 0; b < HORIZON_LUT_BINS; b++)
+	{
+		double az = b * 360.0 / HORIZON_LUT_BINS;
+		while (s + 1 < segStart.size () && az >= segStart[s + 1])
+			s++;
+		azIndex[b] = s;
+	}
+}
 
-	iter++;
+double ObjectCheck::getHorizonHeightAz (double az)
+{
+	if (segStart.size () == 0)
+		return 0;	// default height (alt) of hard horizon, when not explicitly defined
 
-	for (; iter != horizon.end (); iter++)
+	if (!(az >= 0 && az < 360))
 	{
-		if ((*iter).hrz.az > hrz->az)
-			return getHorizonHeightAz (hrz->az, iter_last, iter);
-		iter_last = iter;
+		if (isnan (az))
+			return NAN;
+		az = ln_range_degrees (az);
 	}
-	return getHorizonHeightAz (hrz->az, iter_last, horizon.begin ());
+
+	int b = az * (HORIZON_LUT_BINS / 360.0);
+	if (b >= HORIZON_LUT_BINS)
+		b = HORIZON_LUT_BINS - 1;
+	size_t s = azIndex[b];
+	// horizon points inside the bin
+	while (s + 1 < segStart.size () && az >= segStart[s + 1])
+		s++;
+	return segAlt[s] + (az - segAz[s]) * segSlope[s];
+}
+
+void ObjectCheck::getHorizonHeights (const double *az, double *alt, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		alt[i] = getHorizonHeightAz (az[i]);
 }
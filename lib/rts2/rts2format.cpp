@@ -63,5 +63,5 @@ std::ostream & localTime (std::ostream & _os)
 
 bool formatLocalTime (std::ostream & _os)
 {
-	return getMasterApp ()->usesLocalTime () || (flagLocalTime != -1 && _os.iword (flagLocalTime) == 1);
+	return (getMasterApp () && getMasterApp ()->usesLocalTime ()) || (flagLocalTime != -1 && _os.iword (flagLocalTime) == 1);
 }
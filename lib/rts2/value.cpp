@@ -25,6 +25,8 @@
 #include "block.h"
 #include "configuration.h"
 #include "value.h"
+#include "numfmt.h"
+#include "valueframe.h"
 #include "timestamp.h"
 
 #include "radecparser.h"
@@ -88,6 +90,26 @@ void Value::send (Connection * connection)
 	connection->sendValueRaw (getName (), getValue ());
 }
 
+void Value::encode (std::string &frame)
+{
+	frame.append (PROTO_VALUE " ");
+	frame.append (getName ());
+	frame += ' ';
+	frame.append (getValue ());
+	frame += '\n';
+}
+
+void Value::encodeBinary (std::string &frame)
+{
+	// text record holds the part of the message after value name
+	std::string msg;
+	encode (msg);
+	size_t start = strlen (PROTO_VALUE) + getName ().length () + 2;
+	size_t len = msg.length () - start - 1;
+	binaryPutRecord (frame, BINARY_VALUE_TEXT, len);
+	frame.append (msg, start, len);
+}
+
 ValueString::ValueString (std::string in_val_name): Value (in_val_name)
 {
 	rts2Type |= RTS2_VALUE_STRING;
@@ -139,6 +161,15 @@ void ValueString::send (Connection * connection)
 	connection->sendValue (getName (), getValue ());
 }
 
+void ValueString::encode (std::string &frame)
+{
+	frame.append (PROTO_VALUE " ");
+	frame.append (getName ());
+	frame.append (" \"");
+	frame.append (value);
+	frame.append ("\"\n");
+}
+
 void ValueString::setFromValue (Value * newValue)
 {
 	setValueCharArr (newValue->getValue ());
@@ -223,6 +254,31 @@ int ValueInteger::checkNotNull ()
 	return Value::checkNotNull ();
 }
 
+void ValueInteger::encodeBinary (std::string &frame)
+{
+	// min-max values are send as text
+	if (getValueExtType ())
+	{
+		Value::encodeBinary (frame);
+		return;
+	}
+	std::string payload;
+	binaryPutSigned (payload, value);
+	binaryPutRecord (frame, BINARY_VALUE_INTEGER, payload.length ());
+	frame.append (payload);
+}
+
+int ValueInteger::decodeBinary (char type, const char *data, size_t length)
+{
+	int64_t new_value;
+	if (type != BINARY_VALUE_INTEGER || binaryGetSigned (data, data + length, new_value))
+		return -1;
+	if (value != new_value)
+		changed ();
+	value = new_value;
+	return 0;
+}
+
 ValueDouble::ValueDouble (std::string in_val_name):Value (in_val_name)
 {
 	value = NAN;
@@ -237,7 +293,7 @@ ValueDouble::ValueDouble (std::string in_val_name, std::string in_description, b
 
 const char * ValueDouble::getValue ()
 {
-	snprintf (buf, VALUE_BUF_LEN, "%.20le", value);
+	formatDouble (buf, value);
 	return buf;
 }
 
@@ -260,7 +316,7 @@ int ValueDouble::setValue (Connection * connection)
 
 int ValueDouble::setValueCharArr (const char *in_value)
 {
-	setValueDouble (atof (in_value));
+	setValueDouble (parseDouble (in_value));
 	return 0;
 }
 
@@ -321,6 +377,29 @@ int ValueDouble::checkNotNull ()
 	return Value::checkNotNull ();
 }
 
+void ValueDouble::encodeBinary (std::string &frame)
+{
+	// statistics, min-max and timeserie values are send as text
+	if (getValueExtType ())
+	{
+		Value::encodeBinary (frame);
+		return;
+	}
+	binaryPutRecord (frame, BINARY_VALUE_DOUBLE, 8);
+	binaryPutDouble (frame, value);
+}
+
+int ValueDouble::decodeBinary (char type, const char *data, size_t length)
+{
+	double new_value;
+	if (type != BINARY_VALUE_DOUBLE || binaryGetDouble (data, data + length, new_value))
+		return -1;
+	if (value != new_value)
+		changed ();
+	value = new_value;
+	return 0;
+}
+
 ValueTime::ValueTime (std::string in_val_name):ValueDouble (in_val_name)
 {
 	rts2Type = (~RTS2_VALUE_MASK & rts2Type) | RTS2_VALUE_TIME;
@@ -382,7 +461,7 @@ ValueFloat::ValueFloat (std::string in_val_name, std::string in_description, boo
 
 const char * ValueFloat::getValue ()
 {
-	sprintf (buf, "%.20e", value);
+	formatDouble (buf, value);
 	return buf;
 }
 
@@ -409,7 +488,7 @@ int ValueFloat::setValue (Connection * connection)
 
 int ValueFloat::setValueCharArr (const char *in_value)
 {
-	setValueDouble (atof (in_value));
+	setValueDouble (parseDouble (in_value));
 	return 0;
 }
 
@@ -683,6 +762,25 @@ bool ValueLong::isEqual (Value * other_value)
 	return getValueLong () == other_value->getValueLong ();
 }
 
+void ValueLong::encodeBinary (std::string &frame)
+{
+	std::string payload;
+	binaryPutSigned (payload, value);
+	binaryPutRecord (frame, BINARY_VALUE_LONG, payload.length ());
+	frame.append (payload);
+}
+
+int ValueLong::decodeBinary (char type, const char *data, size_t length)
+{
+	int64_t new_value;
+	if (type != BINARY_VALUE_LONG || binaryGetSigned (data, data + length, new_value))
+		return -1;
+	if (value != new_value)
+		changed ();
+	value = new_value;
+	return 0;
+}
+
 ValueRaDec::ValueRaDec (std::string in_val_name):Value (in_val_name)
 {
 	ra = NAN;
@@ -795,7 +893,9 @@ int ValueRaDec::doOpValue (char op, Value *old_value)
 
 const char * ValueRaDec::getValue ()
 {
-	snprintf (buf, VALUE_BUF_LEN, "%.20le %.20le", getRa (), getDec ());
+	int len = formatDouble (buf, getRa ());
+	buf[len++] = ' ';
+	formatDouble (buf + len, getDec ());
 	return buf;
 }
 
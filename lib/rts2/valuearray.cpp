@@ -22,6 +22,8 @@
 
 #include "libnova_cpp.h"
 #include "utilsfunc.h"
+#include "numfmt.h"
+#include "valueframe.h"
 
 using namespace rts2core;
 
@@ -159,7 +161,7 @@ int DoubleArray::setValueCharArr (const char *_value)
 	std::vector <std::string> sv = SplitStr (std::string (_value), std::string (" "));
 	for (std::vector <std::string>::iterator iter = sv.begin (); iter != sv.end (); iter++)
 	{
-		value.push_back (atof ((*iter).c_str ()));
+		value.push_back (parseDouble ((*iter).c_str ()));
 	}
 	changed ();
 	return 0;
@@ -167,18 +169,13 @@ int DoubleArray::setValueCharArr (const char *_value)
 
 const char * DoubleArray::getValue ()
 {
-	std::ostringstream oss;
-	std::vector <double>::iterator iter = value.begin ();
-	oss.setf (std::ios_base::fixed, std::ios_base::floatfield);
-	while (iter != value.end ())
+	_os.clear ();
+	for (std::vector <double>::iterator iter = value.begin (); iter != value.end (); iter++)
 	{
-		oss << (*iter);
-		iter++;
-		if (iter == value.end ())
-			break;
-		oss << std::string (" ");
+		if (iter != value.begin ())
+			_os += ' ';
+		appendDouble (_os, *iter);
 	}
-	_os = oss.str ();
 	return _os.c_str ();
 }
 
@@ -239,6 +236,35 @@ void DoubleArray::setValueArray (std::vector <double> _arr)
 	}
 }
 
+void DoubleArray::encodeBinary (std::string &frame)
+{
+	std::string payload;
+	binaryPutVarint (payload, value.size ());
+	uint64_t prev = 0;
+	for (std::vector <double>::iterator iter = value.begin (); iter != value.end (); iter++)
+		binaryPutDoubleDelta (payload, *iter, prev);
+	binaryPutRecord (frame, BINARY_VALUE_DARRAY, payload.length ());
+	frame.append (payload);
+}
+
+int DoubleArray::decodeBinary (char type, const char *data, size_t length)
+{
+	const char *end = data + length;
+	uint64_t count;
+	if (type != BINARY_VALUE_DARRAY || binaryGetVarint (data, end, count) || count > length)
+		return -1;
+	std::vector <double> new_value (count);
+	uint64_t prev = 0;
+	for (uint64_t i = 0; i < count; i++)
+	{
+		if (binaryGetDoubleDelta (data, end, new_value[i], prev))
+			return -1;
+	}
+	value.swap (new_value);
+	changed ();
+	return 0;
+}
+
 double DoubleArray::calculateMedianIndex ()
 {
 	double sum = 0;
@@ -445,6 +471,41 @@ void IntegerArray::setValueArray (std::vector <int> _arr)
 	}
 }
 
+void IntegerArray::encodeBinary (std::string &frame)
+{
+	std::string payload;
+	binaryPutVarint (payload, value.size ());
+	int64_t prev = 0;
+	for (std::vector <int>::iterator iter = value.begin (); iter != value.end (); iter++)
+	{
+		binaryPutSigned (payload, *iter - prev);
+		prev = *iter;
+	}
+	binaryPutRecord (frame, BINARY_VALUE_IARRAY, payload.length ());
+	frame.append (payload);
+}
+
+int IntegerArray::decodeBinary (char type, const char *data, size_t length)
+{
+	const char *end = data + length;
+	uint64_t count;
+	if (type != BINARY_VALUE_IARRAY || binaryGetVarint (data, end, count) || count > length)
+		return -1;
+	std::vector <int> new_value (count);
+	int64_t prev = 0;
+	for (uint64_t i = 0; i < count; i++)
+	{
+		int64_t diff;
+		if (binaryGetSigned (data, end, diff))
+			return -1;
+		prev += diff;
+		new_value[i] = prev;
+	}
+	value.swap (new_value);
+	changed ();
+	return 0;
+}
+
 BoolArray::BoolArray (std::string val_name):IntegerArray (val_name)
 {
 	rts2Type &= ~RTS2_VALUE_INTEGER;
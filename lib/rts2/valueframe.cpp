@@ -0,0 +1,180 @@
+/*
+ * Value updates encoded for the text and binary protocol.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "valueframe.h"
+#include "value.h"
+
+#include <string.h>
+
+using namespace rts2core;
+
+void rts2core::binaryPutVarint (std::string &frame, uint64_t v)
+{
+	while (v >= 0x80)
+	{
+		frame += (char) ((v & 0x7f) | 0x80);
+		v >>= 7;
+	}
+	frame += (char) v;
+}
+
+void rts2core::binaryPutSigned (std::string &frame, int64_t v)
+{
+	binaryPutVarint (frame, ((uint64_t) v << 1) ^ (uint64_t) (v >> 63));
+}
+
+void rts2core::binaryPutDouble (std::string &frame, double v)
+{
+	uint64_t u;
+	memcpy (&u, &v, sizeof (u));
+	char b[8];
+	for (int i = 0; i < 8; i++)
+		b[i] = (char) (u >> (8 * i));
+	frame.append (b, 8);
+}
+
+void rts2core::binaryPutDoubleDelta (std::string &frame, double v, uint64_t &prev)
+{
+	uint64_t u;
+	memcpy (&u, &v, sizeof (u));
+	uint64_t x = u ^ prev;
+	prev = u;
+	// control byte holds number of leading zero bytes in upper, and
+	// trailing zero bytes in lower nibble; only bytes between them are send
+	int lead = 0;
+	int trail = 0;
+	if (x == 0)
+	{
+		lead = 8;
+	}
+	else
+	{
+		while (!(x & (0xffULL << (56 - 8 * lead))))
+			lead++;
+		while (!(x & (0xffULL << (8 * trail))))
+			trail++;
+	}
+	frame += (char) ((lead << 4) | trail);
+	for (int i = 7 - lead; i >= trail; i--)
+		frame += (char) (x >> (8 * i));
+}
+
+void rts2core::binaryPutRecord (std::string &frame, char type, size_t length)
+{
+	frame += type;
+	binaryPutVarint (frame, length);
+}
+
+int rts2core::binaryGetVarint (const char *&data, const char *end, uint64_t &v)
+{
+	v = 0;
+	for (int shift = 0; data < end && shift < 64; shift += 7)
+	{
+		unsigned char c = *data++;
+		v |= (uint64_t) (c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return 0;
+	}
+	return -1;
+}
+
+int rts2core::binaryGetSigned (const char *&data, const char *end, int64_t &v)
+{
+	uint64_t u;
+	if (binaryGetVarint (data, end, u))
+		return -1;
+	v = (int64_t) (u >> 1) ^ -(int64_t) (u & 1);
+	return 0;
+}
+
+int rts2core::binaryGetDouble (const char *&data, const char *end, double &v)
+{
+	if (end - data < 8)
+		return -1;
+	uint64_t u = 0;
+	for (int i = 0; i < 8; i++)
+		u |= (uint64_t) (unsigned char) data[i] << (8 * i);
+	data += 8;
+	memcpy (&v, &u, sizeof (v));
+	return 0;
+}
+
+int rts2core::binaryGetDoubleDelta (const char *&data, const char *end, double &v, uint64_t &prev)
+{
+	if (data >= end)
+		return -1;
+	unsigned char c = *data++;
+	int lead = c >> 4;
+	int trail = c & 0x0f;
+	if (lead + trail > 8 || end - data < 8 - lead - trail)
+		return -1;
+	uint64_t x = 0;
+	for (int i = 7 - lead; i >= trail; i--)
+		x |= (uint64_t) (unsigned char) *data++ << (8 * i);
+	prev ^= x;
+	memcpy (&v, &prev, sizeof (v));
+	return 0;
+}
+
+void ValueFrame::add (Value *value, int id)
+{
+	values.push_back (value);
+	ids.push_back (id);
+}
+
+const std::string &ValueFrame::getText ()
+{
+	if (text.empty ())
+	{
+		for (std::vector <Value *>::iterator iter = values.begin (); iter != values.end (); iter++)
+		{
+			(*iter)->encode (text);
+			textEnd.push_back (text.length ());
+		}
+	}
+	return text;
+}
+
+const std::string &ValueFrame::getBinary ()
+{
+	if (binary.empty ())
+	{
+		for (size_t i = 0; i < values.size (); i++)
+		{
+			binaryPutVarint (binary, ids[i]);
+			values[i]->encodeBinary (binary);
+			binaryEnd.push_back (binary.length ());
+		}
+	}
+	return binary;
+}
+
+void ValueFrame::appendText (std::string &out, size_t i)
+{
+	getText ();
+	size_t start = i > 0 ? textEnd[i - 1] : 0;
+	out.append (text, start, textEnd[i] - start);
+}
+
+void ValueFrame::appendBinary (std::string &out, size_t i)
+{
+	getBinary ();
+	size_t start = i > 0 ? binaryEnd[i - 1] : 0;
+	out.append (binary, start, binaryEnd[i] - start);
+}
@@ -19,6 +19,7 @@
 
 #include "valueminmax.h"
 #include "connection.h"
+#include "numfmt.h"
 
 using namespace rts2core;
 
@@ -100,7 +101,11 @@ int ValueDoubleMinMax::doOpValue (char op, Value * old_value)
 
 const char * ValueDoubleMinMax::getValue ()
 {
-	sprintf (buf, "%.20le %.20le %.20le", getValueDouble (), getMin (), getMax ());
+	char *p = buf + formatDouble (buf, getValueDouble ());
+	*p++ = ' ';
+	p += formatDouble (p, getMin ());
+	*p++ = ' ';
+	formatDouble (p, getMax ());
 	return buf;
 }
 
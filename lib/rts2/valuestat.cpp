@@ -22,6 +22,8 @@
 #include "valuestat.h"
 #include "connection.h"
 #include "libnova_cpp.h"
+#include "numfmt.h"
+#include "valueframe.h"
 
 using namespace rts2core;
 
@@ -90,7 +92,15 @@ int ValueDoubleStat::setValue (Connection * connection)
 
 const char * ValueDoubleStat::getValue ()
 {
-	sprintf (buf, "%.20le %i %.20le %.20le %.20le %.20le", value, numMes, mode, min, max, stdev);
+	char *p = buf + formatDouble (buf, value);
+	p += sprintf (p, " %i ", numMes);
+	p += formatDouble (p, mode);
+	*p++ = ' ';
+	p += formatDouble (p, min);
+	*p++ = ' ';
+	p += formatDouble (p, max);
+	*p++ = ' ';
+	formatDouble (p, stdev);
 	return buf;
 }
 
@@ -120,6 +130,43 @@ void ValueDoubleStat::send (Connection * connection)
 	ValueDouble::send (connection);
 }
 
+void ValueDoubleStat::encode (std::string &frame)
+{
+	if (numMes != (int) valueList.size ())
+		calculate ();
+	ValueDouble::encode (frame);
+}
+
+void ValueDoubleStat::encodeBinary (std::string &frame)
+{
+	if (numMes != (int) valueList.size ())
+		calculate ();
+	std::string payload;
+	binaryPutVarint (payload, numMes);
+	binaryPutDouble (payload, value);
+	binaryPutDouble (payload, mode);
+	binaryPutDouble (payload, min);
+	binaryPutDouble (payload, max);
+	binaryPutDouble (payload, stdev);
+	binaryPutRecord (frame, BINARY_VALUE_STAT, payload.length ());
+	frame.append (payload);
+}
+
+int ValueDoubleStat::decodeBinary (char type, const char *data, size_t length)
+{
+	const char *end = data + length;
+	uint64_t n;
+	if (type != BINARY_VALUE_STAT || binaryGetVarint (data, end, n)
+		|| binaryGetDouble (data, end, value)
+		|| binaryGetDouble (data, end, mode)
+		|| binaryGetDouble (data, end, min)
+		|| binaryGetDouble (data, end, max)
+		|| binaryGetDouble (data, end, stdev))
+		return -1;
+	numMes = n;
+	return 0;
+}
+
 void ValueDoubleStat::setFromValue (Value * newValue)
 {
 	ValueDouble::setFromValue (newValue);
@@ -229,7 +276,19 @@ int ValueDoubleTimeserie::setValue (Connection * connection)
 
 const char * ValueDoubleTimeserie::getValue ()
 {
-	sprintf (buf, "%.20le %i %.20le %.20le %.20le %.20le %.20le %.20le", value, numMes, mode, min, max, stdev, alpha, beta);
+	char *p = buf + formatDouble (buf, value);
+	p += sprintf (p, " %i ", numMes);
+	p += formatDouble (p, mode);
+	*p++ = ' ';
+	p += formatDouble (p, min);
+	*p++ = ' ';
+	p += formatDouble (p, max);
+	*p++ = ' ';
+	p += formatDouble (p, stdev);
+	*p++ = ' ';
+	p += formatDouble (p, alpha);
+	*p++ = ' ';
+	formatDouble (p, beta);
 	return buf;
 }
 
@@ -246,6 +305,13 @@ void ValueDoubleTimeserie::send (Connection * connection)
 	ValueDouble::send (connection);
 }
 
+void ValueDoubleTimeserie::encode (std::string &frame)
+{
+	if (numMes != (int) valueList.size ())
+		calculate ();
+	ValueDouble::encode (frame);
+}
+
 void ValueDoubleTimeserie::setFromValue (Value * newValue)
 {
 	ValueDouble::setFromValue (newValue);
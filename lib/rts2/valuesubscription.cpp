@@ -0,0 +1,118 @@
+/*
+ * Value subscriptions - filtering and rate limiting of value updates.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "valuesubscription.h"
+#include "value.h"
+
+#include <math.h>
+#include <fnmatch.h>
+#include <strings.h>
+
+#ifndef FNM_CASEFOLD
+#define FNM_CASEFOLD 0
+#endif
+
+using namespace rts2core;
+
+ValueSubscription::ValueSubscription (double _interval)
+{
+	interval = _interval;
+	pendingTime = NAN;
+}
+
+void ValueSubscription::addPattern (const char *pattern)
+{
+	patterns.push_back (std::string (pattern));
+	matched.clear ();
+}
+
+bool ValueSubscription::matches (Value *value, int id)
+{
+	if (id >= 0 && (size_t) id < matched.size () && matched[id] != 0)
+		return matched[id] > 0;
+
+	bool ret = patterns.empty () || strcasecmp (value->getName ().c_str (), RTS2_VALUE_INFOTIME) == 0;
+	for (std::vector <std::string>::iterator iter = patterns.begin (); !ret && iter != patterns.end (); iter++)
+	{
+		if (fnmatch (iter->c_str (), value->getName ().c_str (), FNM_CASEFOLD) == 0)
+			ret = true;
+	}
+
+	if (id >= 0)
+	{
+		if ((size_t) id >= matched.size ())
+			matched.resize (id + 1, 0);
+		matched[id] = ret ? 1 : -1;
+	}
+	return ret;
+}
+
+bool ValueSubscription::checkAccept (Value *value, int id, double now, bool rateLimit)
+{
+	if (!matches (value, id))
+		return false;
+	if (id < 0 || interval <= 0)
+		return true;
+	if ((size_t) id >= lastSend.size ())
+	{
+		lastSend.resize (id + 1, -INFINITY);
+		pending.resize (id + 1, false);
+	}
+	if (rateLimit && now - lastSend[id] < interval)
+	{
+		// remember value, it will be send when interval expires
+		if (!pending[id])
+		{
+			pending[id] = true;
+			pendingIds.push_back (id);
+			if (isnan (pendingTime) || lastSend[id] + interval < pendingTime)
+				pendingTime = lastSend[id] + interval;
+		}
+		return false;
+	}
+	lastSend[id] = now;
+	pending[id] = false;
+	return true;
+}
+
+void ValueSubscription::getPending (double now, std::vector <int> &ids)
+{
+	pendingTime = NAN;
+	std::vector <int>::iterator iter = pendingIds.begin ();
+	while (iter != pendingIds.end ())
+	{
+		// value was send in the meantime
+		if (!pending[*iter])
+		{
+			iter = pendingIds.erase (iter);
+			continue;
+		}
+		double t = lastSend[*iter] + interval;
+		if (t <= now)
+		{
+			ids.push_back (*iter);
+			pending[*iter] = false;
+			iter = pendingIds.erase (iter);
+			continue;
+		}
+		if (isnan (pendingTime) || t < pendingTime)
+			pendingTime = t;
+		iter++;
+	}
+}
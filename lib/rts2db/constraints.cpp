@@ -20,6 +20,7 @@
 #include "rts2db/constraints.h"
 #include "utilsfunc.h"
 #include "configuration.h"
+#include "ephemcache.h"
 
 #ifndef RTS2_HAVE_DECL_LN_GET_ALT_FROM_AIRMASS
 double ln_get_alt_from_airmass (double X, double airmass_scale)
@@ -528,20 +529,16 @@ void ConstraintLunarDistance::getSatisfiedIntervals (Target *tar, time_t from, t
 
 bool ConstraintLunarAltitude::satisfy (Target *tar, double JD, double *nextJD)
 {
-	struct ln_equ_posn eq_lun;
-	struct ln_hrz_posn hrz_lun;
-	ln_get_lunar_equ_coords (JD, &eq_lun);
-	ln_get_hrz_from_equ (&eq_lun, rts2core::Configuration::instance ()->getObserver (), JD, &hrz_lun);
 	if (nextJD)
 		*nextJD = 0;
-	return isBetween (hrz_lun.alt);
+	return isBetween (rts2core::EphemerisCache::instance ()->getAltitude (rts2core::EPHEM_MOON, JD));
 }
 
 bool ConstraintLunarPhase::satisfy (Target *tar, double JD, double *nextJD)
 {
 	if (nextJD)
 		*nextJD = 0;
-	return isBetween (ln_get_lunar_phase (JD));
+	return isBetween (rts2core::EphemerisCache::instance ()->getLunarPhase (JD));
 }
 
 bool ConstraintSolarDistance::satisfy (Target *tar, double JD, double *nextJD)
@@ -560,13 +557,9 @@ bool ConstraintSolarDistance::satisfy (Target *tar, double JD, double *nextJD)
 
 bool ConstraintSunAltitude::satisfy (Target *tar, double JD, double *nextJD)
 {
-	struct ln_equ_posn eq_sun;
-	struct ln_hrz_posn hrz_sun;
-	ln_get_solar_equ_coords (JD, &eq_sun);
-	ln_get_hrz_from_equ (&eq_sun, rts2core::Configuration::instance ()->getObserver (), JD, &hrz_sun);
 	if (nextJD)
 		*nextJD = 0;
-	return isBetween (hrz_sun.alt);
+	return isBetween (rts2core::EphemerisCache::instance ()->getAltitude (rts2core::EPHEM_SUN, JD));
 }
 
 void ConstraintMaxRepeat::load (xmlNodePtr cons)
@@ -20,6 +20,7 @@
 #include "rts2targetplanet.h"
 #include "infoval.h"
 #include "libnova_cpp.h"
+#include "ephemcache.h"
 
 #define PLANETS   10
 
@@ -159,7 +160,8 @@ void TargetPlanet::load ()
 
 void TargetPlanet::getPosition (struct ln_equ_posn *pos, double JD, struct ln_equ_posn *parallax)
 {
-	planet_info->rst_func (JD, pos);
+	// planets table follows order of ephemeris bodies
+	rts2core::EphemerisCache::instance ()->getEquCoords ((rts2core::ephem_body_t) (planet_info - planets), JD, pos);
 
 	ln_get_parallax (pos, getEarthDistance (JD), observer, 1706, JD, parallax);
 
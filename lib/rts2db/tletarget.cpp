@@ -23,8 +23,7 @@
 #include "libnova_cpp.h"
 #include "rts2fits/image.h"
 
-#include "pluto/norad.h"
-#include "pluto/observe.h"
+#include "configuration.h"
 
 using namespace rts2db;
 
@@ -48,18 +47,11 @@ void TLETarget::orbitFromTLE (std::string target_tle)
 		tle1 = target_tle.substr (0, sub);
 		tle2 = target_tle.substr (sub + 1);
 
-		int ret = parse_elements (tle1.c_str (), tle2.c_str (), &tle);
+		int ret = engine.setTLE (tle1.c_str (), tle2.c_str ());
 		if (ret != 0)
 			throw rts2core::Error ("cannot parse TLE " + tle1 + " " + tle2 + " for target " + getTargetName ());
 
-		ephem = 1;
-		is_deep = select_ephemeris (&tle);
-
-		if (is_deep && (ephem == 1 || ephem == 2))
-			ephem += 2;	/* switch to an SDx */
-		if (!is_deep && (ephem == 3 || ephem == 4))
-			ephem -= 2;	/* switch to an SGx */
-		setTargetName (tle.intl_desig);
+		setTargetName (engine.getTLE ()->intl_desig);
 		setTargetInfo (target_tle.c_str ());
 		setTargetType (TYPE_TLE);
 		return;
@@ -67,56 +59,66 @@ void TLETarget::orbitFromTLE (std::string target_tle)
 	throw rts2core::Error ("cannot parse TLE " + target_tle);
 }
 
+void TLETarget::setObserver ()
+{
+	engine.setObserver (observer->lng, observer->lat, obs_altitude);
+}
+
 void TLETarget::getPosition (struct ln_equ_posn *pos, double JD)
 {
-	double sat_params[N_SAT_PARAMS], observer_loc[3];
-	double t_since;
-	double sat_pos[3]; /* Satellite position vector */
 	double dist_to_satellite;
 
-	double r_s, r_c;
-
-	lat_alt_to_parallax (ln_deg_to_rad (observer->lat), obs_altitude * 1000, &r_c, &r_s);
-
-	observer_cartesian_coords (JD, ln_deg_to_rad (observer->lng), r_c, r_s, observer_loc);
-
-	t_since = (JD - tle.epoch) * 1440.;
-	switch (ephem)
-	{
-		case 0:
-			SGP_init (sat_params, &tle);
-			SGP (t_since, &tle, sat_params, sat_pos, NULL);
-			break;
-		case 1:
-			SGP4_init (sat_params, &tle);
-			SGP4 (t_since, &tle, sat_params, sat_pos, NULL);
-			break;
-		case 2:
-			SGP8_init (sat_params, &tle);
-			SGP8 (t_since, &tle, sat_params, sat_pos, NULL);
-			break;
-		case 3:
-			SDP4_init (sat_params, &tle);
-			SDP4 (t_since, &tle, sat_params, sat_pos, NULL);
-			break;
-		case 4:
-			SDP8_init (sat_params, &tle);
-			SDP8 (t_since, &tle, sat_params, sat_pos, NULL);
-			break;
-		default:
-			throw rts2core::Error ("invalid ephem");
-	}
+	setObserver ();
+	engine.getPosition (JD, pos->ra, pos->dec, dist_to_satellite);
 
-	get_satellite_ra_dec_delta (observer_loc, sat_pos, &(pos->ra), &(pos->dec), &dist_to_satellite);
 	pos->ra = ln_rad_to_deg (pos->ra);
 	pos->dec = ln_rad_to_deg (pos->dec);
 }
 
 int TLETarget::getRST (struct ln_rst_time *rst, double JD, double horizon)
 {
+	// search at least two orbits, so next pass is found even if satellite is currently above horizon
+	double period = engine.getPeriod ();
+	double to = JD + (period > 0.5 ? 2 * period : 1);
+
+	std::vector <rts2pluto::SatellitePass> passes;
+	getPasses (JD, to, horizon, passes);
+
+	if (passes.size () == 0)
+		return -1;
+
+	std::vector <rts2pluto::SatellitePass>::iterator next = passes.begin ();
+	if (std::isnan (next->rise))
+	{
+		// above horizon for the whole period
+		if (std::isnan (next->set))
+			return 1;
+		rst->set = next->set;
+		rst->transit = next->culmination;
+		next++;
+		if (next == passes.end ())
+		{
+			rst->rise = NAN;
+			return 0;
+		}
+		rst->rise = next->rise;
+		// culmination of the current pass was already passed
+		if (rst->transit <= JD)
+			rst->transit = next->culmination;
+		return 0;
+	}
+	rst->rise = next->rise;
+	rst->transit = next->culmination;
+	rst->set = next->set;
 	return 0;
 }
 
+size_t TLETarget::getPasses (double from, double to, double horizon, std::vector <rts2pluto::SatellitePass> &passes)
+{
+	setObserver ();
+	return engine.getPasses (from, to, horizon, rts2core::Configuration::instance ()->getObjectChecker (), passes);
+}
+
 moveType TLETarget::startSlew (struct ln_equ_posn *position, std::string &p1, std::string &p2, bool update_position, int plan_id)
 {
 	if (tle1.size () > 0 && tle2.size () > 0)
@@ -0,0 +1,939 @@
+/*
+ * Incremental index of image archive.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "rts2fits/archiveindex.h"
+#include "rts2fits/image.h"
+#include "configuration.h"
+#include "app.h"
+
+#include <libnova/libnova.h>
+
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+using namespace rts2image;
+
+struct ArchiveIndexHeader
+{
+	uint32_t magic;
+	uint32_t recordSize;
+};
+
+static const char *wcsNames[ARCHIVE_WCS_VALUES] = {"CRVAL1", "CRVAL2", "CRPIX1", "CRPIX2", "CDELT1", "CDELT2", "CROTA2"};
+
+static bool hasPrefix (const std::string &path, const std::string &prefix)
+{
+	return path.compare (0, prefix.length (), prefix) == 0;
+}
+
+// directory name without trailing slash
+static std::string dirName (const char *dir)
+{
+	std::string ret (dir);
+	while (ret.length () > 1 && ret[ret.length () - 1] == '/')
+		ret.erase (ret.length () - 1);
+	return ret;
+}
+
+// NAN JDs are sorted to the end
+static double sortJD (const ArchiveItem *item)
+{
+	return std::isnan (item->entry.JD) ? INFINITY : item->entry.JD;
+}
+
+static bool cmpJD (const ArchiveItem *a, const ArchiveItem *b)
+{
+	return sortJD (a) < sortJD (b);
+}
+
+static bool cmpJDValue (const ArchiveItem *a, double JD)
+{
+	return sortJD (a) < JD;
+}
+
+static bool cmpValueJD (double JD, const ArchiveItem *a)
+{
+	return JD < sortJD (a);
+}
+
+static bool cmpDec (const ArchiveItem *a, const ArchiveItem *b)
+{
+	return a->entry.dec < b->entry.dec;
+}
+
+static bool cmpDecValue (const ArchiveItem *a, double dec)
+{
+	return a->entry.dec < dec;
+}
+
+static bool cmpValueDec (double dec, const ArchiveItem *a)
+{
+	return dec < a->entry.dec;
+}
+
+ArchiveQuery::ArchiveQuery ()
+{
+	from = NAN;
+	to = NAN;
+	ra = NAN;
+	dec = NAN;
+	radius = NAN;
+	field = false;
+	tar_id = -1;
+	obs_id = -1;
+	invalid = false;
+}
+
+ArchiveIndex::ArchiveIndex ()
+{
+	readOnly = true;
+	fd = -1;
+	inode = 0;
+	offset = 0;
+	records = 0;
+	sorted = false;
+	notifyFd = -1;
+}
+
+ArchiveIndex::~ArchiveIndex ()
+{
+	close ();
+}
+
+ArchiveIndex *ArchiveIndex::instance ()
+{
+	static ArchiveIndex *pInstance = NULL;
+	if (pInstance == NULL)
+	{
+		std::string fn;
+		rts2core::Configuration::instance ()->getString ("observatory", "archive_index", fn, "");
+		if (fn.empty ())
+			return NULL;
+		// index can be created later by rts2-imgindex, so failure is not remembered
+		ArchiveIndex *ind = new ArchiveIndex ();
+		if (ind->open (fn.c_str ()))
+		{
+			delete ind;
+			return NULL;
+		}
+		pInstance = ind;
+	}
+	else
+	{
+		pInstance->refresh ();
+	}
+	return pInstance;
+}
+
+int ArchiveIndex::open (const char *_filename, bool _readOnly)
+{
+	close ();
+
+	filename = std::string (_filename);
+	readOnly = _readOnly;
+
+	fd = ::open (_filename, readOnly ? O_RDONLY : (O_RDWR | O_CREAT | O_APPEND), 0644);
+	if (fd < 0)
+	{
+		logStream (MESSAGE_ERROR) << "cannot open archive index " << filename << ": " << strerror (errno) << sendLog;
+		return -1;
+	}
+
+	struct stat sb;
+	if (fstat (fd, &sb))
+	{
+		logStream (MESSAGE_ERROR) << "cannot stat archive index " << filename << ": " << strerror (errno) << sendLog;
+		close ();
+		return -1;
+	}
+	inode = sb.st_ino;
+
+	if (!readOnly)
+	{
+		// lock writes header to new file
+		if (lock ())
+		{
+			close ();
+			return -1;
+		}
+		unlock ();
+		return 0;
+	}
+
+	if (load () < 0)
+	{
+		close ();
+		return -1;
+	}
+	return 0;
+}
+
+void ArchiveIndex::close ()
+{
+	if (fd >= 0)
+	{
+		::close (fd);
+		fd = -1;
+	}
+	clear ();
+}
+
+int ArchiveIndex::refresh ()
+{
+	if (fd < 0)
+		return -1;
+	struct stat sb;
+	if (stat (filename.c_str (), &sb) == 0 && sb.st_ino != inode)
+	{
+		if (reopen ())
+			return -1;
+		return records;
+	}
+	return load ();
+}
+
+int ArchiveIndex::scan (const char *dir, bool recursive)
+{
+	std::string d = dirName (dir);
+	std::set <std::string> seen;
+
+	int ret = scanDir (d, recursive, seen);
+	if (ret < 0)
+		return -1;
+
+	// drop files which were removed
+	std::string prefix = d + "/";
+	std::vector <std::string> removed;
+	for (std::map <std::string, ArchiveItem *>::iterator iter = pathMap.lower_bound (prefix); iter != pathMap.end () && hasPrefix (iter->first, prefix); iter++)
+	{
+		if (!recursive && iter->first.find ('/', prefix.length ()) != std::string::npos)
+			continue;
+		if (seen.find (iter->first) == seen.end ())
+			removed.push_back (iter->first);
+	}
+	for (std::vector <std::string>::iterator iter = removed.begin (); iter != removed.end (); iter++)
+	{
+		if (removeFile (iter->c_str ()) == 0)
+			ret++;
+	}
+	return ret;
+}
+
+int ArchiveIndex::updateFile (const char *path, bool force)
+{
+	struct stat sb;
+	if (stat (path, &sb))
+	{
+		if (errno == ENOENT && pathMap.find (path) != pathMap.end ())
+			return removeFile (path) ? -1 : 1;
+		return 0;
+	}
+	if (!S_ISREG (sb.st_mode))
+		return 0;
+
+	std::map <std::string, ArchiveItem *>::iterator iter = pathMap.find (path);
+	if (!force && iter != pathMap.end () && iter->second->entry.mtime == sb.st_mtime && iter->second->entry.size == sb.st_size)
+		return 0;
+
+	ArchiveEntry entry;
+	if (readEntry (path, entry))
+		logStream (MESSAGE_WARNING) << "cannot read image " << path << ", indexed as invalid" << sendLog;
+	entry.mtime = sb.st_mtime;
+	entry.size = sb.st_size;
+
+	return addEntry (path, entry) ? -1 : 1;
+}
+
+int ArchiveIndex::removeFile (const char *path)
+{
+	if (pathMap.find (path) == pathMap.end ())
+		return 0;
+
+	ArchiveEntry entry;
+	initEntry (entry);
+	entry.flags = ARCHIVE_DELETED;
+	if (append (path, entry))
+		return -1;
+	erase (path);
+	return 0;
+}
+
+int ArchiveIndex::removeDirectory (const char *dir)
+{
+	std::string prefix = dirName (dir) + "/";
+	std::vector <std::string> removed;
+	for (std::map <std::string, ArchiveItem *>::iterator iter = pathMap.lower_bound (prefix); iter != pathMap.end () && hasPrefix (iter->first, prefix); iter++)
+		removed.push_back (iter->first);
+
+	int ret = 0;
+	for (std::vector <std::string>::iterator iter = removed.begin (); iter != removed.end (); iter++)
+	{
+		if (removeFile (iter->c_str ()))
+			ret = -1;
+	}
+	return ret;
+}
+
+int ArchiveIndex::addEntry (const char *path, const ArchiveEntry &entry)
+{
+	if (append (path, entry))
+		return -1;
+	insert (path, entry);
+	return 0;
+}
+
+int ArchiveIndex::compact ()
+{
+	if (readOnly || fd < 0)
+		return -1;
+	if (lock ())
+		return -1;
+
+	std::string tmpname = filename + ".tmp";
+	int tfd = ::open (tmpname.c_str (), O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+	if (tfd < 0)
+	{
+		logStream (MESSAGE_ERROR) << "cannot create " << tmpname << ": " << strerror (errno) << sendLog;
+		unlock ();
+		return -1;
+	}
+
+	std::vector <char> buf;
+	struct ArchiveIndexHeader header;
+	header.magic = ARCHIVE_INDEX_MAGIC;
+	header.recordSize = sizeof (ArchiveEntry);
+	buf.insert (buf.end (), (char *) &header, (char *) (&header + 1));
+
+	for (std::map <std::string, ArchiveItem *>::iterator iter = pathMap.begin (); iter != pathMap.end (); iter++)
+	{
+		uint32_t len = iter->first.length ();
+		buf.insert (buf.end (), (char *) &(iter->second->entry), (char *) (&(iter->second->entry) + 1));
+		buf.insert (buf.end (), (char *) &len, (char *) (&len + 1));
+		buf.insert (buf.end (), iter->first.begin (), iter->first.end ());
+	}
+
+	size_t written = 0;
+	while (written < buf.size ())
+	{
+		ssize_t ret = write (tfd, &(buf[written]), buf.size () - written);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			logStream (MESSAGE_ERROR) << "cannot write " << tmpname << ": " << strerror (errno) << sendLog;
+			::close (tfd);
+			unlink (tmpname.c_str ());
+			unlock ();
+			return -1;
+		}
+		written += ret;
+	}
+
+	struct stat sb;
+	if (fsync (tfd) || fstat (tfd, &sb) || rename (tmpname.c_str (), filename.c_str ()))
+	{
+		logStream (MESSAGE_ERROR) << "cannot replace " << filename << " with compacted index: " << strerror (errno) << sendLog;
+		::close (tfd);
+		unlink (tmpname.c_str ());
+		unlock ();
+		return -1;
+	}
+
+	// closing old descriptor releases its lock
+	::close (fd);
+	fd = tfd;
+	inode = sb.st_ino;
+	offset = buf.size ();
+	records = pathMap.size ();
+	return 0;
+}
+
+const ArchiveItem *ArchiveIndex::find (const char *path)
+{
+	std::map <std::string, ArchiveItem *>::iterator iter = pathMap.find (path);
+	if (iter == pathMap.end ())
+		return NULL;
+	return iter->second;
+}
+
+void ArchiveIndex::query (const ArchiveQuery &q, std::vector <const ArchiveItem *> &ret)
+{
+	sort ();
+
+	std::vector <ArchiveItem *>::iterator jb = byJD.begin ();
+	std::vector <ArchiveItem *>::iterator je = byJD.end ();
+	if (!std::isnan (q.from))
+		jb = std::lower_bound (byJD.begin (), byJD.end (), q.from, cmpJDValue);
+	if (!std::isnan (q.to))
+		je = std::upper_bound (jb, byJD.end (), q.to, cmpValueJD);
+
+	bool position = !(std::isnan (q.ra) || std::isnan (q.dec) || std::isnan (q.radius));
+
+	// search the narrower of time and declination ranges
+	if (position)
+	{
+		std::vector <ArchiveItem *>::iterator db = std::lower_bound (byDec.begin (), byDec.end (), q.dec - q.radius, cmpDecValue);
+		std::vector <ArchiveItem *>::iterator de = std::upper_bound (db, byDec.end (), q.dec + q.radius, cmpValueDec);
+		if (de - db < je - jb)
+		{
+			size_t s = ret.size ();
+			for (; db != de; db++)
+			{
+				if (matches (*db, q))
+					ret.push_back (*db);
+			}
+			std::sort (ret.begin () + s, ret.end (), cmpJD);
+			return;
+		}
+	}
+
+	for (; jb != je; jb++)
+	{
+		if (matches (*jb, q))
+			ret.push_back (*jb);
+	}
+}
+
+void ArchiveIndex::listDirectory (const char *dir, std::vector <std::string> &subdirs, std::vector <const ArchiveItem *> &files)
+{
+	std::string prefix = dirName (dir);
+	if (prefix != "/")
+		prefix += "/";
+
+	size_t s = subdirs.size ();
+	std::map <std::string, ArchiveItem *>::iterator iter = pathMap.lower_bound (prefix);
+	while (iter != pathMap.end () && hasPrefix (iter->first, prefix))
+	{
+		size_t pos = iter->first.find ('/', prefix.length ());
+		if (pos == std::string::npos)
+		{
+			files.push_back (iter->second);
+			iter++;
+		}
+		else
+		{
+			std::string sub = iter->first.substr (prefix.length (), pos - prefix.length ());
+			subdirs.push_back (sub);
+			// skip subdirectory content; '0' follows '/' in ASCII
+			iter = pathMap.lower_bound (prefix + sub + "0");
+		}
+	}
+	// paths are ordered with '/' separator, which sorts after '-' and '.'
+	std::sort (subdirs.begin () + s, subdirs.end ());
+}
+
+bool ArchiveIndex::isImageName (const char *name)
+{
+	const char *dot = strrchr (name, '.');
+	if (dot == NULL || dot == name)
+		return false;
+	return !strcasecmp (dot, ".fits") || !strcasecmp (dot, ".fit") || !strcasecmp (dot, ".fts");
+}
+
+int ArchiveIndex::readEntry (const char *path, ArchiveEntry &entry)
+{
+	initEntry (entry);
+
+	try
+	{
+		Image image (false, false);
+		image.openFile (path, true, false);
+
+		entry.JD = image.getExposureJD ();
+		entry.exposure = image.getExposureLength ();
+		entry.tar_id = image.getTargetId ();
+		entry.obs_id = image.getObsId ();
+		entry.img_id = image.getImgId ();
+		entry.tar_type = image.getTargetType ();
+
+		strncpy (entry.filter, image.getFilter (), sizeof (entry.filter) - 1);
+		strncpy (entry.camera, image.getCameraName (), sizeof (entry.camera) - 1);
+		strncpy (entry.mount, image.getMountName (), sizeof (entry.mount) - 1);
+		image.getValue ("OBJECT", entry.object, sizeof (entry.object), "");
+
+		image.getValue ("CCD_TEMP", entry.temperature, false);
+		image.getValue ("TEL_ALT", entry.alt, false);
+		image.getValue ("TEL_AZ", entry.az, false);
+		image.getValue ("AVERAGE", entry.average, false);
+		image.getValue ("STDEV", entry.stdev, false);
+		image.getValue ("POS_ERR", entry.pos_err, false);
+		image.getValue ("NAXIS1", entry.width, false);
+		image.getValue ("NAXIS2", entry.height, false);
+
+		for (int i = 0; i < ARCHIVE_WCS_VALUES; i++)
+			image.getValue (wcsNames[i], entry.wcs[i], false);
+
+		if (!std::isnan (entry.wcs[0]) && !std::isnan (entry.wcs[1]))
+		{
+			entry.ra = entry.wcs[0];
+			entry.dec = entry.wcs[1];
+			entry.flags |= ARCHIVE_WCS;
+		}
+		else
+		{
+			try
+			{
+				struct ln_equ_posn pos;
+				image.getCoordTarget (pos);
+				entry.ra = pos.ra;
+				entry.dec = pos.dec;
+			}
+			catch (rts2core::Error &er)
+			{
+			}
+		}
+	}
+	catch (rts2core::Error &er)
+	{
+		entry.flags |= ARCHIVE_INVALID;
+		return -1;
+	}
+	return 0;
+}
+
+void ArchiveIndex::initEntry (ArchiveEntry &entry)
+{
+	memset (&entry, 0, sizeof (ArchiveEntry));
+	entry.JD = NAN;
+	entry.ra = NAN;
+	entry.dec = NAN;
+	for (int i = 0; i < ARCHIVE_WCS_VALUES; i++)
+		entry.wcs[i] = NAN;
+	entry.exposure = NAN;
+	entry.temperature = NAN;
+	entry.alt = NAN;
+	entry.az = NAN;
+	entry.average = NAN;
+	entry.stdev = NAN;
+	entry.pos_err = NAN;
+	entry.tar_id = -1;
+	entry.obs_id = -1;
+	entry.img_id = -1;
+}
+
+double ArchiveIndex::getFieldRadius (const ArchiveEntry &entry)
+{
+	if (std::isnan (entry.wcs[4]) || std::isnan (entry.wcs[5]) || entry.width <= 0 || entry.height <= 0)
+		return NAN;
+	double w = fabs (entry.wcs[4]) * entry.width;
+	double h = fabs (entry.wcs[5]) * entry.height;
+	return sqrt (w * w + h * h) / 2.0;
+}
+
+#ifdef RTS2_HAVE_SYS_INOTIFY_H
+int ArchiveIndex::watch (int _notifyFd, const char *dir)
+{
+	notifyFd = _notifyFd;
+
+	std::string d = dirName (dir);
+	int wd = inotify_add_watch (notifyFd, d.c_str (), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE | IN_ONLYDIR);
+	if (wd < 0)
+	{
+		logStream (MESSAGE_ERROR) << "cannot watch " << d << ": " << strerror (errno) << sendLog;
+		return -1;
+	}
+	watches[wd] = d;
+
+	DIR *dp = opendir (d.c_str ());
+	if (dp == NULL)
+		return 1;
+
+	int ret = 1;
+	struct dirent *de;
+	while ((de = readdir (dp)) != NULL)
+	{
+		if (de->d_name[0] == '.')
+			continue;
+		std::string path = d + "/" + de->d_name;
+		bool isdir = de->d_type == DT_DIR;
+		if (de->d_type == DT_UNKNOWN)
+		{
+			struct stat sb;
+			isdir = lstat (path.c_str (), &sb) == 0 && S_ISDIR (sb.st_mode);
+		}
+		if (isdir)
+		{
+			int r = watch (notifyFd, path.c_str ());
+			if (r > 0)
+				ret += r;
+		}
+	}
+	closedir (dp);
+	return ret;
+}
+
+void ArchiveIndex::processEvent (struct inotify_event *event)
+{
+	std::map <int, std::string>::iterator iter = watches.find (event->wd);
+	if (iter == watches.end ())
+		return;
+
+	if (event->mask & IN_IGNORED)
+	{
+		watches.erase (iter);
+		return;
+	}
+	if (event->len == 0 || event->name[0] == '.')
+		return;
+
+	std::string path = iter->second + "/" + event->name;
+
+	if (event->mask & IN_ISDIR)
+	{
+		if (event->mask & (IN_CREATE | IN_MOVED_TO))
+		{
+			// files might be created before the watch was added
+			watch (notifyFd, path.c_str ());
+			scan (path.c_str ());
+		}
+		else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+		{
+			// watches of moved directory would report old paths
+			std::string prefix = path + "/";
+			for (std::map <int, std::string>::iterator wi = watches.begin (); wi != watches.end ();)
+			{
+				if (wi->second == path || hasPrefix (wi->second, prefix))
+				{
+					inotify_rm_watch (notifyFd, wi->first);
+					watches.erase (wi++);
+				}
+				else
+				{
+					wi++;
+				}
+			}
+			removeDirectory (path.c_str ());
+		}
+		return;
+	}
+
+	if (!isImageName (event->name))
+		return;
+
+	if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+		updateFile (path.c_str ());
+	else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+		removeFile (path.c_str ());
+}
+#endif
+
+void ArchiveIndex::clear ()
+{
+	for (std::map <std::string, ArchiveItem *>::iterator iter = pathMap.begin (); iter != pathMap.end (); iter++)
+		delete iter->second;
+	pathMap.clear ();
+	byJD.clear ();
+	byDec.clear ();
+	sorted = false;
+	offset = 0;
+	records = 0;
+}
+
+int ArchiveIndex::reopen ()
+{
+	std::string fn = filename;
+	return open (fn.c_str (), readOnly);
+}
+
+int ArchiveIndex::load ()
+{
+	struct stat sb;
+	if (fstat (fd, &sb))
+	{
+		logStream (MESSAGE_ERROR) << "cannot stat archive index " << filename << ": " << strerror (errno) << sendLog;
+		return -1;
+	}
+
+	if (offset == 0)
+	{
+		// new file, header is written by the first writer
+		if (sb.st_size == 0)
+			return 0;
+		struct ArchiveIndexHeader header;
+		if (pread (fd, &header, sizeof (header), 0) != sizeof (header))
+		{
+			logStream (MESSAGE_ERROR) << "cannot read archive index header from " << filename << sendLog;
+			return -1;
+		}
+		if (header.magic != ARCHIVE_INDEX_MAGIC || header.recordSize != sizeof (ArchiveEntry))
+		{
+			logStream (MESSAGE_ERROR) << filename << " is not an archive index, or was created by different version" << sendLog;
+			return -1;
+		}
+		offset = sizeof (header);
+	}
+
+	if (sb.st_size <= offset)
+		return 0;
+
+	std::vector <char> buf (sb.st_size - offset);
+	size_t rlen = 0;
+	while (rlen < buf.size ())
+	{
+		ssize_t ret = pread (fd, &(buf[rlen]), buf.size () - rlen, offset + rlen);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+		{
+			logStream (MESSAGE_ERROR) << "cannot read archive index " << filename << ": " << strerror (errno) << sendLog;
+			return -1;
+		}
+		rlen += ret;
+	}
+
+	int ret = 0;
+	size_t pos = 0;
+	// incomplete record at the end is being written by other process, will be read on next refresh
+	while (pos + sizeof (ArchiveEntry) + sizeof (uint32_t) <= buf.size ())
+	{
+		ArchiveEntry entry;
+		uint32_t len;
+		memcpy (&entry, &(buf[pos]), sizeof (ArchiveEntry));
+		memcpy (&len, &(buf[pos + sizeof (ArchiveEntry)]), sizeof (uint32_t));
+		size_t rs = sizeof (ArchiveEntry) + sizeof (uint32_t) + len;
+		if (pos + rs > buf.size ())
+			break;
+		std::string path (&(buf[pos + sizeof (ArchiveEntry) + sizeof (uint32_t)]), len);
+		if (entry.flags & ARCHIVE_DELETED)
+			erase (path);
+		else
+			insert (path.c_str (), entry);
+		pos += rs;
+		ret++;
+	}
+
+	offset += pos;
+	records += ret;
+	return ret;
+}
+
+int ArchiveIndex::lock ()
+{
+	while (true)
+	{
+		if (flock (fd, LOCK_EX))
+		{
+			logStream (MESSAGE_ERROR) << "cannot lock archive index " << filename << ": " << strerror (errno) << sendLog;
+			return -1;
+		}
+		struct stat sb;
+		if (stat (filename.c_str (), &sb) == 0 && sb.st_ino == inode)
+			break;
+		// index was compacted by other process
+		flock (fd, LOCK_UN);
+		if (reopen ())
+			return -1;
+	}
+
+	struct stat sb;
+	if (fstat (fd, &sb) == 0 && sb.st_size == 0)
+	{
+		struct ArchiveIndexHeader header;
+		header.magic = ARCHIVE_INDEX_MAGIC;
+		header.recordSize = sizeof (ArchiveEntry);
+		if (write (fd, &header, sizeof (header)) != sizeof (header))
+		{
+			logStream (MESSAGE_ERROR) << "cannot write archive index header to " << filename << ": " << strerror (errno) << sendLog;
+			unlock ();
+			return -1;
+		}
+	}
+
+	if (load () < 0)
+	{
+		unlock ();
+		return -1;
+	}
+	return 0;
+}
+
+void ArchiveIndex::unlock ()
+{
+	flock (fd, LOCK_UN);
+}
+
+void ArchiveIndex::insert (const char *path, const ArchiveEntry &entry)
+{
+	std::map <std::string, ArchiveItem *>::iterator iter = pathMap.find (path);
+	if (iter != pathMap.end ())
+	{
+		iter->second->entry = entry;
+	}
+	else
+	{
+		ArchiveItem *item = new ArchiveItem ();
+		item->path = std::string (path);
+		item->entry = entry;
+		pathMap[item->path] = item;
+	}
+	sorted = false;
+}
+
+void ArchiveIndex::erase (const std::string &path)
+{
+	std::map <std::string, ArchiveItem *>::iterator iter = pathMap.find (path);
+	if (iter == pathMap.end ())
+		return;
+	delete iter->second;
+	pathMap.erase (iter);
+	sorted = false;
+}
+
+int ArchiveIndex::append (const char *path, const ArchiveEntry &entry)
+{
+	if (readOnly || fd < 0)
+	{
+		logStream (MESSAGE_ERROR) << "archive index " << filename << " is not opened for writing" << sendLog;
+		return -1;
+	}
+
+	uint32_t len = strlen (path);
+	std::vector <char> buf;
+	buf.insert (buf.end (), (const char *) &entry, (const char *) (&entry + 1));
+	buf.insert (buf.end (), (char *) &len, (char *) (&len + 1));
+	buf.insert (buf.end (), path, path + len);
+
+	if (lock ())
+		return -1;
+
+	// single write, so readers never see a record without its path
+	ssize_t ret = write (fd, &(buf[0]), buf.size ());
+	if (ret != (ssize_t) buf.size ())
+	{
+		logStream (MESSAGE_ERROR) << "cannot append to archive index " << filename << ": " << strerror (errno) << sendLog;
+		// partial record would corrupt the journal
+		if (ret > 0 && ftruncate (fd, offset))
+			logStream (MESSAGE_ERROR) << "cannot truncate archive index " << filename << ": " << strerror (errno) << sendLog;
+		unlock ();
+		return -1;
+	}
+	offset += buf.size ();
+	records++;
+
+	unlock ();
+	return 0;
+}
+
+void ArchiveIndex::sort ()
+{
+	if (sorted)
+		return;
+
+	byJD.clear ();
+	byDec.clear ();
+	for (std::map <std::string, ArchiveItem *>::iterator iter = pathMap.begin (); iter != pathMap.end (); iter++)
+	{
+		byJD.push_back (iter->second);
+		if (!std::isnan (iter->second->entry.dec))
+			byDec.push_back (iter->second);
+	}
+	std::stable_sort (byJD.begin (), byJD.end (), cmpJD);
+	std::sort (byDec.begin (), byDec.end (), cmpDec);
+	sorted = true;
+}
+
+bool ArchiveIndex::matches (const ArchiveItem *item, const ArchiveQuery &q)
+{
+	const ArchiveEntry &e = item->entry;
+	if ((e.flags & ARCHIVE_INVALID) && !q.invalid)
+		return false;
+	if (!std::isnan (q.from) && !(e.JD >= q.from))
+		return false;
+	if (!std::isnan (q.to) && !(e.JD <= q.to))
+		return false;
+	if (q.tar_id >= 0 && e.tar_id != q.tar_id)
+		return false;
+	if (q.obs_id >= 0 && e.obs_id != q.obs_id)
+		return false;
+	if (!q.filter.empty () && strncmp (e.filter, q.filter.c_str (), sizeof (e.filter)))
+		return false;
+	if (!q.camera.empty () && strncmp (e.camera, q.camera.c_str (), sizeof (e.camera)))
+		return false;
+	if (!q.directory.empty () && !hasPrefix (item->path, dirName (q.directory.c_str ()) + "/"))
+		return false;
+	if (!(std::isnan (q.ra) || std::isnan (q.dec) || std::isnan (q.radius)))
+	{
+		if (std::isnan (e.ra) || std::isnan (e.dec))
+			return false;
+		struct ln_equ_posn p1, p2;
+		p1.ra = q.ra;
+		p1.dec = q.dec;
+		p2.ra = e.ra;
+		p2.dec = e.dec;
+		double sep = ln_get_angular_separation (&p1, &p2);
+		if (sep > q.radius)
+			return false;
+		if (q.field)
+		{
+			double fr = getFieldRadius (e);
+			if (!std::isnan (fr) && sep > fr)
+				return false;
+		}
+	}
+	return true;
+}
+
+int ArchiveIndex::scanDir (const std::string &dir, bool recursive, std::set <std::string> &seen)
+{
+	DIR *dp = opendir (dir.c_str ());
+	if (dp == NULL)
+	{
+		logStream (MESSAGE_ERROR) << "cannot open directory " << dir << ": " << strerror (errno) << sendLog;
+		return -1;
+	}
+
+	int ret = 0;
+	struct dirent *de;
+	while ((de = readdir (dp)) != NULL)
+	{
+		if (de->d_name[0] == '.')
+			continue;
+		std::string path = dir + "/" + de->d_name;
+		bool isdir = de->d_type == DT_DIR;
+		if (de->d_type == DT_UNKNOWN)
+		{
+			struct stat sb;
+			isdir = lstat (path.c_str (), &sb) == 0 && S_ISDIR (sb.st_mode);
+		}
+		if (isdir)
+		{
+			if (recursive)
+			{
+				int r = scanDir (path, recursive, seen);
+				if (r > 0)
+					ret += r;
+			}
+			continue;
+		}
+		if (!isImageName (de->d_name))
+			continue;
+		seen.insert (path);
+		if (updateFile (path.c_str ()) == 1)
+			ret++;
+	}
+	closedir (dp);
+	return ret;
+}
@@ -0,0 +1,737 @@
+/*
+ * Streaming combination of calibration frames.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "rts2fits/calibstack.h"
+#include "rts2fits/imageprocess.h"
+#include "app.h"
+
+#include <errno.h>
+#include <libgen.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+// sigma of normal distribution from median absolute deviation
+#define MAD_SIGMA       1.4826
+
+// maximal number of inputs recorded in IMCMBnnn keys
+#define MAX_IMCMB       999
+
+using namespace rts2image;
+
+static void logFitsError (const char *msg, const char *name, int status)
+{
+	char errtext[FLEN_STATUS];
+	fits_get_errstatus (status, errtext);
+	logStream (MESSAGE_ERROR) << msg << " " << name << ": " << errtext << sendLog;
+}
+
+static void *combineThread (void *arg)
+{
+	((CalibrationStack *) arg)->combineRows ();
+	return NULL;
+}
+
+StackInput::StackInput (const char *_name)
+{
+	name = std::string (_name);
+	width = 0;
+	height = 0;
+	JD = NAN;
+	exposure = NAN;
+	temperature = NAN;
+}
+
+FitsStackInput::FitsStackInput (const char *_filename):StackInput (_filename)
+{
+	fptr = NULL;
+}
+
+FitsStackInput::~FitsStackInput ()
+{
+	if (fptr)
+	{
+		int status = 0;
+		fits_close_file (fptr, &status);
+	}
+}
+
+int FitsStackInput::open ()
+{
+	int status = 0;
+	// moves to the first extension if primary HDU is empty
+	fits_open_image (&fptr, name.c_str (), READONLY, &status);
+	if (status)
+	{
+		logFitsError ("cannot open", name.c_str (), status);
+		fptr = NULL;
+		return -1;
+	}
+
+	int naxis;
+	long sizes[2];
+	fits_get_img_dim (fptr, &naxis, &status);
+	fits_get_img_size (fptr, 2, sizes, &status);
+	if (status)
+	{
+		logFitsError ("cannot read image size of", name.c_str (), status);
+		return -1;
+	}
+	if (naxis != 2)
+	{
+		logStream (MESSAGE_ERROR) << "image " << name << " has " << naxis << " axes, only 2D images can be combined" << sendLog;
+		return -1;
+	}
+	width = sizes[0];
+	height = sizes[1];
+
+	// missing keys are not an error, keep unknown values
+	status = 0;
+	fits_read_key (fptr, TDOUBLE, "JD", &JD, NULL, &status);
+	if (status)
+		JD = NAN;
+	status = 0;
+	fits_read_key (fptr, TFLOAT, "EXPOSURE", &exposure, NULL, &status);
+	if (status)
+		exposure = NAN;
+	status = 0;
+	fits_read_key (fptr, TFLOAT, "CCD_TEMP", &temperature, NULL, &status);
+	if (status)
+		temperature = NAN;
+
+	char val[FLEN_VALUE];
+	status = 0;
+	fits_read_key (fptr, TSTRING, "IMAGETYP", val, NULL, &status);
+	if (status == 0)
+		imageType = std::string (val);
+	status = 0;
+	fits_read_key (fptr, TSTRING, "FILTER", val, NULL, &status);
+	if (status == 0)
+		filter = std::string (val);
+	status = 0;
+	fits_read_key (fptr, TSTRING, "CCD_NAME", val, NULL, &status);
+	if (status == 0)
+		camera = std::string (val);
+
+	return 0;
+}
+
+int FitsStackInput::readRows (int row, int nrows, float *buf)
+{
+	int status = 0;
+	float nulval = NAN;
+	int anynul;
+	fits_read_img (fptr, TFLOAT, (LONGLONG) row * width + 1, (LONGLONG) nrows * width, &nulval, buf, &anynul, &status);
+	if (status)
+	{
+		logFitsError ("cannot read data from", name.c_str (), status);
+		return -1;
+	}
+	return 0;
+}
+
+CalibrationStack::CalibrationStack (const StackParams &_params)
+{
+	params = _params;
+	width = 0;
+	height = 0;
+	blockRows = 0;
+	darkExposure = NAN;
+	block = NULL;
+	blockStart = 0;
+	blockLength = 0;
+	nextRow = 0;
+	rejected = 0;
+	total = 0;
+	pthread_mutex_init (&rowMutex, NULL);
+}
+
+CalibrationStack::~CalibrationStack ()
+{
+	for (std::vector <StackInput *>::iterator iter = inputs.begin (); iter != inputs.end (); iter++)
+		delete *iter;
+	pthread_mutex_destroy (&rowMutex);
+}
+
+void CalibrationStack::addInput (StackInput *input)
+{
+	inputs.push_back (input);
+}
+
+int CalibrationStack::setBias (StackInput &in)
+{
+	biasName = std::string (in.getName ());
+	return readFrame (in, bias);
+}
+
+int CalibrationStack::setDark (StackInput &in)
+{
+	darkName = std::string (in.getName ());
+	darkExposure = in.exposure;
+	return readFrame (in, dark);
+}
+
+int CalibrationStack::stack ()
+{
+	if (inputs.empty ())
+	{
+		logStream (MESSAGE_ERROR) << "no frames to combine" << sendLog;
+		return -1;
+	}
+
+	width = inputs[0]->getWidth ();
+	height = inputs[0]->getHeight ();
+	for (std::vector <StackInput *>::iterator iter = inputs.begin (); iter != inputs.end (); iter++)
+	{
+		if (checkSize (*iter))
+			return -1;
+	}
+
+	size_t pixels = (size_t) width * height;
+	if ((!bias.empty () && bias.size () != pixels) || (!dark.empty () && dark.size () != pixels))
+	{
+		logStream (MESSAGE_ERROR) << "size of master bias or dark does not match size of frames" << sendLog;
+		return -1;
+	}
+
+	size_t n = inputs.size ();
+
+	darkScales.assign (n, 1);
+	if (!dark.empty () && !isnan (darkExposure) && darkExposure > 0)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			if (!isnan (inputs[i]->exposure))
+				darkScales[i] = inputs[i]->exposure / darkExposure;
+		}
+	}
+
+	scales.assign (n, 1);
+	if (params.normalize && estimateScales ())
+		return -1;
+
+	// single buffer if all rows fit to memory, otherwise two blocks, one read while the other is combined
+	size_t rowSize = n * width * sizeof (float);
+	size_t rows = params.memory / rowSize;
+	if (rows < (size_t) height)
+		rows = params.memory / 2 / rowSize;
+	if (rows < 1)
+	{
+		logStream (MESSAGE_WARNING) << "memory limit " << params.memory << " bytes is too small for " << n << " frames, using single row blocks" << sendLog;
+		rows = 1;
+	}
+	blockRows = std::min (rows, (size_t) height);
+
+	blocks[0].resize (n * blockRows * width);
+	if (blockRows < height)
+		blocks[1].resize (n * blockRows * width);
+	else
+		std::vector <float> ().swap (blocks[1]);
+
+	master.assign (pixels, NAN);
+	rejected = 0;
+	total = 0;
+
+	int cur = 0;
+	if (readBlock (0, blockRows, blocks[0].data ()))
+		return -1;
+
+	for (int start = 0; start < height; start += blockRows)
+	{
+		block = blocks[cur].data ();
+		blockStart = start;
+		blockLength = std::min (blockRows, height - start);
+		nextRow = 0;
+
+		std::vector <pthread_t> workers;
+		for (int i = 1; i < params.threads; i++)
+		{
+			pthread_t th;
+			if (pthread_create (&th, NULL, combineThread, this))
+			{
+				logStream (MESSAGE_WARNING) << "cannot create combining thread: " << strerror (errno) << sendLog;
+				break;
+			}
+			workers.push_back (th);
+		}
+
+		// calling thread reads the next block, then joins the workers
+		int ret = 0;
+		int next = start + blockRows;
+		if (next < height)
+			ret = readBlock (next, std::min (blockRows, height - next), blocks[1 - cur].data ());
+
+		combineRows ();
+
+		for (std::vector <pthread_t>::iterator iter = workers.begin (); iter != workers.end (); iter++)
+			pthread_join (*iter, NULL);
+
+		if (ret)
+			return -1;
+
+		cur = 1 - cur;
+	}
+
+	block = NULL;
+	return 0;
+}
+
+size_t CalibrationStack::getBufferSize ()
+{
+	return (blocks[0].capacity () + blocks[1].capacity () + master.capacity () + bias.capacity () + dark.capacity ()) * sizeof (float);
+}
+
+double CalibrationStack::getRejected ()
+{
+	if (total == 0)
+		return 0;
+	return (double) rejected / total;
+}
+
+int CalibrationStack::writeMaster (const char *filename, const char *imageType)
+{
+	if (master.empty ())
+	{
+		logStream (MESSAGE_ERROR) << "frames were not combined, cannot write " << filename << sendLog;
+		return -1;
+	}
+
+	fitsfile *ofptr;
+	int status = 0;
+
+	// leading ! tells CFITSIO to overwrite existing file
+	std::string fn = std::string ("!") + filename;
+	fits_create_file (&ofptr, fn.c_str (), &status);
+	if (status)
+	{
+		logFitsError ("cannot create", filename, status);
+		return -1;
+	}
+
+	long sizes[2];
+	sizes[0] = width;
+	sizes[1] = height;
+	fits_create_img (ofptr, FLOAT_IMG, 2, sizes, &status);
+	fits_write_img (ofptr, TFLOAT, 1, master.size (), master.data (), &status);
+
+	// inputs with the same value are recorded with that value
+	std::string type;
+	if (imageType)
+		type = std::string (imageType);
+	else
+		type = inputs[0]->imageType;
+	std::string filter = inputs[0]->filter;
+	std::string camera = inputs[0]->camera;
+	double exp_sum = 0, temp_sum = 0, jd_sum = 0;
+	int exp_n = 0, temp_n = 0, jd_n = 0;
+	double jd_first = NAN, jd_last = NAN;
+	for (std::vector <StackInput *>::iterator iter = inputs.begin (); iter != inputs.end (); iter++)
+	{
+		StackInput *in = *iter;
+		if (imageType == NULL && in->imageType != type)
+			type = "";
+		if (in->filter != filter)
+			filter = "";
+		if (in->camera != camera)
+			camera = "";
+		if (!isnan (in->exposure))
+		{
+			exp_sum += in->exposure;
+			exp_n++;
+		}
+		if (!isnan (in->temperature))
+		{
+			temp_sum += in->temperature;
+			temp_n++;
+		}
+		if (!isnan (in->JD))
+		{
+			jd_sum += in->JD;
+			jd_n++;
+			if (isnan (jd_first) || in->JD < jd_first)
+				jd_first = in->JD;
+			if (isnan (jd_last) || in->JD > jd_last)
+				jd_last = in->JD;
+		}
+	}
+
+	if (!type.empty ())
+		fits_write_key (ofptr, TSTRING, "IMAGETYP", (void *) type.c_str (), "IRAF based image type", &status);
+	if (!filter.empty ())
+		fits_write_key (ofptr, TSTRING, "FILTER", (void *) filter.c_str (), "camera filter as string", &status);
+	if (!camera.empty ())
+		fits_write_key (ofptr, TSTRING, "CCD_NAME", (void *) camera.c_str (), "camera name", &status);
+	if (exp_n > 0)
+	{
+		float v = exp_sum / exp_n;
+		fits_write_key (ofptr, TFLOAT, "EXPOSURE", &v, "average exposure of combined frames", &status);
+	}
+	if (temp_n > 0)
+	{
+		float v = temp_sum / temp_n;
+		fits_write_key (ofptr, TFLOAT, "CCD_TEMP", &v, "average CCD temperature of combined frames", &status);
+	}
+	if (jd_n > 0)
+	{
+		double v = jd_sum / jd_n;
+		fits_write_key (ofptr, TDOUBLE, "JD", &v, "average exposure JD of combined frames", &status);
+		fits_write_key (ofptr, TDOUBLE, "JD_FIRST", &jd_first, "exposure JD of the first frame", &status);
+		fits_write_key (ofptr, TDOUBLE, "JD_LAST", &jd_last, "exposure JD of the last frame", &status);
+	}
+
+	int ncombine = inputs.size ();
+	fits_write_key (ofptr, TINT, "NCOMBINE", &ncombine, "number of combined frames", &status);
+	const char *combtype = params.method == STACK_MEAN ? "mean" : "median";
+	fits_write_key (ofptr, TSTRING, "COMBTYPE", (void *) combtype, "combination method", &status);
+	fits_write_key (ofptr, TFLOAT, "CLIPLOW", &params.kappaLow, "lower rejection limit (sigmas)", &status);
+	fits_write_key (ofptr, TFLOAT, "CLIPHIGH", &params.kappaHigh, "upper rejection limit (sigmas)", &status);
+	fits_write_key (ofptr, TINT, "CLIPITER", &params.iterations, "maximal number of rejection iterations", &status);
+	double rej = getRejected ();
+	fits_write_key (ofptr, TDOUBLE, "REJECTED", &rej, "fraction of rejected values", &status);
+	int norm = params.normalize;
+	fits_write_key (ofptr, TLOGICAL, "NORMALIZ", &norm, "frames were scaled to unity median", &status);
+	if (!biasName.empty ())
+	{
+		char *bn = strdup (biasName.c_str ());
+		fits_write_key (ofptr, TSTRING, "BIASFILE", basename (bn), "subtracted master bias", &status);
+		free (bn);
+	}
+	if (!darkName.empty ())
+	{
+		char *dn = strdup (darkName.c_str ());
+		fits_write_key (ofptr, TSTRING, "DARKFILE", basename (dn), "subtracted master dark", &status);
+		free (dn);
+	}
+
+	double sum = 0, sum2 = 0;
+	size_t cnt = 0;
+	for (std::vector <float>::iterator iter = master.begin (); iter != master.end (); iter++)
+	{
+		if (isnan (*iter))
+			continue;
+		sum += *iter;
+		sum2 += (double) *iter * *iter;
+		cnt++;
+	}
+	if (cnt > 1)
+	{
+		double avg = sum / cnt;
+		double stdev = sqrt ((sum2 - sum * avg) / (cnt - 1));
+		fits_write_key (ofptr, TDOUBLE, "AVERAGE", &avg, "average value of image", &status);
+		fits_write_key (ofptr, TDOUBLE, "STDEV", &stdev, "standard deviation value of image", &status);
+	}
+
+	for (size_t i = 0; i < inputs.size () && i < MAX_IMCMB; i++)
+	{
+		char key[FLEN_KEYWORD];
+		snprintf (key, FLEN_KEYWORD, "IMCMB%03d", (int) i + 1);
+		char *in = strdup (inputs[i]->getName ());
+		fits_write_key (ofptr, TSTRING, key, basename (in), "combined frame", &status);
+		free (in);
+		if (params.normalize)
+		{
+			snprintf (key, FLEN_KEYWORD, "IMSCL%03d", (int) i + 1);
+			fits_write_key (ofptr, TFLOAT, key, &(scales[i]), "normalization scale of the frame", &status);
+		}
+	}
+
+	fits_write_date (ofptr, &status);
+	fits_write_history (ofptr, "combined by RTS2 calibration stacking", &status);
+
+	fits_close_file (ofptr, &status);
+	if (status)
+	{
+		logFitsError ("cannot write", filename, status);
+		return -1;
+	}
+	return 0;
+}
+
+float CalibrationStack::combineMedian (float *values, size_t n, float *scratch, float kappaLow, float kappaHigh, int iterations, size_t &used)
+{
+	size_t m = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		values[m] = values[i];
+		m += !isnan (values[i]);
+	}
+	used = m;
+	if (m == 0)
+		return NAN;
+
+	float med = selectMedian (values, m);
+	for (int it = 0; it < iterations && m > 2; it++)
+	{
+		for (size_t i = 0; i < m; i++)
+			scratch[i] = fabsf (values[i] - med);
+		float s = selectMedian (scratch, m) * MAD_SIGMA;
+		// integer data with low noise can have zero median absolute deviation
+		if (s == 0)
+		{
+			double s2 = 0;
+			for (size_t i = 0; i < m; i++)
+				s2 += scratch[i] * scratch[i];
+			s = sqrt (s2 / (m - 1));
+			if (s == 0)
+				break;
+		}
+
+		float lo = med - kappaLow * s;
+		float hi = med + kappaHigh * s;
+		size_t j = 0;
+		for (size_t i = 0; i < m; i++)
+		{
+			values[j] = values[i];
+			j += (values[i] >= lo && values[i] <= hi);
+		}
+		if (j == m || j == 0)
+			break;
+		m = j;
+		med = selectMedian (values, m);
+	}
+	used = m;
+	return med;
+}
+
+void CalibrationStack::combineMean (const float **rows, size_t n, int w, float kappaLow, float kappaHigh, int iterations, float *out, float *used, float *scratch)
+{
+	float *sum = scratch;
+	float *cnt = scratch + w;
+	float *lo = scratch + 2 * w;
+	float *hi = scratch + 3 * w;
+	float *mean = scratch + 4 * w;
+	float *dev = scratch + 5 * w;
+
+	// NAN values fail the comparisons, so they are never used
+	for (int x = 0; x < w; x++)
+	{
+		lo[x] = -INFINITY;
+		hi[x] = INFINITY;
+	}
+
+	// Loops over pixels of a row have no branches, so compiler can
+	// vectorize them. Conditions only select between already loaded
+	// values; with other arithmetic in a condition, GCC does not vectorize
+	// the loop as it might raise floating point exception.
+	float prev = -1;
+	for (int it = 0; ; it++)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			sum[x] = 0;
+			cnt[x] = 0;
+		}
+		for (size_t i = 0; i < n; i++)
+		{
+			const float *r = rows[i];
+			for (int x = 0; x < w; x++)
+			{
+				float v = r[x];
+				bool in = (v >= lo[x]) & (v <= hi[x]);
+				sum[x] += in ? v : 0;
+				cnt[x] += in;
+			}
+		}
+
+		float c = 0;
+		for (int x = 0; x < w; x++)
+			c += cnt[x];
+		// no value was rejected or readmitted
+		if (it >= iterations || c == prev)
+			break;
+		prev = c;
+
+		// deviations are summed in a second pass, as sum of squares is not precise enough in floats
+		for (int x = 0; x < w; x++)
+		{
+			mean[x] = sum[x] / cnt[x];
+			dev[x] = 0;
+		}
+		for (size_t i = 0; i < n; i++)
+		{
+			const float *r = rows[i];
+			for (int x = 0; x < w; x++)
+			{
+				float v = r[x];
+				float m = mean[x];
+				bool in = (v >= lo[x]) & (v <= hi[x]);
+				float d = (in ? v : m) - m;
+				dev[x] += d * d;
+			}
+		}
+
+		for (int x = 0; x < w; x++)
+		{
+			float s = sqrtf (dev[x] / (cnt[x] - 1));
+			// keep limits of pixels with too few values to estimate sigma
+			bool clip = cnt[x] > 2;
+			lo[x] = clip ? mean[x] - kappaLow * s : lo[x];
+			hi[x] = clip ? mean[x] + kappaHigh * s : hi[x];
+		}
+	}
+
+	for (int x = 0; x < w; x++)
+	{
+		out[x] = cnt[x] > 0 ? sum[x] / cnt[x] : NAN;
+		used[x] = cnt[x];
+	}
+}
+
+void CalibrationStack::combineRows ()
+{
+	size_t n = inputs.size ();
+	std::vector <const float *> rows (n);
+	std::vector <float> values (n);
+	std::vector <float> scratch (n);
+	std::vector <float> used (width);
+	std::vector <float> meanScratch (params.method == STACK_MEAN ? 6 * width : 0);
+
+	size_t rej = 0;
+	size_t tot = 0;
+
+	while (true)
+	{
+		pthread_mutex_lock (&rowMutex);
+		int r = nextRow;
+		nextRow++;
+		pthread_mutex_unlock (&rowMutex);
+
+		if (r >= blockLength)
+			break;
+
+		for (size_t i = 0; i < n; i++)
+			rows[i] = block + (i * blockRows + r) * width;
+		float *out = master.data () + (size_t) (blockStart + r) * width;
+
+		if (params.method == STACK_MEAN)
+		{
+			combineMean (rows.data (), n, width, params.kappaLow, params.kappaHigh, params.iterations, out, used.data (), meanScratch.data ());
+			for (int x = 0; x < width; x++)
+				rej += n - (size_t) used[x];
+		}
+		else
+		{
+			for (int x = 0; x < width; x++)
+			{
+				for (size_t i = 0; i < n; i++)
+					values[i] = rows[i][x];
+				size_t u;
+				out[x] = combineMedian (values.data (), n, scratch.data (), params.kappaLow, params.kappaHigh, params.iterations, u);
+				rej += n - u;
+			}
+		}
+		tot += n * width;
+	}
+
+	pthread_mutex_lock (&rowMutex);
+	rejected += rej;
+	total += tot;
+	pthread_mutex_unlock (&rowMutex);
+}
+
+int CalibrationStack::checkSize (StackInput *input)
+{
+	if (input->getWidth () != width || input->getHeight () != height)
+	{
+		logStream (MESSAGE_ERROR) << "size of " << input->getName () << " (" << input->getWidth () << "x" << input->getHeight () << ") differs from size of the first frame (" << width << "x" << height << ")" << sendLog;
+		return -1;
+	}
+	return 0;
+}
+
+int CalibrationStack::readFrame (StackInput &input, std::vector <float> &data)
+{
+	data.resize ((size_t) input.getWidth () * input.getHeight ());
+	if (input.readRows (0, input.getHeight (), data.data ()))
+	{
+		data.clear ();
+		return -1;
+	}
+	return 0;
+}
+
+int CalibrationStack::readBlock (int start, int nrows, float *buf)
+{
+	for (size_t i = 0; i < inputs.size (); i++)
+	{
+		float *b = buf + i * blockRows * width;
+		if (inputs[i]->readRows (start, nrows, b))
+			return -1;
+		calibrate (i, start, nrows, b);
+	}
+	return 0;
+}
+
+void CalibrationStack::calibrate (size_t i, int row, int nrows, float *buf)
+{
+	size_t n = (size_t) nrows * width;
+	size_t off = (size_t) row * width;
+	if (!bias.empty ())
+	{
+		const float *b = bias.data () + off;
+		for (size_t k = 0; k < n; k++)
+			buf[k] -= b[k];
+	}
+	if (!dark.empty ())
+	{
+		const float *d = dark.data () + off;
+		float ds = darkScales[i];
+		for (size_t k = 0; k < n; k++)
+			buf[k] -= ds * d[k];
+	}
+	float s = scales[i];
+	if (s != 1)
+	{
+		for (size_t k = 0; k < n; k++)
+			buf[k] *= s;
+	}
+}
+
+int CalibrationStack::estimateScales ()
+{
+	int step = std::max (1, params.sampleStep);
+	std::vector <float> row (width);
+	std::vector <float> sample;
+
+	for (size_t i = 0; i < inputs.size (); i++)
+	{
+		sample.clear ();
+		for (int r = step / 2; r < height; r += step)
+		{
+			if (inputs[i]->readRows (r, 1, row.data ()))
+				return -1;
+			calibrate (i, r, 1, row.data ());
+			for (int x = step / 2; x < width; x += step)
+			{
+				if (!isnan (row[x]))
+					sample.push_back (row[x]);
+			}
+		}
+		float med = selectMedian (sample.data (), sample.size ());
+		if (!(med > 0))
+		{
+			logStream (MESSAGE_ERROR) << "cannot normalize " << inputs[i]->getName () << ", its median is " << med << sendLog;
+			return -1;
+		}
+		scales[i] = 1 / med;
+	}
+	return 0;
+}
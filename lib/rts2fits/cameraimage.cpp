@@ -123,6 +123,30 @@ bool CameraImage::waitForMetaData ()
 	return !(deviceWaits.empty () && triggerWaits.empty ());
 }
 
+void CameraImage::writeTrace ()
+{
+	struct
+	{
+		const char *name;
+		rts2core::traceStage_t from;
+		rts2core::traceStage_t to;
+		const char *desc;
+	} keys[] = {
+		{"LAT_RDST", rts2core::TRACE_EXPOSURE_END, rts2core::TRACE_READOUT_START, "[s] exposure end to readout start"},
+		{"LAT_READ", rts2core::TRACE_READOUT_START, rts2core::TRACE_DATA_START, "[s] readout start to first data received"},
+		{"LAT_XFER", rts2core::TRACE_DATA_START, rts2core::TRACE_DATA_END, "[s] data transfer"},
+		{"LAT_FITS", rts2core::TRACE_DATA_END, rts2core::TRACE_FITS_WRITTEN, "[s] data received to data written to FITS"},
+		{"LAT_TOTL", rts2core::TRACE_EXPOSURE_END, rts2core::TRACE_FITS_WRITTEN, "[s] exposure end to data written to FITS"}
+	};
+
+	for (size_t i = 0; i < sizeof (keys) / sizeof (keys[0]); i++)
+	{
+		double l = trace.interval (keys[i].from, keys[i].to);
+		if (!std::isnan (l))
+			image->setValue (keys[i].name, l, keys[i].desc);
+	}
+}
+
 CameraImages::~CameraImages (void)
 {
 	for (CameraImages::iterator iter = begin (); iter != end (); iter++)
@@ -0,0 +1,360 @@
+/*
+ * FITS tile compression of image channels.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "rts2fits/compression.h"
+#include "imghdr.h"
+#include "app.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+using namespace rts2image;
+
+/**
+ * Converts RTS2 data type to CFITSIO data type used in fits_write_img call.
+ */
+static int fitsWriteType (int dataType)
+{
+	switch (dataType)
+	{
+		case RTS2_DATA_BYTE:
+			return TBYTE;
+		case RTS2_DATA_SHORT:
+			return TSHORT;
+		case RTS2_DATA_LONG:
+			return TINT;
+		case RTS2_DATA_LONGLONG:
+			return TLONGLONG;
+		case RTS2_DATA_FLOAT:
+			return TFLOAT;
+		case RTS2_DATA_DOUBLE:
+			return TDOUBLE;
+		case RTS2_DATA_SBYTE:
+			return TSBYTE;
+		case RTS2_DATA_USHORT:
+			return TUSHORT;
+		case RTS2_DATA_ULONG:
+			return TUINT;
+	}
+	return -1;
+}
+
+static void *compressThread (void *arg)
+{
+	ChannelCompressor *compressor = (ChannelCompressor *) arg;
+	while (compressor->compressNext ())
+	{
+	}
+	return NULL;
+}
+
+int TileCompression::setType (const char *name)
+{
+	if (name == NULL || strlen (name) == 0 || !strcasecmp (name, "none"))
+		type = 0;
+	else if (!strcasecmp (name, "rice"))
+		type = RICE_1;
+	else if (!strcasecmp (name, "hcompress"))
+		type = HCOMPRESS_1;
+	else if (!strcasecmp (name, "gzip"))
+		type = GZIP_1;
+	else if (!strcasecmp (name, "gzip2"))
+		type = GZIP_2;
+	else if (!strcasecmp (name, "plio"))
+		type = PLIO_1;
+	else
+		return -1;
+	return 0;
+}
+
+const char *TileCompression::getTypeName ()
+{
+	switch (type)
+	{
+		case RICE_1:
+			return "rice";
+		case HCOMPRESS_1:
+			return "hcompress";
+		case GZIP_1:
+			return "gzip";
+		case GZIP_2:
+			return "gzip2";
+		case PLIO_1:
+			return "plio";
+	}
+	return "none";
+}
+
+int TileCompression::setFileCompression (fitsfile *fptr, int dataType, long sizes[2], int *status)
+{
+	int ctype = type;
+	bool floatData = (dataType == RTS2_DATA_FLOAT || dataType == RTS2_DATA_DOUBLE);
+
+	// Rice and HCOMPRESS can compress floating point data only after quantization
+	if (floatData && quantize <= 0 && (ctype == RICE_1 || ctype == HCOMPRESS_1 || ctype == PLIO_1))
+		ctype = GZIP_2;
+
+	fits_set_compression_type (fptr, ctype, status);
+
+	long tile[2];
+	tile[0] = sizes[0];
+	tile[1] = tileRows;
+	if (tile[1] <= 0)
+		tile[1] = (ctype == HCOMPRESS_1) ? 16 : 1;
+	if (tile[1] > sizes[1])
+		tile[1] = sizes[1];
+	fits_set_tile_dim (fptr, 2, tile, status);
+
+	if (floatData)
+	{
+		if (quantize > 0)
+		{
+			fits_set_quantize_level (fptr, quantize, status);
+			fits_set_quantize_method (fptr, SUBTRACTIVE_DITHER_1, status);
+		}
+		else
+		{
+			fits_set_quantize_level (fptr, 0, status);
+		}
+	}
+	return *status ? -1 : 0;
+}
+
+ChannelCompressor::ChannelCompressor (TileCompression &_compression)
+{
+	compression = _compression;
+	nextJob = 0;
+	pthread_mutex_init (&jobMutex, NULL);
+}
+
+ChannelCompressor::~ChannelCompressor ()
+{
+	clear ();
+	pthread_mutex_destroy (&jobMutex);
+}
+
+int ChannelCompressor::compress (rts2core::DataChannels *data)
+{
+	clear ();
+
+	for (rts2core::DataChannels::iterator iter = data->begin (); iter != data->end (); iter++)
+	{
+		CompressJob *job = new CompressJob;
+		job->data = (*iter)->getDataBuff ();
+		job->top = (*iter)->getDataTop ();
+		job->channel = ntohs (((struct imghdr *) job->data)->channel);
+		job->memptr = NULL;
+		job->memsize = 0;
+		job->fptr = NULL;
+		job->status = 0;
+		jobs.push_back (job);
+	}
+
+	int nthreads = compression.threads;
+	if ((size_t) nthreads > jobs.size ())
+		nthreads = jobs.size ();
+
+	// CFITSIO compression routines are not thread safe unless library was build reentrant
+	if (nthreads > 1 && !fits_is_reentrant ())
+	{
+		logStream (MESSAGE_WARNING) << "CFITSIO library is not reentrant, compressing channels in a single thread" << sendLog;
+		nthreads = 1;
+	}
+
+	std::vector <pthread_t> workers;
+	for (int i = 1; i < nthreads; i++)
+	{
+		pthread_t th;
+		if (pthread_create (&th, NULL, compressThread, this))
+		{
+			logStream (MESSAGE_ERROR) << "cannot create compression thread: " << strerror (errno) << sendLog;
+			break;
+		}
+		workers.push_back (th);
+	}
+
+	// calling thread is compressing too
+	compressThread (this);
+
+	for (std::vector <pthread_t>::iterator iter = workers.begin (); iter != workers.end (); iter++)
+		pthread_join (*iter, NULL);
+
+	int ret = 0;
+	for (std::vector <CompressJob *>::iterator iter = jobs.begin (); iter != jobs.end (); iter++)
+	{
+		if ((*iter)->status)
+		{
+			char errtext[FLEN_STATUS];
+			fits_get_errstatus ((*iter)->status, errtext);
+			logStream (MESSAGE_ERROR) << "cannot compress channel " << (*iter)->channel << ": " << errtext << sendLog;
+			ret = -1;
+		}
+	}
+	return ret;
+}
+
+int ChannelCompressor::compress (char *in_data, char *fullTop)
+{
+	int channel = ntohs (((struct imghdr *) in_data)->channel);
+
+	// replace only previous (failed) result of this channel, keep results of other channels
+	for (std::vector <CompressJob *>::iterator iter = jobs.begin (); iter != jobs.end ();)
+	{
+		if ((*iter)->channel == channel)
+		{
+			freeJob (*iter);
+			iter = jobs.erase (iter);
+		}
+		else
+		{
+			iter++;
+		}
+	}
+
+	CompressJob *job = new CompressJob;
+	job->data = in_data;
+	job->top = fullTop;
+	job->channel = channel;
+	job->memptr = NULL;
+	job->memsize = 0;
+	job->fptr = NULL;
+	job->status = 0;
+	jobs.push_back (job);
+
+	runJob (job);
+	nextJob = jobs.size ();
+
+	return job->status ? -1 : 0;
+}
+
+int ChannelCompressor::appendTo (int channel, fitsfile *out, int *status)
+{
+	for (std::vector <CompressJob *>::iterator iter = jobs.begin (); iter != jobs.end (); iter++)
+	{
+		CompressJob *job = *iter;
+		if (job->channel != channel || job->fptr == NULL || job->status)
+			continue;
+
+		// compressed image is in the first extension, primary HDU is empty
+		fits_movabs_hdu (job->fptr, 2, NULL, status);
+		fits_copy_hdu (job->fptr, out, 0, status);
+		return *status ? -1 : 0;
+	}
+	return -1;
+}
+
+size_t ChannelCompressor::getCompressedSize ()
+{
+	size_t ret = 0;
+	for (std::vector <CompressJob *>::iterator iter = jobs.begin (); iter != jobs.end (); iter++)
+	{
+		if ((*iter)->fptr == NULL || (*iter)->status)
+			continue;
+		int status = 0;
+		LONGLONG headstart, datastart, dataend;
+		fits_movabs_hdu ((*iter)->fptr, 2, NULL, &status);
+		fits_get_hduaddrll ((*iter)->fptr, &headstart, &datastart, &dataend, &status);
+		if (status == 0)
+			ret += dataend - headstart;
+	}
+	return ret;
+}
+
+size_t ChannelCompressor::getRawSize ()
+{
+	size_t ret = 0;
+	for (std::vector <CompressJob *>::iterator iter = jobs.begin (); iter != jobs.end (); iter++)
+		ret += ((*iter)->top - (*iter)->data) - sizeof (struct imghdr);
+	return ret;
+}
+
+void ChannelCompressor::clear ()
+{
+	for (std::vector <CompressJob *>::iterator iter = jobs.begin (); iter != jobs.end (); iter++)
+		freeJob (*iter);
+	jobs.clear ();
+	nextJob = 0;
+}
+
+void ChannelCompressor::freeJob (CompressJob *job)
+{
+	if (job->fptr)
+	{
+		int status = 0;
+		fits_close_file (job->fptr, &status);
+	}
+	free (job->memptr);
+	delete job;
+}
+
+bool ChannelCompressor::compressNext ()
+{
+	pthread_mutex_lock (&jobMutex);
+	if (nextJob >= jobs.size ())
+	{
+		pthread_mutex_unlock (&jobMutex);
+		return false;
+	}
+	CompressJob *job = jobs[nextJob];
+	nextJob++;
+	pthread_mutex_unlock (&jobMutex);
+
+	runJob (job);
+	return true;
+}
+
+void ChannelCompressor::runJob (CompressJob *job)
+{
+	struct imghdr *im_h = (struct imghdr *) job->data;
+	int dataType = ntohs (im_h->data_type);
+	int writeType = fitsWriteType (dataType);
+	if (writeType < 0)
+	{
+		job->status = BAD_DATATYPE;
+		return;
+	}
+
+	long sizes[2];
+	sizes[0] = ntohl (im_h->sizes[0]);
+	sizes[1] = ntohl (im_h->sizes[1]);
+
+	char *pixelData = job->data + sizeof (struct imghdr);
+	long pixels = sizes[0] * sizes[1];
+
+	// compressed data are usually smaller then raw, so half of raw data size is a good starting point
+	job->memsize = ((job->top - pixelData) / 2 / 2880 + 1) * 2880;
+	job->memptr = malloc (job->memsize);
+
+	fits_create_memfile (&(job->fptr), &(job->memptr), &(job->memsize), job->memsize, realloc, &(job->status));
+	if (job->status)
+	{
+		job->fptr = NULL;
+		return;
+	}
+
+	compression.setFileCompression (job->fptr, dataType, sizes, &(job->status));
+
+	// with compression enabled, CFITSIO creates null primary HDU and the compressed image as its first extension
+	fits_create_img (job->fptr, dataType == RTS2_DATA_SBYTE ? RTS2_DATA_BYTE : dataType, 2, sizes, &(job->status));
+	fits_write_img (job->fptr, writeType, 1, pixels, pixelData, &(job->status));
+	fits_flush_file (job->fptr, &(job->status));
+}
@@ -91,6 +91,13 @@ imageProceRes DevClientCameraFoc::processImage (Image * image)
 		connection->getMaster ()->addConnection (focConn);
 		return IMAGE_KEEP_COPY;
 	}
+	if (image->getShutter () == SHUT_OPENED)
+	{
+		// without focusing script, use built-in star detection
+		ret = image->findStars (0);
+		if (ret >= 0)
+			logStream (MESSAGE_DEBUG) << "found " << ret << " stars, background " << image->median << " noise " << image->sigma << sendLog;
+	}
 	return res;
 }
 
@@ -73,6 +73,14 @@ DevClientCameraImage::DevClientCameraImage (rts2core::Connection * in_connection
 		}
 	}
 
+	std::string compressionName;
+	config->getString (connection->getName (), "compression", compressionName, "none");
+	if (compression.setType (compressionName.c_str ()))
+		logStream (MESSAGE_ERROR) << "unknown compression " << compressionName << ", images will not be compressed" << sendLog;
+	config->getInteger (connection->getName (), "compression_tile_rows", compression.tileRows, 0);
+	config->getFloat (connection->getName (), "compression_quantize", compression.quantize, 4);
+	config->getInteger (connection->getName (), "compression_threads", compression.threads, 1);
+
 	actualImage = NULL;
 
 	expNum = 0;
@@ -181,6 +189,7 @@ void DevClientCameraImage::cameraMetadata (Image *image)
 {
 	double exposureTime = getConnection ()->getValueDouble ("exposure");
 	image->setTemplate (fitsTemplate);
+	image->setCompression (compression);
 
 	image->setExposureLength (exposureTime);
 	
@@ -269,6 +278,9 @@ void DevClientCameraImage::newDataConn (int data_conn)
 		}
 		connection->postMaster (new rts2core::Event (EVENT_WRITE_TO_IMAGE, actualImage));
 	}
+	// camera sends stamps before data
+	actualImage->trace.set (rts2core::TRACE_EXPOSURE_END, getConnection ()->getValueDouble ("trace_exposure_end"));
+	actualImage->trace.set (rts2core::TRACE_READOUT_START, getConnection ()->getValueDouble ("trace_readout_start"));
 	images[data_conn] = actualImage;
 	actualImage = NULL;
 }
@@ -288,6 +300,9 @@ void DevClientCameraImage::allImageDataReceived (int data_conn, rts2core::DataCh
 	{
 		CameraImage *ci = (*iter).second;
 
+		ci->trace.set (rts2core::TRACE_DATA_START, data->dataStart);
+		ci->trace.set (rts2core::TRACE_DATA_END, data->dataEnd);
+
 		ci->writeMetaData ((struct imghdr *) ((*(data->begin ()))->getDataBuff ()));
 
 		// detector coordinates,..
@@ -304,6 +319,10 @@ void DevClientCameraImage::allImageDataReceived (int data_conn, rts2core::DataCh
 		rts2core::DoubleArray *trim_x2 = getDoubleArray ("TRIM_X2");
 		rts2core::DoubleArray *trim_y2 = getDoubleArray ("TRIM_Y2");
 
+		// compress all channels at once, so they can be compressed in parallel
+		if (data2fits)
+			ci->image->compressChannels (data);
+
 		for (rts2core::DataChannels::iterator di = data->begin (); di != data->end (); di++)
 		{
 			ci->writeData ((*di)->getDataBuff (), (*di)->getDataTop (), data2fits ? data->size () : -data->size ());
@@ -435,6 +454,9 @@ void DevClientCameraImage::allImageDataReceived (int data_conn, rts2core::DataCh
 			}
 		}
 
+		if (data2fits)
+			ci->trace.mark (rts2core::TRACE_FITS_WRITTEN);
+
 		ci->image->moveHDU (1);
 
 		cameraImageReady (ci->image);
@@ -534,9 +556,11 @@ void DevClientCameraImage::processCameraImage (CameraImages::iterator cis)
 		beforeProcess (ci->image);
 		if (saveImage)
 		{
+			ci->writeTrace ();
 			// set filter..
 			// save us to the disk..
 			ci->image->saveImage ();
+			ci->trace.mark (rts2core::TRACE_IMAGE_SAVED);
 		}
 		// do basic processing
 		imageProceRes res = processImage (ci->image);
@@ -544,6 +568,8 @@ void DevClientCameraImage::processCameraImage (CameraImages::iterator cis)
 		{
 			setImage (ci->image, NULL);
 		}
+		ci->trace.mark (rts2core::TRACE_PROCESSED);
+		logStream (MESSAGE_DEBUG) << "image trace: " << ci->trace << sendLog;
 	}
 	catch (rts2core::Error &ex)
 	{
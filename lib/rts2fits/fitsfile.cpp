@@ -616,6 +616,12 @@ void FitsFile::getValue (const char *name, char *value, int valLen, const char*
 		}
 		else
 		{
+			// val holds value from the previous call
+			if (fits_status && defVal)
+			{
+				strncpy (value, defVal, valLen);
+				value[valLen - 1] = '\0';
+			}
 			fits_status = 0;
 			return;
 		}
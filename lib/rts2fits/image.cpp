@@ -115,6 +115,8 @@ void Image::initData ()
 
 	writeConnection = true;
 	writeRTS2Values = true;
+
+	compressor = NULL;
 }
 
 
@@ -180,6 +182,9 @@ Image::Image (Image * in_image):FitsFile (in_image)
 
 	shutter = in_image->getShutter ();
 
+	compression = in_image->compression;
+	compressor = NULL;
+
 	// other image will be saved!
 	flags = in_image->flags;
 	//in_image->flags &= ~IMAGE_SAVE;
@@ -289,6 +294,8 @@ Image::~Image (void)
 		arrayGroups.erase (iter++);
 	}
 
+	delete compressor;
+
 	delete[]templateDeviceName;
 	delete[]targetName;
 	delete[]cameraName;
@@ -586,6 +593,9 @@ int Image::closeFile ()
 			logStream (MESSAGE_WARNING) << "error saving " << getAbsoluteFileName () << ":" << er << sendLog;
 		}
 	}
+	// compressed channels are already in the file
+	delete compressor;
+	compressor = NULL;
 	return FitsFile::closeFile ();
 }
 
@@ -1000,7 +1010,15 @@ int Image::writeData (char *in_data, char *fullTop, int nchan)
 
 	// either put it as a new extension, or keep it in primary..
 
-	if (nchan == 1)
+	if (compression.isCompressed () && nchan > 0)
+	{
+		// compressed image cannot be stored in primary HDU
+		if (writeCompressedData (in_data, fullTop))
+			return -1;
+		if (nchan == 1)
+			setValue ("INHERIT", true, "inherit key-values pairs from master HDU");
+	}
+	else if (nchan == 1)
 	{
 		if (dataType == RTS2_DATA_SBYTE)
 			fits_resize_img (getFitsFile (), RTS2_DATA_BYTE, 2, sizes, &fits_status);
@@ -1033,7 +1051,7 @@ int Image::writeData (char *in_data, char *fullTop, int nchan)
 
 	long pixelSize = dataSize / getPixelByteSize ();
 
-	if (nchan > 0)
+	if (nchan > 0 && !compression.isCompressed ())
 	{
 		switch (dataType)
 		{
@@ -1085,6 +1103,37 @@ int Image::writeData (char *in_data, char *fullTop, int nchan)
 	return ret;
 }
 
+int Image::compressChannels (rts2core::DataChannels *data)
+{
+	if (!compression.isCompressed () || !getFitsFile () || !(flags & IMAGE_SAVE))
+		return 0;
+
+	if (compressor == NULL)
+		compressor = new ChannelCompressor (compression);
+
+	return compressor->compress (data);
+}
+
+int Image::writeCompressedData (char *in_data, char *fullTop)
+{
+	int chan = ntohs (((struct imghdr *) in_data)->channel);
+
+	if (compressor == NULL)
+		compressor = new ChannelCompressor (compression);
+
+	// channel was not compressed by compressChannels, compress it now
+	if (compressor->appendTo (chan, getFitsFile (), &fits_status))
+	{
+		fits_status = 0;
+		if (compressor->compress (in_data, fullTop) || compressor->appendTo (chan, getFitsFile (), &fits_status))
+		{
+			logStream (MESSAGE_ERROR) << "cannot write compressed image: " << getFitsErrors () << " dataType " << dataType << sendLog;
+			return -1;
+		}
+	}
+	return 0;
+}
+
 void Image::getImgHeader (struct imghdr *im_h, int chan)
 {
 	int i;
@@ -1,355 +1,494 @@
+/*
+ * Star detection and centroiding kernels.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
 #include <math.h>
-#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <vector>
-#include <string>
 #include <algorithm>
-#include <functional>
 
+#include "rts2fits/imageprocess.h"
 #include "rts2fits/image.h"
 
-#define APP_SIZE        3
-
-using namespace std;
+// FWHM of Gaussian profile in sigmas
+#define FWHM_SIGMA      2.35482
 
-namespace rts2image
-{
+using namespace rts2image;
 
-struct pint
+float rts2image::selectMedian (float *buf, size_t n)
 {
-	float radius;
-	unsigned short value;
-};
+	if (n == 0)
+		return NAN;
+	size_t h = n / 2;
+	std::nth_element (buf, buf + h, buf + n);
+	float m = buf[h];
+	// lower middle value is the largest of the lower half
+	if (n % 2 == 0)
+		m = (m + *std::max_element (buf, buf + h)) / 2;
+	return m;
+}
 
-class comparePixel
+void rts2image::sigmaClip (float *buf, size_t n, float kappa, int iterations, float &median, float &sigma)
 {
-	public:
-		bool operator () (struct pixel x, struct pixel y) const
+	std::vector <float> dev (n);
+	for (int it = 0; ; it++)
+	{
+		float m = selectMedian (buf, n);
+		for (size_t i = 0; i < n; i++)
+			dev[i] = fabsf (buf[i] - m);
+		float s = selectMedian (dev.data (), n) * 1.4826;
+		// integer data with low noise can have zero median absolute deviation
+		if (s == 0 && n > 1)
 		{
-			return x.value > y.value;
+			double s2 = 0;
+			for (size_t i = 0; i < n; i++)
+				s2 += dev[i] * dev[i];
+			s = sqrt (s2 / (n - 1));
 		}
-};
+		// all remaining values are equal, keep previous estimate
+		if (s == 0 && it > 0)
+			break;
+		median = m;
+		sigma = s;
+		if (it >= iterations || sigma == 0)
+			break;
 
-class comparePint
-{
-	public:
-		bool operator     () (struct pint x, struct pint y) const
+		float lo = median - kappa * sigma;
+		float hi = median + kappa * sigma;
+		size_t j = 0;
+		for (size_t i = 0; i < n; i++)
 		{
-			return x.value > y.value;
+			buf[j] = buf[i];
+			j += (buf[i] >= lo && buf[i] <= hi);
 		}
-};
-
-}
-
-using namespace rts2image;
-
-static int cmpdouble (const void *a, const void *b)
-{
-	if (*((double *) a) > *((double *) b))
-		return 1;
-	if (*((double *) a) < *((double *) b))
-		return -1;
-	return 0;
+		if (j == n || j == 0)
+			break;
+		n = j;
+	}
 }
 
-double Image::classicMedian (double *q, int n, double *retsigma)
+void rts2image::gaussianKernel (float fwhm, std::vector <float> &kernel)
 {
-	int i;
-	double *f, M, S;
-
-	f = (double *) malloc (n * sizeof (double));
-
-	memcpy (f, q, n * sizeof (double));
-	qsort (f, n, sizeof (double), cmpdouble);
-
-	if (n % 2)
-		M = f[n / 2];
-	else
-		M = f[n / 2] / 2 + f[n / 2 + 1] / 2;
-
-	if (retsigma)
+	double s = fwhm / FWHM_SIGMA;
+	int r = (int) ceil (3 * s);
+	if (r < 1)
+		r = 1;
+	kernel.resize (2 * r + 1);
+	double sum = 0;
+	for (int i = -r; i <= r; i++)
 	{
-		for (i = 0; i < n; i++)
-			f[i] = fabs (f[i] - M) * 0.6745;
-
-		qsort (f, n, sizeof (double), cmpdouble);
-
-		if (n % 2)
-			S = f[n / 2];
-		else
-			S = f[n / 2] / 2 + f[n / 2 + 1] / 2;
-
-		*retsigma = S;
+		kernel[i + r] = exp (-i * i / (2 * s * s));
+		sum += kernel[i + r];
 	}
-	free (f);
-
-	return M;
+	for (std::vector <float>::iterator iter = kernel.begin (); iter != kernel.end (); iter++)
+		*iter /= sum;
 }
 
-int Image::findMaxIntensity (unsigned short *in_data, struct pixel *ret)
+void rts2image::convolveSeparable (const float *in, float *out, int w, int h, const std::vector <float> &kernel)
 {
-	int x, y, max_x, max_y, pix = 0;
+	int r = kernel.size () / 2;
+	std::vector <float> tmp ((size_t) w * h);
 
-	for (x = 0; x < getChannelWidth (0); x++)
+	// rows; inner loops run over contiguous pixels, so compiler can vectorize them
+	int x0 = std::min (r, w);
+	int x1 = std::max (x0, w - r);
+	for (int y = 0; y < h; y++)
 	{
-		for (y = 0; y < getChannelHeight (0); y++)
+		const float *row = in + (size_t) y * w;
+		float *t = tmp.data () + (size_t) y * w;
+		for (int x = x0; x < x1; x++)
+			t[x] = 0;
+		for (int k = 0; k <= 2 * r; k++)
 		{
-			if (getPixel (in_data, x, y) > pix)
-			{
-				max_x = x;
-				max_y = y;
-				pix = getPixel (in_data, x, y);
-			}
+			float kv = kernel[k];
+			const float *src = row + k - r;
+			for (int x = x0; x < x1; x++)
+				t[x] += kv * src[x];
+		}
+		// edges, extended by border pixels
+		for (int x = 0; x < w; x++)
+		{
+			if (x == x0)
+				x = x1;
+			if (x >= w)
+				break;
+			float s = 0;
+			for (int k = -r; k <= r; k++)
+				s += kernel[k + r] * row[std::min (std::max (x + k, 0), w - 1)];
+			t[x] = s;
 		}
 	}
-	ret->x = max_x;
-	ret->y = max_y;
 
-	return 0;
+	// columns, adding whole rows
+	for (int y = 0; y < h; y++)
+	{
+		float *o = out + (size_t) y * w;
+		for (int x = 0; x < w; x++)
+			o[x] = 0;
+		for (int k = -r; k <= r; k++)
+		{
+			float kv = kernel[k + r];
+			const float *src = tmp.data () + (size_t) std::min (std::max (y + k, 0), h - 1) * w;
+			for (int x = 0; x < w; x++)
+				o[x] += kv * src[x];
+		}
+	}
 }
 
-unsigned short Image::getPixel (unsigned short *in_data, int x, int y)
+static int findRoot (std::vector <int> &parent, int i)
 {
-	return in_data[x + (getChannelWidth (0) * y)];
+	while (parent[i] != i)
+	{
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
 }
 
-int Image::findStar (unsigned short *in_data)
+// component root is always its smallest label
+static void unite (std::vector <int> &parent, int a, int b)
 {
-	float cols_sum[APP_SIZE];
-	unsigned short *row_start_ptr, *data_ptr;
-	float sum;
-	int r, c, i, j, x;
-	struct pixel tmp;
-	bool first = true;
-	bool sedi = true;
+	a = findRoot (parent, a);
+	b = findRoot (parent, b);
+	if (a < b)
+		parent[b] = a;
+	else if (b < a)
+		parent[a] = b;
+}
 
-	assert (getChannelWidth (0) >= APP_SIZE && getChannelHeight (0) >= APP_SIZE);
+int rts2image::labelComponents (const float *in, int w, int h, float thresh, int *labels)
+{
+	// label 0 is background
+	std::vector <int> parent (1, 0);
 
-	for (r = 0; r < getChannelHeight (0) - APP_SIZE; r++)
+	for (int y = 0; y < h; y++)
 	{
-		row_start_ptr = in_data + r * getChannelWidth (0);
-		sum = 0;
-
-		for (i = 0; i < APP_SIZE - 1; i++)
+		for (int x = 0; x < w; x++)
 		{
-			data_ptr = row_start_ptr;
-			cols_sum[i] = 0;
-
-			for (j = 0; j < APP_SIZE; j++)
+			size_t i = (size_t) y * w + x;
+			if (!(in[i] > thresh))
+			{
+				labels[i] = 0;
+				continue;
+			}
+			int l = 0;
+			if (x > 0)
+				l = labels[i - 1];
+			// neighbours on the previous line
+			if (y > 0)
+			{
+				const int *up = labels + i - w;
+				for (int dx = -1; dx <= 1; dx++)
+				{
+					if (x + dx < 0 || x + dx >= w || up[dx] == 0)
+						continue;
+					if (l == 0)
+						l = up[dx];
+					else if (l != up[dx])
+						unite (parent, l, up[dx]);
+				}
+			}
+			if (l == 0)
 			{
-				cols_sum[i] += *data_ptr;
-				data_ptr += getChannelWidth (0);
+				l = parent.size ();
+				parent.push_back (l);
 			}
-			sum += cols_sum[i];
-			row_start_ptr++;
+			labels[i] = l;
 		}
+	}
 
-		cols_sum[APP_SIZE - 1] = 0;
+	// number components consecutively, in order of their first pixel
+	std::vector <int> final (parent.size (), 0);
+	int n = 0;
+	for (size_t l = 1; l < parent.size (); l++)
+	{
+		int r = findRoot (parent, l);
+		if (final[r] == 0)
+			final[r] = ++n;
+		final[l] = final[r];
+	}
 
-		for (c = APP_SIZE - 1; c < getChannelWidth (0); c++)
-		{
-			data_ptr = row_start_ptr;
-			sum -= cols_sum[c % APP_SIZE];
-			cols_sum[c % APP_SIZE] = 0;
+	size_t np = (size_t) w * h;
+	for (size_t i = 0; i < np; i++)
+		labels[i] = final[labels[i]];
 
-			for (j = 0; j < APP_SIZE; j++)
-			{
-				cols_sum[c % APP_SIZE] += *data_ptr;
-				data_ptr += getChannelWidth (0);
-			}
+	return n;
+}
 
-			sum += cols_sum[c % APP_SIZE];
+bool rts2image::gaussianCentroid (const float *in, int w, int h, float bkg, double &x, double &y, float fwhm)
+{
+	double s2 = fwhm / FWHM_SIGMA;
+	s2 *= s2;
+	int r = (int) ceil (2 * fwhm);
+	if (r < 2)
+		r = 2;
+
+	double cx = x;
+	double cy = y;
+	for (int it = 0; it < 30; it++)
+	{
+		int x0 = std::max (0, (int) floor (cx) - r);
+		int x1 = std::min (w - 1, (int) ceil (cx) + r);
+		int y0 = std::max (0, (int) floor (cy) - r);
+		int y1 = std::min (h - 1, (int) ceil (cy) + r);
 
-			if (sum / (float) (APP_SIZE * APP_SIZE) > median + 10 * (sigma))
+		double sw = 0, sx = 0, sy = 0;
+		for (int j = y0; j <= y1; j++)
+		{
+			const float *row = in + (size_t) j * w;
+			double dy = j - cy;
+			for (int i = x0; i <= x1; i++)
 			{
-				#ifdef VERBOSE
-				fprintf (stderr, "%4i %4i\n", c, r);
-				#endif
-				if (first)
-				{
-					tmp.x = c;
-					tmp.y = r;
-					list.push_back (tmp);
-					first = false;
-					#ifdef VERBOSE
-					printf ("%d %d\n", c, r);
-					#endif
-				}
-				else
-				{
-					sedi = false;
-					for (x = 0; x < (int) list.size (); x++)
-					{
-						tmp = list[x];
-						if (fabs ((double) (c - tmp.x)) < 10
-							|| fabs ((double) (r - tmp.y)) < 10)
-						{
-							sedi = true;
-						}
-					}
-
-					if (!sedi)
-					{
-						tmp.x = c;
-						tmp.y = r;
-						list.push_back (tmp);
-						#ifdef VERBOSE
-						printf ("%d %d\n", c, r);
-						#endif
-					}
-				}
+				double dx = i - cx;
+				double d2 = dx * dx + dy * dy;
+				if (d2 > r * r)
+					continue;
+				double wv = exp (-d2 / (2 * s2)) * (row[i] - bkg);
+				sw += wv;
+				sx += wv * dx;
+				sy += wv * dy;
 			}
-			row_start_ptr++;
+		}
+		if (sw <= 0)
+			return false;
+
+		// step of windowed centroid; converges fast for window matching star profile
+		double ddx = 2 * sx / sw;
+		double ddy = 2 * sy / sw;
+		cx += ddx;
+		cy += ddy;
+		if (fabs (cx - x) > r || fabs (cy - y) > r)
+			return false;
+		if (ddx * ddx + ddy * ddy < 1e-8)
+		{
+			x = cx;
+			y = cy;
+			return true;
 		}
 	}
-	return 0;
+	return false;
 }
 
-int Image::aperture (unsigned short *in_data, struct pixel pix, struct pixel *ret)
+namespace rts2image
 {
-	int i, j;
-	struct pixel tmp;
-	vector < pixel > rada;
 
-	for (j = pix.y; j < pix.y + 10; j++)
-	{
-		for (i = pix.x; i < pix.x + 10; i++)
-		{
-			tmp.x = i;
-			tmp.y = j;
-			tmp.value = getPixel (in_data, i, j);
-			rada.push_back (tmp);
-		}
-	}
+struct component
+{
+	int npix;
+	double flux;
+	double sw, sx, sy;
+	float peak;
+	int px, py;
+	bool edge;
+};
 
-	sort (rada.begin (), rada.end (), comparePixel ());
-	#ifdef VERBOSE
-	for (i = 0; i < (int) rada.size (); i++)
-	{
-		tmp = rada[i];
-		printf ("%d %d %d\n", tmp.x, tmp.y, tmp.value);
-	}
-	#else
-	tmp = rada[0];
-	#ifdef VERBOSE
-	printf ("%d %d %d\n", tmp.x, tmp.y, tmp.value);
-	#endif
-	#endif
-	*ret = tmp;
-	return 0;
 }
 
-int Image::centroid (unsigned short *in_data, struct pixel pix, float *px, float *py)
+static bool brighter (const stardata &a, const stardata &b)
 {
-	int i, j;
-	float cmean, total, subtotal;
+	return a.F > b.F;
+}
 
-	for (cmean = 0.0, total = 0.0, i = pix.x - 3; i < pix.x + 4; i++)
+/**
+ * Star FWHM from its half-flux radius. Half of Gaussian flux is inside
+ * radius of FWHM / 2.
+ */
+static double halfFluxFwhm (const float *in, int w, int h, float bkg, double x, double y, double rmax)
+{
+	std::vector <std::pair <float, float> > rv;
+	int x0 = std::max (0, (int) floor (x - rmax));
+	int x1 = std::min (w - 1, (int) ceil (x + rmax));
+	int y0 = std::max (0, (int) floor (y - rmax));
+	int y1 = std::min (h - 1, (int) ceil (y + rmax));
+	double total = 0;
+	for (int j = y0; j <= y1; j++)
 	{
-		for (subtotal = 0.0, j = pix.y - 3; j < pix.y + 4; j++)
+		for (int i = x0; i <= x1; i++)
 		{
-			if (getPixel (in_data, i, j) > median + 6 * sigma)
-				subtotal += getPixel (in_data, i, j);
+			double r = sqrt ((i - x) * (i - x) + (j - y) * (j - y));
+			if (r > rmax)
+				continue;
+			float v = in[(size_t) j * w + i] - bkg;
+			rv.push_back (std::pair <float, float> (r, v));
+			total += v;
 		}
-		total += subtotal;
-		cmean += (i * subtotal);
 	}
-	*px = cmean / total;
-
-	for (cmean = 0.0, total = 0.0, j = pix.y - 3; j < pix.y + 4; j++)
+	if (total <= 0)
+		return NAN;
+	std::sort (rv.begin (), rv.end ());
+	double sum = 0;
+	for (std::vector <std::pair <float, float> >::iterator iter = rv.begin (); iter != rv.end (); iter++)
 	{
-		for (subtotal = 0.0, i = pix.x - 3; i < pix.x + 4; i++)
-		{
-			if (getPixel (in_data, i, j) > median + 6 * sigma)
-				subtotal += getPixel (in_data, i, j);
-		}
-		total += subtotal;
-		cmean += (j * subtotal);
+		sum += iter->second;
+		if (sum >= total / 2)
+			return 2 * iter->first;
 	}
-	*py = cmean / total;
-
-	return 0;
+	return NAN;
 }
 
-int Image::radius (unsigned short *in_data, double px, double py, int rmax)
+int rts2image::findStars (const float *in, int w, int h, std::vector <stardata> &stars, const StarFindParams &params, float *median, float *sigma)
 {
-	int i, j, r, inrr, outrr, xyrr, yrr, np;
-	double sum, cmean;
-	unsigned short dp;
-
-	for (r = 2; r <= rmax; r++)
+	stars.clear ();
+	if (w < 3 || h < 3)
+		return 0;
+	size_t n = (size_t) w * h;
+
+	// background and its noise
+	size_t step = params.sampleStep > 1 ? params.sampleStep : 1;
+	std::vector <float> buf;
+	buf.reserve (n / step + 1);
+	for (size_t i = 0; i < n; i += step)
+		buf.push_back (in[i]);
+	float bkg, noise;
+	sigmaClip (buf.data (), buf.size (), params.clipKappa, params.clipIterations, bkg, noise);
+	if (median)
+		*median = bkg;
+	if (sigma)
+		*sigma = noise;
+
+	// matched filter; noise of smoothed image is reduced by the kernel
+	std::vector <float> kernel;
+	gaussianKernel (params.fwhm, kernel);
+	std::vector <float> smooth (n);
+	convolveSeparable (in, smooth.data (), w, h, kernel);
+	double k2 = 0;
+	for (std::vector <float>::iterator iter = kernel.begin (); iter != kernel.end (); iter++)
+		k2 += *iter * *iter;
+	float thresh = bkg + params.threshold * noise * k2;
+
+	std::vector <int> labels (n);
+	int ncomp = labelComponents (smooth.data (), w, h, thresh, labels.data ());
+	if (ncomp == 0)
+		return 0;
+
+	std::vector <component> comps (ncomp + 1);
+	memset (comps.data (), 0, comps.size () * sizeof (component));
+	for (int y = 0; y < h; y++)
 	{
-		inrr = r * r;
-		outrr = (r + 1) * (r + 1);
-		np = 0;
-		sum = 0.0;
-
-		for (j = (int) py - r; j <= (int) py + r; j++)
+		for (int x = 0; x < w; x++)
 		{
-			yrr = (j - (int) py) * (j - (int) py);
-			for (i = (int) px - r; i <= (int) px + r; i++)
+			size_t i = (size_t) y * w + x;
+			if (labels[i] == 0)
+				continue;
+			component &c = comps[labels[i]];
+			float v = in[i] - bkg;
+			c.npix++;
+			c.flux += v;
+			if (v > 0)
 			{
-				xyrr = (i - (int) px) * (i - (int) px) + yrr;
-				if (xyrr >= inrr && xyrr < outrr)
-				{
-					dp = getPixel (in_data, i, j);
-					sum += dp;
-					np++;
-				}
+				c.sw += v;
+				c.sx += v * x;
+				c.sy += v * y;
+			}
+			if (c.npix == 1 || smooth[i] > c.peak)
+			{
+				c.peak = smooth[i];
+				c.px = x;
+				c.py = y;
 			}
+			if (x == 0 || y == 0 || x == w - 1 || y == h - 1)
+				c.edge = true;
 		}
-		cmean = (sum / np) - (median + sigma);
+	}
 
-		if (cmean < 0.77)
-		{
-			break;
-		}
+	for (int l = 1; l <= ncomp; l++)
+	{
+		component &c = comps[l];
+		if (c.npix < params.minArea)
+			continue;
+		stardata s;
+		s.X = c.sw > 0 ? c.sx / c.sw : c.px;
+		s.Y = c.sw > 0 ? c.sy / c.sw : c.py;
+		s.flags = c.edge ? STAR_EDGE : 0;
+		if (!gaussianCentroid (in, w, h, bkg, s.X, s.Y, params.fwhm))
+			s.flags |= STAR_NOCONVERGE;
+		s.F = c.flux;
+		s.Fe = sqrt (fabs (c.flux) + c.npix * noise * noise);
+		s.fwhm = halfFluxFwhm (in, w, h, bkg, s.X, s.Y, std::max (3.0 * params.fwhm, 2 * sqrt (c.npix / M_PI)));
+		stars.push_back (s);
 	}
 
-	return (r);
+	std::sort (stars.begin (), stars.end (), brighter);
+	return stars.size ();
 }
 
-#ifndef RTS2_HAVE_ROUND
-#define round(x)  ((int) x)
-#endif
-
-int Image::integrate (unsigned short *in_data, double px, double py, int size, float *ret)
+int Image::findStars (int chan, const StarFindParams &params)
 {
-	int i, j;
-	float rad;
-	struct pint part;
-	vector < pint > integral;
-	unsigned short res = 0, subres = 0;
-
-	for (i = (int) round (px) - size; i <= (int) round (px) + size; i++)
-		for (j = (int) round (py) - size; j <= (int) round (py) + size; j++)
+	const void *data = getChannelData (chan);
+	if (data == NULL)
+		return -1;
+
+	int w = getChannelWidth (chan);
+	int h = getChannelHeight (chan);
+	std::vector <stardata> stars;
+	float m, s;
+
+	switch (dataType)
 	{
-		rad =
-			sqrt (fabs (px - i) * fabs (px - i) +
-			fabs (py - j) * fabs (py - j));
-		if (rad <= size && (getPixel (in_data, i, j) > median + (6 * sigma)))
-		{
-			part.radius = rad;
-			part.value = getPixel (in_data, i, j);
-			res += part.value;
-			integral.push_back (part);
-		}
+		case RTS2_DATA_BYTE:
+			rts2image::findStars ((const unsigned char *) data, w, h, stars, params, &m, &s);
+			break;
+		case RTS2_DATA_SBYTE:
+			rts2image::findStars ((const signed char *) data, w, h, stars, params, &m, &s);
+			break;
+		case RTS2_DATA_SHORT:
+			rts2image::findStars ((const int16_t *) data, w, h, stars, params, &m, &s);
+			break;
+		case RTS2_DATA_USHORT:
+			rts2image::findStars ((const uint16_t *) data, w, h, stars, params, &m, &s);
+			break;
+		case RTS2_DATA_LONG:
+			rts2image::findStars ((const int32_t *) data, w, h, stars, params, &m, &s);
+			break;
+		case RTS2_DATA_ULONG:
+			rts2image::findStars ((const uint32_t *) data, w, h, stars, params, &m, &s);
+			break;
+		case RTS2_DATA_LONGLONG:
+			rts2image::findStars ((const int64_t *) data, w, h, stars, params, &m, &s);
+			break;
+		case RTS2_DATA_FLOAT:
+			rts2image::findStars ((const float *) data, w, h, stars, params, &m, &s);
+			break;
+		case RTS2_DATA_DOUBLE:
+			rts2image::findStars ((const double *) data, w, h, stars, params, &m, &s);
+			break;
+		default:
+			logStream (MESSAGE_ERROR) << "Unknow dataType " << dataType << sendLog;
+			return -1;
 	}
 
-	sort (integral.begin (), integral.end (), comparePint ());
+	median = m;
+	sigma = s;
+
+	// replace results of previous detection
+	free (sexResults);
+	sexResults = NULL;
+	sexResultNum = 0;
 
-	for (i = 0; i < (int) integral.size (); i++)
+	for (std::vector <stardata>::iterator iter = stars.begin (); iter != stars.end (); iter++)
 	{
-		part = integral[i];
-		subres += part.value;
-		if (subres > res / 2)
-		{
-			#ifdef VERBOSE
-			printf ("%3.2lf %3.2lf %2.2lf\n", px, py, part.radius);
-			#endif
-			break;
-		}
+		// star data are counted from 1, as positions reported by sextractor
+		iter->X += 1;
+		iter->Y += 1;
+		addStarData (&(*iter));
 	}
-	*ret = part.radius;
-	return 0;
+	return stars.size ();
 }
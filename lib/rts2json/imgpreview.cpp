@@ -96,6 +96,7 @@
 #define	_FILE_OFFSET_BITS 64
 #endif
 
+#include "rts2fits/archiveindex.h"
 #include "rts2fits/image.h"
 #include "rts2json/bsc.h"
 #include "rts2json/imgpreview.h"
@@ -254,6 +255,14 @@ void JpegImageRequest::authorizedExecute (XmlRpc::XmlRpcSource *source, std::str
 	delete mimage;
 }
 
+// sort indexed images by exposure start, images without date go last
+static bool jdsort (const rts2image::ArchiveItem *a, const rts2image::ArchiveItem *b)
+{
+	if (std::isnan (b->entry.JD))
+		return !std::isnan (a->entry.JD);
+	return a->entry.JD < b->entry.JD;
+}
+
 void JpegPreview::authorizedExecute (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length)
 {
 	// size of previews
@@ -363,39 +372,83 @@ void JpegPreview::authorizedExecute (XmlRpc::XmlRpcSource *source, std::string p
 	if (!strcmp (pagesort, "date"))
 		sortby = SORT_DATE;
 
-	switch (sortby)
+	std::vector <std::string> subdirs;
+	std::vector <std::string> files;
+
+	// indexed directories are listed without reading directory and stating files
+	std::vector <const rts2image::ArchiveItem *> items;
+	rts2image::ArchiveIndex *archive = rts2image::ArchiveIndex::instance ();
+	if (archive)
 	{
-	 	case SORT_DATE:
-			/* if following fails to compile, please have a look to value of your
-			 * _POSIX_C_SOURCE #define, record it and send it to petr@kubanek.net.
-			 * Please contact petr@kubanek.net if you don't know how to get
-			 * _POSIX_C_SOURCE. */
-			n = scandir (absPath, &namelist, NULL, cdatesort);
-			break;
-		case SORT_FILENAME:
-		default:
-		  	n = scandir (absPath, &namelist, NULL, alphasort);
-			break;
+		std::string dp;
+		for (std::string::iterator iter = absPathStr.begin (); iter != absPathStr.end (); iter++)
+		{
+			if (*iter == '/' && !dp.empty () && dp[dp.length () - 1] == '/')
+				continue;
+			dp += *iter;
+		}
+		archive->listDirectory (dp.c_str (), subdirs, items);
 	}
 
-	if (n < 0)
+	if (!items.empty () || !subdirs.empty ())
 	{
-		throw XmlRpc::XmlRpcException ("Cannot open directory");
+		if (sortby == SORT_DATE)
+			std::stable_sort (items.begin (), items.end (), jdsort);
+		if (path != "/")
+			subdirs.insert (subdirs.begin (), "..");
+		for (std::vector <const rts2image::ArchiveItem *>::iterator iter = items.begin (); iter != items.end (); iter++)
+		{
+			const std::string &fp = (*iter)->path;
+			if (fp.length () > 5 && fp.compare (fp.length () - 5, 5, ".fits") == 0)
+				files.push_back ((*iter)->path);
+		}
+	}
+	else
+	{
+		switch (sortby)
+		{
+		 	case SORT_DATE:
+				/* if following fails to compile, please have a look to value of your
+				 * _POSIX_C_SOURCE #define, record it and send it to petr@kubanek.net.
+				 * Please contact petr@kubanek.net if you don't know how to get
+				 * _POSIX_C_SOURCE. */
+				n = scandir (absPath, &namelist, NULL, cdatesort);
+				break;
+			case SORT_FILENAME:
+			default:
+			  	n = scandir (absPath, &namelist, NULL, alphasort);
+				break;
+		}
+
+		if (n < 0)
+		{
+			throw XmlRpc::XmlRpcException ("Cannot open directory");
+		}
+
+		for (i = 0; i < n; i++)
+		{
+			char *fname = namelist[i]->d_name;
+			struct stat sbuf;
+			ret = stat ((absPathStr + fname).c_str (), &sbuf);
+			if (ret == 0 && S_ISDIR (sbuf.st_mode) && strcmp (fname, ".") != 0)
+				subdirs.push_back (std::string (fname));
+			else if (strstr (fname + strlen (fname) - 6, ".fits") != NULL)
+				files.push_back (absPathStr + '/' + fname);
+		}
+
+		for (i = 0; i < n; i++)
+		{
+			free (namelist[i]);
+		}
+
+		free (namelist);
 	}
 
 	// first show directories..
 	_os << "<p>";
-	for (i = 0; i < n; i++)
+	for (std::vector <std::string>::iterator iter = subdirs.begin (); iter != subdirs.end (); iter++)
 	{
-		char *fname = namelist[i]->d_name;
-		struct stat sbuf;
-		ret = stat ((absPathStr + fname).c_str (), &sbuf);
-		if (ret)
-			continue;
-		if (S_ISDIR (sbuf.st_mode) && strcmp (fname, ".") != 0)
-		{
-			_os << "<a href='" << getServer ()->getPagePrefix () << getPrefix () << path << fname << "/?ps=" << prevsize << "&lb=" << label_encoded << "&chan=" << chan << "&q=" << quantiles << "&cv=" << colourVariant << "'>" << fname << "</a> ";
-		}
+		_os << "<a href='" << getServer ()->getPagePrefix () << getPrefix () << path << *iter << "/?ps=" << prevsize << "&lb=" << label_encoded << "&chan=" << chan << "&q=" << quantiles << "&cv=" << colourVariant << "'>" << *iter << "</a> ";
 	}
 
 	_os << "</p><p>";
@@ -404,26 +457,14 @@ void JpegPreview::authorizedExecute (XmlRpc::XmlRpcSource *source, std::string p
 	int ie = is + pagesiz;
 	int in = 0;
 
-
-	for (i = 0; i < n; i++)
+	for (i = 0; i < (int) files.size (); i++)
 	{
-		char *fname = namelist[i]->d_name;
-		if (strstr (fname + strlen (fname) - 6, ".fits") == NULL)
-			continue;
 		in++;
 		if (in <= is || in > ie)
 			continue;
-		std::string fpath = absPathStr + '/' + fname;
-		preview.imageHref (_os, i, fpath.c_str (), prevsize, label_encoded, quantiles, chan, colourVariant);
+		preview.imageHref (_os, i, files[i].c_str (), prevsize, label_encoded, quantiles, chan, colourVariant);
 	}
 
-	for (i = 0; i < n; i++)
-	{
-		free (namelist[i]);
-	}
-
-	free (namelist);
-
 	// print pages..
 	_os << "</p><p>Page ";
 	for (i = 1; i <= in / pagesiz; i++)
@@ -27,6 +27,7 @@
 #include "expander.h"
 #include "libnova_cpp.h"
 #include "configuration.h"
+#include "ephemcache.h"
 
 using namespace rts2json;
 
@@ -208,27 +209,40 @@ void Plot::plotXSunAlt ()
 
 	double JD = ln_get_julian_from_timet (&f);
 
+	double nh;
+	double dh;
+	rts2core::Configuration::instance ()->getDouble ("observatory", "night_horizon", nh, -10);
+	rts2core::Configuration::instance ()->getDouble ("observatory", "day_horizon", dh, 0);
+
+	// when pixels are more than table step apart (plots over many days), direct calculation is cheaper
+	rts2core::EphemerisCache *ephem = p_scale < 300 ? rts2core::EphemerisCache::instance () : NULL;
+
 	for (unsigned int x = 0; x < size.width () - y_axis_width; x++)
 	{
 		double j = JD + (x * p_scale) / 86400;
-		struct ln_equ_posn pos;
-		struct ln_hrz_posn hrz;
-		ln_get_solar_equ_coords (j, &pos);
-		ln_get_hrz_from_equ (&pos, rts2core::Configuration::instance ()->getObserver (), j, &hrz);
-		double nh;
-		double dh;
-		rts2core::Configuration::instance ()->getDouble ("observatory", "night_horizon", nh, -10);
-		rts2core::Configuration::instance ()->getDouble ("observatory", "day_horizon", dh, 0);
-
-		if (hrz.alt < dh)
+		double alt;
+		if (ephem)
+		{
+			alt = ephem->getAltitude (rts2core::EPHEM_SUN, j);
+		}
+		else
+		{
+			struct ln_equ_posn pos;
+			struct ln_hrz_posn hrz;
+			ln_get_solar_equ_coords (j, &pos);
+			ln_get_hrz_from_equ (&pos, rts2core::Configuration::instance ()->getObserver (), j, &hrz);
+			alt = hrz.alt;
+		}
+
+		if (alt < dh)
 		{
-			if (hrz.alt < nh)
+			if (alt < nh)
 			{
 				image->strokeColor ("black");
 			}
 			else
 			{
-				double p = (hrz.alt - nh) / (dh - nh);
+				double p = (alt - nh) / (dh - nh);
 				image->strokeColor (Magick::Color (MaxRGB * p, MaxRGB * p, MaxRGB * p));
 			}
 			image->draw (Magick::DrawableLine (y_axis_width + x, 0, y_axis_width + x, size.height () - x_axis_height));
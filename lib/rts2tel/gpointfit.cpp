@@ -0,0 +1,780 @@
+/*
+ * Pointing model fitting.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "gpointfit.h"
+#include "error.h"
+#include "utilsfunc.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+// minimal number of observations processed by single thread
+#define FIT_CHUNK        256
+
+using namespace rts2telmodel;
+
+static const char *gemParams[] = {"id", "me", "ma", "tf", "ih", "ch", "np", "daf", "fo"};
+static const char *altazParams[] = {"ia", "tn", "te", "npae", "npoa", "ie", "tf"};
+
+static const char *axisNames[] = {"az", "el", "ha", "dec"};
+
+/**
+ * Normalize angle difference to -PI..PI.
+ */
+static double normalizeDiff (double d)
+{
+	d = fmod (d, 2 * M_PI);
+	if (d > M_PI)
+		d -= 2 * M_PI;
+	else if (d < -M_PI)
+		d += 2 * M_PI;
+	return d;
+}
+
+/**
+ * Angular separation, Vincenty formula.
+ */
+static double angularSeparation (double x1, double y1, double x2, double y2)
+{
+	double dx = x2 - x1;
+	double sy1 = sin (y1), cy1 = cos (y1);
+	double sy2 = sin (y2), cy2 = cos (y2);
+	double a = cy2 * sin (dx);
+	double b = cy1 * sy2 - sy1 * cy2 * cos (dx);
+	return atan2 (sqrt (a * a + b * b), sy1 * sy2 + cy1 * cy2 * cos (dx));
+}
+
+/**
+ * Solve n x n linear system with partial pivoting. A and b are modified.
+ *
+ * @return -1 if matrix is singular
+ */
+static int solve (std::vector <double> &A, std::vector <double> &b, int n)
+{
+	for (int c = 0; c < n; c++)
+	{
+		int piv = c;
+		for (int r = c + 1; r < n; r++)
+			if (fabs (A[r * n + c]) > fabs (A[piv * n + c]))
+				piv = r;
+		if (!(fabs (A[piv * n + c]) > 0))
+			return -1;
+		if (piv != c)
+		{
+			for (int i = 0; i < n; i++)
+				std::swap (A[c * n + i], A[piv * n + i]);
+			std::swap (b[c], b[piv]);
+		}
+		for (int r = c + 1; r < n; r++)
+		{
+			double f = A[r * n + c] / A[c * n + c];
+			if (f == 0)
+				continue;
+			for (int i = c; i < n; i++)
+				A[r * n + i] -= f * A[c * n + i];
+			b[r] -= f * b[c];
+		}
+	}
+	for (int r = n - 1; r >= 0; r--)
+	{
+		double s = b[r];
+		for (int i = r + 1; i < n; i++)
+			s -= A[r * n + i] * b[i];
+		b[r] = s / A[r * n + r];
+	}
+	return 0;
+}
+
+// formats constant as gpoint does, e.g. 2.0
+static std::string constString (double c)
+{
+	std::ostringstream os;
+	os << c;
+	std::string ret = os.str ();
+	if (ret.find_first_of (".e") == std::string::npos)
+		ret += ".0";
+	return ret;
+}
+
+struct FitJob
+{
+	GPointFit *fit;
+	size_t from;
+	size_t to;
+	const double *p;
+	std::vector <double> jtj;
+	std::vector <double> jtr;
+	double chi2;
+	bool normal;
+};
+
+static void *fitThread (void *arg)
+{
+	FitJob *job = (FitJob *) arg;
+	job->fit->computePartial (job->from, job->to, job->p, job->jtj.data (), job->jtr.data (), &(job->chi2), job->normal);
+	return NULL;
+}
+
+GPointFit::GPointFit ()
+{
+	altaz = false;
+	latitude = NAN;
+	sinLat = 0;
+	cosLat = 1;
+	threads = 0;
+	iterations = 0;
+	initParams ();
+}
+
+GPointFit::~GPointFit ()
+{
+	for (std::vector <ExtraParam *>::iterator iter = extras.begin (); iter != extras.end (); iter++)
+		delete *iter;
+}
+
+int GPointFit::loadInput (const char *fn)
+{
+	std::ifstream is (fn);
+	if (is.fail ())
+		throw rts2core::Error (std::string ("cannot open ") + fn);
+	return loadInput (is);
+}
+
+int GPointFit::loadInput (std::istream &is)
+{
+	std::string line;
+	// skip first line
+	std::getline (is, line);
+
+	bool manual = false;
+	bool haveModel = !std::isnan (latitude);
+	int ln = 1;
+	int loaded = 0;
+
+	while (std::getline (is, line))
+	{
+		ln++;
+		std::istringstream iss (line);
+		if (line.length () > 0 && line[0] == '#')
+		{
+			std::string kind;
+			double lng, lat, alt;
+			iss.get ();
+			iss >> kind >> lng >> lat >> alt;
+			if (iss.fail ())
+				continue;
+			bool a;
+			if (kind == "observatory" || kind == "gem")
+				a = false;
+			else if (kind == "altaz")
+				a = true;
+			else if (kind == "altaz-manual")
+			{
+				a = true;
+				manual = true;
+			}
+			else
+				continue;
+			if (haveModel && (a != altaz || lat != latitude))
+				throw rts2core::Error ("cannot fit data with different model type or latitude");
+			setModel (a, lat);
+			haveModel = true;
+			continue;
+		}
+
+		std::vector <std::string> cols;
+		std::string col;
+		while (iss >> col)
+			cols.push_back (col);
+		if (cols.empty ())
+			continue;
+		if (!haveModel)
+			throw rts2core::Error ("missing observatory line before data");
+		if (cols.size () < (manual ? 8 : 9))
+		{
+			std::ostringstream err;
+			err << "too few columns on line " << ln;
+			throw rts2core::Error (err.str ());
+		}
+		double v[9];
+		for (size_t i = 1; i < (manual ? 8 : 9); i++)
+		{
+			char *endp;
+			v[i] = strtod (cols[i].c_str (), &endp);
+			if (*endp != '\0')
+			{
+				std::ostringstream err;
+				err << "invalid number " << cols[i] << " on line " << ln;
+				throw rts2core::Error (err.str ());
+			}
+		}
+		if (altaz)
+		{
+			// sn mjd ra dec e_alt e_az a_alt a_az
+			if (manual)
+				addObservation (v[7], v[6], v[7] + v[5], v[6] + v[4]);
+			// sn mjd lst a_az a_alt ax_az ax_alt r_az r_alt
+			else
+				addObservation (v[3], v[4], v[7], v[8]);
+		}
+		else
+		{
+			// sn mjd lst a_ra a_dec ax_ra ax_dec r_ra r_dec; DEC above 90 means telescope is flipped
+			double r_ra = v[7];
+			double r_dec = v[8];
+			if (fabs (v[4]) > 90)
+				r_ra = fmod (r_ra + 180, 360);
+			if (v[4] > 90)
+				r_dec = 180 - r_dec;
+			else if (v[4] < -90)
+				r_dec = -180 - r_dec;
+			addObservation (v[2] - v[3], v[4], v[2] - r_ra, r_dec);
+		}
+		loaded++;
+	}
+	return loaded;
+}
+
+void GPointFit::setModel (bool _altaz, double _latitude)
+{
+	bool reinit = _altaz != altaz;
+	altaz = _altaz;
+	latitude = _latitude;
+	sinLat = sin (ln_deg_to_rad (latitude));
+	cosLat = cos (ln_deg_to_rad (latitude));
+	if (reinit)
+		initParams ();
+	for (std::vector <GPointObservation>::iterator iter = observations.begin (); iter != observations.end (); iter++)
+		fillTargetCoordinates (*iter);
+}
+
+void GPointFit::addObservation (double a_x, double a_y, double r_x, double r_y)
+{
+	GPointObservation o;
+	o.a_x = ln_deg_to_rad (a_x);
+	o.a_y = ln_deg_to_rad (a_y);
+	o.r_x = ln_deg_to_rad (r_x);
+	o.r_y = ln_deg_to_rad (r_y);
+	o.active = true;
+	fillTargetCoordinates (o);
+	observations.push_back (o);
+}
+
+void GPointFit::fillTargetCoordinates (GPointObservation &o)
+{
+	if (altaz)
+	{
+		o.az = o.a_x;
+		o.el = o.a_y;
+		// azimuth from south, as in libnova
+		o.ha = atan2 (sin (o.az), cos (o.az) * sinLat + tan (o.el) * cosLat);
+		o.dec = asin (sinLat * sin (o.el) - cosLat * cos (o.el) * cos (o.az));
+	}
+	else
+	{
+		o.ha = o.a_x;
+		o.dec = o.a_y;
+		double cos_dec = cos (o.dec);
+		o.el = asin (sinLat * sin (o.dec) + cosLat * cos_dec * cos (o.ha));
+		o.az = atan2 (cos_dec * sin (o.ha), sinLat * cos_dec * cos (o.ha) - cosLat * sin (o.dec));
+		if (o.az < 0)
+			o.az += 2 * M_PI;
+	}
+}
+
+void GPointFit::initParams ()
+{
+	for (std::vector <ExtraParam *>::iterator iter = extras.begin (); iter != extras.end (); iter++)
+		delete *iter;
+	extras.clear ();
+	extraAxis.clear ();
+
+	names.clear ();
+	if (altaz)
+		names.assign (altazParams, altazParams + 7);
+	else
+		names.assign (gemParams, gemParams + 9);
+
+	values.assign (names.size (), 0);
+	stderrs.assign (names.size (), NAN);
+	fixed.assign (names.size (), false);
+}
+
+void GPointFit::addExtra (const char *axis, const char *function, const char *terms, const char *consts)
+{
+	ci_string ci_axis (axis);
+	int a;
+	for (a = 0; a < 4; a++)
+	{
+		if (ci_axis == axisNames[a])
+			break;
+	}
+	if (a == 4 && ci_axis == "alt")
+		a = 1;
+	if (a == 4)
+		throw rts2core::Error (std::string ("invalid axis name ") + axis);
+	if ((a < 2) != altaz)
+		throw rts2core::Error (std::string ("axis does not match model type ") + axis);
+
+	ExtraParam *ep = new ExtraParam ();
+	try
+	{
+		std::istringstream is (std::string ("1 ") + function + " " + terms + " " + consts);
+		ep->parse (is);
+	}
+	catch (rts2core::Error &er)
+	{
+		delete ep;
+		throw;
+	}
+
+	// parameter name, as generated by gpoint
+	std::ostringstream pn;
+	pn << axisNames[a] << "_" << ExtraParam::fns[ep->function];
+	for (int t = 0; t < MAX_TERMS && ep->terms[t] != GPOINT_LASTTERM; t++)
+		pn << "_" << ExtraParam::pns[ep->terms[t]];
+	for (int t = 0; t < MAX_TERMS && ep->terms[t] != GPOINT_LASTTERM; t++)
+	{
+		std::string c = constString (ep->consts[t]);
+		std::replace (c.begin (), c.end (), '.', '_');
+		pn << "_" << c;
+	}
+
+	for (std::vector <std::string>::iterator iter = names.begin (); iter != names.end (); iter++)
+	{
+		if (*iter == pn.str ())
+		{
+			delete ep;
+			throw rts2core::Error ("duplicated term " + pn.str ());
+		}
+	}
+
+	extras.push_back (ep);
+	extraAxis.push_back (a);
+	names.push_back (pn.str ());
+	values.push_back (0);
+	stderrs.push_back (NAN);
+	fixed.push_back (false);
+}
+
+void GPointFit::setFixed (const char *name)
+{
+	for (size_t i = 0; i < names.size (); i++)
+	{
+		if (names[i] == name)
+		{
+			fixed[i] = true;
+			return;
+		}
+	}
+	throw rts2core::Error (std::string ("unknown parameter ") + name);
+}
+
+double GPointFit::getParam (const char *name)
+{
+	for (size_t i = 0; i < names.size (); i++)
+	{
+		if (names[i] == name)
+			return values[i];
+	}
+	throw rts2core::Error (std::string ("unknown parameter ") + name);
+}
+
+size_t GPointFit::activeSize ()
+{
+	size_t ret = 0;
+	for (std::vector <GPointObservation>::iterator iter = observations.begin (); iter != observations.end (); iter++)
+		if (iter->active)
+			ret++;
+	return ret;
+}
+
+void GPointFit::terms (const GPointObservation &o, const double *p, double *dx, double *dy, double &mx, double &my)
+{
+	double sin_x = sin (o.a_x);
+	double cos_x = cos (o.a_x);
+	double sin_y = sin (o.a_y);
+	double cos_y = cos (o.a_y);
+	double tan_y = sin_y / cos_y;
+
+	if (altaz)
+	{
+		// ia tn te npae npoa ie tf
+		dx[0] = -1;
+		dx[1] = sin_x * tan_y;
+		dx[2] = -cos_x * tan_y;
+		dx[3] = -tan_y;
+		dx[4] = 1 / cos_y;
+		dx[5] = 0;
+		dx[6] = 0;
+
+		dy[0] = 0;
+		dy[1] = cos_x;
+		dy[2] = sin_x;
+		dy[3] = 0;
+		dy[4] = 0;
+		dy[5] = -1;
+		dy[6] = cos_y;
+	}
+	else
+	{
+		// id me ma tf ih ch np daf fo
+		dx[0] = 0;
+		dx[1] = -sin_x * tan_y;
+		dx[2] = cos_x * tan_y;
+		dx[3] = -cosLat * sin_x / cos_y;
+		dx[4] = -1;
+		dx[5] = -1 / cos_y;
+		dx[6] = -tan_y;
+		dx[7] = -(sinLat * tan_y + cosLat * cos_x);
+		dx[8] = 0;
+
+		dy[0] = -1;
+		dy[1] = -cos_x;
+		dy[2] = -sin_x;
+		dy[3] = -(cosLat * sin_y * cos_x - sinLat * cos_y);
+		dy[4] = 0;
+		dy[5] = 0;
+		dy[6] = 0;
+		dy[7] = 0;
+		dy[8] = -cos_x;
+	}
+
+	size_t nb = altaz ? 7 : 9;
+	for (size_t e = 0; e < extras.size (); e++)
+	{
+		double v = extras[e]->getValue (o.az, o.el, o.ha, o.dec);
+		if (extraAxis[e] % 2 == 0)
+		{
+			dx[nb + e] = v;
+			dy[nb + e] = 0;
+		}
+		else
+		{
+			dx[nb + e] = 0;
+			dy[nb + e] = v;
+		}
+	}
+
+	mx = my = 0;
+	for (size_t i = 0; i < names.size (); i++)
+	{
+		mx += p[i] * dx[i];
+		my += p[i] * dy[i];
+	}
+}
+
+void GPointFit::computePartial (size_t from, size_t to, const double *p, double *jtj, double *jtr, double *chi2, bool normal)
+{
+	size_t np = names.size ();
+	size_t nf = freeParams.size ();
+	double dx[np], dy[np];
+	double fx[nf], fy[nf];
+	double mx, my;
+
+	*chi2 = 0;
+	if (normal)
+	{
+		std::fill (jtj, jtj + nf * nf, 0);
+		std::fill (jtr, jtr + nf, 0);
+	}
+
+	for (size_t i = from; i < to; i++)
+	{
+		const GPointObservation &o = observations[i];
+		if (!o.active)
+			continue;
+		terms (o, p, dx, dy, mx, my);
+		// residuals - target position with model applied minus real position; first axis error is scaled to angular distance
+		double w = fabs (cos (o.a_y));
+		double rx = (normalizeDiff (o.a_x - o.r_x) + mx) * w;
+		double ry = o.a_y - o.r_y + my;
+		*chi2 += rx * rx + ry * ry;
+		if (!normal)
+			continue;
+		for (size_t k = 0; k < nf; k++)
+		{
+			fx[k] = dx[freeParams[k]] * w;
+			fy[k] = dy[freeParams[k]];
+		}
+		for (size_t k = 0; k < nf; k++)
+		{
+			jtr[k] += fx[k] * rx + fy[k] * ry;
+			// upper triangle only, filled below
+			for (size_t l = k; l < nf; l++)
+				jtj[k * nf + l] += fx[k] * fx[l] + fy[k] * fy[l];
+		}
+	}
+}
+
+double GPointFit::evaluate (const double *p, double *jtj, double *jtr, bool normal)
+{
+	size_t nf = freeParams.size ();
+	size_t n = observations.size ();
+
+	int nthreads = threads;
+	if (nthreads <= 0)
+		nthreads = sysconf (_SC_NPROCESSORS_ONLN);
+	if ((size_t) nthreads > n / FIT_CHUNK)
+		nthreads = n / FIT_CHUNK;
+	if (nthreads < 1)
+		nthreads = 1;
+
+	std::vector <FitJob> jobs (nthreads);
+	for (int i = 0; i < nthreads; i++)
+	{
+		jobs[i].fit = this;
+		jobs[i].from = n * i / nthreads;
+		jobs[i].to = n * (i + 1) / nthreads;
+		jobs[i].p = p;
+		jobs[i].jtj.resize (nf * nf);
+		jobs[i].jtr.resize (nf);
+		jobs[i].normal = normal;
+	}
+
+	// calling thread processes first job
+	std::vector <pthread_t> workers;
+	for (int i = 1; i < nthreads; i++)
+	{
+		pthread_t th;
+		if (pthread_create (&th, NULL, fitThread, &(jobs[i])))
+		{
+			logStream (MESSAGE_WARNING) << "cannot create fit thread, computing in calling thread" << sendLog;
+			fitThread (&(jobs[i]));
+			continue;
+		}
+		workers.push_back (th);
+	}
+	fitThread (&(jobs[0]));
+	for (std::vector <pthread_t>::iterator iter = workers.begin (); iter != workers.end (); iter++)
+		pthread_join (*iter, NULL);
+
+	double chi2 = 0;
+	if (normal)
+	{
+		std::fill (jtj, jtj + nf * nf, 0);
+		std::fill (jtr, jtr + nf, 0);
+	}
+	for (std::vector <FitJob>::iterator iter = jobs.begin (); iter != jobs.end (); iter++)
+	{
+		chi2 += iter->chi2;
+		if (!normal)
+			continue;
+		for (size_t k = 0; k < nf * nf; k++)
+			jtj[k] += iter->jtj[k];
+		for (size_t k = 0; k < nf; k++)
+			jtr[k] += iter->jtr[k];
+	}
+	if (normal)
+	{
+		for (size_t k = 0; k < nf; k++)
+			for (size_t l = 0; l < k; l++)
+				jtj[k * nf + l] = jtj[l * nf + k];
+	}
+	return chi2;
+}
+
+double GPointFit::fit (int maxIter)
+{
+	freeParams.clear ();
+	for (size_t i = 0; i < names.size (); i++)
+	{
+		if (!fixed[i])
+			freeParams.push_back (i);
+	}
+
+	size_t nf = freeParams.size ();
+	size_t m = activeSize ();
+	iterations = 0;
+
+	if (2 * m <= nf)
+	{
+		logStream (MESSAGE_ERROR) << "not enough observations (" << m << ") to fit " << nf << " parameters" << sendLog;
+		return NAN;
+	}
+
+	std::vector <double> p (values);
+	std::vector <double> pn (values);
+	std::vector <double> jtj (nf * nf), jtr (nf);
+	std::vector <double> jtjn (nf * nf), jtrn (nf);
+	std::vector <double> A (nf * nf), delta (nf);
+
+	double lambda = 1e-3;
+	double chi2 = evaluate (p.data (), jtj.data (), jtr.data (), true);
+
+	while (iterations < maxIter && nf > 0)
+	{
+		iterations++;
+		A = jtj;
+		for (size_t k = 0; k < nf; k++)
+		{
+			A[k * nf + k] *= 1 + lambda;
+			delta[k] = -jtr[k];
+		}
+		if (solve (A, delta, nf))
+		{
+			lambda *= 10;
+			if (lambda > 1e10)
+				break;
+			continue;
+		}
+
+		pn = p;
+		double step = 0;
+		for (size_t k = 0; k < nf; k++)
+		{
+			pn[freeParams[k]] += delta[k];
+			step = std::max (step, fabs (delta[k]));
+		}
+
+		// linear terms, normal equations for new point are computed with residuals
+		double chi2n = evaluate (pn.data (), jtjn.data (), jtrn.data (), true);
+		if (chi2n <= chi2)
+		{
+			bool converged = chi2 - chi2n <= 1e-12 * chi2 || step < 1e-14;
+			p.swap (pn);
+			jtj.swap (jtjn);
+			jtr.swap (jtrn);
+			chi2 = chi2n;
+			lambda = std::max (lambda / 10, 1e-12);
+			if (converged)
+				break;
+		}
+		else
+		{
+			lambda *= 10;
+			if (lambda > 1e10)
+				break;
+		}
+	}
+
+	values = p;
+
+	// parameter errors from covariance matrix
+	stderrs.assign (names.size (), 0);
+	double s2 = chi2 / (2 * m - nf);
+	for (size_t k = 0; k < nf; k++)
+	{
+		A = jtj;
+		std::vector <double> e (nf, 0);
+		e[k] = 1;
+		if (solve (A, e, nf))
+			stderrs[freeParams[k]] = NAN;
+		else
+			stderrs[freeParams[k]] = sqrt (e[k] * s2);
+	}
+
+	double sum = 0;
+	for (size_t i = 0; i < observations.size (); i++)
+	{
+		if (!observations[i].active)
+			continue;
+		double e = getError (i);
+		sum += e * e;
+	}
+	return ln_rad_to_deg (sqrt (sum / m)) * 3600.0;
+}
+
+int GPointFit::fitRejectOutliers (double sigma, int maxRounds)
+{
+	int removed = 0;
+	for (int round = 0; round < maxRounds; round++)
+	{
+		double rms = fit ();
+		if (std::isnan (rms))
+			return removed;
+		double limit = ln_deg_to_rad (sigma * rms / 3600.0);
+		int r = 0;
+		for (size_t i = 0; i < observations.size (); i++)
+		{
+			if (observations[i].active && getError (i) > limit)
+			{
+				observations[i].active = false;
+				r++;
+			}
+		}
+		if (r == 0)
+			return removed;
+		removed += r;
+	}
+	fit ();
+	return removed;
+}
+
+double GPointFit::getError (size_t i)
+{
+	size_t np = names.size ();
+	double dx[np], dy[np];
+	double mx, my;
+	GPointObservation &o = observations[i];
+	terms (o, values.data (), dx, dy, mx, my);
+	return angularSeparation (o.a_x + mx, o.a_y + my, o.r_x, o.r_y);
+}
+
+void GPointFit::getModel (GPointModel *model)
+{
+	model->altaz = altaz;
+	size_t nb = altaz ? 7 : 9;
+	for (size_t i = 0; i < nb; i++)
+		model->params[i] = values[i];
+	for (size_t e = 0; e < extras.size (); e++)
+	{
+		ExtraParam *ep = new ExtraParam (*extras[e]);
+		ep->params[0] = values[nb + e];
+		switch (extraAxis[e])
+		{
+			case 0:
+				model->extraParamsAz.push_back (ep);
+				break;
+			case 1:
+				model->extraParamsEl.push_back (ep);
+				break;
+			case 2:
+				model->extraParamsHa.push_back (ep);
+				break;
+			default:
+				model->extraParamsDec.push_back (ep);
+				break;
+		}
+	}
+}
+
+std::ostream & GPointFit::print (std::ostream &os, char frmt)
+{
+	GPointModel model (latitude);
+	getModel (&model);
+	return model.print (os, frmt);
+}
+
+std::ostream & GPointFit::printParameters (std::ostream &os)
+{
+	std::ios_base::fmtflags oldf = os.flags ();
+	std::streamsize oldp = os.precision ();
+	os << std::left << std::setw (24) << "Name" << std::right << std::setw (10) << "value(\")" << std::setw (10) << "stderr(\")" << " fixed" << std::endl;
+	os << std::fixed << std::setprecision (2);
+	for (size_t i = 0; i < names.size (); i++)
+		os << std::left << std::setw (24) << names[i] << std::right << std::setw (10) << ln_rad_to_deg (values[i]) * 3600.0 << std::setw (10) << ln_rad_to_deg (stderrs[i]) * 3600.0 << (fixed[i] ? "     *" : "") << std::endl;
+	os.flags (oldf);
+	os.precision (oldp);
+	return os;
+}
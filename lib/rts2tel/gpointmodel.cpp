@@ -203,6 +203,13 @@ double ExtraParam::getParamValue (double az, double el, double ha, double dec, i
 			return ha;
 		case GPOINT_DEC:
 			return dec;
+		case GPOINT_PD:
+			// pole distance, DEC above 90 means flipped telescope
+			if (dec > M_PI / 2.0)
+				return dec - M_PI / 2.0;
+			else if (dec < -M_PI / 2.0)
+				return -M_PI / 2.0 - dec;
+			return M_PI / 2.0 - fabs (dec);
 		default:
 			return 0;
 	}
@@ -219,15 +226,15 @@ double ExtraParam::getValue (double az, double el, double ha, double dec)
 		case GPOINT_COS:
 			return params[0] * cosl (consts[0] * getParamValue (az, el, ha, dec, 0));
 		case GPOINT_ABSSIN:
-			return params[0] * abs (sinl (consts[0] * getParamValue (az, el, ha, dec, 0)));
+			return params[0] * fabsl (sinl (consts[0] * getParamValue (az, el, ha, dec, 0)));
 		case GPOINT_ABSCOS:
-			return params[0] * abs (cosl (consts[0] * getParamValue (az, el, ha, dec, 0)));
+			return params[0] * fabsl (cosl (consts[0] * getParamValue (az, el, ha, dec, 0)));
 		case GPOINT_TAN:
 			return params[0] * tanl (consts[0] * getParamValue (az, el, ha, dec, 0));
 		case GPOINT_CSC:
-			return params[0] / cosl (consts[0] * getParamValue (az, el, ha, dec, 0));
-		case GPOINT_SEC:
 			return params[0] / sinl (consts[0] * getParamValue (az, el, ha, dec, 0));
+		case GPOINT_SEC:
+			return params[0] / cosl (consts[0] * getParamValue (az, el, ha, dec, 0));
 		case GPOINT_COT:
 			return params[0] / tanl (consts[0] * getParamValue (az, el, ha, dec, 0));
 		case GPOINT_SINH:
@@ -237,9 +244,9 @@ double ExtraParam::getValue (double az, double el, double ha, double dec)
 		case GPOINT_TANH:
 			return params[0] * tanhl (consts[0] * getParamValue (az, el, ha, dec, 0));
 		case GPOINT_SECH:
-			return params[0] / sinhl (consts[0] * getParamValue (az, el, ha, dec, 0));
-		case GPOINT_CSCH:
 			return params[0] / coshl (consts[0] * getParamValue (az, el, ha, dec, 0));
+		case GPOINT_CSCH:
+			return params[0] / sinhl (consts[0] * getParamValue (az, el, ha, dec, 0));
 		case GPOINT_COTH:
 			return params[0] / tanhl (consts[0] * getParamValue (az, el, ha, dec, 0));
 		case GPOINT_SINCOS:
@@ -247,7 +254,7 @@ double ExtraParam::getValue (double az, double el, double ha, double dec)
 		case GPOINT_COSCOS:
 			return params[0] * cosl (consts[0] * getParamValue (az, el, ha, dec, 0)) * cosl (consts[1] * getParamValue (az, el, ha, dec, 1));
 		case GPOINT_SINSIN:
-			return sinl (consts[0] * getParamValue (az, el, ha, dec, 0)) * sinl (consts[1] * getParamValue (az, el, ha, dec, 1));
+			return params[0] * sinl (consts[0] * getParamValue (az, el, ha, dec, 0)) * sinl (consts[1] * getParamValue (az, el, ha, dec, 1));
 		default:
 			return 0;
 	}
@@ -256,8 +263,14 @@ double ExtraParam::getValue (double az, double el, double ha, double dec)
 std::string ExtraParam::toString (char frmt)
 {
 	std::ostringstream os;
-	os.precision (20);
-	os << std::fixed << printDeg (params[0], frmt) << " " << consts[0];
+	os << printDeg (params[0], frmt) << "\t" << fns[function] << "\t";
+	// terms and constants, as expected by parse
+	int t;
+	for (t = 0; t < MAX_TERMS && terms[t] != GPOINT_LASTTERM; t++)
+		os << (t ? ";" : "") << pns[terms[t]];
+	os << "\t";
+	for (int i = 0; i < t; i++)
+		os << (i ? ";" : "") << (double) consts[i];
 	return os.str ();
 }
 
@@ -343,13 +356,13 @@ int GPointModel::reverse (struct ln_equ_posn *pos, struct ln_hrz_posn *hrz)
 		+ params[3] * cos (lat_r) * sin (ha_r) / cos (dec_r)
 		+ params[7] * (sin (lat_r) * tan (dec_r) + cos (lat_r) * cos (ha_r));
 
-	// now handle extra params
+	// now handle extra params; gpoint adds them to model, which is subtracted above
 	std::list <ExtraParam *>::iterator it;
 	for (it = extraParamsHa.begin (); it != extraParamsHa.end (); it++)
-		r_tar += (*it)->getValue (az_r, el_r, ha_r, dec_r);
+		r_tar -= (*it)->getValue (az_r, el_r, ha_r, dec_r);
 
 	for (it = extraParamsDec.begin (); it != extraParamsDec.end (); it++)
-		d_tar += (*it)->getValue (az_r, el_r, ha_r, dec_r);
+		d_tar -= (*it)->getValue (az_r, el_r, ha_r, dec_r);
 
 	pos->ra = ln_rad_to_deg (r_tar);
 	pos->dec = ln_rad_to_deg (d_tar);
@@ -523,6 +536,10 @@ std::ostream & GPointModel::print (std::ostream & os, char frmt)
 		os << "AZ " << (*it)->toString (frmt) << std::endl;
 	for (it = extraParamsEl.begin (); it != extraParamsEl.end (); it++)
 		os << "EL " << (*it)->toString (frmt) << std::endl;
+	for (it = extraParamsHa.begin (); it != extraParamsHa.end (); it++)
+		os << "HA " << (*it)->toString (frmt) << std::endl;
+	for (it = extraParamsDec.begin (); it != extraParamsDec.end (); it++)
+		os << "DEC " << (*it)->toString (frmt) << std::endl;
 	return os;
 }
 
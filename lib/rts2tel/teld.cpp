@@ -79,6 +79,7 @@ Telescope::Telescope (int in_argc, char **in_argv, bool diffTrack, bool hasTrack
 
 	decUpperLimit = NULL;
 	dut1fn = NULL;
+	nextDUT1Update = 0;
 
 	createValue (telPressure, "PRESSURE", "observatory atmospheric pressure", false, RTS2_VALUE_WRITABLE | RTS2_VALUE_AUTOSAVE);
 	telPressure->setValueFloat (1000);
@@ -95,6 +96,12 @@ Telescope::Telescope (int in_argc, char **in_argv, bool diffTrack, bool hasTrack
 	createValue (telDUT1, "DUT1", "[s] UT1 - UTC", true, RTS2_VALUE_WRITABLE | RTS2_VALUE_AUTOSAVE);
 	telDUT1->setValueDouble (0);
 
+	createValue (telPolarX, "POLAR_X", "[arcsec] polar motion X", false, RTS2_VALUE_WRITABLE | RTS2_VALUE_AUTOSAVE);
+	telPolarX->setValueDouble (0);
+
+	createValue (telPolarY, "POLAR_Y", "[arcsec] polar motion Y", false, RTS2_VALUE_WRITABLE | RTS2_VALUE_AUTOSAVE);
+	telPolarY->setValueDouble (0);
+
 	createValue (pointingModel, "MOUNT", "mount pointing model (equ, alt-az, ...)", false, 0, 0);
 	pointingModel->addSelVal ("EQU");
 	pointingModel->addSelVal ("ALT-AZ");
@@ -1782,6 +1789,8 @@ void Telescope::runTracking ()
 
 void Telescope::logTracking ()
 {
+	if (!rts2core::logEnabled (MESSAGE_DEBUG))
+		return;
 #ifdef RTS2_LIBERFA
 	rts2core::LogStream ls = logStream (MESSAGE_DEBUG | DEBUG_MOUNT_TRACKING_SHORT_LOG);
 		// 1                            2
@@ -1834,7 +1843,7 @@ void Telescope::updateTrackingFrequency ()
 
 int Telescope::moveTLE (const char *l1, const char *l2)
 {
-	int ret = parse_elements (l1, l2, &tle);
+	int ret = tleEngine.setTLE (l1, l2);
 	if (ret != 0)
 	{
 		logStream (MESSAGE_ERROR) << "cannot target on TLEs" << sendLog;
@@ -1853,14 +1862,7 @@ int Telescope::parseTLE (rts2core::Connection *conn, const char *l1, const char
 
 	setTLE (l1, l2);
 
-	int ephem = 1;
-
-	int is_deep = select_ephemeris (&tle);
-	if (is_deep && (ephem == 1 || ephem == 2))
-		ephem += 2;	/* switch to an SDx */
-	if (!is_deep && (ephem == 3 || ephem == 4))
-		ephem -= 2;	/* switch to an SGx */
-	tle_ephem->setValueInteger (ephem);
+	tle_ephem->setValueInteger (tleEngine.getEphem ());
 
 	startTracking (true);
 
@@ -1879,39 +1881,14 @@ void Telescope::setTLE (const char *l1, const char *l2)
 
 void Telescope::calculateTLE (double JD, double &ra, double &dec, double &dist_to_satellite)
 {
-	double sat_params[N_SAT_PARAMS], observer_loc[3];
-	double t_since;
-	double sat_pos[3]; /* Satellite position vector */
-
-	observer_cartesian_coords (JD, ln_deg_to_rad (getLongitude ()), tle_rho_cos_phi->getValueDouble (), tle_rho_sin_phi->getValueDouble (), observer_loc);
-
-	t_since = (JD - tle.epoch) * 1440.;
-	switch (tle_ephem->getValueInteger ())
+	if (!tleEngine.isValid ())
 	{
-		case 0:
-			SGP_init (sat_params, &tle);
-			SGP (t_since, &tle, sat_params, sat_pos, NULL);
-			break;
-		case 1:
-			SGP4_init (sat_params, &tle);
-			SGP4 (t_since, &tle, sat_params, sat_pos, NULL);
-			break;
-		case 2:
-			SGP8_init (sat_params, &tle);
-			SGP8 (t_since, &tle, sat_params, sat_pos, NULL);
-			break;
-		case 3:
-			SDP4_init (sat_params, &tle);
-			SDP4 (t_since, &tle, sat_params, sat_pos, NULL);
-			break;
-		case 4:
-			SDP8_init (sat_params, &tle);
-			SDP8 (t_since, &tle, sat_params, sat_pos, NULL);
-			break;
-		default:
-			logStream (MESSAGE_ERROR) << "invalid tle_ephem " << tle_ephem->getValueInteger () << sendLog;
+		logStream (MESSAGE_ERROR) << "invalid TLE" << sendLog;
+		ra = dec = dist_to_satellite = NAN;
+		return;
 	}
-	get_satellite_ra_dec_delta (observer_loc, sat_pos, &ra, &dec, &dist_to_satellite);
+	tleEngine.setObserver (getLongitude (), getLatitude (), getAltitude ());
+	tleEngine.getPosition (JD, ra, dec, dist_to_satellite);
 }
 
 void Telescope::setDiffTrack (double dra, double ddec)
@@ -2022,6 +1999,10 @@ int Telescope::infoLST (double telLST)
 
 int Telescope::infoUTCLST (const double utc1, const double utc2, double telLST)
 {
+	// EOP change slowly, interpolate them once per minute
+	if (dut1fn != NULL && !(getNow () < nextDUT1Update))
+		updateDUT1 ();
+
 	struct ln_hrz_posn hrz;
 	// calculate alt+az
 	getTelAltAz (&hrz);
@@ -2084,7 +2065,7 @@ void Telescope::applyCorrections (struct ln_equ_posn *pos, double utc1, double u
 
 	eraASTROM astrom;
 
-	int status = eraApco13 (utc1, utc2, telDUT1->getValueDouble (), ln_deg_to_rad (getLongitude ()), ln_deg_to_rad (getLatitude ()), getAltitude (), 0, 0, getPressure (), telAmbientTemperature->getValueFloat (), telHumidity->getValueFloat () / 100.0, telWavelength->getValueFloat () / 1000.0, &astrom, &eo);
+	int status = eraApco13 (utc1, utc2, telDUT1->getValueDouble (), ln_deg_to_rad (getLongitude ()), ln_deg_to_rad (getLatitude ()), getAltitude (), ln_deg_to_rad (telPolarX->getValueDouble () / 3600.0), ln_deg_to_rad (telPolarY->getValueDouble () / 3600.0), getPressure (), telAmbientTemperature->getValueFloat (), telHumidity->getValueFloat () / 100.0, telWavelength->getValueFloat () / 1000.0, &astrom, &eo);
 	if (status)
 	{
 		logStream (MESSAGE_ERROR) << "cannot apply corrections to " << pos->ra << " " << pos->dec << sendLog;
@@ -3021,16 +3002,20 @@ void Telescope::updateDUT1 ()
 	if (dut1fn == NULL)
 		return;
 
-	time_t now;
-
-	time (&now);
-	struct tm *gmt = gmtime (&now);
+	nextDUT1Update = getNow () + 60;
 
-	double dut1 = getDUT1 (dut1fn, gmt);
-	if (!std::isnan (dut1))
+	double dut1, xp, yp;
+	if (eop.reload (dut1fn) >= 0 && eop.getEOP (ln_get_julian_from_sys (), dut1, xp, yp))
 	{
 		telDUT1->setValueDouble (dut1);
 		valueGood (telDUT1);
+		if (!std::isnan (xp) && !std::isnan (yp))
+		{
+			telPolarX->setValueDouble (xp);
+			telPolarY->setValueDouble (yp);
+			sendValueAll (telPolarX);
+			sendValueAll (telPolarY);
+		}
 	}
 	else
 	{
@@ -929,3 +929,61 @@ int sep_windowed(sep_image *im,
 
   return status;
 }
+
+/*****************************************************************************/
+/* Multi-threaded photometry of many circular apertures. Apertures are
+ * independent, each job sums a block of them. */
+
+#define APER_BLOCK 256
+
+typedef struct {
+  sep_image *image;
+  double *x, *y;
+  int n;
+  double r;
+  int subpix;
+  short inflags;
+  double *sum, *sumerr, *area;
+  short *flag;
+} circles;
+
+static int sumcircles(void *arg, int job)
+{
+  circles *c = (circles *)arg;
+  int i, imax, status;
+
+  imax = (job + 1) * APER_BLOCK < c->n ? (job + 1) * APER_BLOCK : c->n;
+  for (i=job*APER_BLOCK; i<imax; i++)
+    {
+      status = sep_sum_circle(c->image, c->x[i], c->y[i], c->r, c->subpix,
+			      c->inflags, c->sum + i, c->sumerr + i,
+			      c->area + i, c->flag + i);
+      if (status != RETURN_OK)
+	return status;
+    }
+  return RETURN_OK;
+}
+
+int sep_sum_circle_array(sep_image *image, double *x, double *y, int n,
+			 double r, int subpix, short inflags,
+			 double *sum, double *sumerr, double *area,
+			 short *flag, int nthreads)
+{
+  circles c;
+
+  if (n <= 0)
+    return RETURN_OK;
+
+  c.image = image;
+  c.x = x;
+  c.y = y;
+  c.n = n;
+  c.r = r;
+  c.subpix = subpix;
+  c.inflags = inflags;
+  c.sum = sum;
+  c.sumerr = sumerr;
+  c.area = area;
+  c.flag = flag;
+  return sep_run_jobs(nthreads, (n - 1) / APER_BLOCK + 1, sumcircles, &c);
+}
@@ -54,12 +54,21 @@ float backguess(backstruct *bkg, float *mean, float *sigma);
 int makebackspline(sep_bkg *bkg, float *map, float *dmap);
 
 
-int sep_background(sep_image* image, int bw, int bh, int fw, int fh,
-                   double fthresh, sep_bkg **bkg)
+/* rows of background meshes processed by backrow() */
+typedef struct {
+  sep_image *image;
+  sep_bkg *bkg;
+} backrows;
+
+/* Compute statistics of meshes in row j. Each row has its own buffers, so
+ * rows can be processed by several threads. */
+static int backrow(void *arg, int j)
 {
+  sep_image *image = ((backrows *)arg)->image;
+  sep_bkg *bkg = ((backrows *)arg)->bkg;
   BYTE *imt, *maskt;
   int npix;                   /* size of image */
-  int nx, ny, nb;             /* number of background boxes in x, y, total */
+  int nx;                     /* number of background boxes in x */
   int bufsize;                /* size of a "row" of boxes in pixels (w*bh) */
   int elsize;                 /* size (in bytes) of an image array element */
   int melsize;                /* size (in bytes) of a mask array element */
@@ -67,55 +76,25 @@ int sep_background(sep_image* image, int bw, int bh, int fw, int fh,
   PIXTYPE maskthresh;
   array_converter convert, mconvert;
   backstruct *backmesh, *bm;  /* info about each background "box" */
-  sep_bkg *bkgout;          /* output */
-  int j,k,m, status;
+  int k, m, status;
 
   status = RETURN_OK;
   npix = image->w * image->h;
-  bufsize = image->w * bh;
+  bufsize = image->w * bkg->bh;
+  nx = bkg->nx;
   maskthresh = image->maskthresh;
   if (image->mask == NULL) maskthresh = 0.0;
 
-  backmesh = bm = NULL;
-  bkgout = NULL;
+  backmesh = NULL;
   buf = mbuf = buft = mbuft = NULL;
   convert = mconvert = NULL;
 
-  /* determine number of background boxes */
-  if ((nx = (image->w - 1) / bw + 1) < 1)
-    nx = 1;
-  if ((ny = (image->h - 1) / bh + 1) < 1)
-    ny = 1;
-  nb = nx*ny;
-
   /* Allocate temp memory & initialize */
   QMALLOC(backmesh, backstruct, nx, status);
   bm = backmesh;
   for (m=nx; m--; bm++)
     bm->histo=NULL;
 
-  /* Allocate the returned struct */
-  QMALLOC(bkgout, sep_bkg, 1, status);
-  bkgout->w = image->w;
-  bkgout->h = image->h;
-  bkgout->nx = nx;
-  bkgout->ny = ny;
-  bkgout->n = nb;
-  bkgout->bw = bw;
-  bkgout->bh = bh;
-  bkgout->back = NULL;
-  bkgout->sigma = NULL;
-  bkgout->dback = NULL;
-  bkgout->dsigma = NULL;
-  QMALLOC(bkgout->back, float, nb, status);
-  QMALLOC(bkgout->sigma, float, nb, status);
-  QMALLOC(bkgout->dback, float, nb, status);
-  QMALLOC(bkgout->dsigma, float, nb, status);
-
-  /* cast input array pointers. These are used to step through the arrays. */
-  imt = (BYTE *)image->data;
-  maskt = (BYTE *)image->mask;
-
   /* get the correct array converter and element size, based on dtype code */
   status = get_array_converter(image->dtype, &convert, &elsize);
   if (status != RETURN_OK)
@@ -127,85 +106,129 @@ int sep_background(sep_image* image, int bw, int bh, int fw, int fh,
 	goto exit;
     }
 
+  /* set array pointers to start of the row */
+  imt = (BYTE *)image->data + (size_t)elsize * bufsize * j;
+  maskt = image->mask ? (BYTE *)image->mask + (size_t)melsize * bufsize * j
+    : NULL;
+
+  /* if the last row, modify the width appropriately*/
+  if (j == bkg->ny-1 && npix%bufsize)
+    bufsize = npix%bufsize;
+
   /* If the input array type is not PIXTYPE, allocate a buffer to hold
      converted values */
   if (image->dtype != PIXDTYPE)
     {
       QMALLOC(buf, PIXTYPE, bufsize, status);
       buft = buf;
-      if (status != RETURN_OK)
-	goto exit;
     }
   if (image->mask && (image->mdtype != PIXDTYPE))
     {
       QMALLOC(mbuf, PIXTYPE, bufsize, status);
       mbuft = mbuf;
-      if (status != RETURN_OK)
-	goto exit;
     }
 
-  /* loop over rows of background boxes.
-   * (here, we could loop over individual boxes rather than entire
-   * rows, but this is convenient for converting the image and mask
-   * arrays.  This is also how it is originally done in SExtractor,
-   * because the pixel buffers are only read in from disk in
-   * increments of a row of background boxes at a time.)
-   */
-  for (j=0; j<ny; j++)
-    {
-      /* if the last row, modify the width appropriately*/
-      if (j == ny-1 && npix%bufsize)
-        bufsize = npix%bufsize;
+  /* convert this row to PIXTYPE and store in buffer(s)*/
+  if (image->dtype != PIXDTYPE)
+    convert(imt, bufsize, buft);
+  else
+    buft = (PIXTYPE *)imt;
 
-      /* convert this row to PIXTYPE and store in buffer(s)*/
-      if (image->dtype != PIXDTYPE)
-	convert(imt, bufsize, buft);
+  if (image->mask)
+    {
+      if (image->mdtype != PIXDTYPE)
+	mconvert(maskt, bufsize, mbuft);
       else
-	buft = (PIXTYPE *)imt;
-
-      if (image->mask)
-	{
-	  if (image->mdtype != PIXDTYPE)
-	    mconvert(maskt, bufsize, mbuft);
-	  else
-	    mbuft = (PIXTYPE *)maskt;
-	}
+	mbuft = (PIXTYPE *)maskt;
+    }
 
-      /* Get clipped mean, sigma for all boxes in the row */
-      backstat(backmesh, buft, mbuft, bufsize, nx, image->w, bw, maskthresh);
+  /* Get clipped mean, sigma for all boxes in the row */
+  backstat(backmesh, buft, mbuft, bufsize, nx, image->w, bkg->bw, maskthresh);
 
-      /* Allocate histograms in each box in this row. */
-      bm = backmesh;
-      for (m=nx; m--; bm++)
-	if (bm->mean <= -BIG)
-	  bm->histo=NULL;
-	else
-	  QCALLOC(bm->histo, LONG, bm->nlevels, status);
-      backhisto(backmesh, buft, mbuft, bufsize, nx, image->w, bw, maskthresh);
-
-      /* Compute background statistics from the histograms */
-      bm = backmesh;
-      for (m=0; m<nx; m++, bm++)
-	{
-	  k = m+nx*j;
-	  backguess(bm, bkgout->back+k, bkgout->sigma+k);
-	  free(bm->histo);
-	  bm->histo = NULL;
-	}
+  /* Allocate histograms in each box in this row. */
+  bm = backmesh;
+  for (m=nx; m--; bm++)
+    if (bm->mean <= -BIG)
+      bm->histo=NULL;
+    else
+      QCALLOC(bm->histo, LONG, bm->nlevels, status);
+  backhisto(backmesh, buft, mbuft, bufsize, nx, image->w, bkg->bw, maskthresh);
 
-      /* increment array pointers to next row of background boxes */
-      imt += elsize * bufsize;
-      if (image->mask)
-	maskt += melsize * bufsize;
+  /* Compute background statistics from the histograms */
+  bm = backmesh;
+  for (m=0; m<nx; m++, bm++)
+    {
+      k = m+nx*j;
+      backguess(bm, bkg->back+k, bkg->sigma+k);
     }
 
-  /* free memory */
+ exit:
   free(buf);
-  buf = NULL;
   free(mbuf);
-  mbuf = NULL;
+  if (backmesh)
+    {
+      bm = backmesh;
+      for (m=0; m<nx; m++, bm++)
+	free(bm->histo);
+    }
   free(backmesh);
-  backmesh = NULL;
+  return status;
+}
+
+int sep_background(sep_image* image, int bw, int bh, int fw, int fh,
+                   double fthresh, sep_bkg **bkg)
+{
+  return sep_background_mt(image, bw, bh, fw, fh, fthresh, 1, bkg);
+}
+
+int sep_background_mt(sep_image* image, int bw, int bh, int fw, int fh,
+                      double fthresh, int nthreads, sep_bkg **bkg)
+{
+  int nx, ny, nb;             /* number of background boxes in x, y, total */
+  sep_bkg *bkgout;          /* output */
+  backrows rows;
+  int status;
+
+  status = RETURN_OK;
+  bkgout = NULL;
+
+  /* determine number of background boxes */
+  if ((nx = (image->w - 1) / bw + 1) < 1)
+    nx = 1;
+  if ((ny = (image->h - 1) / bh + 1) < 1)
+    ny = 1;
+  nb = nx*ny;
+
+  /* Allocate the returned struct */
+  QMALLOC(bkgout, sep_bkg, 1, status);
+  bkgout->w = image->w;
+  bkgout->h = image->h;
+  bkgout->nx = nx;
+  bkgout->ny = ny;
+  bkgout->n = nb;
+  bkgout->bw = bw;
+  bkgout->bh = bh;
+  bkgout->back = NULL;
+  bkgout->sigma = NULL;
+  bkgout->dback = NULL;
+  bkgout->dsigma = NULL;
+  QMALLOC(bkgout->back, float, nb, status);
+  QMALLOC(bkgout->sigma, float, nb, status);
+  QMALLOC(bkgout->dback, float, nb, status);
+  QMALLOC(bkgout->dsigma, float, nb, status);
+
+  /* loop over rows of background boxes.
+   * (here, we could loop over individual boxes rather than entire
+   * rows, but this is convenient for converting the image and mask
+   * arrays.  This is also how it is originally done in SExtractor,
+   * because the pixel buffers are only read in from disk in
+   * increments of a row of background boxes at a time.)
+   * Rows are independent, so they can be processed in parallel.
+   */
+  rows.image = image;
+  rows.bkg = bkgout;
+  if ((status = sep_run_jobs(nthreads, ny, backrow, &rows)) != RETURN_OK)
+    goto exit;
 
   /* Median-filter and check suitability of the background map */
   if ((status = filterback(bkgout, fw, fh, fthresh)) != RETURN_OK)
@@ -224,15 +247,6 @@ int sep_background(sep_image* image, int bw, int bh, int fw, int fh,
 
   /* If we encountered a problem, clean up any allocated memory */
  exit:
-  free(buf);
-  free(mbuf);
-  if (backmesh)
-    {
-      bm = backmesh;
-      for (m=0; m<nx; m++, bm++)
-	free(bm->histo);
-    }
-  free(backmesh);
   sep_bkg_free(bkgout);
   *bkg = NULL;
   return status;
@@ -1097,6 +1111,90 @@ int sep_bkg_subarray(sep_bkg *bkg, void *arr, int dtype)
   return status;
 }
 
+/*****************************************************************************/
+/* Multi-threaded array functions. Lines are evaluated independently, each
+ * job processes a band of lines as high as a background mesh. */
+
+typedef struct {
+  sep_bkg *bkg;
+  BYTE *arr;
+  int dtype;
+  int subtract;
+} bkgbands;
+
+static int bkgband(void *arg, int job)
+{
+  bkgbands *bands = (bkgbands *)arg;
+  sep_bkg *bkg = bands->bkg;
+  array_writer write_array;
+  int y, ymax, size, status;
+  PIXTYPE *tmpline;
+  BYTE *arrt;
+
+  tmpline = NULL;
+  status = RETURN_OK;
+
+  /* float background is written directly to the array */
+  if (bands->dtype == SEP_TFLOAT && !bands->subtract)
+    {
+      write_array = NULL;
+      size = sizeof(float);
+    }
+  else
+    {
+      if (bands->subtract)
+	status = get_array_subtractor(bands->dtype, &write_array, &size);
+      else
+	status = get_array_writer(bands->dtype, &write_array, &size);
+      if (status != RETURN_OK)
+	goto exit;
+
+      QMALLOC(tmpline, PIXTYPE, bkg->w, status);
+    }
+
+  y = job * bkg->bh;
+  ymax = y + bkg->bh < bkg->h ? y + bkg->bh : bkg->h;
+  arrt = bands->arr + (size_t)size * bkg->w * y;
+  for (; y<ymax; y++, arrt+=(size_t)size*bkg->w)
+    {
+      if (write_array == NULL)
+	{
+	  if ((status = sep_bkg_line_flt(bkg, y, (float *)arrt)) != RETURN_OK)
+	    goto exit;
+	  continue;
+	}
+      if ((status = sep_bkg_line_flt(bkg, y, tmpline)) != RETURN_OK)
+	goto exit;
+      write_array(tmpline, bkg->w, arrt);
+    }
+
+ exit:
+  free(tmpline);
+  return status;
+}
+
+static int bkg_bands(sep_bkg *bkg, void *arr, int dtype, int subtract,
+                     int nthreads)
+{
+  bkgbands bands;
+
+  bands.bkg = bkg;
+  bands.arr = (BYTE *)arr;
+  bands.dtype = dtype;
+  bands.subtract = subtract;
+  return sep_run_jobs(nthreads, (bkg->h - 1) / bkg->bh + 1, bkgband, &bands);
+}
+
+int sep_bkg_array_mt(sep_bkg *bkg, void *arr, int dtype, int nthreads)
+{
+  return bkg_bands(bkg, arr, dtype, 0, nthreads);
+}
+
+int sep_bkg_subarray_mt(sep_bkg *bkg, void *arr, int dtype, int nthreads)
+{
+  return bkg_bands(bkg, arr, dtype, 1, nthreads);
+}
+
 /*****************************************************************************/
 
 void sep_bkg_free(sep_bkg *bkg)
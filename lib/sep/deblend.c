@@ -41,8 +41,9 @@ int belong(int, objliststruct *, int, objliststruct *);
 int *createsubmap(objliststruct *, int, int *, int *, int *, int *);
 int gatherup(objliststruct *, objliststruct *);
 
-static objliststruct *objlist=NULL;
-static short	     *son=NULL, *ok=NULL;
+/* per thread, so several threads can deblend */
+static __thread objliststruct *objlist=NULL;
+static __thread short	     *son=NULL, *ok=NULL;
 
 /******************************** deblend ************************************/
 /*
@@ -56,7 +57,7 @@ int deblend(objliststruct *objlistin, int l, objliststruct *objlistout,
 	    int deblend_nthresh, double deblend_mincont, int minarea)
 {
   objstruct		*obj;
-  static objliststruct	debobjlist, debobjlist2;
+  static __thread objliststruct	debobjlist, debobjlist2;
   double		thresh, thresh0, value0;
   int			h,i,j,k,m,subx,suby,subh,subw,
                         xn,
@@ -252,6 +253,7 @@ int gatherup(objliststruct *objlistin, objliststruct *objlistout)
 
   int         i,k,l, *n, iclst, npix, bmwidth,
               nobj = objlistin->nobj, xs,ys, x,y, status;
+  unsigned int seed;
 
   bmp = NULL;
   amp = p = NULL;
@@ -270,6 +272,10 @@ int gatherup(objliststruct *objlistin, objliststruct *objlistout)
   p[0] = 0.0;
   bmwidth = objin->xmax - (xs=objin->xmin) + 1;
   npix = bmwidth * (objin->ymax - (ys=objin->ymin) + 1);
+
+  /* random numbers depend only on the object, not on objects extracted
+   * before it, so results do not depend on the order of extraction */
+  seed = (unsigned int)xs * 65599u + (unsigned int)ys;
   if (!(bmp = (char *)calloc(1, npix*sizeof(char))))
     {
       bmp = NULL;
@@ -337,7 +343,7 @@ int gatherup(objliststruct *objlistin, objliststruct *objlistout)
 	    }			
 	  if (p[nobj-1] > 1.0e-31)
 	    {
-	      drand = p[nobj-1]*rand()/RAND_MAX;
+	      drand = p[nobj-1]*rand_r(&seed)/RAND_MAX;
 	      for (i=1; i<nobj && p[i]<drand; i++);
 	      if (i==nobj)
 		i=iclst;
@@ -35,9 +35,9 @@
 			             /* thresholding filtered weight-maps */
 
 /* globals */
-int plistexist_cdvalue, plistexist_thresh, plistexist_var;
-int plistoff_value, plistoff_cdvalue, plistoff_thresh, plistoff_var;
-int plistsize;
+__thread int plistexist_cdvalue, plistexist_thresh, plistexist_var;
+__thread int plistoff_value, plistoff_cdvalue, plistoff_thresh, plistoff_var;
+__thread int plistsize;
 size_t extract_pixstack = 300000;
 
 /* get and set pixstack */
@@ -51,9 +51,19 @@ size_t sep_get_extract_pixstack()
   return extract_pixstack;
 }
 
+/* scan positions of extracted objects, used to merge objects from tiles */
+typedef struct {
+  int n, size;
+  int *line, *col;    /* scan position where the object was completed */
+  int *ymin, *ymax;   /* lines of the detection the object belongs to */
+} objkeys;
+
 int sortit(infostruct *info, objliststruct *objlist, int minarea,
 	   objliststruct *finalobjlist,
-	   int deblend_nthresh, double deblend_mincont, double gain);
+	   int deblend_nthresh, double deblend_mincont, double gain,
+	   int *ymin, int *ymax);
+int addobjkeys(objkeys *keys, int n, int line, int col, int ymin, int ymax);
+void freeobjkeys(objkeys *keys);
 void plistinit(int hasconv, int hasvar);
 void clean(objliststruct *objlist, double clean_param, int *survives);
 int convert_to_catalog(objliststruct *objlist, int *survives,
@@ -169,11 +179,17 @@ void apply_mask_line(arraybuffer *mbuf, arraybuffer *imbuf, arraybuffer *nbuf)
 }
 
 /****************************** extract **************************************/
-int sep_extract(sep_image *image, float thresh, int thresh_type,
-                int minarea, float *conv, int convw, int convh,
-		int filter_type, int deblend_nthresh, double deblend_cont,
-		int clean_flag, double clean_param,
-		sep_catalog **catalog)
+/* Extract objects from `bandh` lines of the image starting at line `yoff`.
+ * Objects are added to `finalobjlist`. If `keys` is not NULL, the scan
+ * position where each object was completed and lines of its detection
+ * are recorded there. `cleanthresh` receives threshold used for cleaning.
+ */
+static int extract_band(sep_image *image, int yoff, int bandh,
+			float thresh, int thresh_type,
+			int minarea, float *conv, int convw, int convh,
+			int filter_type, int deblend_nthresh,
+			double deblend_cont, objliststruct *finalobjlist,
+			objkeys *keys, PIXTYPE *cleanthresh)
 {
   arraybuffer       dbuf, nbuf, mbuf;
   infostruct        curpixinfo, initinfo, freeinfo;
@@ -181,7 +197,8 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   char              newmarker;
   size_t            mem_pixstack;
   int               nposize, oldnposize;
-  int               w, h;
+  int               w, h, fullh;
+  int               elsize, nelsize, melsize, nobj0, pymin, pymax;
   int               co, i, luflag, pstop, xl, xl2, yl, cn;
   int               stacksize, convn, status;
   int               bufh;
@@ -192,16 +209,16 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   pixstatus         cs, ps;
 
   infostruct        *info, *store;
-  objliststruct     *finalobjlist;
   pliststruct	    *pixel, *pixt;
   char              *marker;
   PIXTYPE           *scan, *cdscan, *wscan, *dummyscan;
   PIXTYPE           *sigscan, *workscan;
   float             *convnorm;
-  int               *start, *end, *survives;
+  int               *start, *end;
   pixstatus         *psstack;
   char              errtext[512];
-  sep_catalog       *cat;
+  array_converter   convert;
+  BYTE              *dptr, *nptr, *mptr;
 
   status = RETURN_OK;
   pixel = NULL;
@@ -213,13 +230,11 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   marker = NULL;
   psstack = NULL;
   start = end = NULL;
-  finalobjlist = NULL;
-  survives = NULL;
-  cat = NULL;
   convn = 0;
   sum = 0.0;
   w = image->w;
-  h = image->h;
+  h = bandh;
+  fullh = image->h;
   isvarthresh = 0;
   relthresh = 0.0;
   pixvar = 0.0;
@@ -228,10 +243,6 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   
   mem_pixstack = sep_get_extract_pixstack();
 
-  /* seed the random number generator consistently on each call to get
-   * consistent results. rand() is used in deblending. */
-  srand(1);
-
   /* Noise characteristics of the image: None, scalar or variable? */
   if (image->noise_type == SEP_NOISE_NONE) { } /* nothing to do */
   else if (image->noise == NULL) {
@@ -284,7 +295,8 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   QMALLOC(psstack, pixstatus, stacksize, status);
   QCALLOC(start, int, stacksize, status);
   QMALLOC(end, int, stacksize, status);
-  if ((status = lutzalloc(w, h)) != RETURN_OK)
+  /* lutz() flags objects truncated by the image, not by the band */
+  if ((status = lutzalloc(w, fullh)) != RETURN_OK)
     goto exit;
   if ((status = allocdeblend(deblend_nthresh)) != RETURN_OK)
     goto exit;
@@ -295,16 +307,25 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
    * the buffer height equals the height of the convolution kernel.
    */
   bufh = conv ? convh : 1;
-  status = arraybuffer_init(&dbuf, image->data, image->dtype, w, h, stacksize,
+  status = get_array_converter(image->dtype, &convert, &elsize);
+  if (status != RETURN_OK) goto exit;
+  dptr = (BYTE *)image->data + (size_t)elsize * w * yoff;
+  status = arraybuffer_init(&dbuf, dptr, image->dtype, w, h, stacksize,
                             bufh);
   if (status != RETURN_OK) goto exit;
   if (isvarnoise) {
-      status = arraybuffer_init(&nbuf, image->noise, image->ndtype, w, h,
+      status = get_array_converter(image->ndtype, &convert, &nelsize);
+      if (status != RETURN_OK) goto exit;
+      nptr = (BYTE *)image->noise + (size_t)nelsize * w * yoff;
+      status = arraybuffer_init(&nbuf, nptr, image->ndtype, w, h,
                                 stacksize, bufh);
       if (status != RETURN_OK) goto exit;
     }
   if (image->mask) {
-      status = arraybuffer_init(&mbuf, image->mask, image->mdtype, w, h,
+      status = get_array_converter(image->mdtype, &convert, &melsize);
+      if (status != RETURN_OK) goto exit;
+      mptr = (BYTE *)image->mask + (size_t)melsize * w * yoff;
+      status = arraybuffer_init(&mbuf, mptr, image->mdtype, w, h,
                                 stacksize, bufh);
       if (status != RETURN_OK) goto exit;
     }
@@ -331,13 +352,6 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   objlist.nobj = 1;
   curpixinfo.pixnb = 1;
 
-  /* Init finalobjlist */
-  QMALLOC(finalobjlist, objliststruct, 1, status);
-  finalobjlist->obj = NULL;
-  finalobjlist->plist = NULL;
-  finalobjlist->nobj = finalobjlist->npix = 0;
-
-
   /* Allocate memory for the pixel list */
   plistinit((conv != NULL), (image->noise_type != SEP_NOISE_NONE));
   if (!(pixel = objlist.plist = malloc(nposize=mem_pixstack*plistsize)))
@@ -349,7 +363,6 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   /*----- at the beginning, "free" object fills the whole pixel list */
   freeinfo.firstpix = 0;
   freeinfo.lastpix = nposize-plistsize;
-  printf("lastpix %d %d\n",freeinfo.lastpix,nposize);
   pixt = pixel;
   for (i=plistsize; i<nposize; i += plistsize, pixt += plistsize)
     PLIST(pixt, nextpix) = i;
@@ -431,7 +444,7 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
 	    }	  
 	}
       
-      trunflag = (yl==0 || yl==h-1)? SEP_OBJ_TRUNC: 0;
+      trunflag = (yl+yoff==0 || yl+yoff==fullh-1)? SEP_OBJ_TRUNC: 0;
       
       for (xl=0; xl<=w; xl++)
 	{
@@ -489,7 +502,7 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
 	      /* set values for the new pixel */ 
 	      PLIST(pixt, nextpix) = -1;
 	      PLIST(pixt, x) = xl;
-	      PLIST(pixt, y) = yl;
+	      PLIST(pixt, y) = yl + yoff;
 	      PLIST(pixt, value) = scan[xl];
 	      if (PLISTEXIST(cdvalue))
 		PLISTPIX(pixt, cdvalue) = cdnewsymbol;
@@ -623,12 +636,23 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
 			      /* update threshold before object is processed */
 			      objlist.thresh = thresh;
 
+			      nobj0 = finalobjlist->nobj;
 			      status = sortit(&info[co], &objlist, minarea,
 					      finalobjlist,
 					      deblend_nthresh,deblend_cont,
-                                              image->gain);
+                                              image->gain, &pymin, &pymax);
 			      if (status != RETURN_OK)
 				goto exit;
+
+			      if (keys)
+				{
+				  status = addobjkeys(keys,
+						      finalobjlist->nobj - nobj0,
+						      yl + yoff, xl,
+						      pymin, pymax);
+				  if (status != RETURN_OK)
+				    goto exit;
+				}
 			    }
 
 			  /* free the chain-list */
@@ -674,31 +698,10 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
 
     } /*---------------- End of the loop over the y's -----------------------*/
 
-  /* convert `finalobjlist` to an array of `sepobj` structs */
-  /* if cleaning, see which objects "survive" cleaning. */
-  if (clean_flag)
-    {
-      /* Calculate mthresh for all objects in the list (needed for cleaning) */
-      for (i=0; i<finalobjlist->nobj; i++)
-	{
-	  status = analysemthresh(i, finalobjlist, minarea, thresh);
-	  if (status != RETURN_OK)
-	    goto exit;
-	}
-
-      QMALLOC(survives, int, finalobjlist->nobj, status);
-      clean(finalobjlist, clean_param, survives);
-    }
-
-  /* convert to output catalog */
-  QCALLOC(cat, sep_catalog, 1, status);
-  status = convert_to_catalog(finalobjlist, survives, cat, w, 1);
-  if (status != RETURN_OK) goto exit;
+  /* threshold of pixels without their own threshold, used for cleaning */
+  *cleanthresh = thresh;
 
  exit:
-  free(finalobjlist->obj);
-  free(finalobjlist->plist);
-  free(finalobjlist);
   freedeblend();
   free(pixel);
   lutzfree();
@@ -709,7 +712,6 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   free(psstack);
   free(start);
   free(end);
-  free(survives);
   arraybuffer_free(&dbuf);
   if (image->noise)
     arraybuffer_free(&nbuf);
@@ -726,8 +728,50 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   if (status != RETURN_OK)
     {
       /* free cdscan if we didn't do it on the last `yl` line */
-      if ((cdscan != NULL) && (cdscan != dummyscan))
+      if (conv && (cdscan != NULL) && (cdscan != dummyscan))
         free(cdscan);
+    }
+
+  return status;
+}
+
+
+/* Clean objects and convert them to the output catalog. */
+static int finish_catalog(objliststruct *finalobjlist, int minarea,
+			  PIXTYPE cleanthresh, int clean_flag,
+			  double clean_param, int w, sep_catalog **catalog)
+{
+  int i, status, *survives;
+  sep_catalog *cat;
+
+  status = RETURN_OK;
+  survives = NULL;
+  cat = NULL;
+
+  /* convert `finalobjlist` to an array of `sepobj` structs */
+  /* if cleaning, see which objects "survive" cleaning. */
+  if (clean_flag)
+    {
+      /* Calculate mthresh for all objects in the list (needed for cleaning) */
+      for (i=0; i<finalobjlist->nobj; i++)
+	{
+	  status = analysemthresh(i, finalobjlist, minarea, cleanthresh);
+	  if (status != RETURN_OK)
+	    goto exit;
+	}
+
+      QMALLOC(survives, int, finalobjlist->nobj, status);
+      clean(finalobjlist, clean_param, survives);
+    }
+
+  /* convert to output catalog */
+  QCALLOC(cat, sep_catalog, 1, status);
+  status = convert_to_catalog(finalobjlist, survives, cat, w, 1);
+
+ exit:
+  free(survives);
+  if (status != RETURN_OK)
+    {
       /* clean up catalog if it was allocated */
       sep_catalog_free(cat);
       cat = NULL;
@@ -737,6 +781,344 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   return status;
 }
 
+int sep_extract(sep_image *image, float thresh, int thresh_type,
+                int minarea, float *conv, int convw, int convh,
+		int filter_type, int deblend_nthresh, double deblend_cont,
+		int clean_flag, double clean_param,
+		sep_catalog **catalog)
+{
+  objliststruct     *finalobjlist;
+  PIXTYPE           cleanthresh;
+  int               status;
+
+  status = RETURN_OK;
+  *catalog = NULL;
+
+  /* Init finalobjlist */
+  QMALLOC(finalobjlist, objliststruct, 1, status);
+  finalobjlist->obj = NULL;
+  finalobjlist->plist = NULL;
+  finalobjlist->nobj = finalobjlist->npix = 0;
+
+  status = extract_band(image, 0, image->h, thresh, thresh_type, minarea,
+			conv, convw, convh, filter_type, deblend_nthresh,
+			deblend_cont, finalobjlist, NULL, &cleanthresh);
+  if (status == RETURN_OK)
+    status = finish_catalog(finalobjlist, minarea, cleanthresh, clean_flag,
+			    clean_param, image->w, catalog);
+
+  free(finalobjlist->obj);
+  free(finalobjlist->plist);
+  free(finalobjlist);
+ exit:
+  return status;
+}
+
+/************************** tiled extraction *********************************/
+/*
+The image is split to horizontal tiles, extracted independently. Each tile
+owns a range of lines and extracts few more lines above and below them.
+An object belongs to the tile owning its first line. Filtering makes
+convh/2 lines next to the inner tile edges differ from the full image, so
+the tile must contain line above the object and line below the object
+outside of them - then the object is detected with exactly the same pixels
+and values as in the full image. If an object does not fit, lines from the
+object's first line are moved to a new, higher tile, which is extracted
+again. Objects are then ordered as they are completed by the full image
+scan, and cleaned together.
+*/
+
+#define TILE_OVERLAP 64   /* lines extracted below the owned lines */
+
+typedef struct {
+  int t0, t1;             /* lines extracted by the tile */
+  int o0, o1;             /* lines owned by the tile */
+  objliststruct objlist;  /* objects extracted by the tile */
+  objkeys keys;
+  PIXTYPE cleanthresh;
+  int overflow;           /* first line of owned object which does not fit
+			     to the tile, -1 if all objects fit */
+} tilestruct;
+
+typedef struct {
+  sep_image *image;
+  float thresh;
+  int thresh_type, minarea;
+  float *conv;
+  int convw, convh, filter_type, deblend_nthresh;
+  double deblend_cont;
+  int margin;             /* lines affected by the tile edge */
+  tilestruct *tiles;
+  int *jobs;              /* tiles to extract */
+} tilejobs;
+
+/* object in the merged list */
+typedef struct {
+  int line, col, tile, i;
+} tileobj;
+
+static void freetile(tilestruct *tile)
+{
+  free(tile->objlist.obj);
+  free(tile->objlist.plist);
+  tile->objlist.obj = NULL;
+  tile->objlist.plist = NULL;
+  tile->objlist.nobj = tile->objlist.npix = 0;
+  freeobjkeys(&tile->keys);
+}
+
+static int extract_tile(void *arg, int job)
+{
+  tilejobs *t = (tilejobs *)arg;
+  tilestruct *tile = t->tiles + t->jobs[job];
+  int i, ybottom, status;
+
+  freetile(tile);
+  status = extract_band(t->image, tile->t0, tile->t1 - tile->t0, t->thresh,
+			t->thresh_type, t->minarea, t->conv, t->convw,
+			t->convh, t->filter_type, t->deblend_nthresh,
+			t->deblend_cont, &tile->objlist, &tile->keys,
+			&tile->cleanthresh);
+  if (status != RETURN_OK)
+    return status;
+
+  /* first line below the object which must be exact */
+  ybottom = tile->t1 < t->image->h ? tile->t1 - t->margin - 1
+    : t->image->h;
+  tile->overflow = -1;
+  for (i=0; i<tile->keys.n; i++)
+    if (tile->keys.ymin[i] >= tile->o0 && tile->keys.ymin[i] < tile->o1
+	&& tile->keys.ymax[i] >= ybottom
+	&& (tile->overflow < 0 || tile->keys.ymin[i] < tile->overflow))
+      tile->overflow = tile->keys.ymin[i];
+  return RETURN_OK;
+}
+
+static int tileobjcmp(const void *p1, const void *p2)
+{
+  const tileobj *o1 = (const tileobj *)p1;
+  const tileobj *o2 = (const tileobj *)p2;
+
+  if (o1->line != o2->line)
+    return o1->line < o2->line ? -1 : 1;
+  if (o1->col != o2->col)
+    return o1->col < o2->col ? -1 : 1;
+  if (o1->tile != o2->tile)
+    return o1->tile < o2->tile ? -1 : 1;
+  return o1->i - o2->i;
+}
+
+int sep_extract_mt(sep_image *image, float thresh, int thresh_type,
+		   int minarea, float *conv, int convw, int convh,
+		   int filter_type, int deblend_nthresh, double deblend_cont,
+		   int clean_flag, double clean_param, int tileh, int nthreads,
+		   sep_catalog **catalog)
+{
+  tilejobs          t;
+  tilestruct        *tiles, *tile, *newtile;
+  tileobj           *objs;
+  objliststruct     finalobjlist;
+  int               *newjobs;
+  int               i, j, k, ntiles, maxtiles, njobs, nobjs, status;
+
+  status = RETURN_OK;
+  *catalog = NULL;
+  tiles = NULL;
+  objs = NULL;
+  t.jobs = NULL;
+  ntiles = 0;
+  finalobjlist.obj = NULL;
+  finalobjlist.plist = NULL;
+  finalobjlist.nobj = finalobjlist.npix = 0;
+
+  nthreads = sep_get_nthreads(nthreads);
+  if (tileh <= 0)
+    {
+      /* single thread does not need tiles */
+      if (nthreads == 1)
+	return sep_extract(image, thresh, thresh_type, minarea, conv, convw,
+			   convh, filter_type, deblend_nthresh, deblend_cont,
+			   clean_flag, clean_param, catalog);
+      /* few tiles per thread to balance the load */
+      tileh = (image->h - 1) / (4 * nthreads) + 1;
+      if (tileh < 4 * TILE_OVERLAP)
+	tileh = 4 * TILE_OVERLAP;
+    }
+
+  t.image = image;
+  t.thresh = thresh;
+  t.thresh_type = thresh_type;
+  t.minarea = minarea;
+  t.conv = conv;
+  t.convw = convw;
+  t.convh = convh;
+  t.filter_type = filter_type;
+  t.deblend_nthresh = deblend_nthresh;
+  t.deblend_cont = deblend_cont;
+  t.margin = conv ? convh / 2 : 0;
+
+  ntiles = (image->h - 1) / tileh + 1;
+  maxtiles = 2 * ntiles;
+  QCALLOC(tiles, tilestruct, maxtiles, status);
+  QMALLOC(t.jobs, int, maxtiles, status);
+  for (i=0; i<ntiles; i++)
+    {
+      tile = tiles + i;
+      tile->o0 = i * tileh;
+      tile->o1 = (i + 1) * tileh < image->h ? (i + 1) * tileh : image->h;
+      /* line above the object must be exact */
+      tile->t0 = tile->o0 - t.margin - 1 > 0 ? tile->o0 - t.margin - 1 : 0;
+      tile->t1 = tile->o1 + TILE_OVERLAP + t.margin + 1;
+      if (tile->t1 > image->h)
+	tile->t1 = image->h;
+      t.jobs[i] = i;
+    }
+  njobs = ntiles;
+
+  /* extract tiles; lines of tiles with objects which do not fit are split
+   * to new higher tiles, which are extracted again */
+  while (njobs > 0)
+    {
+      t.tiles = tiles;
+      status = sep_run_jobs(nthreads, njobs, extract_tile, &t);
+      if (status != RETURN_OK)
+	goto exit;
+      k = ntiles;
+      for (i=0, njobs=0; i<ntiles; i++)
+	{
+	  if (tiles[i].overflow < 0)
+	    continue;
+	  if (k == maxtiles)
+	    {
+	      if (!(newtile = (tilestruct *)realloc(tiles, 2 * maxtiles
+						    * sizeof(tilestruct))))
+		{
+		  status = MEMORY_ALLOC_ERROR;
+		  goto exit;
+		}
+	      tiles = newtile;
+	      memset(tiles + maxtiles, 0, maxtiles * sizeof(tilestruct));
+	      if (!(newjobs = (int *)realloc(t.jobs, 2 * maxtiles * sizeof(int))))
+		{
+		  status = MEMORY_ALLOC_ERROR;
+		  goto exit;
+		}
+	      t.jobs = newjobs;
+	      maxtiles *= 2;
+	    }
+	  tile = tiles + i;
+	  newtile = tiles + k;
+	  newtile->o0 = tile->overflow;
+	  newtile->o1 = tile->o1;
+	  newtile->t0 = newtile->o0 - t.margin - 1 > 0 ?
+	    newtile->o0 - t.margin - 1 : 0;
+	  newtile->t1 = tile->t1 + (tile->t1 - newtile->t0);
+	  if (newtile->t1 > image->h)
+	    newtile->t1 = image->h;
+	  tile->o1 = tile->overflow;
+	  tile->overflow = -1;
+	  t.jobs[njobs++] = k++;
+	}
+      ntiles = k;
+    }
+
+  /* select objects owned by tiles in order of the full image scan */
+  nobjs = 0;
+  for (i=0; i<ntiles; i++)
+    nobjs += tiles[i].keys.n;
+  QMALLOC(objs, tileobj, nobjs > 0 ? nobjs : 1, status);
+  k = 0;
+  for (i=0; i<ntiles; i++)
+    {
+      tile = tiles + i;
+      for (j=0; j<tile->keys.n; j++)
+	if (tile->keys.ymin[j] >= tile->o0 && tile->keys.ymin[j] < tile->o1)
+	  {
+	    objs[k].line = tile->keys.line[j];
+	    objs[k].col = tile->keys.col[j];
+	    objs[k].tile = i;
+	    objs[k].i = j;
+	    k++;
+	  }
+    }
+  nobjs = k;
+  qsort(objs, nobjs, sizeof(tileobj), tileobjcmp);
+
+  /* pixel list layout of this thread must match the tiles */
+  plistinit((conv != NULL), (image->noise_type != SEP_NOISE_NONE));
+  for (k=0; k<nobjs; k++)
+    {
+      status = addobjdeep(objs[k].i, &tiles[objs[k].tile].objlist,
+			  &finalobjlist);
+      if (status != RETURN_OK)
+	goto exit;
+    }
+
+  status = finish_catalog(&finalobjlist, minarea, tiles[0].cleanthresh,
+			  clean_flag, clean_param, image->w, catalog);
+
+ exit:
+  if (tiles)
+    for (i=0; i<ntiles; i++)
+      freetile(tiles + i);
+  free(tiles);
+  free(t.jobs);
+  free(objs);
+  free(finalobjlist.obj);
+  free(finalobjlist.plist);
+  return status;
+}
+
+/******************************* objkeys *************************************/
+/*
+Record scan position for the last `n` objects added to the final list.
+*/
+static int growkey(int **key, int size)
+{
+  int *k;
+
+  if (!(k = (int *)realloc(*key, size * sizeof(int))))
+    return MEMORY_ALLOC_ERROR;
+  *key = k;
+  return RETURN_OK;
+}
+
+int addobjkeys(objkeys *keys, int n, int line, int col, int ymin, int ymax)
+{
+  int size, status;
+
+  status = RETURN_OK;
+  if (keys->n + n > keys->size)
+    {
+      size = keys->size ? keys->size : 64;
+      while (size < keys->n + n)
+	size *= 2;
+      if ((status = growkey(&keys->line, size)) != RETURN_OK
+	  || (status = growkey(&keys->col, size)) != RETURN_OK
+	  || (status = growkey(&keys->ymin, size)) != RETURN_OK
+	  || (status = growkey(&keys->ymax, size)) != RETURN_OK)
+	return status;
+      keys->size = size;
+    }
+  for (; n>0; n--, keys->n++)
+    {
+      keys->line[keys->n] = line;
+      keys->col[keys->n] = col;
+      keys->ymin[keys->n] = ymin;
+      keys->ymax[keys->n] = ymax;
+    }
+  return status;
+}
+
+void freeobjkeys(objkeys *keys)
+{
+  free(keys->line);
+  free(keys->col);
+  free(keys->ymin);
+  free(keys->ymax);
+  memset(keys, 0, sizeof(objkeys));
+}
+
 
 /********************************* sortit ************************************/
 /*
@@ -744,10 +1126,11 @@ build the object structure.
 */
 int sortit(infostruct *info, objliststruct *objlist, int minarea,
 	   objliststruct *finalobjlist,
-	   int deblend_nthresh, double deblend_mincont, double gain)
+	   int deblend_nthresh, double deblend_mincont, double gain,
+	   int *ymin, int *ymax)
 {
   objliststruct	        objlistout, *objlist2;
-  static objstruct	obj;
+  static __thread objstruct	obj;
   int 			i, status;
 
   status=RETURN_OK;  
@@ -767,6 +1150,8 @@ int sortit(infostruct *info, objliststruct *objlist, int minarea,
   obj.thresh = objlist->thresh;
 
   preanalyse(0, objlist);
+  *ymin = obj.ymin;
+  *ymax = obj.ymax;
 
   status = deblend(objlist, 0, &objlistout, deblend_nthresh, deblend_mincont,
 		   minarea);
@@ -35,12 +35,13 @@
 void lutzsort(infostruct *, objliststruct *);
 
 /*------------------------- Static buffers for lutz() -----------------------*/
+/* (one set per thread) */
 
-static infostruct  *info=NULL, *store=NULL;
-static char	   *marker=NULL;
-static pixstatus   *psstack=NULL;
-static int         *start=NULL, *end=NULL, *discan=NULL;
-static int         xmin, ymin, xmax, ymax;
+static __thread infostruct  *info=NULL, *store=NULL;
+static __thread char	   *marker=NULL;
+static __thread pixstatus   *psstack=NULL;
+static __thread int         *start=NULL, *end=NULL, *discan=NULL;
+static __thread int         xmin, ymin, xmax, ymax;
 
 
 /******************************* lutzalloc ***********************************/
@@ -108,7 +109,7 @@ int lutz(pliststruct *plistin,
 	 int *objrootsubmap, int subx, int suby, int subw,
 	 objstruct *objparent, objliststruct *objlist, int minarea)
 {
-  static infostruct	curpixinfo,initinfo;
+  static __thread infostruct	curpixinfo,initinfo;
   objstruct		*obj;
   pliststruct		*plist,*pixel, *plistint;
   
@@ -0,0 +1,123 @@
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+*
+* This file is part of SEP
+*
+* Copyright 2026 Petr Kubanek <petr@kubanek.net>
+*
+* SEP is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* SEP is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with SEP.  If not, see <http://www.gnu.org/licenses/>.
+*
+*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+
+/* Worker threads for the multi-threaded front-end. Jobs are independent
+ * (a row of background meshes, a band of lines, an extraction tile or a
+ * block of apertures), so workers simply take the next job number until
+ * all jobs are done. */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "sep.h"
+#include "sepcore.h"
+
+typedef struct {
+  pthread_mutex_t lock;
+  sep_job func;
+  void *arg;
+  int njobs;
+  int next;
+  int status;
+} jobqueue;
+
+static void *worker(void *arg)
+{
+  jobqueue *q = (jobqueue *)arg;
+  int job, status;
+
+  for (;;)
+    {
+      pthread_mutex_lock(&q->lock);
+      /* stop taking new jobs after the first failure */
+      job = (q->status == RETURN_OK && q->next < q->njobs) ? q->next++ : -1;
+      pthread_mutex_unlock(&q->lock);
+      if (job < 0)
+	break;
+
+      status = q->func(q->arg, job);
+      if (status != RETURN_OK)
+	{
+	  pthread_mutex_lock(&q->lock);
+	  if (q->status == RETURN_OK)
+	    q->status = status;
+	  pthread_mutex_unlock(&q->lock);
+	}
+    }
+  return NULL;
+}
+
+int sep_get_nthreads(int nthreads)
+{
+  long n;
+
+  if (nthreads > 0)
+    return nthreads;
+  n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (int)n : 1;
+}
+
+int sep_run_jobs(int nthreads, int njobs, sep_job func, void *arg)
+{
+  jobqueue q;
+  pthread_t *threads;
+  int i, nstarted, status;
+
+  nthreads = sep_get_nthreads(nthreads);
+  if (nthreads > njobs)
+    nthreads = njobs;
+
+  /* nothing to gain from threads, run jobs in the calling thread */
+  if (nthreads <= 1)
+    {
+      for (i=0; i<njobs; i++)
+	if ((status = func(arg, i)) != RETURN_OK)
+	  return status;
+      return RETURN_OK;
+    }
+
+  status = RETURN_OK;
+  QMALLOC(threads, pthread_t, nthreads - 1, status);
+
+  pthread_mutex_init(&q.lock, NULL);
+  q.func = func;
+  q.arg = arg;
+  q.njobs = njobs;
+  q.next = 0;
+  q.status = RETURN_OK;
+
+  /* calling thread is one of the workers; if a thread cannot be
+   * started, the remaining ones take its jobs */
+  for (nstarted=0; nstarted<nthreads-1; nstarted++)
+    if (pthread_create(threads + nstarted, NULL, worker, &q))
+      break;
+  worker(&q);
+  for (i=0; i<nstarted; i++)
+    pthread_join(threads[i], NULL);
+
+  pthread_mutex_destroy(&q.lock);
+  free(threads);
+  return q.status;
+
+ exit:
+  return status;
+}
@@ -0,0 +1,454 @@
+/*
+ * UCAC5 sub-catalog cache with background prefetch.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "ucac5/UCAC5Cache.hpp"
+
+#include <erfa.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+// mas to radians
+#define MAS2R    (M_PI / 180.0 / 3600.0 / 1000.0)
+// 0.1 mas/yr to radians/yr
+#define PM2R     (MAS2R / 10.0)
+
+static void *prefetchThread(void *arg)
+{
+	((UCAC5Cache *) arg)->prefetchLoop();
+	return NULL;
+}
+
+UCAC5Cache::UCAC5Cache(size_t _maxFields):bands(), bandsOpened(false), maxFields(_maxFields), running(false), hits(0), misses(0), prefetched(0)
+{
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&queueCond, NULL);
+	pthread_cond_init(&loadedCond, NULL);
+}
+
+UCAC5Cache::~UCAC5Cache()
+{
+	stopPrefetch();
+
+	for (std::list <UCAC5Field*>::iterator iter = fields.begin(); iter != fields.end(); iter++)
+		delete *iter;
+	fields.clear();
+
+	for (std::map <int, UCAC5Zone>::iterator iter = zones.begin(); iter != zones.end(); iter++)
+	{
+		if (iter->second.xyz)
+			munmap(iter->second.xyz, iter->second.xyz_size);
+		if (iter->second.xyz_fd >= 0)
+			close(iter->second.xyz_fd);
+		if (iter->second.data)
+			munmap(iter->second.data, iter->second.data_size);
+		if (iter->second.data_fd >= 0)
+			close(iter->second.data_fd);
+	}
+
+	pthread_cond_destroy(&loadedCond);
+	pthread_cond_destroy(&queueCond);
+	pthread_mutex_destroy(&mutex);
+}
+
+int UCAC5Cache::openCatalog(const char *_base)
+{
+	base = _base;
+	std::string bfn = base + "/u5index.unf";
+	if (bands.openBand(bfn.c_str()))
+		return -1;
+	bandsOpened = true;
+	return 0;
+}
+
+int UCAC5Cache::startPrefetch(int threads)
+{
+	if (bandsOpened == false || running)
+		return -1;
+
+	pthread_mutex_lock(&mutex);
+	running = true;
+	pthread_mutex_unlock(&mutex);
+
+	for (int i = 0; i < threads; i++)
+	{
+		pthread_t th;
+		if (pthread_create(&th, NULL, prefetchThread, this))
+			break;
+		workers.push_back(th);
+	}
+
+	if (workers.empty())
+	{
+		running = false;
+		return -1;
+	}
+	return 0;
+}
+
+void UCAC5Cache::stopPrefetch()
+{
+	pthread_mutex_lock(&mutex);
+	running = false;
+	// mark dropped fields as failed, so anyone waiting for them will load them himself
+	for (std::list <UCAC5Field*>::iterator iter = queue.begin(); iter != queue.end(); iter++)
+	{
+		(*iter)->ready = true;
+		(*iter)->ret = -1;
+	}
+	queue.clear();
+	pthread_cond_broadcast(&queueCond);
+	pthread_cond_broadcast(&loadedCond);
+	pthread_mutex_unlock(&mutex);
+
+	for (std::vector <pthread_t>::iterator iter = workers.begin(); iter != workers.end(); iter++)
+		pthread_join(*iter, NULL);
+	workers.clear();
+
+	pthread_mutex_lock(&mutex);
+	expire();
+	pthread_mutex_unlock(&mutex);
+}
+
+void UCAC5Cache::prefetch(double ra, double dec, double radius)
+{
+	pthread_mutex_lock(&mutex);
+	if (findField(ra, dec, radius) == NULL)
+	{
+		UCAC5Field *field = newField(ra, dec, radius);
+		if (running)
+		{
+			queue.push_back(field);
+			pthread_cond_signal(&queueCond);
+		}
+		else
+		{
+			// no background thread, load it now
+			pthread_mutex_unlock(&mutex);
+			int ret = loadField(field);
+			pthread_mutex_lock(&mutex);
+			field->ret = ret;
+			field->ready = true;
+			prefetched++;
+			pthread_cond_broadcast(&loadedCond);
+			expire();
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+int UCAC5Cache::getStars(double ra, double dec, double minRad, double maxRad, double epoch, std::vector <UCAC5Star> &stars, bool wait)
+{
+	stars.clear();
+
+	pthread_mutex_lock(&mutex);
+
+	UCAC5Field *field = findField(ra, dec, maxRad);
+	if (field != NULL && field->ready == false)
+	{
+		if (wait)
+		{
+			field->waiting++;
+			while (field->ready == false)
+				pthread_cond_wait(&loadedCond, &mutex);
+			field->waiting--;
+			// prefetch failed or was dropped
+			if (field->ret < 0)
+				field = NULL;
+		}
+		else
+		{
+			field = NULL;
+		}
+	}
+
+	if (field == NULL)
+	{
+		misses++;
+		field = newField(ra, dec, maxRad);
+		pthread_mutex_unlock(&mutex);
+		int ret = loadField(field);
+		pthread_mutex_lock(&mutex);
+		field->ret = ret;
+		field->ready = true;
+		pthread_cond_broadcast(&loadedCond);
+		if (ret < 0)
+		{
+			expire();
+			pthread_mutex_unlock(&mutex);
+			return -1;
+		}
+	}
+	else
+	{
+		hits++;
+	}
+
+	Vector center;
+	eraS2c(ra, dec, center.data);
+
+	double dt = epoch - 2015.0;
+
+	for (std::vector <UCAC5CachedStar>::iterator iter = field->stars.begin(); iter != field->stars.end(); iter++)
+	{
+		// quick check on catalog position; proper motions are below 100 arcsec
+		double d = eraSepp(center.data, iter->xyz.data);
+		if (d > maxRad + 5e-4 || d < minRad - 5e-4)
+			continue;
+
+		UCAC5Star s;
+		s.srcid = iter->srcid;
+		s.dec = iter->dec + iter->pmdec * dt;
+		s.ra = iter->ra + iter->pmra * dt;
+		if (s.ra < 0)
+			s.ra += 2 * M_PI;
+		else if (s.ra >= 2 * M_PI)
+			s.ra -= 2 * M_PI;
+
+		Vector sc;
+		eraS2c(s.ra, s.dec, sc.data);
+		s.dist = eraSepp(center.data, sc.data);
+		if (s.dist > maxRad || s.dist < minRad)
+			continue;
+
+		s.gmag = iter->mags[0] / 1000.0;
+		s.umag = iter->mags[1] / 1000.0;
+		s.rmag = iter->mags[2] / 1000.0;
+		s.jmag = iter->mags[3] / 1000.0;
+		s.hmag = iter->mags[4] / 1000.0;
+		s.kmag = iter->mags[5] / 1000.0;
+
+		stars.push_back(s);
+	}
+
+	expire();
+	pthread_mutex_unlock(&mutex);
+
+	return stars.size();
+}
+
+bool UCAC5Cache::isCached(double ra, double dec, double radius)
+{
+	pthread_mutex_lock(&mutex);
+	UCAC5Field *field = findField(ra, dec, radius);
+	bool ret = field != NULL && field->ready && field->ret >= 0;
+	pthread_mutex_unlock(&mutex);
+	return ret;
+}
+
+size_t UCAC5Cache::fieldCount()
+{
+	pthread_mutex_lock(&mutex);
+	size_t ret = fields.size();
+	pthread_mutex_unlock(&mutex);
+	return ret;
+}
+
+size_t UCAC5Cache::queueSize()
+{
+	pthread_mutex_lock(&mutex);
+	size_t ret = queue.size();
+	pthread_mutex_unlock(&mutex);
+	return ret;
+}
+
+void UCAC5Cache::prefetchLoop()
+{
+	pthread_mutex_lock(&mutex);
+	while (true)
+	{
+		while (running && queue.empty())
+			pthread_cond_wait(&queueCond, &mutex);
+		if (running == false)
+			break;
+
+		UCAC5Field *field = queue.front();
+		queue.pop_front();
+
+		pthread_mutex_unlock(&mutex);
+		int ret = loadField(field);
+		pthread_mutex_lock(&mutex);
+
+		field->ret = ret;
+		field->ready = true;
+		prefetched++;
+		pthread_cond_broadcast(&loadedCond);
+		expire();
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+UCAC5Cache::UCAC5Zone *UCAC5Cache::getZone(int dec_b)
+{
+	std::map <int, UCAC5Zone>::iterator iter = zones.find(dec_b);
+	if (iter != zones.end())
+		return iter->second.data == NULL ? NULL : &(iter->second);
+
+	UCAC5Zone &zone = zones[dec_b];
+	zone.xyz_fd = -1;
+	zone.xyz = NULL;
+	zone.xyz_size = 0;
+	zone.data_fd = -1;
+	zone.data = NULL;
+	zone.data_size = 0;
+
+	char fn[20];
+	snprintf(fn, 20, "/z%03d.xyz", dec_b + 1);
+
+	std::string path = base + fn;
+	zone.xyz_fd = open(path.c_str(), O_RDONLY);
+	if (zone.xyz_fd < 0)
+		return NULL;
+	struct stat sb;
+	if (fstat(zone.xyz_fd, &sb))
+		return NULL;
+	void *m = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, zone.xyz_fd, 0);
+	if (m == MAP_FAILED)
+		return NULL;
+	zone.xyz = (Vector*) m;
+	zone.xyz_size = sb.st_size;
+
+	path = base + std::string(fn, 5);
+	zone.data_fd = open(path.c_str(), O_RDONLY);
+	if (zone.data_fd < 0)
+		return NULL;
+	if (fstat(zone.data_fd, &sb))
+		return NULL;
+	m = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, zone.data_fd, 0);
+	if (m == MAP_FAILED)
+		return NULL;
+	zone.data = (struct ucac5*) m;
+	zone.data_size = sb.st_size;
+
+	return &zone;
+}
+
+int UCAC5Cache::loadField(UCAC5Field *field)
+{
+	uint16_t dec_b = 0, ra_b = 0;
+	uint32_t ra_start = 0;
+	int32_t len;
+
+	while (bands.nextBand(field->ra, field->dec, field->radius, dec_b, ra_b, ra_start, len) == 0)
+	{
+		pthread_mutex_lock(&mutex);
+		UCAC5Zone *zone = getZone(dec_b);
+		pthread_mutex_unlock(&mutex);
+		if (zone == NULL)
+			return -1;
+
+		size_t count = zone->xyz_size / sizeof(Vector);
+		if (count > zone->data_size / sizeof(struct ucac5))
+			count = zone->data_size / sizeof(struct ucac5);
+		if (ra_start > count)
+			continue;
+		size_t end = (len < 0 || ra_start + len > count) ? count : ra_start + len;
+
+		for (size_t i = ra_start; i < end; i++)
+		{
+			if (eraSepp(field->center.data, zone->xyz[i].data) > field->radius)
+				continue;
+
+			struct ucac5 *rec = zone->data + i;
+			UCAC5CachedStar s;
+			s.srcid = rec->srcid;
+			s.ra = rec->rag * MAS2R;
+			s.dec = rec->dcg * MAS2R;
+			eraS2c(s.ra, s.dec, s.xyz.data);
+			double cd = cos(s.dec);
+			s.pmra = cd > 1e-9 ? rec->pmur * PM2R / cd : 0;
+			s.pmdec = rec->pmud * PM2R;
+			s.mags[0] = rec->gmag;
+			s.mags[1] = rec->umag;
+			s.mags[2] = rec->rmag;
+			s.mags[3] = rec->jmag;
+			s.mags[4] = rec->hmag;
+			s.mags[5] = rec->kmag;
+			field->stars.push_back(s);
+		}
+	}
+	return 0;
+}
+
+UCAC5Field *UCAC5Cache::findField(double ra, double dec, double radius)
+{
+	Vector c;
+	eraS2c(ra, dec, c.data);
+	for (std::list <UCAC5Field*>::iterator iter = fields.begin(); iter != fields.end(); iter++)
+	{
+		UCAC5Field *field = *iter;
+		if (field->ready && field->ret < 0)
+			continue;
+		if (eraSepp(field->center.data, c.data) + radius <= field->radius)
+		{
+			// move to front as most recently used
+			fields.erase(iter);
+			fields.push_front(field);
+			return field;
+		}
+	}
+	return NULL;
+}
+
+UCAC5Field *UCAC5Cache::newField(double ra, double dec, double radius)
+{
+	UCAC5Field *field = new UCAC5Field();
+	field->ra = ra;
+	field->dec = dec;
+	field->radius = radius;
+	eraS2c(ra, dec, field->center.data);
+	field->ready = false;
+	field->ret = 0;
+	field->waiting = 0;
+	fields.push_front(field);
+	return field;
+}
+
+void UCAC5Cache::expire()
+{
+	// failed fields first
+	for (std::list <UCAC5Field*>::iterator iter = fields.begin(); iter != fields.end();)
+	{
+		if ((*iter)->ready && (*iter)->ret < 0 && (*iter)->waiting == 0)
+		{
+			delete *iter;
+			iter = fields.erase(iter);
+		}
+		else
+		{
+			iter++;
+		}
+	}
+
+	std::list <UCAC5Field*>::iterator iter = fields.end();
+	while (fields.size() > maxFields && iter != fields.begin())
+	{
+		iter--;
+		// fields being loaded are kept
+		if ((*iter)->ready && (*iter)->waiting == 0)
+		{
+			delete *iter;
+			iter = fields.erase(iter);
+		}
+	}
+}
@@ -0,0 +1,286 @@
+/*
+ * Combine calibration frames into master bias, dark or flat.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "cliapp.h"
+#include "rts2fits/calibstack.h"
+
+#include <math.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <iostream>
+#include <vector>
+
+#define OPT_KAPPA_LOW     OPT_LOCAL + 860
+#define OPT_KAPPA_HIGH    OPT_LOCAL + 861
+#define OPT_MEMORY        OPT_LOCAL + 862
+
+/**
+ * Combine bias, dark or flat frames into master frame. Frames are read
+ * in blocks of rows, so large number of frames can be combined with
+ * limited memory.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class CalibStack:public rts2core::CliApp
+{
+	public:
+		CalibStack (int argc, char **argv);
+
+	protected:
+		virtual int processOption (int opt);
+		virtual int processArgs (const char *arg);
+		virtual int init ();
+
+		virtual void usage ();
+
+		virtual int doProcessing ();
+
+	private:
+		const char *output;
+		const char *imageType;
+		const char *biasFile;
+		const char *darkFile;
+		std::vector <const char *> files;
+
+		rts2image::StackParams params;
+		bool normalize;
+		int verbose;
+
+		// warn if frames have different values which should be the same for given type
+		void checkInputs (std::vector <rts2image::FitsStackInput *> &inputs);
+};
+
+CalibStack::CalibStack (int argc, char **argv):rts2core::CliApp (argc, argv)
+{
+	output = NULL;
+	imageType = NULL;
+	biasFile = NULL;
+	darkFile = NULL;
+
+	normalize = false;
+	verbose = 0;
+
+	params.threads = sysconf (_SC_NPROCESSORS_ONLN);
+	if (params.threads < 1)
+		params.threads = 1;
+
+	addOption ('o', NULL, 1, "output (master) file");
+	addOption ('t', NULL, 1, "type of master frame (zero, dark or flat); default to IMAGETYP of input frames");
+	addOption ('m', NULL, 1, "combination method (median or mean, default to median)");
+	addOption ('k', NULL, 1, "rejection limit in sigmas, both low and high (default to 3)");
+	addOption (OPT_KAPPA_LOW, "kappa-low", 1, "lower rejection limit in sigmas");
+	addOption (OPT_KAPPA_HIGH, "kappa-high", 1, "upper rejection limit in sigmas");
+	addOption ('i', NULL, 1, "maximal number of rejection iterations (default to 3, 0 disables rejection)");
+	addOption ('b', NULL, 1, "master bias subtracted from frames");
+	addOption ('d', NULL, 1, "master dark subtracted from frames, scaled by exposure");
+	addOption ('n', NULL, 0, "normalize frames to unity median (default for flats)");
+	addOption ('j', NULL, 1, "number of threads (default to number of CPUs)");
+	addOption (OPT_MEMORY, "memory", 1, "memory for frame rows (MB, default to 256)");
+	addOption ('v', NULL, 0, "report progress, timing and memory use");
+}
+
+int CalibStack::processOption (int opt)
+{
+	switch (opt)
+	{
+		case 'o':
+			output = optarg;
+			break;
+		case 't':
+			imageType = optarg;
+			break;
+		case 'm':
+			if (!strcasecmp (optarg, "median"))
+			{
+				params.method = rts2image::STACK_MEDIAN;
+			}
+			else if (!strcasecmp (optarg, "mean"))
+			{
+				params.method = rts2image::STACK_MEAN;
+			}
+			else
+			{
+				std::cerr << "unknown combination method " << optarg << ", expected median or mean" << std::endl;
+				return -1;
+			}
+			break;
+		case 'k':
+			params.kappaLow = params.kappaHigh = atof (optarg);
+			break;
+		case OPT_KAPPA_LOW:
+			params.kappaLow = atof (optarg);
+			break;
+		case OPT_KAPPA_HIGH:
+			params.kappaHigh = atof (optarg);
+			break;
+		case 'i':
+			params.iterations = atoi (optarg);
+			break;
+		case 'b':
+			biasFile = optarg;
+			break;
+		case 'd':
+			darkFile = optarg;
+			break;
+		case 'n':
+			normalize = true;
+			break;
+		case 'j':
+			params.threads = atoi (optarg);
+			if (params.threads < 1)
+			{
+				std::cerr << "invalid number of threads " << optarg << std::endl;
+				return -1;
+			}
+			break;
+		case OPT_MEMORY:
+			params.memory = (size_t) (atof (optarg) * 1024 * 1024);
+			break;
+		case 'v':
+			verbose++;
+			break;
+		default:
+			return rts2core::CliApp::processOption (opt);
+	}
+	return 0;
+}
+
+int CalibStack::processArgs (const char *arg)
+{
+	files.push_back (arg);
+	return 0;
+}
+
+int CalibStack::init ()
+{
+	int ret = rts2core::CliApp::init ();
+	if (ret)
+		return ret;
+
+	if (output == NULL)
+	{
+		std::cerr << "missing output file, please specify it with -o" << std::endl;
+		return -1;
+	}
+
+	if (files.size () < 2)
+	{
+		std::cerr << "at least two frames are needed to create master frame" << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
+
+void CalibStack::usage ()
+{
+	std::cout << "  " << getAppName () << " -o bias.fits -t zero /images/bias/*.fits" << std::endl
+		<< "\tcombine bias frames to master bias" << std::endl
+		<< "  " << getAppName () << " -o dark300.fits -b bias.fits /images/darks/*.fits" << std::endl
+		<< "\tcombine bias subtracted darks" << std::endl
+		<< "  " << getAppName () << " -o flatR.fits -t flat -b bias.fits -d dark300.fits /images/flats/R/*.fits" << std::endl
+		<< "\tcombine normalized flats, with bias and scaled dark subtracted" << std::endl;
+}
+
+int CalibStack::doProcessing ()
+{
+	struct timeval start, end;
+	gettimeofday (&start, NULL);
+
+	std::vector <rts2image::FitsStackInput *> inputs;
+	for (std::vector <const char *>::iterator iter = files.begin (); iter != files.end (); iter++)
+	{
+		rts2image::FitsStackInput *in = new rts2image::FitsStackInput (*iter);
+		if (in->open ())
+		{
+			delete in;
+			for (std::vector <rts2image::FitsStackInput *>::iterator di = inputs.begin (); di != inputs.end (); di++)
+				delete *di;
+			return -1;
+		}
+		inputs.push_back (in);
+	}
+
+	const char *type = imageType ? imageType : inputs[0]->imageType.c_str ();
+	params.normalize = normalize || !strcmp (type, "flat");
+
+	checkInputs (inputs);
+
+	rts2image::CalibrationStack cs (params);
+	for (std::vector <rts2image::FitsStackInput *>::iterator iter = inputs.begin (); iter != inputs.end (); iter++)
+		cs.addInput (*iter);
+
+	if (biasFile)
+	{
+		rts2image::FitsStackInput bias (biasFile);
+		if (bias.open () || cs.setBias (bias))
+			return -1;
+	}
+
+	if (darkFile)
+	{
+		rts2image::FitsStackInput dark (darkFile);
+		if (dark.open () || cs.setDark (dark))
+			return -1;
+	}
+
+	if (cs.stack ())
+		return -1;
+
+	if (cs.writeMaster (output, imageType))
+		return -1;
+
+	if (verbose)
+	{
+		gettimeofday (&end, NULL);
+		struct rusage ru;
+		getrusage (RUSAGE_SELF, &ru);
+		std::cout << "combined " << cs.getInputs () << " " << cs.getWidth () << "x" << cs.getHeight () << " frames to " << output
+			<< " in " << (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0 << " s" << std::endl
+			<< "blocks of " << cs.getBlockRows () << " rows, " << params.threads << " threads, buffers " << cs.getBufferSize () / 1048576.0
+			<< " MB, max RSS " << ru.ru_maxrss / 1024.0 << " MB" << std::endl
+			<< "rejected " << cs.getRejected () * 100 << "% of values" << std::endl;
+	}
+
+	return 0;
+}
+
+void CalibStack::checkInputs (std::vector <rts2image::FitsStackInput *> &inputs)
+{
+	rts2image::FitsStackInput *first = inputs[0];
+	for (std::vector <rts2image::FitsStackInput *>::iterator iter = inputs.begin () + 1; iter != inputs.end (); iter++)
+	{
+		rts2image::FitsStackInput *in = *iter;
+		if (in->imageType != first->imageType)
+			std::cerr << "warning: " << in->getName () << " has image type " << in->imageType << ", " << first->getName () << " has " << first->imageType << std::endl;
+		// dark current depends on exposure, flats are normalized
+		if (!params.normalize && darkFile == NULL && fabs (in->exposure - first->exposure) > 0.01)
+			std::cerr << "warning: " << in->getName () << " exposure " << in->exposure << " s differs from " << first->getName () << " exposure " << first->exposure << " s" << std::endl;
+		if (params.normalize && in->filter != first->filter)
+			std::cerr << "warning: " << in->getName () << " was taken in filter " << in->filter << ", " << first->getName () << " in " << first->filter << std::endl;
+	}
+}
+
+int main (int argc, char **argv)
+{
+	CalibStack app (argc, argv);
+	return app.run ();
+}
@@ -3,6 +3,7 @@
 #endif
 
 #include "configuration.h"
+#include "rts2fits/archiveindex.h"
 #include <fitsio.h>
 
 #include <dirent.h>
@@ -13,8 +14,10 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <vector>
 
 rts2core::Configuration *config;
+rts2image::ArchiveIndex *archive = NULL;
 
 int verbose = 0;
 int do_unlink = 1;
@@ -22,7 +25,7 @@ double max, min;
 int recursive = 0;
 
 void
-check_unlink (char *filename)
+check_unlink (const char *filename)
 {
 	if (do_unlink == 0)
 	{
@@ -34,7 +37,7 @@ check_unlink (char *filename)
 		int y;
 		printf ("Remove %s (y/n)?", filename);
 		y = getchar ();
-		if (y != 'y' || y != 'Y')
+		if (y != 'y' && y != 'Y')
 			return;
 	}
 	if (verbose)
@@ -70,17 +73,50 @@ process_dir (char *dirname)
 			perror ("stat");
 			continue;
 		}
-		if (S_ISDIR (st.st_mode) && !strcmp (de->d_name, ".")
-			&& !strcmp (de->d_name, ".."))
+		if (S_ISDIR (st.st_mode) && strcmp (de->d_name, ".")
+			&& strcmp (de->d_name, ".."))
 			process_dir (de->d_name);
 		else if (S_ISREG (st.st_mode) || S_ISLNK (st.st_mode))
 			process_file (de->d_name);
 	}
+	closedir (dir);
 	if (chdir ("..") == -1)
 		perror ("chdir ..");
 }
 
 
+void
+get_limits (const char *camera_name)
+{
+	if (camera_name == NULL)
+	{
+		if (std::isnan (min))
+		{
+			if (config->getDouble ("flatprocess", "min", min))
+				min = -INFINITY;
+		}
+		if (std::isnan (max))
+		{
+			if (config->getDouble ("flatprocess", "max", max))
+				max = INFINITY;
+		}
+	}
+	else
+	{
+		if (std::isnan (min))
+		{
+			if (config->getDouble (camera_name, "flatmin", min))
+				min = -INFINITY;
+		}
+		if (std::isnan (max))
+		{
+			if (config->getDouble (camera_name, "flatmax", max))
+				max = INFINITY;
+		}
+	}
+}
+
+
 void
 process_file (char *filename)
 {
@@ -119,30 +155,12 @@ process_file (char *filename)
 	{
 		if (verbose)
 			printf ("No CAM_NAME in %s, default will be used\n", filename);
-		if (std::isnan (min))
-		{
-			if (config->getDouble ("flatprocess", "min", min))
-				min = -INFINITY;
-		}
-		if (std::isnan (max))
-		{
-			if (config->getDouble ("flatprocess", "max", max))
-				max = INFINITY;
-		}
+		get_limits (NULL);
 		status = 0;
 	}
 	else
 	{
-		if (std::isnan (min))
-		{
-			if (config->getDouble (camera_name, "flatmin", min))
-				min = -INFINITY;
-		}
-		if (std::isnan (max))
-		{
-			if (config->getDouble (camera_name, "flatmax", max))
-				max = INFINITY;
-		}
+		get_limits (camera_name);
 	}
 	if (verbose > 1)
 		printf ("%s: min %f, max %f, npix: %li\n", filename, min, max, npixels);
@@ -179,6 +197,49 @@ process_file (char *filename)
 }
 
 
+/**
+ * Process images in directory and its subdirectories found in archive
+ * index. Image average from index is used, files are opened only if it is
+ * not known.
+ */
+void
+process_index (char *dirname)
+{
+	char *absdir = realpath (dirname, NULL);
+	if (absdir == NULL)
+	{
+		perror ("realpath");
+		return;
+	}
+
+	rts2image::ArchiveQuery q;
+	q.directory = absdir;
+	free (absdir);
+
+	std::vector <const rts2image::ArchiveItem *> items;
+	archive->query (q, items);
+
+	std::vector <std::string> paths;
+	for (std::vector <const rts2image::ArchiveItem *>::iterator iter = items.begin (); iter != items.end (); iter++)
+	{
+		const rts2image::ArchiveEntry &e = (*iter)->entry;
+		if (std::isnan (e.average))
+		{
+			paths.push_back ((*iter)->path);
+			continue;
+		}
+		get_limits (e.camera[0] ? e.camera : NULL);
+		if (verbose)
+			printf ("%s %f (indexed)\n", (*iter)->path.c_str (), e.average);
+		if (e.average < min || e.average > max)
+			check_unlink ((*iter)->path.c_str ());
+	}
+
+	for (std::vector <std::string>::iterator iter = paths.begin (); iter != paths.end (); iter++)
+		process_file ((char *) iter->c_str ());
+}
+
+
 int
 main (int argc, char **argv)
 {
@@ -190,7 +251,7 @@ main (int argc, char **argv)
 
 	while (1)
 	{
-		c = getopt (argc, argv, "hvinm:M:r");
+		c = getopt (argc, argv, "hvinm:M:rx:");
 		if (c == -1)
 			break;
 		switch (c)
@@ -222,6 +283,14 @@ main (int argc, char **argv)
 			case 'r':
 				recursive = 1;
 				break;
+			case 'x':
+				archive = new rts2image::ArchiveIndex ();
+				if (archive->open (optarg))
+				{
+					fprintf (stderr, "Cannot open archive index %s\n", optarg);
+					exit (EXIT_FAILURE);
+				}
+				break;
 			case 'h':
 				printf ("Remove bad flats (with values more common for \n"
 					" darks or for overexposed images)\n"
@@ -234,6 +303,7 @@ main (int argc, char **argv)
 					"\t-M		max value of median for good flat (overwrites config value)\n"
 					"\t-h		that help\n"
 					"\t-r		recursive (check directories for *.fit*)\n"
+					"\t-x <index>	select images in directories from archive index\n"
 					"\t-v		verbose (increase verbosity)\n"
 					" Part of rts2 package.\n", argv[0]);
 				exit (EXIT_SUCCESS);
@@ -264,7 +334,9 @@ main (int argc, char **argv)
 		}
 		if (S_ISDIR (st.st_mode))
 		{
-			if (recursive)
+			if (recursive && archive)
+				process_index (*argv);
+			else if (recursive)
 				process_dir (*argv);
 			else if (verbose)
 				printf ("Directory %s ignored, not in recursive mode\n", *argv);
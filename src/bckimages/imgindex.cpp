@@ -0,0 +1,363 @@
+/*
+ * Image archive indexer.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "cliapp.h"
+#include "configuration.h"
+#include "libnova_cpp.h"
+#include "timestamp.h"
+#include "utilsfunc.h"
+#include "rts2fits/archiveindex.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#define OPT_FROM          OPT_LOCAL + 850
+#define OPT_TO            OPT_LOCAL + 851
+#define OPT_RA            OPT_LOCAL + 852
+#define OPT_DEC           OPT_LOCAL + 853
+#define OPT_RADIUS        OPT_LOCAL + 854
+#define OPT_FIELD         OPT_LOCAL + 855
+
+// compact index when it holds more superseded records than entries
+#define COMPACT_MIN       1000
+
+/**
+ * Build and query image archive index. Directories given as arguments are
+ * scanned (only new and changed files are read), and with -w watched for
+ * changes.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class ImgIndex:public rts2core::CliApp
+{
+	public:
+		ImgIndex (int argc, char **argv);
+
+	protected:
+		virtual int processOption (int opt);
+		virtual int processArgs (const char *arg);
+		virtual int init ();
+
+		virtual void usage ();
+
+		virtual int doProcessing ();
+
+	private:
+		const char *configFile;
+		const char *indexFile;
+		std::vector <const char *> dirs;
+
+		bool doWatch;
+		bool doCompact;
+		bool doQuery;
+		int verbose;
+
+		rts2image::ArchiveQuery query;
+
+		rts2image::ArchiveIndex index;
+
+		void compactIfNeeded ();
+		int watch ();
+		void printQuery ();
+};
+
+ImgIndex::ImgIndex (int argc, char **argv):rts2core::CliApp (argc, argv)
+{
+	configFile = NULL;
+	indexFile = NULL;
+
+	doWatch = false;
+	doCompact = false;
+	doQuery = false;
+	verbose = 0;
+
+	addOption (OPT_CONFIG, "config", 1, "configuration file");
+	addOption ('i', NULL, 1, "index file (default to observatory/archive_index)");
+	addOption ('w', NULL, 0, "watch directories for changes, update index as files are written");
+	addOption ('c', NULL, 0, "compact index");
+	addOption ('q', NULL, 0, "print indexed images; arguments restrict output to directories");
+	addOption ('f', NULL, 1, "query images in given filter");
+	addOption ('t', NULL, 1, "query images of given target ID");
+	addOption (OPT_FROM, "from", 1, "query images taken after given date");
+	addOption (OPT_TO, "to", 1, "query images taken before given date");
+	addOption (OPT_RA, "ra", 1, "query images around given RA");
+	addOption (OPT_DEC, "dec", 1, "query images around given DEC");
+	addOption (OPT_RADIUS, "radius", 1, "query radius (degrees, default to 1)");
+	addOption (OPT_FIELD, "field", 0, "query only images with position inside their field");
+	addOption ('v', NULL, 0, "report progress (more v for more verbosity)");
+}
+
+int ImgIndex::processOption (int opt)
+{
+	switch (opt)
+	{
+		case OPT_CONFIG:
+			configFile = optarg;
+			break;
+		case 'i':
+			indexFile = optarg;
+			break;
+		case 'w':
+			doWatch = true;
+			break;
+		case 'c':
+			doCompact = true;
+			break;
+		case 'q':
+			doQuery = true;
+			break;
+		case 'f':
+			query.filter = std::string (optarg);
+			break;
+		case 't':
+			query.tar_id = atoi (optarg);
+			break;
+		case OPT_FROM:
+			if (parseDate (optarg, query.from))
+			{
+				std::cerr << "invalid date " << optarg << std::endl;
+				return -1;
+			}
+			break;
+		case OPT_TO:
+			if (parseDate (optarg, query.to))
+			{
+				std::cerr << "invalid date " << optarg << std::endl;
+				return -1;
+			}
+			break;
+		case OPT_RA:
+			query.ra = atof (optarg);
+			break;
+		case OPT_DEC:
+			query.dec = atof (optarg);
+			break;
+		case OPT_RADIUS:
+			query.radius = atof (optarg);
+			break;
+		case OPT_FIELD:
+			query.field = true;
+			break;
+		case 'v':
+			verbose++;
+			break;
+		default:
+			return rts2core::CliApp::processOption (opt);
+	}
+	return 0;
+}
+
+int ImgIndex::processArgs (const char *arg)
+{
+	dirs.push_back (arg);
+	return 0;
+}
+
+int ImgIndex::init ()
+{
+	int ret = rts2core::CliApp::init ();
+	if (ret)
+		return ret;
+
+	ret = rts2core::Configuration::instance ()->loadFile (configFile);
+	if (ret)
+		return ret;
+
+	std::string fn;
+	if (indexFile)
+		fn = std::string (indexFile);
+	else
+		rts2core::Configuration::instance ()->getString ("observatory", "archive_index", fn, "");
+	if (fn.empty ())
+	{
+		std::cerr << "index file is not specified, use -i or set observatory/archive_index" << std::endl;
+		return -1;
+	}
+
+	if (!std::isnan (query.ra) && !std::isnan (query.dec) && std::isnan (query.radius))
+		query.radius = 1;
+
+	if (!doQuery && dirs.empty () && !doCompact)
+	{
+		std::cerr << "missing directories to index" << std::endl;
+		return -1;
+	}
+
+	return index.open (fn.c_str (), doQuery && !doCompact);
+}
+
+void ImgIndex::usage ()
+{
+	std::cout << "  " << getAppName () << " /images/archive" << std::endl
+		<< "\tupdate index with new and changed images from /images/archive" << std::endl
+		<< "  " << getAppName () << " -w /images" << std::endl
+		<< "\tindex /images and keep index updated" << std::endl
+		<< "  " << getAppName () << " -q -f R --from 2026-10-18 /images/archive" << std::endl
+		<< "\tprint R images from /images/archive taken since 2026-10-18" << std::endl;
+}
+
+int ImgIndex::doProcessing ()
+{
+	if (doQuery)
+	{
+		printQuery ();
+		return 0;
+	}
+
+	for (std::vector <const char *>::iterator iter = dirs.begin (); iter != dirs.end (); iter++)
+	{
+		int ret = index.scan (*iter);
+		if (ret < 0)
+			return -1;
+		if (verbose)
+			std::cout << *iter << ": " << ret << " files updated" << std::endl;
+	}
+
+	if (doCompact)
+	{
+		if (index.compact ())
+			return -1;
+	}
+	else
+	{
+		compactIfNeeded ();
+	}
+
+	if (verbose)
+		std::cout << "index holds " << index.size () << " images" << std::endl;
+
+	if (doWatch)
+		return watch ();
+
+	return 0;
+}
+
+void ImgIndex::compactIfNeeded ()
+{
+	if (index.getRecords () > 2 * index.size () + COMPACT_MIN)
+	{
+		if (verbose)
+			std::cout << "compacting index, " << index.getRecords () << " records for " << index.size () << " images" << std::endl;
+		index.compact ();
+	}
+}
+
+int ImgIndex::watch ()
+{
+#ifdef RTS2_HAVE_SYS_INOTIFY_H
+	int fd = inotify_init ();
+	if (fd < 0)
+	{
+		std::cerr << "cannot initialize inotify: " << strerror (errno) << std::endl;
+		return -1;
+	}
+
+	for (std::vector <const char *>::iterator iter = dirs.begin (); iter != dirs.end (); iter++)
+	{
+		int ret = index.watch (fd, *iter);
+		if (ret < 0)
+			return -1;
+		if (verbose)
+			std::cout << "watching " << ret << " directories in " << *iter << std::endl;
+	}
+
+	char buf[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+
+	while (!getEndLoop ())
+	{
+		ssize_t len = read (fd, buf, sizeof (buf));
+		if (len < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			std::cerr << "cannot read inotify events: " << strerror (errno) << std::endl;
+			close (fd);
+			return -1;
+		}
+		for (char *p = buf; p < buf + len;)
+		{
+			struct inotify_event *event = (struct inotify_event *) p;
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				// events were lost, rescan to catch up
+				logStream (MESSAGE_WARNING) << "inotify queue overflow, rescanning" << sendLog;
+				for (std::vector <const char *>::iterator iter = dirs.begin (); iter != dirs.end (); iter++)
+					index.scan (*iter);
+			}
+			else
+			{
+				if (verbose > 1 && event->len > 0)
+					std::cout << "event " << std::hex << event->mask << std::dec << " " << event->name << std::endl;
+				index.processEvent (event);
+			}
+			p += sizeof (struct inotify_event) + event->len;
+		}
+		compactIfNeeded ();
+	}
+	close (fd);
+	return 0;
+#else
+	std::cerr << "inotify is not available on this system, cannot watch directories" << std::endl;
+	return -1;
+#endif
+}
+
+void ImgIndex::printQuery ()
+{
+	std::vector <const rts2image::ArchiveItem *> items;
+
+	if (dirs.empty ())
+	{
+		index.query (query, items);
+	}
+	else
+	{
+		for (std::vector <const char *>::iterator iter = dirs.begin (); iter != dirs.end (); iter++)
+		{
+			query.directory = std::string (*iter);
+			index.query (query, items);
+		}
+	}
+
+	for (std::vector <const rts2image::ArchiveItem *>::iterator iter = items.begin (); iter != items.end (); iter++)
+	{
+		const rts2image::ArchiveEntry &e = (*iter)->entry;
+		std::cout << (*iter)->path << " " << TimeJD (e.JD)
+			<< " " << std::setw (5) << e.tar_id
+			<< " " << std::setw (4) << e.obs_id
+			<< " " << std::setw (4) << e.img_id
+			<< " " << std::setw (6) << e.filter
+			<< " " << std::setw (8) << e.exposure
+			<< " " << LibnovaRaDec (e.ra, e.dec)
+			<< " " << std::setw (10) << e.average
+			<< std::endl;
+	}
+	if (verbose)
+		std::cout << items.size () << " images" << std::endl;
+}
+
+int main (int argc, char **argv)
+{
+	ImgIndex app (argc, argv);
+	return app.run ();
+}
@@ -114,6 +114,14 @@ class Dummy:public Camera
 
 			createShiftStore ();
 
+			createVideoMode ();
+
+			createValue (videoRate, "video_rate", "[frames/s] rate of synthetic video frames, 0 for maximal rate", false, RTS2_VALUE_WRITABLE);
+			videoRate->setValueDouble (100);
+
+			videoTemplate = NULL;
+			videoTemplateSize = 0;
+
 			width = 200;
 			height = 100;
 			dataSize = -1;
@@ -132,8 +140,10 @@ class Dummy:public Camera
 
 		virtual ~Dummy (void)
 		{
+			stopVideoMode ();
 			readoutSleep = NULL;
 			delete[] written;
+			delete[] videoTemplate;
 		}
 
 		virtual int processOption (int in_opt)
@@ -269,6 +279,10 @@ class Dummy:public Camera
 
 		virtual bool supportFrameTransfer () { return supportFrameT; }
 	protected:
+		virtual int startVideo ();
+		virtual int readVideoFrame (char *buf, size_t bufSize);
+		virtual int stopVideo ();
+
 		virtual void initBinnings ()
 		{
 			Camera::initBinnings ();
@@ -338,6 +352,15 @@ class Dummy:public Camera
 
 		rts2core::ValueBool *fitsTransfer;
 
+		rts2core::ValueDouble *videoRate;
+
+		// frame copied to video buffers
+		char *videoTemplate;
+		size_t videoTemplateSize;
+		double videoPeriod;
+		double nextVideoFrame;
+		uint64_t videoFrameNum;
+
 		int width;
 		int height;
 
@@ -510,7 +533,6 @@ int Dummy::doReadout ()
 			{
 				size_t s = (ssize_t) chipByteSize () - written[0] < callReadoutSize->getValueLong () ? chipByteSize () - written[0] : callReadoutSize->getValueLong ();
 				ret = sendReadoutData (getDataTop (0), s, 0);
-				std::cout << "ret " << ret << " " << s << std::endl;
 
 				if (ret < 0)
 					return ret;
@@ -547,6 +569,55 @@ int Dummy::doReadout ()
 	return 0;					 // imediately send new data
 }
 
+int Dummy::startVideo ()
+{
+	// generate single frame, use it as a template for all video frames
+	generateImage (chipUsedSize (), 0);
+
+	delete[] videoTemplate;
+	videoTemplateSize = chipByteSize ();
+	videoTemplate = new char[videoTemplateSize];
+	memcpy (videoTemplate, getDataBuffer (0), videoTemplateSize);
+
+	videoPeriod = videoRate->getValueDouble () > 0 ? 1 / videoRate->getValueDouble () : 0;
+	nextVideoFrame = getNow ();
+	videoFrameNum = 0;
+	return 0;
+}
+
+int Dummy::readVideoFrame (char *buf, size_t bufSize)
+{
+	double now = getNow ();
+	if (nextVideoFrame > now)
+	{
+		// do not block for too long, so video can be stopped
+		if (nextVideoFrame - now > 0.1)
+		{
+			usleep (USEC_SEC / 10);
+			return 1;
+		}
+		usleep ((nextVideoFrame - now) * USEC_SEC);
+	}
+	// sensor is not waiting for slow reader
+	if (nextVideoFrame < now - videoPeriod)
+		nextVideoFrame = now;
+	nextVideoFrame += videoPeriod;
+
+	memcpy (buf, videoTemplate, bufSize < videoTemplateSize ? bufSize : videoTemplateSize);
+	// frame number in the first pixels, so consumers can check frame order
+	if (bufSize >= sizeof (videoFrameNum))
+		memcpy (buf, &videoFrameNum, sizeof (videoFrameNum));
+	videoFrameNum++;
+	return 0;
+}
+
+int Dummy::stopVideo ()
+{
+	delete[] videoTemplate;
+	videoTemplate = NULL;
+	return 0;
+}
+
 void Dummy::generateImage (size_t pixelsize, int chan)
 {
 	// artifical star center
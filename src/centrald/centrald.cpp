@@ -469,29 +469,44 @@ Centrald::Centrald (int argc, char **argv):Daemon (argc, argv, SERVERD_HARD_OFF
 
 Centrald::~Centrald (void)
 {
-	if (fileLog)
-	{
-		fileLog->close ();
-		delete fileLog;
-	}
+	// writes all queued messages
+	delete fileLog;
 	// do not report any priority changes
 	priority_client = -2;
 }
 
 void Centrald::openLog ()
 {
-	if (fileLog)
+	Configuration *config = Configuration::instance ();
+
+	if (logFile == std::string ("-"))
 	{
-		fileLog->close ();
 		delete fileLog;
+		fileLog = NULL;
 	}
-	if (logFile == std::string ("-"))
+	else
 	{
-		fileLog = NULL;
-		return;
+		if (fileLog == NULL)
+			fileLog = new rts2core::MessageLog ();
+		double rotateSize;
+		double rotateInterval;
+		int keep;
+		config->getDouble ("centrald", "log_rotate_size", rotateSize, 0);
+		config->getDouble ("centrald", "log_rotate_interval", rotateInterval, 0);
+		config->getInteger ("centrald", "log_keep", keep, 5);
+		fileLog->setRotation (rotateSize * 1024 * 1024, rotateInterval * 3600, keep, config->getBoolean ("centrald", "log_compress", false));
+		// reopens log with the same name, so external rotation still works
+		fileLog->open (logFile.c_str ());
 	}
-	fileLog = new std::ofstream ();
-	fileLog->open (logFile.c_str (), std::ios_base::out | std::ios_base::app);
+
+	std::string journalFile;
+	int journalSize;
+	config->getString ("centrald", "journal", journalFile, "");
+	config->getInteger ("centrald", "journal_size", journalSize, 100000);
+	if (journalFile.empty () || journalSize <= 0)
+		journal.close ();
+	else if (!journal.isOpen () || journalFile != journal.getPath () || (uint32_t) journalSize != journal.getRecords ())
+		journal.create (journalFile.c_str (), journalSize);
 }
 
 int Centrald::reloadConfig ()
@@ -864,15 +879,12 @@ void Centrald::message (Message & msg)
 
 void Centrald::processMessage (Message & msg)
 {
-	// log it
+	// log it - file log is written by background thread
 	if (fileLog)
-	{
-		(*fileLog) << msg << std::endl;
-	}
+		fileLog->log (msg);
 	else
-	{
 		std::cerr << msg << std::endl;
-	}
+	journal.add (msg);
 
 	// and send it to all
 	sendMessageAll (msg);
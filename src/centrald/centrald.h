@@ -27,6 +27,8 @@
 #include <rts2-config.h>
 #include "daemon.h"
 #include "configuration.h"
+#include "messagejournal.h"
+#include "messagelog.h"
 #include "status.h"
 
 using namespace rts2core;
@@ -278,7 +280,8 @@ class Centrald:public Daemon
 		// which sets logfile
 		enum { LOGFILE_ARG, LOGFILE_DEF, LOGFILE_CNF } logFileSource;
 
-		std::ofstream * fileLog;
+		rts2core::MessageLog * fileLog;
+		rts2core::MessageJournal journal;
 
 		void openLog ();
 		int reloadConfig ();
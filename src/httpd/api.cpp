@@ -204,6 +204,44 @@ void API::executeJSON (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::H
 			memcpy (response, &im_h, sizeof (imghdr));
 			return;
 		}
+		// current frame from camera frame ring, available if camera runs on the same host as httpd
+		else if (vals[0] == "ringimage")
+		{
+			conn = master->getOpenConnection (params->getString ("ccd", ""));
+			if (conn == NULL || conn->getOtherType () != DEVICE_TYPE_CCD)
+				throw JSONException ("cannot find camera with given name");
+			rts2core::DataRingRead *ring = master->getFrameRing (conn);
+			if (ring == NULL)
+				throw JSONException ("camera does not publish frames to shared memory ring");
+			int chan = params->getInteger ("chan", 0);
+			if (chan < 0 || chan >= ring->getChannels ())
+				throw JSONException ("cannot find specified channel");
+
+			char *frame = ring->latestFrame (params->getDouble ("timeout", 0));
+			if (frame == NULL)
+				throw JSONException ("camera did not publish new frame");
+
+			char *data = ring->getChannel (frame, chan);
+			imghdr *im_h = (imghdr *) data;
+			response_length = sizeof (imghdr) + (size_t) ntohl (im_h->sizes[0]) * ntohl (im_h->sizes[1]) * (abs ((int16_t) ntohs (im_h->data_type)) / 8);
+			if (response_length > ring->getChannelStride ())
+			{
+				ring->releaseFrame ();
+				throw JSONException ("invalid frame header");
+			}
+
+			response_type = "binary/data";
+			response = new char[response_length];
+			memcpy (response, data, response_length);
+
+			if (ring->releaseFrame ())
+			{
+				delete[] response;
+				response = NULL;
+				throw JSONException ("frame was overwritten while it was copied");
+			}
+			return;
+		}
 		// calls returning arrays
 		else if (vals[0] == "devices")
 		{
@@ -244,6 +282,30 @@ void API::executeJSON (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::H
 			}
 			os << ']';
 		}
+		// returns messages from centrald journal
+		else if (vals[0] == "journal")
+		{
+			rts2core::MessageJournal *journal = ((HttpD *) getMasterApp ())->getJournal ();
+			if (journal == NULL)
+				throw JSONException ("message journal is not available");
+			double to = params->getDouble ("to", getNow ());
+			double from = params->getDouble ("from", to - 86400);
+			int typemask = params->getInteger ("type", MESSAGE_MASK_ALL);
+			const char *device = params->getString ("d", "");
+			int max = params->getInteger ("max", 1000);
+
+			std::vector <Message> msgs;
+			journal->query (from, to, typemask, device, msgs, max > 0 ? max : 0);
+
+			os << "[";
+			for (std::vector <Message>::iterator iter = msgs.begin (); iter != msgs.end (); iter++)
+			{
+				if (iter != msgs.begin ())
+					os << ",";
+				os << "[" << rts2json::JsonDouble (iter->getMessageTime ()) << ",\"" << rts2json::JsonString (iter->getMessageOName ()) << "\"," << iter->getType () << ",\"" << rts2json::JsonString (iter->getMessageString ()) << "\"]";
+			}
+			os << "]";
+		}
 		// returns array with selection value strings
 		else if (vals[0] == "selval")
 		{
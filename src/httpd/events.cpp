@@ -121,9 +121,12 @@ void Events::parseValue (xmlNodePtr event, std::string deviceName)
 	if (cadencyPtr != NULL)
 		cadency = atof ((char *) cadencyPtr->children->content);
 	xmlAttrPtr testPtr = xmlHasProp (event, (xmlChar *) "test");
-	Expression *test = NULL;
+	CompiledExpression *test = NULL;
 	if (testPtr != NULL)
-	  	test = parseExpression ((char *) testPtr->children->content);
+	{
+	  	test = new CompiledExpression ((char *) testPtr->children->content);
+		valueTests.add (test);
+	}
 
 	xmlNodePtr action = event->children;
 	for (; action != NULL; action = action->next)
@@ -376,6 +379,7 @@ void Events::load (const char *file)
 {
 	stateCommands.clear ();
 	valueCommands.clear ();
+	valueTests.clear ();
 	publicPaths.clear ();
 	allskyPaths.clear ();
 	docroot.clear ();
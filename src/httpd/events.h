@@ -65,6 +65,9 @@ class Events
 		ValueCommands valueCommands;
 		MessageCommands messageCommands;
 
+		// compiled value tests of valueCommands
+		ExpressionIndex valueTests;
+
 		BBServers bbServers;
 
 		std::vector <std::string> publicPaths;
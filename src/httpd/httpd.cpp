@@ -50,6 +50,9 @@ using namespace Magick;
 #define OPT_SSL_CERT            OPT_LOCAL + 81
 #define OPT_SSL_KEY             OPT_LOCAL + 82
 
+// number of messages which triggers database insert
+#define HTTPD_MESSAGE_BATCH     100
+
 using namespace XmlRpc;
 
 /**
@@ -464,6 +467,8 @@ int HttpD::idle ()
 {
 	rts2json::HTTPServer::asyncIdle ();
 #ifdef RTS2_HAVE_PGSQL
+	if (!messageQueue.empty () && getNow () - messageQueue.getLastInsert () >= 1)
+		messageQueue.insertDB ();
 	return DeviceDb::idle ();
 #else
 	return rts2core::Device::idle ();
@@ -618,6 +623,8 @@ int HttpD::init ()
 	// auth_localhost
 	auth_localhost = Configuration::instance ()->getBoolean ("xmlrpcd", "auth_localhost", auth_localhost);
 
+	Configuration::instance ()->getDouble ("xmlrpcd", "value_interval", valueInterval, 0);
+
 #ifdef RTS2_HAVE_LIBJPEG
 	Magick::InitializeMagick (".");
 #endif /* RTS2_HAVE_LIBJPEG */
@@ -802,6 +809,8 @@ HttpD::HttpD (int argc, char **argv): rts2core::Device (argc, argv, DEVICE_TYPE_
 
 	debugTestscript = false;
 
+	valueInterval = 0;
+
 	bbQueueName = NULL;
 
 #ifndef RTS2_HAVE_PGSQL
@@ -834,11 +843,55 @@ HttpD::~HttpD ()
 		delete (*iter).second;
 	}
 	sessions.clear ();
+
+	for (std::map <std::string, rts2core::DataRingRead *>::iterator iter = frameRings.begin (); iter != frameRings.end (); iter++)
+		delete iter->second;
+#ifdef RTS2_HAVE_PGSQL
+	messageQueue.insertDB ();
+#endif
 #ifdef RTS2_HAVE_LIBJPEG
 	MagickLib::DestroyMagick ();
 #endif /* RTS2_HAVE_LIBJPEG */
 }
 
+rts2core::MessageJournal * HttpD::getJournal ()
+{
+	// centrald creates new journal when journal size is changed
+	if (journal.isOpen () && journal.isReplaced ())
+		journal.close ();
+	if (!journal.isOpen ())
+	{
+		// journal is created by centrald, it might not exist when httpd starts
+		std::string journalFile;
+		Configuration::instance ()->getString ("centrald", "journal", journalFile, "");
+		if (journalFile.empty () || journal.open (journalFile.c_str ()))
+			return NULL;
+	}
+	return &journal;
+}
+
+rts2core::DataRingRead * HttpD::getFrameRing (rts2core::Connection *conn)
+{
+	rts2core::Value *rv = conn->getValue ("frame_ring");
+	if (rv == NULL || rv->getValue () == NULL || rv->getValue ()[0] == '\0')
+		return NULL;
+
+	std::string rname (rv->getValue ());
+	std::map <std::string, rts2core::DataRingRead *>::iterator iter = frameRings.find (rname);
+	if (iter != frameRings.end ())
+		return iter->second;
+
+	// ring is in local shared memory, so it is available only if camera runs on the same host
+	rts2core::DataRingRead *ring = new rts2core::DataRingRead ();
+	if (ring->attach (rname.c_str ()))
+	{
+		delete ring;
+		return NULL;
+	}
+	frameRings[rname] = ring;
+	return ring;
+}
+
 rts2core::DevClient * HttpD::createOtherType (rts2core::Connection * conn, int other_device_type)
 {
 	switch (other_device_type)
@@ -854,6 +907,9 @@ rts2core::DevClient * HttpD::createOtherType (rts2core::Connection * conn, int o
 		case DEVICE_TYPE_FOCUS:
 			return new XmlDevFocusClient (conn);
 		default:
+			// API clients which need current values can send info command, which is not rate limited
+			if (valueInterval > 0)
+				conn->subscribe (new rts2core::ValueSubscription (valueInterval));
 			return new XmlDevClient (conn);
 	}
 }
@@ -929,16 +985,19 @@ void HttpD::stateChangedEvent (rts2core::Connection * conn, rts2core::ServerStat
 void HttpD::valueChangedEvent (rts2core::Connection * conn, rts2core::Value * new_value)
 {
 	double now = getNow ();
+	// tests depending on the value must be evaluated again
+	events.valueTests.valueChanged (new_value);
+	const char *name;
+	if (conn->getOtherType () == DEVICE_TYPE_SERVERD)
+		name = "centrald";
+	else
+		name = conn->getName ();
+	std::string valueName = new_value->getName ();
 	// look if there is some state change command entry, which match us..
 	for (ValueCommands::iterator iter = events.valueCommands.begin (); iter != events.valueCommands.end (); iter++)
 	{
 		ValueChange *vc = (*iter);
-		const char *name;
-		if (conn->getOtherType () == DEVICE_TYPE_SERVERD)
-			name = "centrald";
-		else
-			name = conn->getName ();
-		if (vc->isForValue (name, new_value->getName (), now))
+		if (vc->isForValue (name, valueName.c_str (), now))
 		{
 			try
 			{
@@ -959,10 +1018,12 @@ void HttpD::message (Message & msg)
 {
 // log message to DB, if database is present
 #ifdef RTS2_HAVE_PGSQL
+	// messages are inserted in batches, from idle or when enough of them is queued
 	if (msg.isNotDebug ())
 	{
-		rts2db::MessageDB msgDB (msg);
-		msgDB.insertDB ();
+		messageQueue.push_back (rts2db::MessageDB (msg));
+		if (messageQueue.size () >= HTTPD_MESSAGE_BATCH)
+			messageQueue.insertDB ();
 	}
 #endif
 	switch (msg.getID ())
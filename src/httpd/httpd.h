@@ -29,12 +29,15 @@
 #include "rts2db/devicedb.h"
 #include "rts2db/plan.h"
 #include "rts2json/addtargetreq.h"
+#include "rts2db/messagedb.h"
 #include "bbapi.h"
 #else
 #include "configuration.h"
 #include "device.h"
 #endif /* RTS2_HAVE_PGSQL */
 
+#include "messagejournal.h"
+#include "dataring.h"
 #include "userlogins.h"
 #include "graphreq.h"
 #include "rts2json/directory.h"
@@ -425,6 +428,17 @@ class HttpD:public rts2core::Device, XmlRpc::XmlRpcServer, rts2json::HTTPServer
 		 */
 		std::deque <Message> & getMessages () { return messages; }
 
+		/**
+		 * Returns centrald message journal, NULL if journal is not configured or cannot be opened.
+		 */
+		rts2core::MessageJournal *getJournal ();
+
+		/**
+		 * Returns reader of camera frame ring, NULL if camera does not publish frames to the ring.
+		 * Reader is attached on the first call.
+		 */
+		rts2core::DataRingRead *getFrameRing (rts2core::Connection *conn);
+
 		virtual const char* getPagePrefix () { return page_prefix.c_str (); }
 
 		virtual bool getDebug ();
@@ -536,6 +550,19 @@ class HttpD:public rts2core::Device, XmlRpc::XmlRpcServer, rts2json::HTTPServer
 
 		std::string page_prefix;
 
+		// minimal interval between updates of a single value from devices other than mount, camera and focuser
+		double valueInterval;
+
+		rts2core::MessageJournal journal;
+
+		// readers of camera frame rings, indexed by ring name
+		std::map <std::string, rts2core::DataRingRead *> frameRings;
+
+#ifdef RTS2_HAVE_PGSQL
+		// messages waiting to be stored in the database
+		rts2db::MessageDBQueue messageQueue;
+#endif
+
 		void sendBB ();
 		void updateObservation (int obs_id, int plan_id);
 
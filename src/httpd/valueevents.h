@@ -40,7 +40,7 @@ namespace rts2xmlrpc
 class ValueChange:public rts2core::Object
 {
 	public:
-		ValueChange (HttpD *_master, std::string _deviceName, std::string _valueName, float _cadency, Expression *test);
+		ValueChange (HttpD *_master, std::string _deviceName, std::string _valueName, float _cadency, CompiledExpression *test);
 
 		/**
 		 * Catch EVENT_XMLRPC_VALUE_TIMER events.
@@ -49,9 +49,9 @@ class ValueChange:public rts2core::Object
 		 */
 		virtual void postEvent (rts2core::Event * event);
 
-		bool isForValue (std::string _deviceName, std::string _valueName, double infoTime)
+		bool isForValue (const char *_deviceName, const char *_valueName, double infoTime)
 		{
-			if (deviceName == _deviceName.c_str () && valueName == _valueName.c_str () && (cadency < 0 || lastTime + cadency < infoTime))
+			if (deviceName == _deviceName && valueName == _valueName && (cadency < 0 || lastTime + cadency < infoTime))
 			{
 				if (test && test->evaluate () == 0)
 						return false;
@@ -82,7 +82,7 @@ class ValueChange:public rts2core::Object
 	private:
 		double lastTime;
 		float cadency;
-		Expression *test;
+		CompiledExpression *test;
 };
 
 /**
@@ -94,7 +94,7 @@ class ValueChange:public rts2core::Object
 class ValueChangeRecord: public ValueChange
 {
 	public:
-		ValueChangeRecord (HttpD *_master, std::string _deviceName, std::string _valueName, float _cadency, Expression *_test):ValueChange (_master, _deviceName, _valueName, _cadency, _test) {}
+		ValueChangeRecord (HttpD *_master, std::string _deviceName, std::string _valueName, float _cadency, CompiledExpression *_test):ValueChange (_master, _deviceName, _valueName, _cadency, _test) {}
 
 		virtual void run (rts2core::Value *val, double validTime);
 #ifdef RTS2_HAVE_PGSQL
@@ -116,7 +116,7 @@ class ValueChangeRecord: public ValueChange
 class ValueChangeCommand: public ValueChange
 {
 	public:
-		ValueChangeCommand (HttpD *_master, std::string _deviceName, std::string _valueName, float _cadency, Expression *_test, std::string _commandName):ValueChange (_master, _deviceName, _valueName, _cadency, _test)
+		ValueChangeCommand (HttpD *_master, std::string _deviceName, std::string _valueName, float _cadency, CompiledExpression *_test, std::string _commandName):ValueChange (_master, _deviceName, _valueName, _cadency, _test)
 		{
 			commandName = _commandName;
 		}
@@ -134,7 +134,7 @@ class ValueChangeCommand: public ValueChange
 class ValueChangeEmail: public ValueChange, public EmailAction
 {
 	public:
-		ValueChangeEmail (HttpD *_master, std::string _deviceName, std::string _valueName, float _cadency, Expression *_test):ValueChange (_master, _deviceName, _valueName, _cadency, _test), EmailAction () {}
+		ValueChangeEmail (HttpD *_master, std::string _deviceName, std::string _valueName, float _cadency, CompiledExpression *_test):ValueChange (_master, _deviceName, _valueName, _cadency, _test), EmailAction () {}
 
 		virtual void run (rts2core::Value *val, double validTime);
 };
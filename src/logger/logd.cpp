@@ -51,6 +51,7 @@ Logd::Logd (int in_argc, char **in_argv):rts2core::Device (in_argc, in_argv, DEV
 
 	addOption ('c', NULL, 1, "specify config file with logged device, timeouts and values");
 	addOption ('o', NULL, 1, "output log file expression");
+	addOption ('b', NULL, 0, "write values in binary columnar format (use rts2-logreader to read them)");
 
 	createValue (logConfig, "config", "logging configuration file", false, RTS2_VALUE_WRITABLE);
 	createValue (logFile, "output", "logging file", false, RTS2_VALUE_WRITABLE);
@@ -83,6 +84,9 @@ int Logd::processOption (int in_opt)
 		case 'o':
 			logFile->setValueCharArr (optarg);
 			return 0;
+		case 'b':
+			binaryOutput = true;
+			return 0;
 	}
 	return rts2core::Device::processOption (in_opt);
 }
@@ -20,6 +20,9 @@
 #include "loggerbase.h"
 #include "client.h"
 
+#define OPT_JOURNAL      OPT_LOCAL + 1
+#define OPT_HISTORY      OPT_LOCAL + 2
+
 namespace rts2logd
 {
 
@@ -35,6 +38,9 @@ class Logger:public rts2core::Client, public LoggerBase
 		virtual int willConnect (rts2core::NetworkAddress * in_addr);
 	private:
 		std::istream * inputStream;
+
+		const char *journal;
+		double history;
 };
 
 }
@@ -45,8 +51,13 @@ Logger::Logger (int in_argc, char **in_argv):rts2core::Client (in_argc, in_argv,
 {
 	setTimeout (USEC_SEC);
 	inputStream = NULL;
+	journal = NULL;
+	history = 3600;
 
 	addOption ('c', NULL, 1, "specify config file with logged device, timeouts and values");
+	addOption ('b', NULL, 0, "write values in binary columnar format (use rts2-logreader to read them)");
+	addOption (OPT_JOURNAL, "journal", 1, "centrald message journal; messages of logged devices are printed before values");
+	addOption (OPT_HISTORY, "history", 1, "print messages from journal for last given number of seconds (default to 3600)");
 }
 
 int Logger::processOption (int in_opt)
@@ -59,6 +70,15 @@ int Logger::processOption (int in_opt)
 			ret = readDevices (*inputStream);
 			delete inputStream;
 			return ret;
+		case 'b':
+			binaryOutput = true;
+			break;
+		case OPT_JOURNAL:
+			journal = optarg;
+			break;
+		case OPT_HISTORY:
+			history = atof (optarg);
+			break;
 		default:
 			return rts2core::Client::processOption (in_opt);
 	}
@@ -73,7 +93,11 @@ int Logger::init ()
 		return ret;
 	if (!inputStream)
 		ret = readDevices (std::cin);
-	return ret;
+	if (ret)
+		return ret;
+	if (journal)
+		printJournal (journal, getNow () - history, std::cout);
+	return 0;
 }
 
 int Logger::willConnect (rts2core::NetworkAddress * in_addr)
@@ -19,9 +19,11 @@
 
 #include "loggerbase.h"
 
+#include <algorithm>
+
 using namespace rts2logd;
 
-DevClientLogger::DevClientLogger (rts2core::Connection * in_conn, double in_numberSec, time_t in_fileCreationInterval, std::list < std::string > &in_logNames):rts2core::DevClient (in_conn)
+DevClientLogger::DevClientLogger (rts2core::Connection * in_conn, double in_numberSec, time_t in_fileCreationInterval, std::list < std::string > &in_logNames, bool in_binary):rts2core::DevClient (in_conn)
 {
 	exp = NULL;
 
@@ -35,10 +37,17 @@ DevClientLogger::DevClientLogger (rts2core::Connection * in_conn, double in_numb
 	logNames = in_logNames;
 
 	outputStream = &std::cout;
+
+	columnWriter = in_binary ? new rts2core::ColumnLogWriter (in_conn->getName ()) : NULL;
 }
 
 DevClientLogger::~DevClientLogger (void)
 {
+	if (columnWriter)
+	{
+		writeColumns (true);
+		delete columnWriter;
+	}
 	if (outputStream != &std::cout)
 		delete outputStream;
 	delete exp;
@@ -83,12 +92,15 @@ void DevClientLogger::changeOutputStream ()
 	if (expanded == expandedFilename)
 		return;
 	expandedFilename = expanded;
-	std::ofstream * nstream = new std::ofstream (expandedFilename.c_str(), std::ios_base::app);
+	std::ofstream * nstream = new std::ofstream (expandedFilename.c_str(), columnWriter ? (std::ios_base::app | std::ios_base::binary) : std::ios_base::app);
 	if (nstream->fail ())
 	{
 		delete nstream;
 		return;
 	}
+	// rows collected so far belong to the old file
+	if (columnWriter)
+		writeColumns (true);
 	if (outputStream != &std::cout)
 		delete outputStream;
 	
@@ -101,6 +113,21 @@ void DevClientLogger::infoOK ()
 		fillLogValues ();
 	// check if we have to change log file..
 	changeOutputStream ();
+	if (columnWriter)
+	{
+		struct timeval tv;
+		getConnection ()->getInfoTime (tv);
+		double t = tv.tv_sec + (double) tv.tv_usec / USEC_SEC;
+		if (columnWriter->addRow (t, logValues))
+		{
+			// columns changed, write rows collected so far and start a new chunk
+			writeColumns (true);
+			if (columnWriter->addRow (t, logValues))
+				logStream (MESSAGE_ERROR) << "cannot add values of " << getName () << " to binary log" << sendLog;
+		}
+		writeColumns (false);
+		return;
+	}
 	*outputStream << getName ();
 	for (std::list < rts2core::Value * >::iterator iter = logValues.begin (); iter != logValues.end (); iter++)
 	{
@@ -112,6 +139,9 @@ void DevClientLogger::infoOK ()
 void DevClientLogger::infoFailed ()
 {
  	changeOutputStream ();
+	// binary log records only values
+	if (columnWriter)
+		return;
 	*outputStream << "info failed" << std::endl;
 }
 
@@ -124,6 +154,19 @@ void DevClientLogger::idle ()
 		queCommand (new rts2core::CommandInfo (getMaster ()));
 		timeradd (&now, &numberSec, &nextInfoCall);
 	}
+	if (columnWriter)
+		writeColumns (false);
+}
+
+void DevClientLogger::writeColumns (bool force)
+{
+	if (columnWriter->getRows () == 0)
+		return;
+	if (force || columnWriter->getRows () >= COLUMNLOG_CHUNK_ROWS || getNow () > columnWriter->getFirstTime () + COLUMNLOG_CHUNK_INTERVAL)
+	{
+		if (columnWriter->write (*outputStream))
+			logStream (MESSAGE_ERROR) << "cannot write values of " << getName () << " to " << expandedFilename << sendLog;
+	}
 }
 
 void DevClientLogger::postEvent (rts2core::Event * event)
@@ -137,8 +180,14 @@ void DevClientLogger::postEvent (rts2core::Event * event)
 	rts2core::DevClient::postEvent (event);
 }
 
+static bool messageTimeLess (const rts2core::Message &m1, const rts2core::Message &m2)
+{
+	return m1.getMessageTime () < m2.getMessageTime ();
+}
+
 LoggerBase::LoggerBase ()
 {
+	binaryOutput = false;
 }
 
 int LoggerBase::readDevices (std::istream & is)
@@ -202,10 +251,35 @@ int LoggerBase::willConnect (rts2core::NetworkAddress * in_addr)
 	return 0;
 }
 
+int LoggerBase::printJournal (const char *journal, double from, std::ostream &os)
+{
+	rts2core::MessageJournal mj;
+	if (mj.open (journal))
+	{
+		logStream (MESSAGE_ERROR) << "cannot open message journal " << journal << sendLog;
+		return -1;
+	}
+	std::vector <rts2core::Message> msgs;
+	double to = getNow ();
+	for (std::list < LogValName >::iterator iter = devicesNames.begin (); iter != devicesNames.end (); iter++)
+		mj.query (from, to, MESSAGE_MASK_ALL, iter->devName.c_str (), msgs);
+	std::stable_sort (msgs.begin (), msgs.end (), messageTimeLess);
+	for (std::vector <rts2core::Message>::iterator iter = msgs.begin (); iter != msgs.end (); iter++)
+		os << (*iter) << std::endl;
+	return 0;
+}
+
 rts2core::DevClient * LoggerBase::createOtherType (rts2core::Connection * conn, int other_device_type)
 {
 	LogValName *val = getLogVal (conn->getName ());
 	if (val)
-		return new DevClientLogger (conn, val->timeout, 60, val->valueList);
+	{
+		// values are logged after info command, other updates are not needed more often
+		rts2core::ValueSubscription *subscription = new rts2core::ValueSubscription (val->timeout);
+		for (std::list < std::string >::iterator iter = val->valueList.begin (); iter != val->valueList.end (); iter++)
+			subscription->addPattern (iter->c_str ());
+		conn->subscribe (subscription);
+		return new DevClientLogger (conn, val->timeout, 60, val->valueList, binaryOutput);
+	}
 	return NULL;
 }
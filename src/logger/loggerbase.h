@@ -22,9 +22,16 @@
 #include "command.h"
 #include "expander.h"
 #include "utilsfunc.h"
+#include "messagejournal.h"
+#include "columnlog.h"
 
 #define EVENT_SET_LOGFILE RTS2_LOCAL_EVENT+800
 
+// binary log chunk is written after this number of rows..
+#define COLUMNLOG_CHUNK_ROWS       3600
+// ..or when its first row is older than this number of seconds
+#define COLUMNLOG_CHUNK_INTERVAL   600
+
 namespace rts2logd
 {
 
@@ -45,8 +52,9 @@ class DevClientLogger:public rts2core::DevClient
 		 * @param in_numberSec             Number of seconds when the info command will be send.
 		 * @param in_fileCreationInterval  Interval between file creation.
 		 * @param in_logNames              String with space separated names of values which will be logged.
+		 * @param in_binary                Write values as binary columnar chunks.
 		 */
-		DevClientLogger (rts2core::Connection * in_conn, double in_numberSec, time_t in_fileCreationInterval, std::list < std::string > &in_logNames);
+		DevClientLogger (rts2core::Connection * in_conn, double in_numberSec, time_t in_fileCreationInterval, std::list < std::string > &in_logNames, bool in_binary = false);
 
 		virtual ~ DevClientLogger (void);
 		virtual void infoOK ();
@@ -68,6 +76,9 @@ class DevClientLogger:public rts2core::DevClient
 
 		std::ostream * outputStream;
 
+		// not NULL when values are written in binary format
+		rts2core::ColumnLogWriter * columnWriter;
+
 		rts2core::Expander * exp;
 		std::string expandPattern;
 		std::string expandedFilename;
@@ -101,6 +112,13 @@ class DevClientLogger:public rts2core::DevClient
 		 * Change output stream according to new expansion.
 		 */
 		void changeOutputStream ();
+
+		/**
+		 * Write binary chunk if it is full or old enough.
+		 *
+		 * @param force  write any collected rows
+		 */
+		void writeColumns (bool force);
 };
 
 /**
@@ -136,10 +154,26 @@ class LoggerBase
 		LoggerBase ();
 		rts2core::DevClient *createOtherType (rts2core::Connection * conn, int other_device_type);
 	protected:
+		/**
+		 * Write values in binary columnar format.
+		 */
+		bool binaryOutput;
+
 		int readDevices (std::istream & is);
 
 		LogValName *getLogVal (const char *name);
 		int willConnect (rts2core::NetworkAddress * in_addr);
+
+		/**
+		 * Print messages of logged devices from centrald message journal.
+		 *
+		 * @param journal  journal file
+		 * @param from     print messages newer than from
+		 * @param os       output stream
+		 *
+		 * @return -1 if journal cannot be opened, 0 otherwise
+		 */
+		int printJournal (const char *journal, double from, std::ostream &os);
 	private:
 		std::list < LogValName > devicesNames;
 };
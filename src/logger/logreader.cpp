@@ -0,0 +1,265 @@
+/*
+ * Reader of binary logs written by rts2-logger and rts2-logd.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "cliapp.h"
+#include "columnlog.h"
+#include "numfmt.h"
+#include "timestamp.h"
+#include "utilsfunc.h"
+
+#include <fstream>
+#include <iostream>
+#include <math.h>
+
+#define OPT_FROM         OPT_LOCAL + 1
+#define OPT_TO           OPT_LOCAL + 2
+
+namespace rts2logd
+{
+
+/**
+ * Prints or exports to CSV binary logs.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class LogReader:public rts2core::CliApp
+{
+	public:
+		LogReader (int in_argc, char **in_argv);
+
+	protected:
+		virtual int processOption (int in_opt);
+		virtual int processArgs (const char *arg);
+		virtual int doProcessing ();
+
+	private:
+		std::vector <const char *> files;
+		const char *device;
+		std::vector <const char *> columns;
+		double from;
+		double to;
+		bool csv;
+		bool list;
+
+		// columns printed in the last CSV header
+		std::string lastHeader;
+
+		int readFile (std::istream &is, const char *name);
+		void printChunk (rts2core::ColumnLogChunk &chunk);
+		void printCSV (rts2core::ColumnLogChunk &chunk);
+		void printSummary (rts2core::ColumnLogChunk &chunk);
+};
+
+}
+
+using namespace rts2logd;
+
+/**
+ * Append string as CSV field, quoted if needed.
+ */
+static void appendCSV (std::string &out, const std::string &s)
+{
+	if (s.find_first_of (",\"\n") == std::string::npos)
+	{
+		out.append (s);
+		return;
+	}
+	out += '"';
+	for (std::string::const_iterator iter = s.begin (); iter != s.end (); iter++)
+	{
+		if (*iter == '"')
+			out += '"';
+		out += *iter;
+	}
+	out += '"';
+}
+
+LogReader::LogReader (int in_argc, char **in_argv):rts2core::CliApp (in_argc, in_argv)
+{
+	device = NULL;
+	from = NAN;
+	to = NAN;
+	csv = false;
+	list = false;
+
+	addOption ('d', NULL, 1, "print only values of given device");
+	addOption ('v', NULL, 1, "print only given value (can be repeated)");
+	addOption (OPT_FROM, "from", 1, "print values logged after given date");
+	addOption (OPT_TO, "to", 1, "print values logged before given date");
+	addOption ('c', "csv", 0, "export values as CSV");
+	addOption ('l', NULL, 0, "list chunks - device, number of rows, time range and values");
+}
+
+int LogReader::processOption (int in_opt)
+{
+	time_t t;
+	switch (in_opt)
+	{
+		case 'd':
+			device = optarg;
+			break;
+		case 'v':
+			columns.push_back (optarg);
+			break;
+		case OPT_FROM:
+			if (parseDate (optarg, &t))
+				return -1;
+			from = t;
+			break;
+		case OPT_TO:
+			if (parseDate (optarg, &t))
+				return -1;
+			to = t;
+			break;
+		case 'c':
+			csv = true;
+			break;
+		case 'l':
+			list = true;
+			break;
+		default:
+			return rts2core::CliApp::processOption (in_opt);
+	}
+	return 0;
+}
+
+int LogReader::processArgs (const char *arg)
+{
+	files.push_back (arg);
+	return 0;
+}
+
+int LogReader::doProcessing ()
+{
+	if (files.empty ())
+		return readFile (std::cin, "standard input");
+
+	int ret = 0;
+	for (std::vector <const char *>::iterator iter = files.begin (); iter != files.end (); iter++)
+	{
+		std::ifstream is (*iter, std::ios_base::in | std::ios_base::binary);
+		if (is.fail ())
+		{
+			std::cerr << "cannot open " << *iter << std::endl;
+			ret = -1;
+			continue;
+		}
+		if (readFile (is, *iter))
+			ret = -1;
+	}
+	return ret;
+}
+
+int LogReader::readFile (std::istream &is, const char *name)
+{
+	rts2core::ColumnLogReader reader (is);
+	if (device)
+		reader.setDevice (device);
+	for (std::vector <const char *>::iterator iter = columns.begin (); iter != columns.end (); iter++)
+		reader.addColumn (*iter);
+
+	rts2core::ColumnLogChunk chunk;
+	int ret;
+	while ((ret = reader.readChunk (chunk)) > 0)
+	{
+		if (chunk.getRows () == 0)
+			continue;
+		// skip chunks outside of requested period
+		if ((!isnan (from) && chunk.times.back () < from) || (!isnan (to) && chunk.times.front () > to))
+			continue;
+		if (list)
+			printSummary (chunk);
+		else if (csv)
+			printCSV (chunk);
+		else
+			printChunk (chunk);
+	}
+	if (reader.getSkipped () > 0)
+		std::cerr << name << ": skipped " << reader.getSkipped () << " bytes of corrupted or incomplete data" << std::endl;
+	return ret;
+}
+
+void LogReader::printChunk (rts2core::ColumnLogChunk &chunk)
+{
+	std::string line;
+	for (size_t r = 0; r < chunk.getRows (); r++)
+	{
+		if ((!isnan (from) && chunk.times[r] < from) || (!isnan (to) && chunk.times[r] > to))
+			continue;
+		line.clear ();
+		line.append (chunk.device);
+		for (std::vector <rts2core::ColumnLogColumn>::iterator iter = chunk.columns.begin (); iter != chunk.columns.end (); iter++)
+		{
+			line += ' ';
+			iter->appendValue (line, r);
+		}
+		std::cout << Timestamp (chunk.times[r]) << " " << line << std::endl;
+	}
+}
+
+void LogReader::printCSV (rts2core::ColumnLogChunk &chunk)
+{
+	std::string header ("time,device");
+	for (std::vector <rts2core::ColumnLogColumn>::iterator iter = chunk.columns.begin (); iter != chunk.columns.end (); iter++)
+	{
+		header += ',';
+		appendCSV (header, iter->name);
+	}
+	if (header != lastHeader)
+	{
+		std::cout << header << std::endl;
+		lastHeader = header;
+	}
+
+	std::string line;
+	for (size_t r = 0; r < chunk.getRows (); r++)
+	{
+		if ((!isnan (from) && chunk.times[r] < from) || (!isnan (to) && chunk.times[r] > to))
+			continue;
+		line.clear ();
+		rts2core::appendDouble (line, chunk.times[r]);
+		line += ',';
+		appendCSV (line, chunk.device);
+		for (std::vector <rts2core::ColumnLogColumn>::iterator iter = chunk.columns.begin (); iter != chunk.columns.end (); iter++)
+		{
+			line += ',';
+			if (iter->type == COLUMNLOG_STRING)
+				appendCSV (line, iter->strings[r]);
+			else
+				iter->appendValue (line, r);
+		}
+		line += '\n';
+		std::cout << line;
+	}
+	std::cout.flush ();
+}
+
+void LogReader::printSummary (rts2core::ColumnLogChunk &chunk)
+{
+	std::cout << chunk.device << " " << chunk.getRows () << " " << Timestamp (chunk.times.front ()) << " " << Timestamp (chunk.times.back ());
+	for (std::vector <std::string>::iterator iter = chunk.names.begin (); iter != chunk.names.end (); iter++)
+		std::cout << " " << *iter;
+	std::cout << std::endl;
+}
+
+int main (int argc, char **argv)
+{
+	LogReader app (argc, argv);
+	return app.run ();
+}
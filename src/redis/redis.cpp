@@ -20,14 +20,37 @@
 #include <string>
 #include "redis.h"
 
+#define OPT_REDIS         OPT_LOCAL + 1
+#define OPT_HASH          OPT_LOCAL + 2
+#define OPT_STREAM        OPT_LOCAL + 3
+#define OPT_MAX_BACKLOG   OPT_LOCAL + 4
+
 using namespace std;
 
+void ProxyRedisConn::redisConnected ()
+{
+    proxy->publishAll ();
+}
+
 RedisProxy::RedisProxy (int in_argc, char **in_argv):rts2db::DeviceDb (in_argc, in_argv, DEVICE_TYPE_REDIS, "REDIS")
 {
-    redisConn = redisConnect("127.0.0.1", 6379);
-    if (redisConn != NULL && redisConn->err) {
-        logStream (MESSAGE_ERROR) << "Redis connection error: " << redisConn->errstr << sendLog;
-    }
+    notifyConn = NULL;
+    redisConn = NULL;
+    redisHost = "127.0.0.1";
+    redisPort = 6379;
+    maxBacklog = 10000;
+    hashes = false;
+    streamLength = 0;
+
+    createValue (redisConnected, "redis_connected", "true if connected to Redis server", false);
+    createValue (redisBacklog, "redis_backlog", "number of Redis commands waiting for reply", false);
+    createValue (redisCommands, "redis_commands", "number of commands sent to Redis server", false);
+    createValue (redisErrors, "redis_errors", "number of failed Redis commands", false);
+
+    addOption (OPT_REDIS, "redis", 1, "Redis server (host:port), default is 127.0.0.1:6379");
+    addOption (OPT_HASH, "hash", 0, "store device values in hash rts2:<device> instead of rts2:<device>:<value> keys");
+    addOption (OPT_STREAM, "stream", 1, "add changed values to stream rts2:<device>:history, trimmed to about given number of entries");
+    addOption (OPT_MAX_BACKLOG, "max-backlog", 1, "postpone value updates while more commands wait for reply (default 10000)");
 }
 
 RedisProxy::~RedisProxy (void)
@@ -37,7 +60,32 @@ RedisProxy::~RedisProxy (void)
 
 int RedisProxy::processOption (int in_opt)
 {
-    return rts2db::DeviceDb::processOption (in_opt);
+    switch (in_opt)
+    {
+        case OPT_REDIS:
+            {
+                redisHost = string (optarg);
+                size_t sep = redisHost.find (':');
+                if (sep != string::npos)
+                {
+                    redisPort = atoi (redisHost.substr (sep + 1).c_str ());
+                    redisHost = redisHost.substr (0, sep);
+                }
+            }
+            break;
+        case OPT_HASH:
+            hashes = true;
+            break;
+        case OPT_STREAM:
+            streamLength = atol (optarg);
+            break;
+        case OPT_MAX_BACKLOG:
+            maxBacklog = atol (optarg);
+            break;
+        default:
+            return rts2db::DeviceDb::processOption (in_opt);
+    }
+    return 0;
 }
 
 int RedisProxy::init ()
@@ -55,9 +103,21 @@ int RedisProxy::init ()
 
 	addConnection (notifyConn);
 
+	// connection failures are retried from idle
+	redisConn = new ProxyRedisConn (this, redisHost.c_str (), redisPort);
+	redisConn->setMaxBacklog (maxBacklog);
+	redisConn->init ();
+	addConnection (redisConn);
+
 	return ret;
 }
 
+int RedisProxy::idle ()
+{
+    writeValues ();
+    return rts2db::DeviceDb::idle ();
+}
+
 int RedisProxy::reloadConfig ()
 {
 	int ret;
@@ -77,23 +137,25 @@ int RedisProxy::setValue (rts2core::Value *oldValue, rts2core::Value *newValue)
 
 int RedisProxy::deleteConnection (rts2core::Connection * in_conn)
 {
-    redisReply *r, *r2;
-    string connName;
-    if (in_conn == getSingleCentralConn())
-        connName = "centrald";
-    else
-        connName = string(in_conn->getName());
-    r = (redisReply*)redisCommand(redisConn, "SREM rts2:devices %s", connName.c_str());
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "KEYS rts2:%s*", connName.c_str());
-    for (size_t i=0; i < r->elements; i++) {
-        r2 = (redisReply*)redisCommand(redisConn, "DEL %s", r->element[i]->str);
-        freeReplyObject(r2);
+    int ret = rts2db::DeviceDb::deleteConnection (in_conn);
+    if (ret || in_conn == redisConn || in_conn == notifyConn)
+        return ret;
+
+    if (pendingValues.erase (in_conn) == 0 || redisConn == NULL)
+        return ret;
+
+    string connName = getConnName (in_conn);
+    string prefix = "rts2:" + connName;
+    vector <string> del = {"DEL", prefix, prefix + ":values", prefix + ":State"};
+    if (!hashes)
+    {
+        for (rts2core::ValueVector::iterator iter = in_conn->valueBegin (); iter != in_conn->valueEnd (); iter++)
+            del.push_back (prefix + ":" + (*iter)->getName ());
     }
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH %s disconnect", connName.c_str());
-    freeReplyObject(r);
-	return 0;
+    redisConn->command ({"SREM", "rts2:devices", connName});
+    redisConn->command (del);
+    redisConn->command ({"PUBLISH", connName, "disconnect"});
+    return ret;
 }
 
 void RedisProxy::postEvent (rts2core::Event * event)
@@ -103,7 +165,14 @@ void RedisProxy::postEvent (rts2core::Event * event)
 
 int RedisProxy::info ()
 {
-	return rts2db::DeviceDb::info ();
+    redisConnected->setValueBool (redisConn && redisConn->isConnected ());
+    if (redisConn)
+    {
+        redisBacklog->setValueLong (redisConn->getBacklog ());
+        redisCommands->setValueLong (redisConn->getCommands ());
+        redisErrors->setValueLong (redisConn->getErrors ());
+    }
+    return rts2db::DeviceDb::info ();
 }
 
 void RedisProxy::changeMasterState (rts2_status_t old_state, rts2_status_t new_state)
@@ -122,45 +191,35 @@ int RedisProxy::commandAuthorized (rts2core::Connection * conn)
 
 rts2core::DevClient *RedisProxy::createOtherType (rts2core::Connection *conn, int other_device_type)
 {
-    redisReply *r;
-    string connName(conn->getName());
-    if (connName == "") connName = "centrald";
-    r = (redisReply*)redisCommand(redisConn, "SADD rts2:devices %s", connName.c_str());
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH %s connect", connName.c_str());
-    freeReplyObject(r);
+    string connName = getConnName (conn);
+    pendingValues[conn];
+    if (redisConn)
+    {
+        redisConn->command ({"SADD", "rts2:devices", connName});
+        redisConn->command ({"PUBLISH", connName, "connect"});
+    }
     return new RedisProxyClient (conn);
 }
 
 void RedisProxy::stateChangedEvent(rts2core::Connection *conn, rts2core::ServerState *new_state)
 {
-    redisReply *r;
-    string connName(conn->getName());
-    if (conn == getSingleCentralConn())
-        connName = "centrald";
-    r = (redisReply*)redisCommand(redisConn, "SET rts2:%s:State %d", connName.c_str(), new_state->getValue());
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH %s state", connName.c_str());
-    freeReplyObject(r);
+    writeState (conn);
 }
 
 void RedisProxy::valueChangedEvent(rts2core::Connection *conn, rts2core::Value *new_value)
 {
-    redisReply *r;
-    string connName(conn->getName());
-    if (conn == getSingleCentralConn())
-        connName = "centrald";
-    r = (redisReply*)redisCommand(redisConn, "SADD rts2:%s:values %s", connName.c_str(), string(new_value->getName()).c_str());
-    freeReplyObject(r);
-    string key = "rts2:" + connName + ":" + new_value->getName();
-    r = (redisReply*)redisCommand(redisConn, "SET %s %s", key.c_str(), new_value->getValue());
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH %s value %s", connName.c_str(), new_value->getName().c_str());
-    freeReplyObject(r);
+    // values are written in batches from idle, only the last value is written
+    int id = conn->getValueId (new_value->getName ().c_str ());
+    if (id >= 0)
+        pendingValues[conn].add (id);
 }
 
 void RedisProxy::message(rts2core::Message &msg)
 {
+    // messages are dropped when Redis cannot keep up
+    if (redisConn == NULL || redisConn->isFull ())
+        return;
+
     struct tm tmesg;
     time_t t = msg.getMessageTimeSec();
     localtime_r (&t, &tmesg);
@@ -168,9 +227,109 @@ void RedisProxy::message(rts2core::Message &msg)
     snprintf(buf, 1000, "%02i:%02i:%02i.%03i %s %s %s", tmesg.tm_hour, tmesg.tm_min, tmesg.tm_sec,
              (int)(msg.getMessageTimeUSec() / 1000), msg.getMessageOName(), msg.getTypeString(), msg.getMessageString().c_str());
 
-    redisReply *r;
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH message %s", buf);
-    freeReplyObject(r);
+    redisConn->command ({"PUBLISH", "message", buf});
+}
+
+void RedisProxy::publishAll ()
+{
+    for (map <rts2core::Connection *, PendingValues>::iterator iter = pendingValues.begin (); iter != pendingValues.end (); iter++)
+    {
+        rts2core::Connection *conn = iter->first;
+        PendingValues &pv = iter->second;
+        redisConn->command ({"SADD", "rts2:devices", getConnName (conn)});
+        writeState (conn);
+        pv.known.assign (pv.known.size (), false);
+        for (rts2core::ValueVector::iterator viter = conn->valueBegin (); viter != conn->valueEnd (); viter++)
+        {
+            int id = conn->getValueId ((*viter)->getName ().c_str ());
+            if (id >= 0)
+                pv.add (id);
+        }
+    }
+}
+
+string RedisProxy::getConnName (rts2core::Connection *conn)
+{
+    if (conn == getSingleCentralConn () || conn->getName ()[0] == '\0')
+        return string ("centrald");
+    return string (conn->getName ());
+}
+
+void RedisProxy::writeValues ()
+{
+    // postpone updates until server replies to already sent commands
+    if (redisConn == NULL || !redisConn->isConnected () || redisConn->isFull ())
+        return;
+    for (map <rts2core::Connection *, PendingValues>::iterator iter = pendingValues.begin (); iter != pendingValues.end (); iter++)
+    {
+        if (!iter->second.ids.empty ())
+            writeDeviceValues (iter->first, iter->second);
+    }
+}
+
+void RedisProxy::writeDeviceValues (rts2core::Connection *conn, PendingValues &pv)
+{
+    string connName = getConnName (conn);
+    string prefix = "rts2:" + connName;
+
+    vector <string> set;
+    vector <string> add = {"SADD", prefix + ":values"};
+    vector <string> history;
+    vector <string> names;
+
+    if (hashes)
+        set = {"HSET", prefix};
+    else
+        set = {"MSET"};
+    if (streamLength > 0)
+        history = {"XADD", prefix + ":history", "MAXLEN", "~", to_string (streamLength), "*"};
+
+    for (vector <int>::iterator iter = pv.ids.begin (); iter != pv.ids.end (); iter++)
+    {
+        pv.queued[*iter] = false;
+        rts2core::Value *val = conn->getValueById (*iter);
+        if (val == NULL)
+            continue;
+        string name = val->getName ();
+        const char *v = val->getValue ();
+        if (v == NULL)
+            v = "";
+        set.push_back (hashes ? name : prefix + ":" + name);
+        set.push_back (v);
+        if (!pv.known[*iter])
+        {
+            add.push_back (name);
+            pv.known[*iter] = true;
+        }
+        if (streamLength > 0)
+        {
+            history.push_back (name);
+            history.push_back (v);
+        }
+        names.push_back (name);
+    }
+    pv.ids.clear ();
+
+    if (names.empty ())
+        return;
+
+    // the whole batch is pipelined, subscribers are notified after values are set
+    redisConn->command (set);
+    if (add.size () > 2)
+        redisConn->command (add);
+    if (streamLength > 0)
+        redisConn->command (history);
+    for (vector <string>::iterator iter = names.begin (); iter != names.end (); iter++)
+        redisConn->command ({"PUBLISH", connName, "value " + *iter});
+}
+
+void RedisProxy::writeState (rts2core::Connection *conn)
+{
+    if (redisConn == NULL)
+        return;
+    string connName = getConnName (conn);
+    redisConn->command ({"SET", "rts2:" + connName + ":State", to_string (conn->getState ())});
+    redisConn->command ({"PUBLISH", connName, "state"});
 }
 
 int main (int argc, char **argv)
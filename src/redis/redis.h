@@ -26,7 +26,53 @@
 #include <rts2db/plan.h>
 #include <rts2db/target.h>
 #include <devclient.h>
-#include <hiredis.h>
+
+#include "redisconn.h"
+
+#include <map>
+
+class RedisProxy;
+
+/**
+ * Redis connection of the proxy, republishes all values after (re)connection.
+ */
+class ProxyRedisConn:public RedisConn
+{
+    public:
+        ProxyRedisConn (RedisProxy *_master, const char *_host, int _port):RedisConn ((rts2core::Block *) _master, _host, _port) { proxy = _master; }
+
+        virtual void redisConnected ();
+
+    private:
+        RedisProxy *proxy;
+};
+
+/**
+ * Values of a device waiting to be written to Redis.
+ */
+class PendingValues
+{
+    public:
+        // IDs of changed values, see rts2core::Connection::getValueId
+        std::vector <int> ids;
+        // true for values in ids
+        std::vector <bool> queued;
+        // true for values already added to the device value set
+        std::vector <bool> known;
+
+        void add (int id)
+        {
+            if (id >= (int) queued.size ())
+            {
+                queued.resize (id + 1, false);
+                known.resize (id + 1, false);
+            }
+            if (queued[id])
+                return;
+            queued[id] = true;
+            ids.push_back (id);
+        }
+};
 
 class RedisProxy : public rts2db::DeviceDb
 {
@@ -57,11 +103,18 @@ public:
 
     virtual void message (rts2core::Message & msg);
 
+    /**
+     * Queue all values and states, called after connection to Redis is established.
+     */
+    void publishAll ();
+
 protected:
     virtual int processOption (int in_opt);
 
     virtual int init ();
 
+    virtual int idle ();
+
     virtual int reloadConfig ();
 
     virtual int setValue (rts2core::Value *oldValue, rts2core::Value *newValue);
@@ -70,7 +123,33 @@ protected:
 
 private:
     rts2core::ConnNotify *notifyConn;
-    redisContext *redisConn;
+
+    ProxyRedisConn *redisConn;
+    std::string redisHost;
+    int redisPort;
+    long maxBacklog;
+
+    // store device values in a hash rts2:<device>
+    bool hashes;
+    // maximal length of value history stream, 0 when history is not written
+    long streamLength;
+
+    std::map <rts2core::Connection *, PendingValues> pendingValues;
+
+    rts2core::ValueBool *redisConnected;
+    rts2core::ValueLong *redisBacklog;
+    rts2core::ValueLong *redisCommands;
+    rts2core::ValueLong *redisErrors;
+
+    std::string getConnName (rts2core::Connection *conn);
+
+    /**
+     * Write changed values of all devices to Redis in pipelined batches.
+     */
+    void writeValues ();
+    void writeDeviceValues (rts2core::Connection *conn, PendingValues &pv);
+
+    void writeState (rts2core::Connection *conn);
 };
 
 class RedisProxyClient : public rts2core::DevClient
@@ -0,0 +1,226 @@
+/*
+ * Non-blocking connection to Redis server.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "redisconn.h"
+#include "block.h"
+
+#include <poll.h>
+
+// hiredis event library adapter, events are added to Block poll
+static void pollAddRead (void *privdata)
+{
+	((RedisConn *) privdata)->setPoll (POLLIN, true);
+}
+
+static void pollDelRead (void *privdata)
+{
+	((RedisConn *) privdata)->setPoll (POLLIN, false);
+}
+
+static void pollAddWrite (void *privdata)
+{
+	((RedisConn *) privdata)->setPoll (POLLOUT, true);
+}
+
+static void pollDelWrite (void *privdata)
+{
+	((RedisConn *) privdata)->setPoll (POLLOUT, false);
+}
+
+static void pollCleanup (void *privdata)
+{
+	((RedisConn *) privdata)->setPoll (POLLIN | POLLOUT, false);
+}
+
+static void connectCallback (const redisAsyncContext *c, int status)
+{
+	((RedisConn *) c->data)->connectFinished (status);
+}
+
+static void disconnectCallback (const redisAsyncContext *c, int status)
+{
+	((RedisConn *) c->data)->disconnected (status);
+}
+
+static void replyCallback (redisAsyncContext *c, void *r, void *privdata)
+{
+	((RedisConn *) privdata)->reply ((redisReply *) r);
+}
+
+RedisConn::RedisConn (rts2core::Block *_master, const char *_host, int _port):rts2core::ConnNoSend (_master)
+{
+	host = std::string (_host);
+	port = _port;
+
+	ac = NULL;
+	connected = false;
+	pollEvents = 0;
+	lastConnect = 0;
+
+	backlog = 0;
+	maxBacklog = 10000;
+	commands = 0;
+	errors = 0;
+	lastError = 0;
+}
+
+RedisConn::~RedisConn ()
+{
+	if (ac)
+		redisAsyncFree (ac);
+	ac = NULL;
+	// socket is closed by hiredis
+	sock = -1;
+}
+
+int RedisConn::init ()
+{
+	time (&lastConnect);
+	ac = redisAsyncConnect (host.c_str (), port);
+	if (ac == NULL)
+	{
+		logStream (MESSAGE_ERROR) << "cannot allocate Redis context" << sendLog;
+		return -1;
+	}
+	if (ac->err)
+	{
+		logStream (MESSAGE_ERROR) << "cannot connect to Redis server " << host << ":" << port << ": " << ac->errstr << sendLog;
+		redisAsyncFree (ac);
+		ac = NULL;
+		return -1;
+	}
+
+	ac->data = this;
+	ac->ev.data = this;
+	ac->ev.addRead = pollAddRead;
+	ac->ev.delRead = pollDelRead;
+	ac->ev.addWrite = pollAddWrite;
+	ac->ev.delWrite = pollDelWrite;
+	ac->ev.cleanup = pollCleanup;
+
+	sock = ac->c.fd;
+
+	// connection is established when socket becomes writable
+	redisAsyncSetConnectCallback (ac, connectCallback);
+	redisAsyncSetDisconnectCallback (ac, disconnectCallback);
+	return 0;
+}
+
+int RedisConn::add (rts2core::Block *block)
+{
+	if (sock >= 0 && pollEvents)
+		block->addPollFD (sock, pollEvents);
+	return 0;
+}
+
+int RedisConn::receive (rts2core::Block *block)
+{
+	if (ac && sock >= 0 && block->isForRead (sock))
+		redisAsyncHandleRead (ac);
+	return 0;
+}
+
+int RedisConn::writable (rts2core::Block *block)
+{
+	// context can be freed in receive
+	if (ac && sock >= 0 && block->isForWrite (sock))
+		redisAsyncHandleWrite (ac);
+	return 0;
+}
+
+int RedisConn::idle ()
+{
+	if (ac == NULL && time (NULL) >= lastConnect + REDIS_RECONNECT)
+		init ();
+	return rts2core::ConnNoSend::idle ();
+}
+
+int RedisConn::command (const std::vector <std::string> &args)
+{
+	if (ac == NULL || !connected)
+		return -1;
+
+	const char *argv[args.size ()];
+	size_t argvlen[args.size ()];
+	for (size_t i = 0; i < args.size (); i++)
+	{
+		argv[i] = args[i].c_str ();
+		argvlen[i] = args[i].length ();
+	}
+	if (redisAsyncCommandArgv (ac, replyCallback, this, args.size (), argv, argvlen) != REDIS_OK)
+		return -1;
+	backlog++;
+	commands++;
+	return 0;
+}
+
+void RedisConn::connectFinished (int status)
+{
+	if (status != REDIS_OK)
+	{
+		logStream (MESSAGE_ERROR) << "cannot connect to Redis server " << host << ":" << port << ": " << ac->errstr << sendLog;
+		// context is freed by hiredis
+		freeContext ();
+		return;
+	}
+	logStream (MESSAGE_INFO) << "connected to Redis server " << host << ":" << port << sendLog;
+	connected = true;
+	redisConnected ();
+}
+
+void RedisConn::disconnected (int status)
+{
+	if (status != REDIS_OK)
+		logStream (MESSAGE_ERROR) << "disconnected from Redis server " << host << ":" << port << ": " << ac->errstr << sendLog;
+	// context is freed by hiredis
+	freeContext ();
+}
+
+void RedisConn::reply (redisReply *r)
+{
+	if (backlog > 0)
+		backlog--;
+	// NULL reply for commands pending during disconnection
+	if (r == NULL || r->type != REDIS_REPLY_ERROR)
+		return;
+	errors++;
+	time_t now = time (NULL);
+	if (now > lastError + 60)
+	{
+		logStream (MESSAGE_ERROR) << "Redis command failed: " << r->str << sendLog;
+		lastError = now;
+	}
+}
+
+void RedisConn::setPoll (short events, bool set)
+{
+	if (set)
+		pollEvents |= events;
+	else
+		pollEvents &= ~events;
+}
+
+void RedisConn::freeContext ()
+{
+	ac = NULL;
+	sock = -1;
+	connected = false;
+	pollEvents = 0;
+	backlog = 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * Non-blocking connection to Redis server.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_REDISCONN__
+#define __RTS2_REDISCONN__
+
+#include "connnosend.h"
+
+#include <hiredis.h>
+#include <async.h>
+
+#include <string>
+#include <vector>
+
+// seconds between reconnection attempts
+#define REDIS_RECONNECT       5
+
+/**
+ * Connection to Redis server, running hiredis asynchronous context inside
+ * Block poll loop. Commands are pipelined - they are written when the
+ * socket is writable and replies are processed when they arrive, so slow
+ * or remote server never blocks the loop. Number of commands waiting for
+ * reply is limited, callers shall check isFull before queueing commands
+ * they can postpone.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class RedisConn:public rts2core::ConnNoSend
+{
+	public:
+		RedisConn (rts2core::Block *_master, const char *_host, int _port);
+		virtual ~RedisConn ();
+
+		/**
+		 * Start connecting to the server.
+		 */
+		virtual int init ();
+
+		virtual int add (rts2core::Block *block);
+		virtual int receive (rts2core::Block *block);
+		virtual int writable (rts2core::Block *block);
+
+		/**
+		 * Reconnect lost connection.
+		 */
+		virtual int idle ();
+
+		/**
+		 * Queue command.
+		 *
+		 * @param args  command and its arguments
+		 *
+		 * @return -1 if the server is not connected, 0 on success
+		 */
+		int command (const std::vector <std::string> &args);
+
+		bool isConnected () { return connected; }
+
+		/**
+		 * Returns true if too many commands wait for reply.
+		 */
+		bool isFull () { return backlog >= maxBacklog; }
+
+		/**
+		 * Number of commands waiting for reply.
+		 */
+		long getBacklog () { return backlog; }
+
+		void setMaxBacklog (long _maxBacklog) { maxBacklog = _maxBacklog; }
+
+		uint64_t getCommands () { return commands; }
+		uint64_t getErrors () { return errors; }
+
+		/**
+		 * Called when connection to the server is established.
+		 */
+		virtual void redisConnected () {}
+
+		// hiredis callbacks
+		void connectFinished (int status);
+		void disconnected (int status);
+		void reply (redisReply *r);
+		void setPoll (short events, bool set);
+
+	private:
+		std::string host;
+		int port;
+
+		redisAsyncContext *ac;
+		bool connected;
+		short pollEvents;
+		time_t lastConnect;
+
+		long backlog;
+		long maxBacklog;
+		uint64_t commands;
+		uint64_t errors;
+		time_t lastError;
+
+		void freeContext ();
+};
+
+#endif // !__RTS2_REDISCONN__
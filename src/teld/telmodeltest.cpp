@@ -20,6 +20,7 @@
 #include "telmodel.h"
 #include "gem.h"
 #include "gpointmodel.h"
+#include "gpointfit.h"
 #include "tpointmodel.h"
 #include "libnova_cpp.h"
 #include "rts2format.h"
@@ -41,6 +42,11 @@
 #define OPT_T_POINT_MODEL	  OPT_LOCAL + 1005
 #define OPT_CALCULATE_ERRORS      OPT_LOCAL + 1006
 #define OPT_CALCULATE_COUNTS      OPT_LOCAL + 1007
+#define OPT_FIT                   OPT_LOCAL + 1008
+#define OPT_FIT_EXTRA             OPT_LOCAL + 1009
+#define OPT_FIT_FIXED             OPT_LOCAL + 1010
+#define OPT_FIT_SIGMA             OPT_LOCAL + 1011
+#define OPT_FIT_OUTPUT            OPT_LOCAL + 1012
 
 using namespace rts2telmodel;
 
@@ -145,6 +151,14 @@ class TelModelTest:public rts2core::CliApp
 		time_t localDate;
 		struct ln_equ_posn localPosition;
 
+		// model fitting
+		std::vector <std::string> fitFiles;
+		std::vector <std::string> fitExtras;
+		std::vector <std::string> fitFixed;
+		double fitSigma;
+		const char *fitOutput;
+
+		int processFit ();
 		void processErrorFile ();
 		void processCountsFile ();
 		void test (double ra, double dec);
@@ -177,6 +191,8 @@ TelModelTest::TelModelTest (int in_argc, char **in_argv):rts2core::CliApp (in_ar
 	printJD = false;
 	includeRefraction = false;
 	localDate = 0;
+	fitSigma = NAN;
+	fitOutput = NULL;
 	addOption (OPT_T_POINT_MODEL, "t-point-model", 1, "T-Point model filename");
 	addOption (OPT_RTS2_MODEL, "rts2-model", 1, "RTS2 model filename");
 	addOption (OPT_CALCULATE_ERRORS, "calculate-errors", 1, "calculate errors from given input file, specified in input format for model-fit.py script");
@@ -192,6 +208,11 @@ TelModelTest::TelModelTest (int in_argc, char **in_argv):rts2core::CliApp (in_ar
 	addOption ('r', NULL, 0, "Print random RA DEC, handy for telescope pointing tests");
 	addOption (OPT_DATE, "date", 1, "Print transformations for given date");
 	addOption (OPT_RADEC, "radec", 1, "Print transformations of given RA-DEC target pair");
+	addOption (OPT_FIT, "fit", 1, "fit GPoint model to given input file (in gpoint format); can be repeated");
+	addOption (OPT_FIT_EXTRA, "fit-extra", 1, "add extra term to fitted model, axis:function:terms:consts (e.g. az:sincos:az;el:2;2)");
+	addOption (OPT_FIT_FIXED, "fit-fixed", 1, "do not fit given model parameter; can be repeated");
+	addOption (OPT_FIT_SIGMA, "fit-sigma", 1, "remove observations with error above sigma * RMS and refit");
+	addOption (OPT_FIT_OUTPUT, "fit-output", 1, "write fitted model to given file");
 }
 
 TelModelTest::~TelModelTest (void)
@@ -208,7 +229,9 @@ void TelModelTest::usage ()
 	<< "To compare results of actual model with data from observed images (simple logic):" << std::endl
 		<< "\t" << getAppName () << " -m /etc/rts2/model -i *.fits" << std::endl
 	<< "To generate random pointings" << std::endl
-		<< "\t" << getAppName () << " -r" << std::endl;
+		<< "\t" << getAppName () << " -r" << std::endl
+	<< "To fit alt-az model with extra term to data, removing outliers above 3 sigma:" << std::endl
+		<< "\t" << getAppName () << " --fit gpoint_in_altaz --fit-extra az:sincos:az;el:2;2 --fit-sigma 3 --fit-output altaz.model" << std::endl;
 } 
 
 int TelModelTest::processOption (int in_opt)
@@ -260,6 +283,26 @@ int TelModelTest::processOption (int in_opt)
 		case OPT_RADEC:
 			return parseRaDec (optarg, localPosition.ra, localPosition.dec);
 			break;
+		case OPT_FIT:
+			fitFiles.push_back (optarg);
+			break;
+		case OPT_FIT_EXTRA:
+			fitExtras.push_back (optarg);
+			break;
+		case OPT_FIT_FIXED:
+			fitFixed.push_back (optarg);
+			break;
+		case OPT_FIT_SIGMA:
+			fitSigma = atof (optarg);
+			if (!(fitSigma > 0))
+			{
+				std::cerr << "invalid sigma " << optarg << std::endl;
+				return -1;
+			}
+			break;
+		case OPT_FIT_OUTPUT:
+			fitOutput = optarg;
+			break;
 		default:
 			return rts2core::App::processOption (in_opt);
 	}
@@ -279,6 +322,9 @@ int TelModelTest::init ()
 	if (ret)
 		return ret;
 
+	if (!fitFiles.empty ())
+		return 0;
+
 	if (!rpoint && runFiles.empty () && localDate == 0 && errorFile == NULL && countsFile == NULL)
 	{
 		help ();
@@ -651,6 +697,8 @@ void TelModelTest::runOnTPDatFile (std::string filename, std::ostream & os)
 
 int TelModelTest::doProcessing ()
 {
+	if (!fitFiles.empty ())
+		return processFit ();
 	if (errorFile != NULL)
 	{
 		processErrorFile ();
@@ -691,6 +739,81 @@ int TelModelTest::doProcessing ()
 	return 0;
 }
 
+int TelModelTest::processFit ()
+{
+	GPointFit fit;
+	try
+	{
+		for (std::vector <std::string>::iterator iter = fitFiles.begin (); iter != fitFiles.end (); iter++)
+		{
+			int n = fit.loadInput (iter->c_str ());
+			if (verbose)
+				std::cout << "loaded " << n << " observations from " << *iter << std::endl;
+		}
+		for (std::vector <std::string>::iterator iter = fitExtras.begin (); iter != fitExtras.end (); iter++)
+		{
+			std::vector <std::string> e = SplitStr (*iter, ":");
+			if (e.size () != 4)
+			{
+				std::cerr << "invalid extra term " << *iter << ", expected axis:function:terms:consts" << std::endl;
+				return -1;
+			}
+			fit.addExtra (e[0].c_str (), e[1].c_str (), e[2].c_str (), e[3].c_str ());
+		}
+		for (std::vector <std::string>::iterator iter = fitFixed.begin (); iter != fitFixed.end (); iter++)
+			fit.setFixed (iter->c_str ());
+	}
+	catch (rts2core::Error &er)
+	{
+		std::cerr << er << std::endl;
+		return -1;
+	}
+
+	double rms;
+	if (std::isnan (fitSigma))
+	{
+		rms = fit.fit ();
+	}
+	else
+	{
+		int removed = fit.fitRejectOutliers (fitSigma);
+		rms = fit.fit ();
+		std::cout << "removed " << removed << " outliers" << std::endl;
+	}
+
+	if (std::isnan (rms))
+	{
+		std::cerr << "model fit failed" << std::endl;
+		return -1;
+	}
+
+	std::cout << "observations " << fit.activeSize () << " of " << fit.size () << ", " << fit.getIterations () << " iterations, RMS " << rms << "\"" << std::endl;
+	fit.printParameters (std::cout);
+
+	if (verbose)
+	{
+		for (size_t i = 0; i < fit.size (); i++)
+			std::cout << i << " " << (fit[i].active ? "" : "removed ") << ln_rad_to_deg (fit.getError (i)) * 3600.0 << "\"" << std::endl;
+	}
+
+	if (fitOutput)
+	{
+		std::ofstream of (fitOutput);
+		fit.print (of);
+		of.close ();
+		if (of.fail ())
+		{
+			std::cerr << "cannot write model to " << fitOutput << std::endl;
+			return -1;
+		}
+	}
+	else
+	{
+		fit.print (std::cout);
+	}
+	return 0;
+}
+
 void TelModelTest::processErrorFile ()
 {
 	std::ifstream ef (errorFile);
@@ -19,25 +19,22 @@
 
 #include "app.h"
 #include "radecparser.h"
-#include "ucac5/UCAC5Record.hpp"
-#include "ucac5/UCAC5Idx.hpp"
-#include "ucac5/UCAC5Bands.hpp"
+#include "ucac5/UCAC5Cache.hpp"
 
 #include <libnova_cpp.h>
 
 #include <errno.h>
 #include <string>
 #include <vector>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
 #include <erfa.h>
 
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <sys/mman.h>
-#include <fcntl.h>
-#include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 
 class UCAC5Search:public rts2core::App
 {
@@ -53,6 +50,14 @@ class UCAC5Search:public rts2core::App
 		virtual void usage ();
 
 	private:
+		struct SearchField
+		{
+			double ra;
+			double dec;
+			double minRad;
+			double maxRad;
+		};
+
 		std::string radec;
 		double ra;
 		double dec;
@@ -61,12 +66,22 @@ class UCAC5Search:public rts2core::App
 		int argCount;
 		int verbose;
 		std::string base;
+		const char *fieldsFile;
+		double epoch;
+		int threads;
+
+		std::vector <SearchField> searchFields;
+
+		int readFields ();
 };
 
-UCAC5Search::UCAC5Search (int argc, char **argv):App (argc, argv), radec(""), ra(NAN), dec(NAN), minRad(NAN), maxRad(NAN), argCount(0), verbose(0), base("~/ucac5")
+UCAC5Search::UCAC5Search (int argc, char **argv):App (argc, argv), radec(""), ra(NAN), dec(NAN), minRad(NAN), maxRad(NAN), argCount(0), verbose(0), base("~/ucac5"), fieldsFile(NULL), epoch(NAN), threads(2)
 {
 	addOption('v', NULL, 0, "increases verbosity");
 	addOption('b', NULL, 1, "UCAC5 base path");
+	addOption('f', NULL, 1, "file with fields (RA DEC minRadius maxRadius on each line); fields are prefetched in parallel");
+	addOption('e', NULL, 1, "epoch of returned positions (Julian year); default is current epoch");
+	addOption('t', NULL, 1, "number of prefetch threads (default 2)");
 }
 
 int UCAC5Search::run()
@@ -74,92 +89,104 @@ int UCAC5Search::run()
 	int ret = init();
 	if (ret)
 		return ret;
-	if (std::isnan(ra) || std::isnan(dec) || std::isnan(minRad) || std::isnan(maxRad))
+	if (fieldsFile)
 	{
-		std::cerr << "you must provide ra dec min max, please see -h for details" << std::endl;
-		return -2;
+		ret = readFields();
+		if (ret)
+			return ret;
 	}
-	base.replace(base.find("~"), 1, getenv("HOME"));
-	ret = chdir(base.c_str());
-	if (ret)
+	else
 	{
-		std::cerr << "cannot change directory to " << base << ":" << strerror(errno) << std::endl;
-		return -1;
+		if (std::isnan(ra) || std::isnan(dec) || std::isnan(minRad) || std::isnan(maxRad))
+		{
+			std::cerr << "you must provide ra dec min max, please see -h for details" << std::endl;
+			return -2;
+		}
+		SearchField f;
+		f.ra = ra;
+		f.dec = dec;
+		f.minRad = minRad;
+		f.maxRad = maxRad;
+		searchFields.push_back(f);
 	}
+	if (base.find("~") != std::string::npos)
+		base.replace(base.find("~"), 1, getenv("HOME"));
 
-	std::cout << "# searching " << LibnovaRaDec(ra, dec) << " <" << minRad << "," << maxRad << ">" << std::endl;
+	if (std::isnan(epoch))
+		epoch = 2000.0 + (ln_get_julian_from_sys() - JD2000) / 365.25;
 
-	UCAC5Bands bands;
-	ret = bands.openBand("u5index.unf");
+	UCAC5Cache cache(searchFields.size());
+	ret = cache.openCatalog(base.c_str());
 	if (ret)
 	{
 		std::cerr << "cannot open band index file " << base << "/u5index.unf" << std::endl;
 		return -1;
 	}
 
-	double ra_r = D2R * ra, dec_r = D2R * dec, min_r = AS2R * minRad, max_r = AS2R * maxRad;
-
-	UCAC5Idx *index = NULL;
-	uint16_t dec_b = 0, ra_b = 0;
-	uint32_t ra_start = 0;
-	int32_t len;
-
-	Vector tar;
-	eraS2c(ra_r, dec_r, tar.data);
+	if (searchFields.size() > 1)
+	{
+		cache.startPrefetch(threads);
+		for (std::vector <SearchField>::iterator iter = searchFields.begin(); iter != searchFields.end(); iter++)
+			cache.prefetch(D2R * iter->ra, D2R * iter->dec, AS2R * iter->maxRad);
+	}
 
-	while ((bands.nextBand(ra_r, dec_r, max_r, dec_b, ra_b, ra_start, len)) == 0)
+	for (std::vector <SearchField>::iterator iter = searchFields.begin(); iter != searchFields.end(); iter++)
 	{
-		if (verbose)
-			std::cout << "# band " << dec_b << " RA " << ra_b << " (" << ra_start << ".." << len << ")" << std::endl;
-		// open index file..
-		if (index == NULL || index->getBand() != dec_b)
-		{
-			delete index;
-			index = new UCAC5Idx();
-			ret = index->openIdx(dec_b);
-			if (ret)
-			{
-				std::cerr << "Error opening index file for band " << dec_b << ":" << strerror(errno) << std::endl;
-				return -1;
-			}
-		}
-		index->select(ra_start, len);
-		struct ucac5 *data = NULL;
-		char fn[5];
-		snprintf(fn, 5, "z%03d", dec_b + 1);
-		int fd = open(fn, O_RDONLY);
-		if (fd < 0)
+		std::cout << "# searching " << LibnovaRaDec(iter->ra, iter->dec) << " <" << iter->minRad << "," << iter->maxRad << "> epoch " << std::fixed << std::setprecision(3) << epoch << std::endl;
+
+		std::vector <UCAC5Star> stars;
+		ret = cache.getStars(D2R * iter->ra, D2R * iter->dec, AS2R * iter->minRad, AS2R * iter->maxRad, epoch, stars);
+		if (ret < 0)
 		{
-			std::cerr << "Cannot open " << fn << ":" << strerror(errno) << std::endl;
+			std::cerr << "Error reading catalog files for " << LibnovaRaDec(iter->ra, iter->dec) << ":" << strerror(errno) << std::endl;
 			return -1;
 		}
-		struct stat sb;
-		ret = fstat(fd, &sb);
-		if (ret)
+
+		for (std::vector <UCAC5Star>::iterator siter = stars.begin(); siter != stars.end(); siter++)
 		{
-			std::cerr << "Cannot get size of " << fn << ":" << strerror(errno) << std::endl;
-			return -1;
+			if (verbose)
+				std::cout << "# star " << LibnovaDegDist(ln_rad_to_deg(siter->dist)) << std::endl;
+			std::cout << std::setw(8) << std::setfill('0') << siter->srcid << std::setfill(' ') << " " << LibnovaRa(ln_rad_to_deg(siter->ra)) << " " << LibnovaDec(ln_rad_to_deg(siter->dec)) << " " << std::setprecision(3) << siter->gmag << std::endl;
 		}
-		data = (struct ucac5*) mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
-		if (data == MAP_FAILED)
-			return -1;
+	}
+
+	if (verbose)
+		std::cout << "# cache hits " << cache.getHits() << " misses " << cache.getMisses() << " prefetched " << cache.getPrefetched() << std::endl;
+
+	return 0;
+}
 
-		while(true)
+int UCAC5Search::readFields ()
+{
+	std::ifstream is(fieldsFile);
+	if (is.fail())
+	{
+		std::cerr << "cannot open fields file " << fieldsFile << ":" << strerror(errno) << std::endl;
+		return -1;
+	}
+	std::string line;
+	int ln = 0;
+	while (std::getline(is, line))
+	{
+		ln++;
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream ls(line);
+		std::string sra, sdec;
+		SearchField f;
+		ls >> sra >> sdec >> f.minRad >> f.maxRad;
+		if (ls.fail() || parseRaDec((sra + " " + sdec).c_str(), f.ra, f.dec))
 		{
-			double d;
-			int star = index->nextMatched(&tar, min_r, max_r, d);
-			if(star < 0)
-				break;
-			if(verbose)
-				std::cout << "# star " << star << " " << LibnovaDegDist(ln_rad_to_deg(d)) << std::endl;
-			UCAC5Record rec(data + star);
-			std::cout << rec.getString() << std::endl;
+			std::cerr << "invalid field on line " << ln << " of " << fieldsFile << ":" << line << std::endl;
+			return -1;
 		}
-		munmap(data, sb.st_size);
-		close(fd);
+		searchFields.push_back(f);
+	}
+	if (searchFields.empty())
+	{
+		std::cerr << "no fields in " << fieldsFile << std::endl;
+		return -1;
 	}
-	delete index;
-
 	return 0;
 }
 
@@ -173,6 +200,15 @@ int UCAC5Search::processOption (int opt)
 		case 'b':
 			base = optarg;
 			break;
+		case 'f':
+			fieldsFile = optarg;
+			break;
+		case 'e':
+			epoch = atof(optarg);
+			break;
+		case 't':
+			threads = atoi(optarg);
+			break;
 		default:
 			return App::processOption(opt);
 	}
@@ -206,7 +242,10 @@ void UCAC5Search::usage ()
 	std::cout << "Provide RA DEC minRadius maxRadius, and you will receive list of matched stars:" << std::endl
 		<< std::endl
 		<< "Example:" << std::endl
-		<< "\tucac5-search 10:20:33 +20:56:14 0 1000" << std::endl;
+		<< "\tucac5-search 10:20:33 +20:56:14 0 1000" << std::endl
+		<< std::endl
+		<< "Multiple fields can be provided in file, they will be loaded in parallel:" << std::endl
+		<< "\tucac5-search -f fields.txt -e 2026.8" << std::endl;
 }
 
 int main (int argc, char **argv)
@@ -0,0 +1,340 @@
+/*
+ * UCAC5 catalogue daemon, prefetching fields of upcoming targets.
+ * Copyright (C) 2026 Petr Kubanek <petr@kubanek.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "rts2db/devicedb.h"
+#include "rts2db/target.h"
+#include "ucac5/UCAC5Cache.hpp"
+
+#include <libnova_cpp.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+#define OPT_RADIUS     OPT_LOCAL + 870
+#define OPT_FIELDS     OPT_LOCAL + 871
+
+namespace rts2catd
+{
+
+/**
+ * UCAC5 catalogue service. Watches next and queued targets of the
+ * executor, resolves their positions from the database and prefetches
+ * catalogue fields around them in background threads. Astrometry and
+ * photometry scripts receive stars of the field with the stars command,
+ * which is served from memory once the field was prefetched.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class UCAC5Daemon:public rts2db::DeviceDb
+{
+	public:
+		UCAC5Daemon (int argc, char **argv);
+		virtual ~UCAC5Daemon ();
+
+		virtual rts2core::DevClient *createOtherType (rts2core::Connection *conn, int other_device_type);
+
+		virtual int info ();
+
+		virtual int commandAuthorized (rts2core::Connection *conn);
+
+		/**
+		 * Resolve target position and queue field around it for prefetch.
+		 */
+		void prefetchTarget (int tar_id);
+
+	protected:
+		virtual int processOption (int opt);
+		virtual int reloadConfig ();
+		virtual int init ();
+
+	private:
+		UCAC5Cache *cache;
+		std::string base;
+		int threads;
+		int maxFields;
+
+		struct ln_lnlat_posn *observer;
+		double obs_altitude;
+
+		rts2core::ValueDouble *fieldRadius;
+		rts2core::ValueInteger *lastTarget;
+		rts2core::ValueLong *cachedFields;
+		rts2core::ValueLong *queuedFields;
+		rts2core::ValueLong *prefetched;
+		rts2core::ValueLong *hits;
+		rts2core::ValueLong *misses;
+
+		// write stars around given position (degrees) to file
+		int writeStars (double ra, double dec, double radius, const char *filename);
+};
+
+/**
+ * Prefetch fields for targets set as current, next or queued in the executor.
+ *
+ * @author Petr Kubanek <petr@kubanek.net>
+ */
+class UCAC5ExecClient:public rts2core::DevClientExecutor
+{
+	public:
+		UCAC5ExecClient (rts2core::Connection *conn):rts2core::DevClientExecutor (conn) {}
+
+		virtual void valueChanged (rts2core::Value *value);
+};
+
+}
+
+using namespace rts2catd;
+
+void UCAC5ExecClient::valueChanged (rts2core::Value *value)
+{
+	UCAC5Daemon *master = (UCAC5Daemon *) getMaster ();
+	const std::string &name = value->getName ();
+
+	if (name == "current" || name == "next")
+	{
+		master->prefetchTarget (value->getValueInteger ());
+	}
+	// queue target IDs, e.g. next_ids
+	else if (value->getValueType () == (RTS2_VALUE_ARRAY | RTS2_VALUE_INTEGER) && name.length () > 4 && name.compare (name.length () - 4, 4, "_ids") == 0 && name.find ("_removed_ids") == std::string::npos)
+	{
+		rts2core::IntegerArray *ids = (rts2core::IntegerArray *) value;
+		for (std::vector <int>::iterator iter = ids->valueBegin (); iter != ids->valueEnd (); iter++)
+			master->prefetchTarget (*iter);
+	}
+
+	rts2core::DevClientExecutor::valueChanged (value);
+}
+
+UCAC5Daemon::UCAC5Daemon (int argc, char **argv):rts2db::DeviceDb (argc, argv, DEVICE_TYPE_CAT, "UCAC5")
+{
+	cache = NULL;
+	base = "~/ucac5";
+	threads = 2;
+	maxFields = 32;
+
+	observer = NULL;
+	obs_altitude = NAN;
+
+	createValue (fieldRadius, "field_radius", "radius of prefetched fields", false, RTS2_VALUE_WRITABLE | RTS2_DT_DEG_DIST);
+	fieldRadius->setValueDouble (0.5);
+
+	createValue (lastTarget, "last_target", "ID of the last target whose field was prefetched", false);
+	createValue (cachedFields, "cached_fields", "number of fields in cache", false);
+	createValue (queuedFields, "queued_fields", "number of fields waiting for prefetch", false);
+	createValue (prefetched, "prefetched", "number of fields loaded by background threads", false);
+	createValue (hits, "hits", "number of requests served from cache", false);
+	createValue (misses, "misses", "number of requests which read catalogue files", false);
+
+	addOption ('b', NULL, 1, "UCAC5 base path (default ~/ucac5)");
+	addOption ('t', NULL, 1, "number of prefetch threads (default 2)");
+	addOption (OPT_RADIUS, "radius", 1, "radius of prefetched fields (degrees, default 0.5)");
+	addOption (OPT_FIELDS, "fields", 1, "maximal number of cached fields (default 32)");
+}
+
+UCAC5Daemon::~UCAC5Daemon ()
+{
+	if (cache)
+		cache->stopPrefetch ();
+	delete cache;
+}
+
+rts2core::DevClient *UCAC5Daemon::createOtherType (rts2core::Connection *conn, int other_device_type)
+{
+	if (other_device_type == DEVICE_TYPE_EXECUTOR)
+		return new UCAC5ExecClient (conn);
+	return rts2db::DeviceDb::createOtherType (conn, other_device_type);
+}
+
+int UCAC5Daemon::info ()
+{
+	cachedFields->setValueLong (cache->fieldCount ());
+	queuedFields->setValueLong (cache->queueSize ());
+	prefetched->setValueLong (cache->getPrefetched ());
+	hits->setValueLong (cache->getHits ());
+	misses->setValueLong (cache->getMisses ());
+	return rts2db::DeviceDb::info ();
+}
+
+int UCAC5Daemon::commandAuthorized (rts2core::Connection *conn)
+{
+	if (conn->isCommand ("prefetch"))
+	{
+		int tar_id;
+		if (conn->paramNextInteger (&tar_id) || !conn->paramEnd ())
+			return -2;
+		prefetchTarget (tar_id);
+		return 0;
+	}
+	else if (conn->isCommand ("stars"))
+	{
+		double ra, dec, radius;
+		char *filename;
+		if (conn->paramNextHMS (&ra) || conn->paramNextDMS (&dec) || conn->paramNextDouble (&radius) || conn->paramNextString (&filename) || !conn->paramEnd ())
+			return -2;
+		return writeStars (ra, dec, radius, filename) == 0 ? 0 : -2;
+	}
+	return rts2db::DeviceDb::commandAuthorized (conn);
+}
+
+void UCAC5Daemon::prefetchTarget (int tar_id)
+{
+	if (tar_id <= 0)
+		return;
+
+	rts2db::Target *tar;
+	try
+	{
+		tar = createTarget (tar_id, observer, obs_altitude);
+	}
+	catch (rts2core::Error &er)
+	{
+		logStream (MESSAGE_ERROR) << "cannot load target with ID " << tar_id << ": " << er << sendLog;
+		return;
+	}
+	if (tar == NULL)
+	{
+		logStream (MESSAGE_WARNING) << "cannot find target with ID " << tar_id << sendLog;
+		return;
+	}
+
+	// calibration targets do not need catalogue
+	if (tar->getTargetType () == TYPE_DARK || tar->getTargetType () == TYPE_FLAT)
+	{
+		delete tar;
+		return;
+	}
+
+	struct ln_equ_posn pos;
+	tar->getPosition (&pos, ln_get_julian_from_sys ());
+	delete tar;
+
+	if (std::isnan (pos.ra) || std::isnan (pos.dec))
+		return;
+
+	cache->prefetch (ln_deg_to_rad (pos.ra), ln_deg_to_rad (pos.dec), ln_deg_to_rad (fieldRadius->getValueDouble ()));
+
+	if (lastTarget->getValueInteger () != tar_id)
+	{
+		lastTarget->setValueInteger (tar_id);
+		sendValueAll (lastTarget);
+	}
+}
+
+int UCAC5Daemon::processOption (int opt)
+{
+	switch (opt)
+	{
+		case 'b':
+			base = optarg;
+			break;
+		case 't':
+			threads = atoi (optarg);
+			if (threads < 1)
+			{
+				std::cerr << "invalid number of threads " << optarg << std::endl;
+				return -1;
+			}
+			break;
+		case OPT_RADIUS:
+			fieldRadius->setValueDouble (atof (optarg));
+			break;
+		case OPT_FIELDS:
+			maxFields = atoi (optarg);
+			if (maxFields < 1)
+			{
+				std::cerr << "invalid number of fields " << optarg << std::endl;
+				return -1;
+			}
+			break;
+		default:
+			return rts2db::DeviceDb::processOption (opt);
+	}
+	return 0;
+}
+
+int UCAC5Daemon::reloadConfig ()
+{
+	int ret = rts2db::DeviceDb::reloadConfig ();
+	if (ret)
+		return ret;
+	observer = config->getObserver ();
+	obs_altitude = config->getObservatoryAltitude ();
+	return 0;
+}
+
+int UCAC5Daemon::init ()
+{
+	int ret = rts2db::DeviceDb::init ();
+	if (ret)
+		return ret;
+
+	if (base.find ("~") != std::string::npos)
+		base.replace (base.find ("~"), 1, getenv ("HOME"));
+
+	cache = new UCAC5Cache (maxFields);
+	if (cache->openCatalog (base.c_str ()))
+	{
+		logStream (MESSAGE_ERROR) << "cannot open UCAC5 catalogue in " << base << sendLog;
+		return -1;
+	}
+	if (cache->startPrefetch (threads))
+	{
+		logStream (MESSAGE_ERROR) << "cannot start prefetch threads" << sendLog;
+		return -1;
+	}
+	return 0;
+}
+
+int UCAC5Daemon::writeStars (double ra, double dec, double radius, const char *filename)
+{
+	double epoch = 2000.0 + (ln_get_julian_from_sys () - JD2000) / 365.25;
+
+	std::vector <UCAC5Star> stars;
+	if (cache->getStars (ln_deg_to_rad (ra), ln_deg_to_rad (dec), 0, ln_deg_to_rad (radius), epoch, stars) < 0)
+	{
+		logStream (MESSAGE_ERROR) << "cannot read UCAC5 stars around " << LibnovaRaDec (ra, dec) << sendLog;
+		return -1;
+	}
+
+	std::ofstream os (filename);
+	if (!os.good ())
+	{
+		logStream (MESSAGE_ERROR) << "cannot write stars to " << filename << ": " << strerror (errno) << sendLog;
+		return -1;
+	}
+	os << "# UCAC5 stars around " << ra << " " << dec << " radius " << radius << " epoch " << std::fixed << std::setprecision (3) << epoch << std::endl
+		<< "# srcid ra dec gmag umag rmag jmag hmag kmag" << std::endl;
+	for (std::vector <UCAC5Star>::iterator iter = stars.begin (); iter != stars.end (); iter++)
+		os << iter->srcid << std::setprecision (7) << " " << ln_rad_to_deg (iter->ra) << " " << ln_rad_to_deg (iter->dec)
+			<< std::setprecision (3) << " " << iter->gmag << " " << iter->umag << " " << iter->rmag << " " << iter->jmag << " " << iter->hmag << " " << iter->kmag << std::endl;
+	os.close ();
+
+	logStream (MESSAGE_DEBUG) << "wrote " << stars.size () << " UCAC5 stars to " << filename << sendLog;
+	return 0;
+}
+
+int main (int argc, char **argv)
+{
+	UCAC5Daemon device (argc, argv);
+	return device.run ();
+}